@@ -51,13 +51,28 @@ extern "C" {
 
 typedef double ysfx_real;
 
+// the number of sliders is fixed at build time, as a multiple of 64
+//   the public structures do not depend on it; ysfx_get_max_sliders gives the value of the library
+#if !defined(YSFX_MAX_SLIDERS)
+#   define YSFX_MAX_SLIDERS 256
+#endif
+#if YSFX_MAX_SLIDERS < 64 || YSFX_MAX_SLIDERS % 64 != 0
+#   error "YSFX_MAX_SLIDERS must be a non-zero multiple of 64"
+#endif
+#if !defined(YSFX_MAX_CHANNELS)
+#   define YSFX_MAX_CHANNELS 1024
+#endif
+#if YSFX_MAX_CHANNELS < 64
+#   error "YSFX_MAX_CHANNELS must be at least 64"
+#endif
+
 enum {
-    ysfx_max_sliders = 256,
-    ysfx_max_channels = 64,
+    ysfx_max_sliders = YSFX_MAX_SLIDERS,
+    ysfx_max_channels = YSFX_MAX_CHANNELS, // the most pins, an effect only has the channels of its pins
     ysfx_max_midi_buses = 16,
     ysfx_max_triggers = 10,
-    ysfx_max_slider_groups = 4,  // needs to be ysfx_max_sliders / 64
-    ysfx_max_default_vars = 1024,  // needs to be bigger than max_sliders + all the built in variables
+    ysfx_max_slider_groups = YSFX_MAX_SLIDERS / 64,
+    ysfx_max_default_vars = YSFX_MAX_SLIDERS + 768,  // needs to be bigger than max_sliders + all the built in variables
 };
 
 typedef enum ysfx_log_level_e {
@@ -88,16 +103,39 @@ YSFX_API void ysfx_set_data_root(ysfx_config_t *config, const char *root);
 YSFX_API const char *ysfx_get_import_root(ysfx_config_t *config);
 // get the path of the data root, a folder usually named "Data"
 YSFX_API const char *ysfx_get_data_root(ysfx_config_t *config);
+// invalidate the index of the files under the import root, after they have changed on disk
+YSFX_API void ysfx_refresh_import_root(ysfx_config_t *config);
+// set the path of a folder which caches parsed sources between sessions; if empty, there is no cache
+YSFX_API void ysfx_set_cache_root(ysfx_config_t *config, const char *root);
+// get the path of the folder which caches parsed sources
+YSFX_API const char *ysfx_get_cache_root(ysfx_config_t *config);
+// set the path of a folder where `file_open_write` creates files, by names relative to it; if empty, the code cannot write files
+YSFX_API void ysfx_set_write_root(ysfx_config_t *config, const char *root);
+// get the path of the folder where the code writes files
+YSFX_API const char *ysfx_get_write_root(ysfx_config_t *config);
 // guess the undefined root folders, based on the path to the JSFX file
 YSFX_API void ysfx_guess_file_roots(ysfx_config_t *config, const char *sourcepath);
 // register an audio format into the system
 YSFX_API void ysfx_register_audio_format(ysfx_config_t *config, ysfx_audio_format_t *afmt);
 // register the builtin audio formats (at least WAV file support)
 YSFX_API void ysfx_register_builtin_audio_formats(ysfx_config_t *config);
+// keep up to `max_bytes` of decoded audio files in memory, for the effects to read instead of decoding them again; 0 disables
+//   the effects read the files which are in use from memory, even the ones which exceed the size after they are released
+YSFX_API void ysfx_set_audio_cache_size(ysfx_config_t *config, uint64_t max_bytes);
+// make the configuration use the decoded audio files of another, so their effects share them
+YSFX_API void ysfx_share_audio_cache(ysfx_config_t *config, ysfx_config_t *other);
+// set the number of threads which read and parse the imports of a file, including the loading thread;
+//   0 uses one per processor, which is the default, and 1 loads them in sequence
+YSFX_API void ysfx_set_load_threads(ysfx_config_t *config, uint32_t num_threads);
 // set the log reporting function
 YSFX_API void ysfx_set_log_reporter(ysfx_config_t *config, ysfx_log_reporter_t *reporter);
 // set the callback user data
 YSFX_API void ysfx_set_user_data(ysfx_config_t *config, intptr_t userdata);
+// back the global memory of the name `options:gmem` gives with a file, which maps its first `size` items;
+//   the file is created as needed, it keeps the contents, and the processes which map it share them;
+//   a null or empty path removes it. This applies to the memories which are created after:
+//   one which exists already, in the process, stays as it is until its last instance releases it
+YSFX_API void ysfx_set_gmem_file(ysfx_config_t *config, const char *name, const char *path, uint32_t size);
 
 // get a string which textually represents the log level
 YSFX_API const char *ysfx_log_level_string(ysfx_log_level level);
@@ -129,6 +167,20 @@ YSFX_API void ysfx_unload(ysfx_t *fx);
 // check whether the effect is loaded
 YSFX_API bool ysfx_is_loaded(ysfx_t *fx);
 
+// load a file with its imports on a thread in the background, so that the next `ysfx_load_file` of it finds
+//   them parsed in memory; the configuration keeps the sections of the last few files which it prewarmed
+// the compiled code is not prepared, because it belongs to the VM of each instance
+YSFX_API void ysfx_prewarm(ysfx_config_t *config, const char *filepath);
+// wait until the files which are requested to prewarm are done
+YSFX_API void ysfx_prewarm_wait(ysfx_config_t *config);
+// decode ahead the files of a manifest from `ysfx_get_init_manifest`, in parallel on threads in the background,
+//   into the caches which the instances share: the audio files into the audio cache of the configuration,
+//   and the images into those which the configuration keeps; the other files are read through
+// calling this for all the instances of a session, before they initialize, overlaps their I/O
+YSFX_API void ysfx_preload(ysfx_config_t *config, const char *manifest);
+// wait until the files which are requested to preload are done
+YSFX_API void ysfx_preload_wait(ysfx_config_t *config);
+
 // get the name of the effect
 YSFX_API const char *ysfx_get_name(ysfx_t *fx);
 // get the path of the file which is loaded
@@ -149,14 +201,56 @@ YSFX_API uint32_t ysfx_get_num_outputs(ysfx_t *fx);
 YSFX_API const char *ysfx_get_input_name(ysfx_t *fx, uint32_t index);
 // get the name of the output
 YSFX_API const char *ysfx_get_output_name(ysfx_t *fx, uint32_t index);
+// get whether the input is a sidechain, according to its name
+YSFX_API bool ysfx_is_sidechain_input(ysfx_t *fx, uint32_t index);
 // get whether this effect wants metering
 YSFX_API bool ysfx_wants_meters(ysfx_t *fx);
+
+typedef struct ysfx_meter_s {
+    // the highest magnitude of the samples
+    ysfx_real peak;
+    // the root mean square of the samples
+    ysfx_real rms;
+} ysfx_meter_t;
+
+// measure the levels of the channels in and out of each cycle, which a host shows if the effect wants meters; disabled by default
+YSFX_API void ysfx_set_metering(ysfx_t *fx, bool enable);
+// get the levels of the inputs or the outputs over the cycles since the last call, which starts them over;
+//   returns the number of channels, which are the pins, and fills at most `destsize`
+// it does not lock, so a UI thread can call it while processing
+YSFX_API uint32_t ysfx_get_meters(ysfx_t *fx, bool outputs, ysfx_meter_t *dest, uint32_t destsize);
 // get requested dimensions of the graphics area; 0 means host should decide
 YSFX_API bool ysfx_get_gfx_dim(ysfx_t *fx, uint32_t dim[2]);
 // resolve an import path; note that this returns a char* string that needs to be freed with ysfx_free_resolved_path after use
 YSFX_API char *ysfx_resolve_path_and_allocate(ysfx_t* fx, const char* name, const char* origin);
 // free a path returned by ysfx_resolve_path_and_allocate
 YSFX_API void ysfx_free_resolved_path(char *path);
+// get the data files and the images which the last @init found, one path per line; the host keeps it
+//   with the saved state, and gives it to `ysfx_preload` as the project opens
+// note that this returns a char* string that needs to be freed with ysfx_free_resolved_path after use
+YSFX_API char *ysfx_get_init_manifest(ysfx_t *fx);
+
+// get the number of config items, which are the values of the preprocessor
+YSFX_API uint32_t ysfx_get_num_config_items(ysfx_t *fx);
+// get the identifier of a config item, which the preprocessor defines
+YSFX_API const char *ysfx_get_config_item_identifier(ysfx_t *fx, uint32_t index);
+// get the display name of a config item
+YSFX_API const char *ysfx_get_config_item_name(ysfx_t *fx, uint32_t index);
+// get the number of values which a config item lists
+YSFX_API uint32_t ysfx_get_config_item_num_values(ysfx_t *fx, uint32_t index);
+// get a value which a config item lists
+YSFX_API ysfx_real ysfx_get_config_item_value(ysfx_t *fx, uint32_t index, uint32_t value_index);
+// get the display name of a value which a config item lists
+YSFX_API const char *ysfx_get_config_item_value_name(ysfx_t *fx, uint32_t index, uint32_t value_index);
+// get the value of a config item which the files are preprocessed with
+YSFX_API ysfx_real ysfx_get_config_value(ysfx_t *fx, uint32_t index);
+// load the files again for another value of a config item, the default or one which it lists
+//   if the effect was compiled, it compiles with the same options, runs @init and keeps the state;
+//   the variants which were loaded stay in memory, so switching back does not preprocess again
+// NOTE: call this neither concurrently with processing nor with @gfx
+YSFX_API bool ysfx_set_config_value(ysfx_t *fx, uint32_t index, ysfx_real value);
+// prepare the variants for each other value of a config item, keeping the rest; on a thread if `background`
+YSFX_API void ysfx_prepare_config_variants(ysfx_t *fx, bool background);
 
 
 typedef enum ysfx_section_type_e {
@@ -166,11 +260,148 @@ typedef enum ysfx_section_type_e {
     ysfx_section_sample = 4,
     ysfx_section_gfx = 5,
     ysfx_section_serialize = 6,
+    ysfx_section_midi = 7,
 } ysfx_section_type_t;
 
 // get whether the source has the given section
 YSFX_API bool ysfx_has_section(ysfx_t *fx, uint32_t type);
 
+enum {
+    // a bit of `ysfx_get_changed_sections`, for the header and the layout of the files
+    ysfx_changed_header = 1 << 0,
+};
+
+// compare the sources of two effects, and get a mask of `1 << type` for each section whose code differs
+YSFX_API uint32_t ysfx_get_changed_sections(ysfx_t *fx, ysfx_t *other);
+
+enum {
+    // histogram bins of execution times, where bin `i` counts times in [2^(i-1), 2^i) nanoseconds
+    ysfx_profile_histogram_size = 32,
+};
+
+typedef struct ysfx_profile_stats_s {
+    // number of measured executions
+    uint64_t calls;
+    // total, minimum and maximum execution times, in nanoseconds
+    uint64_t total_ns;
+    uint64_t min_ns;
+    uint64_t max_ns;
+    // distribution of execution times
+    uint32_t histogram[ysfx_profile_histogram_size];
+} ysfx_profile_stats_t;
+
+// enable or disable measuring the execution time of sections; disabled by default
+YSFX_API void ysfx_set_profiling(ysfx_t *fx, bool enable);
+// get the execution statistics of a section; @sample is measured once for all frames of a cycle
+YSFX_API bool ysfx_get_profile_stats(ysfx_t *fx, uint32_t type, ysfx_profile_stats_t *stats);
+// reset the execution statistics of all sections
+YSFX_API void ysfx_reset_profile_stats(ysfx_t *fx);
+// get the part of the execution time of @gfx spent inside the `gfx_*` functions, in nanoseconds;
+//   the rest is the time of the code of the effect
+YSFX_API uint64_t ysfx_get_gfx_draw_ns(ysfx_t *fx);
+
+enum {
+    // histogram bins of the loads of the cycles, where bin `i` counts loads in [i, i+1) percent
+    //   and the last bin counts the loads above
+    ysfx_deadline_histogram_size = 256,
+};
+
+typedef struct ysfx_deadline_stats_s {
+    // number of measured processing cycles
+    uint64_t cycles;
+    // number of cycles which took longer than the duration of their frames
+    uint64_t misses;
+    // the loads, as ratios of the time of a cycle to the duration of its frames at the sample rate;
+    //   the percentiles are upper bounds, to the precision of the histogram
+    double max_load;
+    double p50_load;
+    double p90_load;
+    double p99_load;
+    double p999_load;
+    // distribution of the loads
+    uint32_t histogram[ysfx_deadline_histogram_size];
+} ysfx_deadline_stats_t;
+
+// get the loads of the processing cycles, which are measured at all times, to find the effects which miss deadlines
+YSFX_API void ysfx_get_deadline_stats(ysfx_t *fx, ysfx_deadline_stats_t *stats);
+// reset the loads of the processing cycles
+YSFX_API void ysfx_reset_deadline_stats(ysfx_t *fx);
+// get the recent load of the processing, as a ratio like the loads of `ysfx_get_deadline_stats`, from any thread;
+//   the average is smoothed over about a second of audio, and the peak holds the highest load, decaying over about 5 seconds
+YSFX_API void ysfx_get_cpu_load(ysfx_t *fx, double *avg, double *peak);
+
+typedef struct ysfx_line_sample_s {
+    // the path of the main file, or of an import
+    const char *file;
+    // the line, counting from 1
+    uint32_t line;
+    // the number of times this line was found running
+    uint64_t count;
+} ysfx_line_sample_t;
+
+// start or stop a thread which looks at the lines running at every period, in microseconds, or 0 for the default;
+//   it finds lines only in code compiled with `ysfx_compile_profile_lines`
+YSFX_API void ysfx_set_line_sampling(ysfx_t *fx, bool enable, uint32_t period_us);
+// get the lines which were found running, ordered by file and line; it fills at most `max`, and returns the count of all
+//   the paths are valid until the effect is unloaded
+YSFX_API uint32_t ysfx_get_line_samples(ysfx_t *fx, ysfx_line_sample_t *samples, uint32_t max);
+// forget the lines which were found running
+YSFX_API void ysfx_reset_line_samples(ysfx_t *fx);
+
+typedef struct ysfx_load_stats_s {
+    // time spent opening and reading files, including the cache, in nanoseconds
+    uint64_t io_ns;
+    // time spent in the preprocessor, in nanoseconds
+    uint64_t preprocess_ns;
+    // time spent parsing the preprocessed text, in nanoseconds
+    uint64_t parse_ns;
+    // time spent searching for imported files, in nanoseconds
+    uint64_t import_ns;
+    // number of files loaded, and how many of these were parsed already
+    uint32_t num_files;
+    uint32_t num_cached_files;
+    // the file which took the longest to load, and its time in nanoseconds
+    const char *slowest_file;
+    uint64_t slowest_file_ns;
+    // time spent compiling each section, and the size of the generated code in bytes, indexed by section type
+    uint64_t compile_ns[ysfx_section_midi + 1];
+    uint32_t code_size[ysfx_section_midi + 1];
+} ysfx_load_stats_t;
+
+// get the statistics of the last load and compilation; the file name stays valid until the next load
+YSFX_API void ysfx_get_load_stats(ysfx_t *fx, ysfx_load_stats_t *stats);
+
+typedef struct ysfx_code_arena_stats_s {
+    // the memory of the regions where the generated code of all effects is, in bytes
+    uint64_t reserved_bytes;
+    // the pages which hold code, in bytes
+    uint64_t used_bytes;
+    uint32_t num_regions;
+} ysfx_code_arena_stats_t;
+
+// back the generated code of all effects with huge pages, where the system has them, for the regions
+//   of code which are created after; it is off by default, and it is a hint to the system
+YSFX_API void ysfx_set_code_huge_pages(bool enable);
+// get the use of the memory of the generated code of all effects
+YSFX_API void ysfx_get_code_arena_stats(ysfx_code_arena_stats_t *stats);
+
+// start or stop recording a trace of the activity of all effects, on every thread; stopped by default
+//   it records the sections, the processing cycles with their MIDI, @gfx, the loads and the compilations
+YSFX_API void ysfx_set_tracing(bool enable);
+// get whether a trace is recording
+YSFX_API bool ysfx_is_tracing(void);
+// record a span of the activity of the host, on the calling thread, which ends at the matching `ysfx_trace_end`
+//   the names must be constant strings, which are kept until the trace is written
+YSFX_API void ysfx_trace_begin(const char *name);
+YSFX_API void ysfx_trace_end(void);
+// record the value of a counter of the host
+YSFX_API void ysfx_trace_value(const char *name, int64_t value);
+// give a name to the calling thread, which the trace displays; it has effect only while recording
+YSFX_API void ysfx_trace_thread_name(const char *name);
+// write the events recorded so far as JSON of the Chrome trace format, which Perfetto opens, and forget them
+//   each thread keeps a limited number of events between two writes, and counts the ones it drops
+YSFX_API bool ysfx_write_trace(const char *path);
+
 typedef struct ysfx_slider_range_s {
     ysfx_real def;
     ysfx_real min;
@@ -189,6 +420,10 @@ typedef struct ysfx_slider_curve_s {
 
 // determine if slider exists; call from 0 to max-1 to scan available ones
 YSFX_API bool ysfx_slider_exists(ysfx_t *fx, uint32_t index);
+// get the number of sliders which exist
+#define ysfx_get_slider_count(fx) ysfx_get_slider_indices((fx), NULL, 0)
+// get the indices of the sliders which exist, in ascending order
+YSFX_API uint32_t ysfx_get_slider_indices(ysfx_t *fx, uint32_t *dest, uint32_t destsize);
 // get the name of a slider
 YSFX_API const char *ysfx_slider_get_name(ysfx_t *fx, uint32_t index);
 // get the range of a slider (deprecated: use ysfx_slider_get_curve instead)
@@ -212,8 +447,44 @@ YSFX_API bool ysfx_slider_is_initially_visible(ysfx_t *fx, uint32_t index);
 
 // get the value of the slider
 YSFX_API ysfx_real ysfx_slider_get_value(ysfx_t *fx, uint32_t index);
+
+// get the number of sliders which the library was built for
+YSFX_API uint32_t ysfx_get_max_sliders(void);
+
+typedef struct ysfx_slider_snapshot_s {
+    // incremented when any of the values changes
+    uint64_t generation;
+    // the number of values, which is `ysfx_get_max_sliders()`
+    uint32_t count;
+    // the values of all the sliders, by index
+    const ysfx_real *values;
+} ysfx_slider_snapshot_t;
+
+// get the values of the sliders at the end of the latest processing cycle, which are consistent with each other
+//   the first call enables the copy after each cycle; a reader can skip its work while the generation is the same
+//   the snapshot remains valid until the next call, from a single reader thread
+YSFX_API const ysfx_slider_snapshot_t *ysfx_get_slider_snapshot(ysfx_t *fx);
 // set the value of the slider, and call @slider later if the value changed and we choose to notify the effect
 YSFX_API void ysfx_slider_set_value(ysfx_t *fx, uint32_t index, ysfx_real value, bool notify);
+// set the values of several sliders, as `ysfx_slider_set_value` does with notification, optionally from normalized values
+//   the normalized values follow the curves of the sliders, as sampled at load time, which approximates the shapes
+//   closely without computing them; the indices which are out of range are skipped
+YSFX_API void ysfx_slider_set_values(ysfx_t *fx, const uint32_t *indices, const ysfx_real *values, uint32_t count, bool normalized);
+// get the values of several sliders, optionally as normalized values, which are clamped to the range
+YSFX_API void ysfx_slider_get_values(ysfx_t *fx, const uint32_t *indices, ysfx_real *dest, uint32_t count, bool normalized);
+// schedule a change of the slider at a frame offset within the next cycle, and call @slider when it is applied
+//   false is returned if the offset is not within the block size, or if the changes of the cycle fill their reserve
+//   (as many as there are sliders, plus the capacity of the queue), since this never allocates
+YSFX_API bool ysfx_slider_set_value_at(ysfx_t *fx, uint32_t index, ysfx_real value, uint32_t offset);
+// make the changes scheduled at offsets glide linearly over a number of frames, or apply them at once if 0
+//   the slider moves before each @sample, and @slider is called when it arrives
+YSFX_API bool ysfx_slider_set_smoothing(ysfx_t *fx, uint32_t index, uint32_t frames);
+// set the number of slider changes which other threads can post ahead of the next cycle, or 0 to disable posting
+//   this discards the changes which are posted already; do not call it while other threads post or process
+YSFX_API void ysfx_set_slider_queue_capacity(ysfx_t *fx, uint32_t capacity);
+// post a slider change from any thread, without locking, to be scheduled like `ysfx_slider_set_value_at` in the next cycle
+//   the changes keep their order, and false is returned if the queue is full
+YSFX_API bool ysfx_post_slider_value(ysfx_t *fx, uint32_t index, ysfx_real value, uint32_t offset);
 
 // Note, there are two variants of these "normalized" slider values and they deal with
 // zero differently. In REAPER JSFX that span zero in their range, define the zero at
@@ -256,27 +527,114 @@ typedef enum ysfx_compile_option_e {
     ysfx_compile_no_serialize = 1 << 0,
     // skip compiling the @gfx section
     ysfx_compile_no_gfx = 1 << 1,
+    // compile @gfx and @serialize when they first run, rather than upfront
+    ysfx_compile_lazy = 1 << 2,
+    // insert probes before the statements, for `ysfx_set_line_sampling`; it makes the code slower
+    ysfx_compile_profile_lines = 1 << 3,
+    // compile variants of @sample in the background, for the values of the variables of `options:const=a,b`
+    //   which do not change while @sample runs; the compiler folds the expressions of these values,
+    //   and removes the branches which cannot run; it is not used with `ysfx_compile_profile_lines`
+    ysfx_compile_specialize = 1 << 4,
+    // compile also a @sample which loops over the frames of a block by itself, instead of running
+    //   once per frame; it saves the cost of entering the code at every frame, which is most of
+    //   the time of a short @sample; it is not used with `ysfx_compile_profile_lines`, and
+    //   a variant of `ysfx_compile_specialize` is preferred to it when there is one
+    ysfx_compile_frame_loop = 1 << 5,
 } ysfx_compile_option_t;
 
 // compile the previously loaded source
 YSFX_API bool ysfx_compile(ysfx_t *fx, uint32_t compileopts);
+// get the count of the variants of @sample which `ysfx_compile_specialize` compiled so far
+YSFX_API uint32_t ysfx_get_specialized_count(ysfx_t *fx);
 // check whether the effect is compiled
 YSFX_API bool ysfx_is_compiled(ysfx_t *fx);
 
+typedef enum ysfx_capability_e {
+    // the code receives MIDI, by @midi or by `midirecv`
+    ysfx_capability_midi_in = 1 << 0,
+    // the code sends MIDI
+    ysfx_capability_midi_out = 1 << 1,
+    // the code reads the transport, as `tempo`, `play_position` or `beat_position`;
+    //   the playback state must be set regardless, since starting the playback runs @init
+    ysfx_capability_transport = 1 << 2,
+    // the code changes the values of sliders, or automates them
+    ysfx_capability_slider_output = 1 << 3,
+    // the code sets its latency
+    ysfx_capability_latency = 1 << 4,
+} ysfx_capability_t;
+
+// get what the compiled code can observe of the host, or report to it, as flags of `ysfx_capability_t`;
+//   the host can skip the work for the others, which makes no difference to the effect;
+//   the analysis is by the names which the code refers to, so it may report more than it uses;
+//   the code which calls `eval` is reported with all the flags
+YSFX_API uint32_t ysfx_get_capabilities(ysfx_t *fx);
+// create a copy of the effect, with its source, settings and VM state; the copy does not need @init if the original had it
+YSFX_API ysfx_t *ysfx_clone(ysfx_t *fx);
+// continue from the VM state of another instance, whose @init has run, instead of running @init; not realtime-safe
+YSFX_API bool ysfx_adopt_state(ysfx_t *fx, ysfx_t *from);
+
 // get the block size
 YSFX_API uint32_t ysfx_get_block_size(ysfx_t *fx);
 // get the sample rate
 YSFX_API ysfx_real ysfx_get_sample_rate(ysfx_t *fx);
-// update the block size; don't forget to call @init
+// update the block size, which longer cycles are split to; don't forget to call @init
 YSFX_API void ysfx_set_block_size(ysfx_t *fx, uint32_t blocksize);
 // update the sample rate; don't forget to call @init
 YSFX_API void ysfx_set_sample_rate(ysfx_t *fx, ysfx_real samplerate);
 
 // set the capacity of the MIDI buffer
 YSFX_API void ysfx_set_midi_capacity(ysfx_t *fx, uint32_t capacity, bool extensible);
+// set the capacity of a separate pool for the payload of large SysEx events, or 0 to keep them in the MIDI buffer
+//   with a buffer which is not extensible, processing does not allocate memory for MIDI then,
+//   and the events which do not fit are dropped
+YSFX_API void ysfx_set_midi_sysex_capacity(ysfx_t *fx, uint32_t capacity);
+// keep the MIDI output sorted by offset, events at the same offset staying in the order they were sent
+YSFX_API void ysfx_set_midi_output_sorted(ysfx_t *fx, bool sorted);
+// remove the MIDI output values of controllers, pitch bend, and aftertouch which repeat the previous in the cycle, per channel
+//   with a nonzero interval, keep also the values of each at least this number of frames apart, except the last of the cycle
+YSFX_API void ysfx_set_midi_output_deduplicated(ysfx_t *fx, bool deduplicated, uint32_t min_interval);
+// set the number of events which other threads can post ahead of the next cycle, or 0 to disable posting
+//   this discards the events which are posted already; do not call it while other threads post or process
+YSFX_API void ysfx_set_midi_queue_capacity(ysfx_t *fx, uint32_t capacity);
+// get the number of MIDI events which were dropped for lack of capacity, since the effect was created
+YSFX_API uint64_t ysfx_get_midi_overflow(ysfx_t *fx);
+
+typedef enum ysfx_denormal_mode_e {
+    // add a small offset to the input samples, unless `ext_nodenorm` is set
+    ysfx_denormal_add_offset,
+    // set flush-to-zero and denormals-are-zero on the CPU during processing,
+    //   or add the offset like the other mode where the CPU cannot
+    ysfx_denormal_flush_to_zero,
+} ysfx_denormal_mode_t;
+
+// set the way denormal numbers are avoided during processing
+YSFX_API void ysfx_set_denormal_mode(ysfx_t *fx, uint32_t mode);
+
+// stop processing after `num_blocks` cycles where inputs and outputs stay within `threshold`, and no events arrive; 0 disables
+YSFX_API void ysfx_set_silence_skip(ysfx_t *fx, uint32_t num_blocks, ysfx_real threshold);
+// get whether processing is currently skipped because of silence
+YSFX_API bool ysfx_is_sleeping(ysfx_t *fx);
+// run @sample at a multiple of the sample rate (1, 2, 4 or 8); it adds latency to `ysfx_get_pdc_delay`
+YSFX_API void ysfx_set_oversampling(ysfx_t *fx, uint32_t factor);
+// get the factor of oversampling
+YSFX_API uint32_t ysfx_get_oversampling(ysfx_t *fx);
+// split cycles at the offsets of MIDI and slider events, in sub-blocks of at least `min_frames`; 0 disables splitting
+YSFX_API void ysfx_set_sample_accurate(ysfx_t *fx, uint32_t min_frames);
+// stream the audio files which the effect opens next, decoding `seconds` ahead on a thread per file; 0 reads them directly
+//   the code copies from memory, and it waits for the decoding only if it reads faster
+YSFX_API void ysfx_set_audio_file_read_ahead(ysfx_t *fx, ysfx_real seconds);
+// resample the audio files which the effect opens next to its sample rate, and report this rate in `file_riff`
+YSFX_API void ysfx_set_audio_file_resampling(ysfx_t *fx, bool enable);
 
 // activate and invoke @init
 YSFX_API void ysfx_init(ysfx_t *fx);
+// run @init on a thread of the effect when the processing finds it due, rather than on the audio thread; disabled by default
+//   meanwhile the processing passes the audio through, and keeps the MIDI and the sliders for the first cycle after it
+//   the functions which change the settings or the state wait for it to finish
+// NOTE: call this neither concurrently with processing nor with @init
+YSFX_API void ysfx_set_background_init(ysfx_t *fx, bool enable);
+// get whether @init is running in the background
+YSFX_API bool ysfx_is_initializing(ysfx_t *fx);
 
 // get the output latency
 YSFX_API ysfx_real ysfx_get_pdc_delay(ysfx_t *fx);
@@ -284,6 +642,13 @@ YSFX_API ysfx_real ysfx_get_pdc_delay(ysfx_t *fx);
 YSFX_API void ysfx_get_pdc_channels(ysfx_t *fx, uint32_t channels[2]);
 // get whether the output latency applies to MIDI as well
 YSFX_API bool ysfx_get_pdc_midi(ysfx_t *fx);
+// delay the outputs outside of the range of `ysfx_get_pdc_channels` by `ysfx_get_pdc_delay`, so the host can
+//   compensate all of them with the same latency; disabled by default, and idle while the range is empty
+YSFX_API void ysfx_set_pdc_compensation(ysfx_t *fx, bool enable);
+// reserve the delay lines of the compensation for the given channel count and delay, at the next @init
+//   they are sized at least for the outputs of the effect and the delay which @init sets, and never while processing,
+//   so a delay which grows beyond is shortened to the capacity, and the channels beyond it are not delayed
+YSFX_API void ysfx_set_pdc_capacity(ysfx_t *fx, uint32_t num_channels, uint32_t num_frames);
 
 typedef enum ysfx_playback_state_e {
     ysfx_playback_error = 0,
@@ -304,11 +669,34 @@ typedef struct ysfx_time_info_s {
     ysfx_real beat_position;
     // time signature in fraction form
     uint32_t time_signature[2];
+    // whether the host renders faster than real time, as when it bounces
+    bool offline;
 } ysfx_time_info_t;
 
 // update time information; do this before processing the cycle
+//   the variables are only written when they differ, so it is cheap to call
+//   this on every cycle with an unchanged time information
 YSFX_API void ysfx_set_time_info(ysfx_t *fx, const ysfx_time_info_t *info);
 
+typedef struct ysfx_transport_s {
+    // the time information which was last set
+    ysfx_time_info_t info;
+    // length of a beat in samples, at the sample rate, or 0 without tempo
+    ysfx_real samples_per_beat;
+    // length of a bar in beats, or 0 without time signature
+    ysfx_real beats_per_bar;
+    // position in bars, from zero
+    ysfx_real bar_position;
+} ysfx_transport_t;
+
+// get the transport, as of the last time information, and its derived values
+YSFX_API void ysfx_get_transport(ysfx_t *fx, ysfx_transport_t *transport);
+// get whether the last time information was for an offline render
+//   while offline, @init and `file_open_async` finish before the audio goes on,
+//   and the cycles do not count for the deadline statistics
+// NOTE: this can be called from any thread, a UI may skip its frames
+YSFX_API bool ysfx_is_offline(ysfx_t *fx);
+
 typedef struct ysfx_midi_event_s {
     // the bus number
     uint32_t bus;
@@ -322,13 +710,44 @@ typedef struct ysfx_midi_event_s {
 
 // send MIDI, it will be processed during the cycle
 YSFX_API bool ysfx_send_midi(ysfx_t *fx, const ysfx_midi_event_t *event);
+// post MIDI from any thread, without locking, it will be processed during the next cycle
+//   the message is up to 16 bytes, and the offset counts from the start of the cycle
+YSFX_API bool ysfx_post_midi(ysfx_t *fx, const ysfx_midi_event_t *event);
 // receive MIDI, after having processed the cycle
 YSFX_API bool ysfx_receive_midi(ysfx_t *fx, ysfx_midi_event_t *event);
 // receive MIDI from a single bus (do not mix with API above, use either)
 YSFX_API bool ysfx_receive_midi_from_bus(ysfx_t *fx, uint32_t bus, ysfx_midi_event_t *event);
+// send several MIDI events in order, and return how many were accepted
+YSFX_API uint32_t ysfx_send_midi_batch(ysfx_t *fx, const ysfx_midi_event_t *events, uint32_t count);
+// receive up to `max` MIDI events at once, and return how many were received
+//   the event data points into the output buffer, valid until the next cycle
+YSFX_API uint32_t ysfx_receive_midi_batch(ysfx_t *fx, ysfx_midi_event_t *events, uint32_t max);
+
+typedef struct ysfx_ump_event_s {
+    // the bus number
+    uint32_t bus;
+    // the frame when it happens within the cycle
+    uint32_t offset;
+    // the number of 32-bit words of the packet
+    uint32_t size;
+    // the words of the packet
+    uint32_t data[4];
+} ysfx_ump_event_t;
+
+// get the number of 32-bit words of a MIDI 2.0 universal packet, from its first word
+YSFX_API uint32_t ysfx_ump_sizeof(uint32_t word);
+// send a MIDI 2.0 universal packet, it will be processed during the cycle
+//   scripts which receive MIDI 1.0 get a translation, if there is one
+YSFX_API bool ysfx_send_ump(ysfx_t *fx, const ysfx_ump_event_t *event);
+// receive MIDI as universal packets, after having processed the cycle (do not mix with `ysfx_receive_midi`)
+//   MIDI 1.0 output is translated, SysEx forming a sequence of 7-bit SysEx packets
+YSFX_API bool ysfx_receive_ump(ysfx_t *fx, ysfx_ump_event_t *event);
 
 // send a trigger, it will be processed during the cycle
 YSFX_API bool ysfx_send_trigger(ysfx_t *fx, uint32_t index);
+// send a trigger at a frame offset within the next cycle
+//   when the processing is sample-accurate, the cycle is split there, otherwise it fires at the start
+YSFX_API bool ysfx_send_trigger_at(ysfx_t *fx, uint32_t index, uint32_t offset);
 
 // determine which group a particular slider is part of
 YSFX_API uint8_t ysfx_fetch_slider_group_index(uint32_t slider_number);
@@ -339,17 +758,52 @@ YSFX_API uint64_t ysfx_slider_mask(uint32_t slider_number, uint8_t group_index);
 YSFX_API uint64_t ysfx_fetch_slider_changes(ysfx_t *fx, uint8_t slider_group_index);
 // get a bit mask of sliders whose values must be automated, and clear it to zero
 YSFX_API uint64_t ysfx_fetch_slider_automations(ysfx_t *fx, uint8_t slider_group_index);
+
+typedef struct ysfx_slider_automation_s {
+    // the slider number
+    uint32_t index;
+    // the frame within the cycle when the effect automated it, or 0 outside of processing
+    uint32_t offset;
+    // the value of the slider at that moment
+    ysfx_real value;
+} ysfx_slider_automation_t;
+
+// set the number of timed automations which are recorded, or 0 to disable recording
+//   this discards the automations which are recorded already; do not call it while processing
+YSFX_API void ysfx_set_slider_automation_capacity(ysfx_t *fx, uint32_t capacity);
+// receive the next automation recorded by `slider_automate`, in order, without locking
+//   the automations past the capacity are dropped, but the masks of `ysfx_fetch_slider_automations` still have them
+YSFX_API bool ysfx_receive_slider_automation(ysfx_t *fx, ysfx_slider_automation_t *automation);
+// get a bit mask of sliders whose values differ from the last time this was called, by any means; call it on the processing thread
+YSFX_API uint64_t ysfx_fetch_slider_value_changes(ysfx_t *fx, uint8_t slider_group_index);
 // get a bit mask of sliders whose values are currently being touched
 YSFX_API uint64_t ysfx_fetch_slider_touches(ysfx_t *fx, uint8_t slider_group_index);
 // get a bit mask of sliders currently visible
 YSFX_API uint64_t ysfx_get_slider_visibility(ysfx_t *fx, uint8_t slider_group_index);
+// get a bit mask of sliders whose visibility changed since the last call, and clear it to zero
+YSFX_API uint64_t ysfx_fetch_slider_visibility_changes(ysfx_t *fx, uint8_t slider_group_index);
+// a function called when the effect changes the visibility of sliders
+//   it is called from the thread of the code, which may be the audio thread: it must not block
+typedef void (ysfx_slider_visibility_callback_t)(void *userdata);
+// set the function called after visibility changes, or null; do not call it while processing
+YSFX_API void ysfx_set_slider_visibility_callback(ysfx_t *fx, ysfx_slider_visibility_callback_t *callback, void *userdata);
 // determine whether the plugin wants a manual undo point made and clear it to false
 YSFX_API bool ysfx_fetch_want_undopoint(ysfx_t *fx);
 
 // process a cycle in 32-bit float
+//   a null input channel is read as silence, and a null output channel is
+//   not written, so that the host can pass the channels of its buses as is
 YSFX_API void ysfx_process_float(ysfx_t *fx, const float *const *ins, float *const *outs, uint32_t num_ins, uint32_t num_outs, uint32_t num_frames);
 // process a cycle in 64-bit float
 YSFX_API void ysfx_process_double(ysfx_t *fx, const double *const *ins, double *const *outs, uint32_t num_ins, uint32_t num_outs, uint32_t num_frames);
+// process a cycle in 32-bit float, with interleaved channels
+YSFX_API void ysfx_process_interleaved_float(ysfx_t *fx, const float *in, float *out, uint32_t num_channels, uint32_t num_frames);
+// process a cycle in 64-bit float, with interleaved channels
+YSFX_API void ysfx_process_interleaved_double(ysfx_t *fx, const double *in, double *out, uint32_t num_channels, uint32_t num_frames);
+// process a cycle in 32-bit float, with interleaved channels, replacing the input with the output
+YSFX_API void ysfx_process_interleaved_float_in_place(ysfx_t *fx, float *buffer, uint32_t num_channels, uint32_t num_frames);
+// process a cycle in 64-bit float, with interleaved channels, replacing the input with the output
+YSFX_API void ysfx_process_interleaved_double_in_place(ysfx_t *fx, double *buffer, uint32_t num_channels, uint32_t num_frames);
 
 typedef struct ysfx_state_slider_s {
     // index of the slider
@@ -367,6 +821,10 @@ typedef struct ysfx_state_s {
     uint8_t *data;
     // size of serialized data
     size_t data_size;
+    // highest memory slot in use when saved, rounded to a block; 0 if unknown
+    uint32_t mem_high_water;
+    // the hash, cached by `ysfx_state_hash`; 0 if not computed yet, reset it to 0 after modifying the state
+    uint64_t hash;
 } ysfx_state_t;
 
 // load state
@@ -378,9 +836,43 @@ YSFX_API void ysfx_state_free(ysfx_state_t *state);
 // duplicate a state object
 YSFX_API ysfx_state_t *ysfx_state_dup(ysfx_state_t *state);
 // compare two state objects; returns true if they are the same
+//   the states which have their hashes cached are told apart by them first
 YSFX_API bool ysfx_is_state_equal(ysfx_state_t *state1, ysfx_state_t *state2);
+// get a hash of the sliders and the serialized data of a state, which it caches; it is never 0
+//   equal states have equal hashes, within a process; it is not meant to be stored
+YSFX_API uint64_t ysfx_state_hash(ysfx_state_t *state);
+// load only the sliders of a state, and call @slider later; the serialized data is ignored and @serialize is not invoked
+//   it does not allocate or lock, so a host can recall slider-only presets from the audio thread between cycles
+YSFX_API bool ysfx_load_slider_state(ysfx_t *fx, ysfx_state_t *state);
 // load only serialized state
 YSFX_API bool ysfx_load_serialized_state(ysfx_t *fx, ysfx_state_t *state);
+// set the sliders somewhere between two states, with `t` from 0 at `a` to 1 at `b`, and call @slider later
+//   continuous sliders move along their curves, gliding if they have smoothing; enumerations switch at the middle
+//   only sliders are changed, never the serialized data, and it does not allocate; call it in the audio thread
+YSFX_API void ysfx_morph_states(ysfx_t *fx, ysfx_state_t *a, ysfx_state_t *b, ysfx_real t);
+
+typedef struct ysfx_serial_buffer_s ysfx_serial_buffer_t;
+
+// a buffer of the host which receives serialized data
+struct ysfx_serial_buffer_s {
+    // the memory, and the bytes written to it so far
+    uint8_t *data;
+    size_t size;
+    size_t capacity;
+    // make the capacity at least `capacity`, updating `data` and `capacity`; returns false on failure
+    bool (*grow)(ysfx_serial_buffer_t *buffer, size_t capacity);
+    // data for the host
+    intptr_t userdata;
+};
+
+// serialize the state of the code, appending to the buffer directly; returns false if any of it did not fit
+YSFX_API bool ysfx_save_serialized_state_to(ysfx_t *fx, ysfx_serial_buffer_t *buffer);
+// load only serialized state, reading from the memory directly
+YSFX_API bool ysfx_load_serialized_state_from(ysfx_t *fx, const uint8_t *data, size_t size);
+// serialize the values as 64-bit doubles, which is exact but not compatible with Reaper; the default is 32-bit floats
+YSFX_API void ysfx_set_lossless_serialization(ysfx_t *fx, bool enable);
+// get whether the values are serialized as 64-bit doubles
+YSFX_API bool ysfx_get_lossless_serialization(ysfx_t *fx);
 
 typedef struct ysfx_preset_s {
     // name of the preset
@@ -391,6 +883,8 @@ typedef struct ysfx_preset_s {
     ysfx_state_t *state;
 } ysfx_preset_t;
 
+typedef struct ysfx_bank_index_s ysfx_bank_index_t;
+
 typedef struct ysfx_bank_s {
     // name of the bank
     char *name;
@@ -398,22 +892,36 @@ typedef struct ysfx_bank_s {
     ysfx_preset_t *presets;
     // number of programs
     uint32_t preset_count;
+    // the presets, which the banks made from this one share (internal)
+    ysfx_bank_index_t *index;
 } ysfx_bank_t;
 
 // get the path of the RPL preset bank of the loaded JSFX, if present
 YSFX_API const char *ysfx_get_bank_path(ysfx_t *fx);
 // read a preset bank from RPL file
 YSFX_API ysfx_bank_t *ysfx_load_bank(const char *path);
-// write a preset bank to RPL file
+// read only the names in a RPL file, leaving `blob_name` and `state` null until `ysfx_bank_get_preset` decodes them
+//   `index_path`, if not null, is a file which keeps the names for the next time, while the bank is unchanged
+YSFX_API ysfx_bank_t *ysfx_load_bank_index(const char *path, const char *index_path);
+// get a preset of the bank, decoding it first if needed; returns null if it cannot be decoded
+YSFX_API ysfx_preset_t *ysfx_bank_get_preset(ysfx_bank_t *bank, uint32_t index);
+// write a preset bank to RPL file, replacing it once the new one is complete
 YSFX_API bool ysfx_save_bank(const char *path, ysfx_bank_t *bank);
+// write a preset bank to a binary file, which keeps the values exactly and loads faster than RPL
+//   `ysfx_load_bank` and `ysfx_load_bank_index` recognize this format by its header
+YSFX_API bool ysfx_save_bank_binary(const char *path, ysfx_bank_t *bank);
 // free a preset bank
 YSFX_API void ysfx_bank_free(ysfx_bank_t *bank);
 // create empty preset bank
 YSFX_API ysfx_bank_t *ysfx_create_empty_bank(const char* bank_name);
+// the functions which make a new bank from another share the presets which they have in common; do not modify these in place
 // add a preset to the current bank and returns a *new* bank without freeing the old bank
 YSFX_API ysfx_bank_t *ysfx_add_preset_to_bank(ysfx_bank_t *bank_in, const char* preset_name, ysfx_state_t *state);
 // returns > 0 if preset exists in bank. Preset index is given by return value - 1
 YSFX_API uint32_t ysfx_preset_exists(ysfx_bank_t *bank_in, const char* preset_name);
+// find the first preset whose state is equal to this one; returns its index plus 1, or 0 if there is none
+//   the presets cache their hashes, so the next searches compare a number for each preset
+YSFX_API uint32_t ysfx_bank_find_state(ysfx_bank_t *bank, ysfx_state_t *state);
 // deletes a preset from the bank and returns a *new* bank without freeing the old bank
 YSFX_API ysfx_bank_t *ysfx_delete_preset_from_bank(ysfx_bank_t *bank_in, const char* preset_name);
 // renames a preset from the bank and returns a *new* bank without freeing the old bank
@@ -434,6 +942,84 @@ YSFX_API ysfx_real ysfx_read_vmem_single(ysfx_t *fx, uint32_t addr);
 // read how many memory slots are in use
 YSFX_API int ysfx_calculate_used_mem(ysfx_t *fx);
 
+typedef struct ysfx_vmem_span_s {
+    // contiguous memory of the VM, or NULL if this part is not allocated
+    const ysfx_real *data;
+    // address of the first slot
+    uint32_t addr;
+    // number of slots
+    uint32_t count;
+} ysfx_vmem_span_t;
+
+// get direct views on a range of VM memory, split at block boundaries; returns the number of spans which cover it
+// the spans remain valid until the code is unloaded or the memory relocated, and their contents change with processing
+YSFX_API uint32_t ysfx_get_vmem_spans(ysfx_t *fx, uint32_t addr, uint32_t count, ysfx_vmem_span_t *spans, uint32_t max_spans);
+// set a range of VM memory to copy after each processing cycle; a count of 0 disables it
+// NOTE: call this neither concurrently with processing nor with `ysfx_get_vmem_snapshot`
+YSFX_API void ysfx_set_vmem_snapshot(ysfx_t *fx, uint32_t addr, uint32_t count);
+// get the latest copy of the snapshot range; it remains valid until the next call, from a single reader thread
+YSFX_API const ysfx_real *ysfx_get_vmem_snapshot(ysfx_t *fx, uint32_t *count);
+
+typedef struct ysfx_watch_range_s {
+    // address of the first slot
+    uint32_t addr;
+    // number of slots
+    uint32_t count;
+} ysfx_watch_range_t;
+
+// watch some variables and ranges of VM memory, whose values are copied after each processing cycle;
+//   this replaces the earlier watch, and an empty one stops copying. It is safe to call during processing,
+//   but neither concurrently with loading or compiling, nor with `ysfx_get_watch`, from a single reader thread
+// returns false if a variable does not exist, which reads as 0, or if there are too many values to watch
+YSFX_API bool ysfx_set_watch(ysfx_t *fx, const char *const *names, uint32_t num_names, const ysfx_watch_range_t *ranges, uint32_t num_ranges);
+// get the latest values of the watch: the variables in order, followed by the ranges; NULL until the first cycle
+//   after the watch was set. The values remain valid until the next call, and the variables read as 0 after the code is unloaded
+YSFX_API const ysfx_real *ysfx_get_watch(ysfx_t *fx, uint32_t *count);
+
+typedef struct ysfx_memory_stats_s {
+    // number of allocated blocks of VM memory
+    uint32_t ram_blocks;
+    // size of the allocated VM memory, in bytes
+    uint64_t ram_bytes;
+    // highest memory slot in use, rounded to a block
+    uint32_t ram_high_water;
+    // number of memory slots which the effect can address
+    uint32_t ram_limit;
+    // number of strings in the pool
+    uint32_t num_strings;
+    // total length of the strings in the pool, in bytes
+    uint64_t string_bytes;
+    // number of images which hold a bitmap
+    uint32_t num_images;
+    // size of the image bitmaps, in bytes
+    uint64_t image_bytes;
+} ysfx_memory_stats_t;
+
+// get the memory usage of the effect; it costs a walk of the allocated blocks and objects
+// NOTE: do not call this from the @gfx thread while it runs @gfx
+YSFX_API void ysfx_get_memory_stats(ysfx_t *fx, ysfx_memory_stats_t *stats);
+
+typedef enum ysfx_prefault_policy_e {
+    // do not pre-fault the memory
+    ysfx_prefault_none,
+    // pre-fault the memory up to the high-water mark, from this session or a loaded state
+    ysfx_prefault_high_water,
+    // pre-fault the whole memory allowed by `options:maxmem`
+    ysfx_prefault_maxmem,
+} ysfx_prefault_policy_t;
+
+// allocate and touch the VM memory ahead of processing, so that @sample does not allocate
+// NOTE: call this from a non-realtime thread, not concurrently with processing
+YSFX_API void ysfx_prefault_memory(ysfx_t *fx, ysfx_prefault_policy_t policy);
+// set a policy to pre-fault the memory automatically after @init, and after loading a state
+YSFX_API void ysfx_set_auto_prefault(ysfx_t *fx, ysfx_prefault_policy_t policy);
+// get the highest memory slot in use, rounded to a block, or recorded by a loaded state
+YSFX_API uint32_t ysfx_get_memory_high_water(ysfx_t *fx);
+// allocate again the VM memory and the processing buffers from the calling thread, and copy them
+//   under a first-touch NUMA policy, it places them on the node of this thread: call it from a thread
+//   bound to the node which will process the effect, not concurrently with processing
+YSFX_API void ysfx_relocate_memory(ysfx_t *fx);
+
 //------------------------------------------------------------------------------
 // YSFX graphics
 
@@ -467,12 +1053,20 @@ typedef struct ysfx_gfx_config_s {
 YSFX_API void ysfx_gfx_setup(ysfx_t *fx, ysfx_gfx_config_t *gc);
 // get whether the current effect is requesting Retina support
 YSFX_API bool ysfx_gfx_wants_retina(ysfx_t *fx);
-// push a key to the input queue
+// push a key to the input queue, which the next @gfx receives
+//   the input functions do not wait for @gfx, but they must be called from a single thread
 YSFX_API void ysfx_gfx_add_key(ysfx_t *fx, uint32_t mods, uint32_t key, bool press);
 // update mouse information; position is relative to canvas; wheel should be in steps normalized to ±1.0
+//   the moves between two runs of @gfx merge into the last, and their wheel steps add up
 YSFX_API void ysfx_gfx_update_mouse(ysfx_t *fx, uint32_t mods, int32_t xpos, int32_t ypos, uint32_t buttons, ysfx_real wheel, ysfx_real hwheel);
 // invoke @gfx to paint the graphics; returns whether the framer buffer is modified
 YSFX_API bool ysfx_gfx_run(ysfx_t *fx);
+// get the region of the frame which the last @gfx has drawn on, as x, y, width and height in pixels
+//   returns false if it has drawn nothing; hosts can copy and repaint only this region
+YSFX_API bool ysfx_gfx_get_dirty_rect(ysfx_t *fx, uint32_t rect[4]);
+// run frames of @gfx without a window, into a buffer of (4*width*height) bytes, cleared first
+//   returns the number of frames which have run, 0 if the effect has no @gfx or it's not initialized
+YSFX_API uint32_t ysfx_gfx_render_offscreen(ysfx_t *fx, uint32_t width, uint32_t height, uint32_t frames, uint8_t *pixels);
 // request desired frame rate for UI refresh
 YSFX_API uint32_t ysfx_get_requested_framerate(ysfx_t *fx);
 
@@ -595,6 +1189,240 @@ typedef struct ysfx_audio_format_s {
     uint64_t (*read)(ysfx_audio_reader_t *reader, ysfx_real *samples, uint64_t count);
 } ysfx_audio_format_t;
 
+//------------------------------------------------------------------------------
+// YSFX header scan
+
+typedef struct ysfx_scan_s ysfx_scan_t;
+
+// read the metadata of a file from its header only, without preprocessing or imports; NULL on failure
+// the pins are those declared, without the stereo default of effects which have @sample
+YSFX_API ysfx_scan_t *ysfx_scan_header(ysfx_config_t *config, const char *filepath);
+// scan many files using a number of threads, including the calling thread; failed results are NULL
+YSFX_API void ysfx_scan_headers(ysfx_config_t *config, const char *const *filepaths, uint32_t count, ysfx_scan_t **results, uint32_t num_threads);
+// delete the result of a scan
+YSFX_API void ysfx_scan_free(ysfx_scan_t *scan);
+// get the name of the effect
+YSFX_API const char *ysfx_scan_get_name(ysfx_scan_t *scan);
+// get the author of the effect
+YSFX_API const char *ysfx_scan_get_author(ysfx_scan_t *scan);
+// get the list of tags of the effect
+YSFX_API uint32_t ysfx_scan_get_tags(ysfx_scan_t *scan, const char **dest, uint32_t destsize);
+// get the number of inputs
+YSFX_API uint32_t ysfx_scan_get_num_inputs(ysfx_scan_t *scan);
+// get the number of outputs
+YSFX_API uint32_t ysfx_scan_get_num_outputs(ysfx_scan_t *scan);
+// get the name of the input
+YSFX_API const char *ysfx_scan_get_input_name(ysfx_scan_t *scan, uint32_t index);
+// get the name of the output
+YSFX_API const char *ysfx_scan_get_output_name(ysfx_scan_t *scan, uint32_t index);
+// determine if slider exists
+YSFX_API bool ysfx_scan_slider_exists(ysfx_scan_t *scan, uint32_t index);
+// get the name of a slider
+YSFX_API const char *ysfx_scan_slider_get_name(ysfx_scan_t *scan, uint32_t index);
+// get the curve of a slider
+YSFX_API bool ysfx_scan_slider_get_curve(ysfx_scan_t *scan, uint32_t index, ysfx_slider_curve_t *curve);
+
+//------------------------------------------------------------------------------
+// YSFX packages
+
+// A package `*.ysfxpkg` holds an effect with its imports and its data in a single file.
+// It loads and scans by its path, as the effect itself would, and its entries are
+// accessible as files below this path, as in `fx.ysfxpkg/data/a.wav`.
+
+// pack the files of a directory into a package, whose effect is the given main file,
+// relative to the directory; the files are deflated if requested and if it makes them smaller
+YSFX_API bool ysfx_package_create(const char *package_path, const char *directory, const char *main_file, bool compress);
+
+//------------------------------------------------------------------------------
+// YSFX chain
+
+typedef struct ysfx_chain_s ysfx_chain_t;
+
+// create a new empty chain of effects, processed in series
+YSFX_API ysfx_chain_t *ysfx_chain_new();
+// delete a chain
+YSFX_API void ysfx_chain_free(ysfx_chain_t *chain);
+// increase the reference counter
+YSFX_API void ysfx_chain_add_ref(ysfx_chain_t *chain);
+// append an effect to the end of the chain, taking a reference to it
+YSFX_API void ysfx_chain_append(ysfx_chain_t *chain, ysfx_t *fx);
+// append a stage where each branch processes a copy of the signal in parallel, and the outputs are summed
+// an empty branch passes the signal through; the chain takes a reference to each branch
+YSFX_API void ysfx_chain_append_parallel(ysfx_chain_t *chain, ysfx_chain_t *const *branches, uint32_t num_branches);
+// append a stage of `num_lanes` copies of an effect, each on its own group of channels, as many as the pins of the effect
+//   the copies are clones of `fx` made now; before every cycle they take its sliders, and they all receive the same MIDI
+//   the lanes run in parallel on the threads of the chain, and only `fx` sends out MIDI; the chain takes a reference to it
+YSFX_API void ysfx_chain_append_ganged(ysfx_chain_t *chain, ysfx_t *fx, uint32_t num_lanes);
+// append a stage of `num_voices` copies of an effect, where each note-on goes to a voice which receives its note-off
+//   a note takes a free voice, or steals the earliest released, or else the earliest held; the other events go to all
+//   the voices start from silence, and those which run are summed into the signal, in parallel on the threads of the chain
+//   a voice runs while it holds a note, or until it is silent after, or if it receives events; it follows the sliders of `fx`
+//   the copies are clones of `fx` made now; the chain takes a reference to it
+YSFX_API void ysfx_chain_append_voices(ysfx_chain_t *chain, ysfx_t *fx, uint32_t num_voices);
+// get the number of voices which sound at the given position of the chain, or 0 if it's not a stage of voices
+YSFX_API uint32_t ysfx_chain_get_active_voices(ysfx_chain_t *chain, uint32_t index);
+// get the number of stages in the chain
+YSFX_API uint32_t ysfx_chain_get_size(ysfx_chain_t *chain);
+// get the effect at the given position of the chain, the first lane of a ganged stage, or NULL if it's a parallel stage
+YSFX_API ysfx_t *ysfx_chain_get_effect(ysfx_chain_t *chain, uint32_t index);
+// allocate the internal buffer for the given channel count and block size, to avoid doing it while processing
+YSFX_API void ysfx_chain_set_capacity(ysfx_chain_t *chain, uint32_t num_channels, uint32_t num_frames);
+// set the number of threads which process parallel branches, including the calling thread; 1 is single-threaded
+YSFX_API void ysfx_chain_set_num_threads(ysfx_chain_t *chain, uint32_t num_threads);
+// a function of the host which runs `num_tasks` tasks on its threads, calling `ysfx_chain_execute_task` for each index,
+//   and returns once they are all done, like the thread pool of CLAP; if it returns false, the chain runs them itself
+typedef bool (ysfx_chain_executor_t)(void *userdata, uint32_t num_tasks);
+// run the parallel branches, lanes and voices on the threads of the host, instead of those of the chain; NULL to stop
+YSFX_API void ysfx_chain_set_executor(ysfx_chain_t *chain, ysfx_chain_executor_t *executor, void *userdata);
+// run one of the tasks which the executor was given, from a thread of the host
+YSFX_API void ysfx_chain_execute_task(ysfx_chain_t *chain, uint32_t index);
+// run the stages in `num_groups` groups of consecutive stages, each on its own thread, handing the blocks down
+//   group `i` takes `group_sizes[i]` stages, or an even share if NULL, and the last group takes those which remain
+//   the blocks have the size of the capacity, which is to set after, and the cycles of any size go through them in pieces
+//   the output comes a block per group late, as `ysfx_chain_get_pdc_delay` reports, and is silent until then; 1 turns it off
+//   a change of the capacity restarts from silence, and the channels beyond it are silent
+//   the parallel stages then run on the thread of their group
+YSFX_API void ysfx_chain_set_pipeline(ysfx_chain_t *chain, uint32_t num_groups, const uint32_t *group_sizes);
+// get the delay which the pipeline adds, in frames, which is fixed by the capacity
+YSFX_API ysfx_real ysfx_chain_get_pdc_delay(ysfx_chain_t *chain);
+// send MIDI into the chain, for the next cycle
+YSFX_API bool ysfx_chain_send_midi(ysfx_chain_t *chain, const ysfx_midi_event_t *event);
+// receive the MIDI output of the chain, after a cycle
+YSFX_API bool ysfx_chain_receive_midi(ysfx_chain_t *chain, ysfx_midi_event_t *event);
+// process a cycle through all effects in 32-bit float; samples are converted only on entry and exit
+YSFX_API void ysfx_chain_process_float(ysfx_chain_t *chain, const float *const *ins, float *const *outs, uint32_t num_ins, uint32_t num_outs, uint32_t num_frames);
+// process a cycle through all effects in 64-bit float
+YSFX_API void ysfx_chain_process_double(ysfx_chain_t *chain, const double *const *ins, double *const *outs, uint32_t num_ins, uint32_t num_outs, uint32_t num_frames);
+
+//------------------------------------------------------------------------------
+// YSFX batch processing
+
+typedef struct ysfx_process_pool_s ysfx_process_pool_t;
+
+// a cycle of an effect, as `ysfx_process_float` takes it
+typedef struct ysfx_process_job_s {
+    ysfx_t *fx;
+    const float *const *ins;
+    float *const *outs;
+    uint32_t num_ins;
+    uint32_t num_outs;
+} ysfx_process_job_t;
+
+// create the threads which process batches, including the calling thread; 1 is single-threaded
+YSFX_API ysfx_process_pool_t *ysfx_process_pool_new(uint32_t num_threads);
+// stop the threads and delete the pool
+YSFX_API void ysfx_process_pool_free(ysfx_process_pool_t *pool);
+// process a cycle of every job, and return when all are done; the pool may be NULL, to process them in order
+//   the effects must be distinct; each thread takes a range of the jobs, then helps with the others once it's done,
+//   so an effect which keeps its position between calls mostly stays on the same thread
+YSFX_API void ysfx_process_many(ysfx_process_pool_t *pool, const ysfx_process_job_t *jobs, uint32_t count, uint32_t num_frames);
+
+//------------------------------------------------------------------------------
+// YSFX snapshots
+
+typedef struct ysfx_snapshot_s ysfx_snapshot_t;
+
+// capture the VM: variables, memory and strings; unlike a state, it needs no @serialize
+// blocks of memory which are the same as in `base`, if not NULL, are shared with it
+// NOTE: call this neither concurrently with processing nor with @gfx
+YSFX_API ysfx_snapshot_t *ysfx_snapshot_take(ysfx_t *fx, ysfx_snapshot_t *base);
+// restore a snapshot into the VM, writing only the blocks of memory which differ
+YSFX_API bool ysfx_snapshot_restore(ysfx_t *fx, ysfx_snapshot_t *snap);
+// release a snapshot
+YSFX_API void ysfx_snapshot_free(ysfx_snapshot_t *snap);
+// get the size of the memory of a snapshot, not counting the blocks shared with `base` if not NULL
+YSFX_API size_t ysfx_snapshot_get_memory_size(ysfx_snapshot_t *snap, ysfx_snapshot_t *base);
+
+//------------------------------------------------------------------------------
+// YSFX hibernation
+
+typedef enum ysfx_hibernate_option_e {
+    // keep a copy of the VM instead of the state, for effects which @serialize does not restore;
+    //   the blocks of memory which are all zero are not kept
+    ysfx_hibernate_keep_vm = 1 << 0,
+} ysfx_hibernate_option_t;
+
+// release the code, the memory and the images of an effect which is idle, keeping what brings it back
+//   until it wakes or compiles again, it processes as if it was not compiled, passing the audio through
+// NOTE: call this neither concurrently with processing nor with @gfx
+YSFX_API bool ysfx_hibernate(ysfx_t *fx, uint32_t hibernateopts);
+// compile the effect again, run @init and restore it; if it fails to compile, it stays in hibernation
+YSFX_API bool ysfx_wake(ysfx_t *fx);
+// check whether the effect is in hibernation
+YSFX_API bool ysfx_is_hibernating(ysfx_t *fx);
+
+//------------------------------------------------------------------------------
+// YSFX hot swap
+
+typedef struct ysfx_swap_s ysfx_swap_t;
+
+typedef enum ysfx_swap_option_e {
+    // set the sliders of the new effect to the values of the old one
+    ysfx_swap_keep_sliders = 1 << 0,
+    // copy the memory of the old effect into the new one, at the time of the swap
+    ysfx_swap_keep_memory = 1 << 1,
+} ysfx_swap_option_t;
+
+// create a holder of the effect which the audio thread processes, taking a reference to it
+YSFX_API ysfx_swap_t *ysfx_swap_new(ysfx_t *fx);
+// delete a holder, and the effects it references
+YSFX_API void ysfx_swap_free(ysfx_swap_t *swap);
+// initialize a compiled effect off the audio thread, and make it replace the current one at the next acquire
+// the holder takes a reference; publish, reload and collect must be called from one non-realtime thread
+YSFX_API void ysfx_swap_publish(ysfx_swap_t *swap, ysfx_t *fx, uint32_t swapopts);
+// load and compile a new effect with the configuration of the current one, then publish it
+YSFX_API bool ysfx_swap_reload(ysfx_swap_t *swap, const char *filepath, uint32_t loadopts, uint32_t compileopts, uint32_t swapopts);
+// get the effect to process, installing the published one if any; call on the audio thread, at a block boundary
+YSFX_API ysfx_t *ysfx_swap_acquire(ysfx_swap_t *swap);
+// free the effect which was replaced by the last swap; realtime-unsafe
+YSFX_API void ysfx_swap_collect(ysfx_swap_t *swap);
+
+//------------------------------------------------------------------------------
+// YSFX sandbox
+
+typedef struct ysfx_sandbox_s ysfx_sandbox_t;
+
+// create the memory which the host shares with an effect in a child process, for up to `max_channels`
+//   in and out, of `max_frames` each; the child, such as `ysfx_tool --serve=NAME`, opens it by its name
+YSFX_API ysfx_sandbox_t *ysfx_sandbox_new(uint32_t max_channels, uint32_t max_frames);
+// delete the memory, which makes the child stop serving
+YSFX_API void ysfx_sandbox_free(ysfx_sandbox_t *sandbox);
+// get the name of the memory, for the child to open
+YSFX_API const char *ysfx_sandbox_get_name(ysfx_sandbox_t *sandbox);
+// wait for the child to serve, for at most the given time
+YSFX_API bool ysfx_sandbox_wait_connected(ysfx_sandbox_t *sandbox, uint32_t timeout_ms);
+// get the planes of audio which the child processes in place, where the host writes its inputs and reads its outputs
+YSFX_API ysfx_real *const *ysfx_sandbox_get_inputs(ysfx_sandbox_t *sandbox);
+YSFX_API ysfx_real *const *ysfx_sandbox_get_outputs(ysfx_sandbox_t *sandbox);
+// set the settings of the host, which the next cycle passes to the effect
+YSFX_API void ysfx_sandbox_set_sample_rate(ysfx_sandbox_t *sandbox, ysfx_real samplerate);
+YSFX_API void ysfx_sandbox_set_block_size(ysfx_sandbox_t *sandbox, uint32_t blocksize);
+YSFX_API void ysfx_sandbox_set_time_info(ysfx_sandbox_t *sandbox, const ysfx_time_info_t *info);
+// change a slider at the next cycle, or get its value as of the last one
+YSFX_API bool ysfx_sandbox_slider_set_value(ysfx_sandbox_t *sandbox, uint32_t index, ysfx_real value);
+YSFX_API ysfx_real ysfx_sandbox_slider_get_value(ysfx_sandbox_t *sandbox, uint32_t index);
+// send MIDI to the next cycle, or receive the MIDI of the last one
+YSFX_API bool ysfx_sandbox_send_midi(ysfx_sandbox_t *sandbox, const ysfx_midi_event_t *event);
+YSFX_API bool ysfx_sandbox_receive_midi(ysfx_sandbox_t *sandbox, ysfx_midi_event_t *event);
+// process a cycle in the child, and wait for it at most `timeout_us` microseconds; if it takes longer, the
+//   outputs are silent, and the cycles fail until the child is done with the late one
+// NOTE: call the functions of the host from the audio thread, except new, free and wait_connected
+YSFX_API bool ysfx_sandbox_process(ysfx_sandbox_t *sandbox, uint32_t num_ins, uint32_t num_outs, uint32_t num_frames, uint32_t timeout_us);
+// in the child, process the cycles of the host with the effect, until the host deletes the memory or exits;
+//   returns false if the memory of this name cannot be opened
+YSFX_API bool ysfx_sandbox_serve(ysfx_t *fx, const char *name);
+
+//------------------------------------------------------------------------------
+// YSFX base64
+
+// encode the data with padding, into a text of `ysfx_base64_encoded_size` characters; returns the count written
+YSFX_API size_t ysfx_base64_encode(const void *data, size_t size, char *text);
+// decode the text, which skips what is not base64 and stops at the padding, into data of
+//   `ysfx_base64_decoded_capacity` bytes; returns the count written
+YSFX_API size_t ysfx_base64_decode(const char *text, size_t length, void *data);
+YSFX_API size_t ysfx_base64_encoded_size(size_t size);
+YSFX_API size_t ysfx_base64_decoded_capacity(size_t length);
+
 //------------------------------------------------------------------------------
 
 #ifdef __cplusplus
@@ -618,6 +1446,12 @@ YSFX_DEFINE_AUTO_PTR(ysfx_u, ysfx_t, ysfx_free);
 YSFX_DEFINE_AUTO_PTR(ysfx_state_u, ysfx_state_t, ysfx_state_free);
 YSFX_DEFINE_AUTO_PTR(ysfx_bank_u, ysfx_bank_t, ysfx_bank_free);
 YSFX_DEFINE_AUTO_PTR(ysfx_menu_u, ysfx_menu_t, ysfx_menu_free);
+YSFX_DEFINE_AUTO_PTR(ysfx_scan_u, ysfx_scan_t, ysfx_scan_free);
+YSFX_DEFINE_AUTO_PTR(ysfx_chain_u, ysfx_chain_t, ysfx_chain_free);
+YSFX_DEFINE_AUTO_PTR(ysfx_process_pool_u, ysfx_process_pool_t, ysfx_process_pool_free);
+YSFX_DEFINE_AUTO_PTR(ysfx_snapshot_u, ysfx_snapshot_t, ysfx_snapshot_free);
+YSFX_DEFINE_AUTO_PTR(ysfx_swap_u, ysfx_swap_t, ysfx_swap_free);
+YSFX_DEFINE_AUTO_PTR(ysfx_sandbox_u, ysfx_sandbox_t, ysfx_sandbox_free);
 
 #define YSFX_DEFINE_SHARED_PTR(sptr, styp, freefn)               \
     struct sptr##_deleter {                                      \
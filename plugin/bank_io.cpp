@@ -16,19 +16,123 @@
 //
 
 #include "bank_io.h"
+#include <map>
 #include <mutex>
 #include <shared_mutex>
+#include <condition_variable>
+#include <thread>
 
 std::shared_timed_mutex bank_mutex;
 
-bool save_bank(const char *path, ysfx_bank_t* bank)
+struct BankWriter::Impl {
+    void run();
+
+    std::mutex mutex;
+    std::condition_variable cond;
+    // the latest version of each bank which is not written yet
+    std::map<std::string, ysfx_bank_shared> pending;
+    std::string writing;
+    bool quit = false;
+    std::thread thread;
+};
+
+BankWriter::BankWriter()
+    : m_impl{new Impl}
+{
+    m_impl->thread = std::thread([this]() { m_impl->run(); });
+}
+
+BankWriter::~BankWriter()
+{
+    // the pending banks are written before
+    {
+        std::lock_guard<std::mutex> lock(m_impl->mutex);
+        m_impl->quit = true;
+    }
+    m_impl->cond.notify_all();
+    m_impl->thread.join();
+}
+
+void BankWriter::write(const std::string &path, ysfx_bank_shared bank)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_impl->mutex);
+        m_impl->pending[path] = std::move(bank);
+    }
+    m_impl->cond.notify_all();
+}
+
+void BankWriter::waitFor(const std::string &path)
+{
+    std::unique_lock<std::mutex> lock(m_impl->mutex);
+    m_impl->cond.wait(lock, [this, &path]() { return m_impl->writing != path && m_impl->pending.count(path) == 0; });
+}
+
+bool is_binary_bank_path(const char *path)
+{
+    return juce::File(juce::String::fromUTF8(path)).hasFileExtension("ysfxbank");
+}
+
+void BankWriter::Impl::run()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        cond.wait(lock, [this]() { return quit || !pending.empty(); });
+        if (pending.empty())
+            break;
+
+        auto it = pending.begin();
+        writing = it->first;
+        ysfx_bank_shared bank = std::move(it->second);
+        pending.erase(it);
+        lock.unlock();
+
+        {
+            std::unique_lock<std::shared_timed_mutex> bankLock(bank_mutex);
+            if (is_binary_bank_path(writing.c_str()))
+                ysfx_save_bank_binary(writing.c_str(), bank.get());
+            else
+                ysfx_save_bank(writing.c_str(), bank.get());
+        }
+        bank.reset();
+
+        lock.lock();
+        writing.clear();
+        cond.notify_all();
+    }
+}
+
+void save_bank(const char *path, ysfx_bank_shared bank)
 {
-    std::unique_lock<std::shared_timed_mutex> lock(bank_mutex);
-    return ysfx_save_bank(path, bank);
+    juce::SharedResourcePointer<BankWriter> writer;
+    writer->write(path, std::move(bank));
+}
+
+// the index of the names in a bank, kept for the next time it opens
+static juce::File bank_index_file(const char *path)
+{
+    juce::File dir = juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory);
+    if (dir == juce::File{})
+        return juce::File{};
+
+    dir = dir.getChildFile("ysfx_saike_mod").getChildFile("BankIndex");
+    if (!dir.createDirectory())
+        return juce::File{};
+
+    juce::String name = juce::String::toHexString(juce::String::fromUTF8(path).hashCode64());
+    return dir.getChildFile(name + ".index");
 }
 
 ysfx_bank_t* load_bank(const char *path)
 {
+    juce::SharedResourcePointer<BankWriter> writer;
+    writer->waitFor(path);
+
     std::shared_lock<std::shared_timed_mutex> lock(bank_mutex);
-    return ysfx_load_bank(path);
+
+    // the presets decode when they are first used
+    juce::File index = bank_index_file(path);
+    if (index == juce::File{})
+        return ysfx_load_bank_index(path, nullptr);
+    return ysfx_load_bank_index(path, index.getFullPathName().toRawUTF8());
 }
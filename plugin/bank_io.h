@@ -1,4 +1,4 @@
-// Copyright 2024 Joep Vanlier
+// Copyright 2021 Jean Pierre Cimalando
 //
 // Licensed under the Apache License, Version 2.0 (the "License");
 // you may not use this file except in compliance with the License.
@@ -14,8 +14,30 @@
 //
 // SPDX-License-Identifier: Apache-2.0
 //
-
+#pragma once
 #include "ysfx.h"
+#include <juce_core/juce_core.h>
+#include <memory>
 
-bool save_bank(const char *path, ysfx_bank_t* bank);
+// write a bank on the thread of the writer, replacing the file once it is complete
+//   a newer version of the bank, which comes before the write, replaces the older
+//   a path with the extension `.ysfxbank` is written in the binary format, others as RPL
+void save_bank(const char *path, ysfx_bank_shared bank);
+// whether a bank at this path is written in the binary format
+bool is_binary_bank_path(const char *path);
+// read a bank, after the writes which are pending for its file
 ysfx_bank_t* load_bank(const char *path);
+
+// the thread which writes the banks, while some instance holds it
+//   use it as `juce::SharedResourcePointer<BankWriter>`
+class BankWriter {
+public:
+    BankWriter();
+    ~BankWriter();
+    void write(const std::string &path, ysfx_bank_shared bank);
+    void waitFor(const std::string &path);
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> m_impl;
+};
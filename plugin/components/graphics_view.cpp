@@ -21,15 +21,18 @@
 #include "graphics_view.h"
 #include "utility/functional_timer.h"
 #include "utility/async_updater.h"
-#include "utility/rt_semaphore.h"
+#include "utility/task_pool.h"
+#include "utility/opaque_copy.h"
+#include <juce_opengl/juce_opengl.h>
 #include <list>
+#include <vector>
 #include <map>
 #include <queue>
 #include <tuple>
-#include <thread>
 #include <atomic>
 #include <mutex>
 #include <condition_variable>
+#include <algorithm>
 #include <cmath>
 #include <cstdio>
 
@@ -41,6 +44,8 @@ struct YsfxGraphicsView::Impl final : public better::AsyncUpdater::Listener {
     juce::Point<int> getDisplayOffset() const;
 
     void tickGfx();
+    double getGfxInterval(ysfx_t *fx) const;
+    void setGfxActive(bool active);
     bool updateGfxTarget(int newWidth, int newHeight, int newRetina);
     void updateYsfxKeyModifiers();
     void updateYsfxMousePosition(const juce::MouseEvent &event);
@@ -52,6 +57,25 @@ struct YsfxGraphicsView::Impl final : public better::AsyncUpdater::Listener {
     YsfxGraphicsView *m_self = nullptr;
     ysfx_u m_fx;
     std::unique_ptr<juce::Timer> m_gfxTimer;
+    // applies the size of the component, once it stops changing
+    std::unique_ptr<juce::Timer> m_resizeTimer;
+
+    //--------------------------------------------------------------------------
+    // Render surfaces, pooled by size class, so that a resize reuses them
+    //   a surface is a view on a pooled image, which is free again once all
+    //   its views are gone, as the frames in flight still hold the old ones
+
+    struct BitmapPool {
+        // get a surface of the size, not cleared
+        juce::Image acquire(int width, int height);
+        // the granularity of the size classes, in pixels
+        static constexpr int sizeClass = 256;
+        // the number of the images kept at most
+        static constexpr size_t maxImages = 4;
+        std::vector<juce::Image> m_images;
+    };
+
+    BitmapPool m_renderPool;
 
     //--------------------------------------------------------------------------
     struct GfxTarget : public std::enable_shared_from_this<GfxTarget> {
@@ -84,6 +108,24 @@ struct YsfxGraphicsView::Impl final : public better::AsyncUpdater::Listener {
     // whether the jsfx had a first initialization of the gfx resolution or not
     bool m_gfxInitialized = false;
 
+    //--------------------------------------------------------------------------
+    // Adaptive scheduling of @gfx
+    //   the rate backs off while the frames do not change, until the input or
+    //   the sliders wake it, and the views which show share a global budget
+
+    // the frames per second which all the views run at most, together
+    static constexpr double gfxFrameBudget = 240;
+    // the longest interval of a view which backs off, in milliseconds
+    static constexpr double gfxMaxIdleInterval = 250;
+
+    static std::atomic<int> s_numActiveViews;
+    // whether this view counts in the budget
+    bool m_gfxActive = false;
+    // the number of the last @gfx frames which have not changed
+    uint32_t m_gfxIdleFrames = 0;
+    double m_lastGfxTime = 0;
+    uint64_t m_sliderGeneration = 0;
+
     //--------------------------------------------------------------------------
     struct KeyPressed {
         int jcode = 0;
@@ -115,8 +157,15 @@ struct YsfxGraphicsView::Impl final : public better::AsyncUpdater::Listener {
     struct AsyncRepainter : public better::AsyncUpdater {
         // whether the bitmap contains changes
         bool m_hasBitmapChanged = false;
+        // the region of the bitmap which changed since the last repaint, in pixels
+        juce::Rectangle<int> m_changedArea;
+        // the region of the bitmap which the GPU texture has yet to receive
+        juce::Rectangle<int> m_uploadArea;
+        // whether the GPU scales the texture with linear filtering
+        bool m_linearFilter = false;
         // a double-buffer of the render bitmap, copied after a finished rendering
         juce::Image m_bitmap{juce::Image::ARGB, 1, 1, false, juce::SoftwareImageType{}};
+        BitmapPool m_bitmapPool;
         std::mutex m_mutex;
     };
 
@@ -143,50 +192,57 @@ struct YsfxGraphicsView::Impl final : public better::AsyncUpdater::Listener {
     void handleAsyncUpdate(better::AsyncUpdater *updater) override;
 
     //--------------------------------------------------------------------------
-    // This background thread runs @gfx.
-    // This is on a separate thread, because it has elements which can block,
-    // which otherwise would require modal loops (eg. `gfx_showmenu`).
-
-    class BackgroundWork {
-    public:
-        void start();
-        void stop();
-
-        struct Message : std::enable_shared_from_this<Message> {
-            explicit Message(int type) : m_type{type} {}
-            int m_type = 0;
-        };
+    // The frames of @gfx run on the task pool, which the views share with the
+    // processors. This is off the message thread, because @gfx has elements
+    // which can block, which otherwise would require modal loops (eg. `gfx_showmenu`).
+    //   the pool runs the frames of a view one at a time, and those of the
+    //   views in turns, after the background work of the processors
+
+    static constexpr int gfxTaskPriority = 100;
+
+    struct GfxFrame {
+        ysfx_u m_fx;
+        GfxTarget::Ptr m_target;
+        bool m_dirty = false;
+        GfxInputState m_input;
+        AsyncRepainter *m_asyncRepainter = nullptr;
+        std::atomic<int> *m_numPendingFrames = nullptr;
+        void *m_userData = nullptr;
+    };
 
-        struct GfxMessage : Message {
-            GfxMessage() : Message{'@gfx'} {}
-            ysfx_u m_fx;
-            GfxTarget::Ptr m_target;
-            bool m_dirty = false;
-            GfxInputState m_input;
-            AsyncRepainter *m_asyncRepainter = nullptr;
-            void *m_userData = nullptr;
-        };
+    static void processGfxFrame(GfxFrame &frame);
+    void cancelGfxFrames();
 
-        void postMessage(std::shared_ptr<Message> message);
+    juce::SharedResourcePointer<TaskPool> m_taskPool;
 
-    private:
-        void run();
-        std::shared_ptr<Message> popNextMessage();
-        void processGfxMessage(GfxMessage &msg);
+    // the frames posted, which have yet to finish
+    std::atomic<int> m_numPendingFrames{0};
 
-    private:
-        std::thread m_thread;
-        RTSemaphore m_sema;
-        volatile bool m_running = false;
-        std::queue<std::shared_ptr<Message>> m_messages;
-        std::mutex m_messagesMutex;
+    //--------------------------------------------------------------------------
+    // The optional presentation on the GPU, which uploads the changed region
+    // of the bitmap into a texture, and scales the texture there.
+
+#if !JUCE_OPENGL_ES
+    struct GpuPresenter : public juce::OpenGLRenderer {
+        explicit GpuPresenter(Impl *impl) : m_impl{impl} {}
+        ~GpuPresenter() override { m_context.detach(); }
+        void newOpenGLContextCreated() override {}
+        void renderOpenGL() override;
+        void openGLContextClosing() override;
+
+        Impl *m_impl = nullptr;
+        juce::OpenGLContext m_context;
+        GLuint m_texture = 0;
+        int m_textureWidth = 0;
+        int m_textureHeight = 0;
     };
 
-    BackgroundWork m_work;
-
-    uint32_t m_numWaitedRepaints = 0;
+    std::unique_ptr<GpuPresenter> m_gpuPresenter;
+#endif
 };
 
+std::atomic<int> YsfxGraphicsView::Impl::s_numActiveViews{0};
+
 YsfxGraphicsView::YsfxGraphicsView()
     : m_impl{new YsfxGraphicsView::Impl}
 {
@@ -210,8 +266,12 @@ YsfxGraphicsView::YsfxGraphicsView()
 
 YsfxGraphicsView::~YsfxGraphicsView()
 {
+#if !JUCE_OPENGL_ES
+    m_impl->m_gpuPresenter.reset();
+#endif
     m_impl->endPopupMenu(0);
-    m_impl->m_work.stop();
+    m_impl->cancelGfxFrames();
+    m_impl->setGfxActive(false);
 
     m_impl->m_asyncRepainter->removeListener(m_impl.get());
     m_impl->m_asyncMouseCursor->removeListener(m_impl.get());
@@ -228,17 +288,19 @@ void YsfxGraphicsView::setEffect(ysfx_t *fx)
         ysfx_add_ref(fx);
 
     m_impl->endPopupMenu(0);
-    m_impl->m_work.stop();
+    m_impl->cancelGfxFrames();
 
     m_impl->m_gfxDirty = true;
     m_impl->m_gfxInitialized = false;
+    m_impl->m_gfxIdleFrames = 0;
+    m_impl->m_lastGfxTime = 0;
 
     if (!fx || !ysfx_has_section(fx, ysfx_section_gfx)) {
         m_impl->m_gfxTimer.reset();
+        m_impl->setGfxActive(false);
         repaint();
     }
     else {
-        m_impl->m_work.start();
         m_impl->m_gfxTimer.reset(FunctionalTimer::create([this]() { m_impl->tickGfx(); }));
         m_impl->m_gfxTimer->startTimerHz(ysfx_get_requested_framerate(fx));
     }
@@ -251,15 +313,69 @@ void YsfxGraphicsView::setEffect(ysfx_t *fx)
 
     m_impl->m_popupMenu.reset();
 
-    m_impl->m_numWaitedRepaints = 0;
-
     setMouseCursor(juce::MouseCursor{juce::MouseCursor::NormalCursor});
 }
 
 void YsfxGraphicsView::setScaling(float new_scaling)
 {
-    m_outputScalingFactor.store(new_scaling);
-    fullPixelScaling = static_cast<bool>(std::abs(std::round(new_scaling) - new_scaling) <= 0.0000001f);
+    float old_scaling = m_outputScalingFactor.exchange(new_scaling);
+    updatePixelScaling();
+    if (old_scaling != new_scaling && onScalingChanged)
+        onScalingChanged();
+}
+
+void YsfxGraphicsView::setRenderScale(float new_scale)
+{
+    if (m_renderScale.exchange(new_scale) == new_scale)
+        return;
+
+    updatePixelScaling();
+    if (m_impl->updateGfxTarget(-1, -1, -1))
+        m_impl->m_gfxDirty = true;
+}
+
+void YsfxGraphicsView::updatePixelScaling()
+{
+    // the bitmap maps to whole pixels when it upscales by an integer
+    float upscale = m_outputScalingFactor.load() / m_renderScale.load();
+    fullPixelScaling = static_cast<bool>(std::abs(std::round(upscale) - upscale) <= 0.0000001f);
+
+    std::lock_guard<std::mutex> lock{m_impl->m_asyncRepainter->m_mutex};
+    m_impl->m_asyncRepainter->m_linearFilter = !fullPixelScaling;
+}
+
+float YsfxGraphicsView::getPresentationScale() const
+{
+    return m_outputScalingFactor.load() / (m_pixelFactor.load() * m_renderScale.load());
+}
+
+void YsfxGraphicsView::setGpuPresentation(bool enable)
+{
+#if !JUCE_OPENGL_ES
+    if (enable == (m_impl->m_gpuPresenter != nullptr))
+        return;
+
+    if (!enable) {
+        m_impl->m_gpuPresenter.reset();
+        repaint();
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock{m_impl->m_asyncRepainter->m_mutex};
+        m_impl->m_asyncRepainter->m_uploadArea = m_impl->m_asyncRepainter->m_bitmap.getBounds();
+        m_impl->m_asyncRepainter->m_linearFilter = !fullPixelScaling;
+    }
+
+    m_impl->m_gpuPresenter.reset(new Impl::GpuPresenter{m_impl.get()});
+    juce::OpenGLContext &context = m_impl->m_gpuPresenter->m_context;
+    context.setRenderer(m_impl->m_gpuPresenter.get());
+    context.setComponentPaintingEnabled(false);
+    context.setContinuousRepainting(false);
+    context.attachTo(*this);
+#else
+    (void)enable;
+#endif
 }
 
 float YsfxGraphicsView::getScaling()
@@ -267,6 +383,11 @@ float YsfxGraphicsView::getScaling()
     return m_outputScalingFactor.load();
 }
 
+float YsfxGraphicsView::getRenderScale()
+{
+    return m_renderScale.load();
+}
+
 float YsfxGraphicsView::getTotalScaling()
 {
     // We rescale this only when we have active UI rescaling on under the assumption that that mode
@@ -281,7 +402,9 @@ void YsfxGraphicsView::paint(juce::Graphics &g)
 
     // Get final pixel size (we want to correct for any DPI scaling that's happening by making the
     // graphical render target larger).
-    m_pixelFactor = juce::jmax(1.0f, g.getInternalContext().getPhysicalPixelScaleFactor());
+    float pixel_factor = juce::jmax(1.0f, g.getInternalContext().getPhysicalPixelScaleFactor());
+    if (m_pixelFactor.exchange(pixel_factor) != pixel_factor && onScalingChanged)
+        onScalingChanged();
 
     ///
     if (fullPixelScaling) {
@@ -293,15 +416,29 @@ void YsfxGraphicsView::paint(juce::Graphics &g)
     juce::Image &image = m_impl->m_asyncRepainter->m_bitmap;
 
     g.setOpacity(1.0f);
-    auto trafo = juce::AffineTransform::scale(m_outputScalingFactor.load() / m_pixelFactor.load()).translated(0.5f, 0.5f);
+    auto trafo = juce::AffineTransform::scale(getPresentationScale()).translated(0.5f, 0.5f);
     g.drawImageTransformed(image, trafo, false);
 }
 
 void YsfxGraphicsView::resized()
 {
     Component::resized();
-    if (m_impl->updateGfxTarget(-1, -1, -1))
-        m_impl->m_gfxDirty = true;
+
+    // the first size applies at once, and the next when the dragging pauses
+    if (m_impl->m_gfxTarget->m_gfxWidth <= 0 || m_impl->m_gfxTarget->m_gfxHeight <= 0) {
+        if (m_impl->updateGfxTarget(-1, -1, -1))
+            m_impl->m_gfxDirty = true;
+        return;
+    }
+
+    if (!m_impl->m_resizeTimer) {
+        m_impl->m_resizeTimer.reset(FunctionalTimer::create([this]() {
+            m_impl->m_resizeTimer->stopTimer();
+            if (m_impl->updateGfxTarget(-1, -1, -1))
+                m_impl->m_gfxDirty = true;
+        }));
+    }
+    m_impl->m_resizeTimer->startTimer(50);
 }
 
 bool YsfxGraphicsView::keyPressed(const juce::KeyPress &key)
@@ -414,6 +551,7 @@ void YsfxGraphicsView::filesDropped(const juce::StringArray &files, int x, int y
 {
     (void)x;
     (void)y;
+    m_impl->m_gfxIdleFrames = 0;
     std::lock_guard<std::mutex> lock{m_impl->m_droppedFilesMutex};
     m_impl->m_droppedFiles = files;
 }
@@ -491,14 +629,36 @@ void YsfxGraphicsView::Impl::translateKeyPress(const juce::KeyPress &key, uint32
 //------------------------------------------------------------------------------
 void YsfxGraphicsView::Impl::tickGfx()
 {
-    // don't overload the background with @gfx requests
+    // pause while the view is hidden, or its window minimized
+    const bool showing = m_self->isShowing();
+    setGfxActive(showing);
+    if (!showing)
+        return;
+
+    // don't overload the pool with @gfx frames, one runs and one waits
     // (remember that @gfx can block)
-    if (m_numWaitedRepaints > 1)
+    if (m_numPendingFrames.load() > 1)
         return;
 
     ysfx_t *fx = m_fx.get();
     jassert(fx);
 
+    // a bounce has the processor to itself
+    if (ysfx_is_offline(fx))
+        return;
+
+    // wake when a slider moves, from the host, the panel, or the effect
+    uint64_t sliderGeneration = ysfx_get_slider_snapshot(fx)->generation;
+    if (sliderGeneration != m_sliderGeneration) {
+        m_sliderGeneration = sliderGeneration;
+        m_gfxIdleFrames = 0;
+    }
+
+    const double now = juce::Time::getMillisecondCounterHiRes();
+    if (now - m_lastGfxTime < getGfxInterval(fx))
+        return;
+    m_lastGfxTime = now;
+
     ///
     uint32_t gfxDim[2] = {};
     ysfx_get_gfx_dim(fx, gfxDim);
@@ -511,7 +671,7 @@ void YsfxGraphicsView::Impl::tickGfx()
     }
 
     ///
-    std::shared_ptr<BackgroundWork::GfxMessage> msg{new BackgroundWork::GfxMessage};
+    std::shared_ptr<GfxFrame> msg{new GfxFrame};
     msg->m_fx.reset(fx);
     ysfx_add_ref(fx);
     msg->m_target = m_gfxTarget;
@@ -524,14 +684,41 @@ void YsfxGraphicsView::Impl::tickGfx()
     msg->m_input.m_ysfxHWheel = m_gfxInputState->m_ysfxHWheel;
     msg->m_input.m_ysfxKeys = std::move(m_gfxInputState->m_ysfxKeys);
     msg->m_asyncRepainter = m_asyncRepainter.get();
+    msg->m_numPendingFrames = &m_numPendingFrames;
     msg->m_userData = m_self;
 
     m_gfxInputState->m_ysfxWheel = 0;
     m_gfxInputState->m_ysfxHWheel = 0;
 
     ///
-    m_work.postMessage(msg);
-    m_numWaitedRepaints += 1;
+    m_numPendingFrames.fetch_add(1);
+    m_taskPool->post(this, gfxTaskPriority, [msg]() { processGfxFrame(*msg); });
+    m_gfxDirty = false;
+}
+
+double YsfxGraphicsView::Impl::getGfxInterval(ysfx_t *fx) const
+{
+    const uint32_t framerate = juce::jmax(1u, ysfx_get_requested_framerate(fx));
+    double interval = 1000.0 / framerate;
+
+    // after a second without change, the interval doubles with each second
+    const uint32_t idleSeconds = m_gfxIdleFrames / framerate;
+    if (idleSeconds > 0)
+        interval = juce::jmax(interval, juce::jmin(gfxMaxIdleInterval, interval * (double)(1u << juce::jmin(idleSeconds, 8u))));
+
+    // the budget goes in equal shares to the views which show
+    const int numViews = juce::jmax(1, s_numActiveViews.load(std::memory_order_relaxed));
+    return juce::jmax(interval, 1000.0 * numViews / gfxFrameBudget);
+}
+
+void YsfxGraphicsView::Impl::setGfxActive(bool active)
+{
+    if (m_gfxActive == active)
+        return;
+    m_gfxActive = active;
+    s_numActiveViews.fetch_add(active ? 1 : -1, std::memory_order_relaxed);
+    if (active)
+        m_gfxIdleFrames = 0;
 }
 
 bool YsfxGraphicsView::Impl::updateGfxTarget(int newWidth, int newHeight, int newRetina)
@@ -547,15 +734,16 @@ bool YsfxGraphicsView::Impl::updateGfxTarget(int newWidth, int newHeight, int ne
     newHeight = (newHeight == -1) ? m_self->getHeight() : (int) (newHeight * scaling_factor);
     newRetina = (newRetina == -1) ? target->m_wantRetina : newRetina;
 
-    // Set internal JSFX texture size
-    int internal_width = static_cast<int>(newWidth * pixel_factor);
-    int internal_height = static_cast<int>(newHeight * pixel_factor);
+    // Set internal JSFX texture size, at the resolution chosen for rendering
+    float bitmap_scale = pixel_factor * m_self->m_renderScale.load();
+    int internal_width = static_cast<int>(newWidth * bitmap_scale);
+    int internal_height = static_cast<int>(newHeight * bitmap_scale);
 
     bool needsUpdate = (
         (target->m_gfxWidth != internal_width)
         || (target->m_gfxHeight != internal_height)
         || (target->m_wantRetina != static_cast<bool>(newRetina))
-        || (std::abs(target->m_bitmapScale - pixel_factor) > 1e-4)
+        || (std::abs(target->m_bitmapScale - bitmap_scale) > 1e-4)
     );
 
     if (needsUpdate) {
@@ -564,15 +752,45 @@ bool YsfxGraphicsView::Impl::updateGfxTarget(int newWidth, int newHeight, int ne
         target->m_gfxWidth = internal_width;
         target->m_gfxHeight = internal_height;
         target->m_wantRetina = (bool)newRetina;
-        target->m_renderBitmap = juce::Image(juce::Image::ARGB, juce::jmax(1, internal_width - 2), juce::jmax(1, internal_height - 2), true, juce::SoftwareImageType{});
-        target->m_bitmapScale = pixel_factor;
+        target->m_renderBitmap = m_renderPool.acquire(juce::jmax(1, internal_width - 2), juce::jmax(1, internal_height - 2));
+        target->m_renderBitmap.clear(target->m_renderBitmap.getBounds());
+        target->m_bitmapScale = bitmap_scale;
     }
 
     return needsUpdate;
 }
 
+juce::Image YsfxGraphicsView::Impl::BitmapPool::acquire(int width, int height)
+{
+    const int classWidth = (width + sizeClass - 1) / sizeClass * sizeClass;
+    const int classHeight = (height + sizeClass - 1) / sizeClass * sizeClass;
+    const juce::Rectangle<int> area{0, 0, width, height};
+
+    // an image is free when the pool holds its only reference
+    auto isFree = [](const juce::Image &image) -> bool { return image.getReferenceCount() == 1; };
+
+    for (const juce::Image &image : m_images) {
+        if (isFree(image) && image.getWidth() == classWidth && image.getHeight() == classHeight)
+            return image.getClippedImage(area);
+    }
+
+    // make room, by dropping a free image of another size
+    if (m_images.size() >= maxImages) {
+        auto it = std::find_if(m_images.begin(), m_images.end(), isFree);
+        if (it != m_images.end())
+            m_images.erase(it);
+    }
+
+    juce::Image image{juce::Image::ARGB, classWidth, classHeight, false, juce::SoftwareImageType{}};
+    if (m_images.size() < maxImages)
+        m_images.push_back(image);
+    return image.getClippedImage(area);
+}
+
 void YsfxGraphicsView::Impl::updateYsfxKeyModifiers()
 {
+    // any input wakes @gfx out of its back off
+    m_gfxIdleFrames = 0;
     juce::ModifierKeys mods = juce::ModifierKeys::getCurrentModifiers();
     m_gfxInputState->m_ysfxMouseMods = translateModifiers(mods);
 }
@@ -710,72 +928,14 @@ const char *YsfxGraphicsView::Impl::getYsfxDropFile(void *userdata, int32_t inde
 }
 
 //------------------------------------------------------------------------------
-void YsfxGraphicsView::Impl::BackgroundWork::start()
-{
-    if (m_running)
-        return;
-
-    m_running = true;
-    m_thread = std::thread([this]() { run(); });
-}
-
-void YsfxGraphicsView::Impl::BackgroundWork::stop()
-{
-    if (!m_running)
-        return;
-
-    m_running = false;
-    m_sema.post();
-
-    m_thread.join();
-
-    std::lock_guard<std::mutex> lock{m_messagesMutex};
-    while (!m_messages.empty())
-        m_messages.pop();
-
-    m_sema.clear();
-}
-
-void YsfxGraphicsView::Impl::BackgroundWork::postMessage(std::shared_ptr<Message> message)
-{
-    if (!m_running)
-        return;
-
-    {
-        std::lock_guard<std::mutex> lock{m_messagesMutex};
-        m_messages.emplace(message);
-    }
-    m_sema.post();
-}
-
-void YsfxGraphicsView::Impl::BackgroundWork::run()
-{
-    while (m_sema.wait(), m_running) {
-        std::shared_ptr<Message> msg = popNextMessage();
-        jassert(msg);
-
-        if (msg) {
-            switch (msg->m_type) {
-            case '@gfx':
-                processGfxMessage(static_cast<GfxMessage &>(*msg));
-                break;
-            }
-        }
-    }
-}
-
-std::shared_ptr<YsfxGraphicsView::Impl::BackgroundWork::Message> YsfxGraphicsView::Impl::BackgroundWork::popNextMessage()
+void YsfxGraphicsView::Impl::cancelGfxFrames()
 {
-    std::lock_guard<std::mutex> lock{m_messagesMutex};
-    if (m_messages.empty())
-        return nullptr;
-
-    std::shared_ptr<Message> msg = m_messages.front();
-    m_messages.pop();
-    return msg;
+    // drop the frames which wait, and wait for the one which runs
+    m_taskPool->cancel(this);
+    m_numPendingFrames.store(0);
 }
 
-void YsfxGraphicsView::Impl::BackgroundWork::processGfxMessage(GfxMessage &msg)
+void YsfxGraphicsView::Impl::processGfxFrame(GfxFrame &msg)
 {
     ysfx_t *fx = msg.m_fx.get();
     GfxInputState &input = msg.m_input;
@@ -791,6 +951,8 @@ void YsfxGraphicsView::Impl::BackgroundWork::processGfxMessage(GfxMessage &msg)
     ///
     GfxTarget *target = msg.m_target.get();
     bool mustRepaint;
+    bool hasDirtyRect;
+    uint32_t dirtyRect[4];
 
     {
         juce::Image::BitmapData bdata{target->m_renderBitmap, juce::Image::BitmapData::readWrite};
@@ -807,20 +969,16 @@ void YsfxGraphicsView::Impl::BackgroundWork::processGfxMessage(GfxMessage &msg)
         gc.get_drop_file = &getYsfxDropFile;
         ysfx_gfx_setup(fx, &gc);
 
-        // multiple @gfx cannot run concurrently on different threads (issue 44)
-        // FIXME: this workaround affects performance, actually fix this properly
-        static std::mutex globalGfxRunMutex;
-        std::lock_guard<std::mutex> gfxRunLock{globalGfxRunMutex};
-
+        // the instances run @gfx concurrently, and take turns only for text (issue 44)
         mustRepaint = ysfx_gfx_run(fx) || msg.m_dirty;
+        hasDirtyRect = ysfx_gfx_get_dirty_rect(fx, dirtyRect);
     }
 
     ///
     std::lock_guard<std::mutex> lock{msg.m_asyncRepainter->m_mutex};
 
-    if (!mustRepaint)
-        msg.m_asyncRepainter->m_hasBitmapChanged = false;
-    else
+    // a change stays due until the component repaints, across the frames in flight
+    if (mustRepaint)
     {
         juce::Image &imgsrc = target->m_renderBitmap;
         juce::Image &imgdst = msg.m_asyncRepainter->m_bitmap;
@@ -828,33 +986,114 @@ void YsfxGraphicsView::Impl::BackgroundWork::processGfxMessage(GfxMessage &msg)
         int w = imgsrc.getWidth();
         int h = imgsrc.getHeight();
 
-        if (w != imgdst.getWidth() || h != imgdst.getHeight())
-            imgdst = juce::Image{juce::Image::ARGB, w, h, false, juce::SoftwareImageType{}};
+        // copy only what @gfx has drawn on, unless the whole screen is due
+        juce::Rectangle<int> area{0, 0, w, h};
+        bool isFullCopy = msg.m_dirty || !hasDirtyRect;
+
+        if (w != imgdst.getWidth() || h != imgdst.getHeight()) {
+            // let go of the old surface first, which the pool may hand out again
+            imgdst = juce::Image{};
+            imgdst = msg.m_asyncRepainter->m_bitmapPool.acquire(w, h);
+            isFullCopy = true;
+        }
+
+        if (!isFullCopy)
+            area = area.getIntersection({(int)dirtyRect[0], (int)dirtyRect[1], (int)dirtyRect[2], (int)dirtyRect[3]});
 
         juce::Image::BitmapData src{imgsrc, juce::Image::BitmapData::readOnly};
         juce::Image::BitmapData dst{imgdst, juce::Image::BitmapData::writeOnly};
 
         // Set alpha channel to 255 explicitly.
-        for (int row = 0; row < h; ++row)
-        {
-            juce::uint8* from = src.getLinePointer(row);
-            juce::uint8* to = dst.getLinePointer(row);
-            for (int pix = 0; pix < w; ++pix)
-            {
-                juce::uint32 pixel = *reinterpret_cast<const juce::uint32*>(from);
-                *reinterpret_cast<juce::uint32*>(to) = pixel | 0xFF000000;
-
-                from += src.pixelStride;
-                to += src.pixelStride;
-            }
-        }
+        jassert(src.pixelStride == 4 && dst.pixelStride == 4);
+        for (int row = area.getY(); row < area.getBottom(); ++row)
+            copyPixelsOpaque(src.getPixelPointer(area.getX(), row), dst.getPixelPointer(area.getX(), row), area.getWidth());
 
         msg.m_asyncRepainter->m_hasBitmapChanged = true;
+        msg.m_asyncRepainter->m_changedArea = isFullCopy ? area : msg.m_asyncRepainter->m_changedArea.getUnion(area);
+        msg.m_asyncRepainter->m_uploadArea = isFullCopy ? area : msg.m_asyncRepainter->m_uploadArea.getUnion(area);
     }
 
     msg.m_asyncRepainter->triggerAsyncUpdate();
+    msg.m_numPendingFrames->fetch_sub(1);
 }
 
+//------------------------------------------------------------------------------
+#if !JUCE_OPENGL_ES
+void YsfxGraphicsView::Impl::GpuPresenter::renderOpenGL()
+{
+    using namespace juce::gl;
+
+    YsfxGraphicsView *self = m_impl->m_self;
+    const float renderingScale = (float)m_context.getRenderingScale();
+    const float pixelFactor = juce::jmax(1.0f, renderingScale);
+    if (self->m_pixelFactor.exchange(pixelFactor) != pixelFactor) {
+        // this is the render thread, the owner hears of it on the message thread
+        juce::Component::SafePointer<YsfxGraphicsView> safeSelf{self};
+        juce::MessageManager::callAsync([safeSelf]() {
+            if (safeSelf && safeSelf->onScalingChanged)
+                safeSelf->onScalingChanged();
+        });
+    }
+
+    juce::OpenGLHelpers::clear(juce::Colours::black);
+
+    AsyncRepainter &repainter = *m_impl->m_asyncRepainter;
+    std::lock_guard<std::mutex> lock{repainter.m_mutex};
+    juce::Image &image = repainter.m_bitmap;
+    const int w = image.getWidth();
+    const int h = image.getHeight();
+
+    if (m_texture == 0)
+        glGenTextures(1, &m_texture);
+    glBindTexture(GL_TEXTURE_2D, m_texture);
+
+    if (w != m_textureWidth || h != m_textureHeight) {
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h, 0, GL_BGRA, GL_UNSIGNED_BYTE, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        m_textureWidth = w;
+        m_textureHeight = h;
+        repainter.m_uploadArea = image.getBounds();
+    }
+
+    // upload only the rows and columns which @gfx has changed
+    juce::Rectangle<int> area = repainter.m_uploadArea.getIntersection(image.getBounds());
+    repainter.m_uploadArea = {};
+    if (!area.isEmpty()) {
+        juce::Image::BitmapData bdata{image, juce::Image::BitmapData::readOnly};
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, bdata.lineStride / bdata.pixelStride);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, area.getX(), area.getY(), area.getWidth(), area.getHeight(),
+                        GL_BGRA, GL_UNSIGNED_BYTE, bdata.getPixelPointer(area.getX(), area.getY()));
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    }
+
+    const GLint filter = repainter.m_linearFilter ? GL_LINEAR : GL_NEAREST;
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+
+    // the same mapping as the software paint, in the pixels of the context
+    const float scale = self->getPresentationScale() * renderingScale;
+    const int contextWidth = juce::roundToInt(renderingScale * (float)self->getWidth());
+    const int contextHeight = juce::roundToInt(renderingScale * (float)self->getHeight());
+    const juce::Rectangle<int> target{0, 0, juce::roundToInt(scale * (float)w), juce::roundToInt(scale * (float)h)};
+    m_context.copyTexture(target, target, contextWidth, contextHeight, false);
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void YsfxGraphicsView::Impl::GpuPresenter::openGLContextClosing()
+{
+    using namespace juce::gl;
+
+    if (m_texture != 0)
+        glDeleteTextures(1, &m_texture);
+    m_texture = 0;
+    m_textureWidth = 0;
+    m_textureHeight = 0;
+}
+#endif
+
 //------------------------------------------------------------------------------
 std::unique_ptr<juce::PopupMenu> YsfxGraphicsView::Impl::createPopupMenu(const char *str)
 {
@@ -916,9 +1155,31 @@ void YsfxGraphicsView::Impl::endPopupMenu(int menuResult)
 void YsfxGraphicsView::Impl::handleAsyncUpdate(better::AsyncUpdater *updater)
 {
     if (updater == m_asyncRepainter.get()) {
-        if (m_asyncRepainter->m_hasBitmapChanged)
-            m_self->repaint();
-        m_numWaitedRepaints -= 1;
+        juce::Rectangle<int> area;
+        {
+            std::lock_guard<std::mutex> lock{m_asyncRepainter->m_mutex};
+            if (m_asyncRepainter->m_hasBitmapChanged)
+                area = m_asyncRepainter->m_changedArea;
+            m_asyncRepainter->m_hasBitmapChanged = false;
+            m_asyncRepainter->m_changedArea = {};
+            m_asyncRepainter->m_linearFilter = !m_self->fullPixelScaling;
+        }
+        if (area.isEmpty())
+            m_gfxIdleFrames += 1;
+        else
+            m_gfxIdleFrames = 0;
+#if !JUCE_OPENGL_ES
+        if (m_gpuPresenter) {
+            if (!area.isEmpty())
+                m_gpuPresenter->m_context.triggerRepaint();
+        }
+        else
+#endif
+        if (!area.isEmpty()) {
+            // map the pixels like paint does, with a margin for resampling
+            float scale = m_self->getPresentationScale();
+            m_self->repaint(area.toFloat().transformedBy(juce::AffineTransform::scale(scale)).getSmallestIntegerContainer().expanded(2));
+        }
     }
     else if (updater == m_asyncMouseCursor.get()) {
         AsyncMouseCursor &cursorUpdater = static_cast<AsyncMouseCursor &>(*updater);
@@ -18,6 +18,7 @@
 #pragma once
 #include "ysfx.h"
 #include <juce_gui_basics/juce_gui_basics.h>
+#include <functional>
 #include <memory>
 
 class YsfxGraphicsView : public juce::Component, public juce::FileDragAndDropTarget {
@@ -26,9 +27,16 @@ public:
     ~YsfxGraphicsView() override;
     void setEffect(ysfx_t *fx);
     void setScaling(float new_scaling);
+    void setGpuPresentation(bool enable);
+    // set the resolution which @gfx renders at, relative to the display, independently of the scaling
+    void setRenderScale(float new_scale);
     float getScaling();
+    float getRenderScale();
     float getTotalScaling();
 
+    // called on the message thread when the total scaling may have changed
+    std::function<void()> onScalingChanged;
+
 protected:
     void paint(juce::Graphics &g) override;
     void resized() override;
@@ -47,8 +55,13 @@ protected:
 private:
     std::atomic<float> m_pixelFactor{1.0f};
     std::atomic<float> m_outputScalingFactor{1.0f};
+    std::atomic<float> m_renderScale{1.0f};
     bool fullPixelScaling{true};
 
+    // the scale from the pixels of the bitmap to those of the component
+    float getPresentationScale() const;
+    void updatePixelScaling();
+
     struct Impl;
     std::unique_ptr<Impl> m_impl;
 };
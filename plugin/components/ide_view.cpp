@@ -23,6 +23,8 @@
 #include "utility/functional_timer.h"
 #include "tokenizer.h"
 #include <algorithm>
+#include <string>
+#include <vector>
 #include "ysfx_document.h"
 
 
@@ -34,6 +36,8 @@ struct YsfxIDEView::Impl {
     std::unique_ptr<JSFXTokenizer> m_tokenizer;
     std::unique_ptr<juce::TextButton> m_btnSave;
     std::unique_ptr<juce::TextButton> m_btnUpdate;
+    std::unique_ptr<juce::TextButton> m_btnProfile;
+    std::unique_ptr<juce::TextButton> m_btnTrace;
     std::unique_ptr<juce::Label> m_lblVariablesHeading;
     std::unique_ptr<juce::TextEditor> m_searchBox;
     std::unique_ptr<juce::Viewport> m_vpVariables;
@@ -57,6 +61,7 @@ struct YsfxIDEView::Impl {
     };
     juce::Array<VariableUI> m_vars;
     std::unique_ptr<juce::Timer> m_varsUpdateTimer;
+    std::unique_ptr<juce::Timer> m_heatUpdateTimer;
     juce::String searchString{""};
 
     bool m_forceUpdate{false};
@@ -65,8 +70,10 @@ struct YsfxIDEView::Impl {
     //==========================================================================
     void setupNewFx();
     void buildVariableList();
+    void updateLineHeat();
     void saveCurrentFile();
     void saveAs();
+    void saveTrace();
     std::shared_ptr<YSFXCodeEditor> addEditor();
     void openDocument(juce::File file);
     void setCurrentEditor(int idx);
@@ -202,13 +209,26 @@ void YsfxIDEView::Impl::buildVariableList()
             return a.m_name.compareNatural(b.m_name) < 0;
         });
 
+    // the processing copies the listed variables after each cycle, in this order
+    std::vector<std::string> names((size_t)m_vars.size());
+    std::vector<const char *> namePtrs((size_t)m_vars.size());
+    for (int i = 0; i < m_vars.size(); ++i) {
+        names[(size_t)i] = m_vars.getReference(i).m_name.toStdString();
+        namePtrs[(size_t)i] = names[(size_t)i].c_str();
+    }
+    ysfx_set_watch(fx, namePtrs.data(), (uint32_t)namePtrs.size(), nullptr, 0);
+
     m_varsUpdateTimer.reset(
         FunctionalTimer::create(
             [this]() {
                 if (m_self->isShowing() && m_btnUpdate && (m_btnUpdate->getToggleState() || m_forceUpdate)) {
-                    for (int i = 0; i < m_vars.size(); ++i) {
-                        VariableUI &ui = m_vars.getReference(i);
-                        ui.m_lblValue->setText(juce::String(*ui.m_var), juce::dontSendNotification);
+                    uint32_t count = 0;
+                    const ysfx_real *values = ysfx_get_watch(m_fx.get(), &count);
+                    if (values && count == (uint32_t)m_vars.size()) {
+                        for (int i = 0; i < m_vars.size(); ++i) {
+                            VariableUI &ui = m_vars.getReference(i);
+                            ui.m_lblValue->setText(juce::String(values[i]), juce::dontSendNotification);
+                        }
                         m_forceUpdate = false;
                     }
                 }
@@ -225,6 +245,40 @@ void YsfxIDEView::Impl::buildVariableList()
     relayoutUILater();
 }
 
+void YsfxIDEView::Impl::updateLineHeat()
+{
+    ysfx_t *fx = m_fx.get();
+    bool enabled = fx && m_btnProfile->getToggleState();
+
+    std::vector<ysfx_line_sample_t> samples;
+    if (enabled) {
+        samples.resize(ysfx_get_line_samples(fx, nullptr, 0));
+        samples.resize(ysfx_get_line_samples(fx, samples.data(), (uint32_t)samples.size()));
+    }
+
+    for (const auto& editor : m_editors) {
+        if (!enabled) {
+            editor->setLineHeat({});
+            continue;
+        }
+
+        // relative to the hottest line of the file
+        const juce::File path = editor->getPath();
+        std::vector<float> heat;
+        uint64_t hottest = 0;
+        for (const ysfx_line_sample_t &sample : samples) {
+            if (juce::File{juce::CharPointer_UTF8{sample.file}} != path) continue;
+            if (heat.size() < sample.line) heat.resize(sample.line);
+            heat[sample.line - 1] = (float)sample.count;
+            hottest = std::max(hottest, sample.count);
+        }
+        if (hottest > 0) {
+            for (float &h : heat) h /= (float)hottest;
+        }
+        editor->setLineHeat(std::move(heat));
+    }
+}
+
 void YsfxIDEView::Impl::setupNewFx()
 {
     ysfx_t *fx = m_fx.get();
@@ -283,6 +337,29 @@ void YsfxIDEView::Impl::saveAs()
     );
 }
 
+void YsfxIDEView::Impl::saveTrace()
+{
+    if (m_fileChooserActive) return;
+    m_fileChooserActive = true;
+
+    juce::File initialPath = juce::File::getSpecialLocation(juce::File::userDocumentsDirectory).getChildFile("ysfx-trace.json");
+
+    m_fileChooser.reset(new juce::FileChooser(TRANS("Choose filename to save the trace to"), initialPath, "*.json"));
+    m_fileChooser->launchAsync(
+        juce::FileBrowserComponent::saveMode|juce::FileBrowserComponent::canSelectFiles|juce::FileBrowserComponent::warnAboutOverwriting,
+        [this](const juce::FileChooser &chooser) {
+            juce::File chosenFile = chooser.getResult();
+            if (chosenFile != juce::File()) {
+                if (ysfx_write_trace(chosenFile.getFullPathName().toRawUTF8()))
+                    m_self->setStatusText(TRANS("Trace saved to ") + chosenFile.getFullPathName());
+                else
+                    m_self->setStatusText(TRANS("Cannot save the trace to ") + chosenFile.getFullPathName());
+            }
+            m_fileChooserActive = false;
+        }
+    );
+}
+
 void YsfxIDEView::Impl::saveCurrentFile()
 {
     ysfx_t *fx = m_fx.get();
@@ -434,7 +511,7 @@ std::shared_ptr<YSFXCodeEditor> YsfxIDEView::Impl::addEditor()
         return false;
     };
 
-    m_editors.push_back(std::make_shared<YSFXCodeEditor>(m_tokenizer.get(), keyPressCallback, dblClickCallback));
+    m_editors.push_back(std::make_shared<YSFXCodeEditor>(m_tokenizer->getDefaultColourScheme(), keyPressCallback, dblClickCallback));
     m_self->addAndMakeVisible(m_editors.back()->getVisibleComponent());
     return m_editors.back();
 }
@@ -450,6 +527,18 @@ void YsfxIDEView::Impl::createUI()
     m_btnUpdate->setClickingTogglesState(true);
     m_btnUpdate->setToggleState(false, juce::NotificationType::dontSendNotification);
     m_self->addAndMakeVisible(*m_btnUpdate);
+    m_btnProfile.reset(new juce::TextButton(TRANS("Profile (off)")));
+    m_btnProfile->setTooltip("Enable this to show which lines take the time of the effect, in red. The effect is compiled again, and runs slower while this is on.");
+    m_btnProfile->setClickingTogglesState(true);
+    m_btnProfile->setToggleState(false, juce::NotificationType::dontSendNotification);
+    m_self->addAndMakeVisible(*m_btnProfile);
+
+    m_btnTrace.reset(new juce::TextButton(TRANS("Trace (off)")));
+    m_btnTrace->setTooltip("Enable this to record what the effects do on every thread, with their times. When it is turned off, the trace is saved into a file which Perfetto or the trace viewer of Chrome opens.");
+    m_btnTrace->setClickingTogglesState(true);
+    m_btnTrace->setToggleState(ysfx_is_tracing(), juce::NotificationType::dontSendNotification);
+    m_btnTrace->setButtonText(ysfx_is_tracing() ? TRANS("Trace (on)") : TRANS("Trace (off)"));
+    m_self->addAndMakeVisible(*m_btnTrace);
     m_lblVariablesHeading.reset(new juce::Label(juce::String{}, TRANS("Variables")));
     m_self->addAndMakeVisible(*m_lblVariablesHeading);
     m_searchBox.reset(new juce::TextEditor("search field"));
@@ -512,6 +601,28 @@ void YsfxIDEView::Impl::connectUI()
 {
     m_btnSave->onClick = [this]() { saveCurrentFile(); };
     m_btnUpdate->onClick = [this]() { m_btnUpdate->setButtonText(m_btnUpdate->getToggleState() ? TRANS("Watch (on)") : TRANS("Watch (off)")); };
+    m_btnProfile->onClick = [this]() {
+        bool enable = m_btnProfile->getToggleState();
+        m_btnProfile->setButtonText(enable ? TRANS("Profile (on)") : TRANS("Profile (off)"));
+        if (m_self->onLineProfilingChanged)
+            m_self->onLineProfilingChanged(enable);
+
+        if (enable) {
+            m_heatUpdateTimer.reset(FunctionalTimer::create([this]() { updateLineHeat(); }));
+            m_heatUpdateTimer->startTimer(500);
+        }
+        else {
+            m_heatUpdateTimer.reset();
+            updateLineHeat();
+        }
+    };
+    m_btnTrace->onClick = [this]() {
+        bool enable = m_btnTrace->getToggleState();
+        m_btnTrace->setButtonText(enable ? TRANS("Trace (on)") : TRANS("Trace (off)"));
+        ysfx_set_tracing(enable);
+        if (!enable)
+            saveTrace();
+    };
 }
 
 void YsfxIDEView::Impl::relayoutUI()
@@ -548,6 +659,8 @@ void YsfxIDEView::Impl::relayoutUI()
     temp = topRow.reduced(10, 10);
     m_btnSave->setBounds(temp.removeFromLeft(100));
     m_btnUpdate->setBounds(temp.removeFromLeft(100));
+    m_btnProfile->setBounds(temp.removeFromLeft(100));
+    m_btnTrace->setBounds(temp.removeFromLeft(100));
     
     ///
     temp = debugArea;
@@ -35,6 +35,8 @@ public:
 
     std::function<void(const juce::File &)> onFileSaved;
     std::function<void(const juce::File &)> onReloadRequested;
+    // the profiler of lines is toggled, which needs the effect compiled again
+    std::function<void(bool)> onLineProfilingChanged;
 
 protected:
     void resized() override;
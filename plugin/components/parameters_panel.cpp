@@ -62,6 +62,12 @@ private:
     //==============================================================================
     void timerCallback() override
     {
+        uint32_t quietChanges = parameter.getQuietChangeCount();
+        if (quietChanges != lastQuietChanges) {
+            lastQuietChanges = quietChanges;
+            parameterValueHasChanged = 1;
+        }
+
         if (parameterValueHasChanged.compareAndSetBool(0, 1)) {
             handleNewParameterValue();
             startTimerHz(50);
@@ -73,6 +79,7 @@ private:
 
     YsfxParameter &parameter;
     juce::Atomic<int> parameterValueHasChanged{0};
+    uint32_t lastQuietChanges = parameter.getQuietChangeCount();
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(YsfxParameterListener)
 };
@@ -443,37 +450,37 @@ YsfxParametersPanel::YsfxParametersPanel()
 
 YsfxParametersPanel::~YsfxParametersPanel()
 {
-    paramComponents.clear();
+    if (watchedParent)
+        watchedParent->removeComponentListener(this);
+    rows.clear();
 }
 
 void YsfxParametersPanel::setParametersDisplayed(const juce::Array<YsfxParameter *> &parameters)
 {
-    paramComponents.clear();
+    rows.clear();
+    displayedParameters.clearQuick();
 
     for (auto *param : parameters)
         if (param->isAutomatable())
-            addAndMakeVisible(paramComponents.add(
-                new YsfxParameterDisplayComponent(*param)));
+            displayedParameters.add(param);
 
-    int maxWidth = 800;
-
-    for (auto &comp : paramComponents) {
-        maxWidth = juce::jmax(maxWidth, comp->getWidth());
-    }
-
-    setSize(maxWidth, getRecommendedHeight());
+    // the size may stay the same, the rows are for the new parameters anyway
+    setSize(800, getRecommendedHeight());
+    updateVisibleRows();
 }
 
 int YsfxParametersPanel::getRecommendedHeight(int heightAtLeast) const
 {
-    int height = 0;
-
-    for (auto &comp : paramComponents)
-        height += comp->getHeight();
+    int height = displayedParameters.size() * getRowHeight();
 
     return juce::jmax(height, heightAtLeast);
 }
 
+int YsfxParametersPanel::getRowHeight() const
+{
+    return 20 + 2 * LOOKANDFEEL.m_gap;
+}
+
 void YsfxParametersPanel::paint(juce::Graphics &g)
 {
     g.fillAll(getLookAndFeel().findColour(juce::ResizableWindow::backgroundColourId));
@@ -481,8 +488,62 @@ void YsfxParametersPanel::paint(juce::Graphics &g)
 
 void YsfxParametersPanel::resized()
 {
-    auto area = getLocalBounds();
+    updateVisibleRows();
+}
+
+void YsfxParametersPanel::moved()
+{
+    // the viewport scrolls by moving us
+    updateVisibleRows();
+}
 
-    for (auto *comp : paramComponents)
-        comp->setBounds(area.removeFromTop(comp->getHeight()));
+void YsfxParametersPanel::parentHierarchyChanged()
+{
+    // the view gets larger or smaller with the parent, without resizing us
+    juce::Component *parent = getParentComponent();
+    if (watchedParent != parent) {
+        if (watchedParent)
+            watchedParent->removeComponentListener(this);
+        watchedParent = parent;
+        if (parent)
+            parent->addComponentListener(this);
+    }
+    updateVisibleRows();
+}
+
+void YsfxParametersPanel::componentMovedOrResized(juce::Component &component, bool wasMoved, bool wasResized)
+{
+    (void)component;
+    (void)wasMoved;
+    if (wasResized)
+        updateVisibleRows();
+}
+
+void YsfxParametersPanel::updateVisibleRows()
+{
+    juce::Rectangle<int> area = getLocalBounds();
+    if (juce::Component *parent = getParentComponent())
+        area = area.getIntersection(getLocalArea(parent, parent->getLocalBounds()));
+
+    const int rowHeight = getRowHeight();
+    const int count = displayedParameters.size();
+    const int first = juce::jlimit(0, count, area.getY() / rowHeight);
+    const int last = area.isEmpty() ? first : juce::jlimit(first, count, (area.getBottom() + rowHeight - 1) / rowHeight);
+
+    // the rows which are still in view are kept, with their controls as they are
+    for (auto it = rows.begin(); it != rows.end();) {
+        if (it->first < first || it->first >= last)
+            it = rows.erase(it);
+        else
+            ++it;
+    }
+
+    for (int index = first; index < last; ++index) {
+        std::unique_ptr<YsfxParameterDisplayComponent> &row = rows[index];
+        if (!row) {
+            row.reset(new YsfxParameterDisplayComponent(*displayedParameters[index]));
+            addAndMakeVisible(*row);
+        }
+        row->setBounds(0, index * rowHeight, getWidth(), rowHeight);
+    }
 }
@@ -20,10 +20,13 @@
 
 #pragma once
 #include <juce_audio_processors/juce_audio_processors.h>
+#include <map>
+#include <memory>
 class YsfxParameter;
 class YsfxParameterDisplayComponent;
 
-class YsfxParametersPanel : public juce::Component {
+// creates the rows only for the parameters in view, the viewport around it scrolls them in and out
+class YsfxParametersPanel : public juce::Component, private juce::ComponentListener {
 public:
     explicit YsfxParametersPanel();
     ~YsfxParametersPanel() override;
@@ -35,9 +38,17 @@ public:
 protected:
     void paint(juce::Graphics &g) override;
     void resized() override;
+    void moved() override;
+    void parentHierarchyChanged() override;
 
 private:
-    juce::OwnedArray<YsfxParameterDisplayComponent> paramComponents;
+    void componentMovedOrResized(juce::Component &component, bool wasMoved, bool wasResized) override;
+    void updateVisibleRows();
+    int getRowHeight() const;
+
+    juce::Array<YsfxParameter *> displayedParameters;
+    std::map<int, std::unique_ptr<YsfxParameterDisplayComponent>> rows;
+    juce::Component::SafePointer<juce::Component> watchedParent;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(YsfxParametersPanel)
 };
@@ -270,7 +270,7 @@ class LoadedBank : public juce::Component, public juce::DragAndDropContainer {
                             }
 
                             this->m_listBox->deselectAllRows();
-                            save_bank(m_file.getFullPathName().toStdString().c_str(), m_bank.get());
+                            save_bank(m_file.getFullPathName().toStdString().c_str(), m_bank);
                             if (m_bankUpdatedCallback) m_bankUpdatedCallback();
                         }
                     },
@@ -293,7 +293,7 @@ class LoadedBank : public juce::Component, public juce::DragAndDropContainer {
                         if (wantRename) {
                             m_bank.reset(ysfx_rename_preset_from_bank(m_bank.get(), currentPreset.c_str(), presetName.toStdString().c_str()));
                             this->m_listBox->deselectAllRows();
-                            save_bank(m_file.getFullPathName().toStdString().c_str(), m_bank.get());
+                            save_bank(m_file.getFullPathName().toStdString().c_str(), m_bank);
                             if (m_bankUpdatedCallback) m_bankUpdatedCallback();
                         }
                     },
@@ -384,7 +384,9 @@ class LoadedBank : public juce::Component, public juce::DragAndDropContainer {
                 bool alwaysAccept = force_accept;
                 bool shouldContinue = true;
                 if (result == 1) {
-                    m_bank.reset(ysfx_add_preset_to_bank(m_bank.get(), src_bank->presets[idx].name, src_bank->presets[idx].state));
+                    // the bank takes the state, so it gets a copy
+                    if (const ysfx_preset_t *preset = ysfx_bank_get_preset(src_bank.get(), idx))
+                        m_bank.reset(ysfx_add_preset_to_bank(m_bank.get(), preset->name, ysfx_state_dup(preset->state)));
                 } else if (result == 3) {
                     // Yes to all
                     alwaysAccept = true;
@@ -395,13 +397,13 @@ class LoadedBank : public juce::Component, public juce::DragAndDropContainer {
 
                 if (shouldContinue) {
                     if (indices.empty()) {
-                        save_bank(m_file.getFullPathName().toStdString().c_str(), m_bank.get());
+                        save_bank(m_file.getFullPathName().toStdString().c_str(), m_bank);
                         if (m_bankUpdatedCallback) m_bankUpdatedCallback();
                     } else {
                         this->transferPresetRecursive(indices, src_bank, alwaysAccept);
                     }
                 } else {
-                    save_bank(m_file.getFullPathName().toStdString().c_str(), m_bank.get());
+                    save_bank(m_file.getFullPathName().toStdString().c_str(), m_bank);
                     if (m_bankUpdatedCallback) m_bankUpdatedCallback();
                 }
             };
@@ -493,9 +495,8 @@ void YsfxRPLView::Impl::createUI()
     m_right.setLabelTooltip("Click to select preset file to import from");
     m_self->addAndMakeVisible(m_right);
 
-    juce::Timer *timer = FunctionalTimer::create([this]() { checkFileForModifications(); });
-    m_fileCheckTimer.reset(timer);
-    timer->startTimer(100);
+    // the files are only checked while the view is shown, see visibilityChanged
+    m_fileCheckTimer.reset(FunctionalTimer::create([this]() { checkFileForModifications(); }));
 }
 
 void YsfxRPLView::Impl::setupNewFx()
@@ -529,6 +530,16 @@ void YsfxRPLView::resized()
     m_impl->relayoutUILater();
 }
 
+void YsfxRPLView::visibilityChanged()
+{
+    if (isVisible()) {
+        m_impl->checkFileForModifications();
+        m_impl->m_fileCheckTimer->startTimer(250);
+    }
+    else
+        m_impl->m_fileCheckTimer->stopTimer();
+}
+
 void YsfxRPLView::focusOnPresetViewer()
 {
 }
@@ -31,6 +31,7 @@ public:
 
 protected:
     void resized() override;
+    void visibilityChanged() override;
 
 private:
     struct Impl;
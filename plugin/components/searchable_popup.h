@@ -2,6 +2,8 @@
 #include <set>
 #include <map>
 #include <vector>
+#include <string>
+#include <cstdint>
 #include <juce_gui_basics/juce_gui_basics.h>
 
 /*
@@ -103,6 +105,9 @@
                     juce::String label;
                     juce::PopupMenu::Item* popup_menu_item = nullptr;
                     MenuTree* menu;
+                    // the index of the search, built once the labels are final
+                    std::u32string folded;
+                    uint64_t char_mask = 0;
                 };
 
                 std::vector<QuickSearchItem> quick_search_items;
@@ -173,6 +178,7 @@
                     creation_time = juce::Time::getCurrentTime();
                     readPopupMenuItems (menu_tree, m_owner->menu);
                     handleDuplicatedLabels();
+                    buildSearchIndex();
 
                     /* compute the width and item height */
                     juce::String longest_string;
@@ -343,6 +349,33 @@
                     }
                 }
 
+                static juce::juce_wchar foldChar (juce::juce_wchar c) { return juce::CharacterFunctions::toLowerCase (c); }
+                static uint64_t charBit (juce::juce_wchar c) { return (uint64_t) 1 << ((uint32_t) c & 63); }
+
+                static std::u32string foldString (const juce::String& str, uint64_t* mask)
+                {
+                    std::u32string folded;
+                    folded.reserve ((size_t) str.length());
+                    for (auto p = str.getCharPointer(); ! p.isEmpty();)
+                    {
+                        auto c = foldChar (p.getAndAdvance());
+                        folded.push_back ((char32_t) c);
+                        *mask |= charBit (c);
+                    }
+                    return folded;
+                }
+
+                // the labels are folded once, and each keeps the set of its characters: a label
+                // cannot match if it lacks one of the characters of the search
+                void buildSearchIndex()
+                {
+                    for (auto& q : quick_search_items)
+                    {
+                        q.char_mask = 0;
+                        q.folded = foldString (q.label, &q.char_mask);
+                    }
+                }
+
                 // decide the orientation and dimensions of the QuickSearchComponent
                 juce::Rectangle<int> getBestBounds (int total_h)
                 {
@@ -443,21 +476,23 @@
 
                 const int no_match_score = -1000000;
 
-                // give a score for the match between searched string 'needle' and 'str'
-                int evalMatchScore (juce::String str, const juce::String& needle)
+                // give a score for the match between searched string 'needle' and 'str', both folded
+                int evalMatchScore (std::u32string str, const std::u32string& needle)
                 {
-                    if (needle.isEmpty())
+                    if (needle.empty())
                         return 0;
 
+                    const int needle_length = (int) needle.size();
+                    const int str_length = (int) str.size();
                     int score = 0;
                     int old_best_j = -1;
-                    for (int i = 0; i < needle.length();)
+                    for (int i = 0; i < needle_length;)
                     {
                         int best_j = -1, best_len = 0;
-                        for (int j = 0; j < str.length(); ++j)
+                        for (int j = 0; j < str_length; ++j)
                         {
                             int len = 0;
-                            while (i + len < needle.length() && j + len < str.length() && juce::CharacterFunctions::compareIgnoreCase (str[j + len], needle[i + len]) == 0)
+                            while (i + len < needle_length && j + len < str_length && str[(size_t) (j + len)] == needle[(size_t) (i + len)])
                             {
                                 ++len;
                             }
@@ -471,13 +506,13 @@
                             return no_match_score; // char not found ! no need to continue
                         score +=
                             (best_len == 1 ? 1 : (best_len * best_len + 1)); // boost for matches of more that one char
-                        if ((best_len == 1 && str[best_j] != ' ') || best_j < old_best_j)
+                        if ((best_len == 1 && str[(size_t) best_j] != ' ') || best_j < old_best_j)
                         {
                             score -= 100;
                         }
-                        str = str.replaceSection (
-                            best_j, best_len,
-                            "\t"); // mark these characters are 'done' , so that 'xxxx' does not match 'x'
+                        str.replace (
+                            (size_t) best_j, (size_t) best_len,
+                            U"\t"); // mark these characters are 'done' , so that 'xxxx' does not match 'x'
                         old_best_j = best_j;
                         i += std::max (1, best_len);
                     }
@@ -487,7 +522,8 @@
                 // get the the list of best matches, sorted by decreasing score
                 void updateMatches()
                 {
-                    juce::String needle = editor.getText();
+                    uint64_t needle_mask = 0;
+                    std::u32string needle = foldString (editor.getText(), &needle_mask);
                     auto old_matches = matches;
                     matches.resize (0);
 
@@ -497,7 +533,11 @@
                     {
                         auto& q = quick_search_items[idx];
 
-                        scores[idx] = evalMatchScore (q.label, needle);
+                        // the ones which lack a character of the search would not match anyway
+                        if ((needle_mask & ~q.char_mask) != 0)
+                            continue;
+
+                        scores[idx] = evalMatchScore (q.folded, needle);
                         if (! q.popup_menu_item->isEnabled)
                             scores[idx] -= 10000;
                         matches.push_back (idx);
@@ -18,6 +18,11 @@ void JSFXTokenizer::setColours(std::map<std::string, std::array<uint8_t, 3>> col
         m_colourScheme.set(key, juce::Colour(colormap[key][0], colormap[key][1], colormap[key][2]));
 }
 
+void JSFXTokenizer::setColourScheme(const juce::CodeEditorComponent::ColourScheme &colourScheme)
+{
+    m_colourScheme = colourScheme;
+}
+
 juce::CodeEditorComponent::ColourScheme JSFXTokenizer::getDefaultColourScheme()
 {
     return m_colourScheme;
@@ -25,5 +30,21 @@ juce::CodeEditorComponent::ColourScheme JSFXTokenizer::getDefaultColourScheme()
 
 int JSFXTokenizer::readNextToken (juce::CodeDocument::Iterator& source)
 {
-    return JSFXTokenizerFunctions::readNextJSFXToken(source);
+    // only a token which ends a line can leave a block comment open, so the state
+    //   is looked up only when a token starts a line
+    const int line = source.getLine();
+    const bool atLineStart = source.getPosition() == 0 || source.peekPreviousChar() == '\n';
+    bool inComment = atLineStart && (size_t)line < m_lineInComment.size() && m_lineInComment[(size_t)line];
+
+    int token = JSFXTokenizerFunctions::readNextJSFXToken(source, inComment);
+
+    const int endLine = source.getLine();
+    if (endLine != line) {
+        if (m_lineInComment.size() <= (size_t)endLine)
+            m_lineInComment.resize((size_t)endLine + 1);
+        std::fill(m_lineInComment.begin() + line + 1, m_lineInComment.begin() + endLine, (uint8_t)0);
+        m_lineInComment[(size_t)endLine] = inComment;
+    }
+
+    return token;
 }
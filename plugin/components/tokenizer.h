@@ -1,6 +1,9 @@
+#pragma once
 #include <vector>
 #include <array>
+#include <map>
 #include <string>
+#include <cstdint>
 #include <juce_gui_extra/juce_gui_extra.h>
 
 class JSFXTokenizer : public juce::CPlusPlusCodeTokeniser
@@ -8,6 +11,7 @@ class JSFXTokenizer : public juce::CPlusPlusCodeTokeniser
     public:
         JSFXTokenizer();
         void setColours(std::map<std::string, std::array<uint8_t, 3>> colormap);
+        void setColourScheme(const juce::CodeEditorComponent::ColourScheme &colourScheme);
         juce::CodeEditorComponent::ColourScheme getDefaultColourScheme() override;
 
         /** The token values returned by this tokeniser. */
@@ -34,4 +38,8 @@ class JSFXTokenizer : public juce::CPlusPlusCodeTokeniser
     private:
         int readNextToken(juce::CodeDocument::Iterator& source) override;
         juce::CodeEditorComponent::ColourScheme m_colourScheme;
+
+        // whether each line starts inside a block comment; the editor tokenizes the lines in
+        //   order from the places it caches, so each entry is written before it is read again
+        std::vector<uint8_t> m_lineInComment;
 };
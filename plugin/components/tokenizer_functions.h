@@ -12,7 +12,7 @@ namespace JSFXTokenizerFunctions {
         static const char* const keywords2Char[] = { nullptr };
         static const char* const keywords3Char[] = { nullptr };
         static const char* const keywords4Char[] = { "@gfx", "desc", "tags", nullptr };
-        static const char* const keywords5Char[] = { "@init", nullptr };
+        static const char* const keywords5Char[] = { "@init", "@midi", nullptr };
         static const char* const keywords6Char[] = { "@block", "import", "in_pin", nullptr };
         static const char* const keywords7Char[] = { "@sample", "@slider", "out_pin", "options", nullptr };
         static const char* const keywords8Char[] = { nullptr };
@@ -110,7 +110,7 @@ namespace JSFXTokenizerFunctions {
         static const char* const keywords8Char[] = { "fft_real", "file_mem", "file_var", "freembuf", "gfx_blit", "gfx_line", "gfx_rect", "midirecv", "midisend", "strnicmp", nullptr };
         static const char* const keywords9Char[] = { "file_open", "file_riff", "file_text", "ifft_real", "stack_pop", nullptr };
         static const char* const keywords10Char[] = { "atomic_add", "atomic_get", "atomic_set", "convolve_c", "file_avail", "file_close", "gfx_blurto", "gfx_circle", "gfx_lineto", "gfx_printf", "gfx_rectto", "stack_exch", "stack_peek", "stack_push", nullptr };
-        static const char* const keywordsOther[] = { "atomic_exch", "atomic_setifequal", "fft_permute", "file_rewind", "file_string", "gfx_blitext", "gfx_deltablit", "gfx_drawchar", "gfx_drawnumber", "gfx_drawstr", "gfx_getchar", "gfx_getfont", "gfx_getimgdim", "gfx_getpixel", "gfx_gradrect", "gfx_loadimg", "gfx_measurestr", "gfx_muladdrect", "gfx_roundrect", "gfx_setcursor", "gfx_setfont", "gfx_setimgdim", "gfx_setpixel", "gfx_showmenu", "gfx_transformblit", "gfx_triangle", "ifft_permute", "mem_get_values", "mem_insert_shuffle", "mem_multiply_sum", "mem_set_values", "midirecv_buf", "midirecv_str", "midisend_buf", "midisend_str", "slider_automate", "slider_next_chg", "slider_show", "sliderchange", "str_getchar", "str_setchar", "strcpy_from", "strcpy_fromslider", "strcpy_substr", nullptr };
+        static const char* const keywordsOther[] = { "atomic_exch", "atomic_setifequal", "fft_permute", "file_rewind", "file_string", "gfx_blitext", "gfx_deltablit", "gfx_drawchar", "gfx_drawnumber", "gfx_drawstr", "gfx_getchar", "gfx_getfont", "gfx_getimgdim", "gfx_getpixel", "gfx_gradrect", "gfx_loadimg", "gfx_measurestr", "gfx_muladdrect", "gfx_roundrect", "gfx_setcursor", "gfx_setfont", "gfx_setimgdim", "gfx_setpixel", "gfx_showmenu", "gfx_transformblit", "gfx_triangle", "ifft_permute", "mem_get_values", "mem_insert_shuffle", "mem_multiply_sum", "mem_set_values", "midirecv_buf", "midirecv_str", "midirecv_ump", "midisend_buf", "midisend_str", "midisend_ump", "slider_automate", "slider_next_chg", "slider_show", "sliderchange", "str_getchar", "str_setchar", "strcpy_from", "strcpy_fromslider", "strcpy_substr", nullptr };
         const char* const* k;
 
         switch (tokenLength)
@@ -242,9 +242,35 @@ namespace JSFXTokenizerFunctions {
         return JSFXTokenizer::tokenType_error;
     }
 
+    // reads a block comment up to its end, or up to the end of its line; true if it ended
     template <typename Iterator>
-    static int readNextJSFXToken (Iterator& source)
+    static bool skipBlockCommentInLine(Iterator& source)
     {
+        const int line = source.getLine();
+
+        while (!source.isEOF()) {
+            auto c = source.nextChar();
+
+            if (c == '*' && source.peekNextChar() == '/') {
+                source.skip();
+                return true;
+            }
+            if (source.getLine() != line)
+                return false;
+        }
+
+        return false;
+    }
+
+    // a block comment is read a line at a time, inBlockComment tells if one goes on at the start
+    template <typename Iterator>
+    static int readNextJSFXToken (Iterator& source, bool& inBlockComment)
+    {
+        if (inBlockComment) {
+            inBlockComment = !JSFXTokenizerFunctions::skipBlockCommentInLine(source);
+            return JSFXTokenizer::tokenType_comment;
+        }
+
         source.skipWhitespace();
         auto firstChar = source.peekNextChar();
 
@@ -346,7 +372,7 @@ namespace JSFXTokenizerFunctions {
                 // This is a poor workaround for dealing with paths that have /* in them in the header.
                 if (!juce::CharacterFunctions::isLetter(previousChar)) {
                     source.skip();
-                    juce::CppTokeniserFunctions::skipComment(source);
+                    inBlockComment = !JSFXTokenizerFunctions::skipBlockCommentInLine(source);
                     return JSFXTokenizer::tokenType_comment;
                 } else {
                     return JSFXTokenizer::tokenType_operator;
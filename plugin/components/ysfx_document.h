@@ -20,8 +20,11 @@
 
 #pragma once
 #include "dialogs.h"
+#include "tokenizer.h"
 #include <juce_gui_basics/juce_gui_basics.h>
 #include <juce_gui_extra/juce_gui_extra.h>
+#include <algorithm>
+#include <vector>
 
 
 class YSFXCodeDocument : public juce::CodeDocument {
@@ -53,6 +56,34 @@ class CodeEditor : public juce::CodeEditorComponent
         CodeEditor(
             juce::CodeDocument& doc, juce::CodeTokeniser* tokenizer, std::function<bool(const juce::KeyPress&)> keyPressCallback, std::function<bool(int x, int y)> dblClickCallback
         ) : CodeEditorComponent(doc, tokenizer), m_keyPressCallback{keyPressCallback}, m_dblClickCallback{dblClickCallback} {}
+
+        // the share of the samples of the profiler which each line has, from 0 to 1; empty to hide
+        void setLineHeat(std::vector<float> heat)
+        {
+            m_lineHeat = std::move(heat);
+            repaint();
+        }
+
+        void paintOverChildren(juce::Graphics &g) override
+        {
+            if (m_lineHeat.empty()) return;
+
+            const int lineHeight = getLineHeight();
+            const int first = getFirstLineOnScreen();
+            const int last = std::min<int>(first + getNumLinesOnScreen() + 1, (int)m_lineHeat.size());
+            for (int line = first; line < last; ++line) {
+                float heat = m_lineHeat[(size_t)line];
+                if (heat <= 0.0f) continue;
+                g.setColour(juce::Colours::red.withAlpha(0.06f + 0.30f * heat));
+                g.fillRect(0, (line - first) * lineHeight, getWidth(), lineHeight);
+            }
+        }
+
+        void editorViewportPositionChanged() override
+        {
+            juce::CodeEditorComponent::editorViewportPositionChanged();
+            if (!m_lineHeat.empty()) repaint();
+        }
         
         bool keyPressed(const juce::KeyPress &key) override 
         {
@@ -120,16 +151,20 @@ class CodeEditor : public juce::CodeEditorComponent
     private:
         std::function<bool(const juce::KeyPress&)> m_keyPressCallback;
         std::function<bool(int x, int y)> m_dblClickCallback;
+        std::vector<float> m_lineHeat;
 };
 
 
 class YSFXCodeEditor : public juce::CodeDocument::Listener
 {
     public:
-        YSFXCodeEditor(juce::CodeTokeniser* tokenizer, std::function<bool(const juce::KeyPress&)> keyPressCallback, std::function<bool(int x, int y)> dblClickCallback) {
+        YSFXCodeEditor(juce::CodeEditorComponent::ColourScheme colourScheme, std::function<bool(const juce::KeyPress&)> keyPressCallback, std::function<bool(int x, int y)> dblClickCallback) {
             m_document = std::make_unique<YSFXCodeDocument>();
             m_document->addListener(this);
-            m_editor = std::make_unique<CodeEditor>(*m_document, tokenizer, keyPressCallback, dblClickCallback);
+            // the tokenizer caches the state of the lines, so each document has its own
+            m_tokenizer = std::make_unique<JSFXTokenizer>();
+            m_tokenizer->setColourScheme(colourScheme);
+            m_editor = std::make_unique<CodeEditor>(*m_document, m_tokenizer.get(), keyPressCallback, dblClickCallback);
             m_editor->setVisible(false);
         }
         ~YSFXCodeEditor() override {
@@ -177,6 +212,7 @@ class YSFXCodeEditor : public juce::CodeDocument::Listener
         }
 
         juce::String getLineAt(int x, int y) const { return m_editor->getLineAt(x, y); }
+        void setLineHeat(std::vector<float> heat) { m_editor->setLineHeat(std::move(heat)); }
         CodeEditor* getVisibleComponent() { return m_editor.get(); }
 
         void setVisible(bool visible) { m_editor->setVisible(visible); }
@@ -184,6 +220,7 @@ class YSFXCodeEditor : public juce::CodeDocument::Listener
         void setBounds(T&& arg) { m_editor->setBounds(std::forward<T>(arg)); }
 
     private:
+        std::unique_ptr<JSFXTokenizer> m_tokenizer;
         std::unique_ptr<CodeEditor> m_editor;
         std::unique_ptr<YSFXCodeDocument> m_document;
         bool m_modified{false};
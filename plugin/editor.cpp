@@ -37,7 +37,7 @@
 #include <iostream>
 #include <cmath>
 
-struct YsfxEditor::Impl {
+struct YsfxEditor::Impl : public better::AsyncUpdater::Listener {
     YsfxEditor *m_self = nullptr;
     YsfxProcessor *m_proc = nullptr;
     YsfxInfo::Ptr m_info;
@@ -45,21 +45,23 @@ struct YsfxEditor::Impl {
     ysfx_bank_shared m_bank;
     std::unique_ptr<juce::AlertWindow> m_editDialog;
     std::unique_ptr<juce::AlertWindow> m_modalAlert;
-    std::unique_ptr<juce::Timer> m_infoTimer;
     std::unique_ptr<juce::Timer> m_relayoutTimer;
     std::unique_ptr<juce::Timer> m_undoTimer;
+    std::unique_ptr<juce::Timer> m_loadTimer;
     std::unique_ptr<juce::FileChooser> m_fileChooser;
     std::unique_ptr<juce::PopupMenu> m_recentFilesPopup;
     std::unique_ptr<juce::PopupMenu> m_recentFilesOptsPopup;
     std::unique_ptr<juce::PopupMenu> m_recentFilesOptsSubmenuPopup;
     std::unique_ptr<juce::PopupMenu> m_presetsPopup;
     std::unique_ptr<juce::PopupMenu> m_presetsOptsPopup;
+    std::unique_ptr<juce::PopupMenu> m_renderScalePopup;
     std::unique_ptr<juce::PropertiesFile> m_pluginProperties;
     bool m_fileChooserActive = false;
     bool m_mustResizeToGfx = true;
     bool m_maintainState = false;
     int m_keepUndoState{1};
     int m_softwareRenderer{0};
+    int m_gpuPresentation{0};
     WindowBehaviour m_windowBehaviour{WindowBehaviour::alwaysOnTop};
     float m_currentScaling{1.0f};
     uint64_t m_sliderVisible[ysfx_max_slider_groups]{0};
@@ -70,12 +72,16 @@ struct YsfxEditor::Impl {
     //==========================================================================
     void updateInfo();
     void grabInfoAndUpdate();
+    void handleAsyncUpdate(better::AsyncUpdater *updater) override;
+    void checkScaling();
+    void updateLoadStats();
     void chooseFileAndLoad();
     void loadFile(const juce::File &file, bool keepState);
     void popupRecentFiles();
     void popupRecentOpts();
     void popupPresets();
     void popupPresetOptions();
+    void popupRenderScale();
     void switchEditor(bool showGfx);
     void openCodeEditor();
     void openPresetWindow();
@@ -86,6 +92,7 @@ struct YsfxEditor::Impl {
     void saveRecentFiles(const juce::RecentlyOpenedFilesList &recent);
     void clearRecentFiles();
     void setScale(float newScaling);
+    void setRenderScale(float newScale);
     void loadScaling();
     void saveScaling();
     void resetScaling(const juce::File &jsfxFilePath);
@@ -152,6 +159,7 @@ struct YsfxEditor::Impl {
     std::unique_ptr<juce::TextButton> m_btnUndo;
     std::unique_ptr<juce::TextButton> m_btnRedo;
     std::unique_ptr<juce::TextButton> m_btnGfxScaling;
+    std::unique_ptr<juce::TextButton> m_btnGfxScalingOpts;
 
     std::unique_ptr<juce::Label> m_lblFilePath;
     std::unique_ptr<juce::Label> m_lblIO;
@@ -296,6 +304,7 @@ void YsfxEditor::paint (juce::Graphics& g)
 YsfxEditor::~YsfxEditor()
 {
     if (m_impl) {
+        m_impl->m_proc->removeEditorListener(m_impl.get());
         m_impl->saveScaling();
     }
 }
@@ -362,11 +371,6 @@ void YsfxEditor::Impl::grabInfoAndUpdate()
     YsfxCurrentPresetInfo::Ptr presetInfo = m_proc->getCurrentPresetInfo();
     ysfx_bank_shared bank = m_proc->getCurrentBank();
 
-    if (std::abs(m_graphicsView->getTotalScaling() - m_currentScaling) > 1e-6) {
-        relayoutUILater();
-        m_currentScaling = m_graphicsView->getTotalScaling();
-    }
-
     if (m_currentPresetInfo != presetInfo) {
         m_currentPresetInfo = presetInfo;
     }
@@ -377,7 +381,8 @@ void YsfxEditor::Impl::grabInfoAndUpdate()
         relayoutUI();
     }
     
-    if (m_info != info) {
+    bool infoChanged = m_info != info;
+    if (infoChanged) {
         m_info = info;
         updateInfo();
         m_btnLoadFile->setButtonText(TRANS("Load"));
@@ -391,7 +396,8 @@ void YsfxEditor::Impl::grabInfoAndUpdate()
     for (uint8_t i = 0; i < ysfx_max_slider_groups; i++) {
         ysfx_t *fx = m_info.get()->effect.get();
 
-        if (fx) {
+        // read the visibility again only if it changed, or if it is another effect
+        if (fx && (ysfx_fetch_slider_visibility_changes(fx, i) || infoChanged)) {
             uint64_t newValue = ysfx_get_slider_visibility(fx, i);
             if (newValue != m_sliderVisible[i]) {
                 m_sliderVisible[i] = newValue;
@@ -410,6 +416,47 @@ void YsfxEditor::Impl::grabInfoAndUpdate()
     }
 }
 
+void YsfxEditor::Impl::handleAsyncUpdate(better::AsyncUpdater *updater)
+{
+    (void)updater;
+    grabInfoAndUpdate();
+}
+
+void YsfxEditor::Impl::checkScaling()
+{
+    if (std::abs(m_graphicsView->getTotalScaling() - m_currentScaling) > 1e-6) {
+        relayoutUILater();
+        m_currentScaling = m_graphicsView->getTotalScaling();
+    }
+}
+
+void YsfxEditor::Impl::updateLoadStats()
+{
+    YsfxInfo *info = m_info.get();
+    ysfx_t *fx = info ? info->effect.get() : nullptr;
+    if (!fx) {
+        m_lblIO->setTooltip(juce::String{});
+        return;
+    }
+
+    // the load is the time of a cycle, for the duration of its frames
+    ysfx_deadline_stats_t stats{};
+    ysfx_get_deadline_stats(fx, &stats);
+    auto percent = [](double load) { return juce::String(load * 100, 0) + "%"; };
+    juce::String text;
+    double recentLoad = 0, recentPeak = 0;
+    ysfx_get_cpu_load(fx, &recentLoad, &recentPeak);
+    text << TRANS("Recent load") << ": " << percent(recentLoad) << ", " << percent(recentPeak) << " " << TRANS("at peak") << "\n";
+    text << TRANS("Load of the processing") << ": " << percent(stats.p50_load) << " " << TRANS("median") << ", "
+         << percent(stats.p99_load) << " " << TRANS("at 99%") << ", " << percent(stats.max_load) << " " << TRANS("at most") << "\n"
+         << TRANS("Missed deadlines") << ": " << juce::String((juce::int64)stats.misses) << " / " << juce::String((juce::int64)stats.cycles);
+    m_lblIO->setTooltip(text);
+
+    // a deadline which was missed remains marked until the statistics are reset
+    juce::Colour textColour = m_self->findColour(juce::Label::textColourId);
+    m_lblIO->setColour(juce::Label::textColourId, stats.misses > 0 ? juce::Colours::orangered : textColour);
+}
+
 void YsfxEditor::Impl::updateInfo()
 {
     YsfxInfo *info = m_info.get();
@@ -617,6 +664,12 @@ void YsfxEditor::Impl::loadScaling()
                 setScale(1.0f);
             }
 
+            key = getKey("_render_scale");
+            if (m_pluginProperties->containsKey(key))
+                setRenderScale(m_pluginProperties->getValue(key).getFloatValue());
+            else
+                setRenderScale(1.0f);
+
             int width = m_pluginProperties->getValue(getKey("_width")).getIntValue();
             int height = m_pluginProperties->getValue(getKey("_height")).getIntValue();
             if (width && height) {
@@ -705,6 +758,36 @@ void YsfxEditor::Impl::popupRecentOpts()
     });
 }
 
+void YsfxEditor::Impl::popupRenderScale()
+{
+    m_renderScalePopup.reset(new juce::PopupMenu);
+
+    // the resolution of @gfx, which trades the sharpness for the processor time
+    const float scales[] = {0.5f, 1.0f, 2.0f};
+    const float current = m_graphicsView->getRenderScale();
+    m_renderScalePopup->addSectionHeader(TRANS("Render resolution"));
+    for (int i = 0; i < 3; ++i)
+        m_renderScalePopup->addItem(i + 1, juce::String::formatted("x%g", scales[i]), true, current == scales[i]);
+
+    juce::PopupMenu::Options popupOptions = juce::PopupMenu::Options{}
+        .withTargetComponent(*m_btnGfxScalingOpts);
+
+    m_renderScalePopup->showMenuAsync(popupOptions, [this, scales](int index) {
+        if (index < 1 || index > 3)
+            return;
+
+        float newScale = scales[index - 1];
+        setRenderScale(newScale);
+
+        juce::String key = getJsfxName() + juce::String("_render_scale");
+        {
+            juce::ScopedLock lock{m_pluginProperties->getLock()};
+            m_pluginProperties->setValue(key, juce::String::formatted("%.3f", newScale));
+            m_pluginProperties->save();
+        }
+    });
+}
+
 void YsfxEditor::Impl::popupPresetOptions()
 {
     m_presetsOptsPopup.reset(new juce::PopupMenu);
@@ -968,6 +1051,12 @@ void YsfxEditor::Impl::initializeProperties()
             m_pluginProperties->setNeedsToBeSaved(true);
         }
 
+        // the changes are only polled for undo points if it is enabled
+        if (m_keepUndoState == 2) {
+            m_undoTimer.reset(FunctionalTimer::create([this]() { m_proc->checkForUndoableChanges(); }));
+            m_undoTimer->startTimer(500);
+        }
+
         auto sw_key = juce::String("ysfx_force_software_rendering");
         if (m_pluginProperties->containsKey(sw_key)) {
             m_softwareRenderer = m_pluginProperties->getIntValue(sw_key);
@@ -976,6 +1065,15 @@ void YsfxEditor::Impl::initializeProperties()
             m_pluginProperties->setNeedsToBeSaved(true);
         }
 
+        // presents @gfx through an OpenGL texture, which the GPU scales
+        auto gpu_key = juce::String("ysfx_gpu_gfx_presentation");
+        if (m_pluginProperties->containsKey(gpu_key)) {
+            m_gpuPresentation = m_pluginProperties->getIntValue(gpu_key);
+        } else {
+            m_pluginProperties->setValue(gpu_key, juce::var{0});
+            m_pluginProperties->setNeedsToBeSaved(true);
+        }
+
         auto windowBehaviour = juce::String("ysfx_sub_window_stay_on_top");
         if (m_pluginProperties->containsKey(windowBehaviour)) {
             m_windowBehaviour = static_cast<WindowBehaviour>(m_pluginProperties->getIntValue(windowBehaviour));
@@ -984,6 +1082,8 @@ void YsfxEditor::Impl::initializeProperties()
             m_pluginProperties->setNeedsToBeSaved(true);
         }
     }
+
+    m_graphicsView->setGpuPresentation(m_gpuPresentation && !m_softwareRenderer);
 }
 
 void YsfxEditor::Impl::createUI()
@@ -1003,6 +1103,9 @@ void YsfxEditor::Impl::createUI()
     m_btnGfxScaling.reset(new juce::TextButton(TRANS("x1")));
     m_self->addAndMakeVisible(*m_btnGfxScaling);
     m_btnGfxScaling->setTooltip("Render JSFX UI at lower resolution and upscale the result. Ths is intended for JSFX that do not implement scaling themselves. For JSFX that do, it is better to simply resize the plugin.");
+    m_btnGfxScalingOpts.reset(new juce::TextButton(TRANS(juce::CharPointer_UTF8("\xe2\x96\xBC"))));
+    m_self->addAndMakeVisible(*m_btnGfxScalingOpts);
+    m_btnGfxScalingOpts->setTooltip("Set the resolution which the JSFX UI renders at, independently of the scaling. A lower resolution costs less processor time on high density displays.");
     m_btnLoadPreset.reset(new juce::TextButton(TRANS("Preset")));
     m_self->addAndMakeVisible(*m_btnLoadPreset);
     m_btnPresetOpts.reset(new juce::TextButton(TRANS(juce::CharPointer_UTF8("\xe2\x96\xBC"))));
@@ -1021,6 +1124,8 @@ void YsfxEditor::Impl::createUI()
     m_lblIO->setJustificationType(juce::Justification::horizontallyCentred);
     m_lblIO->setColour(juce::Label::outlineColourId, m_self->findColour(juce::ComboBox::outlineColourId));
     m_self->addAndMakeVisible(*m_lblIO);
+    m_loadTimer.reset(FunctionalTimer::create([this]() { updateLoadStats(); }));
+    m_loadTimer->startTimer(1000);
     m_centerViewPort.reset(new juce::Viewport);
     m_centerViewPort->setScrollBarsShown(true, false);
     m_self->addAndMakeVisible(*m_centerViewPort);
@@ -1053,6 +1158,12 @@ void YsfxEditor::Impl::setScale(float newScaling)
     m_btnGfxScaling->setButtonText(TRANS(juce::String::formatted("%.1f", newScaling)));
 }
 
+void YsfxEditor::Impl::setRenderScale(float newScale)
+{
+    newScale = (newScale == 0.5f || newScale == 2.0f) ? newScale : 1.0f;
+    m_graphicsView->setRenderScale(newScale);
+}
+
 void YsfxEditor::Impl::connectUI()
 {
     m_btnLoadFile->onClick = [this]() { chooseFileAndLoad(); };
@@ -1062,6 +1173,7 @@ void YsfxEditor::Impl::connectUI()
     m_btnEditCode->onClick = [this]() { openCodeEditor(); };
     m_btnLoadPreset->onClick = [this]() { popupPresets(); };
     m_btnPresetOpts->onClick = [this]() { popupPresetOptions(); };
+    m_btnGfxScalingOpts->onClick = [this]() { popupRenderScale(); };
     m_btnReload->onClick = [this] {
         YsfxInfo::Ptr info = m_info;
         ysfx_t *fx = info->effect.get();
@@ -1100,20 +1212,34 @@ void YsfxEditor::Impl::connectUI()
 
     m_ideView->onFileSaved = [this](const juce::File &file) { 
         saveScaling();
-        loadFile(file, true);
+
+        // saving the current effect swaps its code, keeping the state if possible
+        YsfxInfo::Ptr info = m_proc->getCurrentInfo();
+        if (info && info->mainFile == file) {
+            m_maintainState = true;
+            m_proc->reloadJsfxCode(file.getFullPathName());
+            relayoutUILater();
+        }
+        else
+            loadFile(file, true);
     };
 
-    m_infoTimer.reset(FunctionalTimer::create([this]() { grabInfoAndUpdate(); }));
-    m_infoTimer->startTimer(100);
-    
-    m_undoTimer.reset(
-        FunctionalTimer::create(
-            [this]() {
-                if (m_keepUndoState == 2) m_proc->checkForUndoableChanges();
-            }
-        )
-    );
-    m_undoTimer->startTimer(500);
+    m_ideView->onLineProfilingChanged = [this](bool enable) {
+        m_proc->setLineProfiling(enable);
+
+        // compile the current effect again, keeping its state
+        YsfxInfo::Ptr info = m_proc->getCurrentInfo();
+        if (info && info->mainFile.existsAsFile()) {
+            m_maintainState = true;
+            m_proc->reloadJsfxCode(info->mainFile.getFullPathName());
+        }
+    };
+
+    m_graphicsView->onScalingChanged = [this]() { checkScaling(); };
+
+    // the processor tells when there is something to update, no need to poll it
+    m_proc->addEditorListener(this);
+    grabInfoAndUpdate();
 }
 
 void YsfxEditor::Impl::relayoutUI()
@@ -1161,6 +1287,7 @@ void YsfxEditor::Impl::relayoutUI()
     temp.removeFromRight(spacing);
     m_btnEditCode->setBounds(temp.removeFromRight(60));
     temp.removeFromRight(spacing);
+    m_btnGfxScalingOpts->setBounds(temp.removeFromRight(25));
     m_btnGfxScaling->setBounds(temp.removeFromRight(40));
     temp.removeFromRight(spacing);
 
@@ -26,12 +26,13 @@ struct YsfxCurrentPresetInfo : public std::enable_shared_from_this<YsfxCurrentPr
 };
 
 struct YsfxInfo : public std::enable_shared_from_this<YsfxInfo> {
-    ysfx_u effect;
     juce::Time timeStamp;
     juce::StringArray errors;
     juce::StringArray warnings;
     juce::String m_name;
     juce::File mainFile;
+    // the last, to be released first, since its log reports into the above
+    ysfx_u effect;
 
     using Ptr = std::shared_ptr<YsfxInfo>;
 };
@@ -40,6 +40,8 @@ void YsfxParameter::setEffect(ysfx_t *fx)
             m_displayName = juce::String(ysfx_slider_get_name(fx, static_cast<uint32_t>(m_sliderIndex)));
         }
     }
+
+    invalidateTextCache();
 }
 
 bool YsfxParameter::existsAsSlider() const
@@ -147,6 +149,26 @@ bool YsfxParameter::wasUpdatedByHost() {
 }
 
 juce::String YsfxParameter::getText(float normalisedValue, int) const
+{
+    // NOTE: hosts poll this a lot for the same value, so keep the last
+    //    result; the key is the normalized value, which quantizes the text
+    std::shared_ptr<const TextCacheEntry> cached = std::atomic_load(&m_textCache);
+    if (cached && cached->normValue == normalisedValue)
+        return cached->text;
+
+    auto entry = std::make_shared<TextCacheEntry>();
+    entry->normValue = normalisedValue;
+    entry->text = formatText(normalisedValue);
+    std::atomic_store(&m_textCache, std::shared_ptr<const TextCacheEntry>{entry});
+    return entry->text;
+}
+
+void YsfxParameter::invalidateTextCache()
+{
+    std::atomic_store(&m_textCache, std::shared_ptr<const TextCacheEntry>{});
+}
+
+juce::String YsfxParameter::formatText(float normalisedValue) const
 {
     ysfx_real actualValue = convertToYsfxValue(normalisedValue);
 
@@ -43,17 +43,31 @@ public:
     void setValueNoNotify(float newValue);
     float getDefaultValue() const override;
     juce::String getText(float normalisedValue, int) const override;
+    void invalidateTextCache();
     float getValueForText(const juce::String &text) const override;
     bool wasUpdatedByHost();  // Fetches whether this was updated by host and resets it
+    // Records a value change for the editor, without notifying the host
+    void markValueChangedQuietly() { ++m_quietChanges; }
+    uint32_t getQuietChangeCount() const { return m_quietChanges.load(); }
 
     juce::String getName(int maximumStringLength) const override;
     juce::CriticalSection m_nameSection;
 
 private:
+    juce::String formatText(float normalisedValue) const;
+
+    struct TextCacheEntry {
+        float normValue = 0.0f;
+        juce::String text;
+    };
+
     ysfx_u m_fx;
     int m_sliderIndex = 0;
     float m_value = 0.0f;
     std::atomic<bool> m_hostUpdated{false};
+    std::atomic<uint32_t> m_quietChanges{0};
     juce::String m_displayName;
+    // last formatted value, replaced atomically so readers never lock
+    mutable std::shared_ptr<const TextCacheEntry> m_textCache;
     const juce::NormalisableRange<float> m_range{0.0f, 1.0f};
 };
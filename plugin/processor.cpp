@@ -20,16 +20,18 @@
 #include "parameter.h"
 #include "info.h"
 #include "utility/audio_processor_suspender.h"
-#include "utility/rt_semaphore.h"
 #include "utility/sync_bitset.hpp"
+#include "utility/task_pool.h"
+#include "utility/undo_history.h"
 #include "ysfx.h"
 #include "bank_io.h"
 #include <atomic>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
+#include <functional>
+#include <chrono>
 #include <cmath>
-#include <deque>
 #include <algorithm>
 
 struct YsfxProcessor::Impl : public juce::AudioProcessorListener {
@@ -38,29 +40,43 @@ struct YsfxProcessor::Impl : public juce::AudioProcessorListener {
     ysfx_time_info_t m_timeInfo{};
     int m_sliderParamOffset = 0;
     ysfx::sync_bitset64 m_sliderParametersChanged[ysfx_max_slider_groups];
+    // the sliders of the current effect, and the number of groups which hold them
+    std::vector<uint32_t> m_sliderIndices;
+    std::atomic<int> m_numSliderGroups{0};
     YsfxInfo::Ptr m_info{new YsfxInfo};
     YsfxCurrentPresetInfo::Ptr m_currentPresetInfo{new YsfxCurrentPresetInfo};
     ysfx_bank_shared m_bank{nullptr};
 
+    // the timestamped slider changes which the effect takes ahead of a block, and the shortest sub-block
+    static constexpr uint32_t kSliderEventCapacity = 1024;
+    static constexpr uint32_t kSliderEventMinFrames = 16;
+
     int m_maxUndoStack{64};
     double m_sample_rate{44100.0};
     uint32_t m_block_size{256};
 
     //==========================================================================
+    // the host channels of the pins, null where the host has none
+    const void *m_pinInputs[ysfx_max_channels]{};
+    void *m_pinOutputs[ysfx_max_channels]{};
+    template <class Real> void processBlockWithBuses(juce::AudioBuffer<Real> &buffer, juce::MidiBuffer &midiMessages);
     void processBlockGenerically(const void *inputs[], void *outputs[], uint32_t numIns, uint32_t numOuts, uint32_t numFrames, uint32_t processBits, juce::MidiBuffer &midiMessages);
     void processMidiInput(juce::MidiBuffer &midi);
     void processMidiOutput(juce::MidiBuffer &midi);
     void processSliderChanges();
     void processLatency();
-    void updateTimeInfo();
+    void updateTimeInfo(bool positions);
     void syncParametersToSliders();
     void syncSlidersToParameters(bool notify);
     void syncParameterToSlider(int index);
+    static ysfx_real sliderValueOfParameter(YsfxParameter *param, float normValue);
     void syncSliderToParameter(int index, bool notify);
-    static YsfxInfo::Ptr createNewFx(juce::CharPointer_UTF8 filePath, ysfx_state_t *initialState);
-    void installNewFx(YsfxInfo::Ptr info, ysfx_bank_shared bank);
+    void updateSliderIndices();
+    static YsfxInfo::Ptr createNewFx(juce::CharPointer_UTF8 filePath, ysfx_state_t *initialState, bool profileLines = false);
+    void installNewFx(YsfxInfo::Ptr info, ysfx_bank_shared bank, bool adoptState = false);
     ysfx_bank_shared loadDefaultBank(YsfxInfo::Ptr info);
     void loadNewPreset(const ysfx_preset_t &preset);
+    void applyPendingPresetSliders();
     void resetPresetInfo();
 
     void pushUndoState();
@@ -68,10 +84,18 @@ struct YsfxProcessor::Impl : public juce::AudioProcessorListener {
     void redoState();
     void updateUndoState();
 
+    void notifyEditor();
+
+    void runAtBlockBoundary(std::function<void()> task);
+    void runPendingBlockTask();
+    ysfx_state_t *saveStateAtBlockBoundary();
+
     //==========================================================================
     struct LoadRequest : public std::enable_shared_from_this<LoadRequest> {
         juce::String filePath;
         ysfx_state_u initialState;
+        // continue from the VM state of the current effect, if only the code changed
+        bool incremental = false;
         volatile bool completion = false;
         std::mutex completionMutex;
         std::condition_variable completionVariable;
@@ -90,15 +114,59 @@ struct YsfxProcessor::Impl : public juce::AudioProcessorListener {
     };
 
     LoadRequest::Ptr m_loadRequest;
+    // the last full load, which stands for the state of the effect until it completes
+    LoadRequest::Ptr m_pendingLoad;
     PresetRequest::Ptr m_presetRequest;
-    UndoRequest m_undoRequest{UndoRequest::noRequest};
-    bool m_wantUndoPoint{false};
+    std::atomic<UndoRequest> m_undoRequest{UndoRequest::noRequest};
+    std::atomic<bool> m_wantUndoPoint{false};
     ysfx::sync_bitset64 m_sliderParamsToNotify[ysfx_max_slider_groups];
     ysfx::sync_bitset64 m_sliderParamsTouching[ysfx_max_slider_groups];
+    std::atomic<bool> m_batchParamsToNotify{false};
     bool m_updateParamNames{false};
+    // the editors learn of the changes at once, instead of polling
+    better::AsyncUpdater m_editorUpdater;
+    std::atomic<bool> m_editorDirty{false};
+
+    // a preset with only sliders, which the audio thread recalls at the start of a block
+    //   without suspending the processing or invoking @serialize
+    std::mutex m_presetSlidersMutex;
+    ysfx_state_slider_t m_presetSliders[ysfx_max_sliders]{};
+    uint32_t m_presetSliderCount{0};
+    std::atomic<bool> m_presetSlidersPending{false};
+
+    // a task which the audio thread runs at the start of a block, for another thread
+    //   which waits for it, so that saving or loading the state does not take the
+    //   callback lock; when the host does not process, the waiter takes it instead
+    std::mutex m_blockTaskRequestMutex;
+    std::mutex m_blockTaskMutex;
+    std::condition_variable m_blockTaskDone;
+    std::function<void()> m_blockTask;
+    std::atomic<bool> m_blockTaskPending{false};
+
+    // the state which the audio thread saves, in memory which it only grows
+    std::mutex m_stateMutex;
+    std::vector<uint8_t> m_stateData;
+    size_t m_stateDataSize{0};
+    ysfx_state_slider_t m_stateSliders[ysfx_max_sliders]{};
+    uint32_t m_stateSliderCount{0};
+    uint32_t m_stateMemHighWater{0};
     
-    std::deque<ysfx_state_u> m_undoStack;
+    // the state which the host got last, and its encoding, which is given again while the state is the same;
+    //   the hosts ask often, to see whether the project has changed
+    ysfx_state_u m_savedState;
+    juce::File m_savedPath;
+    juce::MemoryBlock m_savedBlock;
+    std::mutex m_savedMutex;
+
+    UndoHistory m_undoStack;
     int m_undoPosition{-1};
+    // the serialized data of the state which undo or redo restores
+    std::vector<uint8_t> m_undoData;
+
+    // keeps the thread which writes the banks, so the edits do not wait for it
+    juce::SharedResourcePointer<BankWriter> m_bankWriter;
+    // runs the loads, presets and undo steps, so that they do not delay the notifications
+    juce::SharedResourcePointer<TaskPool> m_taskPool;
     bool m_hasUndo{false};
     bool m_hasRedo{false};
 
@@ -108,6 +176,7 @@ struct YsfxProcessor::Impl : public juce::AudioProcessorListener {
         explicit SliderNotificationUpdater(Impl *impl) : m_impl{impl} {}
         void addSlidersToNotify(uint64_t mask, int group) { m_sliderMask[group].fetch_or(mask); }
         void updateTouch(uint64_t mask, int group) { m_touchMask[group].exchange(mask); }
+        void setBatched() { m_batched.store(true); }
 
     protected:
         void handleAsyncUpdate() override;
@@ -118,6 +187,7 @@ struct YsfxProcessor::Impl : public juce::AudioProcessorListener {
 
         ysfx::sync_bitset64 m_touchMask[ysfx_max_slider_groups];
         uint64_t m_previousTouchMask[ysfx_max_slider_groups]{0};
+        std::atomic<bool> m_batched{false};
     };
 
     std::unique_ptr<SliderNotificationUpdater> m_sliderNotificationUpdater;
@@ -155,13 +225,15 @@ struct YsfxProcessor::Impl : public juce::AudioProcessorListener {
         void shutdown();
         void wakeUp();
     private:
+        // the order of the work on the pool, most urgent first
+        enum TaskPriority { notifyTask, presetTask, undoTask, loadTask };
         void run();
+        void postTasks();
         void processLoadRequest(LoadRequest &req);
         void processPresetRequest(PresetRequest &req);
         Impl *m_impl = nullptr;
-        RTSemaphore m_sema;
-        std::atomic<bool> m_running{};
-        std::thread m_thread;
+        // the notifications have their own queue on the pool, so the other tasks do not delay them
+        TaskPool::Waker *m_waker = nullptr;
     };
 
     std::unique_ptr<Background> m_background;
@@ -172,6 +244,8 @@ struct YsfxProcessor::Impl : public juce::AudioProcessorListener {
 
     //==========================================================================
     std::atomic<RetryState> m_failedLoad{RetryState::ok};
+    // the effects which load next have the probes of the lines
+    std::atomic<bool> m_lineProfiling{false};
     juce::CriticalSection m_loadLock;
     juce::String m_lastLoadPath{""};
     ysfx_state_u m_failedLoadState{nullptr};  // Holds the state of a failed load
@@ -288,6 +362,21 @@ YsfxParameter *YsfxProcessor::getYsfxParameter(int sliderIndex)
     return static_cast<YsfxParameter *>(getParameters()[paramIndex]);
 }
 
+bool YsfxProcessor::setSliderParameterAt(int sliderIndex, float normValue, uint32_t sampleOffset)
+{
+    YsfxParameter *param = getYsfxParameter(sliderIndex);
+    if (!param || !param->existsAsSlider())
+        return false;
+
+    // the effect takes it at its frame, and the parameter shows it without reporting it back
+    ysfx_t *fx = m_impl->m_fx.get();
+    ysfx_set_sample_accurate(fx, Impl::kSliderEventMinFrames);
+    if (!ysfx_post_slider_value(fx, (uint32_t)sliderIndex, Impl::sliderValueOfParameter(param, normValue), sampleOffset))
+        return false;
+    param->setValueNoNotify(normValue);
+    return true;
+}
+
 void YsfxProcessor::loadJsfxFile(const juce::String &filePath, ysfx_state_t *initialState, bool async, bool preserveState)
 {
     Impl::LoadRequest::Ptr loadRequest{new Impl::LoadRequest};
@@ -296,12 +385,7 @@ void YsfxProcessor::loadJsfxFile(const juce::String &filePath, ysfx_state_t *ini
     if (preserveState) {
         jassert(!initialState);
         
-        {
-            AudioProcessorSuspender sus(*this);
-            sus.lockCallbacks();
-            ysfx_t *fx = m_impl->m_fx.get();
-            initialState = ysfx_save_state(fx);
-        }
+        initialState = m_impl->saveStateAtBlockBoundary();
     }
 
     if ((m_impl->m_failedLoad.load() == RetryState::retrying) || ((m_impl->m_failedLoad.load() == RetryState::failedRetry) && preserveState)) {
@@ -312,6 +396,7 @@ void YsfxProcessor::loadJsfxFile(const juce::String &filePath, ysfx_state_t *ini
     } else {
         loadRequest->initialState.reset(ysfx_state_dup(initialState));
     };
+    std::atomic_store(&m_impl->m_pendingLoad, loadRequest);
     std::atomic_store(&m_impl->m_loadRequest, loadRequest);
     m_impl->m_background->wakeUp();
     if (!async) {
@@ -320,6 +405,30 @@ void YsfxProcessor::loadJsfxFile(const juce::String &filePath, ysfx_state_t *ini
     }
 }
 
+void YsfxProcessor::reloadJsfxCode(const juce::String &filePath)
+{
+    // an effect which failed to load has no state to continue from
+    if (m_impl->m_failedLoad.load() != RetryState::ok || !ysfx_is_compiled(m_impl->m_fx.get())) {
+        loadJsfxFile(filePath, nullptr, true, true);
+        return;
+    }
+
+    Impl::LoadRequest::Ptr loadRequest{new Impl::LoadRequest};
+    loadRequest->filePath = filePath;
+    loadRequest->incremental = true;
+
+    // the fallback, if the change turns out to need a full reload
+    loadRequest->initialState.reset(m_impl->saveStateAtBlockBoundary());
+
+    std::atomic_store(&m_impl->m_loadRequest, loadRequest);
+    m_impl->m_background->wakeUp();
+}
+
+void YsfxProcessor::setLineProfiling(bool enable)
+{
+    m_impl->m_lineProfiling.store(enable);
+}
+
 void YsfxProcessor::loadJsfxPreset(YsfxInfo::Ptr info, ysfx_bank_shared bank, uint32_t index, PresetLoadMode load, bool async)
 {
     Impl::PresetRequest::Ptr presetRequest{new Impl::PresetRequest};
@@ -405,7 +514,7 @@ void YsfxProcessor::savePreset(const char* preset_name, ysfx_state_t* preset)
         newBank = make_ysfx_bank_shared(ysfx_add_preset_to_bank(bank.get(), preset_name, preset));
     }
 
-    save_bank(bankLocation.getFullPathName().toStdString().c_str(), newBank.get());
+    save_bank(bankLocation.getFullPathName().toStdString().c_str(), newBank);
     loadJsfxPreset(m_impl->m_info, newBank, ysfx_preset_exists(newBank.get(), preset_name) - 1, PresetLoadMode::load, true);
 }
 
@@ -439,7 +548,7 @@ void YsfxProcessor::renameCurrentPreset(const char* new_preset_name)
     backupPresetFile(bankLocation);
 
     ysfx_bank_shared newBank = make_ysfx_bank_shared(ysfx_rename_preset_from_bank(bank.get(), currentPreset.toStdString().c_str(), new_preset_name));
-    save_bank(bankLocation.getFullPathName().toStdString().c_str(), newBank.get());
+    save_bank(bankLocation.getFullPathName().toStdString().c_str(), newBank);
     loadJsfxPreset(m_impl->m_info, newBank, ysfx_preset_exists(newBank.get(), new_preset_name) - 1, PresetLoadMode::load, true);
 }
 
@@ -459,7 +568,7 @@ void YsfxProcessor::deleteCurrentPreset()
     if (currentPreset.isEmpty()) return;
 
     ysfx_bank_shared newBank = make_ysfx_bank_shared(ysfx_delete_preset_from_bank(bank.get(), currentPreset.toStdString().c_str()));
-    save_bank(bankLocation.getFullPathName().toStdString().c_str(), newBank.get());
+    save_bank(bankLocation.getFullPathName().toStdString().c_str(), newBank);
     loadJsfxPreset(m_impl->m_info, newBank, 0, PresetLoadMode::deleteName, true);
 }
 
@@ -508,6 +617,16 @@ ysfx_bank_shared YsfxProcessor::getCurrentBank()
     return std::atomic_load(&m_impl->m_bank);
 }
 
+void YsfxProcessor::addEditorListener(better::AsyncUpdater::Listener *listener)
+{
+    m_impl->m_editorUpdater.addListener(listener);
+}
+
+void YsfxProcessor::removeEditorListener(better::AsyncUpdater::Listener *listener)
+{
+    m_impl->m_editorUpdater.removeListener(listener);
+}
+
 //==============================================================================
 void YsfxProcessor::prepareToPlay(double sampleRate, int samplesPerBlock)
 {
@@ -520,6 +639,8 @@ void YsfxProcessor::prepareToPlay(double sampleRate, int samplesPerBlock)
 
     ysfx_set_sample_rate(fx, sampleRate);
     ysfx_set_block_size(fx, (uint32_t)samplesPerBlock);
+    // room for a second of latency, which the effect may set later than @init
+    ysfx_set_pdc_capacity(fx, (uint32_t)getTotalNumOutputChannels(), (uint32_t)sampleRate);
 
     ysfx_init(fx);
 
@@ -532,9 +653,12 @@ void YsfxProcessor::releaseResources()
 
 void YsfxProcessor::Impl::processBlockGenerically(const void *inputs[], void *outputs[], uint32_t numIns, uint32_t numOuts, uint32_t numFrames, uint32_t processBits, juce::MidiBuffer &midiMessages)
 {
+    runPendingBlockTask();
+
     ysfx_t *fx = m_fx.get();
 
-    for (auto group = 0; group < ysfx_max_slider_groups; group++) {
+    const int numSliderGroups = m_numSliderGroups.load();
+    for (auto group = 0; group < numSliderGroups; group++) {
         uint64_t sliderParametersChanged = m_sliderParametersChanged[group].exchange(0);
     
         if (sliderParametersChanged) {
@@ -547,10 +671,16 @@ void YsfxProcessor::Impl::processBlockGenerically(const void *inputs[], void *ou
         }
     }
 
-    updateTimeInfo();
+    applyPendingPresetSliders();
+
+    // skip the work whose results the effect cannot observe
+    const uint32_t capabilities = ysfx_get_capabilities(fx);
+
+    updateTimeInfo((capabilities & ysfx_capability_transport) != 0);
     ysfx_set_time_info(fx, &m_timeInfo);
 
-    processMidiInput(midiMessages);
+    if (capabilities & ysfx_capability_midi_in)
+        processMidiInput(midiMessages);
 
     switch (processBits) {
     case 32:
@@ -563,33 +693,73 @@ void YsfxProcessor::Impl::processBlockGenerically(const void *inputs[], void *ou
         jassertfalse;
     }
 
-    processMidiOutput(midiMessages);
-    processSliderChanges();
-    processLatency();
+    if (capabilities & ysfx_capability_midi_out)
+        processMidiOutput(midiMessages);
+    else
+        midiMessages.clear();
+    if (capabilities & ysfx_capability_slider_output)
+        processSliderChanges();
+    // otherwise, the latency is set when the effect is installed
+    if (capabilities & ysfx_capability_latency)
+        processLatency();
+}
+
+template <class Real>
+void YsfxProcessor::Impl::processBlockWithBuses(juce::AudioBuffer<Real> &buffer, juce::MidiBuffer &midiMessages)
+{
+    ysfx_t *fx = m_fx.get();
+
+    const Real *const *hostIns = buffer.getArrayOfReadPointers();
+    Real *const *hostOuts = buffer.getArrayOfWritePointers();
+    const int numHostIns = m_self->getTotalNumInputChannels();
+    const int numHostOuts = m_self->getTotalNumOutputChannels();
+    const int numMainIns = m_self->getMainBusNumInputChannels();
+    const int numFrames = buffer.getNumSamples();
+
+    // the pins take the host channels in order, as in REAPER, except that
+    // the sidechain pins start on the buses after the main one; the main pins
+    // before them stay on the main bus, and the missing channels are null
+    const uint32_t numIns = ysfx_get_num_inputs(fx);
+    bool hasSidechain = false;
+    for (uint32_t pin = 0; pin < numIns && !hasSidechain; ++pin)
+        hasSidechain = ysfx_is_sidechain_input(fx, pin);
+
+    int next = 0;
+    bool inSidechain = false;
+    for (uint32_t pin = 0; pin < numIns; ++pin) {
+        if (!inSidechain && ysfx_is_sidechain_input(fx, pin)) {
+            inSidechain = true;
+            next = numMainIns;
+        }
+        const void *channel = nullptr;
+        if (inSidechain || !hasSidechain || next < numMainIns) {
+            if (next < numHostIns)
+                channel = hostIns[next];
+            ++next;
+        }
+        m_pinInputs[pin] = channel;
+    }
+
+    const uint32_t numOuts = ysfx_get_num_outputs(fx);
+    for (uint32_t pin = 0; pin < numOuts; ++pin)
+        m_pinOutputs[pin] = ((int)pin < numHostOuts) ? hostOuts[pin] : nullptr;
+
+    // the buffer is in place: the channels above the outputs keep their
+    // input, which forwards it, and the others must be silenced
+    for (int ch = std::max((int)numOuts, numHostIns); ch < numHostOuts; ++ch)
+        buffer.clear(ch, 0, numFrames);
+
+    processBlockGenerically(m_pinInputs, m_pinOutputs, numIns, numOuts, (uint32_t)numFrames, 8 * sizeof(Real), midiMessages);
 }
 
 void YsfxProcessor::processBlock(juce::AudioBuffer<float> &buffer, juce::MidiBuffer &midiMessages)
 {
-    m_impl->processBlockGenerically(
-        (const void **)buffer.getArrayOfReadPointers(),
-        (void **)buffer.getArrayOfWritePointers(),
-        (uint32_t)getTotalNumInputChannels(),
-        (uint32_t)getTotalNumOutputChannels(),
-        (uint32_t)buffer.getNumSamples(),
-        8 * sizeof(buffer.getSample(0, 0)),
-        midiMessages);
+    m_impl->processBlockWithBuses(buffer, midiMessages);
 }
 
 void YsfxProcessor::processBlock(juce::AudioBuffer<double> &buffer, juce::MidiBuffer &midiMessages)
 {
-    m_impl->processBlockGenerically(
-        (const void **)buffer.getArrayOfReadPointers(),
-        (void **)buffer.getArrayOfWritePointers(),
-        (uint32_t)getTotalNumInputChannels(),
-        (uint32_t)getTotalNumOutputChannels(),
-        (uint32_t)buffer.getNumSamples(),
-        8 * sizeof(buffer.getSample(0, 0)),
-        midiMessages);
+    m_impl->processBlockWithBuses(buffer, midiMessages);
 }
 
 bool YsfxProcessor::supportsDoublePrecisionProcessing() const
@@ -663,23 +833,73 @@ void YsfxProcessor::changeProgramName(int index, const juce::String &newName)
 }
 
 //==============================================================================
+// serialized data from this size is compressed in the state chunk, if it gets smaller
+//   version 1 has the data in base64; version 2 can have it compressed with zlib
+static constexpr size_t stateCompressionThreshold = 4096;
+
+static bool compressStateData(const uint8_t *data, size_t size, juce::MemoryBlock &packed)
+{
+    {
+        juce::MemoryOutputStream packedStream(packed, false);
+        // the fastest level, since hosts save the state often
+        juce::GZIPCompressorOutputStream zStream(packedStream, 1);
+        if (!zStream.write(data, size))
+            return false;
+    }
+    return packed.getSize() < size;
+}
+
+static bool decompressStateData(const juce::MemoryBlock &packed, size_t size, juce::MemoryBlock &data)
+{
+    juce::MemoryInputStream packedStream(packed, false);
+    juce::GZIPDecompressorInputStream zStream(&packedStream, false, juce::GZIPDecompressorInputStream::zlibFormat, (juce::int64)size);
+    data.setSize(size);
+    return (size_t)zStream.read(data.getData(), size) == size;
+}
+
 void YsfxProcessor::getStateInformation(juce::MemoryBlock &destData)
 {
     juce::File path;
     ysfx_state_u state;
 
-    {
-        AudioProcessorSuspender sus(*this);
-        sus.lockCallbacks();
-        ysfx_t *fx = m_impl->m_fx.get();
-        path = juce::CharPointer_UTF8(ysfx_get_file_path(fx));
-        state.reset(ysfx_save_state(fx));
+    // while a load is not complete, the state is the one which it will have
+    bool pending = false;
+    if (Impl::LoadRequest::Ptr loadRequest = std::atomic_load(&m_impl->m_pendingLoad)) {
+        std::lock_guard<std::mutex> lock(loadRequest->completionMutex);
+        if (!loadRequest->completion) {
+            pending = true;
+            path = loadRequest->filePath;
+            state.reset(ysfx_state_dup(loadRequest->initialState.get()));
+        }
+    }
+
+    if (!pending) {
+        path = juce::CharPointer_UTF8(ysfx_get_file_path(m_impl->m_fx.get()));
+        state.reset(m_impl->saveStateAtBlockBoundary());
+    }
+
+    if (state) {
+        ysfx_state_hash(state.get());
+        std::lock_guard<std::mutex> lock(m_impl->m_savedMutex);
+        if (m_impl->m_savedState && m_impl->m_savedPath == path && ysfx_is_state_equal(state.get(), m_impl->m_savedState.get())) {
+            destData = m_impl->m_savedBlock;
+            return;
+        }
     }
 
     juce::ValueTree root("ysfx");
-    root.setProperty("version", 1, nullptr);
+    int version = 1;
     root.setProperty("path", path.getFullPathName(), nullptr);
 
+    // the files which @init opened, to preload them as the project opens next
+    if (!pending) {
+        if (char *manifest = ysfx_get_init_manifest(m_impl->m_fx.get())) {
+            if (*manifest)
+                root.setProperty("manifest", juce::String::fromUTF8(manifest), nullptr);
+            ysfx_free_resolved_path(manifest);
+        }
+    }
+
     if (state) {
         juce::ValueTree stateTree("state");
 
@@ -688,15 +908,44 @@ void YsfxProcessor::getStateInformation(juce::MemoryBlock &destData)
             sliderTree.setProperty(juce::String(state->sliders[i].index), state->sliders[i].value, nullptr);
         stateTree.addChild(sliderTree, -1, nullptr);
 
-        stateTree.setProperty("data", juce::Base64::toBase64(state->data, state->data_size), nullptr);
+        juce::MemoryBlock packed;
+        if (state->data_size >= stateCompressionThreshold && compressStateData(state->data, state->data_size, packed)) {
+            stateTree.setProperty("encoding", "zlib", nullptr);
+            stateTree.setProperty("dataSize", (juce::int64)state->data_size, nullptr);
+            stateTree.setProperty("data", packed, nullptr);
+            version = 2;
+        }
+        else {
+            std::string text(ysfx_base64_encoded_size(state->data_size), '\0');
+            text.resize(ysfx_base64_encode(state->data, state->data_size, &text[0]));
+            stateTree.setProperty("data", juce::String::fromUTF8(text.data(), (int)text.size()), nullptr);
+        }
+        stateTree.setProperty("memHighWater", (juce::int64)state->mem_high_water, nullptr);
 
         root.addChild(stateTree, -1, nullptr);
     }
 
-    juce::MemoryOutputStream stream(destData, false);
-    root.writeToStream(stream);
+    // only the states which need it get the new version, so older versions can read the rest
+    root.setProperty("version", version, nullptr);
+
+    {
+        juce::MemoryOutputStream stream(destData, false);
+        root.writeToStream(stream);
+    }
+
+    if (state) {
+        std::lock_guard<std::mutex> lock(m_impl->m_savedMutex);
+        m_impl->m_savedState = std::move(state);
+        m_impl->m_savedPath = path;
+        m_impl->m_savedBlock = destData;
+    }
 }
 
+static ysfx_config_t *getSharedAudioCacheConfig();
+
+// the load is asynchronous, so the instances of a session compile in parallel
+//   on the pool; meanwhile the previous effect keeps processing, and the empty
+//   effect of a new instance passes the audio through
 void YsfxProcessor::setStateInformation(const void *data, int sizeInBytes)
 {
     juce::File path;
@@ -706,11 +955,17 @@ void YsfxProcessor::setStateInformation(const void *data, int sizeInBytes)
 
     if (root.getType().getCharPointer().compare(juce::CharPointer_UTF8("ysfx")) != 0)
         return;
-    if ((int)root.getProperty("version") != 1)
+    int version = (int)root.getProperty("version");
+    if (version != 1 && version != 2)
         return;
 
     path = root.getProperty("path").toString();
 
+    // all the instances of the session queue their files, before any of them runs @init
+    juce::String manifest = root.getProperty("manifest").toString();
+    if (manifest.isNotEmpty())
+        ysfx_preload(getSharedAudioCacheConfig(), manifest.toRawUTF8());
+
     juce::ValueTree stateTree = root.getChildWithName("state");
     if (stateTree != juce::ValueTree{}) {
         ysfx_state_t state{};
@@ -728,27 +983,41 @@ void YsfxProcessor::setStateInformation(const void *data, int sizeInBytes)
                 }
             }
         }
-        {
-            juce::MemoryOutputStream base64Result(dataBlock, false);
-            juce::Base64::convertFromBase64(base64Result, stateTree.getProperty("data").toString());
+        if (stateTree.getProperty("encoding").toString() == "zlib") {
+            const juce::MemoryBlock *packed = stateTree.getProperty("data").getBinaryData();
+            size_t size = (size_t)(juce::int64)stateTree.getProperty("dataSize", 0);
+            if (!packed || !decompressStateData(*packed, size, dataBlock))
+                dataBlock.reset();
+        }
+        else {
+            juce::String text = stateTree.getProperty("data").toString();
+            size_t length = text.getNumBytesAsUTF8();
+            dataBlock.setSize(ysfx_base64_decoded_capacity(length));
+            dataBlock.setSize(ysfx_base64_decode(text.toRawUTF8(), length, dataBlock.getData()));
         }
 
         state.sliders = sliders.data();
         state.slider_count = (uint32_t)sliders.size();
         state.data = (uint8_t *)dataBlock.getData();
         state.data_size = dataBlock.getSize();
-        loadJsfxFile(path.getFullPathName(), &state, false, false);
+        state.mem_high_water = (uint32_t)(juce::int64)stateTree.getProperty("memHighWater", 0);
+        loadJsfxFile(path.getFullPathName(), &state, true, false);
     }
     else {
-        loadJsfxFile(path.getFullPathName(), nullptr, false, false);
+        loadJsfxFile(path.getFullPathName(), nullptr, true, false);
     }
 }
 
 //==============================================================================
 bool YsfxProcessor::isBusesLayoutSupported(const BusesLayout &layout) const
 {
-    int numInputs = layout.getMainInputChannels();
-    int numOutputs = layout.getMainOutputChannels();
+    // the pins are mapped over all the buses
+    int numInputs = 0;
+    int numOutputs = 0;
+    for (int bus = 0; bus < layout.inputBuses.size(); ++bus)
+        numInputs += layout.getNumChannels(true, bus);
+    for (int bus = 0; bus < layout.outputBuses.size(); ++bus)
+        numOutputs += layout.getNumChannels(false, bus);
 
     if (numInputs > ysfx_max_channels || numOutputs > ysfx_max_channels)
         return false;
@@ -761,41 +1030,63 @@ void YsfxProcessor::Impl::processMidiInput(juce::MidiBuffer &midi)
 {
     ysfx_t *fx = m_fx.get();
 
+    enum { batchSize = 256 };
+    ysfx_midi_event_t events[batchSize];
+    uint32_t count = 0;
+
     for (juce::MidiMessageMetadata md : midi) {
-        ysfx_midi_event_t event{};
+        ysfx_midi_event_t &event = events[count++];
+        event.bus = 0;
         event.offset = (uint32_t)md.samplePosition;
         event.size = (uint32_t)md.numBytes;
         event.data = md.data;
-        ysfx_send_midi(fx, &event);
+        if (count == batchSize) {
+            ysfx_send_midi_batch(fx, events, count);
+            count = 0;
+        }
     }
+    ysfx_send_midi_batch(fx, events, count);
 }
 
 void YsfxProcessor::Impl::processMidiOutput(juce::MidiBuffer &midi)
 {
     midi.clear();
 
-    ysfx_midi_event_t event;
+    enum { batchSize = 256 };
+    ysfx_midi_event_t events[batchSize];
     ysfx_t *fx = m_fx.get();
-    while (ysfx_receive_midi(fx, &event))
-        midi.addEvent(event.data, (int)event.size, (int)event.offset);
+    uint32_t count;
+    do {
+        count = ysfx_receive_midi_batch(fx, events, batchSize);
+        for (uint32_t i = 0; i < count; ++i)
+            midi.addEvent(events[i].data, (int)events[i].size, (int)events[i].offset);
+    } while (count == batchSize);
 }
 
 void YsfxProcessor::Impl::processSliderChanges()
 {
     ysfx_t *fx = m_fx.get();
 
-    for (int i = 0; i < ysfx_max_sliders; ++i) {
-        YsfxParameter *param = m_self->getYsfxParameter(i);
-        if (param->existsAsSlider()) {
-            float normValue = param->convertFromYsfxValue(ysfx_slider_get_value(fx, (uint32_t)i));
-            if (std::abs(param->getValue() - normValue) > 1e-9) {
-                param->setValueNoNotify(normValue);  // This should not trigger @slider
+    const int numSliderGroups = m_numSliderGroups.load();
+
+    // visit only the sliders whose values have changed since the last cycle
+    for (uint8_t group = 0; group < numSliderGroups; ++group) {
+        uint64_t changes = ysfx_fetch_slider_value_changes(fx, group);
+        for (uint32_t i = group * 64; changes; ++i, changes >>= 1) {
+            if (!(changes & 1))
+                continue;
+            YsfxParameter *param = m_self->getYsfxParameter((int)i);
+            if (param->existsAsSlider()) {
+                float normValue = param->convertFromYsfxValue(ysfx_slider_get_value(fx, i));
+                if (std::abs(param->getValue() - normValue) > 1e-9) {
+                    param->setValueNoNotify(normValue);  // This should not trigger @slider
+                }
             }
         }
     }
 
     bool notify = false;
-    for (uint8_t i = 0; i < ysfx_max_slider_groups; ++i) {
+    for (uint8_t i = 0; i < numSliderGroups; ++i) {
         uint64_t automated = ysfx_fetch_slider_automations(fx, i);
         m_sliderParamsTouching[i].exchange(ysfx_fetch_slider_touches(fx, i));
         m_sliderParamsToNotify[i].fetch_or(automated);
@@ -806,7 +1097,7 @@ void YsfxProcessor::Impl::processSliderChanges()
     // this will sync parameters later (on message thread)
     if (notify) m_background->wakeUp();
 
-    //TODO: visibility changes
+    // visibility changes are fetched by the editor
 }
 
 void YsfxProcessor::Impl::processLatency()
@@ -814,20 +1105,23 @@ void YsfxProcessor::Impl::processLatency()
     ysfx_t *fx = m_fx.get();
     ysfx_real latency = ysfx_get_pdc_delay(fx);
 
-    // NOTE: ignore pdc_bot_ch and pdc_top_ch
+    // the outputs outside of pdc_bot_ch and pdc_top_ch are delayed to match, by the compensation of ysfx
 
     int samples = juce::roundToInt(latency);
     m_self->setLatencySamples(samples);
 }
 
-void YsfxProcessor::Impl::updateTimeInfo()
+void YsfxProcessor::Impl::updateTimeInfo(bool positions)
 {
+    m_timeInfo.offline = m_self->isNonRealtime();
+
     juce::AudioPlayHead *playHead = m_self->getPlayHead();
 
     juce::Optional<juce::AudioPlayHead::PositionInfo> cpi = playHead->getPosition();
     if (!cpi)
         return;
 
+    // the playback state is always needed, since starting the playback runs @init
     if (cpi->getIsRecording())
         m_timeInfo.playback_state = ysfx_playback_recording;
     else if (cpi->getIsPlaying())
@@ -835,6 +1129,9 @@ void YsfxProcessor::Impl::updateTimeInfo()
     else
         m_timeInfo.playback_state = ysfx_playback_paused;
 
+    if (!positions)
+        return;
+
     if (juce::Optional<double> bpm = cpi->getBpm())
         m_timeInfo.tempo = *bpm;
     if (juce::Optional<double> timeInSeconds = cpi->getTimeInSeconds())
@@ -849,14 +1146,28 @@ void YsfxProcessor::Impl::updateTimeInfo()
 
 void YsfxProcessor::Impl::syncParametersToSliders()
 {
-    for (int i = 0; i < ysfx_max_sliders; ++i)
-        syncParameterToSlider(i);
+    for (uint32_t i : m_sliderIndices)
+        syncParameterToSlider((int)i);
 }
 
 void YsfxProcessor::Impl::syncSlidersToParameters(bool notify)
 {
-    for (int i = 0; i < ysfx_max_sliders; ++i)
-        syncSliderToParameter(i, notify);
+    for (uint32_t i : m_sliderIndices)
+        syncSliderToParameter((int)i, notify);
+}
+
+void YsfxProcessor::Impl::updateSliderIndices()
+{
+    ysfx_t *fx = m_fx.get();
+
+    // NOTE: the capacity stays at the maximum, so this does not allocate
+    m_sliderIndices.resize(ysfx_max_sliders);
+    m_sliderIndices.resize(ysfx_get_slider_indices(fx, m_sliderIndices.data(), ysfx_max_sliders));
+
+    int numSliderGroups = 0;
+    if (!m_sliderIndices.empty())
+        numSliderGroups = ysfx_fetch_slider_group_index(m_sliderIndices.back()) + 1;
+    m_numSliderGroups.store(numSliderGroups);
 }
 
 void YsfxProcessor::Impl::syncParameterToSlider(int index)
@@ -867,17 +1178,23 @@ void YsfxProcessor::Impl::syncParameterToSlider(int index)
     YsfxParameter *param = m_self->getYsfxParameter(index);
 
     if (param->existsAsSlider()) {
-        ysfx_real actualValue = param->convertToYsfxValue(param->getValue());
+        ysfx_real actualValue = sliderValueOfParameter(param, param->getValue());
+        ysfx_slider_set_value(m_fx.get(), (uint32_t)index, actualValue, param->wasUpdatedByHost());
+    }
+}
 
-        // NOTE: Unfortunately, things have to map to 0-1 so you lose some precision 
-        // coming back (and can't rely on integer floats being exact anymore).
-        ysfx_real rounded = juce::roundToInt(actualValue);
-        if (std::abs(rounded - actualValue) < 0.00001) {
-            actualValue = rounded > -0.1 ? abs(rounded) : rounded;
-        }
+ysfx_real YsfxProcessor::Impl::sliderValueOfParameter(YsfxParameter *param, float normValue)
+{
+    ysfx_real actualValue = param->convertToYsfxValue(normValue);
 
-        ysfx_slider_set_value(m_fx.get(), (uint32_t)index, actualValue, param->wasUpdatedByHost());
+    // NOTE: Unfortunately, things have to map to 0-1 so you lose some precision 
+    // coming back (and can't rely on integer floats being exact anymore).
+    ysfx_real rounded = juce::roundToInt(actualValue);
+    if (std::abs(rounded - actualValue) < 0.00001) {
+        actualValue = rounded > -0.1 ? abs(rounded) : rounded;
     }
+
+    return actualValue;
 }
 
 void YsfxProcessor::Impl::syncSliderToParameter(int index, bool notify)
@@ -897,7 +1214,7 @@ void YsfxProcessor::Impl::syncSliderToParameter(int index, bool notify)
         
         if (notify)
             param->setValueNotifyingHost(normValue);
-        else {
+        else if (normValue != param->getValue()) {
             param->setValue(normValue);
 
             uint8_t group = ysfx_fetch_slider_group_index((uint32_t) index);
@@ -906,7 +1223,19 @@ void YsfxProcessor::Impl::syncSliderToParameter(int index, bool notify)
     }
 }
 
-YsfxInfo::Ptr YsfxProcessor::Impl::createNewFx(juce::CharPointer_UTF8 filePath, ysfx_state_t *initialState)
+// the instances of the plugin share the decoded audio files, which it also preloads
+static ysfx_config_t *getSharedAudioCacheConfig()
+{
+    static ysfx_config_u holder = []() {
+        ysfx_config_u config{ysfx_config_new()};
+        ysfx_register_builtin_audio_formats(config.get());
+        ysfx_set_audio_cache_size(config.get(), (uint64_t)512 << 20);
+        return config;
+    }();
+    return holder.get();
+}
+
+YsfxInfo::Ptr YsfxProcessor::Impl::createNewFx(juce::CharPointer_UTF8 filePath, ysfx_state_t *initialState, bool profileLines)
 {
     YsfxInfo::Ptr info{new YsfxInfo};
 
@@ -916,6 +1245,7 @@ YsfxInfo::Ptr YsfxProcessor::Impl::createNewFx(juce::CharPointer_UTF8 filePath,
     ysfx_config_u config{ysfx_config_new()};
     ysfx_register_builtin_audio_formats(config.get());
     ysfx_guess_file_roots(config.get(), filePath);
+    ysfx_share_audio_cache(config.get(), getSharedAudioCacheConfig());
 
     ///
     auto logfn = [](intptr_t userdata, ysfx_log_level level, const char *message) {
@@ -932,11 +1262,21 @@ YsfxInfo::Ptr YsfxProcessor::Impl::createNewFx(juce::CharPointer_UTF8 filePath,
     ///
     ysfx_t *fx = ysfx_new(config.get());
     info->effect.reset(fx);
+    ysfx_set_auto_prefault(fx, ysfx_prefault_high_water);
+    ysfx_set_midi_capacity(fx, 64 * 1024, false);
+    ysfx_set_midi_sysex_capacity(fx, 1024 * 1024);
+    ysfx_set_midi_output_sorted(fx, true);
+    ysfx_set_pdc_compensation(fx, true);
+    ysfx_set_slider_queue_capacity(fx, kSliderEventCapacity);
 
     uint32_t loadopts = 0;
     uint32_t compileopts = 0;
+    if (profileLines)
+        compileopts |= ysfx_compile_profile_lines;
     ysfx_load_file(fx, filePath, loadopts);
     ysfx_compile(fx, compileopts);
+    if (profileLines)
+        ysfx_set_line_sampling(fx, true, 0);
 
     info->mainFile = juce::File{filePath};
     info->m_name = info->mainFile.getFileNameWithoutExtension();
@@ -963,23 +1303,37 @@ ysfx_bank_shared YsfxProcessor::Impl::loadDefaultBank(YsfxInfo::Ptr info)
     return bank;
 }
 
-void YsfxProcessor::Impl::installNewFx(YsfxInfo::Ptr info, ysfx_bank_shared bank)
+void YsfxProcessor::Impl::installNewFx(YsfxInfo::Ptr info, ysfx_bank_shared bank, bool adoptState)
 {
+    ysfx_t *fx = info->effect.get();
+
+    // the new effect is not live yet, so its @init runs before the suspension
+    ysfx_set_slider_visibility_callback(fx, +[](void *userdata) { ((Impl *)userdata)->notifyEditor(); }, this);
+    ysfx_set_sample_rate(fx, m_sample_rate);
+    ysfx_set_block_size(fx, m_block_size);
+    ysfx_set_pdc_capacity(fx, (uint32_t)m_self->getTotalNumOutputChannels(), (uint32_t)m_sample_rate);
+    if (!adoptState)
+        ysfx_init(fx);
+
     AudioProcessorSuspender sus{*m_self};
     sus.lockCallbacks();
 
-    ysfx_t *fx = info->effect.get();
+    // a preset of the previous effect is not recalled in this one
+    m_presetSlidersPending.store(false);
+
+    ysfx_u previous{m_fx.release()};
     m_fx.reset(fx);
     ysfx_add_ref(fx);
 
-    ysfx_set_sample_rate(fx, m_sample_rate);
-    ysfx_set_block_size(fx, m_block_size);
-    ysfx_init(fx);
+    if (adoptState && (!previous || !ysfx_adopt_state(fx, previous.get())))
+        ysfx_init(fx);
 
     for (uint32_t i = 0; i < ysfx_max_sliders; ++i) {
         YsfxParameter *param = m_self->getYsfxParameter((int)i);
         param->setEffect(fx);
     }
+    updateSliderIndices();
+    processLatency();
 
     bool notify = false;
     syncSlidersToParameters(notify);
@@ -1003,7 +1357,7 @@ void YsfxProcessor::Impl::installNewFx(YsfxInfo::Ptr info, ysfx_bank_shared bank
     std::atomic_store(&m_bank, bank);
     std::atomic_store(&m_info, info);
 
-    m_background->wakeUp();
+    notifyEditor();
 }
 
 void YsfxProcessor::Impl::updateUndoState()
@@ -1012,27 +1366,74 @@ void YsfxProcessor::Impl::updateUndoState()
     m_hasRedo = static_cast<size_t>(m_undoPosition + 1) < m_undoStack.size();
 }
 
+void YsfxProcessor::Impl::notifyEditor()
+{
+    // the background forwards it to the message thread, this may run on the audio thread
+    m_editorDirty.store(true);
+    m_background->wakeUp();
+}
+
 void YsfxProcessor::Impl::loadNewPreset(const ysfx_preset_t &preset)
 {
-    AudioProcessorSuspender sus{*m_self};
-    sus.lockCallbacks();
+    YsfxCurrentPresetInfo::Ptr presetInfo{new YsfxCurrentPresetInfo()};
+    presetInfo->m_lastChosenPreset = juce::String::fromUTF8(preset.name);
 
-    ysfx_t *fx = m_fx.get();
-    ysfx_load_state(fx, preset.state);
+    ysfx_state_t *state = preset.state;
+    if (state->data_size == 0 && state->slider_count <= ysfx_max_sliders) {
+        // the audio thread recalls it, and notifies the parameters after
+        {
+            std::lock_guard<std::mutex> lock(m_presetSlidersMutex);
+            std::copy(state->sliders, state->sliders + state->slider_count, m_presetSliders);
+            m_presetSliderCount = state->slider_count;
+        }
+        m_presetSlidersPending.store(true);
 
-    bool notify = false;
-    syncSlidersToParameters(notify);
+        std::atomic_store(&m_currentPresetInfo, presetInfo);
+        notifyEditor();
+        return;
+    }
 
-    YsfxCurrentPresetInfo::Ptr presetInfo{new YsfxCurrentPresetInfo()};
-    presetInfo->m_lastChosenPreset = juce::String::fromUTF8(preset.name);
+    runAtBlockBoundary([this, state]() {
+        // a full preset replaces the one which is not recalled yet
+        m_presetSlidersPending.store(false);
 
-    // notify parameters later, on the message thread
-    for (int i=0; i < ysfx_max_slider_groups; i++) {
-        m_sliderParamsToNotify[i].store(~(uint64_t)0);
+        ysfx_load_state(m_fx.get(), state);
+
+        bool notify = false;
+        syncSlidersToParameters(notify);
+    });
+
+    // notify parameters later, on the message thread, as a single batch;
+    //    the sync above has marked the parameters whose values changed
+    for (int i=0; i < ysfx_max_slider_groups; i++)
         m_sliderParamsTouching[i].store((uint64_t)0);
-    }
+    m_batchParamsToNotify.store(true);
 
     std::atomic_store(&m_currentPresetInfo, presetInfo);
+    notifyEditor();
+}
+
+void YsfxProcessor::Impl::applyPendingPresetSliders()
+{
+    if (!m_presetSlidersPending.load())
+        return;
+
+    // if the background is copying a preset in, it is recalled in the next block
+    std::unique_lock<std::mutex> lock(m_presetSlidersMutex, std::try_to_lock);
+    if (!lock.owns_lock())
+        return;
+
+    ysfx_state_t state{m_presetSliders, m_presetSliderCount, nullptr, 0, 0};
+    ysfx_load_slider_state(m_fx.get(), &state);
+    m_presetSlidersPending.store(false);
+    lock.unlock();
+
+    bool notify = false;
+    syncSlidersToParameters(notify);
+
+    for (int i=0; i < ysfx_max_slider_groups; i++)
+        m_sliderParamsTouching[i].store((uint64_t)0);
+    m_batchParamsToNotify.store(true);
     m_background->wakeUp();
 }
 
@@ -1040,68 +1441,148 @@ void YsfxProcessor::Impl::pushUndoState()
 {
     if (!m_currentPresetInfo) return;
 
-    ysfx_state_t* state;
-    {
-        AudioProcessorSuspender sus(*m_self);
-        sus.lockCallbacks();
-        ysfx_t *fx = m_fx.get();
-        state = ysfx_save_state(fx);
-    }
+    ysfx_state_u state{saveStateAtBlockBoundary()};
 
-    if (!m_currentPresetInfo) return;
+    if (!m_currentPresetInfo || !state) return;
+
+    // The snapshot shares the chunks which did not change since the others
+    UndoHistory::Snapshot snapshot = m_undoStack.capture(state.get());
+    state.reset();
 
     // Verify that we don't already have this exact state
-    if ((m_undoPosition < m_undoStack.size()) && (m_undoPosition >= 0) && ysfx_is_state_equal(state, m_undoStack[m_undoPosition].get())) {
-        ysfx_state_free(state);
+    if ((m_undoPosition < static_cast<int>(m_undoStack.size())) && (m_undoPosition >= 0) && UndoHistory::isEqual(snapshot, m_undoStack[static_cast<size_t>(m_undoPosition)]))
         return;
-    }
-
-    ysfx_state_u preset;
-    preset.reset(state);
 
     // We add a new undo state -> Invalidate everything after our current position
     auto offset = std::min<int>(static_cast<int>(m_undoStack.size()), std::max<int>(1, m_undoPosition + 1));
-    m_undoStack.erase(m_undoStack.begin() + offset, m_undoStack.end());
+    m_undoStack.truncate(static_cast<size_t>(offset));
 
-    m_undoStack.emplace_back(std::move(preset));
+    m_undoStack.push(std::move(snapshot));
     m_undoPosition = static_cast<int>(m_undoStack.size()) - 1;
 
-    if (m_undoStack.size() > m_maxUndoStack) {
-        m_undoStack.pop_front();
+    if (m_undoStack.size() > static_cast<size_t>(m_maxUndoStack)) {
+        m_undoStack.popFront();
         m_undoPosition -= 1;
     }
 
     updateUndoState();
+    notifyEditor();
 }
 
 void YsfxProcessor::Impl::popUndoState()
 {
-    AudioProcessorSuspender sus{*m_self};
-    sus.lockCallbacks();
-
     m_undoPosition = std::max<int>(-1, m_undoPosition - 1);
     if (m_undoPosition < 0) return;  // Nothing to undo
 
-    ysfx_t *fx = m_fx.get();
-    ysfx_load_serialized_state(fx, m_undoStack[static_cast<size_t>(m_undoPosition)].get());
+    // the data is rebuilt here, only its loading waits for the audio thread
+    UndoHistory::getData(m_undoStack[static_cast<size_t>(m_undoPosition)], m_undoData);
+    runAtBlockBoundary([this]() {
+        ysfx_load_serialized_state_from(m_fx.get(), m_undoData.data(), m_undoData.size());
+    });
     updateUndoState();
 
-    m_background->wakeUp();
+    notifyEditor();
 }
 
 void YsfxProcessor::Impl::redoState()
 {
-    AudioProcessorSuspender sus{*m_self};
-    sus.lockCallbacks();
-
     if ((m_undoPosition + 1) >= static_cast<int>(m_undoStack.size())) return;  // Nothing to redo
     m_undoPosition += 1;
-    
-    ysfx_t *fx = m_fx.get();
-    ysfx_load_serialized_state(fx, m_undoStack[static_cast<size_t>(m_undoPosition)].get());
+
+    UndoHistory::getData(m_undoStack[static_cast<size_t>(m_undoPosition)], m_undoData);
+    runAtBlockBoundary([this]() {
+        ysfx_load_serialized_state_from(m_fx.get(), m_undoData.data(), m_undoData.size());
+    });
     updateUndoState();
 
-    m_background->wakeUp();
+    notifyEditor();
+}
+
+void YsfxProcessor::Impl::runAtBlockBoundary(std::function<void()> task)
+{
+    std::lock_guard<std::mutex> requestLock(m_blockTaskRequestMutex);
+
+    std::unique_lock<std::mutex> lock(m_blockTaskMutex);
+    m_blockTask = std::move(task);
+    m_blockTaskPending.store(true);
+
+    // the host might not be processing, so wait for a few blocks at most
+    const double blockSeconds = m_block_size / m_sample_rate;
+    const std::chrono::milliseconds timeout{20 + (int)(4000 * blockSeconds)};
+    bool done = m_blockTaskDone.wait_for(lock, timeout, [this]() { return !m_blockTaskPending.load(); });
+
+    // the task is released here, so the audio thread does not free it
+    task = std::move(m_blockTask);
+    m_blockTask = nullptr;
+    m_blockTaskPending.store(false);
+    lock.unlock();
+
+    if (!done) {
+        AudioProcessorSuspender sus{*m_self};
+        sus.lockCallbacks();
+        task();
+    }
+}
+
+void YsfxProcessor::Impl::runPendingBlockTask()
+{
+    if (!m_blockTaskPending.load())
+        return;
+
+    // if the requester is giving up on the wait, it runs the task itself
+    std::unique_lock<std::mutex> lock(m_blockTaskMutex, std::try_to_lock);
+    if (!lock.owns_lock() || !m_blockTaskPending.load())
+        return;
+
+    m_blockTask();
+    m_blockTaskPending.store(false);
+    lock.unlock();
+    m_blockTaskDone.notify_one();
+}
+
+ysfx_state_t *YsfxProcessor::Impl::saveStateAtBlockBoundary()
+{
+    std::lock_guard<std::mutex> stateLock(m_stateMutex);
+    if (m_stateData.empty())
+        m_stateData.resize(4096);
+
+    bool compiled = false;
+
+    runAtBlockBoundary([this, &compiled]() {
+        ysfx_t *fx = m_fx.get();
+        compiled = ysfx_is_compiled(fx);
+        if (!compiled)
+            return;
+
+        m_stateSliderCount = 0;
+        uint32_t indices[ysfx_max_sliders];
+        uint32_t count = ysfx_get_slider_indices(fx, indices, ysfx_max_sliders);
+        for (uint32_t i = 0; i < count; ++i)
+            m_stateSliders[m_stateSliderCount++] = {indices[i], ysfx_slider_get_value(fx, indices[i])};
+
+        // the vector keeps its capacity, so it only allocates when the state grows
+        ysfx_serial_buffer_t buffer{};
+        buffer.data = m_stateData.data();
+        buffer.capacity = m_stateData.size();
+        buffer.userdata = (intptr_t)&m_stateData;
+        buffer.grow = [](ysfx_serial_buffer_t *buffer, size_t capacity) -> bool {
+            std::vector<uint8_t> &data = *(std::vector<uint8_t> *)buffer->userdata;
+            data.resize(std::max(capacity, 2 * data.size()));
+            buffer->data = data.data();
+            buffer->capacity = data.size();
+            return true;
+        };
+        ysfx_save_serialized_state_to(fx, &buffer);
+        m_stateDataSize = buffer.size;
+        m_stateMemHighWater = ysfx_get_memory_high_water(fx);
+    });
+
+    if (!compiled)
+        return nullptr;
+
+    // the copy is made outside of the audio thread
+    ysfx_state_t view{m_stateSliders, m_stateSliderCount, m_stateData.data(), m_stateDataSize, m_stateMemHighWater};
+    return ysfx_state_dup(&view);
 }
 
 void YsfxProcessor::Impl::resetPresetInfo()
@@ -1109,12 +1590,18 @@ void YsfxProcessor::Impl::resetPresetInfo()
     YsfxCurrentPresetInfo::Ptr presetInfo{new YsfxCurrentPresetInfo()};
     presetInfo->m_lastChosenPreset = juce::String{""};
     std::atomic_store(&m_currentPresetInfo, presetInfo);
-    m_background->wakeUp();
+    notifyEditor();
 }
 
 //==============================================================================
 void YsfxProcessor::Impl::SliderNotificationUpdater::handleAsyncUpdate()
 {
+    // NOTE: a batch (eg. a preset load) does not notify the host one
+    //    parameter at a time, which floods it with automation and undo
+    //    entries; the editor is told quietly, and the host rereads all
+    //    values at once when it is told the program changed
+    bool batched = m_batched.exchange(false);
+
     int group_offset = 0;
     for (uint8_t group = 0; group < ysfx_max_slider_groups; group++) {
         uint64_t sliderMask = m_sliderMask[group].exchange(0);
@@ -1133,7 +1620,10 @@ void YsfxProcessor::Impl::SliderNotificationUpdater::handleAsyncUpdate()
         for (int i = 0; i < 64; ++i) {
             if (sliderMask & (uint64_t{1} << i)) {
                 YsfxParameter *param = m_impl->m_self->getYsfxParameter(i + group_offset);
-                param->sendValueChangedMessageToListeners(param->getValue());
+                if (batched)
+                    param->markValueChangedQuietly();
+                else
+                    param->sendValueChangedMessageToListeners(param->getValue());
             }
         }
         for (int i = 0; i < 64; ++i) {
@@ -1145,6 +1635,9 @@ void YsfxProcessor::Impl::SliderNotificationUpdater::handleAsyncUpdate()
 
         group_offset += 64;
     }
+
+    if (batched)
+        m_impl->m_self->updateHostDisplay(ChangeDetails().withProgramChanged(true));
 }
 
 //==============================================================================
@@ -1162,70 +1655,121 @@ void YsfxProcessor::Impl::ManualUndoPointUpdater::handleAsyncUpdate()
 YsfxProcessor::Impl::Background::Background(Impl *impl)
     : m_impl(impl)
 {
-    m_running.store(true, std::memory_order_relaxed);
-    m_thread = std::thread([this]() { run(); });
+    m_waker = impl->m_taskPool->addWaker(this, notifyTask, [this]() { run(); });
 }
 
 void YsfxProcessor::Impl::Background::shutdown()
 {
-    m_running.store(false, std::memory_order_relaxed);
-    m_sema.post();
-    m_thread.join();
+    TaskPool &pool = *m_impl->m_taskPool;
+    pool.removeWaker(m_waker);
+    m_waker = nullptr;
+    pool.cancel(this);
+    pool.cancel(m_impl);
 }
 
 void YsfxProcessor::Impl::Background::wakeUp()
 {
-    m_sema.post();
+    if (m_waker)
+        m_impl->m_taskPool->wake(m_waker);
 }
 
 void YsfxProcessor::Impl::Background::run()
 {
-    while (m_sema.wait(), m_running.load(std::memory_order_relaxed)) {
-        Impl *impl = this->m_impl;
-        Impl::SliderNotificationUpdater *updater = impl->m_sliderNotificationUpdater.get();
-        bool updatedAny = false;
-        for (uint8_t group = 0; group < ysfx_max_slider_groups; group++) {
-            if (uint64_t sliderMask = m_impl->m_sliderParamsToNotify[group].exchange(0)) {
-                uint64_t touchMask = m_impl->m_sliderParamsTouching[group].load();
-                updater->addSlidersToNotify(sliderMask, group);
-                updater->updateTouch(touchMask, group);
-                updatedAny = true;
-            }
-        }
-        if (updatedAny) updater->triggerAsyncUpdate();
-        if (m_impl->m_updateParamNames) {
-            m_impl->m_updateParamNames = false;
-            m_impl->m_deferredUpdateHostDisplay->triggerAsyncUpdate();
-        }
-        if (LoadRequest::Ptr loadRequest = std::atomic_exchange(&m_impl->m_loadRequest, LoadRequest::Ptr{}))
-            processLoadRequest(*loadRequest);
-        if (PresetRequest::Ptr presetRequest = std::atomic_exchange(&m_impl->m_presetRequest, PresetRequest::Ptr{}))
-            processPresetRequest(*presetRequest);
-        
-        if (m_impl->m_wantUndoPoint) {
-            m_impl->m_wantUndoPoint = false;
-            m_impl->pushUndoState();
-            Impl::ManualUndoPointUpdater *undoPointUpdater = m_impl->m_manualUndoPointUpdater.get();
-            undoPointUpdater->triggerAsyncUpdate();
+    ysfx_trace_thread_name("background");
+    ysfx_trace_begin("background");
+
+    Impl *impl = this->m_impl;
+    Impl::SliderNotificationUpdater *updater = impl->m_sliderNotificationUpdater.get();
+    bool updatedAny = m_impl->m_batchParamsToNotify.exchange(false);
+    if (updatedAny)
+        updater->setBatched();
+    const int numSliderGroups = m_impl->m_numSliderGroups.load();
+    for (uint8_t group = 0; group < numSliderGroups; group++) {
+        if (uint64_t sliderMask = m_impl->m_sliderParamsToNotify[group].exchange(0)) {
+            uint64_t touchMask = m_impl->m_sliderParamsTouching[group].load();
+            updater->addSlidersToNotify(sliderMask, group);
+            updater->updateTouch(touchMask, group);
+            updatedAny = true;
         }
+    }
+    if (updatedAny) updater->triggerAsyncUpdate();
+    if (m_impl->m_updateParamNames) {
+        m_impl->m_updateParamNames = false;
+        m_impl->m_deferredUpdateHostDisplay->triggerAsyncUpdate();
+    }
+    if (m_impl->m_editorDirty.exchange(false))
+        m_impl->m_editorUpdater.triggerAsyncUpdate();
+    postTasks();
 
-        if (m_impl->m_undoRequest == UndoRequest::wantUndo) {
-            m_impl->popUndoState();
-            m_impl->m_undoRequest = UndoRequest::noRequest;
-        }
+    ysfx_trace_end();
+}
 
-        if (m_impl->m_undoRequest == UndoRequest::wantRedo) {
-            m_impl->redoState();
-            m_impl->m_undoRequest = UndoRequest::noRequest;
-        }
+void YsfxProcessor::Impl::Background::postTasks()
+{
+    // the pool runs one task of this instance at a time, so these do not race;
+    //   each task takes its request when it starts, the latest one wins
+    TaskPool &pool = *m_impl->m_taskPool;
+
+    if (std::atomic_load(&m_impl->m_presetRequest)) {
+        pool.post(m_impl, presetTask, [this]() {
+            ysfx_trace_begin("preset task");
+            if (PresetRequest::Ptr presetRequest = std::atomic_exchange(&m_impl->m_presetRequest, PresetRequest::Ptr{}))
+                processPresetRequest(*presetRequest);
+            ysfx_trace_end();
+        });
+    }
+
+    if (m_impl->m_wantUndoPoint || m_impl->m_undoRequest != UndoRequest::noRequest) {
+        pool.post(m_impl, undoTask, [this]() {
+            ysfx_trace_begin("undo task");
+            if (m_impl->m_wantUndoPoint.exchange(false)) {
+                m_impl->pushUndoState();
+                Impl::ManualUndoPointUpdater *undoPointUpdater = m_impl->m_manualUndoPointUpdater.get();
+                undoPointUpdater->triggerAsyncUpdate();
+            }
+
+            UndoRequest undoRequest = m_impl->m_undoRequest.exchange(UndoRequest::noRequest);
+            if (undoRequest == UndoRequest::wantUndo)
+                m_impl->popUndoState();
+            else if (undoRequest == UndoRequest::wantRedo)
+                m_impl->redoState();
+            ysfx_trace_end();
+        });
+    }
+
+    if (std::atomic_load(&m_impl->m_loadRequest)) {
+        pool.post(m_impl, loadTask, [this]() {
+            ysfx_trace_begin("load task");
+            if (LoadRequest::Ptr loadRequest = std::atomic_exchange(&m_impl->m_loadRequest, LoadRequest::Ptr{}))
+                processLoadRequest(*loadRequest);
+            ysfx_trace_end();
+        });
     }
 }
 
 void YsfxProcessor::Impl::Background::processLoadRequest(LoadRequest &req)
 {
-    YsfxInfo::Ptr info = createNewFx(req.filePath.toUTF8(), req.initialState.get());
+    YsfxInfo::Ptr info;
+    bool adoptState = false;
+
+    if (req.incremental) {
+        // the current effect keeps running while the new code compiles;
+        // unchanged imports are shared with it, rather than parsed again
+        info = createNewFx(req.filePath.toUTF8(), nullptr, m_impl->m_lineProfiling.load());
+        ysfx_t *fx = info->effect.get();
+        ysfx_t *current = m_impl->m_fx.get();
+        if (ysfx_is_compiled(fx) && ysfx_is_compiled(current)) {
+            const uint32_t mustReload = ysfx_changed_header | (1u << ysfx_section_init);
+            adoptState = (ysfx_get_changed_sections(current, fx) & mustReload) == 0;
+        }
+        if (!adoptState && req.initialState)
+            ysfx_load_state(fx, req.initialState.get());
+    }
+    else
+        info = createNewFx(req.filePath.toUTF8(), req.initialState.get(), m_impl->m_lineProfiling.load());
+
     ysfx_bank_shared bank = m_impl->loadDefaultBank(info);
-    m_impl->installNewFx(info, bank);
+    m_impl->installNewFx(info, bank, adoptState);
 
     {
         const juce::ScopedLock sl(m_impl->m_loadLock);
@@ -1250,6 +1794,7 @@ void YsfxProcessor::Impl::Background::processLoadRequest(LoadRequest &req)
             m_impl->m_failedLoad.store(RetryState::ok);
         }
     }
+    m_impl->notifyEditor();
 
     std::lock_guard<std::mutex> lock(req.completionMutex);
     req.completion = true;
@@ -1262,8 +1807,10 @@ void YsfxProcessor::Impl::Background::processPresetRequest(PresetRequest &req)
     if (m_impl->m_info != req.info)
         return;
 
-    if (m_impl->m_bank != req.bank)
+    if (m_impl->m_bank != req.bank) {
         std::atomic_store(&m_impl->m_bank, req.bank);
+        m_impl->notifyEditor();
+    }
 
     ysfx_bank_t *bank = req.bank.get();
     
@@ -1271,8 +1818,10 @@ void YsfxProcessor::Impl::Background::processPresetRequest(PresetRequest &req)
         if (!bank || req.index >= bank->preset_count)
             return;
 
-        const ysfx_preset_t &preset = bank->presets[req.index];
-        m_impl->loadNewPreset(preset);
+        const ysfx_preset_t *preset = ysfx_bank_get_preset(bank, req.index);
+        if (!preset)
+            return;
+        m_impl->loadNewPreset(*preset);
     } else if (req.load == PresetLoadMode::deleteName) {
         m_impl->resetPresetInfo();
     }
@@ -17,6 +17,7 @@
 
 #pragma once
 #include "info.h"
+#include "utility/async_updater.h"
 #include <juce_audio_processors/juce_audio_processors.h>
 #include <memory>
 class YsfxParameter;
@@ -33,7 +34,13 @@ public:
     ~YsfxProcessor() override;
 
     YsfxParameter *getYsfxParameter(int sliderIndex);
+    // change a slider at a frame of the next block, from the audio thread, for the wrappers whose hosts send
+    //   timestamped events, like the direct events of CLAP or the parameter queues of VST3; the block is split there
+    bool setSliderParameterAt(int sliderIndex, float normValue, uint32_t sampleOffset);
     void loadJsfxFile(const juce::String &filePath, ysfx_state_t *initialState, bool async, bool preserveState);
+    void reloadJsfxCode(const juce::String &filePath);
+    // compile the effects with the probes of the lines, and sample them; it takes effect at the next load
+    void setLineProfiling(bool enable);
     void loadJsfxPreset(YsfxInfo::Ptr info, ysfx_bank_shared bank, uint32_t index, PresetLoadMode load, bool async);
     void popUndoState();
     void checkForUndoableChanges();
@@ -50,6 +57,9 @@ public:
     YsfxInfo::Ptr getCurrentInfo();
     YsfxCurrentPresetInfo::Ptr getCurrentPresetInfo();
     ysfx_bank_shared getCurrentBank();
+    // be called on the message thread when the info, preset, bank, undo or visible sliders change
+    void addEditorListener(better::AsyncUpdater::Listener *listener);
+    void removeEditorListener(better::AsyncUpdater::Listener *listener);
 
     //==========================================================================
     void prepareToPlay(double sampleRate, int samplesPerBlock) override;
@@ -0,0 +1,53 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+#pragma once
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#   define YSFX_OPAQUE_COPY_SSE2 1
+#   include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64) || defined(__ARM_NEON)
+#   define YSFX_OPAQUE_COPY_NEON 1
+#   include <arm_neon.h>
+#endif
+
+// copy a row of 32-bit ARGB pixels, setting the alpha channel to 255
+//   the alpha is the high byte of the native pixel word, like JUCE's PixelARGB
+inline void copyPixelsOpaque(const uint8_t *src, uint8_t *dst, int count)
+{
+    int i = 0;
+#if defined(YSFX_OPAQUE_COPY_SSE2)
+    const __m128i alpha = _mm_set1_epi32((int)0xFF000000u);
+    for (; i + 4 <= count; i += 4) {
+        __m128i p = _mm_loadu_si128((const __m128i *)&src[4 * i]);
+        _mm_storeu_si128((__m128i *)&dst[4 * i], _mm_or_si128(p, alpha));
+    }
+#elif defined(YSFX_OPAQUE_COPY_NEON)
+    const uint32x4_t alpha = vdupq_n_u32(0xFF000000u);
+    for (; i + 4 <= count; i += 4) {
+        uint32x4_t p = vreinterpretq_u32_u8(vld1q_u8(&src[4 * i]));
+        vst1q_u8(&dst[4 * i], vreinterpretq_u8_u32(vorrq_u32(p, alpha)));
+    }
+#endif
+    for (; i < count; ++i) {
+        uint32_t pixel;
+        memcpy(&pixel, &src[4 * i], 4);
+        pixel |= 0xFF000000u;
+        memcpy(&dst[4 * i], &pixel, 4);
+    }
+}
@@ -0,0 +1,192 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "task_pool.h"
+#include "rt_semaphore.h"
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+struct TaskPool::Waker {
+    const void *owner = nullptr;
+    int priority = 0;
+    std::function<void()> task;
+    std::atomic<bool> woken{false};
+};
+
+struct TaskPool::Impl {
+    struct Task {
+        const void *owner = nullptr;
+        int priority = 0;
+        uint64_t sequence = 0;
+        std::function<void()> function;
+    };
+
+    void run();
+    void dispatch(TaskPool *pool);
+    bool isRunning(const void *owner) const;
+
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::vector<Task> queue;
+    // the owners which have a task in progress
+    std::vector<const void *> running;
+    uint64_t nextSequence = 0;
+    bool quit = false;
+    std::vector<std::thread> threads;
+
+    // the thread which posts the tasks of the wakers, since those cannot lock
+    std::mutex wakerMutex;
+    std::vector<std::unique_ptr<Waker>> wakers;
+    RTSemaphore wakerSema;
+    std::atomic<bool> wakerQuit{false};
+    std::thread dispatcher;
+};
+
+TaskPool::TaskPool()
+    : m_impl{new Impl}
+{
+    // leave some of the machine to the audio threads of the host;
+    //   at least two, since a frame of @gfx may block on its menu
+    unsigned numThreads = std::max(2u, std::min(4u, std::thread::hardware_concurrency() / 2));
+    for (unsigned i = 0; i < numThreads; ++i)
+        m_impl->threads.emplace_back([this]() { m_impl->run(); });
+    m_impl->dispatcher = std::thread([this]() { m_impl->dispatch(this); });
+}
+
+TaskPool::~TaskPool()
+{
+    m_impl->wakerQuit.store(true);
+    m_impl->wakerSema.post();
+    m_impl->dispatcher.join();
+
+    {
+        std::lock_guard<std::mutex> lock(m_impl->mutex);
+        m_impl->quit = true;
+    }
+    m_impl->cond.notify_all();
+    for (std::thread &thread : m_impl->threads)
+        thread.join();
+}
+
+void TaskPool::post(const void *owner, int priority, std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_impl->mutex);
+        auto it = std::find_if(m_impl->queue.begin(), m_impl->queue.end(), [owner, priority](const Impl::Task &t) {
+            return t.owner == owner && t.priority == priority;
+        });
+        if (it != m_impl->queue.end())
+            it->function = std::move(task);
+        else
+            m_impl->queue.push_back(Impl::Task{owner, priority, m_impl->nextSequence++, std::move(task)});
+    }
+    m_impl->cond.notify_all();
+}
+
+void TaskPool::cancel(const void *owner)
+{
+    std::unique_lock<std::mutex> lock(m_impl->mutex);
+    m_impl->queue.erase(std::remove_if(m_impl->queue.begin(), m_impl->queue.end(), [owner](const Impl::Task &t) {
+        return t.owner == owner;
+    }), m_impl->queue.end());
+    m_impl->cond.wait(lock, [this, owner]() { return !m_impl->isRunning(owner); });
+}
+
+TaskPool::Waker *TaskPool::addWaker(const void *owner, int priority, std::function<void()> task)
+{
+    std::unique_ptr<Waker> waker{new Waker};
+    waker->owner = owner;
+    waker->priority = priority;
+    waker->task = std::move(task);
+
+    Waker *result = waker.get();
+    std::lock_guard<std::mutex> lock(m_impl->wakerMutex);
+    m_impl->wakers.push_back(std::move(waker));
+    return result;
+}
+
+void TaskPool::removeWaker(Waker *waker)
+{
+    // after this, the dispatcher does not post it anymore
+    std::lock_guard<std::mutex> lock(m_impl->wakerMutex);
+    auto it = std::find_if(m_impl->wakers.begin(), m_impl->wakers.end(), [waker](const std::unique_ptr<Waker> &w) {
+        return w.get() == waker;
+    });
+    if (it != m_impl->wakers.end())
+        m_impl->wakers.erase(it);
+}
+
+void TaskPool::wake(Waker *waker)
+{
+    waker->woken.store(true);
+    m_impl->wakerSema.post();
+}
+
+void TaskPool::Impl::dispatch(TaskPool *pool)
+{
+    while (wakerSema.wait(), !wakerQuit.load()) {
+        std::lock_guard<std::mutex> lock(wakerMutex);
+        for (const std::unique_ptr<Waker> &waker : wakers) {
+            if (waker->woken.exchange(false))
+                pool->post(waker->owner, waker->priority, waker->task);
+        }
+    }
+}
+
+bool TaskPool::Impl::isRunning(const void *owner) const
+{
+    return std::find(running.begin(), running.end(), owner) != running.end();
+}
+
+void TaskPool::Impl::run()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        // the most urgent task, among the owners which are not busy
+        auto next = queue.end();
+        cond.wait(lock, [this, &next]() {
+            next = queue.end();
+            for (auto it = queue.begin(); it != queue.end(); ++it) {
+                if (isRunning(it->owner))
+                    continue;
+                if (next == queue.end() || it->priority < next->priority ||
+                    (it->priority == next->priority && it->sequence < next->sequence))
+                    next = it;
+            }
+            return quit || next != queue.end();
+        });
+        if (next == queue.end())
+            break;
+
+        Task task = std::move(*next);
+        queue.erase(next);
+        running.push_back(task.owner);
+        lock.unlock();
+
+        task.function();
+        task.function = nullptr;
+
+        lock.lock();
+        running.erase(std::find(running.begin(), running.end(), task.owner));
+        cond.notify_all();
+    }
+}
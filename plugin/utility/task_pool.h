@@ -0,0 +1,46 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+#include <functional>
+#include <memory>
+
+// a small pool of threads, shared by the instances of the plugin and their
+// editors, which runs the background work of each by priority, lowest value first;
+// it starts with the first instance, and its size does not depend on their count
+//   use it as `juce::SharedResourcePointer<TaskPool>`
+//   the tasks of the same owner run one at a time, in order of priority;
+//   a task posted again at the same priority replaces the one which waits
+class TaskPool {
+public:
+    TaskPool();
+    ~TaskPool();
+    void post(const void *owner, int priority, std::function<void()> task);
+    // drop the tasks of the owner which wait, and wait for the one which runs
+    void cancel(const void *owner);
+
+    // a task which is posted again whenever it is woken; the waking is
+    //   real-time safe, so the audio thread can do it
+    struct Waker;
+    Waker *addWaker(const void *owner, int priority, std::function<void()> task);
+    void removeWaker(Waker *waker);
+    void wake(Waker *waker);
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> m_impl;
+};
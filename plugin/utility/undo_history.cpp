@@ -0,0 +1,148 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+#include "undo_history.h"
+#include <algorithm>
+#include <cstring>
+
+static uint64_t hashBytes(const uint8_t *data, size_t size, uint64_t seed)
+{
+    uint64_t h = seed ^ (size * UINT64_C(0x9E3779B97F4A7C15));
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t w;
+        std::memcpy(&w, &data[i], 8);
+        h = (h ^ w) * UINT64_C(0xff51afd7ed558ccd);
+        h ^= h >> 32;
+    }
+    for (; i < size; ++i)
+        h = (h ^ data[i]) * UINT64_C(0x100000001b3);
+    return h;
+}
+
+static uint64_t hashCombine(uint64_t h, uint64_t v)
+{
+    return (h ^ v) * UINT64_C(0xc4ceb9fe1a85ec53) + (h >> 29);
+}
+
+UndoHistory::UndoHistory(size_t chunkSize)
+    : m_chunkSize(std::max<size_t>(1, chunkSize))
+{
+}
+
+UndoHistory::Snapshot UndoHistory::capture(const ysfx_state_t *state)
+{
+    Snapshot snapshot;
+    snapshot.sliders.assign(state->sliders, state->sliders + state->slider_count);
+    snapshot.dataSize = state->data_size;
+
+    uint64_t hash = 0;
+    for (const ysfx_state_slider_t &slider : snapshot.sliders) {
+        uint8_t bytes[sizeof(slider.index) + sizeof(slider.value)];
+        std::memcpy(bytes, &slider.index, sizeof(slider.index));
+        std::memcpy(bytes + sizeof(slider.index), &slider.value, sizeof(slider.value));
+        hash = hashCombine(hash, hashBytes(bytes, sizeof(bytes), 0));
+    }
+
+    snapshot.chunks.reserve((state->data_size + m_chunkSize - 1) / m_chunkSize);
+    for (size_t pos = 0; pos < state->data_size; pos += m_chunkSize) {
+        const uint8_t *data = state->data + pos;
+        size_t size = std::min(m_chunkSize, state->data_size - pos);
+        uint64_t chunkHash = hashBytes(data, size, 0);
+        hash = hashCombine(hash, chunkHash);
+
+        // share the chunk which has the same contents, if there is one
+        std::weak_ptr<const Chunk> &entry = m_chunks[chunkHash];
+        ChunkPtr chunk = entry.lock();
+        if (!chunk || chunk->data.size() != size || std::memcmp(chunk->data.data(), data, size) != 0) {
+            std::shared_ptr<Chunk> fresh{new Chunk};
+            fresh->hash = chunkHash;
+            fresh->data.assign(data, data + size);
+            if (!chunk)
+                entry = fresh;
+            chunk = std::move(fresh);
+        }
+        snapshot.chunks.push_back(std::move(chunk));
+    }
+
+    snapshot.hash = hash;
+    return snapshot;
+}
+
+bool UndoHistory::isEqual(const Snapshot &a, const Snapshot &b)
+{
+    if (a.hash != b.hash || a.dataSize != b.dataSize || a.sliders.size() != b.sliders.size())
+        return false;
+    for (size_t i = 0; i < a.sliders.size(); ++i) {
+        if (a.sliders[i].index != b.sliders[i].index || a.sliders[i].value != b.sliders[i].value)
+            return false;
+    }
+    if (a.chunks.size() != b.chunks.size())
+        return false;
+    for (size_t i = 0; i < a.chunks.size(); ++i) {
+        // the chunks which were found in the history are the same objects
+        const Chunk &x = *a.chunks[i];
+        const Chunk &y = *b.chunks[i];
+        if (&x != &y && (x.hash != y.hash || x.data != y.data))
+            return false;
+    }
+    return true;
+}
+
+void UndoHistory::push(Snapshot snapshot)
+{
+    m_snapshots.push_back(std::move(snapshot));
+}
+
+void UndoHistory::truncate(size_t size)
+{
+    if (size < m_snapshots.size()) {
+        m_snapshots.erase(m_snapshots.begin() + static_cast<std::ptrdiff_t>(size), m_snapshots.end());
+        forgetUnusedChunks();
+    }
+}
+
+void UndoHistory::popFront()
+{
+    if (!m_snapshots.empty()) {
+        m_snapshots.pop_front();
+        forgetUnusedChunks();
+    }
+}
+
+void UndoHistory::clear()
+{
+    m_snapshots.clear();
+    m_chunks.clear();
+}
+
+void UndoHistory::getData(const Snapshot &snapshot, std::vector<uint8_t> &data)
+{
+    data.clear();
+    data.reserve(snapshot.dataSize);
+    for (const ChunkPtr &chunk : snapshot.chunks)
+        data.insert(data.end(), chunk->data.begin(), chunk->data.end());
+}
+
+void UndoHistory::forgetUnusedChunks()
+{
+    for (auto it = m_chunks.begin(); it != m_chunks.end(); ) {
+        if (it->second.expired())
+            it = m_chunks.erase(it);
+        else
+            ++it;
+    }
+}
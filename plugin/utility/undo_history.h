@@ -0,0 +1,69 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+#pragma once
+#include "ysfx.h"
+#include <memory>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <cstdint>
+
+// a history of states, where the snapshots share the chunks of serialized
+//   data which they have in common, so each one costs only what changed
+class UndoHistory {
+public:
+    explicit UndoHistory(size_t chunkSize = 4096);
+
+    struct Chunk {
+        uint64_t hash = 0;
+        std::vector<uint8_t> data;
+    };
+    using ChunkPtr = std::shared_ptr<const Chunk>;
+
+    struct Snapshot {
+        std::vector<ysfx_state_slider_t> sliders;
+        std::vector<ChunkPtr> chunks;
+        size_t dataSize = 0;
+        // combines the hashes of the sliders and of the chunks
+        uint64_t hash = 0;
+    };
+
+    // make a snapshot of the state, with the chunks which the history already has
+    Snapshot capture(const ysfx_state_t *state);
+    // compare snapshots; after a capture, equal data has the same chunks
+    static bool isEqual(const Snapshot &a, const Snapshot &b);
+
+    size_t size() const { return m_snapshots.size(); }
+    const Snapshot &operator[](size_t index) const { return m_snapshots[index]; }
+    void push(Snapshot snapshot);
+    // remove the snapshots at `size` and after
+    void truncate(size_t size);
+    void popFront();
+    void clear();
+
+    // put together the serialized data of a snapshot
+    static void getData(const Snapshot &snapshot, std::vector<uint8_t> &data);
+
+private:
+    void forgetUnusedChunks();
+
+private:
+    size_t m_chunkSize = 0;
+    std::deque<Snapshot> m_snapshots;
+    // the chunks by hash, while some snapshot holds them
+    std::unordered_map<uint64_t, std::weak_ptr<const Chunk>> m_chunks;
+};
@@ -32,18 +32,14 @@
 #include "WDL/lice/lice.h"
 #include "WDL/wdltypes.h"
 
-static LICE_IBitmap *LICE_LoadSTB(const char *filename, LICE_IBitmap *bmp)
+// convert the decoded pixels, and release them
+static LICE_IBitmap *LICE_LoadSTBPixels(stbi_uc *srcpx, unsigned w, unsigned h, LICE_IBitmap *bmp)
 {
     LICE_IBitmap *delbmp = nullptr;
-    stbi_uc *srcpx = nullptr;
     LICE_pixel *dstpx = nullptr;
     bool dstflip = false;
     unsigned dstspan = 0;
-    unsigned w = 0;
-    unsigned h = 0;
-    unsigned ch = 0;
 
-    srcpx = stbi_load(filename, (int *)&w, (int *)&h, (int *)&ch, 4);
     if (!srcpx)
         goto fail;
 
@@ -74,3 +70,21 @@ fail:
     stbi_image_free(srcpx);
     return nullptr;
 }
+
+static LICE_IBitmap *LICE_LoadSTB(const char *filename, LICE_IBitmap *bmp)
+{
+    unsigned w = 0;
+    unsigned h = 0;
+    unsigned ch = 0;
+    stbi_uc *srcpx = stbi_load(filename, (int *)&w, (int *)&h, (int *)&ch, 4);
+    return LICE_LoadSTBPixels(srcpx, w, h, bmp);
+}
+
+static inline LICE_IBitmap *LICE_LoadSTBFromMemory(const void *data, int size, LICE_IBitmap *bmp)
+{
+    unsigned w = 0;
+    unsigned h = 0;
+    unsigned ch = 0;
+    stbi_uc *srcpx = stbi_load_from_memory((const stbi_uc *)data, size, (int *)&w, (int *)&h, (int *)&ch, 4);
+    return LICE_LoadSTBPixels(srcpx, w, h, bmp);
+}
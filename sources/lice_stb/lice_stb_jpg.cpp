@@ -23,6 +23,11 @@ LICE_IBitmap *LICE_LoadJPG(const char *filename, LICE_IBitmap *bmp)
     return LICE_LoadSTB(filename, bmp);
 }
 
+LICE_IBitmap *LICE_LoadJPGFromMemory(const void *data_in, int buflen, LICE_IBitmap *bmp)
+{
+    return LICE_LoadSTBFromMemory(data_in, buflen, bmp);
+}
+
 class LICE_stb_JPGLoader
 {
     _LICE_ImageLoader_rec rec;
@@ -0,0 +1,124 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+#pragma once
+#include <memory>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+namespace ysfx {
+
+//------------------------------------------------------------------------------
+// bounded_queue: A lock-free bounded queue, with multiple producers and a single consumer
+//
+// Each slot carries a sequence number, which tells whether the slot is free for
+// the producers of a given round, or holds a value for the consumer. A producer
+// claims a slot by advancing the write position, and publishes it by updating
+// the sequence; the consumer waits for the slot at its position to be published.
+//
+// The capacity is rounded up to a power of 2. Reserving is not thread-safe, it
+// must not happen while other threads push or pop.
+
+template <class T>
+class bounded_queue {
+public:
+    // allocate at least the given number of slots, discarding the values, or remove the slots if 0
+    void reserve(uint32_t capacity)
+    {
+        if (capacity == 0) {
+            slots_.reset();
+            mask_ = 0;
+        }
+        else {
+            size_t size = 1;
+            while (size < capacity)
+                size <<= 1;
+            slots_.reset(new slot[size]);
+            mask_ = size - 1;
+            for (size_t i = 0; i < size; ++i)
+                slots_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        write_pos_.store(0, std::memory_order_relaxed);
+        read_pos_ = 0;
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    // get the number of slots
+    uint32_t capacity() const
+    {
+        return slots_ ? (uint32_t)(mask_ + 1) : 0;
+    }
+
+    // push a value from any thread, and return false if the queue is full
+    bool push(const T &value)
+    {
+        if (!slots_)
+            return false;
+
+        // claim a slot, by advancing the write position over a free one
+        slot *s;
+        size_t pos = write_pos_.load(std::memory_order_relaxed);
+        for (;;) {
+            s = &slots_[pos & mask_];
+            size_t sequence = s->sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+            if (diff == 0) {
+                if (write_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0)
+                return false;
+            else
+                pos = write_pos_.load(std::memory_order_relaxed);
+        }
+
+        s->value = value;
+        s->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // pop a value from the consumer thread, and return false if there is none
+    bool pop(T &value)
+    {
+        if (!slots_)
+            return false;
+
+        size_t pos = read_pos_;
+        slot *s = &slots_[pos & mask_];
+        if (s->sequence.load(std::memory_order_acquire) != pos + 1)
+            return false;
+
+        value = s->value;
+        // release the slot for the producers of the next round
+        s->sequence.store(pos + mask_ + 1, std::memory_order_release);
+        read_pos_ = pos + 1;
+        return true;
+    }
+
+private:
+    struct slot {
+        std::atomic<size_t> sequence{0};
+        T value{};
+    };
+
+    std::unique_ptr<slot[]> slots_;
+    size_t mask_ = 0;
+    std::atomic<size_t> write_pos_{0};
+    size_t read_pos_ = 0;
+};
+
+} // namespace ysfx
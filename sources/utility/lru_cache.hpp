@@ -0,0 +1,77 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+#pragma once
+#include <list>
+#include <unordered_map>
+#include <utility>
+#include <cstddef>
+
+namespace ysfx {
+
+//------------------------------------------------------------------------------
+// lru_cache: A map of bounded size, which forgets the least recently used entry
+//
+// It's not thread-safe; the user serializes the access.
+
+template <class K, class V, class Hash = std::hash<K>>
+class lru_cache {
+public:
+    explicit lru_cache(size_t capacity) : capacity_(capacity ? capacity : 1) {}
+
+    // find the value of a key, and mark it as the most recently used
+    V *find(const K &key)
+    {
+        auto it = index_.find(key);
+        if (it == index_.end())
+            return nullptr;
+        entries_.splice(entries_.begin(), entries_, it->second);
+        return &it->second->second;
+    }
+
+    // put a value for a key, and forget the least recently used if it's full
+    void insert(const K &key, const V &value)
+    {
+        auto it = index_.find(key);
+        if (it != index_.end()) {
+            it->second->second = value;
+            entries_.splice(entries_.begin(), entries_, it->second);
+            return;
+        }
+        if (entries_.size() >= capacity_) {
+            index_.erase(entries_.back().first);
+            entries_.pop_back();
+        }
+        entries_.emplace_front(key, value);
+        index_.emplace(key, entries_.begin());
+    }
+
+    void clear()
+    {
+        index_.clear();
+        entries_.clear();
+    }
+
+    size_t size() const { return entries_.size(); }
+
+private:
+    using entry = std::pair<K, V>;
+    size_t capacity_ = 0;
+    std::list<entry> entries_;
+    std::unordered_map<K, typename std::list<entry>::iterator, Hash> index_;
+};
+
+} // namespace ysfx
@@ -0,0 +1,82 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+namespace ysfx {
+
+//------------------------------------------------------------------------------
+// triple_buffer: A lock-free exchange of the latest value, from one writer to one reader
+//
+// The writer fills the `back` slot and publishes it, the reader owns the `front`
+// slot, and they exchange their slots with the `middle` one, which carries a bit
+// when it holds a value the reader has not taken yet. Neither side ever waits;
+// the values which the reader misses are overwritten.
+//
+// The slots are reached by index for sizing them, which is not thread-safe, and
+// must not happen while the writer or the reader use the buffer.
+
+template <class T>
+class triple_buffer {
+public:
+    // get the slot which the writer fills
+    T &back() { return slots_[back_]; }
+
+    // publish the slot of the writer, which gets another
+    void publish()
+    {
+        back_ = middle_.exchange(back_ | fresh, std::memory_order_acq_rel) & index_mask;
+    }
+
+    // take the value published last, and return false if there is none since the last time
+    bool update()
+    {
+        if (!(middle_.load(std::memory_order_relaxed) & fresh))
+            return false;
+        front_ = middle_.exchange(front_, std::memory_order_acq_rel) & index_mask;
+        return true;
+    }
+
+    // get the slot which the reader owns
+    T &front() { return slots_[front_]; }
+    const T &front() const { return slots_[front_]; }
+
+    // get any of the 3 slots
+    T &operator[](uint32_t index) { return slots_[index]; }
+
+    // forget what was published, keeping the values of the slots
+    void reset()
+    {
+        back_ = 0;
+        front_ = 1;
+        middle_.store(2, std::memory_order_release);
+    }
+
+private:
+    enum : uint32_t {
+        index_mask = 3,
+        fresh = 4,
+    };
+
+    T slots_[3]{};
+    uint32_t back_ = 0;
+    uint32_t front_ = 1;
+    std::atomic<uint32_t> middle_{2};
+};
+
+} // namespace ysfx
@@ -20,14 +20,22 @@
 
 #include "ysfx.hpp"
 #include "ysfx_config.hpp"
+#include "ysfx_cache.hpp"
+#include "ysfx_package.hpp"
+#include "ysfx_import_index.hpp"
 #include "ysfx_eel_utils.hpp"
 #include "ysfx_api_eel.hpp"
 #include "ysfx_preprocess.hpp"
+#include "ysfx_convert.hpp"
+#include "ysfx_trace.hpp"
+#include "ysfx_snapshot.hpp"
+#include "ysfx_capability.hpp"
 #include "ysfx_api_host_interaction_dummy.hpp"
 #include <type_traits>
 #include <algorithm>
 #include <functional>
 #include <deque>
+#include <thread>
 #include <set>
 #include <new>
 #include <map>
@@ -36,15 +44,12 @@
 #include <cstring>
 #include <cassert>
 #include <cmath>
+#include <chrono>
 
 
 static_assert(std::is_same<EEL_F, ysfx_real>::value,
               "ysfx_real is incorrectly defined");
 
-enum {
-    ysfx_max_file_handles = 64, // change if it needs more
-};
-
 //------------------------------------------------------------------------------
 static thread_local ysfx_thread_id_t ysfx_thread_id;
 
@@ -75,6 +80,9 @@ ysfx_api_initializer::ysfx_api_initializer()
     ysfx_api_init_eel();
     ysfx_api_init_reaper();
     ysfx_api_init_file();
+    ysfx_api_init_analyzer();
+    ysfx_api_init_convolve();
+    ysfx_api_init_lookahead();
     ysfx_api_init_gfx();
     ysfx_api_init_host_interaction();
 }
@@ -99,6 +107,42 @@ EEL_F *registerVariable(ysfx_u *fx, NSEEL_VMCTX ctx, const char* name) {
 };
 
 //------------------------------------------------------------------------------
+static void ysfx_push_free_file_slot(ysfx_t *fx, uint32_t index)
+{
+    std::atomic<uint64_t> &head = fx->file.free_head;
+    uint64_t old = head.load();
+    uint64_t next;
+    do {
+        fx->file.slots[index].next_free.store((uint32_t)old);
+        next = ((old >> 32) + 1) << 32 | (index + 1);
+    } while (!head.compare_exchange_weak(old, next));
+}
+
+static int32_t ysfx_pop_free_file_slot(ysfx_t *fx)
+{
+    std::atomic<uint64_t> &head = fx->file.free_head;
+    uint64_t old = head.load();
+    uint64_t next;
+    do {
+        uint32_t top = (uint32_t)old;
+        if (top == 0)
+            return -1;
+        next = ((old >> 32) + 1) << 32 | fx->file.slots[top - 1].next_free.load();
+    } while (!head.compare_exchange_weak(old, next));
+    return (int32_t)(uint32_t)old - 1;
+}
+
+// make all slots free except the serializer's, the lowest at the top
+static void ysfx_reset_free_file_slots(ysfx_t *fx)
+{
+    fx->file.free_head.store(0);
+    for (uint32_t i = ysfx_max_file_handles; i-- > 1; )
+        ysfx_push_free_file_slot(fx, i);
+}
+
+static void ysfx_update_samples_per_beat(ysfx_t *fx);
+static void ysfx_wait_background_init(ysfx_t *fx);
+
 ysfx_t *ysfx_new(ysfx_config_t *config)
 {
     ysfx_u fx{new ysfx_t};
@@ -120,10 +164,6 @@ ysfx_t *ysfx_new(ysfx_config_t *config)
 
     ysfx_eel_string_initvm(vm);
 
-#if !defined(YSFX_NO_GFX)
-    fx->gfx.state.reset(ysfx_gfx_state_new(fx.get()));
-#endif
-
     auto var_resolver = [](void *userdata, const char *name) -> EEL_F * {
         ysfx_t *fx = (ysfx_t *)userdata;
 
@@ -138,38 +178,49 @@ ysfx_t *ysfx_new(ysfx_config_t *config)
     };
     NSEEL_VM_set_var_resolver(vm, var_resolver, fx.get());
 
-    for (uint32_t i = 0; i < ysfx_max_channels; ++i) {
+    // the variables which processing touches on every block are registered first,
+    // since the VM stores them in the order of registration, it keeps them together
+    fx->var.spl.reserve(ysfx_fixed_channels);
+    for (uint32_t i = 0; i < ysfx_fixed_channels; ++i) {
         std::string name = "spl" + std::to_string(i);
         EEL_F *var = registerVariable(&fx, vm, name.c_str());
-        *(fx->var.spl[i] = var) = 0;
-    }
-    for (uint32_t i = 0; i < ysfx_max_sliders; ++i) {
-        std::string name = "slider" + std::to_string(i + 1);
-        EEL_F *var = registerVariable(&fx, vm, name.c_str());
-        *(fx->var.slider[i] = var) = 0;
-        fx->slider_of_var[var] = i;
+        *var = 0;
+        fx->var.spl.push_back(var);
     }
 
     #define AUTOVAR(name, value) *(fx->var.name = registerVariable(&fx, vm, #name)) = (value)
-    AUTOVAR(srate, fx->sample_rate);
     AUTOVAR(num_ch, fx->valid_input_channels);
     AUTOVAR(samplesblock, fx->block_size);
     AUTOVAR(trigger, 0);
     AUTOVAR(tempo, 120);
     AUTOVAR(play_state, 1);
     AUTOVAR(play_position, 0);
+    AUTOVAR(play_offline, 0);
     AUTOVAR(beat_position, 0);
     AUTOVAR(ts_num, 0);
     AUTOVAR(ts_denom, 4);
-    AUTOVAR(ext_noinit, 0);
     AUTOVAR(ext_nodenorm, 0);
     AUTOVAR(ext_midi_bus, 0);
     AUTOVAR(midi_bus, 0);
+    AUTOVAR(srate, fx->sample_rate);
+    AUTOVAR(ext_noinit, 0);
     AUTOVAR(pdc_delay, 0);
     AUTOVAR(pdc_bot_ch, 0);
     AUTOVAR(pdc_top_ch, 0);
     AUTOVAR(pdc_midi, 0);
-    // gfx variables
+
+    for (uint32_t i = 0; i < ysfx_max_sliders; ++i) {
+        std::string name = "slider" + std::to_string(i + 1);
+        EEL_F *var = registerVariable(&fx, vm, name.c_str());
+        *(fx->var.slider[i] = var) = 0;
+        fx->slider_of_var.emplace_back(var, i);
+    }
+    std::sort(fx->slider_of_var.begin(), fx->slider_of_var.end());
+
+    // gfx variables, which the state of gfx registers first
+#if !defined(YSFX_NO_GFX)
+    fx->gfx.state.reset(ysfx_gfx_state_new(fx.get()));
+#endif
     AUTOVAR(gfx_r, 0);
     AUTOVAR(gfx_g, 0);
     AUTOVAR(gfx_b, 0);
@@ -193,21 +244,44 @@ ysfx_t *ysfx_new(ysfx_config_t *config)
 
     fx->midi.in.reset(new ysfx_midi_buffer_t);
     fx->midi.out.reset(new ysfx_midi_buffer_t);
+    fx->split.midi_in.reset(new ysfx_midi_buffer_t);
+    fx->split.midi_out.reset(new ysfx_midi_buffer_t);
+    fx->midi.event.reset(new ysfx_midi_buffer_t);
+    fx->midi.queue.reset(new ysfx_midi_queue_t);
+    fx->split.slider_events.reserve(ysfx_max_sliders);
+    fx->split.trigger_events.reserve(4 * ysfx_max_triggers);
+    fx->slider.ramping.reserve(ysfx_max_sliders);
+    fx->split.points.reserve(1024);
     ysfx_set_midi_capacity(fx.get(), 1024, true);
 
-    fx->file.list.reserve(16);
-    fx->file.list.emplace_back(new ysfx_serializer_t(fx->vm.get()));
+    fx->file.slots[0].file.reset(new ysfx_serializer_t(fx->vm.get()));
+    ysfx_reset_free_file_slots(fx.get());
+    ysfx_update_samples_per_beat(fx.get());
 
     return fx.release();
 }
 
+// stop preparing the variants of config items, and release them
+static void ysfx_forget_config_variants(ysfx_t *fx)
+{
+    fx->variant.cancel.store(true);
+    fx->variant.worker.reset();
+    fx->variant.cancel.store(false);
+
+    std::lock_guard<ysfx::mutex> lock{fx->variant.mutex};
+    fx->variant.values.clear();
+    fx->variant.cache.clear();
+}
+
 void ysfx_free(ysfx_t *fx)
 {
     if (!fx)
         return;
 
-    if (fx->ref_count.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    if (fx->ref_count.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        ysfx_forget_config_variants(fx);
         delete fx;
+    }
 }
 
 void ysfx_add_ref(ysfx_t *fx)
@@ -220,10 +294,380 @@ ysfx_config_t *ysfx_get_config(ysfx_t *fx)
     return fx->config.get();
 }
 
+// a source file, open on disk or read from a package
+struct ysfx_source_file_t {
+    ysfx::FILE_u stream;
+    ysfx_package_data_sp packaged;
+    ysfx::file_uid uid{};
+    // the key of the entry in the package, or empty on disk
+    std::string entry;
+};
+
+static bool ysfx_open_source_file(const char *filepath, ysfx_source_file_t &file)
+{
+    file.packaged = ysfx_package_read(filepath);
+    if (file.packaged) {
+        file.uid = file.packaged->package->uid;
+        file.entry = file.packaged->entry->key;
+        return true;
+    }
+    file.stream.reset(ysfx::fopen_utf8(filepath, "rb"));
+    return file.stream && ysfx::get_stream_file_uid(file.stream.get(), file.uid);
+}
+
+// get a parsed file from the registry, from the cache on disk, or by parsing it;
+// the preprocessor values are those of the main file, or null if it's the main file
+static ysfx_parsed_unit_sp ysfx_parse_unit(ysfx_t *fx, ysfx_load_record_t &record, const char *filepath, const ysfx_source_file_t &file, const std::map<std::string, ysfx_real> *preprocessor_values)
+{
+    ysfx_config_t &config = *fx->config;
+    ysfx_load_stats_t &stats = record.stats;
+
+    // count the file, and the time it took on any outcome
+    const uint64_t file_begin = ysfx::monotonic_ns();
+    auto file_guard = ysfx::defer([&record, filepath, file_begin]() {
+        ysfx_load_stats_t &stats = record.stats;
+        uint64_t file_ns = ysfx::monotonic_ns() - file_begin;
+        stats.num_files += 1;
+        if (file_ns >= stats.slowest_file_ns) {
+            stats.slowest_file_ns = file_ns;
+            record.slowest_file.assign(filepath);
+        }
+    });
+
+    // the configuration of the main file comes from itself, so it's not part of the key
+    ysfx_cache_key_t key;
+    std::string key_string;
+    bool keyed;
+    {
+        ysfx::scoped_timer timer{stats.io_ns};
+        ysfx_trace_scope trace{"io", "load"};
+        const std::map<std::string, ysfx_real> &values = preprocessor_values ? *preprocessor_values : std::map<std::string, ysfx_real>{};
+        keyed = true;
+        if (file.packaged)
+            ysfx_cache_make_package_key(config, file.uid, file.packaged->package->stamp, file.entry, values, key);
+        else
+            keyed = ysfx_cache_make_key(config, file.stream.get(), file.uid, values, key);
+    }
+    if (keyed) {
+        key_string = ysfx_cache_key_string(key);
+        if (ysfx_parsed_unit_sp unit = ysfx_registry_find(key_string)) {
+            stats.num_cached_files += 1;
+            return unit;
+        }
+    }
+
+    std::shared_ptr<ysfx_parsed_unit_t> unit{new ysfx_parsed_unit_t};
+
+    bool cached = false;
+    if (keyed) {
+        ysfx::scoped_timer timer{stats.io_ns};
+        ysfx_trace_scope trace{"io", "load"};
+        cached = ysfx_cache_load(config, key_string, *unit);
+    }
+
+    if (cached)
+        stats.num_cached_files += 1;
+    else {
+        ysfx_parse_error error;
+
+        // read the file whole, so the time of I/O is apart from the rest
+        std::string text;
+        {
+            ysfx::scoped_timer timer{stats.io_ns};
+            ysfx_trace_scope trace{"io", "load"};
+            if (file.packaged)
+                text.assign((const char *)file.packaged->data, file.packaged->size);
+            else {
+                FILE *stream = file.stream.get();
+                if (fseek(stream, 0, SEEK_END) == 0) {
+                    long size = ftell(stream);
+                    if (size > 0)
+                        text.reserve((size_t)size);
+                    fseek(stream, 0, SEEK_SET);
+                }
+                char buf[8192];
+                size_t count;
+                while ((count = fread(buf, 1, sizeof(buf), stream)) > 0)
+                    text.append(buf, count);
+                if (ferror(stream)) {
+                    ysfx_logf(config, ysfx_log_error, "%s: cannot read the file", ysfx::path_file_name(filepath).c_str());
+                    return nullptr;
+                }
+            }
+        }
+        ysfx::string_text_reader raw_reader(text.c_str());
+
+        if (!preprocessor_values) {
+            //--------------------------------------------------------------------------
+            // Read the preprocessor configuration (which involves reading only the header) as we need the information to compile the rest
+            ysfx::scoped_timer timer{stats.parse_ns};
+            ysfx_trace_scope trace{"parse", "load"};
+            if (!ysfx_parse_toplevel(raw_reader, unit->toplevel, &error, true)) {
+                ysfx_logf(config, ysfx_log_error, "%s:%u: %s", ysfx::path_file_name(filepath).c_str(), error.line + 1, error.message.c_str());
+                return nullptr;
+            }
+            if (!ysfx_parse_header(unit->toplevel.header.get(), unit->header, &error)) {
+                ysfx_logf(config, ysfx_log_error, "%s:%u: %s", ysfx::path_file_name(filepath).c_str(), error.line + 1, error.message.c_str());
+                return nullptr;
+            };
+
+            for (auto config_item : unit->header.config_items) {
+                unit->preprocessor_values[config_item.identifier] = config_item.default_value;  // Load preprocessor defaults
+            }
+
+            raw_reader.rewind();
+        }
+
+        // run the preprocessor first
+        std::string preprocessed;
+        preprocessed.reserve(text.size());
+        {
+            ysfx::scoped_timer timer{stats.preprocess_ns};
+            ysfx_trace_scope trace{"preprocess", "load"};
+            if (!ysfx_preprocess(raw_reader, &error, preprocessed, preprocessor_values ? *preprocessor_values : unit->preprocessor_values)) {
+                ysfx_logf(config, ysfx_log_error, "%s:%u: %s", ysfx::path_file_name(filepath).c_str(), error.line + 1, error.message.c_str());
+                return nullptr;
+            }
+        }
+        ysfx::string_text_reader reader = ysfx::string_text_reader(preprocessed.c_str());
+
+        // then parse it
+        {
+            ysfx::scoped_timer timer{stats.parse_ns};
+            ysfx_trace_scope trace{"parse", "load"};
+            if (!ysfx_parse_toplevel(reader, unit->toplevel, &error, false)) {
+                ysfx_logf(config, ysfx_log_error, "%s:%u: %s", ysfx::path_file_name(filepath).c_str(), error.line + 1, error.message.c_str());
+                return nullptr;
+            }
+            if (!ysfx_parse_header(unit->toplevel.header.get(), unit->header, &error) && preprocessor_values) {
+                ysfx_logf(config, ysfx_log_error, "%s:%u: %s", ysfx::path_file_name(filepath).c_str(), error.line + 1, error.message.c_str());
+                return nullptr;
+            }
+        }
+
+        // resolve the imports, which are remembered in the cache
+        {
+            ysfx::scoped_timer timer{stats.import_ns};
+            ysfx_trace_scope trace{"import", "load"};
+            for (const std::string &name : unit->header.imports) {
+                std::string imported_path = ysfx_resolve_import_path(fx, name, filepath);
+                if (!imported_path.empty())
+                    unit->imports[name] = std::move(imported_path);
+            }
+        }
+
+        if (keyed) {
+            ysfx::scoped_timer timer{stats.io_ns};
+            ysfx_trace_scope trace{"io", "load"};
+            ysfx_cache_store(config, key_string, *unit);
+        }
+    }
+
+    if (!keyed)
+        return unit;
+
+    return ysfx_registry_insert(key_string, std::move(unit));
+}
+
+// a file of the tree of imports, and the paths of its own imports
+struct ysfx_import_node_t {
+    std::string path;
+    std::pair<ysfx::file_uid, std::string> id;
+    ysfx_parsed_unit_sp parsed;
+    std::vector<std::string> imports;
+    bool ok = false;
+};
+
+// prefer the path which was resolved at the time of parsing, if the file is still there
+static std::string ysfx_resolve_unit_import(ysfx_t *fx, ysfx_load_record_t &record, const std::string &name, const std::string &origin, const ysfx_parsed_unit_t &parent)
+{
+    std::string imported_path;
+    {
+        ysfx::scoped_timer timer{record.stats.import_ns};
+        ysfx_trace_scope trace{"import", "load"};
+        auto it = parent.imports.find(name);
+        if (it != parent.imports.end() && ysfx_package_exists(it->second))
+            imported_path = it->second;
+        else
+            imported_path = ysfx_resolve_import_path(fx, name, origin);
+    }
+
+    if (imported_path.empty())
+        ysfx_logf(*fx->config, ysfx_log_error, "%s: cannot find import: %s", ysfx::path_file_name(origin.c_str()).c_str(), name.c_str());
+
+    return imported_path;
+}
+
+// read and parse an imported file, and resolve its own imports
+static void ysfx_load_import_node(ysfx_t *fx, ysfx_load_record_t &record, ysfx_import_node_t &node, const std::map<std::string, ysfx_real> &preprocessor_values)
+{
+    ysfx_source_file_t file;
+    bool opened;
+    {
+        ysfx::scoped_timer timer{record.stats.io_ns};
+        ysfx_trace_scope trace{"io", "load"};
+        opened = ysfx_open_source_file(node.path.c_str(), file);
+    }
+    if (!opened) {
+        ysfx_logf(*fx->config, ysfx_log_error, "%s: cannot open file for reading", ysfx::path_file_name(node.path.c_str()).c_str());
+        return;
+    }
+    node.id = {file.uid, file.entry};
+
+    node.parsed = ysfx_parse_unit(fx, record, node.path.c_str(), file, &preprocessor_values);
+    if (!node.parsed)
+        return;
+
+    for (const std::string &name : node.parsed->header.imports) {
+        std::string next_path = ysfx_resolve_unit_import(fx, record, name, node.path, *node.parsed);
+        if (next_path.empty())
+            return;
+        node.imports.push_back(std::move(next_path));
+    }
+
+    node.ok = true;
+}
+
+static void ysfx_add_load_record(ysfx_load_record_t &record, const ysfx_load_record_t &other)
+{
+    record.stats.io_ns += other.stats.io_ns;
+    record.stats.preprocess_ns += other.stats.preprocess_ns;
+    record.stats.parse_ns += other.stats.parse_ns;
+    record.stats.import_ns += other.stats.import_ns;
+    record.stats.num_files += other.stats.num_files;
+    record.stats.num_cached_files += other.stats.num_cached_files;
+    if (other.stats.num_files > 0 && other.stats.slowest_file_ns >= record.stats.slowest_file_ns) {
+        record.stats.slowest_file_ns = other.stats.slowest_file_ns;
+        record.slowest_file = other.slowest_file;
+    }
+}
+
+static bool ysfx_load_imports(ysfx_t *fx, const char *filepath, const ysfx_parsed_unit_t &main_parsed, const std::map<std::string, ysfx_real> &preprocessor_values)
+{
+    static constexpr uint32_t max_import_level = 32;
+
+    uint32_t max_threads = fx->config->load_threads;
+    if (max_threads == 0)
+        max_threads = std::max(1u, std::thread::hardware_concurrency());
+
+    std::deque<ysfx_import_node_t> nodes;
+    // the node of each path, and the first node of each file, since those of a package share its uid
+    std::map<std::string, size_t> node_of_path;
+    std::map<std::pair<ysfx::file_uid, std::string>, size_t> node_of_file;
+
+    std::vector<std::string> main_imports;
+    for (const std::string &name : fx->source.main->header.imports) {
+        std::string imported_path = ysfx_resolve_unit_import(fx, fx->load, name, filepath, main_parsed);
+        if (imported_path.empty())
+            return false;
+        main_imports.push_back(std::move(imported_path));
+    }
+
+    std::vector<std::string> level_paths = main_imports;
+    for (uint32_t level = 0; !level_paths.empty(); ++level) {
+        if (level >= max_import_level) {
+            ysfx_logf(*fx->config, ysfx_log_error, "%s: %s", ysfx::path_file_name(level_paths[0].c_str()).c_str(), "too many import levels");
+            return false;
+        }
+
+        // the new paths of this level, in the order they appear
+        const size_t first = nodes.size();
+        for (std::string &path : level_paths) {
+            if (node_of_path.find(path) != node_of_path.end())
+                continue;
+            node_of_path[path] = nodes.size();
+            nodes.emplace_back();
+            nodes.back().path = std::move(path);
+        }
+        const size_t count = nodes.size() - first;
+
+        // each thread adds its statistics after the others are done
+        const uint32_t num_threads = (uint32_t)std::max<size_t>(1, std::min<size_t>(max_threads, count));
+        std::vector<ysfx_load_record_t> records(num_threads);
+        std::atomic<size_t> next{0};
+        auto work = [&](ysfx_load_record_t &record) {
+            for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < count; )
+                ysfx_load_import_node(fx, record, nodes[first + i], preprocessor_values);
+        };
+        std::vector<std::thread> threads;
+        threads.reserve(num_threads - 1);
+        for (uint32_t i = 1; i < num_threads; ++i)
+            threads.emplace_back(work, std::ref(records[i]));
+        work(records[0]);
+        for (std::thread &thread : threads)
+            thread.join();
+        for (const ysfx_load_record_t &record : records)
+            ysfx_add_load_record(fx->load, record);
+
+        level_paths.clear();
+        for (size_t i = first; i < nodes.size(); ++i) {
+            ysfx_import_node_t &node = nodes[i];
+            if (!node.ok)
+                return false;
+            // the same file under another path is visited once, by its first node
+            auto it = node_of_file.find(node.id);
+            if (it != node_of_file.end()) {
+                node_of_path[node.path] = it->second;
+                continue;
+            }
+            node_of_file[node.id] = i;
+            level_paths.insert(level_paths.end(), node.imports.begin(), node.imports.end());
+        }
+    }
+
+    // add the sources in post-order, each dependency before the file which imports it
+    std::vector<bool> visited(nodes.size());
+    std::function<void(const std::string &)> visit =
+        [fx, &nodes, &node_of_path, &visited, &visit](const std::string &path)
+        {
+            size_t index = node_of_path[path];
+            if (visited[index])
+                return;
+            visited[index] = true;
+
+            ysfx_import_node_t &node = nodes[index];
+            for (const std::string &next_path : node.imports)
+                visit(next_path);
+
+            ysfx_source_unit_u unit{new ysfx_source_unit_t};
+            unit->toplevel = std::shared_ptr<const ysfx_toplevel_t>(node.parsed, &node.parsed->toplevel);
+            unit->header = node.parsed->header;
+            unit->path = node.path;
+            fx->source.imports.push_back(std::move(unit));
+        };
+    for (const std::string &path : main_imports)
+        visit(path);
+
+    return true;
+}
+
 bool ysfx_load_file(ysfx_t *fx, const char *filepath, uint32_t loadopts)
 {
+    ysfx_trace_scope trace{"load", "load"};
     ysfx_unload(fx);
 
+    // a package loads by its main entry
+    std::string package_main;
+    {
+        std::string package_path;
+        std::string entry;
+        if (ysfx_package_split(filepath, package_path, entry) && entry.empty()) {
+            if (ysfx_package_sp package = ysfx_package_find(package_path)) {
+                package_main = package_path + '/' + package->main;
+                filepath = package_main.c_str();
+            }
+        }
+    }
+
+    fx->load.stats = {};
+    fx->load.slowest_file.clear();
+    fx->memory.high_water = 0;
+
+    if (fx->variant.path != filepath) {
+        ysfx_forget_config_variants(fx);
+        fx->variant.path.assign(filepath);
+    }
+
     //--------------------------------------------------------------------------
     // failure guard
 
@@ -232,52 +676,51 @@ bool ysfx_load_file(ysfx_t *fx, const char *filepath, uint32_t loadopts)
     //--------------------------------------------------------------------------
     // load the main file
 
-    ysfx::file_uid main_uid;
-    std::map<std::string, ysfx_real> preprocessor_values;
+    ysfx_parsed_unit_sp main_parsed;
+    ysfx_parsed_unit_sp default_parsed;
+    std::map<std::string, ysfx_real> config_values;
 
     {
         ysfx_source_unit_u main{new ysfx_source_unit_t};
 
-        ysfx::FILE_u stream{ysfx::fopen_utf8(filepath, "rb")};
-        if (!stream || !ysfx::get_stream_file_uid(stream.get(), main_uid)) {
+        ysfx_source_file_t file;
+        bool opened;
+        {
+            ysfx::scoped_timer timer{fx->load.stats.io_ns};
+            ysfx_trace_scope trace{"io", "load"};
+            opened = ysfx_open_source_file(filepath, file);
+        }
+        if (!opened) {
             ysfx_logf(*fx->config, ysfx_log_error, "%s: cannot open file for reading", ysfx::path_file_name(filepath).c_str());
             return false;
         }
 
-        ysfx_parse_error error;
-        ysfx::stdio_text_reader raw_reader(stream.get());
-
-        //--------------------------------------------------------------------------
-        // Read the preprocessor configuration (which involves reading only the header) as we need the information to compile the rest
-        {
-            if (!ysfx_parse_toplevel(raw_reader, main->toplevel, &error, true)) {
-                ysfx_logf(*fx->config, ysfx_log_error, "%s:%u: %s", ysfx::path_file_name(filepath).c_str(), error.line + 1, error.message.c_str());
-                return false;
-            }
-            if (!ysfx_parse_header(main->toplevel.header.get(), main->header, &error)) {
-                ysfx_logf(*fx->config, ysfx_log_error, "%s:%u: %s", ysfx::path_file_name(filepath).c_str(), error.line + 1, error.message.c_str());
-                return false;
-            };
+        main_parsed = ysfx_parse_unit(fx, fx->load, filepath, file, nullptr);
+        if (!main_parsed)
+            return false;
 
-            for (auto config_item : main->header.config_items) {
-                preprocessor_values[config_item.identifier] = config_item.default_value;  // Load preprocessor defaults
+        // the values which are chosen replace the defaults, and key another variant
+        config_values = main_parsed->preprocessor_values;
+        bool configured = false;
+        for (const std::pair<const std::string, ysfx_real> &chosen : fx->variant.values) {
+            auto it = config_values.find(chosen.first);
+            if (it != config_values.end() && it->second != chosen.second) {
+                it->second = chosen.second;
+                configured = true;
             }
-
-            raw_reader.rewind();
         }
-
-        std::string preprocessed;
-        if (!ysfx_preprocess(raw_reader, &error, preprocessed, preprocessor_values)) {
-            ysfx_logf(*fx->config, ysfx_log_error, "%s:%u: %s", ysfx::path_file_name(filepath).c_str(), error.line + 1, error.message.c_str());
-            return false;
+        if (configured) {
+            default_parsed = std::move(main_parsed);
+            if (file.stream)
+                fseek(file.stream.get(), 0, SEEK_SET);
+            main_parsed = ysfx_parse_unit(fx, fx->load, filepath, file, &config_values);
+            if (!main_parsed)
+                return false;
         }
-        ysfx::string_text_reader reader = ysfx::string_text_reader(preprocessed.c_str());
 
-        if (!ysfx_parse_toplevel(reader, main->toplevel, &error, false)) {
-            ysfx_logf(*fx->config, ysfx_log_error, "%s:%u: %s", ysfx::path_file_name(filepath).c_str(), error.line + 1, error.message.c_str());
-            return false;
-        }
-        ysfx_parse_header(main->toplevel.header.get(), main->header, &error);
+        // the sections are shared, the header is adjusted by this instance
+        main->toplevel = std::shared_ptr<const ysfx_toplevel_t>(main_parsed, &main_parsed->toplevel);
+        main->header = main_parsed->header;
 
         // validity check
         if (main->header.desc.empty()) {
@@ -289,7 +732,7 @@ bool ysfx_load_file(ysfx_t *fx, const char *filepath, uint32_t loadopts)
             main->header.imports.clear();
 
         // if no pins are specified and we have @sample, the default is stereo
-        if (main->toplevel.sample && !main->header.explicit_pins &&
+        if (main->toplevel->sample && !main->header.explicit_pins &&
             main->header.in_pins.empty() && main->header.out_pins.empty())
         {
             main->header.in_pins = {"JS input 1", "JS input 2"};
@@ -297,17 +740,16 @@ bool ysfx_load_file(ysfx_t *fx, const char *filepath, uint32_t loadopts)
         }
 
         // register variables aliased to sliders
-        for (uint32_t i = 0; i < ysfx_max_sliders; ++i) {
-            if (main->header.sliders[i].exists) {
-                if (!main->header.sliders[i].var.empty())
-                {
-                    std::string data = main->header.sliders[i].var;
-                    std::transform(data.begin(), data.end(), data.begin(), ysfx::ascii_tolower);
-                    fx->source.slider_alias.insert({data, i});
-                }
+        for (uint32_t i : main->header.slider_indices) {
+            if (!main->header.sliders[i].var.empty())
+            {
+                std::string data = main->header.sliders[i].var;
+                std::transform(data.begin(), data.end(), data.begin(), ysfx::ascii_tolower);
+                fx->source.slider_alias.insert({data, i});
             }
         }
 
+        main->path.assign(filepath);
         fx->source.main = std::move(main);
         fx->source.main_file_path.assign(filepath);
 
@@ -325,102 +767,129 @@ bool ysfx_load_file(ysfx_t *fx, const char *filepath, uint32_t loadopts)
 
         // set the initial mask of visible sliders
         ysfx_update_slider_visibility_mask(fx);
+
+        // sample the curves, once the enums are fixed
+        for (uint32_t i = 0; i < ysfx_max_sliders; ++i) {
+            ysfx_slider_curve_t curve{};
+            ysfx_slider_get_curve(fx, i, &curve);
+            fx->slider.curve_table[i].build(curve);
+        }
     }
 
     //--------------------------------------------------------------------------
     // load the imports
 
-    // we load the imports recursively using post-order
-
-    static constexpr uint32_t max_import_level = 32;
-    std::set<ysfx::file_uid> seen;
-
-    std::function<bool(const std::string &, const std::string &, uint32_t)> do_next_import =
-        [fx, &seen, &do_next_import, &preprocessor_values]
-        (const std::string &name, const std::string &origin, uint32_t level) -> bool
-        {
-            if (level >= max_import_level) {
-                ysfx_logf(*fx->config, ysfx_log_error, "%s: %s", ysfx::path_file_name(origin.c_str()).c_str(), "too many import levels");
-                return false;
-            }
-
-            std::string imported_path = ysfx_resolve_import_path(fx, name, origin);
-            if (imported_path.empty()) {
-                ysfx_logf(*fx->config, ysfx_log_error, "%s: cannot find import: %s", ysfx::path_file_name(origin.c_str()).c_str(), name.c_str());
-                return false;
-            }
+    // the files of each level of the tree are read and parsed in parallel,
+    //   and their imports form the next level; the sources are then ordered
+    //   in post-order, as if they were loaded one after the other
 
-            ysfx::file_uid imported_uid;
-            ysfx::FILE_u stream{ysfx::fopen_utf8(imported_path.c_str(), "rb")};
-            if (!stream || !ysfx::get_stream_file_uid(stream.get(), imported_uid)) {
-                ysfx_logf(*fx->config, ysfx_log_error, "%s: cannot open file for reading", ysfx::path_file_name(imported_path.c_str()).c_str());
-                return false;
-            }
+    if (!ysfx_load_imports(fx, filepath, *main_parsed, config_values))
+        return false;
 
-            // this file was already visited, skip
-            if (!seen.insert(imported_uid).second)
-                return true;
+    //--------------------------------------------------------------------------
+    // initialize the sliders to defaults
 
-            ysfx_source_unit_u unit{new ysfx_source_unit_t};
-            ysfx::stdio_text_reader raw_reader(stream.get());
+    for (uint32_t i = 0; i < ysfx_max_sliders; ++i)
+        *fx->var.slider[i] = fx->source.main->header.sliders[i].def;
 
-            // run the preprocessor first
-            ysfx_parse_error error;
-            std::string preprocessed;
-            if (!ysfx_preprocess(raw_reader, &error, preprocessed, preprocessor_values)) {
-                ysfx_logf(*fx->config, ysfx_log_error, "%s:%u: %s", ysfx::path_file_name(imported_path.c_str()).c_str(), error.line + 1, error.message.c_str());
-                return false;
-            }
-            ysfx::string_text_reader reader = ysfx::string_text_reader(preprocessed.c_str());
+    //--------------------------------------------------------------------------
+    // keep the variant, with the parse of the defaults which led to it
 
-            // then parse it
-            if (!ysfx_parse_toplevel(reader, unit->toplevel, &error, false)) {
-                ysfx_logf(*fx->config, ysfx_log_error, "%s:%u: %s", ysfx::path_file_name(imported_path.c_str()).c_str(), error.line + 1, error.message.c_str());
-                return false;
-            }
-            if (!ysfx_parse_header(unit->toplevel.header.get(), unit->header, &error)) {
-                ysfx_logf(*fx->config, ysfx_log_error, "%s:%u: %s", ysfx::path_file_name(imported_path.c_str()).c_str(), error.line + 1, error.message.c_str());
-                return false;
-            }
+    {
+        std::vector<std::shared_ptr<const ysfx_toplevel_t>> sections;
+        sections.push_back(fx->source.main->toplevel);
+        for (const ysfx_source_unit_u &unit : fx->source.imports)
+            sections.push_back(unit->toplevel);
+        if (default_parsed)
+            sections.emplace_back(default_parsed, &default_parsed->toplevel);
+
+        std::lock_guard<ysfx::mutex> lock{fx->variant.mutex};
+        fx->variant.cache[config_values] = std::move(sections);
+    }
 
-            // process the imported dependencies, *first*
-            for (const std::string &name : unit->header.imports) {
-                if (!do_next_import(name, imported_path.c_str(), level + 1))
-                    return false;
-            }
+    fx->source.load_options = loadopts;
+    fx->source.config_values = std::move(config_values);
 
-            // add it to the import sources, *second*
-            fx->source.imports.push_back(std::move(unit));
+    //--------------------------------------------------------------------------
 
-            return true;
-        };
+    fail_guard.disarm();
+    return true;
+}
 
-    for (const std::string &name : fx->source.main->header.imports) {
-        if (!do_next_import(name, filepath, 0))
-            return false;
+// the index of the file which has the section: 0 for the main, 1 and more for the imports
+static uint32_t ysfx_section_unit(ysfx_t *fx, const ysfx_section_t *section)
+{
+    for (size_t i = 0; i < fx->source.imports.size(); ++i) {
+        const ysfx_toplevel_t &toplevel = *fx->source.imports[i]->toplevel;
+        for (const ysfx_section_u *sec : {&toplevel.init, &toplevel.slider, &toplevel.block, &toplevel.sample,
+                                          &toplevel.serialize, &toplevel.gfx, &toplevel.midi}) {
+            if (sec->get() == section)
+                return (uint32_t)i + 1;
+        }
     }
+    return 0;
+}
 
-    //--------------------------------------------------------------------------
-    // initialize the sliders to defaults
+static bool ysfx_compile_section(ysfx_t *fx, const ysfx_section_t *section, uint32_t type, const char *name, NSEEL_CODEHANDLE_u &dest)
+{
+    NSEEL_VMCTX vm = fx->vm.get();
+    if (section->text.empty()) {
+        // NOTE: check for empty source, which would return null code
+        dest.reset();
+        return true;
+    }
+    ysfx_load_stats_t &stats = fx->load.stats;
+    NSEEL_CODEHANDLE_u code;
+    {
+        ysfx::scoped_timer timer{stats.compile_ns[type]};
+        ysfx_trace_scope trace{name, "compile"};
+        if (fx->code.line_probes) {
+            std::string text = ysfx_instrument_lines(section->text, section->line_offset, ysfx_section_unit(fx, section));
+            code.reset(NSEEL_code_compile_ex(vm, text.c_str(), section->line_offset, NSEEL_CODE_COMPILE_FLAG_COMMONFUNCS));
+        }
+        else
+            code.reset(NSEEL_code_compile_ex(vm, section->text.c_str(), section->line_offset, NSEEL_CODE_COMPILE_FLAG_COMMONFUNCS));
+    }
+    if (!code) {
+        ysfx_logf(*fx->config, ysfx_log_error, "%s: %s", name, NSEEL_code_getcodeerror(vm));
+        return false;
+    }
+    // the second count is the size of the generated code
+    if (int *code_stats = NSEEL_code_getstats(code.get()))
+        stats.code_size[type] += (uint32_t)code_stats[1];
+    dest = std::move(code);
+    return true;
+}
 
-    for (uint32_t i = 0; i < ysfx_max_sliders; ++i)
-        *fx->var.slider[i] = fx->source.main->header.sliders[i].def;
+// compile a section which was deferred, if it's not done yet
+static void ysfx_compile_lazy_section(ysfx_t *fx, const ysfx_section_t *&section, uint32_t type, const char *name, NSEEL_CODEHANDLE_u &dest)
+{
+    std::lock_guard<ysfx::mutex> lock{fx->lazy_code_mutex};
+    if (!section)
+        return;
 
-    //--------------------------------------------------------------------------
+    // the error is reported, and the section acts as if it was empty
+    ysfx_compile_section(fx, section, type, name, dest);
+    section = nullptr;
 
-    fail_guard.disarm();
-    return true;
+    ysfx_eel_string_context_update_named_vars(fx->string_ctx.get(), fx->vm.get());
 }
 
 bool ysfx_compile(ysfx_t *fx, uint32_t compileopts)
 {
+    ysfx_trace_scope trace{"compile", "compile"};
+    ysfx_wait_background_init(fx);
     ysfx_unload_code(fx);
+    fx->hibernation = {};
 
     if (!fx->source.main) {
         ysfx_logf(*fx->config, ysfx_log_error, "???: no source is loaded, cannot compile");
         return false;
     }
 
+    // the processing reports through the queue, which delivers from now
+    fx->config->log_queue->start();
+
     //--------------------------------------------------------------------------
     // failure guard
 
@@ -432,11 +901,16 @@ bool ysfx_compile(ysfx_t *fx, uint32_t compileopts)
     NSEEL_VMCTX vm = fx->vm.get();
 
     {
+        // the most that EEL2 can address, which the layout of the code generator fixes
+        const uint32_t maxmem_limit = (uint32_t)NSEEL_RAM_BLOCKS * (uint32_t)NSEEL_RAM_ITEMSPERBLOCK;
+
         uint32_t maxmem = fx->source.main->header.options.maxmem;
         if (maxmem == 0)
             maxmem = 8 * 1024 * 1024;
-        if (maxmem > 128 * 1024 * 1024)
-            maxmem = 128 * 1024 * 1024;
+        if (maxmem > maxmem_limit) {
+            ysfx_logf(*fx->config, ysfx_log_warning, "%s: maxmem is limited to %u", ysfx::path_file_name(fx->source.main_file_path.c_str()).c_str(), maxmem_limit);
+            maxmem = maxmem_limit;
+        }
 
         NSEEL_VM_setramsize(vm, (int)maxmem);
         if (fx->source.main->header.options.prealloc != 0) {
@@ -444,40 +918,67 @@ bool ysfx_compile(ysfx_t *fx, uint32_t compileopts)
         };
     }
 
-    //--------------------------------------------------------------------------
-    // compile
+    // the shared memory must be set before compiling
+    {
+        const std::string &gmem = fx->source.main->header.options.gmem;
+        if (!gmem.empty()) {
+            auto it = fx->config->gmem_files.find(gmem);
+            const ysfx_gmem_file_t *file = (it != fx->config->gmem_files.end()) ? &it->second : nullptr;
+            fx->code.gmem = ysfx_gmem_acquire(gmem, file);
+            if (file && !fx->code.gmem->file.is_open())
+                ysfx_logf(*fx->config, ysfx_log_warning, "%s: the global memory is not backed by %s", gmem.c_str(), file->path.c_str());
+            NSEEL_VM_SetGRAM(vm, &fx->code.gmem->gram);
+        }
+    }
 
-    auto compile_section =
-        [fx](ysfx_section_t *section, const char *name, NSEEL_CODEHANDLE_u &dest) -> bool
-        {
-            NSEEL_VMCTX vm = fx->vm.get();
-            if (section->text.empty()) {
-                // NOTE: check for empty source, which would return null code
-                dest.reset();
-                return true;
-            }
-            NSEEL_CODEHANDLE_u code{NSEEL_code_compile_ex(vm, section->text.c_str(), section->line_offset, NSEEL_CODE_COMPILE_FLAG_COMMONFUNCS)};
-            if (!code) {
-                ysfx_logf(*fx->config, ysfx_log_error, "%s: %s", name, NSEEL_code_getcodeerror(vm));
-                return false;
-            }
-            dest = std::move(code);
-            return true;
+    // the channels above the fixed ones, which the pins need, before the code refers to them
+    {
+        const ysfx_header_t &header = fx->source.main->header;
+        const uint32_t num_channels = (uint32_t)std::max(header.in_pins.size(), header.out_pins.size());
+        for (uint32_t i = ysfx_fixed_channels; i < num_channels; ++i) {
+            std::string name = "spl" + std::to_string(i);
+            EEL_F *var = NSEEL_VM_regvar(vm, name.c_str());
+            *var = 0;
+            fx->var.spl.push_back(var);
+        }
+        fx->interleaved.f32.ins.resize(num_channels);
+        fx->interleaved.f32.outs.resize(num_channels);
+        fx->interleaved.f64.ins.resize(num_channels);
+        fx->interleaved.f64.outs.resize(num_channels);
+    }
+
+    //--------------------------------------------------------------------------
+    // compile
+
+    for (uint32_t type = 0; type <= ysfx_section_midi; ++type) {
+        fx->load.stats.compile_ns[type] = 0;
+        fx->load.stats.code_size[type] = 0;
+    }
+
+    // the lines of the earlier code may not be the same
+    fx->code.line_probes = (compileopts & ysfx_compile_profile_lines) != 0;
+    if (fx->profile.line_sampler)
+        fx->profile.line_sampler->reset();
+
+    auto compile_section =
+        [fx](const ysfx_section_t *section, uint32_t type, const char *name, NSEEL_CODEHANDLE_u &dest) -> bool
+        {
+            return ysfx_compile_section(fx, section, type, name, dest);
         };
 
     // compile the multiple @init sections, imports first
     {
-        std::vector<ysfx_section_t *> secs;
+        std::vector<const ysfx_section_t *> secs;
         secs.reserve(fx->source.imports.size() + 1);
 
         // collect init sections: imports first, main second
         for (size_t i = 0; i < fx->source.imports.size(); ++i)
-            secs.push_back(fx->source.imports[i]->toplevel.init.get());
-        secs.push_back(fx->source.main->toplevel.init.get());
+            secs.push_back(fx->source.imports[i]->toplevel->init.get());
+        secs.push_back(fx->source.main->toplevel->init.get());
 
-        for (ysfx_section_t *sec : secs) {
+        for (const ysfx_section_t *sec : secs) {
             NSEEL_CODEHANDLE_u code;
-            if (sec && !compile_section(sec, "@init", code))
+            if (sec && !compile_section(sec, ysfx_section_init, "@init", code))
                 return false;
             fx->code.init.push_back(std::move(code));
         }
@@ -486,29 +987,95 @@ bool ysfx_compile(ysfx_t *fx, uint32_t compileopts)
     // compile the other sections, single
     // a non-@init section is searched in the main file first;
     // if not found, it's inherited from the first import which has it.
-    ysfx_section_t *slider = ysfx_search_section(fx, ysfx_section_slider);
-    ysfx_section_t *block = ysfx_search_section(fx, ysfx_section_block);
-    ysfx_section_t *sample = ysfx_search_section(fx, ysfx_section_sample);
-    ysfx_section_t *gfx = nullptr;
-    ysfx_section_t *serialize = nullptr;
+    const ysfx_section_t *slider = ysfx_search_section(fx, ysfx_section_slider);
+    const ysfx_section_t *block = ysfx_search_section(fx, ysfx_section_block);
+    const ysfx_section_t *sample = ysfx_search_section(fx, ysfx_section_sample);
+    const ysfx_section_t *midi = ysfx_search_section(fx, ysfx_section_midi);
+    const ysfx_section_t *gfx = nullptr;
+    const ysfx_section_t *serialize = nullptr;
     if ((compileopts & ysfx_compile_no_gfx) == 0)
         gfx = ysfx_search_section(fx, ysfx_section_gfx);
     if ((compileopts & ysfx_compile_no_serialize) == 0)
         serialize = ysfx_search_section(fx, ysfx_section_serialize);
 
-    if (slider && !compile_section(slider, "@slider", fx->code.slider))
+    if (slider && !compile_section(slider, ysfx_section_slider, "@slider", fx->code.slider))
         return false;
-    if (block && !compile_section(block, "@block", fx->code.block))
+    if (block && !compile_section(block, ysfx_section_block, "@block", fx->code.block))
         return false;
-    if (sample && !compile_section(sample, "@sample", fx->code.sample))
+    if (sample && !compile_section(sample, ysfx_section_sample, "@sample", fx->code.sample))
         return false;
-    if (gfx && !compile_section(gfx, "@gfx", fx->code.gfx))
-        return false;
-    if (serialize && !compile_section(serialize, "@serialize", fx->code.serialize))
+    if (midi && !compile_section(midi, ysfx_section_midi, "@midi", fx->code.midi))
         return false;
+    if (compileopts & ysfx_compile_lazy) {
+        fx->code.lazy_gfx = gfx;
+        fx->code.lazy_serialize = serialize;
+    }
+    else {
+        if (gfx && !compile_section(gfx, ysfx_section_gfx, "@gfx", fx->code.gfx))
+            return false;
+        if (serialize && !compile_section(serialize, ysfx_section_serialize, "@serialize", fx->code.serialize))
+            return false;
+    }
+
+    // the loop steps the frames by a function call, instead of entering the code at each;
+    //   the body starts on the line of the section, and a comment at its end stays inside,
+    //   and if it does not compile within a loop, as with a function definition, it runs per frame
+    if (fx->code.sample && (compileopts & ysfx_compile_frame_loop) && !fx->code.line_probes) {
+        std::string text;
+        text.reserve(sample->text.size() + 64);
+        text.append("loop(__ysfx_frames(0), __ysfx_frame(0); (");
+        text.append(sample->text);
+        text.append("\n););");
+        ysfx::scoped_timer timer{fx->load.stats.compile_ns[ysfx_section_sample]};
+        fx->code.sample_loop.reset(NSEEL_code_compile_ex(vm, text.c_str(), sample->line_offset, NSEEL_CODE_COMPILE_FLAG_COMMONFUNCS));
+        if (!fx->code.sample_loop)
+            ysfx_logf(*fx->config, ysfx_log_info, "@sample: runs per frame, not in a loop: %s", NSEEL_code_getcodeerror(vm));
+    }
+
+    // the variants have no probes, so the lines would not be found
+    if (sample && (compileopts & ysfx_compile_specialize) && !fx->code.line_probes) {
+        const std::vector<std::string> &constants = fx->source.main->header.options.constants;
+        std::vector<ysfx_real> zeros(constants.size());
+        std::string text;
+        if (!constants.empty() && ysfx_specialize_text(sample->text, constants, zeros.data(), text))
+            fx->code.specializer.reset(new ysfx_specializer_t(fx, sample->text.c_str(), sample->line_offset, constants));
+    }
+
+    std::vector<const ysfx_section_t *> secs{slider, block, sample, midi, gfx, serialize};
+    for (const ysfx_source_unit_u &unit : fx->source.imports)
+        secs.push_back(unit->toplevel->init.get());
+    secs.push_back(fx->source.main->toplevel->init.get());
+
+    // the texts which `eval` and `match` are given literally compile now, rather than at their first run
+    {
+        fx->code.eval_cache.reset(new ysfx_eval_cache_t);
+        fx->code.match_cache.reset(new ysfx_match_cache_t);
+        for (const ysfx_section_t *sec : secs) {
+            if (!sec)
+                continue;
+            if (sec->text.find("eval") != std::string::npos)
+                fx->code.eval_cache->precompile(vm, sec->text);
+            if (sec->text.find("match") != std::string::npos)
+                fx->code.match_cache->precompile(sec->text);
+        }
+    }
+
+    // the files which open in the background need a thread, if the code has them
+    {
+        bool async_files = std::any_of(secs.begin(), secs.end(), [](const ysfx_section_t *sec) -> bool {
+            return sec && sec->text.find("file_open_async") != std::string::npos;
+        });
+        if (async_files)
+            fx->file.opener.reset(new ysfx_file_opener_t);
+
+        fx->code.capabilities = ysfx_analyze_capabilities(secs, fx->source.slider_alias);
+        if (midi)
+            fx->code.capabilities |= ysfx_capability_midi_in;
+    }
 
     fx->has_serialize = serialize ? true : false;
     fx->code.compiled = true;
+    fx->code.options = compileopts;
     fx->is_freshly_compiled = true;
     fx->must_compute_init = true;
 
@@ -567,14 +1134,142 @@ void ysfx_reinitialize_vars(ysfx_t *fx)
     NSEEL_VM_enumallvars(fx->vm.get(), +callback, &fx->built_ins);
 }
 
+uint32_t ysfx_get_specialized_count(ysfx_t *fx)
+{
+    ysfx_specializer_t *specializer = fx->code.specializer.get();
+    return specializer ? specializer->variant_count() : 0;
+}
+
 bool ysfx_is_compiled(ysfx_t *fx)
 {
     return fx->code.compiled;
 }
 
+uint32_t ysfx_get_capabilities(ysfx_t *fx)
+{
+    return fx->code.capabilities;
+}
+
+static void ysfx_prepare_processing(ysfx_t *fx);
+
+ysfx_t *ysfx_clone(ysfx_t *fx)
+{
+    ysfx_wait_background_init(fx);
+
+    ysfx_u copy{ysfx_new(fx->config.get())};
+
+    // host settings
+    copy->block_size = fx->block_size;
+    copy->sample_rate = fx->sample_rate;
+    copy->valid_input_channels = fx->valid_input_channels;
+    copy->denormal_mode = fx->denormal_mode;
+    ysfx_set_midi_capacity(copy.get(), (uint32_t)fx->midi.in->data.capacity(), fx->midi.in->extensible);
+    ysfx_set_midi_sysex_capacity(copy.get(), fx->midi.in->has_pool ? (uint32_t)fx->midi.in->pool.capacity() : 0);
+    ysfx_set_midi_output_sorted(copy.get(), fx->midi.sort_output);
+    ysfx_set_midi_output_deduplicated(copy.get(), fx->midi.dedup_output, fx->midi.dedup_interval);
+    ysfx_set_midi_queue_capacity(copy.get(), fx->midi.queue->events.capacity());
+    ysfx_set_silence_skip(copy.get(), fx->silence.num_blocks, fx->silence.threshold);
+    ysfx_set_sample_accurate(copy.get(), fx->split.min_frames);
+    ysfx_set_audio_file_read_ahead(copy.get(), fx->file.read_ahead);
+    ysfx_set_audio_file_resampling(copy.get(), fx->file.resample);
+    ysfx_set_lossless_serialization(copy.get(), fx->file.serialize_f64);
+    for (uint32_t i = 0; i < ysfx_max_sliders; ++i)
+        copy->slider.ramp[i].frames = fx->slider.ramp[i].frames;
+    ysfx_set_slider_queue_capacity(copy.get(), fx->slider.queue.capacity());
+    ysfx_set_slider_automation_capacity(copy.get(), fx->slider.automation.capacity());
+    copy->oversampling.factor = fx->oversampling.factor;
+    ysfx_set_pdc_compensation(copy.get(), fx->pdc.enabled);
+    ysfx_set_pdc_capacity(copy.get(), fx->pdc.reserve_channels, fx->pdc.reserve_frames);
+    ysfx_set_profiling(copy.get(), fx->profile.enabled.load(std::memory_order_relaxed));
+    copy->memory.auto_prefault = fx->memory.auto_prefault;
+    ysfx_set_vmem_snapshot(copy.get(), fx->vmem_snapshot.addr, fx->vmem_snapshot.count);
+
+    if (!fx->source.main)
+        return copy.release();
+
+    // source: the parsed sections are shared, the headers are copied
+    copy->source.main_file_path = fx->source.main_file_path;
+    copy->source.bank_path = fx->source.bank_path;
+    copy->source.main.reset(new ysfx_source_unit_t(*fx->source.main));
+    copy->source.imports.reserve(fx->source.imports.size());
+    for (const ysfx_source_unit_u &unit : fx->source.imports)
+        copy->source.imports.emplace_back(new ysfx_source_unit_t(*unit));
+    copy->source.slider_alias = fx->source.slider_alias;
+
+    for (uint32_t i = 0; i < ysfx_max_sliders; ++i) {
+        *copy->var.slider[i] = *fx->var.slider[i];
+        copy->slider.curve_table[i] = fx->slider.curve_table[i];
+    }
+    for (uint32_t i = 0; i < ysfx_max_slider_groups; ++i)
+        copy->slider.visible_mask[i].store(fx->slider.visible_mask[i].load());
+
+    if (!fx->code.compiled)
+        return copy.release();
+
+    // code: compiled again, because the generated code refers to the variables of its own VM
+    if (!ysfx_compile(copy.get(), fx->code.options))
+        return nullptr;
+
+    if (!fx->must_compute_init)
+        ysfx_adopt_state(copy.get(), fx);
+
+    return copy.release();
+}
+
+bool ysfx_adopt_state(ysfx_t *fx, ysfx_t *from)
+{
+    if (!fx->code.compiled || !from->code.compiled || from->must_compute_init)
+        return false;
+
+    NSEEL_VMCTX src_vm = from->vm.get();
+    NSEEL_VMCTX dst_vm = fx->vm.get();
+
+    auto copy_var = [](const char *name, EEL_F *var, void *userdata) -> int {
+        *NSEEL_VM_regvar((NSEEL_VMCTX)userdata, name) = *var;
+        return 1;
+    };
+    NSEEL_VM_enumallvars(src_vm, +copy_var, dst_vm);
+
+    for (uint32_t block = 0; block < NSEEL_RAM_BLOCKS; ++block) {
+        int src_valid = 0;
+        int dst_valid = 0;
+        unsigned addr = block * NSEEL_RAM_ITEMSPERBLOCK;
+        EEL_F *src = NSEEL_VM_getramptr_noalloc(src_vm, addr, &src_valid);
+        if (!src || src_valid <= 0)
+            continue;
+        EEL_F *dst = NSEEL_VM_getramptr(dst_vm, addr, &dst_valid);
+        if (!dst || dst_valid <= 0)
+            continue;
+        memcpy(dst, src, (size_t)std::min(src_valid, dst_valid) * sizeof(EEL_F));
+    }
+
+    {
+        ysfx_string_scoped_lock lock{from};
+        ysfx_eel_string_context_copy(fx->string_ctx.get(), from->string_ctx.get());
+    }
+    ysfx_eel_string_context_update_named_vars(fx->string_ctx.get(), dst_vm);
+
+    for (uint32_t i = 0; i < ysfx_max_slider_groups; ++i) {
+        fx->slider.automate_mask[i].store(from->slider.automate_mask[i].load());
+        fx->slider.touch_mask[i].store(0);
+        fx->slider.change_mask[i].store(0);
+    }
+
+    // the state after @init, without running it
+    fx->is_freshly_compiled = false;
+    fx->must_compute_init = false;
+    fx->must_compute_slider = true;
+    ysfx_prepare_processing(fx);
+
+    return true;
+}
+
 void ysfx_unload_source(ysfx_t *fx)
 {
     fx->source = {};
+
+    std::lock_guard<ysfx::mutex> lock(fx->file.resolved_mutex);
+    fx->file.resolved.clear();
 }
 
 void ysfx_unload_code(ysfx_t *fx)
@@ -590,23 +1285,47 @@ void ysfx_unload_code(ysfx_t *fx)
     }
 #endif
 
+    // stop compiling the variants, before the VM is reset
+    fx->code.specializer.reset();
+    // and opening the files, which may still look up the sources
+    fx->file.opener.reset();
+
+    // no drawing nor processing reads the analyzers from now on
+    fx->analyzer.count.store(0, std::memory_order_relaxed);
+    for (ysfx_analyzer_u &analyzer : fx->analyzer.list)
+        analyzer.reset();
+
+    // detach the shared memory, which may be released with the code
+    NSEEL_VM_SetGRAM(fx->vm.get(), nullptr);
     fx->code = {};
 
     fx->is_freshly_compiled = false;
     fx->must_compute_init = false;
     fx->must_compute_slider = false;
+    for (uint32_t index : fx->slider.ramping)
+        fx->slider.ramp[index].remaining = 0;
+    fx->slider.ramping.clear();
+
+    // the variables stay registered in the VM, to be found again by the next compile
+    fx->var.spl.resize(ysfx_fixed_channels);
+    fx->interleaved = {};
 
     NSEEL_VMCTX vm = fx->vm.get();
     NSEEL_code_compile_ex(vm, nullptr, 0, NSEEL_CODE_COMPILE_FLAG_COMMONFUNCS_RESET);
     NSEEL_VM_remove_unused_vars(vm);
     NSEEL_VM_remove_all_nonreg_vars(vm);
     NSEEL_VM_freeRAM(vm);
+
+    // the watched variables are gone
+    fx->watch.generation += 1;
 }
 
 void ysfx_unload(ysfx_t *fx)
 {
+    ysfx_wait_background_init(fx);
     ysfx_unload_code(fx);
     ysfx_unload_source(fx);
+    fx->hibernation = {};
 }
 
 bool ysfx_is_loaded(ysfx_t *fx)
@@ -614,31 +1333,154 @@ bool ysfx_is_loaded(ysfx_t *fx)
     return fx->source.main != nullptr;
 }
 
-void ysfx_fill_file_enums(ysfx_t *fx)
+bool ysfx_hibernate(ysfx_t *fx, uint32_t hibernateopts)
 {
-    if (fx->config->data_root.empty())
-        return;
+    ysfx_wait_background_init(fx);
+    if (!fx->code.compiled)
+        return false;
 
-    for (uint32_t i = 0; i < ysfx_max_sliders; ++i) {
-        ysfx_slider_t &slider = fx->source.main->header.sliders[i];
-        if (slider.path.empty())
+    ysfx_state_u state;
+    ysfx_snapshot_u vm;
+    if (hibernateopts & ysfx_hibernate_keep_vm) {
+        vm.reset(ysfx_snapshot_take(fx, nullptr));
+        if (!vm)
+            return false;
+        // the blocks of zeros are what a new VM has anyway
+        ysfx_snapshot_drop_zero_blocks(vm.get());
+    }
+    else {
+        state.reset(ysfx_save_state(fx));
+        if (!state)
+            return false;
+    }
+
+    const uint32_t compile_options = fx->code.options;
+    ysfx_unload_code(fx);
+
+    // the buffers of processing, which the next @init sizes again
+    fx->scratch = {};
+    fx->oversampling.in = {};
+    fx->oversampling.out = {};
+    fx->oversampling.in_buf = {};
+    fx->oversampling.out_buf = {};
+    fx->pdc.lines = {};
+    fx->pdc.capacity = 0;
+    fx->pdc.num_channels = 0;
+    fx->pdc.pos = 0;
+    fx->convolver.list.clear();
+    fx->lookahead.list.clear();
+
+#if !defined(YSFX_NO_GFX)
+    {
+        std::lock_guard<ysfx::mutex> lock{fx->gfx.mutex};
+        if (ysfx_gfx_state_t *gfx = fx->gfx.state.get())
+            ysfx_gfx_state_release_images(gfx);
+    }
+#endif
+
+    fx->hibernation.active = true;
+    fx->hibernation.compile_options = compile_options;
+    fx->hibernation.state = std::move(state);
+    fx->hibernation.vm = std::move(vm);
+    return true;
+}
+
+bool ysfx_wake(ysfx_t *fx)
+{
+    if (!fx->hibernation.active)
+        return fx->code.compiled;
+
+    // compiling forgets the hibernation, so keep it until the effect is back
+    uint32_t compile_options = fx->hibernation.compile_options;
+    ysfx_state_u state = std::move(fx->hibernation.state);
+    ysfx_snapshot_u vm = std::move(fx->hibernation.vm);
+    auto restore_guard = ysfx::defer([&]() {
+        fx->hibernation.active = true;
+        fx->hibernation.compile_options = compile_options;
+        fx->hibernation.state = std::move(state);
+        fx->hibernation.vm = std::move(vm);
+    });
+
+    if (!ysfx_compile(fx, compile_options))
+        return false;
+    restore_guard.disarm();
+
+    ysfx_init(fx);
+    ysfx_wait_background_init(fx);
+    if (vm)
+        ysfx_snapshot_restore(fx, vm.get());
+    else
+        ysfx_load_state(fx, state.get());
+    return true;
+}
+
+bool ysfx_is_hibernating(ysfx_t *fx)
+{
+    return fx->hibernation.active;
+}
+
+// list the files of the directory which the effect can open; the listing is
+//   shared by the instances of the configuration, until the directory changes
+static ysfx::string_list ysfx_list_openable_files(ysfx_t *fx, const std::string &dirpath)
+{
+    ysfx_config_t &config = *fx->config;
+
+    ysfx::file_stamp stamp{};
+    bool has_stamp = ysfx_package_get_file_stamp(dirpath, stamp);
+    if (has_stamp) {
+        std::lock_guard<std::mutex> lock(config.dir_listings_mutex);
+        auto it = config.dir_listings.find(dirpath);
+        if (it != config.dir_listings.end() && it->second.stamp == stamp)
+            return it->second.files;
+    }
+
+    std::string subdir;
+    ysfx_package_sp package = ysfx_package_find(dirpath, &subdir);
+
+    ysfx::string_list files;
+    for (std::string &filename : package ? package->list_directory(subdir) : ysfx::list_directory(dirpath.c_str())) {
+        if (!filename.empty() && ysfx::is_path_separator(filename.back()))
             continue;
 
-        std::string dirpath = ysfx::path_ensure_final_separator((fx->config->data_root + slider.path).c_str());
-        ysfx::string_list entries = ysfx::list_directory(dirpath.c_str());
+        std::string filepath = dirpath + filename;
 
-        for (const std::string &filename : entries) {
-            if (!filename.empty() && ysfx::is_path_separator(filename.back()))
-                continue;
+        ysfx_file_type_t ftype = ysfx_detect_file_type(fx, filepath.c_str(), nullptr);
+        if (ftype == ysfx_file_type_none)
+            continue;
 
-            std::string filepath = dirpath + filename;
+        files.push_back(std::move(filename));
+    }
 
-            ysfx_file_type_t ftype = ysfx_detect_file_type(fx, filepath.c_str(), nullptr);
-            if (ftype == ysfx_file_type_none)
-                continue;
+    if (has_stamp) {
+        std::lock_guard<std::mutex> lock(config.dir_listings_mutex);
+        ysfx_dir_listing_t &listing = config.dir_listings[dirpath];
+        listing.stamp = stamp;
+        listing.files = files;
+    }
+
+    return files;
+}
+
+void ysfx_fill_file_enums(ysfx_t *fx)
+{
+    // a packaged effect has its data in the package
+    std::string data_root;
+    if (ysfx_package_find(fx->source.main_file_path))
+        data_root = ysfx::path_directory(fx->source.main_file_path.c_str());
+    else
+        data_root = fx->config->data_root;
+
+    if (data_root.empty())
+        return;
+
+    for (uint32_t i : fx->source.main->header.slider_indices) {
+        ysfx_slider_t &slider = *fx->source.main->header.sliders.find(i);
+        if (slider.path.empty())
+            continue;
 
+        std::string dirpath = ysfx::path_ensure_final_separator((data_root + slider.path).c_str());
+        for (std::string &filename : ysfx_list_openable_files(fx, dirpath))
             slider.enum_names.push_back(std::move(filename));
-        }
 
         if (!slider.enum_names.empty())
             slider.max = (EEL_F)(slider.enum_names.size() - 1);
@@ -650,8 +1492,8 @@ void ysfx_fix_invalid_enums(ysfx_t *fx)
     //NOTE: regardless of the range of enum sliders in source, it is <0,N-1,1>
     //  if there is a mismatch, correct and output a warning
 
-    for (uint32_t i = 0; i < ysfx_max_sliders; ++i) {
-        ysfx_slider_t &slider = fx->source.main->header.sliders[i];
+    for (uint32_t i : fx->source.main->header.slider_indices) {
+        ysfx_slider_t &slider = *fx->source.main->header.sliders.find(i);
         if (!slider.is_enum)
             continue;
 
@@ -709,6 +1551,172 @@ void ysfx_free_resolved_path(char *path)
     path = nullptr;
 }
 
+char *ysfx_get_init_manifest(ysfx_t *fx)
+{
+    std::string manifest;
+    {
+        std::lock_guard<ysfx::mutex> lock(fx->file.resolved_mutex);
+        manifest = ysfx_preload_manifest_join(fx->file.init_manifest);
+    }
+
+    char *text = static_cast<char *>(malloc(manifest.size() + 1));
+    if (text)
+        memcpy(text, manifest.c_str(), manifest.size() + 1);
+    return text;
+}
+
+static const ysfx_config_item *ysfx_get_config_item(ysfx_t *fx, uint32_t index)
+{
+    ysfx_source_unit_t *main = fx->source.main.get();
+    if (!main || index >= main->header.config_items.size())
+        return nullptr;
+    return &main->header.config_items[index];
+}
+
+uint32_t ysfx_get_num_config_items(ysfx_t *fx)
+{
+    ysfx_source_unit_t *main = fx->source.main.get();
+    if (!main)
+        return 0;
+    return (uint32_t)main->header.config_items.size();
+}
+
+const char *ysfx_get_config_item_identifier(ysfx_t *fx, uint32_t index)
+{
+    const ysfx_config_item *item = ysfx_get_config_item(fx, index);
+    return item ? item->identifier.c_str() : "";
+}
+
+const char *ysfx_get_config_item_name(ysfx_t *fx, uint32_t index)
+{
+    const ysfx_config_item *item = ysfx_get_config_item(fx, index);
+    return item ? item->name.c_str() : "";
+}
+
+uint32_t ysfx_get_config_item_num_values(ysfx_t *fx, uint32_t index)
+{
+    const ysfx_config_item *item = ysfx_get_config_item(fx, index);
+    return item ? (uint32_t)item->var_values.size() : 0;
+}
+
+ysfx_real ysfx_get_config_item_value(ysfx_t *fx, uint32_t index, uint32_t value_index)
+{
+    const ysfx_config_item *item = ysfx_get_config_item(fx, index);
+    if (!item || value_index >= item->var_values.size())
+        return 0;
+    return item->var_values[value_index];
+}
+
+const char *ysfx_get_config_item_value_name(ysfx_t *fx, uint32_t index, uint32_t value_index)
+{
+    const ysfx_config_item *item = ysfx_get_config_item(fx, index);
+    if (!item || value_index >= item->var_names.size())
+        return "";
+    return item->var_names[value_index].c_str();
+}
+
+ysfx_real ysfx_get_config_value(ysfx_t *fx, uint32_t index)
+{
+    const ysfx_config_item *item = ysfx_get_config_item(fx, index);
+    if (!item)
+        return 0;
+    auto it = fx->source.config_values.find(item->identifier);
+    return (it != fx->source.config_values.end()) ? it->second : item->default_value;
+}
+
+bool ysfx_set_config_value(ysfx_t *fx, uint32_t index, ysfx_real value)
+{
+    const ysfx_config_item *item = ysfx_get_config_item(fx, index);
+    if (!item)
+        return false;
+    if (value != item->default_value &&
+        std::find(item->var_values.begin(), item->var_values.end(), value) == item->var_values.end())
+        return false;
+    if (value == ysfx_get_config_value(fx, index))
+        return true;
+
+    ysfx_wait_background_init(fx);
+    const bool compiled = fx->code.compiled;
+    const uint32_t compileopts = fx->code.options;
+    ysfx_state_u state{compiled ? ysfx_save_state(fx) : nullptr};
+    const std::string path = fx->source.main_file_path;
+    const uint32_t loadopts = fx->source.load_options;
+
+    auto apply = [&]() -> bool {
+        if (!ysfx_load_file(fx, path.c_str(), loadopts))
+            return false;
+        if (!compiled)
+            return true;
+        if (!ysfx_compile(fx, compileopts))
+            return false;
+        ysfx_init(fx);
+        if (state)
+            ysfx_load_state(fx, state.get());
+        return true;
+    };
+
+    std::map<std::string, ysfx_real> previous = fx->variant.values;
+    fx->variant.values[item->identifier] = value;
+    if (apply())
+        return true;
+
+    // go back to the variant which worked
+    fx->variant.values = std::move(previous);
+    apply();
+    return false;
+}
+
+void ysfx_prepare_config_variants(ysfx_t *fx, bool background)
+{
+    ysfx_source_unit_t *main = fx->source.main.get();
+    if (!main)
+        return;
+
+    // the variants which differ from the current one by a single value
+    std::vector<std::map<std::string, ysfx_real>> wanted;
+    for (const ysfx_config_item &item : main->header.config_items) {
+        for (ysfx_real value : item.var_values) {
+            std::map<std::string, ysfx_real> values = fx->source.config_values;
+            ysfx_real &slot = values[item.identifier];
+            if (slot == value)
+                continue;
+            slot = value;
+            wanted.push_back(std::move(values));
+        }
+    }
+
+    std::string path = fx->source.main_file_path;
+    uint32_t loadopts = fx->source.load_options;
+
+    // each variant loads into an instance of its own, whose sections are then kept
+    auto job = [fx, wanted, path, loadopts]() {
+        for (const std::map<std::string, ysfx_real> &values : wanted) {
+            if (fx->variant.cancel.load())
+                break;
+            {
+                std::lock_guard<ysfx::mutex> lock{fx->variant.mutex};
+                if (fx->variant.cache.find(values) != fx->variant.cache.end())
+                    continue;
+            }
+            ysfx_u other{ysfx_new(fx->config.get())};
+            other->variant.path = path;
+            other->variant.values = values;
+            if (!ysfx_load_file(other.get(), path.c_str(), loadopts))
+                continue;
+            std::lock_guard<ysfx::mutex> lock{fx->variant.mutex};
+            fx->variant.cache.insert(other->variant.cache.begin(), other->variant.cache.end());
+        }
+    };
+
+    fx->variant.worker.reset();
+    if (!background) {
+        job();
+        return;
+    }
+    fx->variant.worker.reset(new ysfx_init_worker_t(job));
+    fx->variant.worker->start();
+}
+
 const char *ysfx_get_author(ysfx_t *fx)
 {
     ysfx_source_unit_t *main = fx->source.main.get();
@@ -772,6 +1780,14 @@ const char *ysfx_get_output_name(ysfx_t *fx, uint32_t index)
     return main->header.out_pins[index].c_str();
 }
 
+bool ysfx_is_sidechain_input(ysfx_t *fx, uint32_t index)
+{
+    ysfx_source_unit_t *main = fx->source.main.get();
+    if (!main || index >= main->header.sidechain_pins.size())
+        return false;
+    return main->header.sidechain_pins[index];
+}
+
 bool ysfx_wants_meters(ysfx_t *fx)
 {
     ysfx_source_unit_t *main = fx->source.main.get();
@@ -781,10 +1797,36 @@ bool ysfx_wants_meters(ysfx_t *fx)
     return !main->header.options.no_meter;
 }
 
+void ysfx_set_metering(ysfx_t *fx, bool enable)
+{
+    if (enable && !fx->meters.ins) {
+        fx->meters.ins.reset(new ysfx_meter_channel_t[ysfx_max_channels]);
+        fx->meters.outs.reset(new ysfx_meter_channel_t[ysfx_max_channels]);
+    }
+    fx->meters.enabled.store(enable, std::memory_order_release);
+}
+
+uint32_t ysfx_get_meters(ysfx_t *fx, bool outputs, ysfx_meter_t *dest, uint32_t destsize)
+{
+    ysfx_meter_channel_t *channels = outputs ? fx->meters.outs.get() : fx->meters.ins.get();
+    if (!channels)
+        return 0;
+
+    const uint32_t count = (outputs ? fx->meters.num_outs : fx->meters.num_ins).load(std::memory_order_acquire);
+    for (uint32_t i = 0; i < std::min(count, destsize); ++i) {
+        ysfx_meter_channel_t &channel = channels[i];
+        const uint64_t frames = channel.frames.exchange(0, std::memory_order_relaxed);
+        const ysfx_real sum_squares = channel.sum_squares.exchange(0, std::memory_order_relaxed);
+        dest[i].peak = channel.peak.exchange(0, std::memory_order_relaxed);
+        dest[i].rms = frames ? std::sqrt(sum_squares / (ysfx_real)frames) : 0;
+    }
+    return count;
+}
+
 bool ysfx_get_gfx_dim(ysfx_t *fx, uint32_t dim[2])
 {
-    ysfx_toplevel_t *origin = nullptr;
-    ysfx_section_t *sec = ysfx_search_section(fx, ysfx_section_gfx, &origin);
+    const ysfx_toplevel_t *origin = nullptr;
+    const ysfx_section_t *sec = ysfx_search_section(fx, ysfx_section_gfx, &origin);
 
     if (!sec) {
         if (dim) {
@@ -801,18 +1843,18 @@ bool ysfx_get_gfx_dim(ysfx_t *fx, uint32_t dim[2])
     return true;
 }
 
-ysfx_section_t *ysfx_search_section(ysfx_t *fx, uint32_t type, ysfx_toplevel_t **origin)
+const ysfx_section_t *ysfx_search_section(ysfx_t *fx, uint32_t type, const ysfx_toplevel_t **origin)
 {
     if (!fx->source.main)
         return nullptr;
 
     auto search =
-        [fx](ysfx_section_t *(*test)(ysfx_toplevel_t &tl), ysfx_toplevel_t **origin) -> ysfx_section_t *
+        [fx](const ysfx_section_t *(*test)(const ysfx_toplevel_t &tl), const ysfx_toplevel_t **origin) -> const ysfx_section_t *
         {
-            ysfx_toplevel_t *tl = &fx->source.main->toplevel;
-            ysfx_section_t *sec = test(*tl);
+            const ysfx_toplevel_t *tl = fx->source.main->toplevel.get();
+            const ysfx_section_t *sec = test(*tl);
             for (size_t i = 0; !sec && i < fx->source.imports.size(); ++i) {
-                tl = &fx->source.imports[i]->toplevel;
+                tl = fx->source.imports[i]->toplevel.get();
                 sec = test(*tl);
             }
             if (origin)
@@ -822,17 +1864,19 @@ ysfx_section_t *ysfx_search_section(ysfx_t *fx, uint32_t type, ysfx_toplevel_t *
 
     switch (type) {
     case ysfx_section_init:
-        return search([](ysfx_toplevel_t &tl) { return tl.init.get(); }, origin);
+        return search([](const ysfx_toplevel_t &tl) -> const ysfx_section_t * { return tl.init.get(); }, origin);
     case ysfx_section_slider:
-        return search([](ysfx_toplevel_t &tl) { return tl.slider.get(); }, origin);
+        return search([](const ysfx_toplevel_t &tl) -> const ysfx_section_t * { return tl.slider.get(); }, origin);
     case ysfx_section_block:
-        return search([](ysfx_toplevel_t &tl) { return tl.block.get(); }, origin);
+        return search([](const ysfx_toplevel_t &tl) -> const ysfx_section_t * { return tl.block.get(); }, origin);
     case ysfx_section_sample:
-        return search([](ysfx_toplevel_t &tl) { return tl.sample.get(); }, origin);
+        return search([](const ysfx_toplevel_t &tl) -> const ysfx_section_t * { return tl.sample.get(); }, origin);
     case ysfx_section_gfx:
-        return search([](ysfx_toplevel_t &tl) { return tl.gfx.get(); }, origin);
+        return search([](const ysfx_toplevel_t &tl) -> const ysfx_section_t * { return tl.gfx.get(); }, origin);
     case ysfx_section_serialize:
-        return search([](ysfx_toplevel_t &tl) { return tl.serialize.get(); }, origin);
+        return search([](const ysfx_toplevel_t &tl) -> const ysfx_section_t * { return tl.serialize.get(); }, origin);
+    case ysfx_section_midi:
+        return search([](const ysfx_toplevel_t &tl) -> const ysfx_section_t * { return tl.midi.get(); }, origin);
     default:
         return nullptr;
     }
@@ -843,23 +1887,79 @@ bool ysfx_has_section(ysfx_t *fx, uint32_t type)
     return ysfx_search_section(fx, type) != nullptr;
 }
 
+uint32_t ysfx_get_changed_sections(ysfx_t *fx, ysfx_t *other)
+{
+    if (!fx->source.main || !other->source.main)
+        return ~(uint32_t)0;
+
+    auto same_code = [](const ysfx_section_t *a, const ysfx_section_t *b) -> bool {
+        if (a == b)
+            return true;
+        return a && b && a->text == b->text;
+    };
+
+    const ysfx_toplevel_t &main = *fx->source.main->toplevel;
+    const ysfx_toplevel_t &other_main = *other->source.main->toplevel;
+    const size_t num_imports = fx->source.imports.size();
+
+    uint32_t changed = 0;
+
+    if (fx->source.main_file_path != other->source.main_file_path ||
+        num_imports != other->source.imports.size() ||
+        !same_code(main.header.get(), other_main.header.get()) ||
+        main.gfx_w != other_main.gfx_w || main.gfx_h != other_main.gfx_h)
+    {
+        changed |= ysfx_changed_header;
+    }
+
+    // all the @init sections run in order, any of them counts
+    bool same_init = same_code(main.init.get(), other_main.init.get());
+    for (size_t i = 0; same_init && i < num_imports && i < other->source.imports.size(); ++i)
+        same_init = same_code(fx->source.imports[i]->toplevel->init.get(), other->source.imports[i]->toplevel->init.get());
+    if (!same_init)
+        changed |= 1u << ysfx_section_init;
+
+    for (uint32_t type = ysfx_section_slider; type <= ysfx_section_midi; ++type) {
+        if (!same_code(ysfx_search_section(fx, type), ysfx_search_section(other, type)))
+            changed |= 1u << type;
+    }
+
+    return changed;
+}
+
 bool ysfx_slider_exists(ysfx_t *fx, uint32_t index)
 {
     ysfx_source_unit_t *main = fx->source.main.get();
     if (index >= ysfx_max_sliders || !main)
         return false;
 
-    ysfx_slider_t &slider = main->header.sliders[index];
+    const ysfx_slider_t &slider = main->header.sliders[index];
     return slider.exists;
 }
 
+uint32_t ysfx_get_slider_indices(ysfx_t *fx, uint32_t *dest, uint32_t destsize)
+{
+    ysfx_source_unit_t *main = fx->source.main.get();
+    if (!main)
+        return 0;
+
+    const std::vector<uint32_t> &indices = main->header.slider_indices;
+    uint32_t count = (uint32_t)indices.size();
+
+    uint32_t copysize = (destsize < count) ? destsize : count;
+    for (uint32_t i = 0; i < copysize; ++i)
+        dest[i] = indices[i];
+
+    return count;
+}
+
 const char *ysfx_slider_get_name(ysfx_t *fx, uint32_t index)
 {
     ysfx_source_unit_t *main = fx->source.main.get();
     if (index >= ysfx_max_sliders || !main)
         return "";
 
-    ysfx_slider_t &slider = main->header.sliders[index];
+    const ysfx_slider_t &slider = main->header.sliders[index];
     return slider.desc.c_str();
 }
 
@@ -869,7 +1969,7 @@ bool ysfx_slider_get_range(ysfx_t *fx, uint32_t index, ysfx_slider_range_t *rang
     if (index >= ysfx_max_sliders || !main)
         return false;
 
-    ysfx_slider_t &slider = main->header.sliders[index];
+    const ysfx_slider_t &slider = main->header.sliders[index];
     range->def = slider.def;
     range->min = slider.min;
     range->max = slider.max;
@@ -883,7 +1983,7 @@ bool ysfx_slider_get_curve(ysfx_t *fx, uint32_t index, ysfx_slider_curve_t *curv
     if (index >= ysfx_max_sliders || !main)
         return false;
 
-    ysfx_slider_t &slider = main->header.sliders[index];
+    const ysfx_slider_t &slider = main->header.sliders[index];
     curve->def = slider.def;
     curve->min = slider.min;
     curve->max = slider.max;
@@ -1068,7 +2168,7 @@ bool ysfx_slider_is_enum(ysfx_t *fx, uint32_t index)
     if (index >= ysfx_max_sliders || !main)
         return false;
 
-    ysfx_slider_t &slider = main->header.sliders[index];
+    const ysfx_slider_t &slider = main->header.sliders[index];
     return slider.is_enum;
 }
 
@@ -1078,7 +2178,7 @@ uint32_t ysfx_slider_get_enum_names(ysfx_t *fx, uint32_t index, const char **des
     if (index >= ysfx_max_sliders || !main)
         return 0;
 
-    ysfx_slider_t &slider = main->header.sliders[index];
+    const ysfx_slider_t &slider = main->header.sliders[index];
     uint32_t count = (uint32_t)slider.enum_names.size();
 
     uint32_t copysize = (destsize < count) ? destsize : count;
@@ -1094,7 +2194,7 @@ const char *ysfx_slider_get_enum_name(ysfx_t *fx, uint32_t slider_index, uint32_
     if (slider_index >= ysfx_max_sliders || !main)
         return 0;
 
-    ysfx_slider_t &slider = main->header.sliders[slider_index];
+    const ysfx_slider_t &slider = main->header.sliders[slider_index];
     if (enum_index >= slider.enum_names.size())
         return "";
 
@@ -1106,7 +2206,7 @@ const char *ysfx_slider_path(ysfx_t *fx, uint32_t slider_index) {
     if (slider_index >= ysfx_max_sliders || !main)
         return 0;
 
-    ysfx_slider_t &slider = main->header.sliders[slider_index];
+    const ysfx_slider_t &slider = main->header.sliders[slider_index];
     if (slider.path.empty()) {
         return 0;
     } else {
@@ -1120,7 +2220,7 @@ bool ysfx_slider_is_path(ysfx_t *fx, uint32_t index)
     if (index >= ysfx_max_sliders || !main)
         return false;
 
-    ysfx_slider_t &slider = main->header.sliders[index];
+    const ysfx_slider_t &slider = main->header.sliders[index];
     return !slider.path.empty();
 }
 
@@ -1130,7 +2230,7 @@ bool ysfx_slider_is_initially_visible(ysfx_t *fx, uint32_t index)
     if (index >= ysfx_max_sliders || !main)
         return false;
 
-    ysfx_slider_t &slider = main->header.sliders[index];
+    const ysfx_slider_t &slider = main->header.sliders[index];
     return slider.initially_visible;
 }
 
@@ -1145,12 +2245,189 @@ void ysfx_slider_set_value(ysfx_t *fx, uint32_t index, ysfx_real value, bool not
 {
     if (index >= ysfx_max_sliders)
         return;
+    // a value set directly interrupts the glide
+    if (fx->slider.ramp[index].remaining > 0) {
+        std::vector<uint32_t> &ramping = fx->slider.ramping;
+        fx->slider.ramp[index].remaining = 0;
+        ramping.erase(std::find(ramping.begin(), ramping.end(), index));
+    }
     if (*fx->var.slider[index] != value) {
         *fx->var.slider[index] = value;
         fx->must_compute_slider = notify;
     }
 }
 
+void ysfx_slider_set_values(ysfx_t *fx, const uint32_t *indices, const ysfx_real *values, uint32_t count, bool normalized)
+{
+    for (uint32_t i = 0; i < count; ++i) {
+        uint32_t index = indices[i];
+        if (index >= ysfx_max_sliders)
+            continue;
+        ysfx_real value = normalized ? fx->slider.curve_table[index].from_normalized(values[i]) : values[i];
+        ysfx_slider_set_value(fx, index, value, true);
+    }
+}
+
+void ysfx_slider_get_values(ysfx_t *fx, const uint32_t *indices, ysfx_real *dest, uint32_t count, bool normalized)
+{
+    for (uint32_t i = 0; i < count; ++i) {
+        uint32_t index = indices[i];
+        if (index >= ysfx_max_sliders) {
+            dest[i] = 0;
+            continue;
+        }
+        ysfx_real value = *fx->var.slider[index];
+        dest[i] = normalized ? fx->slider.curve_table[index].to_normalized(value) : value;
+    }
+}
+
+bool ysfx_slider_set_value_at(ysfx_t *fx, uint32_t index, ysfx_real value, uint32_t offset)
+{
+    if (index >= ysfx_max_sliders || offset >= fx->block_size)
+        return false;
+
+    // this may run on the audio thread, so it stays within what is reserved
+    std::vector<ysfx_slider_event_t> &events = fx->split.slider_events;
+    if (events.size() == events.capacity())
+        return false;
+
+    ysfx_slider_event_t event{index, offset, value};
+    auto pos = std::upper_bound(
+        events.begin(), events.end(), event,
+        [](const ysfx_slider_event_t &a, const ysfx_slider_event_t &b) { return a.offset < b.offset; });
+    events.insert(pos, event);
+    return true;
+}
+
+void ysfx_set_slider_queue_capacity(ysfx_t *fx, uint32_t capacity)
+{
+    fx->slider.queue.reserve(capacity);
+    // the whole queue can be scheduled without allocating
+    fx->split.slider_events.reserve(ysfx_max_sliders + (size_t)fx->slider.queue.capacity());
+}
+
+bool ysfx_post_slider_value(ysfx_t *fx, uint32_t index, ysfx_real value, uint32_t offset)
+{
+    if (index >= ysfx_max_sliders)
+        return false;
+
+    return fx->slider.queue.push(ysfx_slider_event_t{index, offset, value});
+}
+
+bool ysfx_slider_set_smoothing(ysfx_t *fx, uint32_t index, uint32_t frames)
+{
+    if (index >= ysfx_max_sliders)
+        return false;
+
+    fx->slider.ramp[index].frames = frames;
+    return true;
+}
+
+// start the glide of a slider from its current value
+static void ysfx_slider_start_ramp(ysfx_t *fx, uint32_t index, ysfx_real value)
+{
+    ysfx_slider_ramp_t &ramp = fx->slider.ramp[index];
+    ysfx_real current = *fx->var.slider[index];
+    if (ramp.remaining == 0 && current == value)
+        return;
+
+    if (ramp.remaining == 0)
+        fx->slider.ramping.push_back(index);
+
+    // the glide advances once per frame of @sample, which may be oversampled
+    ramp.remaining = ramp.frames * fx->oversampling.factor;
+    ramp.target = value;
+    ramp.step = (value - current) / (ysfx_real)ramp.remaining;
+}
+
+// advance the gliding sliders by some frames, and call @slider later for those which arrive
+static void ysfx_slider_advance_ramps(ysfx_t *fx, uint32_t frames)
+{
+    std::vector<uint32_t> &ramping = fx->slider.ramping;
+
+    for (size_t i = 0; i < ramping.size(); ) {
+        uint32_t index = ramping[i];
+        ysfx_slider_ramp_t &ramp = fx->slider.ramp[index];
+        if (ramp.remaining > frames) {
+            *fx->var.slider[index] += ramp.step * (ysfx_real)frames;
+            ramp.remaining -= frames;
+            ++i;
+        }
+        else {
+            *fx->var.slider[index] = ramp.target;
+            ramp.remaining = 0;
+            fx->must_compute_slider = true;
+            ramping[i] = ramping.back();
+            ramping.pop_back();
+        }
+    }
+}
+
+void ysfx_morph_states(ysfx_t *fx, ysfx_state_t *a, ysfx_state_t *b, ysfx_real t)
+{
+    ysfx_source_unit_t *main = fx->source.main.get();
+    if (!main)
+        return;
+
+    t = (t < 0) ? 0 : (t > 1) ? 1 : t;
+
+    // the values of the sliders in each state, or nothing where the state lacks them
+    const ysfx_real *values_a[ysfx_max_sliders] = {};
+    const ysfx_real *values_b[ysfx_max_sliders] = {};
+    for (uint32_t i = 0; i < a->slider_count; ++i) {
+        if (a->sliders[i].index < ysfx_max_sliders)
+            values_a[a->sliders[i].index] = &a->sliders[i].value;
+    }
+    for (uint32_t i = 0; i < b->slider_count; ++i) {
+        if (b->sliders[i].index < ysfx_max_sliders)
+            values_b[b->sliders[i].index] = &b->sliders[i].value;
+    }
+
+    for (uint32_t index = 0; index < ysfx_max_sliders; ++index) {
+        const ysfx_real *va = values_a[index];
+        const ysfx_real *vb = values_b[index];
+        if (!va && !vb)
+            continue;
+
+        const ysfx_slider_t &slider = main->header.sliders[index];
+        ysfx_real value;
+        if (!va || !vb)
+            value = va ? *va : *vb;
+        else if (slider.is_enum || !slider.path.empty())
+            value = (t < 0.5) ? *va : *vb;
+        else {
+            // move in the normalized range, so log and power curves morph evenly
+            ysfx_slider_curve_t curve;
+            ysfx_slider_get_curve(fx, index, &curve);
+            ysfx_real na = ysfx_ysfx_value_to_normalized(*va, &curve);
+            ysfx_real nb = ysfx_ysfx_value_to_normalized(*vb, &curve);
+            value = (t == 0) ? *va : (t == 1) ? *vb :
+                ysfx_normalized_to_ysfx_value(na + (nb - na) * t, &curve);
+        }
+
+        if (fx->slider.ramp[index].frames > 0)
+            ysfx_slider_start_ramp(fx, index, value);
+        else if (*fx->var.slider[index] != value) {
+            *fx->var.slider[index] = value;
+            fx->must_compute_slider = true;
+        }
+    }
+}
+
+// find a file in a directory of a package, directly or at any depth; false if the directory is not in a package
+static bool ysfx_package_resolve(const std::string &dir, const std::string &name, bool recursive, std::string &result)
+{
+    std::string subdir;
+    ysfx_package_sp package = ysfx_package_find(dir, &subdir);
+    if (!package)
+        return false;
+    const ysfx_package_entry_t *entry = recursive ?
+        package->search(subdir, name) : package->find(ysfx::path_ensure_final_separator(subdir.c_str()) + name);
+    if (entry)
+        result = package->path + '/' + entry->name;
+    return true;
+}
+
 std::string ysfx_resolve_import_path(ysfx_t *fx, const std::string &name, const std::string &origin)
 {
     std::vector<std::string> dirs;
@@ -1182,12 +2459,33 @@ std::string ysfx_resolve_import_path(ysfx_t *fx, const std::string &name, const
     // search for the file in these directories directly
     for (const std::string &dir : dirs) {
         std::string resolved;
-        if (check_existence(dir, name, resolved))
+        if (ysfx_package_resolve(dir, name, false, resolved)) {
+            if (!resolved.empty())
+                return resolved;
+        }
+        else if (check_existence(dir, name, resolved))
             return resolved;
     }
 
-    // search for the file recursively
+    // search for the file recursively, using the index of the import root if possible
     for (const std::string &dir : dirs) {
+        std::string packaged;
+        if (ysfx_package_resolve(dir, name, true, packaged)) {
+            if (!packaged.empty())
+                return packaged;
+            continue;
+        }
+
+        const std::string &import_root = fx->config->import_root;
+        if (nocase && !import_root.empty()) {
+            std::string resolved;
+            ysfx_import_index_result_t found = ysfx_import_index_find(import_root, dir, name, resolved);
+            if (found == ysfx_import_index_found)
+                return resolved;
+            else if (found == ysfx_import_index_not_found)
+                continue;
+        }
+
         struct visit_data {
             const std::string *name = nullptr;
             std::string resolved;
@@ -1224,6 +2522,7 @@ ysfx_real ysfx_get_sample_rate(ysfx_t *fx)
 
 void ysfx_set_block_size(ysfx_t *fx, uint32_t blocksize)
 {
+    ysfx_wait_background_init(fx);
     if (fx->block_size != blocksize) {
         fx->block_size = blocksize;
         fx->must_compute_init = true;
@@ -1232,9 +2531,11 @@ void ysfx_set_block_size(ysfx_t *fx, uint32_t blocksize)
 
 void ysfx_set_sample_rate(ysfx_t *fx, ysfx_real samplerate)
 {
+    ysfx_wait_background_init(fx);
     if (fx->sample_rate != samplerate) {
         fx->sample_rate = samplerate;
         fx->must_compute_init = true;
+        ysfx_update_samples_per_beat(fx);
     }
 }
 
@@ -1242,15 +2543,512 @@ void ysfx_set_midi_capacity(ysfx_t *fx, uint32_t capacity, bool extensible)
 {
     ysfx_midi_reserve(fx->midi.in.get(), capacity, extensible);
     ysfx_midi_reserve(fx->midi.out.get(), capacity, extensible);
+    ysfx_midi_reserve(fx->split.midi_in.get(), capacity, extensible);
+    ysfx_midi_reserve(fx->split.midi_out.get(), capacity, extensible);
+    ysfx_midi_reserve(fx->midi.event.get(), capacity, extensible);
+    // the input is sorted when the cycle is split
+    fx->midi.in->scratch.reserve(capacity);
+    ysfx_set_midi_output_sorted(fx, fx->midi.sort_output);
+    ysfx_set_midi_output_deduplicated(fx, fx->midi.dedup_output, fx->midi.dedup_interval);
+}
+
+void ysfx_set_midi_sysex_capacity(ysfx_t *fx, uint32_t capacity)
+{
+    for (ysfx_midi_buffer_t *midi : {fx->midi.in.get(), fx->midi.out.get(), fx->split.midi_in.get(), fx->split.midi_out.get(), fx->midi.event.get()})
+        ysfx_midi_reserve_pool(midi, capacity);
+}
+
+void ysfx_set_midi_output_sorted(ysfx_t *fx, bool sorted)
+{
+    fx->midi.sort_output = sorted;
+    if (sorted) {
+        for (ysfx_midi_buffer_t *midi : {fx->midi.out.get(), fx->split.midi_out.get()})
+            midi->scratch.reserve(midi->data.capacity());
+    }
+}
+
+void ysfx_set_midi_output_deduplicated(ysfx_t *fx, bool deduplicated, uint32_t min_interval)
+{
+    fx->midi.dedup_output = deduplicated;
+    fx->midi.dedup_interval = min_interval;
+    if (deduplicated) {
+        // the smallest controller event takes 7 bytes of data
+        ysfx_midi_buffer_t *midi = fx->midi.out.get();
+        midi->scratch.reserve(midi->data.capacity());
+        midi->dedup.reserve(midi->data.capacity() / 7);
+    }
+}
+
+void ysfx_set_midi_queue_capacity(ysfx_t *fx, uint32_t capacity)
+{
+    ysfx_midi_queue_reserve(fx->midi.queue.get(), capacity);
+}
+
+uint64_t ysfx_get_midi_overflow(ysfx_t *fx)
+{
+    uint64_t overflow = fx->midi.queue->overflow.load(std::memory_order_relaxed);
+    for (ysfx_midi_buffer_t *midi : {fx->midi.in.get(), fx->midi.out.get(), fx->split.midi_in.get(), fx->split.midi_out.get()})
+        overflow += midi->overflow;
+    return overflow;
+}
+
+void ysfx_set_denormal_mode(ysfx_t *fx, uint32_t mode)
+{
+    fx->denormal_mode = mode;
+}
+
+void ysfx_set_silence_skip(ysfx_t *fx, uint32_t num_blocks, ysfx_real threshold)
+{
+    fx->silence.num_blocks = num_blocks;
+    fx->silence.threshold = threshold;
+    fx->silence.silent_blocks = 0;
+    fx->silence.sleeping.store(false, std::memory_order_relaxed);
+}
+
+void ysfx_set_audio_file_read_ahead(ysfx_t *fx, ysfx_real seconds)
+{
+    fx->file.read_ahead = (seconds > 0) ? seconds : 0;
+}
+
+void ysfx_set_audio_file_resampling(ysfx_t *fx, bool enable)
+{
+    fx->file.resample = enable;
+}
+
+bool ysfx_is_sleeping(ysfx_t *fx)
+{
+    return fx->silence.sleeping.load(std::memory_order_relaxed);
+}
+
+void ysfx_set_oversampling(ysfx_t *fx, uint32_t factor)
+{
+    uint32_t pow2 = 1;
+    while (pow2 < 8 && pow2 * 2 <= factor)
+        pow2 *= 2;
+
+    ysfx_wait_background_init(fx);
+    if (fx->oversampling.factor != pow2) {
+        fx->oversampling.factor = pow2;
+        fx->must_compute_init = true;
+    }
+}
+
+uint32_t ysfx_get_oversampling(ysfx_t *fx)
+{
+    return fx->oversampling.factor;
+}
+
+void ysfx_set_sample_accurate(ysfx_t *fx, uint32_t min_frames)
+{
+    fx->split.min_frames = min_frames;
+}
+
+static uint64_t ysfx_profile_begin(ysfx_t *fx)
+{
+    if (!fx->profile.enabled.load(std::memory_order_relaxed) && !ysfx_trace_enabled())
+        return 0;
+    return ysfx::monotonic_ns();
+}
+
+static void ysfx_profile_end(ysfx_t *fx, uint32_t type, uint64_t begin)
+{
+    if (fx->code.line_probes) {
+        uint32_t slot = (type == ysfx_section_gfx) ? ysfx_line_probe_gfx : ysfx_line_probe_dsp;
+        fx->profile.line[slot].store(0, std::memory_order_relaxed);
+    }
+
+    if (begin == 0)
+        return;
+
+    uint64_t end = ysfx::monotonic_ns();
+    uint64_t ns = end - begin;
+
+    if (ysfx_trace_enabled()) {
+        static const char *const names[ysfx_section_midi + 1] = {
+            "header", "@init", "@slider", "@block", "@sample", "@gfx", "@serialize", "@midi",
+        };
+        ysfx_trace_span(names[type], "section", begin, end);
+    }
+
+    if (!fx->profile.enabled.load(std::memory_order_relaxed))
+        return;
+
+    // each section has a single writer, relaxed accesses are enough
+    ysfx_profile_section_t &section = fx->profile.section[type];
+    section.calls.fetch_add(1, std::memory_order_relaxed);
+    section.total_ns.fetch_add(ns, std::memory_order_relaxed);
+    if (ns < section.min_ns.load(std::memory_order_relaxed))
+        section.min_ns.store(ns, std::memory_order_relaxed);
+    if (ns > section.max_ns.load(std::memory_order_relaxed))
+        section.max_ns.store(ns, std::memory_order_relaxed);
+
+    uint32_t bin = 0;
+    while (bin + 1 < ysfx_profile_histogram_size && (ns >> bin) != 0)
+        ++bin;
+    section.histogram[bin].fetch_add(1, std::memory_order_relaxed);
+}
+
+void ysfx_set_profiling(ysfx_t *fx, bool enable)
+{
+    fx->profile.enabled.store(enable, std::memory_order_relaxed);
+}
+
+bool ysfx_get_profile_stats(ysfx_t *fx, uint32_t type, ysfx_profile_stats_t *stats)
+{
+    if (type < ysfx_section_init || type > ysfx_section_midi)
+        return false;
+
+    const ysfx_profile_section_t &section = fx->profile.section[type];
+    stats->calls = section.calls.load(std::memory_order_relaxed);
+    stats->total_ns = section.total_ns.load(std::memory_order_relaxed);
+    stats->min_ns = stats->calls ? section.min_ns.load(std::memory_order_relaxed) : 0;
+    stats->max_ns = section.max_ns.load(std::memory_order_relaxed);
+    for (uint32_t i = 0; i < ysfx_profile_histogram_size; ++i)
+        stats->histogram[i] = section.histogram[i].load(std::memory_order_relaxed);
+    return true;
+}
+
+void ysfx_set_line_sampling(ysfx_t *fx, bool enable, uint32_t period_us)
+{
+    fx->profile.line_sampler.reset();
+    if (enable)
+        fx->profile.line_sampler.reset(new ysfx_line_sampler_t(fx->profile.line, period_us ? period_us : 1000));
+}
+
+uint32_t ysfx_get_line_samples(ysfx_t *fx, ysfx_line_sample_t *samples, uint32_t max)
+{
+    if (!fx->profile.line_sampler)
+        return 0;
+
+    uint32_t count = 0;
+    for (const auto &item : fx->profile.line_sampler->counts()) {
+        uint32_t unit = item.first >> ysfx_line_probe_unit_shift;
+        const ysfx_source_unit_t *source = nullptr;
+        if (unit == 0)
+            source = fx->source.main.get();
+        else if (unit <= fx->source.imports.size())
+            source = fx->source.imports[unit - 1].get();
+        if (!source)
+            continue;
+        if (count < max) {
+            ysfx_line_sample_t &sample = samples[count];
+            sample.file = source->path.c_str();
+            sample.line = item.first & (((uint32_t)1 << ysfx_line_probe_unit_shift) - 1);
+            sample.count = item.second;
+        }
+        ++count;
+    }
+    return count;
+}
+
+void ysfx_reset_line_samples(ysfx_t *fx)
+{
+    if (fx->profile.line_sampler)
+        fx->profile.line_sampler->reset();
+}
+
+void ysfx_get_load_stats(ysfx_t *fx, ysfx_load_stats_t *stats)
+{
+    // the lazy sections add to the statistics when they compile
+    std::lock_guard<ysfx::mutex> lock{fx->lazy_code_mutex};
+    *stats = fx->load.stats;
+    stats->slowest_file = fx->load.slowest_file.c_str();
+}
+
+void ysfx_reset_profile_stats(ysfx_t *fx)
+{
+    for (ysfx_profile_section_t &section : fx->profile.section) {
+        section.calls.store(0, std::memory_order_relaxed);
+        section.total_ns.store(0, std::memory_order_relaxed);
+        section.min_ns.store(~(uint64_t)0, std::memory_order_relaxed);
+        section.max_ns.store(0, std::memory_order_relaxed);
+        for (std::atomic<uint32_t> &bin : section.histogram)
+            bin.store(0, std::memory_order_relaxed);
+    }
+    fx->profile.gfx_draw_ns.store(0, std::memory_order_relaxed);
+}
+
+uint64_t ysfx_get_gfx_draw_ns(ysfx_t *fx)
+{
+    return fx->profile.gfx_draw_ns.load(std::memory_order_relaxed);
+}
+
+// each effect has a single processing thread, relaxed accesses are enough
+// the time constants of the recent loads
+static const double ysfx_cpu_load_avg_ns = 1e9;
+static const double ysfx_cpu_load_peak_ns = 5e9;
+
+void ysfx_record_deadline(ysfx_t *fx, uint64_t ns, uint32_t num_frames)
+{
+    if (num_frames == 0 || !(fx->sample_rate > 0))
+        return;
+
+    ysfx_deadline_t &deadline = fx->profile.deadline;
+    const double budget_ns = num_frames * 1e9 / fx->sample_rate;
+    const uint64_t load_ppm = (uint64_t)(ns * 1e6 / budget_ns);
+
+    deadline.cycles.fetch_add(1, std::memory_order_relaxed);
+    if (load_ppm > 1000000)
+        deadline.misses.fetch_add(1, std::memory_order_relaxed);
+    if (load_ppm > deadline.max_load_ppm.load(std::memory_order_relaxed))
+        deadline.max_load_ppm.store(load_ppm, std::memory_order_relaxed);
+
+    uint64_t bin = load_ppm / 10000;
+    if (bin >= ysfx_deadline_histogram_size)
+        bin = ysfx_deadline_histogram_size - 1;
+    deadline.histogram[bin].fetch_add(1, std::memory_order_relaxed);
+
+    // the smoothing depends on the duration of the cycle, not on the count of them
+    const double load = ns / budget_ns;
+    const double avg_k = budget_ns / (budget_ns + ysfx_cpu_load_avg_ns);
+    const double peak_k = budget_ns / (budget_ns + ysfx_cpu_load_peak_ns);
+    double avg = deadline.avg_load.load(std::memory_order_relaxed);
+    double peak = deadline.peak_load.load(std::memory_order_relaxed);
+    deadline.avg_load.store(avg + (load - avg) * avg_k, std::memory_order_relaxed);
+    deadline.peak_load.store(std::max(load, peak - peak * peak_k), std::memory_order_relaxed);
+}
+
+void ysfx_get_cpu_load(ysfx_t *fx, double *avg, double *peak)
+{
+    const ysfx_deadline_t &deadline = fx->profile.deadline;
+    if (avg)
+        *avg = deadline.avg_load.load(std::memory_order_relaxed);
+    if (peak)
+        *peak = deadline.peak_load.load(std::memory_order_relaxed);
+}
+
+void ysfx_get_deadline_stats(ysfx_t *fx, ysfx_deadline_stats_t *stats)
+{
+    const ysfx_deadline_t &deadline = fx->profile.deadline;
+    *stats = ysfx_deadline_stats_t{};
+    stats->cycles = deadline.cycles.load(std::memory_order_relaxed);
+    stats->misses = deadline.misses.load(std::memory_order_relaxed);
+    stats->max_load = deadline.max_load_ppm.load(std::memory_order_relaxed) * 1e-6;
+
+    uint64_t binned = 0;
+    for (uint32_t i = 0; i < ysfx_deadline_histogram_size; ++i) {
+        stats->histogram[i] = deadline.histogram[i].load(std::memory_order_relaxed);
+        binned += stats->histogram[i];
+    }
+
+    // the upper bound of the bin which reaches the rank, or the maximum in the last bin
+    auto percentile = [stats, binned](double p) -> double {
+        if (binned == 0)
+            return 0;
+        uint64_t rank = (uint64_t)std::ceil(p * binned);
+        uint64_t count = 0;
+        for (uint32_t i = 0; i + 1 < ysfx_deadline_histogram_size; ++i) {
+            count += stats->histogram[i];
+            if (count >= rank)
+                return std::min((i + 1) * 0.01, stats->max_load);
+        }
+        return stats->max_load;
+    };
+    stats->p50_load = percentile(0.5);
+    stats->p90_load = percentile(0.9);
+    stats->p99_load = percentile(0.99);
+    stats->p999_load = percentile(0.999);
+}
+
+void ysfx_reset_deadline_stats(ysfx_t *fx)
+{
+    ysfx_deadline_t &deadline = fx->profile.deadline;
+    deadline.cycles.store(0, std::memory_order_relaxed);
+    deadline.misses.store(0, std::memory_order_relaxed);
+    deadline.max_load_ppm.store(0, std::memory_order_relaxed);
+    for (std::atomic<uint32_t> &bin : deadline.histogram)
+        bin.store(0, std::memory_order_relaxed);
+    deadline.avg_load.store(0, std::memory_order_relaxed);
+    deadline.peak_load.store(0, std::memory_order_relaxed);
+}
+
+static void ysfx_reserve_scratch(ysfx_t *fx, uint32_t num_frames, uint32_t num_ins, uint32_t num_outs)
+{
+    // sized by @init for the block size; the cycles which exceed it are split
+    if (fx->scratch.in.size() < (size_t)num_frames * num_ins)
+        fx->scratch.in.resize((size_t)num_frames * num_ins);
+    if (fx->scratch.out.size() < (size_t)num_frames * num_outs)
+        fx->scratch.out.resize((size_t)num_frames * num_outs);
+}
+
+static void ysfx_reserve_oversampling(ysfx_t *fx, uint32_t num_frames, uint32_t num_ins, uint32_t num_outs)
+{
+    if (fx->oversampling.in_buf.size() < (size_t)num_frames * num_ins)
+        fx->oversampling.in_buf.resize((size_t)num_frames * num_ins);
+    if (fx->oversampling.out_buf.size() < (size_t)num_frames * num_outs)
+        fx->oversampling.out_buf.resize((size_t)num_frames * num_outs);
+}
+
+// the most frames which the outputs outside of the PDC channels are delayed
+static const uint32_t ysfx_max_pdc_frames = 1 << 20;
+
+// sized after @init, outside of the processing; this only grows
+static void ysfx_reserve_pdc(ysfx_t *fx, uint32_t delay, uint32_t num_channels)
+{
+    uint32_t capacity = 1;
+    while (capacity <= delay)
+        capacity *= 2;
+    if (capacity <= fx->pdc.capacity && num_channels <= fx->pdc.num_channels)
+        return;
+    capacity = std::max(capacity, fx->pdc.capacity);
+    num_channels = std::max(num_channels, fx->pdc.num_channels);
+    fx->pdc.lines.assign((size_t)capacity * num_channels, 0);
+    fx->pdc.capacity = capacity;
+    fx->pdc.num_channels = num_channels;
+    fx->pdc.pos = 0;
+}
+
+static uint32_t ysfx_get_pdc_frames(ysfx_t *fx)
+{
+    ysfx_real delay = std::round(ysfx_get_pdc_delay(fx));
+    return (delay < (ysfx_real)ysfx_max_pdc_frames) ? (uint32_t)delay : ysfx_max_pdc_frames;
+}
+
+// delay the outputs outside of `pdc_bot_ch` and `pdc_top_ch`, in place
+template <class Real>
+static void ysfx_compensate_pdc(ysfx_t *fx, Real *const *outs, uint32_t stride, uint32_t num_outs, uint32_t num_frames)
+{
+    uint32_t channels[2];
+    ysfx_get_pdc_channels(fx, channels);
+    const uint32_t capacity = fx->pdc.capacity;
+    uint32_t delay = (channels[0] < channels[1]) ? ysfx_get_pdc_frames(fx) : 0;
+    // the lines do not grow while processing, so a longer delay is shortened
+    delay = std::min(delay, (capacity > 0) ? (capacity - 1) : 0);
+    if (delay == 0) {
+        fx->pdc.delay = 0;
+        return;
+    }
+
+    // the lines start over when the effect changes the settings
+    if (delay != fx->pdc.delay || channels[0] != fx->pdc.channels[0] || channels[1] != fx->pdc.channels[1]) {
+        std::fill(fx->pdc.lines.begin(), fx->pdc.lines.end(), (ysfx_real)0);
+        fx->pdc.pos = 0;
+        fx->pdc.delay = delay;
+        fx->pdc.channels[0] = channels[0];
+        fx->pdc.channels[1] = channels[1];
+    }
+
+    const uint32_t mask = capacity - 1;
+    for (uint32_t ch = 0; ch < std::min(num_outs, fx->pdc.num_channels); ++ch) {
+        Real *out = outs[ch];
+        if (!out || (ch >= channels[0] && ch < channels[1]))
+            continue;
+        ysfx_real *line = &fx->pdc.lines[(size_t)ch * capacity];
+        uint32_t pos = fx->pdc.pos;
+        for (uint32_t i = 0; i < num_frames; ++i) {
+            ysfx_real value = out[i * stride];
+            out[i * stride] = (Real)line[(pos - delay) & mask];
+            line[pos] = value;
+            pos = (pos + 1) & mask;
+        }
+    }
+    fx->pdc.pos = (fx->pdc.pos + num_frames) & mask;
+}
+
+// reset the processing state which follows @init
+static void ysfx_prepare_processing(ysfx_t *fx)
+{
+    const uint32_t os_factor = fx->oversampling.factor;
+    fx->silence.silent_blocks = 0;
+    fx->silence.sleeping.store(false, std::memory_order_relaxed);
+
+    const uint32_t num_code_ins = (uint32_t)fx->source.main->header.in_pins.size();
+    const uint32_t num_code_outs = (uint32_t)fx->source.main->header.out_pins.size();
+    const uint32_t max_frames = std::max<uint32_t>(fx->block_size, 1);
+    ysfx_reserve_scratch(fx, max_frames, num_code_ins, num_code_outs);
+    if (os_factor > 1)
+        ysfx_reserve_oversampling(fx, max_frames * os_factor, num_code_ins, num_code_outs);
+
+    // reset the oversampling filters
+    fx->oversampling.in.resize(os_factor > 1 ? num_code_ins : 0);
+    fx->oversampling.out.resize(os_factor > 1 ? num_code_outs : 0);
+    for (ysfx_oversampler_t &os : fx->oversampling.in)
+        os.setup(os_factor, fx->block_size);
+    for (ysfx_oversampler_t &os : fx->oversampling.out)
+        os.setup(os_factor, fx->block_size);
+
+    // size the delay lines for the latency which @init has set, and the capacity of the host, and empty them
+    if (fx->pdc.enabled) {
+        const uint32_t frames = std::max(ysfx_get_pdc_frames(fx), std::min(fx->pdc.reserve_frames, ysfx_max_pdc_frames));
+        ysfx_reserve_pdc(fx, frames, std::max(num_code_outs, std::min<uint32_t>(fx->pdc.reserve_channels, ysfx_max_channels)));
+    }
+    fx->pdc.delay = 0;
+
+    // replace the spare strings which @init has taken
+    ysfx_string_pool_refill(fx);
+
+#if !defined(YSFX_NO_GFX)
+    // do initializations on next @gfx, on the gfx thread
+    // release-acquire order is for VM `gfx_*` variables and `wants_retina`
+    fx->gfx.wants_retina = *fx->var.gfx_ext_retina > 0;
+    fx->gfx.must_init.store(true, std::memory_order_release);
+#endif
+}
+
+static void ysfx_run_init(ysfx_t *fx);
+
+static void ysfx_wait_background_init(ysfx_t *fx)
+{
+    if (fx->init_worker)
+        fx->init_worker->wait();
+}
+
+// the @init and the first @slider, on the thread of the worker
+static void ysfx_run_background_init(ysfx_t *fx)
+{
+    ysfx_trace_scope trace{"init", "init"};
+    if (ysfx_trace_enabled())
+        ysfx_trace_name_thread("init");
+
+    ysfx_run_init(fx);
+
+    if (fx->must_compute_slider) {
+        uint64_t profile_begin = ysfx_profile_begin(fx);
+        NSEEL_code_execute(fx->code.slider.get());
+        ysfx_profile_end(fx, ysfx_section_slider, profile_begin);
+        fx->must_compute_slider = false;
+    }
+}
+
+void ysfx_set_background_init(ysfx_t *fx, bool enable)
+{
+    if (!enable)
+        fx->init_worker.reset();
+    else if (!fx->init_worker)
+        fx->init_worker.reset(new ysfx_init_worker_t([fx]() { ysfx_run_background_init(fx); }));
+}
+
+bool ysfx_is_initializing(ysfx_t *fx)
+{
+    return fx->init_worker && fx->init_worker->running();
+}
+
+// whether the processing waits for @init, which it starts in the background if due
+static bool ysfx_must_wait_init(ysfx_t *fx)
+{
+    ysfx_init_worker_t *worker = fx->init_worker.get();
+    if (worker->running())
+        return true;
+    if (!fx->must_compute_init)
+        return false;
+    worker->start();
+    return true;
 }
 
 void ysfx_init(ysfx_t *fx)
+{
+    ysfx_wait_background_init(fx);
+    ysfx_run_init(fx);
+}
+
+static void ysfx_run_init(ysfx_t *fx)
 {
     if (!fx->code.compiled)
         return;
 
-    *fx->var.samplesblock = (EEL_F)fx->block_size;
-    *fx->var.srate = fx->sample_rate;
+    const uint32_t os_factor = fx->oversampling.factor;
+    *fx->var.samplesblock = (EEL_F)(fx->block_size * os_factor);
+    *fx->var.srate = fx->sample_rate * os_factor;
 
     if (fx->is_freshly_compiled) {
         *fx->var.pdc_delay = 0;
@@ -1268,22 +3066,33 @@ void ysfx_init(ysfx_t *fx)
     }
 
     ysfx_clear_files(fx);
+    fx->convolver.list.clear();
+    fx->lookahead.list.clear();
+
+    {
+        std::lock_guard<ysfx::mutex> lock(fx->file.resolved_mutex);
+        fx->file.init_manifest.clear();
+        fx->file.recording_init = true;
+    }
 
+    uint64_t profile_begin = ysfx_profile_begin(fx);
     for (size_t i = 0; i < fx->code.init.size(); ++i)
     {
         // TODO: @init should never run concurrently with any other thread
         NSEEL_code_execute(fx->code.init[i].get());
     };
+    ysfx_profile_end(fx, ysfx_section_init, profile_begin);
+
+    {
+        std::lock_guard<ysfx::mutex> lock(fx->file.resolved_mutex);
+        fx->file.recording_init = false;
+    }
 
     fx->must_compute_init = false;
     fx->must_compute_slider = true;
 
-#if !defined(YSFX_NO_GFX)
-    // do initializations on next @gfx, on the gfx thread
-    // release-acquire order is for VM `gfx_*` variables and `wants_retina`
-    fx->gfx.wants_retina = *fx->var.gfx_ext_retina > 0;
-    fx->gfx.must_init.store(true, std::memory_order_release);
-#endif
+    ysfx_prefault_memory(fx, fx->memory.auto_prefault);
+    ysfx_prepare_processing(fx);
 }
 
 void ysfx_first_init(ysfx_t *fx)
@@ -1302,7 +3111,16 @@ void ysfx_first_init(ysfx_t *fx)
 ysfx_real ysfx_get_pdc_delay(ysfx_t *fx)
 {
     ysfx_real value = *fx->var.pdc_delay;
-    return (value > 0) ? value : 0;
+    value = (value > 0) ? value : 0;
+
+    // the effect counts in frames of the oversampled rate
+    const uint32_t os_factor = fx->oversampling.factor;
+    if (os_factor > 1 && !fx->oversampling.in.empty())
+        value = value / os_factor + fx->oversampling.in[0].latency();
+    else if (os_factor > 1 && !fx->oversampling.out.empty())
+        value = value / os_factor + fx->oversampling.out[0].latency();
+
+    return value;
 }
 
 void ysfx_get_pdc_channels(ysfx_t *fx, uint32_t channels[2])
@@ -1326,20 +3144,39 @@ bool ysfx_get_pdc_midi(ysfx_t *fx)
     return (bool)*fx->var.pdc_midi;
 }
 
+void ysfx_set_pdc_compensation(ysfx_t *fx, bool enable)
+{
+    fx->pdc.enabled = enable;
+    fx->pdc.delay = 0;
+}
+
+void ysfx_set_pdc_capacity(ysfx_t *fx, uint32_t num_channels, uint32_t num_frames)
+{
+    fx->pdc.reserve_channels = num_channels;
+    fx->pdc.reserve_frames = num_frames;
+}
+
 void ysfx_update_slider_visibility_mask(ysfx_t *fx)
 {
     uint32_t slider_idx = 0;
     for (uint32_t group = 0; group < ysfx_max_slider_groups; ++group) {
         uint64_t visible = 0;
         for (uint32_t i = 0; i < 64; ++i) {
-            ysfx_slider_t &slider = fx->source.main->header.sliders[slider_idx++];
+            const ysfx_slider_t &slider = fx->source.main->header.sliders[slider_idx++];
             visible |= (uint64_t)slider.initially_visible << i;
         }
     
-        fx->slider.visible_mask[group].store(visible);
+        uint64_t previous = fx->slider.visible_mask[group].exchange(visible);
+        fx->slider.visible_change_mask[group].fetch_or(previous ^ visible);
     }
 }
 
+static void ysfx_update_samples_per_beat(ysfx_t *fx)
+{
+    ysfx_real tempo = fx->transport.info.tempo;
+    fx->transport.samples_per_beat = (tempo > 0) ? (fx->sample_rate * 60 / tempo) : 0;
+}
+
 void ysfx_set_time_info(ysfx_t *fx, const ysfx_time_info_t *info)
 {
     uint32_t prev_state = (uint32_t)*fx->var.play_state;
@@ -1358,9 +3195,41 @@ void ysfx_set_time_info(ysfx_t *fx, const ysfx_time_info_t *info)
     *fx->var.tempo = info->tempo;
     *fx->var.play_state = (EEL_F)new_state;
     *fx->var.play_position = info->time_position;
+    *fx->var.play_offline = info->offline ? 1 : 0;
     *fx->var.beat_position = info->beat_position;
     *fx->var.ts_num = (EEL_F)info->time_signature[0];
     *fx->var.ts_denom = (EEL_F)info->time_signature[1];
+
+    // recompute the derived values only for what has changed
+    ysfx_transport_t &transport = fx->transport;
+    bool tempo_changed = transport.info.tempo != info->tempo;
+    bool signature_changed = transport.info.time_signature[0] != info->time_signature[0] ||
+        transport.info.time_signature[1] != info->time_signature[1];
+    bool beat_changed = transport.info.beat_position != info->beat_position;
+    transport.info = *info;
+    fx->offline.store(info->offline, std::memory_order_relaxed);
+
+    if (tempo_changed)
+        ysfx_update_samples_per_beat(fx);
+    if (signature_changed) {
+        uint32_t num = info->time_signature[0];
+        uint32_t denom = info->time_signature[1];
+        transport.beats_per_bar = (num > 0 && denom > 0) ? ((ysfx_real)num * 4 / denom) : 0;
+    }
+    if (signature_changed || beat_changed) {
+        ysfx_real beats_per_bar = transport.beats_per_bar;
+        transport.bar_position = (beats_per_bar > 0) ? (info->beat_position / beats_per_bar) : 0;
+    }
+}
+
+void ysfx_get_transport(ysfx_t *fx, ysfx_transport_t *transport)
+{
+    *transport = fx->transport;
+}
+
+bool ysfx_is_offline(ysfx_t *fx)
+{
+    return fx->offline.load(std::memory_order_relaxed);
 }
 
 bool ysfx_send_midi(ysfx_t *fx, const ysfx_midi_event_t *event)
@@ -1368,6 +3237,11 @@ bool ysfx_send_midi(ysfx_t *fx, const ysfx_midi_event_t *event)
     return ysfx_midi_push(fx->midi.in.get(), event);
 }
 
+bool ysfx_post_midi(ysfx_t *fx, const ysfx_midi_event_t *event)
+{
+    return ysfx_midi_queue_post(fx->midi.queue.get(), event);
+}
+
 bool ysfx_receive_midi(ysfx_t *fx, ysfx_midi_event_t *event)
 {
     return ysfx_midi_get_next(fx->midi.out.get(), event);
@@ -1375,7 +3249,27 @@ bool ysfx_receive_midi(ysfx_t *fx, ysfx_midi_event_t *event)
 
 bool ysfx_receive_midi_from_bus(ysfx_t *fx, uint32_t bus, ysfx_midi_event_t *event)
 {
-    return ysfx_midi_get_next_from_bus(fx->midi.out.get(), 0, event);
+    return ysfx_midi_get_next_from_bus(fx->midi.out.get(), bus, event);
+}
+
+bool ysfx_send_ump(ysfx_t *fx, const ysfx_ump_event_t *event)
+{
+    return ysfx_midi_push_ump(fx->midi.in.get(), event);
+}
+
+bool ysfx_receive_ump(ysfx_t *fx, ysfx_ump_event_t *event)
+{
+    return ysfx_midi_get_next_ump(fx->midi.out.get(), event);
+}
+
+uint32_t ysfx_send_midi_batch(ysfx_t *fx, const ysfx_midi_event_t *events, uint32_t count)
+{
+    return ysfx_midi_push_batch(fx->midi.in.get(), events, count);
+}
+
+uint32_t ysfx_receive_midi_batch(ysfx_t *fx, ysfx_midi_event_t *events, uint32_t max)
+{
+    return ysfx_midi_get_next_batch(fx->midi.out.get(), events, max);
 }
 
 uint32_t ysfx_current_midi_bus(ysfx_t *fx)
@@ -1395,6 +3289,20 @@ bool ysfx_send_trigger(ysfx_t *fx, uint32_t index)
     return true;
 }
 
+bool ysfx_send_trigger_at(ysfx_t *fx, uint32_t index, uint32_t offset)
+{
+    if (index >= ysfx_max_triggers)
+        return false;
+
+    std::vector<ysfx_trigger_event_t> &events = fx->split.trigger_events;
+    ysfx_trigger_event_t event{index, offset};
+    auto pos = std::upper_bound(
+        events.begin(), events.end(), event,
+        [](const ysfx_trigger_event_t &a, const ysfx_trigger_event_t &b) { return a.offset < b.offset; });
+    events.insert(pos, event);
+    return true;
+}
+
 // A little helper function to find which of the bitsets we have to use
 uint8_t ysfx_fetch_slider_group_index(uint32_t slider_number) {
     return slider_number >> 6;
@@ -1414,6 +3322,46 @@ uint64_t ysfx_fetch_slider_automations(ysfx_t *fx, uint8_t slider_group_index)
     return fx->slider.automate_mask[slider_group_index].exchange(0);
 }
 
+void ysfx_set_slider_automation_capacity(ysfx_t *fx, uint32_t capacity)
+{
+    fx->slider.automation.reserve(capacity);
+}
+
+bool ysfx_receive_slider_automation(ysfx_t *fx, ysfx_slider_automation_t *automation)
+{
+    ysfx_slider_event_t event;
+    if (!fx->slider.automation.pop(event))
+        return false;
+
+    automation->index = event.index;
+    automation->offset = event.offset;
+    automation->value = event.value;
+    return true;
+}
+
+uint64_t ysfx_fetch_slider_value_changes(ysfx_t *fx, uint8_t slider_group_index)
+{
+    if (!fx->code.compiled || slider_group_index >= ysfx_max_slider_groups)
+        return 0;
+
+    uint32_t first = (uint32_t)slider_group_index * 64;
+    const ysfx_slider_table_t &sliders = fx->source.main->header.sliders;
+    EEL_F *const *vars = &fx->var.slider[first];
+    ysfx_real *cache = &fx->slider.value_cache[first];
+
+    uint64_t changes = 0;
+    for (uint32_t i = 0; i < 64; ++i) {
+        if (!sliders[first + i].exists)
+            continue;
+        ysfx_real value = *vars[i];
+        if (value != cache[i] && !(std::isnan(value) && std::isnan(cache[i]))) {
+            cache[i] = value;
+            changes |= (uint64_t)1 << i;
+        }
+    }
+    return changes;
+}
+
 bool ysfx_fetch_want_undopoint(ysfx_t *fx)
 {
     if (!fx) return false;
@@ -1440,34 +3388,460 @@ uint64_t ysfx_get_slider_visibility(ysfx_t *fx, uint8_t slider_group_index)
     return fx->slider.visible_mask[slider_group_index].load();
 }
 
+uint64_t ysfx_fetch_slider_visibility_changes(ysfx_t *fx, uint8_t slider_group_index)
+{
+    return fx->slider.visible_change_mask[slider_group_index].exchange(0);
+}
+
+void ysfx_set_slider_visibility_callback(ysfx_t *fx, ysfx_slider_visibility_callback_t *callback, void *userdata)
+{
+    fx->slider.visible_callback = callback;
+    fx->slider.visible_callback_data = userdata;
+}
+
+static void ysfx_take_vmem_snapshot(ysfx_t *fx);
+static void ysfx_take_slider_snapshot(ysfx_t *fx);
+
+// compute @midi for the input events before the frame `end`, and return the offset of the next one
+static uint32_t ysfx_run_midi_section(ysfx_t *fx, uint32_t end)
+{
+    ysfx_midi_buffer_t *in = fx->midi.in.get();
+    ysfx_midi_event_t &event = fx->midi.pending;
+    const bool ext_midi_bus = *fx->var.ext_midi_bus != 0;
+
+    while (fx->midi.has_pending || ysfx_midi_get_next_raw(in, &event)) {
+        if (event.offset >= end) {
+            fx->midi.has_pending = true;
+            return event.offset;
+        }
+        fx->midi.has_pending = false;
+
+        uint32_t bus = event.bus & ~ysfx_midi_bus_ump;
+        if (bus != 0 && !ext_midi_bus)
+            continue;
+        if (ext_midi_bus)
+            *fx->var.midi_bus = (EEL_F)bus;
+
+        // the MIDI functions see this event as the only input
+        ysfx_midi_clear(fx->midi.event.get());
+        ysfx_midi_push(fx->midi.event.get(), &event);
+        std::swap(fx->midi.in, fx->midi.event);
+        uint64_t profile_begin = ysfx_profile_begin(fx);
+        NSEEL_code_execute(fx->code.midi.get());
+        ysfx_profile_end(fx, ysfx_section_midi, profile_begin);
+        std::swap(fx->midi.in, fx->midi.event);
+    }
+
+    return ~(uint32_t)0;
+}
+
+// prepare the frame `i` for @sample, with the events and the glides which come before it
+static void ysfx_load_sample_frame(ysfx_t *fx, uint32_t i)
+{
+    auto &frames = fx->frames;
+    const uint32_t os_factor = fx->oversampling.factor;
+    fx->split.frame = frames.offset + (os_factor > 1 ? i / os_factor : i);
+    if (i >= frames.next_midi)
+        frames.next_midi = ysfx_run_midi_section(fx, i + 1);
+    if (!fx->slider.ramping.empty())
+        ysfx_slider_advance_ramps(fx, 1);
+    EEL_F **spl = fx->var.spl.data();
+    for (uint32_t ch = 0; ch < frames.num_ins; ++ch)
+        *spl[ch] = frames.in[ch * frames.num_frames + i];
+}
+
+static void ysfx_store_sample_frame(ysfx_t *fx, uint32_t i)
+{
+    auto &frames = fx->frames;
+    EEL_F **spl = fx->var.spl.data();
+    for (uint32_t ch = 0; ch < frames.num_outs; ++ch)
+        frames.out[ch * frames.num_frames + i] = *spl[ch];
+}
+
+uint32_t ysfx_sample_loop_count(ysfx_t *fx)
+{
+    auto &frames = fx->frames;
+    if (!frames.looping)
+        return 0;
+    // the loops of EEL are bounded, so a large block takes more than one run
+    return std::min<uint32_t>(frames.num_frames - frames.index, NSEEL_LOOPFUNC_SUPPORT_MAXLEN);
+}
+
+void ysfx_sample_loop_step(ysfx_t *fx)
+{
+    auto &frames = fx->frames;
+    if (!frames.looping || frames.index >= frames.num_frames)
+        return;
+    if (frames.pending)
+        ysfx_store_sample_frame(fx, frames.index - 1);
+    ysfx_load_sample_frame(fx, frames.index++);
+    frames.pending = true;
+}
+
+template <class Real>
+static void ysfx_process_sub_block(ysfx_t *fx, const Real *const *ins, Real *const *outs, uint32_t stride, uint32_t num_ins, uint32_t num_code_ins, uint32_t num_outs, uint32_t offset, uint32_t num_frames, EEL_F denorm_value)
+{
+    const uint32_t os_factor = fx->oversampling.factor;
+    *fx->var.samplesblock = (EEL_F)(num_frames * os_factor);
+
+    // MIDI offsets are in frames of the oversampled rate
+    if (os_factor > 1)
+        ysfx_midi_scale_offsets(fx->midi.in.get(), os_factor, 1);
+
+    fx->split.frame = offset;
+
+    // compute @slider if needed
+    if (fx->must_compute_slider) {
+        // TODO: slider must never run concurrently with @sample or @block
+        uint64_t profile_begin = ysfx_profile_begin(fx);
+        NSEEL_code_execute(fx->code.slider.get());
+        ysfx_profile_end(fx, ysfx_section_slider, profile_begin);
+        fx->must_compute_slider = false;
+    }
+
+    // compute @block
+    uint64_t profile_begin = ysfx_profile_begin(fx);
+    NSEEL_code_execute(fx->code.block.get());
+    ysfx_profile_end(fx, ysfx_section_block, profile_begin);
+
+    // without @sample, the sliders glide by whole sub-blocks
+    if (!fx->code.sample && !fx->slider.ramping.empty())
+        ysfx_slider_advance_ramps(fx, num_frames * os_factor);
+
+    // compute @midi for every input event, before the @sample of its frame
+    //   without @sample, everything runs after @block
+    fx->midi.has_pending = false;
+    if (fx->code.midi && !fx->code.sample)
+        ysfx_run_midi_section(fx, ~(uint32_t)0);
+
+    // compute @sample, once per frame
+    if (fx->code.sample) {
+        ysfx_real *scratch_in = fx->scratch.in.data();
+        ysfx_real *scratch_out = fx->scratch.out.data();
+
+        // convert the inputs at once, in planar layout
+        //   a null channel of the host is silent, as are the pins beyond
+        for (uint32_t ch = 0; ch < num_code_ins; ++ch) {
+            if (ch < num_ins && ins[ch])
+                ysfx::convert_in(&ins[ch][offset * stride], stride, &scratch_in[ch * num_frames], num_frames, denorm_value);
+            else
+                std::fill_n(&scratch_in[ch * num_frames], num_frames, denorm_value);
+        }
+
+        // run at the oversampled rate, between the filters
+        uint32_t num_spl_frames = num_frames;
+        ysfx_real *spl_in = scratch_in;
+        ysfx_real *spl_out = scratch_out;
+        if (os_factor > 1) {
+            num_spl_frames = num_frames * os_factor;
+            spl_in = fx->oversampling.in_buf.data();
+            spl_out = fx->oversampling.out_buf.data();
+            for (uint32_t ch = 0; ch < num_code_ins; ++ch)
+                fx->oversampling.in[ch].upsample(&scratch_in[ch * num_frames], &spl_in[ch * num_spl_frames], num_frames);
+        }
+
+        auto &frames = fx->frames;
+        frames.in = spl_in;
+        frames.out = spl_out;
+        frames.num_ins = num_code_ins;
+        frames.num_outs = num_outs;
+        frames.num_frames = num_spl_frames;
+        frames.offset = offset;
+        frames.index = 0;
+        frames.next_midi = fx->code.midi ? ysfx_run_midi_section(fx, 1) : ~(uint32_t)0;
+
+        // the variant for the values which @init, @slider and @block have set
+        NSEEL_CODEHANDLE sample_code = fx->code.sample.get();
+        NSEEL_CODEHANDLE loop_code = fx->code.sample_loop.get();
+        if (fx->code.specializer) {
+            if (NSEEL_CODEHANDLE code = fx->code.specializer->code()) {
+                sample_code = code;
+                loop_code = nullptr;
+            }
+        }
+
+        profile_begin = ysfx_profile_begin(fx);
+        if (loop_code) {
+            // the loop stores the outputs of a frame as it goes to the next, except the last
+            frames.looping = true;
+            frames.pending = false;
+            while (frames.index < num_spl_frames)
+                NSEEL_code_execute(loop_code);
+            if (frames.pending)
+                ysfx_store_sample_frame(fx, frames.index - 1);
+            frames.looping = false;
+        }
+        else {
+            for (uint32_t i = 0; i < num_spl_frames; ++i) {
+                ysfx_load_sample_frame(fx, i);
+                NSEEL_code_execute(sample_code);
+                ysfx_store_sample_frame(fx, i);
+            }
+        }
+        ysfx_profile_end(fx, ysfx_section_sample, profile_begin);
+
+        // the events which are past the end
+        fx->split.frame = offset + num_frames - 1;
+        if (fx->code.midi)
+            ysfx_run_midi_section(fx, ~(uint32_t)0);
+
+        if (os_factor > 1) {
+            for (uint32_t ch = 0; ch < num_outs; ++ch)
+                fx->oversampling.out[ch].downsample(&spl_out[ch * num_spl_frames], &scratch_out[ch * num_frames], num_frames);
+        }
+
+        for (uint32_t ch = 0; ch < num_outs; ++ch) {
+            if (outs[ch])
+                ysfx::convert_out(&scratch_out[ch * num_frames], &outs[ch][offset * stride], stride, num_frames);
+        }
+    }
+
+    if (os_factor > 1)
+        ysfx_midi_scale_offsets(fx->midi.out.get(), 1, os_factor);
+}
+
+static void ysfx_apply_slider_events(ysfx_t *fx, uint32_t end)
+{
+    std::vector<ysfx_slider_event_t> &events = fx->split.slider_events;
+
+    size_t count = 0;
+    while (count < events.size() && events[count].offset < end) {
+        const ysfx_slider_event_t &event = events[count++];
+        if (fx->slider.ramp[event.index].frames > 0)
+            ysfx_slider_start_ramp(fx, event.index, event.value);
+        else
+            ysfx_slider_set_value(fx, event.index, event.value, true);
+    }
+
+    events.erase(events.begin(), events.begin() + count);
+}
+
+static void ysfx_apply_trigger_events(ysfx_t *fx, uint32_t end)
+{
+    std::vector<ysfx_trigger_event_t> &events = fx->split.trigger_events;
+
+    uint32_t triggers = (uint32_t)*fx->var.trigger;
+    size_t count = 0;
+    while (count < events.size() && events[count].offset < end)
+        triggers |= 1u << events[count++].index;
+    *fx->var.trigger = (EEL_F)triggers;
+
+    events.erase(events.begin(), events.begin() + count);
+}
+
+template <class Real>
+static bool ysfx_is_silent(const Real *const *chans, uint32_t stride, uint32_t num_chans, uint32_t num_frames, ysfx_real threshold)
+{
+    for (uint32_t ch = 0; ch < num_chans; ++ch) {
+        const Real *chan = chans[ch];
+        if (!chan)
+            continue;
+        for (uint32_t i = 0; i < num_frames; ++i) {
+            if (std::fabs(chan[i * stride]) > threshold)
+                return false;
+        }
+    }
+    return true;
+}
+
+// the most frames of a sub-block which the buffers of @sample hold, as @init has sized them
+static uint32_t ysfx_get_max_sub_block(ysfx_t *fx, uint32_t num_code_ins, uint32_t num_outs)
+{
+    if (!fx->code.sample)
+        return ~(uint32_t)0;
+
+    const uint32_t os_factor = fx->oversampling.factor;
+    size_t frames = fx->block_size;
+    if (num_code_ins > 0)
+        frames = std::min(frames, fx->scratch.in.size() / num_code_ins);
+    if (num_outs > 0)
+        frames = std::min(frames, fx->scratch.out.size() / num_outs);
+    if (os_factor > 1) {
+        if (num_code_ins > 0)
+            frames = std::min(frames, fx->oversampling.in_buf.size() / ((size_t)num_code_ins * os_factor));
+        if (num_outs > 0)
+            frames = std::min(frames, fx->oversampling.out_buf.size() / ((size_t)num_outs * os_factor));
+    }
+    return (uint32_t)frames;
+}
+
 template <class Real>
-void ysfx_process_generic(ysfx_t *fx, const Real *const *ins, Real *const *outs, uint32_t num_ins, uint32_t num_outs, uint32_t num_frames)
+static void ysfx_process_code(ysfx_t *fx, const Real *const *ins, Real *const *outs, uint32_t stride, uint32_t num_ins, uint32_t num_code_ins, uint32_t num_outs, uint32_t num_frames, EEL_F denorm_value)
+{
+    // a cycle longer than the block size is split, rather than growing the buffers on the audio thread
+    const uint32_t max_frames = std::max<uint32_t>(ysfx_get_max_sub_block(fx, num_code_ins, num_outs), 1);
+
+    // in order, the sub-blocks take their MIDI in a single pass
+    if (fx->split.min_frames > 0 || num_frames > max_frames)
+        ysfx_midi_sort(fx->midi.in.get());
+
+    // collect the offsets where the cycle must be split
+    std::vector<uint32_t> &points = fx->split.points;
+    points.clear();
+    if (fx->split.min_frames > 0) {
+        ysfx_midi_event_t event;
+        while (ysfx_midi_get_next(fx->midi.in.get(), &event)) {
+            if (event.offset < num_frames)
+                points.push_back(event.offset);
+        }
+        ysfx_midi_rewind(fx->midi.in.get());
+        for (const ysfx_slider_event_t &event : fx->split.slider_events) {
+            if (event.offset < num_frames)
+                points.push_back(event.offset);
+        }
+        for (const ysfx_trigger_event_t &event : fx->split.trigger_events) {
+            if (event.offset < num_frames)
+                points.push_back(event.offset);
+        }
+        std::sort(points.begin(), points.end());
+        points.erase(std::unique(points.begin(), points.end()), points.end());
+    }
+
+    if ((points.empty() || (points.size() == 1 && points[0] == 0)) && num_frames <= max_frames) {
+        ysfx_apply_slider_events(fx, ~(uint32_t)0);
+        ysfx_apply_trigger_events(fx, ~(uint32_t)0);
+        ysfx_process_sub_block<Real>(fx, ins, outs, stride, num_ins, num_code_ins, num_outs, 0, num_frames, denorm_value);
+    }
+    else {
+        ysfx_midi_buffer_t *cycle_in = fx->midi.in.get();
+        ysfx_midi_buffer_t *midi_in = fx->split.midi_in.get();
+        ysfx_midi_buffer_t *midi_out = fx->split.midi_out.get();
+        size_t next_point = 0;
+        uint32_t start = 0;
+
+        // the first input event which no sub-block has taken yet
+        ysfx_midi_event_t next_event;
+        bool has_next_event = ysfx_midi_get_next_raw(cycle_in, &next_event);
+
+        while (start < num_frames) {
+            // find the end of this sub-block, respecting the minimum length
+            uint32_t end = num_frames;
+            while (next_point < points.size() && points[next_point] < start + fx->split.min_frames)
+                ++next_point;
+            if (next_point < points.size() && points[next_point] < num_frames)
+                end = points[next_point];
+            if (end - start > max_frames)
+                end = start + max_frames;
+            const bool last = end == num_frames;
+
+            ysfx_apply_slider_events(fx, last ? ~(uint32_t)0 : end);
+            ysfx_apply_trigger_events(fx, last ? ~(uint32_t)0 : end);
+
+            // extract the MIDI of this sub-block, relative to its start
+            ysfx_midi_clear(midi_in);
+            ysfx_midi_clear(midi_out);
+            for (; has_next_event && (last || next_event.offset < end); has_next_event = ysfx_midi_get_next_raw(cycle_in, &next_event)) {
+                ysfx_midi_event_t event = next_event;
+                event.offset -= start;
+                ysfx_midi_push(midi_in, &event);
+            }
+
+            std::swap(fx->midi.in, fx->split.midi_in);
+            std::swap(fx->midi.out, fx->split.midi_out);
+            ysfx_process_sub_block<Real>(fx, ins, outs, stride, num_ins, num_code_ins, num_outs, start, end - start, denorm_value);
+            std::swap(fx->midi.in, fx->split.midi_in);
+            std::swap(fx->midi.out, fx->split.midi_out);
+
+            // collect the MIDI output, relative to the whole cycle
+            ysfx_midi_event_t event;
+            while (ysfx_midi_get_next_raw(midi_out, &event)) {
+                event.offset += start;
+                ysfx_midi_push(fx->midi.out.get(), &event);
+            }
+
+            // triggers fire on the first sub-block, or the one of their offset
+            *fx->var.trigger = 0;
+            start = end;
+        }
+        ysfx_midi_rewind(cycle_in);
+    }
+}
+
+// accumulate the levels of the channels into the meters, for a reader to take
+template <class Real>
+static void ysfx_measure_channels(ysfx_meter_channel_t *channels, std::atomic<uint32_t> &counter, const Real *const *bufs, uint32_t stride, uint32_t num_channels, uint32_t num_frames)
+{
+    for (uint32_t ch = 0; ch < num_channels; ++ch) {
+        // a null channel is measured as silence
+        ysfx_real peak = 0;
+        ysfx_real sum_squares = 0;
+        if (bufs[ch])
+            ysfx::measure_levels(bufs[ch], stride, num_frames, peak, sum_squares);
+
+        ysfx_meter_channel_t &channel = channels[ch];
+        ysfx_real old = channel.peak.load(std::memory_order_relaxed);
+        while (peak > old && !channel.peak.compare_exchange_weak(old, peak, std::memory_order_relaxed));
+        old = channel.sum_squares.load(std::memory_order_relaxed);
+        while (!channel.sum_squares.compare_exchange_weak(old, old + sum_squares, std::memory_order_relaxed));
+        channel.frames.fetch_add(num_frames, std::memory_order_relaxed);
+    }
+    counter.store(num_channels, std::memory_order_release);
+}
+
+template <class Real>
+static void ysfx_process_generic(ysfx_t *fx, const Real *const *ins, Real *const *outs, uint32_t stride, uint32_t num_ins, uint32_t num_outs, uint32_t num_frames)
 {
     ysfx_set_thread_id(ysfx_thread_id_dsp);
 
+    const uint64_t cycle_begin = ysfx::monotonic_ns();
+    const bool tracing = ysfx_trace_enabled();
+    if (tracing)
+        ysfx_trace_name_thread("dsp");
+
+    // while @init runs in the background, the audio passes through, and the events wait for it;
+    //   an offline render waits for it instead, as it has no deadline to keep
+    const bool offline = fx->transport.info.offline;
+    if (offline)
+        ysfx_wait_background_init(fx);
+    else if (fx->init_worker && fx->code.compiled && ysfx_must_wait_init(fx)) {
+        for (uint32_t ch = 0; ch < std::min(num_ins, num_outs); ++ch)
+            ysfx::copy_samples(ins[ch], outs[ch], stride, num_frames);
+        for (uint32_t ch = std::min(num_ins, num_outs); ch < num_outs; ++ch)
+            ysfx::clear_samples(outs[ch], stride, num_frames);
+        ysfx_midi_clear(fx->midi.out.get());
+        ysfx_set_thread_id(ysfx_thread_id_none);
+        return;
+    }
+
+    const bool flush_denormals = fx->denormal_mode == ysfx_denormal_flush_to_zero && ysfx::can_flush_denormals();
+    ysfx::scoped_flush_denormals denormals_guard{flush_denormals};
+
     // prepare MIDI input for reading, output for writing
     assert(fx->midi.in->read_pos == 0);
+    ysfx_midi_queue_drain(fx->midi.queue.get(), fx->midi.in.get());
     ysfx_midi_clear(fx->midi.out.get());
+    // the events which the code cannot receive neither split the cycle, nor wake it up
+    if (fx->code.compiled && !(fx->code.capabilities & ysfx_capability_midi_in))
+        ysfx_midi_clear(fx->midi.in.get());
+    if (tracing)
+        ysfx_trace_count("midi in bytes", (int64_t)fx->midi.in->data.size());
+
+    // schedule the slider changes posted by other threads
+    for (ysfx_slider_event_t event; fx->slider.queue.pop(event); )
+        ysfx_slider_set_value_at(fx, event.index, event.value, event.offset);
 
     // prepare triggers
     *fx->var.trigger = (EEL_F)fx->triggers;
     fx->triggers = 0;
 
     if (!fx->code.compiled) {
+        ysfx_apply_slider_events(fx, ~(uint32_t)0);
+        fx->split.trigger_events.clear();
+
         // Forward audio if it exists
         for (uint32_t ch = 0; ch < std::min(num_ins, num_outs); ++ch)
-            memcpy(outs[ch], ins[ch], num_frames * sizeof(Real));
+            ysfx::copy_samples(ins[ch], outs[ch], stride, num_frames);
         
         // Otherwise silence, since not all DAWs initialize their outs
         for (uint32_t ch = std::min(num_ins, num_outs); ch < num_outs; ++ch)
-            memset(outs[ch], 0, num_frames * sizeof(Real));
+            ysfx::clear_samples(outs[ch], stride, num_frames);
     } else {
         // compute @init if needed
         if (fx->must_compute_init)
             ysfx_init(fx);
 
         double denorm_value = 0.0000000000000001;
-        if ((fx->var.ext_nodenorm) && (*(fx->var.ext_nodenorm) > 0.5)) {
+        if (flush_denormals || ((fx->var.ext_nodenorm) && (*(fx->var.ext_nodenorm) > 0.5))) {
             denorm_value = 0.0;
         }
 
@@ -1482,127 +3856,230 @@ void ysfx_process_generic(ysfx_t *fx, const Real *const *ins, Real *const *outs,
 
         fx->valid_input_channels = num_ins;
 
-        *fx->var.samplesblock = (EEL_F)num_frames;
+        // measure the inputs before the code overwrites them, when processing in place
+        const bool metering = fx->meters.enabled.load(std::memory_order_acquire);
+        if (metering)
+            ysfx_measure_channels<Real>(fx->meters.ins.get(), fx->meters.num_ins, ins, stride, num_ins, num_frames);
+
         *fx->var.num_ch = (EEL_F)num_ins;
 
-        // compute @slider if needed
-        if (fx->must_compute_slider) {
-            // TODO: slider must never run concurrently with @sample or @block
-            NSEEL_code_execute(fx->code.slider.get());
-            fx->must_compute_slider = false;
-        }
-
-        // compute @block
-        NSEEL_code_execute(fx->code.block.get());
-
-        // compute @sample, once per frame
-        if (fx->code.sample) {
-            EEL_F **spl = fx->var.spl;
-            for (uint32_t i = 0; i < num_frames; ++i) {
-                for (uint32_t ch = 0; ch < num_ins; ++ch)
-                    *spl[ch] = (EEL_F)ins[ch][i] + denorm_value;
-                for (uint32_t ch = num_ins; ch < num_code_ins; ++ch)
-                    *spl[ch] = denorm_value;
-                NSEEL_code_execute(fx->code.sample.get());
-                for (uint32_t ch = 0; ch < num_outs; ++ch)
-                    outs[ch][i] = (Real)*spl[ch];
-            }
+        // skip processing while asleep, as long as nothing comes to wake us
+        const bool quiet =
+            fx->silence.num_blocks > 0 && !fx->must_compute_slider &&
+            *fx->var.trigger == 0 && fx->split.trigger_events.empty() && fx->midi.in->data.empty() &&
+            fx->split.slider_events.empty() && fx->slider.ramping.empty() &&
+            ysfx_is_silent(ins, stride, num_ins, num_frames, fx->silence.threshold);
+
+        if (quiet && fx->silence.sleeping.load(std::memory_order_relaxed)) {
+            for (uint32_t ch = 0; ch < num_outs; ++ch)
+                ysfx::clear_samples(outs[ch], stride, num_frames);
+        }
+        else {
+            ysfx_process_code<Real>(fx, ins, outs, stride, num_ins, num_code_ins, num_outs, num_frames, denorm_value);
+
+            // fall asleep after enough blocks of silence in and out
+            bool sleeping = false;
+            if (quiet && fx->midi.out->data.empty() && ysfx_is_silent(outs, stride, num_outs, num_frames, fx->silence.threshold))
+                sleeping = ++fx->silence.silent_blocks >= fx->silence.num_blocks;
+            else
+                fx->silence.silent_blocks = 0;
+            fx->silence.sleeping.store(sleeping, std::memory_order_relaxed);
         }
 
         // either forward or clear any output above the maximum count
         for (uint32_t ch = num_outs; ch < std::min(orig_num_ins, orig_num_outs); ++ch)
-            memcpy(outs[ch], ins[ch], num_frames * sizeof(Real));
+            ysfx::copy_samples(ins[ch], outs[ch], stride, num_frames);
 
         for (uint32_t ch = std::max(num_outs, std::min(orig_num_ins, orig_num_outs)); ch < orig_num_outs; ++ch)
-            memset(outs[ch], 0, num_frames * sizeof(Real));
+            ysfx::clear_samples(outs[ch], stride, num_frames);
+
+        if (fx->pdc.enabled)
+            ysfx_compensate_pdc<Real>(fx, outs, stride, orig_num_outs, num_frames);
+
+        if (metering)
+            ysfx_measure_channels<Real>(fx->meters.outs.get(), fx->meters.num_outs, outs, stride, num_outs, num_frames);
+
+        // feed the analyzers which the code has created
+        const uint32_t num_analyzers = fx->analyzer.count.load(std::memory_order_acquire);
+        for (uint32_t i = 0; i < num_analyzers; ++i) {
+            ysfx_analyzer_t *analyzer = fx->analyzer.list[i].get();
+            if (analyzer->channel() < orig_num_outs)
+                analyzer->write(outs[analyzer->channel()], stride, num_frames);
+        }
+
+        if (fx->vmem_snapshot.count > 0)
+            ysfx_take_vmem_snapshot(fx);
+        if (fx->slider_snapshot.enabled.load(std::memory_order_relaxed))
+            ysfx_take_slider_snapshot(fx);
+        if (fx->watch.active || fx->watch.pending.load(std::memory_order_relaxed))
+            ysfx_watch_publish(fx, fx->watch);
     }
 
-    // prepare MIDI input for writing, output for reading
-    assert(fx->midi.out->read_pos == 0);
-    ysfx_midi_clear(fx->midi.in.get());
+    // prepare MIDI input for writing, output for reading
+    assert(fx->midi.out->read_pos == 0);
+    if (fx->midi.dedup_output)
+        ysfx_midi_deduplicate(fx->midi.out.get(), fx->midi.dedup_interval);
+    if (fx->midi.sort_output)
+        ysfx_midi_sort(fx->midi.out.get());
+    ysfx_midi_clear(fx->midi.in.get());
+
+    const uint64_t cycle_end = ysfx::monotonic_ns();
+    if (!offline)
+        ysfx_record_deadline(fx, cycle_end - cycle_begin, num_frames);
+
+    if (tracing) {
+        ysfx_trace_span("process", "dsp", cycle_begin, cycle_end);
+        ysfx_trace_count("midi out bytes", (int64_t)fx->midi.out->data.size());
+    }
+
+    ysfx_set_thread_id(ysfx_thread_id_none);
+}
+
+void ysfx_process_float(ysfx_t *fx, const float *const *ins, float *const *outs, uint32_t num_ins, uint32_t num_outs, uint32_t num_frames)
+{
+    ysfx_process_generic<float>(fx, ins, outs, 1, num_ins, num_outs, num_frames);
+}
+
+void ysfx_process_double(ysfx_t *fx, const double *const *ins, double *const *outs, uint32_t num_ins, uint32_t num_outs, uint32_t num_frames)
+{
+    ysfx_process_generic<double>(fx, ins, outs, 1, num_ins, num_outs, num_frames);
+}
+
+static ysfx_channel_list_t<float> &ysfx_interleaved_channels(ysfx_t *fx, float *)
+{
+    return fx->interleaved.f32;
+}
+
+static ysfx_channel_list_t<double> &ysfx_interleaved_channels(ysfx_t *fx, double *)
+{
+    return fx->interleaved.f64;
+}
+
+template <class Real>
+static void ysfx_process_interleaved(ysfx_t *fx, const Real *in, Real *out, uint32_t num_channels, uint32_t num_frames)
+{
+    const uint32_t stride = num_channels;
+    ysfx_channel_list_t<Real> &list = ysfx_interleaved_channels(fx, (Real *)nullptr);
+
+    // channels above the pins are forwarded
+    const uint32_t num_pin_channels = (uint32_t)list.ins.size();
+    if (num_channels > num_pin_channels) {
+        for (uint32_t ch = num_pin_channels; ch < num_channels; ++ch)
+            ysfx::copy_samples(&in[ch], &out[ch], stride, num_frames);
+        num_channels = num_pin_channels;
+    }
+
+    for (uint32_t ch = 0; ch < num_channels; ++ch) {
+        list.ins[ch] = &in[ch];
+        list.outs[ch] = &out[ch];
+    }
+
+    ysfx_process_generic<Real>(fx, list.ins.data(), list.outs.data(), stride, num_channels, num_channels, num_frames);
+}
+
+void ysfx_process_interleaved_float(ysfx_t *fx, const float *in, float *out, uint32_t num_channels, uint32_t num_frames)
+{
+    ysfx_process_interleaved<float>(fx, in, out, num_channels, num_frames);
+}
 
-    ysfx_set_thread_id(ysfx_thread_id_none);
+void ysfx_process_interleaved_double(ysfx_t *fx, const double *in, double *out, uint32_t num_channels, uint32_t num_frames)
+{
+    ysfx_process_interleaved<double>(fx, in, out, num_channels, num_frames);
 }
 
-void ysfx_process_float(ysfx_t *fx, const float *const *ins, float *const *outs, uint32_t num_ins, uint32_t num_outs, uint32_t num_frames)
+void ysfx_process_interleaved_float_in_place(ysfx_t *fx, float *buffer, uint32_t num_channels, uint32_t num_frames)
 {
-    ysfx_process_generic<float>(fx, ins, outs, num_ins, num_outs, num_frames);
+    ysfx_process_interleaved<float>(fx, buffer, buffer, num_channels, num_frames);
 }
 
-void ysfx_process_double(ysfx_t *fx, const double *const *ins, double *const *outs, uint32_t num_ins, uint32_t num_outs, uint32_t num_frames)
+void ysfx_process_interleaved_double_in_place(ysfx_t *fx, double *buffer, uint32_t num_channels, uint32_t num_frames)
 {
-    ysfx_process_generic<double>(fx, ins, outs, num_ins, num_outs, num_frames);
+    ysfx_process_interleaved<double>(fx, buffer, buffer, num_channels, num_frames);
 }
 
 void ysfx_clear_files(ysfx_t *fx)
 {
-    std::lock_guard<ysfx::mutex> list_lock(fx->file.list_mutex);
-
     // delete all except the serializer
-    while (fx->file.list.size() > 1) {
-        ysfx_file_t *file = fx->file.list.back().get();
-        std::unique_ptr<ysfx::mutex> file_mutex;
-        std::unique_lock<ysfx::mutex> file_lock;
-        if (file) {
-            file_lock = std::unique_lock<ysfx::mutex>{*fx->file.list.back()->m_mutex};
-            file_mutex = std::move(fx->file.list.back()->m_mutex);
-        }
-        fx->file.list.pop_back();
+    for (uint32_t i = 1; i < ysfx_max_file_handles; ++i) {
+        ysfx_file_slot_t &slot = fx->file.slots[i];
+        ysfx_close_file(fx, i + ysfx_max_file_handles * slot.generation.load());
     }
+
+    // the slots start over from the lowest, the generations go on
+    ysfx_reset_free_file_slots(fx);
 }
 
-ysfx_file_t *ysfx_get_file(ysfx_t *fx, uint32_t handle, std::unique_lock<ysfx::mutex> &lock, std::unique_lock<ysfx::mutex> *list_lock)
+ysfx_file_t *ysfx_get_file(ysfx_t *fx, uint32_t handle, std::unique_lock<ysfx::mutex> &lock)
 {
-    std::unique_lock<ysfx::mutex> local_list_lock;
-    if (list_lock)
-        *list_lock = std::unique_lock<ysfx::mutex>(fx->file.list_mutex);
-    else
-        local_list_lock = std::unique_lock<ysfx::mutex>(fx->file.list_mutex);
-    if (handle >= fx->file.list.size())
+    uint32_t index = handle % ysfx_max_file_handles;
+    uint32_t generation = handle / ysfx_max_file_handles;
+    ysfx_file_slot_t &slot = fx->file.slots[index];
+
+    // NOTE: only the threads which use the same file wait for each other
+    if (slot.generation.load() != generation)
         return nullptr;
-    ysfx_file_t *file = fx->file.list[handle].get();
-    if (!file)
+    lock = std::unique_lock<ysfx::mutex>{slot.mutex};
+    if (slot.generation.load() != generation || !slot.file) {
+        lock = {};
         return nullptr;
-    lock = std::unique_lock<ysfx::mutex>{*file->m_mutex};
-    return file;
+    }
+    return slot.file.get();
 }
 
 int32_t ysfx_insert_file(ysfx_t *fx, ysfx_file_t *file)
 {
-    std::lock_guard<ysfx::mutex> lock(fx->file.list_mutex);
-
-    //
-    size_t noneidx = ~(size_t)0;
-    size_t freeidx = noneidx;
+    int32_t index = ysfx_pop_free_file_slot(fx);
+    if (index == -1)
+        return -1;
 
-    for (size_t i = 0, n = fx->file.list.size(); i < n && freeidx == noneidx; ++i) {
-        if (!fx->file.list[i])
-            freeidx = i;
-    }
-    if (freeidx != noneidx) {
-        fx->file.list[freeidx].reset(file);
-        return (uint32_t)freeidx;
-    }
+    ysfx_file_slot_t &slot = fx->file.slots[index];
+    std::lock_guard<ysfx::mutex> lock(slot.mutex);
+    slot.file.reset(file);
+    return index + ysfx_max_file_handles * (int32_t)slot.generation.load();
+}
 
-    enum { max_file_handles = 64 };
+bool ysfx_close_file(ysfx_t *fx, uint32_t handle)
+{
+    uint32_t index = handle % ysfx_max_file_handles;
+    if (index == 0) //NOTE: cannot close the serializer handle (0)
+        return false;
 
-    size_t pos = fx->file.list.size();
-    if (pos >= max_file_handles)
-        return -1;
+    ysfx_file_u file;
+    {
+        std::unique_lock<ysfx::mutex> lock;
+        if (!ysfx_get_file(fx, handle, lock))
+            return false;
+        ysfx_file_slot_t &slot = fx->file.slots[index];
+        file = std::move(slot.file);
+        slot.generation.store((slot.generation.load() + 1) % ysfx_file_generation_count);
+    }
 
-    fx->file.list.emplace_back(file);
-    return (uint32_t)pos;
+    ysfx_push_free_file_slot(fx, index);
+    return true;
 }
 
 bool ysfx_load_state(ysfx_t *fx, ysfx_state_t *state)
 {
+    ysfx_wait_background_init(fx);
     if (!fx->code.compiled)
         return false;
 
+    ysfx_load_slider_state(fx, state);
+
+    fx->memory.high_water = std::max(fx->memory.high_water, state->mem_high_water);
+
     // restore the serialization
-    std::string buffer((char *)state->data, state->data_size);
+    ysfx_load_serialized_state_from(fx, state->data, state->data_size);
+
+    ysfx_prefault_memory(fx, fx->memory.auto_prefault);
+    return true;
+}
+
+bool ysfx_load_slider_state(ysfx_t *fx, ysfx_state_t *state)
+{
+    if (!fx->code.compiled)
+        return false;
 
-    // restore the sliders
     for (uint32_t i = 0; i < ysfx_max_sliders; ++i)
         *fx->var.slider[i] = fx->source.main->header.sliders[i].def;
 
@@ -1612,13 +4089,25 @@ bool ysfx_load_state(ysfx_t *fx, ysfx_state_t *state)
             *fx->var.slider[j] = state->sliders[i].value;
     }
     fx->must_compute_slider = true;
+    return true;
+}
+
+bool ysfx_load_serialized_state(ysfx_t *fx, ysfx_state_t *state)
+{
+    return ysfx_load_serialized_state_from(fx, state->data, state->data_size);
+}
+
+bool ysfx_load_serialized_state_from(ysfx_t *fx, const uint8_t *data, size_t size)
+{
+    if (!fx->code.compiled)
+        return false;
 
     // invoke @serialize
     {
         std::unique_lock<ysfx::mutex> lock;
         ysfx_serializer_t *serializer = static_cast<ysfx_serializer_t *>(ysfx_get_file(fx, 0, lock));
         assert(serializer);
-        serializer->begin(false, buffer);
+        serializer->begin_read(data, size, fx->file.serialize_f64);
         lock.unlock();
         ysfx_serialize(fx);
         lock.lock();
@@ -1628,68 +4117,89 @@ bool ysfx_load_state(ysfx_t *fx, ysfx_state_t *state)
     return true;
 }
 
-bool ysfx_load_serialized_state(ysfx_t *fx, ysfx_state_t *state)
+void ysfx_set_lossless_serialization(ysfx_t *fx, bool enable)
 {
-    if (!fx->code.compiled) return false;
+    fx->file.serialize_f64 = enable;
+}
 
-    // restore the serialization
-    std::string buffer((char *)state->data, state->data_size);
+bool ysfx_get_lossless_serialization(ysfx_t *fx)
+{
+    return fx->file.serialize_f64;
+}
+
+bool ysfx_save_serialized_state_to(ysfx_t *fx, ysfx_serial_buffer_t *buffer)
+{
+    if (!fx->code.compiled)
+        return false;
+
+    size_t start = buffer->size;
+    bool complete;
 
     // invoke @serialize
     {
         std::unique_lock<ysfx::mutex> lock;
         ysfx_serializer_t *serializer = static_cast<ysfx_serializer_t *>(ysfx_get_file(fx, 0, lock));
         assert(serializer);
-        serializer->begin(false, buffer);
+        serializer->begin_write(*buffer, fx->file.serialize_f64);
         lock.unlock();
         ysfx_serialize(fx);
         lock.lock();
+        complete = !serializer->m_overflow;
         serializer->end();
     }
 
+    // after a failure to grow, the data is incomplete; remove it
+    if (!complete)
+        buffer->size = start;
+    return complete;
+}
+
+// a buffer which the state takes, with no copy
+static bool ysfx_grow_state_buffer(ysfx_serial_buffer_t *buffer, size_t capacity)
+{
+    uint8_t *data = new (std::nothrow) uint8_t[capacity];
+    if (!data)
+        return false;
+    memcpy(data, buffer->data, buffer->size);
+    delete[] buffer->data;
+    buffer->data = data;
+    buffer->capacity = capacity;
     return true;
 }
 
 ysfx_state_t *ysfx_save_state(ysfx_t *fx)
 {
+    ysfx_wait_background_init(fx);
     if (!fx->code.compiled)
         return nullptr;
 
-    std::string buffer;
+    ysfx_serial_buffer_t buffer{};
+    buffer.grow = &ysfx_grow_state_buffer;
+    auto buffer_cleanup = ysfx::defer([&buffer]() { delete[] buffer.data; });
 
-    // invoke @serialize
-    {
-        std::unique_lock<ysfx::mutex> lock;
-        ysfx_serializer_t *serializer = static_cast<ysfx_serializer_t *>(ysfx_get_file(fx, 0, lock));
-        assert(serializer);
-        serializer->begin(true, buffer);
-        lock.unlock();
-        ysfx_serialize(fx);
-        lock.lock();
-        serializer->end();
-    }
+    ysfx_save_serialized_state_to(fx, &buffer);
 
     // save the sliders
     ysfx_state_u state{new ysfx_state_t};
-    uint32_t slider_count = 0;
-    for (uint32_t i = 0; i < ysfx_max_sliders; ++i)
-        slider_count += fx->source.main->header.sliders[i].exists;
+    const std::vector<uint32_t> &slider_indices = fx->source.main->header.slider_indices;
+    uint32_t slider_count = (uint32_t)slider_indices.size();
 
     state->sliders = new ysfx_state_slider_t[slider_count]{};
     state->slider_count = slider_count;
 
-    for (uint32_t i = 0, j = 0; i < ysfx_max_sliders; ++i) {
-        if (fx->source.main->header.sliders[i].exists) {
-            state->sliders[j].index = i;
-            state->sliders[j].value = *fx->var.slider[i];
-            ++j;
-        }
+    for (uint32_t j = 0; j < slider_count; ++j) {
+        uint32_t i = slider_indices[j];
+        state->sliders[j].index = i;
+        state->sliders[j].value = *fx->var.slider[i];
     }
 
     // save the serialization
-    state->data_size = buffer.size();
-    state->data = new uint8_t[state->data_size];
-    memcpy(state->data, buffer.data(), state->data_size);
+    state->data_size = buffer.size;
+    state->data = buffer.data ? buffer.data : new uint8_t[0];
+    buffer.data = nullptr;
+
+    state->mem_high_water = ysfx_get_memory_high_water(fx);
+    state->hash = 0;
 
     //
     return state.release();
@@ -1721,6 +4231,10 @@ ysfx_state_t *ysfx_state_dup(ysfx_state_t *state_in)
     state_out->data = new uint8_t[data_size];
     memcpy(state_out->data, state_in->data, data_size);
 
+    state_out->mem_high_water = state_in->mem_high_water;
+    // the copy is often modified after, so its hash is computed again
+    state_out->hash = 0;
+
     return state_out.release();
 }
 
@@ -1729,6 +4243,7 @@ bool ysfx_is_state_equal(ysfx_state_t *state1, ysfx_state_t *state2)
     if (!state1 || !state2)
         return false;
     
+    if (state1->hash && state2->hash && state1->hash != state2->hash) return false;
     if (state1->slider_count != state2->slider_count) return false;
     if (state1->data_size != state2->data_size) return false;
     if (memcmp(state1->data, state2->data, state1->data_size) != 0) return false;
@@ -1737,19 +4252,53 @@ bool ysfx_is_state_equal(ysfx_state_t *state1, ysfx_state_t *state2)
     return true;
 }
 
+uint64_t ysfx_state_hash(ysfx_state_t *state)
+{
+    if (!state)
+        return 0;
+    if (state->hash)
+        return state->hash;
+
+    uint64_t hash = ysfx::hash_bytes(state->data, state->data_size);
+    for (uint32_t i = 0; i < state->slider_count; ++i) {
+        uint8_t bytes[4 + 8];
+        ysfx::pack_u32le(state->sliders[i].index, bytes);
+        ysfx::pack_f64le(state->sliders[i].value, bytes + 4);
+        hash = ysfx::hash_combine(hash, ysfx::hash_bytes(bytes, sizeof(bytes)));
+    }
+
+    // 0 means that the hash is not known
+    state->hash = hash ? hash : 1;
+    return state->hash;
+}
+
 void ysfx_serialize(ysfx_t *fx)
 {
+    ysfx_compile_lazy_section(fx, fx->code.lazy_serialize, ysfx_section_serialize, "@serialize", fx->code.serialize);
+
     if (fx->code.serialize) {
         if (fx->must_compute_init)
             ysfx_init(fx);
+        uint64_t profile_begin = ysfx_profile_begin(fx);
         NSEEL_code_execute(fx->code.serialize.get());
+        ysfx_profile_end(fx, ysfx_section_serialize, profile_begin);
     }
 }
 
 uint32_t ysfx_get_slider_of_var(ysfx_t *fx, EEL_F *var)
 {
-    auto it = fx->slider_of_var.find(var);
-    if (it == fx->slider_of_var.end())
+    // the sliders are normally contiguous, unless the VM has started a new block of storage
+    EEL_F *first = fx->var.slider[0];
+    if (var >= first && var < first + ysfx_max_sliders) {
+        uint32_t index = (uint32_t)(var - first);
+        if (fx->var.slider[index] == var)
+            return index;
+    }
+
+    auto it = std::lower_bound(
+        fx->slider_of_var.begin(), fx->slider_of_var.end(), var,
+        [](const std::pair<ysfx_real *, uint32_t> &item, ysfx_real *var) { return item.first < var; });
+    if (it == fx->slider_of_var.end() || it->first != var)
         return ~(uint32_t)0;
     return it->second;
 }
@@ -1790,9 +4339,18 @@ ysfx_real ysfx_read_var(ysfx_t *fx, const char *name)
 
 void ysfx_read_vmem(ysfx_t *fx, uint32_t addr, ysfx_real *dest, uint32_t count)
 {
-    ysfx_eel_ram_reader reader(fx->vm.get(), addr);
-    for (uint32_t i = 0; i < count; ++i)
-        dest[i] = reader.read_next();
+    ysfx_vmem_span_t span;
+    while (count > 0 && ysfx_get_vmem_spans(fx, addr, count, &span, 1) > 0) {
+        if (span.data)
+            memcpy(dest, span.data, span.count * sizeof(ysfx_real));
+        else
+            memset(dest, 0, span.count * sizeof(ysfx_real));
+        dest += span.count;
+        addr += span.count;
+        count -= span.count;
+    }
+    // past the end of the address space
+    memset(dest, 0, count * sizeof(ysfx_real));
 }
 
 ysfx_real ysfx_read_vmem_single(ysfx_t *fx, uint32_t addr)
@@ -1802,36 +4360,263 @@ ysfx_real ysfx_read_vmem_single(ysfx_t *fx, uint32_t addr)
     return flt_addr ? *flt_addr : 0;
 }
 
+uint32_t ysfx_get_vmem_spans(ysfx_t *fx, uint32_t addr, uint32_t count, ysfx_vmem_span_t *spans, uint32_t max_spans)
+{
+    NSEEL_VMCTX vm = fx->vm.get();
+
+    if (count > UINT32_MAX - addr)
+        count = UINT32_MAX - addr;
+
+    uint32_t num_spans = 0;
+    while (count > 0) {
+        uint32_t len = NSEEL_RAM_ITEMSPERBLOCK - (addr & (NSEEL_RAM_ITEMSPERBLOCK - 1));
+        if (len > count)
+            len = count;
+        if (num_spans < max_spans) {
+            int32_t valid = 0;
+            const EEL_F *data = NSEEL_VM_getramptr_noalloc(vm, addr, &valid);
+            spans[num_spans].data = (valid > 0) ? data : nullptr;
+            spans[num_spans].addr = addr;
+            spans[num_spans].count = len;
+        }
+        ++num_spans;
+        addr += len;
+        count -= len;
+    }
+
+    return num_spans;
+}
+
+void ysfx_set_vmem_snapshot(ysfx_t *fx, uint32_t addr, uint32_t count)
+{
+    auto &snap = fx->vmem_snapshot;
+    snap.addr = addr;
+    snap.count = count;
+    for (uint32_t i = 0; i < 3; ++i)
+        snap.buffer[i].assign(count, 0);
+    snap.buffer.reset();
+}
+
+const ysfx_real *ysfx_get_vmem_snapshot(ysfx_t *fx, uint32_t *count)
+{
+    auto &snap = fx->vmem_snapshot;
+    snap.buffer.update();
+    if (count)
+        *count = snap.count;
+    return snap.buffer.front().data();
+}
+
+static void ysfx_take_vmem_snapshot(ysfx_t *fx)
+{
+    auto &snap = fx->vmem_snapshot;
+    ysfx_read_vmem(fx, snap.addr, snap.buffer.back().data(), snap.count);
+    snap.buffer.publish();
+}
+
+uint32_t ysfx_get_max_sliders(void)
+{
+    return ysfx_max_sliders;
+}
+
+const ysfx_slider_snapshot_t *ysfx_get_slider_snapshot(ysfx_t *fx)
+{
+    auto &snap = fx->slider_snapshot;
+    snap.enabled.store(true, std::memory_order_relaxed);
+    snap.buffer.update();
+    snap.view.generation = snap.buffer.front().generation;
+    snap.view.count = ysfx_max_sliders;
+    snap.view.values = snap.buffer.front().values;
+    return &snap.view;
+}
+
+static void ysfx_take_slider_snapshot(ysfx_t *fx)
+{
+    auto &snap = fx->slider_snapshot;
+
+    bool changed = false;
+    for (uint32_t i = 0; i < ysfx_max_sliders; ++i) {
+        ysfx_real value = *fx->var.slider[i];
+        // compared as bits, so that NaN does not count as a change each time
+        if (memcmp(&value, &snap.current.values[i], sizeof(value)) != 0) {
+            snap.current.values[i] = value;
+            changed = true;
+        }
+    }
+    if (!changed && snap.current.generation != 0)
+        return;
+
+    ++snap.current.generation;
+    snap.buffer.back() = snap.current;
+    snap.buffer.publish();
+}
+
+// walk the block table of the VM, which only covers the EEL2 address space
+static uint32_t ysfx_count_ram_blocks(ysfx_t *fx, uint32_t *high_water)
+{
+    NSEEL_VMCTX vm = fx->vm.get();
+    uint32_t count = 0;
+    uint32_t top = 0;
+
+    for (uint32_t block = 0; block < NSEEL_RAM_BLOCKS; ++block) {
+        int32_t valid = 0;
+        if (NSEEL_VM_getramptr_noalloc(vm, block * NSEEL_RAM_ITEMSPERBLOCK, &valid) && valid > 0) {
+            ++count;
+            top = block + 1;
+        }
+    }
+
+    if (high_water)
+        *high_water = top * NSEEL_RAM_ITEMSPERBLOCK;
+    return count;
+}
+
 int ysfx_calculate_used_mem(ysfx_t *fx)
 {
-    int validCount{0};
-    uint32_t addr{0};
-    int usedMemory{0};
+    return (int)(ysfx_count_ram_blocks(fx, nullptr) * NSEEL_RAM_ITEMSPERBLOCK);
+}
+
+void ysfx_get_memory_stats(ysfx_t *fx, ysfx_memory_stats_t *stats)
+{
+    *stats = {};
 
-    for (uint32_t i = 0; i < UINT32_MAX / NSEEL_RAM_ITEMSPERBLOCK; i++) {
-        NSEEL_VM_getramptr_noalloc(fx->vm.get(), addr, &validCount);
-        addr += NSEEL_RAM_ITEMSPERBLOCK;
-        usedMemory += validCount;
+    stats->ram_blocks = ysfx_count_ram_blocks(fx, nullptr);
+    stats->ram_bytes = (uint64_t)stats->ram_blocks * NSEEL_RAM_ITEMSPERBLOCK * sizeof(EEL_F);
+    stats->ram_high_water = ysfx_get_memory_high_water(fx);
+    stats->ram_limit = (uint32_t)NSEEL_VM_setramsize(fx->vm.get(), 0);
+
+    {
+        std::lock_guard<ysfx::mutex> lock{fx->string_mutex};
+        ysfx_eel_string_context_measure(fx->string_ctx.get(), &stats->num_strings, &stats->string_bytes);
     }
-    
-    return usedMemory;
+
+#if !defined(YSFX_NO_GFX)
+    {
+        std::lock_guard<ysfx::mutex> lock{fx->gfx.mutex};
+        if (ysfx_gfx_state_t *state = fx->gfx.state.get())
+            stats->image_bytes = ysfx_gfx_state_measure_images(state, &stats->num_images);
+    }
+#endif
+}
+
+void ysfx_prefault_memory(ysfx_t *fx, ysfx_prefault_policy_t policy)
+{
+    if (!fx->code.compiled)
+        return;
+
+    NSEEL_VMCTX vm = fx->vm.get();
+
+    uint32_t limit = 0;
+    switch (policy) {
+    case ysfx_prefault_high_water:
+        limit = ysfx_get_memory_high_water(fx);
+        break;
+    case ysfx_prefault_maxmem:
+        limit = (uint32_t)NSEEL_VM_setramsize(vm, 0);
+        break;
+    default:
+        break;
+    }
+
+    for (uint32_t addr = 0; addr < limit; addr += NSEEL_RAM_ITEMSPERBLOCK) {
+        int32_t valid = 0;
+        if (NSEEL_VM_getramptr_noalloc(vm, addr, &valid) && valid > 0)
+            continue;
+        EEL_F *block = NSEEL_VM_getramptr(vm, addr, &valid);
+        if (!block || valid <= 0)
+            break;
+        // the pages of a new block are mapped at the first write, do it now
+        memset(block, 0, (uint32_t)valid * sizeof(EEL_F));
+    }
+}
+
+void ysfx_set_auto_prefault(ysfx_t *fx, ysfx_prefault_policy_t policy)
+{
+    fx->memory.auto_prefault = policy;
+}
+
+// allocate a buffer again from the calling thread, and write all of its capacity
+template <class T>
+static void ysfx_relocate_vector(std::vector<T> &vec)
+{
+    std::vector<T> fresh;
+    fresh.reserve(vec.capacity());
+    fresh.resize(vec.capacity());
+    std::copy(vec.begin(), vec.end(), fresh.begin());
+    fresh.resize(vec.size());
+    vec.swap(fresh);
+}
+
+void ysfx_relocate_memory(ysfx_t *fx)
+{
+    // the blocks come from calloc in EEL2, which releases them with free; the generated code
+    //   allocates them on first use, knowing only the block table and not the instance, so
+    //   the placement by the thread which touches them first stands in for an allocator hook
+    EEL_F **blocks = ((compileContext *)fx->vm.get())->ram_state->blocks;
+    for (uint32_t block = 0; block < NSEEL_RAM_BLOCKS; ++block) {
+        if (!blocks[block])
+            continue;
+        EEL_F *fresh = (EEL_F *)malloc(NSEEL_RAM_ITEMSPERBLOCK * sizeof(EEL_F));
+        if (!fresh)
+            continue;
+        memcpy(fresh, blocks[block], NSEEL_RAM_ITEMSPERBLOCK * sizeof(EEL_F));
+        free(blocks[block]);
+        blocks[block] = fresh;
+    }
+
+    for (ysfx_midi_buffer_t *midi : {fx->midi.in.get(), fx->midi.out.get(), fx->split.midi_in.get(), fx->split.midi_out.get(), fx->midi.event.get()}) {
+        ysfx_relocate_vector(midi->data);
+        ysfx_relocate_vector(midi->index);
+        ysfx_relocate_vector(midi->pool);
+        ysfx_relocate_vector(midi->scratch);
+        ysfx_relocate_vector(midi->dedup);
+        ysfx_relocate_vector(midi->translated);
+    }
+    ysfx_relocate_vector(fx->scratch.in);
+    ysfx_relocate_vector(fx->scratch.out);
+    ysfx_relocate_vector(fx->oversampling.in_buf);
+    ysfx_relocate_vector(fx->oversampling.out_buf);
+    ysfx_relocate_vector(fx->split.slider_events);
+    ysfx_relocate_vector(fx->split.trigger_events);
+    ysfx_relocate_vector(fx->split.points);
+
+    {
+        ysfx_string_scoped_lock lock{fx};
+        fx->string_pool.spare.clear();
+    }
+    ysfx_string_pool_refill(fx);
+}
+
+uint32_t ysfx_get_memory_high_water(ysfx_t *fx)
+{
+    uint32_t high_water = 0;
+    ysfx_count_ram_blocks(fx, &high_water);
+    fx->memory.high_water = std::max(fx->memory.high_water, high_water);
+    return fx->memory.high_water;
+}
+
+bool ysfx_find_data_file(ysfx_t *fx, EEL_F *file, std::string &result, ysfx_file_type_t *type, void **fmtobj)
+{
+    ysfx_data_file_name_t name;
+    if (!ysfx_get_data_file_name(fx, file, name))
+        return false;
+    return ysfx_resolve_data_file(fx, name, result, type, fmtobj);
 }
 
-bool ysfx_find_data_file(ysfx_t *fx, EEL_F *file, std::string &result)
+bool ysfx_get_data_file_name(ysfx_t *fx, EEL_F *file, ysfx_data_file_name_t &name)
 {
     // 3 possibilities for file
     // - slider
     // - index of filename
     // - string
 
-    std::string filepart;
+    std::string &filepart = name.part;
 
-    bool accept_absolute = false;
-    bool accept_relative = false;
+    bool &accept_absolute = name.accept_absolute;
+    bool &accept_relative = name.accept_relative;
 
     int32_t index = ysfx_eel_round<int32_t>(*file);
     uint32_t slideridx = ysfx_get_slider_of_var(fx, file);
-    ysfx_slider_t *slider = nullptr;
+    const ysfx_slider_t *slider = nullptr;
 
     if (slideridx != ~(uint32_t)0)
         slider = &fx->source.main->header.sliders[slideridx];
@@ -1855,6 +4640,55 @@ bool ysfx_find_data_file(ysfx_t *fx, EEL_F *file, std::string &result)
     else
         return false;
 
+    return true;
+}
+
+// note the file in the manifest of @init, if it runs; the mutex of the resolution is held
+static void ysfx_record_init_file(ysfx_t *fx, const std::string &path)
+{
+    enum { max_manifest_files = 256 };
+
+    ysfx::string_list &manifest = fx->file.init_manifest;
+    if (!fx->file.recording_init || manifest.size() >= max_manifest_files)
+        return;
+    if (std::find(manifest.begin(), manifest.end(), path) == manifest.end())
+        manifest.push_back(path);
+}
+
+bool ysfx_resolve_data_file(ysfx_t *fx, const ysfx_data_file_name_t &name, std::string &result, ysfx_file_type_t *type, void **fmtobj)
+{
+    const std::string &filepart = name.part;
+    const bool accept_absolute = name.accept_absolute;
+    const bool accept_relative = name.accept_relative;
+
+    // reuse the earlier resolution, if neither the file nor the directories
+    //   before it have changed since
+    std::string key;
+    key.reserve(filepart.size() + 1);
+    key.push_back(accept_absolute ? 'a' : 'r');
+    key.append(filepart);
+
+    std::lock_guard<ysfx::mutex> lock(fx->file.resolved_mutex);
+
+    auto it = fx->file.resolved.find(key);
+    if (it != fx->file.resolved.end()) {
+        const ysfx_resolved_file_t &entry = it->second;
+        ysfx::file_stamp stamp;
+        bool valid = ysfx_package_get_file_stamp(entry.path, stamp) && stamp == entry.stamp;
+        for (size_t i = 0; valid && i < entry.skipped.size(); ++i)
+            valid = ysfx_package_get_file_stamp(entry.skipped[i].first, stamp) && stamp == entry.skipped[i].second;
+        if (valid) {
+            result.assign(entry.path);
+            if (type)
+                *type = entry.type;
+            if (fmtobj && entry.format != ~(size_t)0)
+                *fmtobj = &fx->config->audio_formats[entry.format];
+            ysfx_record_init_file(fx, entry.path);
+            return true;
+        }
+        fx->file.resolved.erase(it);
+    }
+
     std::vector<std::string> filecandidates;
     filecandidates.reserve(2);
 
@@ -1866,11 +4700,30 @@ bool ysfx_find_data_file(ysfx_t *fx, EEL_F *file, std::string &result)
             filecandidates.push_back(fx->config->data_root + filepart);
     }
 
+    ysfx_resolved_file_t entry;
+
     for (const std::string &filepath : filecandidates) {
-        if (ysfx::exists(filepath.c_str())) {
+        if (ysfx_package_get_file_stamp(filepath, entry.stamp)) {
+            void *fmt = nullptr;
+            entry.path = filepath;
+            entry.type = ysfx_detect_file_type(fx, filepath.c_str(), &fmt);
+            if (fmt)
+                entry.format = (size_t)((ysfx_audio_format_t *)fmt - fx->config->audio_formats.data());
             result.assign(filepath);
+            if (type)
+                *type = entry.type;
+            if (fmtobj)
+                *fmtobj = fmt;
+            ysfx_record_init_file(fx, filepath);
+            fx->file.resolved[key] = std::move(entry);
             return true;
         }
+
+        // a file which appears in this directory later would take precedence
+        std::string dirpath = ysfx::path_directory(filepath.c_str());
+        ysfx::file_stamp dirstamp{};
+        ysfx_package_get_file_stamp(dirpath, dirstamp);
+        entry.skipped.emplace_back(std::move(dirpath), dirstamp);
     }
 
     return false;
@@ -1898,6 +4751,8 @@ void ysfx_gfx_setup(ysfx_t *fx, ysfx_gfx_config_t *gc)
     bool doinit = false;
     ysfx_scoped_gfx_t scope{fx, doinit};
 
+    ysfx_compile_lazy_section(fx, fx->code.lazy_gfx, ysfx_section_gfx, "@gfx", fx->code.gfx);
+
     ysfx_gfx_state_set_bitmap(fx->gfx.state.get(), gc->pixels, gc->pixel_width, gc->pixel_height, gc->pixel_stride);
     ysfx_real scale = fx->gfx.wants_retina ? gc->scale_factor : 1;
     ysfx_gfx_state_set_scale_factor(fx->gfx.state.get(), scale);
@@ -1925,72 +4780,19 @@ bool ysfx_gfx_wants_retina(ysfx_t *fx)
 void ysfx_gfx_add_key(ysfx_t *fx, uint32_t mods, uint32_t key, bool press)
 {
 #if !defined(YSFX_NO_GFX)
-    bool doinit = true;
-    ysfx_scoped_gfx_t scope{fx, doinit};
-
-    if (!fx->gfx.ready)
-        return;
-
-    ysfx_gfx_state_add_key(fx->gfx.state.get(), mods, key, press);
+    ysfx_gfx_input_send_key(fx->gfx.input, mods, key, press);
 #else
     (void)fx;
     (void)mods;
     (void)key;
+    (void)press;
 #endif
 }
 
 void ysfx_gfx_update_mouse(ysfx_t *fx, uint32_t mods, int32_t xpos, int32_t ypos, uint32_t buttons, ysfx_real wheel, ysfx_real hwheel)
 {
 #if !defined(YSFX_NO_GFX)
-    bool doinit = true;
-    ysfx_scoped_gfx_t scope{fx, doinit};
-
-    if (!fx->gfx.ready)
-        return;
-
-    *fx->var.mouse_x = (EEL_F)xpos;
-    *fx->var.mouse_y = (EEL_F)ypos;
-    *fx->var.mouse_wheel += 512 * wheel;
-    *fx->var.mouse_hwheel += 512 * hwheel;
-
-    /*  
-        1: lmb
-        2: rmb
-        4: Control (Windows) or Command (macOS) key
-        8: Shift key
-        16: Alt (Windows) or Option (macOS) key
-        32: Windows (Windows) or Control (macOS) key
-        64: middle mouse button
-    */
-
-    uint32_t mouse_cap = 0;
-    if (buttons & ysfx_button_left)
-        mouse_cap |= 1;
-    if (buttons & ysfx_button_right)
-        mouse_cap |= 2;
-    if (buttons & ysfx_button_middle)
-        mouse_cap |= 64;
-    
-    if (mouse_cap) {  
-        if (mods & ysfx_mod_shift)
-            mouse_cap |= 8;
-        if (mods & ysfx_mod_alt)
-            mouse_cap |= 16;
-    
-#ifdef __APPLE__
-        if (mods & ysfx_mod_ctrl)
-            mouse_cap |= 32;
-        if (mods & ysfx_mod_super)
-            mouse_cap |= 4;
-#else
-        // Windows key is currently unavailable
-        if (mods & ysfx_mod_ctrl)
-            mouse_cap |= 4;
-#endif
-    }
-    
-    *fx->var.mouse_cap = (EEL_F)mouse_cap;
-
+    ysfx_gfx_input_send_mouse(fx->gfx.input, mods, xpos, ypos, buttons, wheel, hwheel);
 #else
     (void)fx;
     (void)mods;
@@ -2011,8 +4813,17 @@ bool ysfx_gfx_run(ysfx_t *fx)
     if (!fx->gfx.ready)
         return false;
 
+    ysfx_compile_lazy_section(fx, fx->code.lazy_gfx, ysfx_section_gfx, "@gfx", fx->code.gfx);
+
+    ysfx_trace_scope trace{"gfx", "gfx"};
+    if (ysfx_trace_enabled())
+        ysfx_trace_name_thread("gfx");
+
+    ysfx_gfx_input_receive(fx);
     ysfx_gfx_prepare(fx);
+    uint64_t profile_begin = ysfx_profile_begin(fx);
     NSEEL_code_execute(fx->code.gfx.get());
+    ysfx_profile_end(fx, ysfx_section_gfx, profile_begin);
 
     return ysfx_gfx_state_is_dirty(fx->gfx.state.get());
 #else
@@ -2020,3 +4831,82 @@ bool ysfx_gfx_run(ysfx_t *fx)
     return false;
 #endif
 }
+
+bool ysfx_gfx_get_dirty_rect(ysfx_t *fx, uint32_t rect[4])
+{
+#if !defined(YSFX_NO_GFX)
+    bool doinit = false;
+    ysfx_scoped_gfx_t scope{fx, doinit};
+
+    if (!fx->gfx.ready) {
+        rect[0] = rect[1] = rect[2] = rect[3] = 0;
+        return false;
+    }
+
+    return ysfx_gfx_state_get_dirty_rect(fx->gfx.state.get(), rect);
+#else
+    (void)fx;
+    rect[0] = rect[1] = rect[2] = rect[3] = 0;
+    return false;
+#endif
+}
+
+uint32_t ysfx_gfx_render_offscreen(ysfx_t *fx, uint32_t width, uint32_t height, uint32_t frames, uint8_t *pixels)
+{
+#if !defined(YSFX_NO_GFX)
+    if (width == 0 || height == 0 || !ysfx_has_section(fx, ysfx_section_gfx))
+        return 0;
+
+    memset(pixels, 0, 4 * (size_t)width * (size_t)height);
+
+    ysfx_gfx_config_t gc{};
+    gc.pixel_width = width;
+    gc.pixel_height = height;
+    gc.pixels = pixels;
+    gc.scale_factor = 1.0;
+    ysfx_gfx_setup(fx, &gc);
+
+    uint32_t count = 0;
+    for (; count < frames; ++count) {
+        ysfx_gfx_run(fx);
+        if (!fx->gfx.ready)
+            break;
+    }
+
+    // the buffer belongs to the caller, no later frame must draw there
+    gc.pixel_width = 0;
+    gc.pixel_height = 0;
+    gc.pixels = nullptr;
+    ysfx_gfx_setup(fx, &gc);
+
+    return count;
+#else
+    (void)fx;
+    (void)width;
+    (void)height;
+    (void)frames;
+    (void)pixels;
+    return 0;
+#endif
+}
+
+//------------------------------------------------------------------------------
+size_t ysfx_base64_encode(const void *data, size_t size, char *text)
+{
+    return ysfx::encode_base64((const uint8_t *)data, size, text);
+}
+
+size_t ysfx_base64_decode(const char *text, size_t length, void *data)
+{
+    return ysfx::decode_base64(text, length, (uint8_t *)data);
+}
+
+size_t ysfx_base64_encoded_size(size_t size)
+{
+    return ysfx::base64_encoded_size(size);
+}
+
+size_t ysfx_base64_decoded_capacity(size_t length)
+{
+    return ysfx::base64_decoded_capacity(length);
+}
@@ -22,23 +22,70 @@
 #include "ysfx_api_eel.hpp"
 #include "ysfx_api_reaper.hpp"
 #include "ysfx_api_file.hpp"
+#include "ysfx_api_analyzer.hpp"
+#include "ysfx_api_convolve.hpp"
+#include "ysfx_api_lookahead.hpp"
 #include "ysfx_api_gfx.hpp"
 #include "ysfx_utils.hpp"
+#include "ysfx_oversample.hpp"
+#include "ysfx_gmem.hpp"
+#include "ysfx_analyzer.hpp"
+#include "ysfx_convolver.hpp"
+#include "ysfx_lookahead.hpp"
+#include "ysfx_line_profile.hpp"
+#include "ysfx_specialize.hpp"
+#include "ysfx_eval_cache.hpp"
+#include "ysfx_match.hpp"
+#include "ysfx_curve_table.hpp"
+#include "ysfx_init_worker.hpp"
+#include "ysfx_watch.hpp"
 #include "utility/sync_bitset.hpp"
+#include "utility/bounded_queue.hpp"
+#include "utility/triple_buffer.hpp"
 #include "WDL/eel2/ns-eel.h"
 #include "WDL/eel2/ns-eel-int.h"
+#include "WDL/wdlstring.h"
 #include <unordered_map>
+#include <map>
 #include <atomic>
 
 YSFX_DEFINE_AUTO_PTR(NSEEL_VMCTX_u, void, NSEEL_VM_free); // NOTE: `NSEEL_VMCTX` is `void *`
 YSFX_DEFINE_AUTO_PTR(NSEEL_CODEHANDLE_u, void, NSEEL_code_free); // NOTE: `NSEEL_CODEHANDLE` is `void *`
 
 struct ysfx_source_unit_t {
-    ysfx_toplevel_t toplevel;
+    // the sections, shared with other instances of the same file
+    std::shared_ptr<const ysfx_toplevel_t> toplevel;
+    // the header, as adjusted by this instance
     ysfx_header_t header;
+    // the path of the file
+    std::string path;
 };
 using ysfx_source_unit_u = std::unique_ptr< ysfx_source_unit_t>;
 
+// the variables `spl0` to `spl63` exist in every effect, as in REAPER,
+//   the others are created for the pins which need them
+enum {
+    ysfx_fixed_channels = 64,
+};
+
+enum {
+    ysfx_max_analyzers = 16, // change if it needs more
+};
+
+// the levels of a channel accumulated over cycles, until a reader takes them
+struct ysfx_meter_channel_t {
+    std::atomic<ysfx_real> peak{0};
+    std::atomic<ysfx_real> sum_squares{0};
+    std::atomic<uint64_t> frames{0};
+};
+
+// the channels of an interleaved buffer, as the planar processing takes them
+template <class Real>
+struct ysfx_channel_list_t {
+    std::vector<const Real *> ins;
+    std::vector<Real *> outs;
+};
+
 enum ysfx_file_type_t {
     ysfx_file_type_none,
     ysfx_file_type_txt,
@@ -46,24 +93,98 @@ enum ysfx_file_type_t {
     ysfx_file_type_audio,
 };
 
+// a slot of the table of files; a handle is the index of its slot, tagged with
+//   the generation of the slot, so a handle stays invalid after it is closed
+enum {
+    ysfx_max_file_handles = 64, // change if it needs more
+    ysfx_file_generation_count = 1 << 20,
+};
+
+struct ysfx_file_slot_t {
+    // guards the file, and the use of it
+    ysfx::mutex mutex;
+    ysfx_file_u file;
+    std::atomic<uint32_t> generation{0};
+    std::atomic<uint32_t> next_free{0};
+};
+
+// a file found by name, with the stamps which confirm it is still the one
+struct ysfx_resolved_file_t {
+    std::string path;
+    ysfx::file_stamp stamp{};
+    // the directories of the candidates which did not have the file before
+    std::vector<std::pair<std::string, ysfx::file_stamp>> skipped;
+    ysfx_file_type_t type = ysfx_file_type_none;
+    // the index of the audio format, since the formats may grow after
+    size_t format = ~(size_t)0;
+};
+
+struct ysfx_slider_event_t {
+    uint32_t index;
+    uint32_t offset;
+    ysfx_real value;
+};
+
+struct ysfx_trigger_event_t {
+    uint32_t index;
+    uint32_t offset;
+};
+
+// the glide of a slider towards a value which was set at an offset
+struct ysfx_slider_ramp_t {
+    // the duration of the glide, or 0 to apply values at once
+    uint32_t frames = 0;
+    // the frames left, in the rate of @sample
+    uint32_t remaining = 0;
+    ysfx_real target = 0;
+    ysfx_real step = 0;
+};
+
+struct ysfx_profile_section_t {
+    std::atomic<uint64_t> calls{0};
+    std::atomic<uint64_t> total_ns{0};
+    std::atomic<uint64_t> min_ns{~(uint64_t)0};
+    std::atomic<uint64_t> max_ns{0};
+    std::atomic<uint32_t> histogram[ysfx_profile_histogram_size] = {};
+};
+
+// the load of a cycle is kept in millionths
+struct ysfx_deadline_t {
+    std::atomic<uint64_t> cycles{0};
+    std::atomic<uint64_t> misses{0};
+    std::atomic<uint64_t> max_load_ppm{0};
+    std::atomic<uint32_t> histogram[ysfx_deadline_histogram_size] = {};
+    // the recent loads, smoothed over the duration of the audio
+    std::atomic<double> avg_load{0};
+    std::atomic<double> peak_load{0};
+};
+
 enum ysfx_thread_id_t {
     ysfx_thread_id_none,
     ysfx_thread_id_dsp,
     ysfx_thread_id_gfx,
 };
 
+// the statistics of loading, which each thread gathers apart before they are added
+struct ysfx_load_record_t {
+    ysfx_load_stats_t stats{};
+    std::string slowest_file;
+};
+
 struct ysfx_s {
     ysfx_config_u config;
     eel_string_context_state_u string_ctx;
     ysfx::mutex string_mutex;
     ysfx::mutex atomic_mutex;
     ysfx::mutex image_mutex;
+    ysfx::mutex lazy_code_mutex;
     NSEEL_VMCTX_u vm;
 
     // some default values, these are not standard, just arbitrary
     uint32_t block_size = 128;
     ysfx_real sample_rate = 44100;
     uint32_t valid_input_channels = 2;
+    uint32_t denormal_mode = ysfx_denormal_add_offset;
 
     bool is_freshly_compiled = false;
     bool must_compute_init = false;
@@ -71,13 +192,24 @@ struct ysfx_s {
     bool has_serialize = false;
     bool want_undo = false;
 
-    std::unordered_map<ysfx_real *, uint32_t> slider_of_var;
+    // the transport of the last `ysfx_set_time_info`, with its derived values
+    ysfx_transport_t transport{{120, ysfx_playback_playing, 0, 0, {0, 4}}, 0, 0, 0};
+    // the offline flag of the transport, for the other threads
+    std::atomic<bool> offline{false};
+
+    // the slider variables, sorted by address
+    std::vector<std::pair<ysfx_real *, uint32_t>> slider_of_var;
     
     struct fixed_variables {
         EEL_F* vars[ysfx_max_default_vars];
         uint16_t count{0};
     } built_ins;
 
+    // user strings built ahead of time, for the VM to take without allocating
+    struct {
+        std::vector<std::unique_ptr<WDL_FastString>> spare;
+    } string_pool;
+
     // source
     struct {
         std::string main_file_path;
@@ -85,22 +217,45 @@ struct ysfx_s {
         ysfx_source_unit_u main;
         std::vector<ysfx_source_unit_u> imports;
         std::unordered_map<std::string, uint32_t> slider_alias;
+        uint32_t load_options = 0;
+        // the values of the config items, which the files are preprocessed with
+        std::map<std::string, ysfx_real> config_values;
     } source;
 
     // compilation
     struct {
         bool compiled = false;
+        uint32_t options = 0;
         std::vector<NSEEL_CODEHANDLE_u> init;
         NSEEL_CODEHANDLE_u slider;
         NSEEL_CODEHANDLE_u block;
         NSEEL_CODEHANDLE_u sample;
+        // @sample inside a loop over the frames, with `ysfx_compile_frame_loop`
+        NSEEL_CODEHANDLE_u sample_loop;
         NSEEL_CODEHANDLE_u gfx;
         NSEEL_CODEHANDLE_u serialize;
+        NSEEL_CODEHANDLE_u midi;
+        // named global memory, if the effect has `options:gmem`
+        ysfx_gmem_sp gmem;
+        // sections which compile at their first use
+        const ysfx_section_t *lazy_gfx = nullptr;
+        const ysfx_section_t *lazy_serialize = nullptr;
+        // whether the sections have the probes of `ysfx_compile_profile_lines`
+        bool line_probes = false;
+        // the variants of @sample for the values of `options:const`
+        ysfx_specializer_u specializer;
+        // the code of `eval`, by its text
+        ysfx_eval_cache_u eval_cache;
+        // the patterns of `match` and `matchi`
+        ysfx_match_cache_u match_cache;
+        // the flags of `ysfx_capability_t`
+        uint32_t capabilities = 0;
     } code;
 
     // VM variables
     struct {
-        EEL_F *spl[ysfx_max_channels] = {};
+        // one per channel, at least `ysfx_fixed_channels`
+        std::vector<ysfx_real *> spl;
         EEL_F *slider[ysfx_max_sliders] = {};
         EEL_F *srate = nullptr;
         EEL_F *num_ch = nullptr;
@@ -109,6 +264,7 @@ struct ysfx_s {
         EEL_F *tempo = nullptr;
         EEL_F *play_state = nullptr;
         EEL_F *play_position = nullptr;
+        EEL_F *play_offline = nullptr;
         EEL_F *beat_position = nullptr;
         EEL_F *ts_num = nullptr;
         EEL_F *ts_denom = nullptr;
@@ -148,14 +304,170 @@ struct ysfx_s {
     struct {
         ysfx_midi_buffer_u in;
         ysfx_midi_buffer_u out;
+        bool sort_output = false;
+        bool dedup_output = false;
+        uint32_t dedup_interval = 0;
+        // the events posted by other threads, moved into the input at each cycle
+        ysfx_midi_queue_u queue;
+        // the input as seen by @midi, which is the event it runs for
+        ysfx_midi_buffer_u event;
+        // the next input event for @midi, if it is already read
+        ysfx_midi_event_t pending{};
+        bool has_pending = false;
     } midi;
 
+    // Profiling
+    struct {
+        std::atomic<bool> enabled{false};
+        ysfx_profile_section_t section[ysfx_section_midi + 1];
+        // the part of @gfx spent in the drawing functions
+        std::atomic<uint64_t> gfx_draw_ns{0};
+        // the probe which ran last on each thread, or zero when no code runs
+        std::atomic<uint32_t> line[ysfx_line_probe_slots] = {};
+        ysfx_line_sampler_u line_sampler;
+        ysfx_deadline_t deadline;
+    } profile;
+
+    // Statistics of loading and compilation
+    ysfx_load_record_t load;
+
+    // VM memory
+    struct {
+        uint32_t high_water = 0;
+        ysfx_prefault_policy_t auto_prefault = ysfx_prefault_none;
+    } memory;
+
+    // Copy of VM memory taken after each cycle, in a triple buffer
+    struct {
+        uint32_t addr = 0;
+        uint32_t count = 0;
+        // the processing writes into `back`, the reader owns `front`
+        ysfx::triple_buffer<std::vector<ysfx_real>> buffer;
+    } vmem_snapshot;
+
+    // Copy of the slider values taken after each cycle, in a triple buffer,
+    //   published only when they change, once a reader has asked for them
+    struct {
+        std::atomic<bool> enabled{false};
+        struct values_t {
+            uint64_t generation;
+            ysfx_real values[ysfx_max_sliders];
+        };
+        // the processing writes into `back`, the reader owns `front`
+        ysfx::triple_buffer<values_t> buffer;
+        // the values which were published last
+        values_t current{};
+        // the view of `front` which the reader is given
+        ysfx_slider_snapshot_t view{};
+    } slider_snapshot;
+
+    // Values which a reader watches, copied after each cycle
+    ysfx_watch_t watch;
+
+    // Staging of samples for @sample
+    struct {
+        std::vector<ysfx_real> in;
+        std::vector<ysfx_real> out;
+    } scratch;
+
+    // the channels of the interleaved processing, sized by the pins
+    struct {
+        ysfx_channel_list_t<float> f32;
+        ysfx_channel_list_t<double> f64;
+    } interleaved;
+
+    // Metering of the channels in and out, written by the audio thread;
+    //   the channels are allocated once enabled, and kept until the end
+    struct {
+        std::atomic<bool> enabled{false};
+        std::unique_ptr<ysfx_meter_channel_t[]> ins;
+        std::unique_ptr<ysfx_meter_channel_t[]> outs;
+        std::atomic<uint32_t> num_ins{0};
+        std::atomic<uint32_t> num_outs{0};
+    } meters;
+
+    // Silence detection
+    struct {
+        uint32_t num_blocks = 0;
+        ysfx_real threshold = 0;
+        uint32_t silent_blocks = 0;
+        std::atomic<bool> sleeping{false};
+    } silence;
+
+    // Oversampling of @sample
+    struct {
+        uint32_t factor = 1;
+        std::vector<ysfx_oversampler_t> in;
+        std::vector<ysfx_oversampler_t> out;
+        std::vector<ysfx_real> in_buf;
+        std::vector<ysfx_real> out_buf;
+    } oversampling;
+
+    // the delay of the outputs outside of `pdc_bot_ch` and `pdc_top_ch`
+    struct {
+        bool enabled = false;
+        // planar, `capacity` frames per channel, a power of 2
+        std::vector<ysfx_real> lines;
+        uint32_t capacity = 0;
+        uint32_t num_channels = 0;
+        uint32_t pos = 0;
+        // the capacity which the host reserves, besides that which @init needs
+        uint32_t reserve_channels = 0;
+        uint32_t reserve_frames = 0;
+        // the settings which the lines are filled for
+        uint32_t delay = 0;
+        uint32_t channels[2] = {};
+    } pdc;
+
+    // Sample-accurate splitting
+    struct {
+        uint32_t min_frames = 0;
+        std::vector<ysfx_slider_event_t> slider_events;
+        std::vector<ysfx_trigger_event_t> trigger_events;
+        std::vector<uint32_t> points;
+        // the frame of the cycle which the code is computing
+        uint32_t frame = 0;
+        ysfx_midi_buffer_u midi_in;
+        ysfx_midi_buffer_u midi_out;
+    } split;
+
+    // the frames which @sample goes through, in the planar buffers of the sub-block
+    struct {
+        const ysfx_real *in = nullptr;
+        ysfx_real *out = nullptr;
+        uint32_t num_ins = 0;
+        uint32_t num_outs = 0;
+        uint32_t num_frames = 0;
+        uint32_t offset = 0;
+        // the frame which comes next, and the offset of the next MIDI event
+        uint32_t index = 0;
+        uint32_t next_midi = 0;
+        // whether the loop of `ysfx_compile_frame_loop` runs, and has a frame to store
+        bool looping = false;
+        bool pending = false;
+    } frames;
+
     // Slider
     struct {
         ysfx::sync_bitset64 automate_mask[ysfx_max_slider_groups];
         ysfx::sync_bitset64 change_mask[ysfx_max_slider_groups];
         ysfx::sync_bitset64 visible_mask[ysfx_max_slider_groups];
+        // the sliders whose visibility changed, since it was last fetched
+        ysfx::sync_bitset64 visible_change_mask[ysfx_max_slider_groups];
+        ysfx_slider_visibility_callback_t *visible_callback = nullptr;
+        void *visible_callback_data = nullptr;
         ysfx::sync_bitset64 touch_mask[ysfx_max_slider_groups];
+        // the values as of the last check for value changes
+        ysfx_real value_cache[ysfx_max_sliders] = {};
+        ysfx_slider_ramp_t ramp[ysfx_max_sliders];
+        // the curves, sampled at load, for `ysfx_slider_set_values` and `ysfx_slider_get_values`
+        ysfx_curve_table_t curve_table[ysfx_max_sliders];
+        // the sliders which are gliding
+        std::vector<uint32_t> ramping;
+        // the changes posted by other threads, scheduled at each cycle
+        ysfx::bounded_queue<ysfx_slider_event_t> queue;
+        // the automations made by the effect, with their timing
+        ysfx::bounded_queue<ysfx_slider_event_t> automation;
     } slider;
 
     // Triggers
@@ -163,21 +475,86 @@ struct ysfx_s {
 
     // Files
     struct {
-        std::vector<ysfx_file_u> list;
-        ysfx::mutex list_mutex;
+        // the open files, by handle; slot 0 has the serializer
+        ysfx_file_slot_t slots[ysfx_max_file_handles];
+        // the stack of free slots, as the index plus 1 and a tag against ABA
+        std::atomic<uint64_t> free_head{0};
+        // the seconds which audio files stream ahead, or 0 to read them directly
+        ysfx_real read_ahead = 0;
+        // whether audio files are resampled to the rate of the effect
+        bool resample = false;
+        // whether @serialize stores the values as 64-bit doubles, instead of 32-bit floats
+        bool serialize_f64 = false;
+        // the files which were found by name, valid until their stamps change
+        std::unordered_map<std::string, ysfx_resolved_file_t> resolved;
+        ysfx::mutex resolved_mutex;
+        // the files which were found while @init ran last, in order, for its manifest; under the same mutex
+        ysfx::string_list init_manifest;
+        bool recording_init = false;
+        // the thread of `file_open_async`, if the code has it; it is the last, to stop first
+        ysfx_file_opener_u opener;
     } file;
 
+    // Convolvers, by handle minus 1; they are destroyed at @init
+    struct {
+        std::vector<ysfx_convolver_u> list;
+    } convolver;
+
+    // Lookaheads, by handle minus 1; they are destroyed at @init
+    struct {
+        std::vector<ysfx_lookahead_u> list;
+    } lookahead;
+
+    // Analyzers, by handle minus 1; they are kept across @init, until the code is unloaded,
+    //   and the audio thread feeds the first `count` of them with the outputs
+    struct {
+        ysfx_analyzer_u list[ysfx_max_analyzers];
+        std::atomic<uint32_t> count{0};
+        // the magnitudes of a reading, before they are written to the memory
+        std::vector<ysfx_real> magnitudes;
+    } analyzer;
+
+    // what brings back an effect which hibernates, while its code and memory are released
+    struct {
+        bool active = false;
+        uint32_t compile_options = 0;
+        ysfx_state_u state;
+        ysfx_snapshot_u vm;
+    } hibernation;
+
 #if !defined(YSFX_NO_GFX)
     // Graphics
     struct {
         ysfx_gfx_state_u state;
         ysfx::mutex mutex;
+        ysfx_gfx_input_t input;
+        // the wheel totals which @gfx has applied, from the input
+        ysfx_real wheel_received = 0;
+        ysfx_real hwheel_received = 0;
         volatile bool ready = false;
         volatile bool wants_retina = false;
         std::atomic<bool> must_init{false};
     } gfx;
 #endif
 
+    // the sources preprocessed for the values of the config items, kept to switch between them
+    struct {
+        // the file which they are for; loading another one forgets them
+        std::string path;
+        // the values chosen over the defaults of the header
+        std::map<std::string, ysfx_real> values;
+        // the sections of each variant, which keep it in the registry of parsed units
+        std::map<std::map<std::string, ysfx_real>, std::vector<std::shared_ptr<const ysfx_toplevel_t>>> cache;
+        ysfx::mutex mutex;
+        std::atomic<bool> cancel{false};
+        // the thread which prepares the variants in the background
+        ysfx_init_worker_u worker;
+    } variant;
+
+    // the thread which runs @init in the background, if enabled; it is the last,
+    //   so that it stops before the rest is destroyed
+    ysfx_init_worker_u init_worker;
+
     std::atomic<uint32_t> ref_count{1};
 };
 
@@ -189,13 +566,30 @@ void ysfx_first_init(ysfx_t *fx);
 void ysfx_update_slider_visibility_mask(ysfx_t *fx);
 void ysfx_fill_file_enums(ysfx_t *fx);
 void ysfx_fix_invalid_enums(ysfx_t *fx);
-ysfx_section_t *ysfx_search_section(ysfx_t *fx, uint32_t type, ysfx_toplevel_t **origin = nullptr);
+const ysfx_section_t *ysfx_search_section(ysfx_t *fx, uint32_t type, const ysfx_toplevel_t **origin = nullptr);
 std::string ysfx_resolve_import_path(ysfx_t *fx, const std::string &name, const std::string &origin);
 uint32_t ysfx_current_midi_bus(ysfx_t *fx);
+// the steps of the loop of `ysfx_compile_frame_loop`, which its code calls
+uint32_t ysfx_sample_loop_count(ysfx_t *fx);
+void ysfx_sample_loop_step(ysfx_t *fx);
 void ysfx_clear_files(ysfx_t *fx);
-ysfx_file_t *ysfx_get_file(ysfx_t *fx, uint32_t handle, std::unique_lock<ysfx::mutex> &lock, std::unique_lock<ysfx::mutex> *list_lock = nullptr);
+ysfx_file_t *ysfx_get_file(ysfx_t *fx, uint32_t handle, std::unique_lock<ysfx::mutex> &lock);
 int32_t ysfx_insert_file(ysfx_t *fx, ysfx_file_t *file);
+bool ysfx_close_file(ysfx_t *fx, uint32_t handle);
 void ysfx_serialize(ysfx_t *fx);
+// count a cycle which took `ns` for `num_frames`, in the statistics of the deadline and the recent loads
+void ysfx_record_deadline(ysfx_t *fx, uint64_t ns, uint32_t num_frames);
 uint32_t ysfx_get_slider_of_var(ysfx_t *fx, EEL_F *var);
-bool ysfx_find_data_file(ysfx_t *fx, EEL_F *file, std::string &result);
+// the name of a data file, as the code gives it
+struct ysfx_data_file_name_t {
+    std::string part;
+    bool accept_absolute = false;
+    bool accept_relative = false;
+};
+// get the name of the file which the code names, which is quick, unlike finding it
+bool ysfx_get_data_file_name(ysfx_t *fx, EEL_F *file, ysfx_data_file_name_t &name);
+// find a file by name, and optionally detect its type
+bool ysfx_resolve_data_file(ysfx_t *fx, const ysfx_data_file_name_t &name, std::string &result, ysfx_file_type_t *type = nullptr, void **fmtobj = nullptr);
+// find the file which the code names, and optionally detect its type
+bool ysfx_find_data_file(ysfx_t *fx, EEL_F *file, std::string &result, ysfx_file_type_t *type = nullptr, void **fmtobj = nullptr);
 ysfx_file_type_t ysfx_detect_file_type(ysfx_t *fx, const char *path, void **fmtobj);
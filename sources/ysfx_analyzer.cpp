@@ -0,0 +1,136 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+#include "ysfx_analyzer.hpp"
+#include "ysfx_block_math.hpp"
+#include "WDL/fft.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#   define YSFX_ANALYZER_SSE2 1
+#   include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#   define YSFX_ANALYZER_NEON 1
+#   include <arm_neon.h>
+#endif
+
+static_assert(sizeof(WDL_FFT_REAL) == sizeof(ysfx_real), "the transforms operate on the real type");
+
+// the magnitudes of the pairs in place, as the first `pairs` values
+static void ysfx_pair_magnitudes(ysfx_real *buf, uint32_t pairs, ysfx_real scale)
+{
+    uint32_t i = 0;
+#if defined(YSFX_ANALYZER_SSE2)
+    const __m128d vscale = _mm_set1_pd(scale);
+    for (; i + 2 <= pairs; i += 2) {
+        __m128d a = _mm_loadu_pd(&buf[2 * i]), b = _mm_loadu_pd(&buf[2 * i + 2]);
+        a = _mm_mul_pd(a, a);
+        b = _mm_mul_pd(b, b);
+        __m128d sum = _mm_add_pd(_mm_unpacklo_pd(a, b), _mm_unpackhi_pd(a, b));
+        _mm_storeu_pd(&buf[i], _mm_mul_pd(_mm_sqrt_pd(sum), vscale));
+    }
+#elif defined(YSFX_ANALYZER_NEON)
+    for (; i + 2 <= pairs; i += 2) {
+        float64x2_t a = vld1q_f64(&buf[2 * i]), b = vld1q_f64(&buf[2 * i + 2]);
+        float64x2_t sum = vpaddq_f64(vmulq_f64(a, a), vmulq_f64(b, b));
+        vst1q_f64(&buf[i], vmulq_n_f64(vsqrtq_f64(sum), scale));
+    }
+#endif
+    for (; i < pairs; ++i) {
+        ysfx_real re = buf[2 * i], im = buf[2 * i + 1];
+        buf[i] = std::sqrt(re * re + im * im) * scale;
+    }
+}
+
+//------------------------------------------------------------------------------
+ysfx_analyzer_t::ysfx_analyzer_t(uint32_t channel, uint32_t size)
+    : m_channel(channel),
+      m_size(size),
+      m_ring(new std::atomic<ysfx_real>[2 * (size_t)size])
+{
+    WDL_fft_init();
+
+    for (uint32_t i = 0; i < 2 * size; ++i)
+        m_ring[i].store(0, std::memory_order_relaxed);
+    m_work.resize(size);
+}
+
+void ysfx_analyzer_t::make_window(uint32_t window)
+{
+    const uint32_t size = m_size;
+    const double pi = 3.14159265358979323846;
+
+    m_window.resize(size);
+    for (uint32_t i = 0; i < size; ++i) {
+        double x = 2 * pi * i / size;
+        switch (window) {
+        default:
+        case window_rectangular:
+            m_window[i] = 1;
+            break;
+        case window_hann:
+            m_window[i] = 0.5 - 0.5 * std::cos(x);
+            break;
+        case window_blackman_harris:
+            m_window[i] = 0.35875 - 0.48829 * std::cos(x) + 0.14128 * std::cos(2 * x) - 0.01168 * std::cos(3 * x);
+            break;
+        }
+    }
+
+    // the transform of WDL has twice the gain of the DFT, and a sine has half
+    //   of its amplitude at the bin, so this cancels out with the window's sum
+    double sum = 0;
+    for (uint32_t i = 0; i < size; ++i)
+        sum += m_window[i];
+    m_window_scale = (ysfx_real)(1 / sum);
+    m_window_kind = window;
+}
+
+void ysfx_analyzer_t::read_magnitudes(ysfx_real *dest, uint32_t window)
+{
+    const uint32_t size = m_size;
+    const uint32_t half = size / 2;
+    const uint64_t mask = 2 * (uint64_t)size - 1;
+
+    if (window >= window_count)
+        window = window_hann;
+    if (window != m_window_kind)
+        make_window(window);
+
+    // the most recent samples; the ring has room for the writer to advance by
+    //   another whole transform without touching them while they are copied
+    ysfx_real *work = m_work.data();
+    const uint64_t time = m_time.load(std::memory_order_acquire);
+    const uint64_t start = time - std::min<uint64_t>(time, size);
+    const uint32_t pad = (uint32_t)(size - (time - start));
+    std::fill_n(work, pad, (ysfx_real)0);
+    for (uint32_t i = pad; i < size; ++i)
+        work[i] = m_ring[(start + i - pad) & mask].load(std::memory_order_relaxed);
+
+    ysfx::block_mul(work, m_window.data(), size);
+    WDL_real_fft(work, (int)size, 0);
+
+    // the zero frequency is real, it has no negative frequency to pair with
+    const int *permute = WDL_fft_permute_tab((int)half);
+    ysfx_real dc = std::fabs(work[0]) * (m_window_scale / 2);
+    work[1] = 0;
+    ysfx_pair_magnitudes(work, half, m_window_scale);
+
+    dest[0] = dc;
+    for (uint32_t k = 1; k < half; ++k)
+        dest[k] = work[permute[k]];
+}
@@ -0,0 +1,77 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+#pragma once
+#include "ysfx.h"
+#include <vector>
+#include <atomic>
+#include <memory>
+
+// a tap of the audio of a channel, whose spectrum is computed on request;
+//   the audio thread writes the samples to a ring, without locking, and the
+//   reader transforms the most recent ones, in the thread which asks for them
+struct ysfx_analyzer_t {
+    ysfx_analyzer_t(uint32_t channel, uint32_t size);
+
+    uint32_t channel() const { return m_channel; }
+    uint32_t size() const { return m_size; }
+
+    // add the samples of the channel, or silence if it is null; by the audio thread only
+    template <class Real>
+    void write(const Real *src, uint32_t stride, uint32_t count);
+
+    // compute the magnitudes of the `size / 2` bins of the most recent samples,
+    //   scaled so that a sine of amplitude 1 at the center of a bin reads 1;
+    //   by a single reader at once
+    void read_magnitudes(ysfx_real *dest, uint32_t window);
+
+    // the sizes of the transforms
+    static constexpr uint32_t min_size = 16;
+    static constexpr uint32_t max_size = 32768;
+
+    enum {
+        window_rectangular,
+        window_hann,
+        window_blackman_harris,
+        window_count,
+    };
+
+private:
+    void make_window(uint32_t window);
+
+    uint32_t m_channel = 0;
+    uint32_t m_size = 0;
+    // the recent samples, twice the size of the transform, by the time modulo this
+    std::unique_ptr<std::atomic<ysfx_real>[]> m_ring;
+    std::atomic<uint64_t> m_time{0};
+    // the state of the reader
+    std::vector<ysfx_real> m_work;
+    std::vector<ysfx_real> m_window;
+    uint32_t m_window_kind = ~(uint32_t)0;
+    ysfx_real m_window_scale = 0;
+};
+
+template <class Real>
+void ysfx_analyzer_t::write(const Real *src, uint32_t stride, uint32_t count)
+{
+    const uint64_t mask = 2 * (uint64_t)m_size - 1;
+    uint64_t time = m_time.load(std::memory_order_relaxed);
+    for (uint32_t i = 0; i < count; ++i)
+        m_ring[(time + i) & mask].store(src ? (ysfx_real)src[i * stride] : 0, std::memory_order_relaxed);
+    m_time.store(time + count, std::memory_order_release);
+}
+
+using ysfx_analyzer_u = std::unique_ptr<ysfx_analyzer_t>;
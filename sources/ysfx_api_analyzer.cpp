@@ -0,0 +1,87 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+#include "ysfx.hpp"
+#include "ysfx_api_analyzer.hpp"
+#include "ysfx_analyzer.hpp"
+#include "ysfx_eel_utils.hpp"
+
+static ysfx_analyzer_t *ysfx_get_analyzer(ysfx_t *fx, EEL_F handle_)
+{
+    int32_t handle = ysfx_eel_round<int32_t>(handle_);
+    if (handle < 1 || (uint32_t)handle > fx->analyzer.count.load(std::memory_order_acquire))
+        return nullptr;
+    return fx->analyzer.list[(uint32_t)handle - 1].get();
+}
+
+static EEL_F NSEEL_CGEN_CALL ysfx_api_analyzer_create(void *opaque, EEL_F *channel_, EEL_F *size_)
+{
+    ysfx_t *fx = (ysfx_t *)opaque;
+    if (ysfx_get_thread_id() == ysfx_thread_id_gfx)
+        return 0;
+
+    int32_t channel = ysfx_eel_round<int32_t>(*channel_);
+    int32_t size = ysfx_eel_round<int32_t>(*size_);
+    if (channel < 0 || channel >= ysfx_max_channels)
+        return 0;
+    if (size < (int32_t)ysfx_analyzer_t::min_size || size > (int32_t)ysfx_analyzer_t::max_size || (size & (size - 1)) != 0)
+        return 0;
+
+    // the same tap again, as @init runs more than once
+    const uint32_t count = fx->analyzer.count.load(std::memory_order_relaxed);
+    for (uint32_t i = 0; i < count; ++i) {
+        ysfx_analyzer_t *analyzer = fx->analyzer.list[i].get();
+        if (analyzer->channel() == (uint32_t)channel && analyzer->size() == (uint32_t)size)
+            return (EEL_F)(i + 1);
+    }
+    if (count == ysfx_max_analyzers)
+        return 0;
+
+    fx->analyzer.list[count].reset(new ysfx_analyzer_t((uint32_t)channel, (uint32_t)size));
+    fx->analyzer.count.store(count + 1, std::memory_order_release);
+    return (EEL_F)(count + 1);
+}
+
+static EEL_F NSEEL_CGEN_CALL ysfx_api_analyzer_read(void *opaque, INT_PTR np, EEL_F **parms)
+{
+    ysfx_t *fx = (ysfx_t *)opaque;
+    if (ysfx_get_thread_id() != ysfx_thread_id_gfx)
+        return 0;
+
+    ysfx_analyzer_t *analyzer = ysfx_get_analyzer(fx, *parms[0]);
+    int64_t addr = ysfx_eel_round<int64_t>(*parms[1]);
+    int32_t window = (np > 2) ? ysfx_eel_round<int32_t>(*parms[2]) : (int32_t)ysfx_analyzer_t::window_hann;
+    if (!analyzer || addr < 0 || window < 0)
+        return 0;
+
+    const uint32_t bins = analyzer->size() / 2;
+    std::vector<ysfx_real> &magnitudes = fx->analyzer.magnitudes;
+    magnitudes.resize(bins);
+    analyzer->read_magnitudes(magnitudes.data(), (uint32_t)window);
+
+    ysfx_eel_ram_writer writer{fx->vm.get(), addr};
+    for (uint32_t i = 0; i < bins; ++i) {
+        if (!writer.write_next(magnitudes[i]))
+            return (EEL_F)i;
+    }
+    return (EEL_F)bins;
+}
+
+void ysfx_api_init_analyzer()
+{
+    NSEEL_addfunc_retval("analyzer_create", 2, NSEEL_PProc_THIS, &ysfx_api_analyzer_create);
+    NSEEL_addfunc_varparm("analyzer_read", 2, NSEEL_PProc_THIS, &ysfx_api_analyzer_read);
+}
@@ -0,0 +1,123 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+#include "ysfx.hpp"
+#include "ysfx_api_convolve.hpp"
+#include "ysfx_convolver.hpp"
+#include "ysfx_eel_utils.hpp"
+#include <vector>
+#include <algorithm>
+
+enum {
+    ysfx_max_convolvers = 64, // change if it needs more
+};
+
+static ysfx_convolver_t *ysfx_get_convolver(ysfx_t *fx, EEL_F handle_)
+{
+    int32_t handle = ysfx_eel_round<int32_t>(handle_);
+    if (handle < 1 || (uint32_t)handle > fx->convolver.list.size())
+        return nullptr;
+    return fx->convolver.list[(uint32_t)handle - 1].get();
+}
+
+static EEL_F NSEEL_CGEN_CALL ysfx_api_conv_create(void *opaque, INT_PTR np, EEL_F **parms)
+{
+    ysfx_t *fx = (ysfx_t *)opaque;
+    if (ysfx_get_thread_id() == ysfx_thread_id_gfx)
+        return 0;
+
+    int64_t addr = ysfx_eel_round<int64_t>(*parms[0]);
+    int64_t length = ysfx_eel_round<int64_t>(*parms[1]);
+    int32_t block = ysfx_eel_round<int32_t>(*parms[2]);
+    bool threaded = np > 3 && ysfx_eel_round<int32_t>(*parms[3]) != 0;
+    if (length < 0 || length > (int64_t)NSEEL_RAM_BLOCKS * NSEEL_RAM_ITEMSPERBLOCK)
+        return 0;
+
+    std::vector<ysfx_convolver_u> &list = fx->convolver.list;
+    size_t index = 0;
+    while (index < list.size() && list[index])
+        ++index;
+    if (index == ysfx_max_convolvers)
+        return 0;
+
+    std::vector<ysfx_real> impulse((size_t)length);
+    ysfx_eel_ram_reader reader{fx->vm.get(), addr};
+    for (ysfx_real &value : impulse)
+        value = reader.read_next();
+
+    ysfx_convolver_u conv{new ysfx_convolver_t(impulse.data(), (uint32_t)length, (uint32_t)std::max(block, 0), threaded)};
+    if (index == list.size())
+        list.push_back(std::move(conv));
+    else
+        list[index] = std::move(conv);
+
+    return (EEL_F)(index + 1);
+}
+
+static EEL_F NSEEL_CGEN_CALL ysfx_api_conv_process(void *opaque, EEL_F *handle_, EEL_F *buf_, EEL_F *len_)
+{
+    ysfx_t *fx = (ysfx_t *)opaque;
+    if (ysfx_get_thread_id() == ysfx_thread_id_gfx)
+        return 0;
+
+    ysfx_convolver_t *conv = ysfx_get_convolver(fx, *handle_);
+    int64_t addr = ysfx_eel_round<int64_t>(*buf_);
+    int64_t len = ysfx_eel_round<int64_t>(*len_);
+    if (!conv || addr < 0 || len <= 0)
+        return 0;
+
+    // the buffer, by the pieces which are contiguous
+    int64_t done = 0;
+    while (done < len && addr + done <= 0xFFFFFFFFu) {
+        int32_t valid = 0;
+        EEL_F *samples = NSEEL_VM_getramptr(fx->vm.get(), (uint32_t)(addr + done), &valid);
+        if (!samples || valid <= 0)
+            break;
+        uint32_t n = (uint32_t)std::min<int64_t>(len - done, valid);
+        conv->process(samples, n);
+        done += n;
+    }
+
+    return (EEL_F)done;
+}
+
+static EEL_F NSEEL_CGEN_CALL ysfx_api_conv_latency(void *opaque, EEL_F *handle_)
+{
+    ysfx_t *fx = (ysfx_t *)opaque;
+    ysfx_convolver_t *conv = ysfx_get_convolver(fx, *handle_);
+    return conv ? (EEL_F)conv->latency() : 0;
+}
+
+static EEL_F NSEEL_CGEN_CALL ysfx_api_conv_free(void *opaque, EEL_F *handle_)
+{
+    ysfx_t *fx = (ysfx_t *)opaque;
+    if (ysfx_get_thread_id() == ysfx_thread_id_gfx)
+        return 0;
+
+    int32_t handle = ysfx_eel_round<int32_t>(*handle_);
+    if (!ysfx_get_convolver(fx, *handle_))
+        return 0;
+    fx->convolver.list[(uint32_t)handle - 1].reset();
+    return 1;
+}
+
+void ysfx_api_init_convolve()
+{
+    NSEEL_addfunc_varparm("conv_create", 3, NSEEL_PProc_THIS, &ysfx_api_conv_create);
+    NSEEL_addfunc_retval("conv_process", 3, NSEEL_PProc_THIS, &ysfx_api_conv_process);
+    NSEEL_addfunc_retval("conv_latency", 1, NSEEL_PProc_THIS, &ysfx_api_conv_latency);
+    NSEEL_addfunc_retval("conv_free", 1, NSEEL_PProc_THIS, &ysfx_api_conv_free);
+}
@@ -20,17 +20,22 @@
 
 #include "ysfx.hpp"
 #include "ysfx_api_eel.hpp"
+#include "ysfx_config.hpp"
 #include "ysfx_utils.hpp"
+#include "ysfx_eel_utils.hpp"
+#include "ysfx_block_math.hpp"
+#include <algorithm>
 #include <cstring>
 #include <cstdlib>
 #include <cstddef>
+#include <cmath>
 
 #include "WDL/ptrlist.h"
 #include "WDL/assocarray.h"
 #include "WDL/mutex.h"
 
 #ifndef EELSCRIPT_NO_STDIO
-#   define EEL_STRING_STDOUT_WRITE(x,len) { fwrite(x,len,1,stdout); fflush(stdout); }
+#   define EEL_STRING_STDOUT_WRITE(x,len) { ysfx_log_stdout(*((ysfx_t *)opaque)->config, x, (size_t)(len)); }
 #endif
 
 //TODO: thread-safety considerations with strings
@@ -38,15 +43,574 @@
 #define EEL_STRING_MAXUSERSTRING_LENGTH_HINT ysfx_string_max_length
 
 static ysfx::mutex atomic_mutex;
-#define EEL_ATOMIC_SET_SCOPE(opaque) ysfx::mutex *mutex = ((opaque) ? &((ysfx_t *)(opaque))->atomic_mutex : &atomic_mutex);
-#define EEL_ATOMIC_ENTER mutex->lock()
-#define EEL_ATOMIC_LEAVE mutex->unlock()
 
 #include "WDL/eel2/eel_strings.h"
 #include "WDL/eel2/eel_misc.h"
 #include "WDL/eel2/eel_fft.h"
 #include "WDL/eel2/eel_mdct.h"
-#include "WDL/eel2/eel_atomic.h"
+
+//------------------------------------------------------------------------------
+// eval: the code of the texts is kept by the instance, so a text which repeats
+//   compiles once; the nesting is limited, as the code can eval itself
+
+enum { ysfx_eval_max_depth = 8 };
+static thread_local int ysfx_eval_depth = 0;
+
+static char *ysfx_eval_take(ysfx_t *fx, const char *text, NSEEL_CODEHANDLE &code)
+{
+    ysfx_eval_cache_t *cache = fx->code.eval_cache.get();
+    return cache ? cache->take(text, code) : nullptr;
+}
+
+static void ysfx_eval_put(ysfx_t *fx, char *text, NSEEL_CODEHANDLE code)
+{
+    if (ysfx_eval_cache_t *cache = fx->code.eval_cache.get())
+        cache->put(text, code);
+    else {
+        NSEEL_code_free(code);
+        free(text);
+    }
+}
+
+#define EEL_EVAL_GET_VMCTX(opaque) (((ysfx_t *)(opaque))->vm.get())
+#define EEL_EVAL_GET_CACHED(str, ch) ysfx_eval_take((ysfx_t *)(opaque), (str), (ch))
+#define EEL_EVAL_SET_CACHED(sv, ch) ysfx_eval_put((ysfx_t *)(opaque), (sv), (ch))
+#define EEL_EVAL_SCOPE_ENTER (ysfx_eval_depth < ysfx_eval_max_depth && ++ysfx_eval_depth)
+#define EEL_EVAL_SCOPE_LEAVE --ysfx_eval_depth;
+#include "WDL/eel2/eel_eval.h"
+
+//------------------------------------------------------------------------------
+// match and matchi: the patterns are compiled once, and these take over the
+//   builtins of eel_strings.h, which interpret them at each step; the values
+//   are stored the same way as there
+
+struct ysfx_match_sink_t {
+    void *opaque = nullptr;
+    int num_fmt_parms = 0;
+    EEL_F **fmt_parms = nullptr;
+    const char *fmt_end = nullptr;
+    const char *msg_end = nullptr;
+
+    EEL_F *resolve(const ysfx_match_op_t &op, int position, EEL_F &alt)
+    {
+        if (op.named)
+            return op.name.empty() ? nullptr : EEL_STRING_GETNAMEDVAR(op.name.c_str(), 1, &alt);
+        EEL_F *var = (position < num_fmt_parms) ? fmt_parms[position] : nullptr;
+        if (!var)
+            var = EEL_STRING_GETFMTVAR(position);
+        return var;
+    }
+
+    void store_char(EEL_F *var, EEL_F &alt, const char *msg)
+    {
+        if (var == &alt) {
+            EEL_STRING_STORAGECLASS *wr = nullptr;
+            EEL_STRING_GET_FOR_WRITE(alt, &wr);
+            if (wr)
+                wr->Set(msg, 1);
+        }
+        else
+            *var = (EEL_F)*(const unsigned char *)msg;
+    }
+
+    void store_value(const ysfx_match_op_t &op, EEL_F *var, EEL_F &alt, const char *msg, int len)
+    {
+        if (op.ch == 's') {
+            EEL_STRING_STORAGECLASS *wr = nullptr;
+            EEL_STRING_GET_FOR_WRITE(*var, &wr);
+            // not into the haystack, nor into the pattern
+            if (wr && !(msg_end >= wr->Get() && msg_end <= wr->Get() + wr->GetLength()) &&
+                !(fmt_end >= wr->Get() && fmt_end <= wr->Get() + wr->GetLength()))
+                wr->SetRaw(msg, len);
+            return;
+        }
+
+        char tmp[128];
+        lstrcpyn_safe(tmp, msg, wdl_min(len + 1, (int)sizeof(tmp)));
+        if (var == &alt) {
+            EEL_STRING_STORAGECLASS *wr = nullptr;
+            EEL_STRING_GET_FOR_WRITE(alt, &wr);
+            if (wr)
+                wr->Set(tmp);
+        }
+        else if (op.ch == 'u')
+            *var = (EEL_F)strtoul(tmp, nullptr, 10);
+        else if (op.ch == 'x')
+            *var = (EEL_F)strtoul(msg, nullptr, 16);
+        else
+            *var = (EEL_F)atof(tmp);
+    }
+};
+
+static EEL_F ysfx_api_match_common(void *opaque, INT_PTR num_parms, EEL_F **parms, bool ignorecase)
+{
+    if (!opaque || num_parms < 2)
+        return 0;
+
+    EEL_STRING_MUTEXLOCK_SCOPE
+    EEL_STRING_STORAGECLASS *fmt_wr = nullptr, *msg_wr = nullptr;
+    const char *fmt = EEL_STRING_GET_FOR_INDEX(*(parms[0]), &fmt_wr);
+    const char *msg = EEL_STRING_GET_FOR_INDEX(*(parms[1]), &msg_wr);
+    if (!fmt || !msg)
+        return 0;
+
+    ysfx_match_sink_t sink;
+    sink.opaque = opaque;
+    sink.num_fmt_parms = (int)num_parms - 2;
+    sink.fmt_parms = parms + 2;
+    sink.fmt_end = fmt + (fmt_wr ? fmt_wr->GetLength() : strlen(fmt));
+    sink.msg_end = msg + (msg_wr ? msg_wr->GetLength() : strlen(msg));
+
+    ysfx_t *fx = (ysfx_t *)opaque;
+    if (ysfx_match_cache_t *cache = fx->code.match_cache.get())
+        return cache->get(fmt, sink.fmt_end).run(sink, msg, sink.msg_end, ignorecase) ? 1 : 0;
+
+    ysfx_match_program_t program;
+    program.compile(fmt, sink.fmt_end);
+    return program.run(sink, msg, sink.msg_end, ignorecase) ? 1 : 0;
+}
+
+static EEL_F NSEEL_CGEN_CALL ysfx_api_match(void *opaque, INT_PTR num_parms, EEL_F **parms)
+{
+    return ysfx_api_match_common(opaque, num_parms, parms, false);
+}
+
+static EEL_F NSEEL_CGEN_CALL ysfx_api_matchi(void *opaque, INT_PTR num_parms, EEL_F **parms)
+{
+    return ysfx_api_match_common(opaque, num_parms, parms, true);
+}
+
+//------------------------------------------------------------------------------
+// block math: vectorized operations on spans of the memory of the VM
+
+static constexpr int64_t ysfx_block_ram_items = (int64_t)NSEEL_RAM_BLOCKS * NSEEL_RAM_ITEMSPERBLOCK;
+
+static int64_t ysfx_block_length(EEL_F len_)
+{
+    int64_t len = ysfx_eel_round<int64_t>(len_);
+    return (len < 0) ? 0 : std::min(len, ysfx_block_ram_items);
+}
+
+// the memory at the address, contiguous for the available count
+//   a source which is not allocated is null, available up to the end of its block
+//   a destination is allocated, or the count is zero
+static ysfx_real *ysfx_block_span(NSEEL_VMCTX vm, int64_t addr, bool alloc, int64_t *avail)
+{
+    *avail = 0;
+    if (addr < 0 || addr >= ysfx_block_ram_items)
+        return nullptr;
+    int32_t valid = 0;
+    ysfx_real *ptr = alloc ? NSEEL_VM_getramptr(vm, (uint32_t)addr, &valid) :
+        NSEEL_VM_getramptr_noalloc(vm, (uint32_t)addr, &valid);
+    if (ptr && valid > 0)
+        *avail = valid;
+    else {
+        ptr = nullptr;
+        if (!alloc)
+            *avail = NSEEL_RAM_ITEMSPERBLOCK - addr % NSEEL_RAM_ITEMSPERBLOCK;
+    }
+    return ptr;
+}
+
+// walk a destination and a source by the pieces which are contiguous in both
+//   the function receives a null source where the memory is not allocated
+template <class Fn>
+static void ysfx_block_walk(NSEEL_VMCTX vm, int64_t dest, int64_t src, int64_t len, Fn &&fn)
+{
+    for (int64_t i = 0; i < len; ) {
+        int64_t davail, savail;
+        ysfx_real *d = ysfx_block_span(vm, dest + i, true, &davail);
+        const ysfx_real *s = ysfx_block_span(vm, src + i, false, &savail);
+        uint32_t n = (uint32_t)std::min(len - i, std::min(davail, savail));
+        if (n == 0)
+            break;
+        fn(d, s, n, i);
+        i += n;
+    }
+}
+
+template <class Fn>
+static void ysfx_block_walk_dest(NSEEL_VMCTX vm, int64_t dest, int64_t len, Fn &&fn)
+{
+    for (int64_t i = 0; i < len; ) {
+        int64_t davail;
+        ysfx_real *d = ysfx_block_span(vm, dest + i, true, &davail);
+        uint32_t n = (uint32_t)std::min(len - i, davail);
+        if (n == 0)
+            break;
+        fn(d, n, i);
+        i += n;
+    }
+}
+
+template <class Fn>
+static void ysfx_block_walk_src(NSEEL_VMCTX vm, int64_t src, int64_t len, Fn &&fn)
+{
+    for (int64_t i = 0; i < len; ) {
+        int64_t savail;
+        const ysfx_real *s = ysfx_block_span(vm, src + i, false, &savail);
+        uint32_t n = (uint32_t)std::min(len - i, savail);
+        if (n == 0)
+            break;
+        if (s)
+            fn(s, n);
+        i += n;
+    }
+}
+
+static EEL_F NSEEL_CGEN_CALL ysfx_api_mem_mul(void *opaque, EEL_F *dest_, EEL_F *src_, EEL_F *len_)
+{
+    ysfx_t *fx = (ysfx_t *)opaque;
+    ysfx_block_walk(
+        fx->vm.get(), ysfx_eel_round<int64_t>(*dest_), ysfx_eel_round<int64_t>(*src_), ysfx_block_length(*len_),
+        [](ysfx_real *d, const ysfx_real *s, uint32_t n, int64_t) {
+            if (s)
+                ysfx::block_mul(d, s, n);
+            else
+                memset(d, 0, n * sizeof(ysfx_real));
+        });
+    return *dest_;
+}
+
+static EEL_F NSEEL_CGEN_CALL ysfx_api_mem_add_scaled(void *opaque, INT_PTR np, EEL_F **parms)
+{
+    (void)np;
+    ysfx_t *fx = (ysfx_t *)opaque;
+    ysfx_real gain = *parms[2];
+    ysfx_block_walk(
+        fx->vm.get(), ysfx_eel_round<int64_t>(*parms[0]), ysfx_eel_round<int64_t>(*parms[1]), ysfx_block_length(*parms[3]),
+        [gain](ysfx_real *d, const ysfx_real *s, uint32_t n, int64_t) {
+            if (s)
+                ysfx::block_add_scaled(d, s, gain, n);
+        });
+    return *parms[0];
+}
+
+static EEL_F NSEEL_CGEN_CALL ysfx_api_mem_ramp(void *opaque, INT_PTR np, EEL_F **parms)
+{
+    (void)np;
+    ysfx_t *fx = (ysfx_t *)opaque;
+    int64_t len = ysfx_block_length(*parms[1]);
+    if (len <= 0)
+        return *parms[0];
+    // the gain reaches the end just after the last element, where the next block starts
+    ysfx_real start = *parms[2];
+    ysfx_real step = (*parms[3] - start) / (ysfx_real)len;
+    ysfx_block_walk_dest(
+        fx->vm.get(), ysfx_eel_round<int64_t>(*parms[0]), len,
+        [start, step](ysfx_real *d, uint32_t n, int64_t i) {
+            ysfx::block_ramp(d, n, start + step * (ysfx_real)i, step, 0);
+        });
+    return *parms[0];
+}
+
+static EEL_F NSEEL_CGEN_CALL ysfx_api_mem_fir(void *opaque, INT_PTR np, EEL_F **parms)
+{
+    (void)np;
+    ysfx_t *fx = (ysfx_t *)opaque;
+    NSEEL_VMCTX vm = fx->vm.get();
+    int64_t dest = ysfx_eel_round<int64_t>(*parms[0]);
+    int64_t src = ysfx_eel_round<int64_t>(*parms[1]);
+    int64_t coefs = ysfx_eel_round<int64_t>(*parms[2]);
+    int64_t order = ysfx_block_length(*parms[3]);
+    int64_t len = ysfx_block_length(*parms[4]);
+    if (order <= 0)
+        return *parms[0];
+
+    int64_t havail;
+    const ysfx_real *h = ysfx_block_span(vm, coefs, false, &havail);
+    if (havail < order)
+        h = nullptr;
+
+    for (int64_t i = 0; i < len; ) {
+        int64_t davail, xavail;
+        ysfx_real *d = ysfx_block_span(vm, dest + i, true, &davail);
+        if (!d)
+            break;
+        const ysfx_real *x = ysfx_block_span(vm, src + i, false, &xavail);
+        int64_t n = std::min(len - i, davail);
+        if (xavail >= order) {
+            n = std::min(n, xavail - (order - 1));
+            if (!x)
+                memset(d, 0, (size_t)n * sizeof(ysfx_real));
+            else if (h)
+                ysfx::block_fir(d, x, h, (uint32_t)order, (uint32_t)n);
+            else
+                n = 0;
+        }
+        else
+            n = 0;
+        if (n == 0) {
+            // a window across blocks, or coefficients which are not contiguous
+            ysfx_real acc = 0;
+            ysfx_eel_ram_reader hr{vm, coefs};
+            for (int64_t k = 0; k < order; ++k) {
+                int64_t xavail1;
+                const ysfx_real *x1 = ysfx_block_span(vm, src + i + order - 1 - k, false, &xavail1);
+                acc += hr.read_next() * (x1 ? *x1 : 0);
+            }
+            d[0] = acc;
+            n = 1;
+        }
+        i += n;
+    }
+
+    return *parms[0];
+}
+
+static EEL_F NSEEL_CGEN_CALL ysfx_api_mem_biquad(void *opaque, INT_PTR np, EEL_F **parms)
+{
+    (void)np;
+    ysfx_t *fx = (ysfx_t *)opaque;
+    NSEEL_VMCTX vm = fx->vm.get();
+    int64_t state = ysfx_eel_round<int64_t>(*parms[3]);
+
+    ysfx_real coefs[5];
+    ysfx_eel_ram_reader cr{vm, ysfx_eel_round<int64_t>(*parms[2])};
+    for (ysfx_real &c : coefs)
+        c = cr.read_next();
+    ysfx_real s[2];
+    ysfx_eel_ram_reader sr{vm, state};
+    for (ysfx_real &v : s)
+        v = sr.read_next();
+
+    ysfx_block_walk_dest(
+        vm, ysfx_eel_round<int64_t>(*parms[0]), ysfx_block_length(*parms[1]),
+        [&coefs, &s](ysfx_real *d, uint32_t n, int64_t) {
+            ysfx::block_biquad(d, n, coefs, s);
+        });
+
+    ysfx_eel_ram_writer sw{vm, state};
+    for (ysfx_real v : s)
+        sw.write_next(v);
+    return *parms[0];
+}
+
+static EEL_F NSEEL_CGEN_CALL ysfx_api_mem_abs_max(void *opaque, EEL_F *src_, EEL_F *len_)
+{
+    ysfx_t *fx = (ysfx_t *)opaque;
+    ysfx_real max = 0;
+    ysfx_block_walk_src(
+        fx->vm.get(), ysfx_eel_round<int64_t>(*src_), ysfx_block_length(*len_),
+        [&max](const ysfx_real *s, uint32_t n) {
+            max = ysfx::block_abs_max(s, n, max);
+        });
+    return max;
+}
+
+static EEL_F NSEEL_CGEN_CALL ysfx_api_mem_rms(void *opaque, EEL_F *src_, EEL_F *len_)
+{
+    ysfx_t *fx = (ysfx_t *)opaque;
+    int64_t len = ysfx_block_length(*len_);
+    if (len <= 0)
+        return 0;
+    ysfx_real sum = 0;
+    ysfx_block_walk_src(
+        fx->vm.get(), ysfx_eel_round<int64_t>(*src_), len,
+        [&sum](const ysfx_real *s, uint32_t n) {
+            sum += ysfx::block_sum_squares(s, n);
+        });
+    return std::sqrt(sum / (ysfx_real)len);
+}
+
+//------------------------------------------------------------------------------
+// atomics: hardware operations on the 8-byte slots of the VM, so that the
+//   audio thread does not take a mutex to talk with @gfx
+
+#if defined(__GNUC__) && defined(__GCC_ATOMIC_LLONG_LOCK_FREE) && __GCC_ATOMIC_LLONG_LOCK_FREE == 2
+#   define YSFX_ATOMIC_GNU 1
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86) || defined(_M_ARM64))
+#   define YSFX_ATOMIC_MSVC 1
+#   include <intrin.h>
+#endif
+
+static ysfx::mutex &ysfx_atomic_mutex(void *opaque)
+{
+    return opaque ? ((ysfx_t *)opaque)->atomic_mutex : atomic_mutex;
+}
+
+// whether the slot can be accessed lock-free; otherwise, the mutex is used
+static bool ysfx_atomic_slot_ok(const EEL_F *p)
+{
+#if defined(YSFX_ATOMIC_GNU) || defined(YSFX_ATOMIC_MSVC)
+    return sizeof(EEL_F) == 8 && ((uintptr_t)p & 7) == 0;
+#else
+    (void)p;
+    return false;
+#endif
+}
+
+#if defined(YSFX_ATOMIC_GNU)
+static EEL_F ysfx_atomic_load(EEL_F *p)
+{
+    EEL_F value;
+    __atomic_load(p, &value, __ATOMIC_SEQ_CST);
+    return value;
+}
+
+static void ysfx_atomic_store(EEL_F *p, EEL_F value)
+{
+    __atomic_store(p, &value, __ATOMIC_SEQ_CST);
+}
+
+static EEL_F ysfx_atomic_exchange(EEL_F *p, EEL_F value)
+{
+    EEL_F old;
+    __atomic_exchange(p, &value, &old, __ATOMIC_SEQ_CST);
+    return old;
+}
+
+// on failure, it updates the expected value with the current one
+static bool ysfx_atomic_cas(EEL_F *p, EEL_F &expected, EEL_F desired)
+{
+    return __atomic_compare_exchange(p, &expected, &desired, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+#elif defined(YSFX_ATOMIC_MSVC)
+static __int64 ysfx_atomic_bits(EEL_F x)
+{
+    __int64 u;
+    memcpy(&u, &x, 8);
+    return u;
+}
+
+static EEL_F ysfx_atomic_real(__int64 u)
+{
+    EEL_F x;
+    memcpy(&x, &u, 8);
+    return x;
+}
+
+static bool ysfx_atomic_cas(EEL_F *p, EEL_F &expected, EEL_F desired)
+{
+    __int64 cmp = ysfx_atomic_bits(expected);
+    __int64 old = _InterlockedCompareExchange64((volatile __int64 *)p, ysfx_atomic_bits(desired), cmp);
+    expected = ysfx_atomic_real(old);
+    return old == cmp;
+}
+
+// 32-bit x86 has no plain 8-byte load; a compare-exchange by 0 stores back what it finds
+static EEL_F ysfx_atomic_load(EEL_F *p)
+{
+    return ysfx_atomic_real(_InterlockedCompareExchange64((volatile __int64 *)p, 0, 0));
+}
+
+static EEL_F ysfx_atomic_exchange(EEL_F *p, EEL_F value)
+{
+    EEL_F old = ysfx_atomic_load(p);
+    while (!ysfx_atomic_cas(p, old, value));
+    return old;
+}
+
+static void ysfx_atomic_store(EEL_F *p, EEL_F value)
+{
+    ysfx_atomic_exchange(p, value);
+}
+#else
+static EEL_F ysfx_atomic_load(EEL_F *p) { return *p; }
+static void ysfx_atomic_store(EEL_F *p, EEL_F value) { *p = value; }
+static EEL_F ysfx_atomic_exchange(EEL_F *p, EEL_F value) { EEL_F old = *p; *p = value; return old; }
+static bool ysfx_atomic_cas(EEL_F *p, EEL_F &expected, EEL_F desired)
+{
+    if (memcmp(p, &expected, sizeof(EEL_F)) != 0) {
+        expected = *p;
+        return false;
+    }
+    *p = desired;
+    return true;
+}
+#endif
+
+static EEL_F NSEEL_CGEN_CALL ysfx_api_atomic_setifequal(void *opaque, EEL_F *a, EEL_F *cmp, EEL_F *nd)
+{
+    if (!ysfx_atomic_slot_ok(a)) {
+        std::lock_guard<ysfx::mutex> lock(ysfx_atomic_mutex(opaque));
+        EEL_F ret = *a;
+        if (std::fabs(ret - *cmp) < NSEEL_CLOSEFACTOR)
+            *a = *nd;
+        return ret;
+    }
+
+    const EEL_F c = *cmp;
+    const EEL_F d = *nd;
+    EEL_F ret = ysfx_atomic_load(a);
+    while (std::fabs(ret - c) < NSEEL_CLOSEFACTOR && !ysfx_atomic_cas(a, ret, d));
+    return ret;
+}
+
+// the swap of two slots cannot be a single hardware operation; the mutex
+//   orders it against other exchanges, and each slot is still accessed
+//   atomically, so that the lock-free operations never see a torn value
+static EEL_F NSEEL_CGEN_CALL ysfx_api_atomic_exch(void *opaque, EEL_F *a, EEL_F *b)
+{
+    std::lock_guard<ysfx::mutex> lock(ysfx_atomic_mutex(opaque));
+    if (!ysfx_atomic_slot_ok(a) || !ysfx_atomic_slot_ok(b)) {
+        EEL_F tmp = *b;
+        *b = *a;
+        *a = tmp;
+        return tmp;
+    }
+    EEL_F tmp = ysfx_atomic_exchange(b, ysfx_atomic_load(a));
+    ysfx_atomic_store(a, tmp);
+    return tmp;
+}
+
+static EEL_F NSEEL_CGEN_CALL ysfx_api_atomic_add(void *opaque, EEL_F *a, EEL_F *b)
+{
+    if (!ysfx_atomic_slot_ok(a)) {
+        std::lock_guard<ysfx::mutex> lock(ysfx_atomic_mutex(opaque));
+        return *a += *b;
+    }
+
+    const EEL_F inc = *b;
+    EEL_F old = ysfx_atomic_load(a);
+    while (!ysfx_atomic_cas(a, old, old + inc));
+    return old + inc;
+}
+
+static EEL_F NSEEL_CGEN_CALL ysfx_api_atomic_set(void *opaque, EEL_F *a, EEL_F *b)
+{
+    if (!ysfx_atomic_slot_ok(a)) {
+        std::lock_guard<ysfx::mutex> lock(ysfx_atomic_mutex(opaque));
+        return *a = *b;
+    }
+
+    const EEL_F value = *b;
+    ysfx_atomic_store(a, value);
+    return value;
+}
+
+static EEL_F NSEEL_CGEN_CALL ysfx_api_atomic_get(void *opaque, EEL_F *a)
+{
+    if (!ysfx_atomic_slot_ok(a)) {
+        std::lock_guard<ysfx::mutex> lock(ysfx_atomic_mutex(opaque));
+        return *a;
+    }
+
+    return ysfx_atomic_load(a);
+}
+
+//------------------------------------------------------------------------------
+// the probe which `ysfx_compile_profile_lines` inserts before the statements
+static EEL_F NSEEL_CGEN_CALL ysfx_api_line_probe(void *opaque, EEL_F *probe_)
+{
+    ysfx_t *fx = (ysfx_t *)opaque;
+    uint32_t slot = (ysfx_get_thread_id() == ysfx_thread_id_gfx) ? ysfx_line_probe_gfx : ysfx_line_probe_dsp;
+    fx->profile.line[slot].store((uint32_t)*probe_, std::memory_order_relaxed);
+    return *probe_;
+}
+
+static EEL_F NSEEL_CGEN_CALL ysfx_api_sample_loop_count(void *opaque, EEL_F *)
+{
+    ysfx_t *fx = (ysfx_t *)opaque;
+    return (EEL_F)ysfx_sample_loop_count(fx);
+}
+
+static EEL_F NSEEL_CGEN_CALL ysfx_api_sample_loop_step(void *opaque, EEL_F *)
+{
+    ysfx_t *fx = (ysfx_t *)opaque;
+    ysfx_sample_loop_step(fx);
+    return 0;
+}
 
 //------------------------------------------------------------------------------
 void ysfx_api_init_eel()
@@ -56,7 +620,29 @@ void ysfx_api_init_eel()
     EEL_mdct_register();
     EEL_string_register();
     EEL_misc_register();
-    EEL_atomic_register();
+    EEL_eval_register();
+
+    // registered last, these are found first
+    NSEEL_addfunc_varparm("match", 2, NSEEL_PProc_THIS, &ysfx_api_match);
+    NSEEL_addfunc_varparm("matchi", 2, NSEEL_PProc_THIS, &ysfx_api_matchi);
+
+    NSEEL_addfunc_retval("atomic_setifequal", 3, NSEEL_PProc_THIS, &ysfx_api_atomic_setifequal);
+    NSEEL_addfunc_retval("atomic_exch", 2, NSEEL_PProc_THIS, &ysfx_api_atomic_exch);
+    NSEEL_addfunc_retval("atomic_add", 2, NSEEL_PProc_THIS, &ysfx_api_atomic_add);
+    NSEEL_addfunc_retval("atomic_set", 2, NSEEL_PProc_THIS, &ysfx_api_atomic_set);
+    NSEEL_addfunc_retval("atomic_get", 1, NSEEL_PProc_THIS, &ysfx_api_atomic_get);
+
+    NSEEL_addfunc_retval("__ysfx_line", 1, NSEEL_PProc_THIS, &ysfx_api_line_probe);
+    NSEEL_addfunc_retval("__ysfx_frames", 1, NSEEL_PProc_THIS, &ysfx_api_sample_loop_count);
+    NSEEL_addfunc_retval("__ysfx_frame", 1, NSEEL_PProc_THIS, &ysfx_api_sample_loop_step);
+
+    NSEEL_addfunc_retval("mem_mul", 3, NSEEL_PProc_THIS, &ysfx_api_mem_mul);
+    NSEEL_addfunc_exparms("mem_add_scaled", 4, NSEEL_PProc_THIS, &ysfx_api_mem_add_scaled);
+    NSEEL_addfunc_exparms("mem_ramp", 4, NSEEL_PProc_THIS, &ysfx_api_mem_ramp);
+    NSEEL_addfunc_exparms("mem_fir", 5, NSEEL_PProc_THIS, &ysfx_api_mem_fir);
+    NSEEL_addfunc_exparms("mem_biquad", 4, NSEEL_PProc_THIS, &ysfx_api_mem_biquad);
+    NSEEL_addfunc_retval("mem_abs_max", 2, NSEEL_PProc_THIS, &ysfx_api_mem_abs_max);
+    NSEEL_addfunc_retval("mem_rms", 2, NSEEL_PProc_THIS, &ysfx_api_mem_rms);
 }
 
 //------------------------------------------------------------------------------
@@ -81,6 +667,69 @@ void ysfx_eel_string_context_update_named_vars(eel_string_context_state *state,
     state->update_named_vars(vm);
 }
 
+// copy the mutable strings; the literals are not copied, and the named strings are matched by name
+void ysfx_eel_string_context_copy(eel_string_context_state *dst, eel_string_context_state *src)
+{
+    for (int i = 0; i < EEL_STRING_MAX_USER_STRINGS; ++i) {
+        WDL_FastString *str = src->m_user_strings[i];
+        if (str) {
+            if (!dst->m_user_strings[i])
+                dst->m_user_strings[i] = new WDL_FastString;
+            dst->m_user_strings[i]->Set(str);
+        }
+        else if (dst->m_user_strings[i])
+            dst->m_user_strings[i]->Set("");
+    }
+
+    for (int i = 0, n = src->m_unnamed_strings.GetSize(); i < n; ++i) {
+        WDL_FastString *str = src->m_unnamed_strings.Get(i);
+        if (i < dst->m_unnamed_strings.GetSize())
+            dst->m_unnamed_strings.Get(i)->Set(str);
+        else
+            dst->m_unnamed_strings.Add(new WDL_FastString(str));
+    }
+
+    for (int i = 0, n = src->m_named_strings_names.GetSize(); i < n; ++i) {
+        const char *name = nullptr;
+        int src_index = src->m_named_strings_names.Enumerate(i, &name);
+        WDL_FastString *str = src->m_named_strings.Get(src_index - EEL_STRING_NAMED_BASE);
+        if (!str)
+            continue;
+        int dst_index = dst->m_named_strings_names.Get(name);
+        if (dst_index)
+            dst->m_named_strings.Get(dst_index - EEL_STRING_NAMED_BASE)->Set(str);
+        else {
+            dst_index = dst->m_named_strings.GetSize() + EEL_STRING_NAMED_BASE;
+            dst->m_named_strings.Add(new WDL_FastString(str));
+            dst->m_named_strings_names.Insert(name, dst_index);
+        }
+    }
+}
+
+void ysfx_eel_string_context_measure(eel_string_context_state *ctx, uint32_t *count, uint64_t *bytes)
+{
+    uint32_t n = 0;
+    uint64_t size = 0;
+    auto add = [&n, &size](const WDL_FastString *str) {
+        if (str) {
+            ++n;
+            size += (uint64_t)str->GetLength();
+        }
+    };
+
+    for (int i = 0; i < EEL_STRING_MAX_USER_STRINGS; ++i)
+        add(ctx->m_user_strings[i]);
+    for (int i = 0, m = ctx->m_literal_strings.GetSize(); i < m; ++i)
+        add(ctx->m_literal_strings.Get(i));
+    for (int i = 0, m = ctx->m_unnamed_strings.GetSize(); i < m; ++i)
+        add(ctx->m_unnamed_strings.Get(i));
+    for (int i = 0, m = ctx->m_named_strings.GetSize(); i < m; ++i)
+        add(ctx->m_named_strings.Get(i));
+
+    *count = n;
+    *bytes = size;
+}
+
 //------------------------------------------------------------------------------
 static_assert(
     ysfx_string_max_length == EEL_STRING_MAXUSERSTRING_LENGTH_HINT,
@@ -141,17 +790,71 @@ void ysfx_image_unlock(ysfx_t *fx)
 
 const char *ysfx_string_access_unlocked(ysfx_t *fx, ysfx_real id, WDL_FastString **fs, bool for_write)
 {
-    return fx->string_ctx->GetStringForIndex(id, fs, for_write);
+    eel_string_context_state *ctx = fx->string_ctx.get();
+
+    // a user string is created at its first access for writing, which can be
+    // on the audio thread: give it one of the spares instead of allocating
+    if (fs) {
+        int idx = (int)(id + 0.5);
+        auto &spare = fx->string_pool.spare;
+        if (idx >= 0 && idx < EEL_STRING_MAX_USER_STRINGS && !ctx->m_user_strings[idx] && !spare.empty()) {
+            ctx->m_user_strings[idx] = spare.back().release();
+            spare.pop_back();
+        }
+    }
+
+    return ctx->GetStringForIndex(id, fs, for_write);
+}
+
+// allocate the buffer of a string now, keeping its text; the buffer never
+//   shrinks, so the writes up to this capacity do not allocate
+static void ysfx_string_reserve(WDL_FastString &str, int capacity)
+{
+    int length = str.GetLength();
+    if (length >= capacity - 1)
+        return;
+    str.SetLen(capacity - 1);
+    str.SetLen(length);
+}
+
+void ysfx_string_pool_refill(ysfx_t *fx)
+{
+    ysfx_string_scoped_lock lock{fx};
+
+    auto &spare = fx->string_pool.spare;
+    spare.reserve(ysfx_string_pool_size);
+    while (spare.size() < ysfx_string_pool_size) {
+        WDL_FastString *str = new WDL_FastString;
+        ysfx_string_reserve(*str, ysfx_string_pool_capacity);
+        spare.emplace_back(str);
+    }
+
+    // the strings `#name` and `#` are created by the compiler without a buffer,
+    // which their first write would allocate, maybe on the audio thread
+    eel_string_context_state *ctx = fx->string_ctx.get();
+    for (int i = 0, n = ctx->m_named_strings.GetSize(); i < n; ++i)
+        ysfx_string_reserve(*ctx->m_named_strings.Get(i), ysfx_string_pool_capacity);
+    for (int i = 0, n = ctx->m_unnamed_strings.GetSize(); i < n; ++i)
+        ysfx_string_reserve(*ctx->m_unnamed_strings.Get(i), ysfx_string_pool_capacity);
+    for (WDL_FastString *str : ctx->m_user_strings) {
+        if (str)
+            ysfx_string_reserve(*str, ysfx_string_pool_capacity);
+    }
 }
 
 //------------------------------------------------------------------------------
-// NOTE(jpc) implement this? I guess probably not.
-//     DSP and UI should not mutex each other.
+// EEL2 takes this mutex only to allocate blocks of RAM; it's needed because
+// the blocks of a named gmem are allocated by instances on different threads.
+//     Accesses to allocated memory don't take it, DSP and UI don't mutex each other.
+
+static ysfx::mutex ram_alloc_mutex;
 
 void NSEEL_HOSTSTUB_EnterMutex()
 {
+    ram_alloc_mutex.lock();
 }
 
 void NSEEL_HOSTSTUB_LeaveMutex()
 {
+    ram_alloc_mutex.unlock();
 }
@@ -36,10 +36,14 @@ class eel_string_context_state;
 eel_string_context_state *ysfx_eel_string_context_new();
 void ysfx_eel_string_context_free(eel_string_context_state *state);
 void ysfx_eel_string_context_update_named_vars(eel_string_context_state *state, NSEEL_VMCTX vm);
+void ysfx_eel_string_context_copy(eel_string_context_state *dst, eel_string_context_state *src);
+void ysfx_eel_string_context_measure(eel_string_context_state *ctx, uint32_t *count, uint64_t *bytes);
 YSFX_DEFINE_AUTO_PTR(eel_string_context_state_u, eel_string_context_state, ysfx_eel_string_context_free);
 
 //------------------------------------------------------------------------------
 enum { ysfx_string_max_length = 1 << 16 };
+// number of spare user strings, and the capacity of each
+enum { ysfx_string_pool_size = 32, ysfx_string_pool_capacity = 256 };
 bool ysfx_string_access(ysfx_t *fx, ysfx_real id, bool for_write, void (*access)(void *, WDL_FastString &), void *userdata);
 bool ysfx_string_get(ysfx_t *fx, ysfx_real id, std::string &txt);
 bool ysfx_string_set(ysfx_t *fx, ysfx_real id, const std::string &txt);
@@ -48,6 +52,7 @@ void ysfx_string_unlock(ysfx_t *fx);
 void ysfx_image_lock(ysfx_t *fx);
 void ysfx_image_unlock(ysfx_t *fx);
 const char *ysfx_string_access_unlocked(ysfx_t *fx, ysfx_real id, WDL_FastString **fs, bool for_write);
+void ysfx_string_pool_refill(ysfx_t *fx);
 
 struct ysfx_string_scoped_lock {
     ysfx_string_scoped_lock(ysfx_t *fx) : m_fx(fx) { ysfx_string_lock(fx); }
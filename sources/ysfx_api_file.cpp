@@ -21,19 +21,29 @@
 #include "ysfx.hpp"
 #include "ysfx_config.hpp"
 #include "ysfx_api_file.hpp"
+#include "ysfx_package.hpp"
+#include "ysfx_audio_wav.hpp"
 #include "ysfx_eel_utils.hpp"
+#include "ysfx_convert.hpp"
 #include <cstring>
 #include <cstdio>
 #include <cassert>
+#include <algorithm>
 
 ysfx_raw_file_t::ysfx_raw_file_t(NSEEL_VMCTX vm, const char *filename)
-    : m_vm(vm),
-      m_stream(ysfx::fopen_utf8(filename, "rb"))
+    : m_vm(vm)
 {
+    if (!ysfx_package_map_file(filename, m_map) && !m_map.open(filename))
+        m_stream.reset(ysfx::fopen_utf8(filename, "rb"));
 }
 
 int32_t ysfx_raw_file_t::avail()
 {
+    if (m_map.is_open()) {
+        uint64_t f32_count = (m_map.size() - m_pos) / 4;
+        return (f32_count > 0x7fffffff) ? 0x7fffffff : (uint32_t)f32_count;
+    }
+
     if (!m_stream)
         return 0;
 
@@ -61,6 +71,8 @@ int32_t ysfx_raw_file_t::avail()
 
 void ysfx_raw_file_t::rewind()
 {
+    m_pos = 0;
+
     if (!m_stream)
         return;
 
@@ -69,6 +81,14 @@ void ysfx_raw_file_t::rewind()
 
 bool ysfx_raw_file_t::var(ysfx_real *var)
 {
+    if (m_map.is_open()) {
+        if (m_map.size() - m_pos < 4)
+            return false;
+        *var = (EEL_F)ysfx::unpack_f32le(&m_map.data()[m_pos]);
+        m_pos += 4;
+        return true;
+    }
+
     if (!m_stream)
         return false;
 
@@ -82,17 +102,84 @@ bool ysfx_raw_file_t::var(ysfx_real *var)
 
 uint32_t ysfx_raw_file_t::mem(uint32_t offset, uint32_t length)
 {
+    if (m_map.is_open())
+        return mem_mapped(offset, length);
+
     if (!m_stream)
         return 0;
 
-    ysfx_eel_ram_writer writer{m_vm, offset};
+    // read in chunks, and convert them directly into the blocks of memory
+    enum { chunk_size = 1024 };
+    uint8_t data[4 * chunk_size];
+    float values[chunk_size];
+
+    uint32_t read = 0;
+    while (read < length) {
+        uint64_t addr = (uint64_t)offset + read;
+        int32_t valid = 0;
+        EEL_F *dest = (addr < UINT32_MAX) ? NSEEL_VM_getramptr(m_vm, (uint32_t)addr, &valid) : nullptr;
+        if (valid <= 0)
+            dest = nullptr;
+
+        uint32_t count = length - read;
+        if (count > chunk_size)
+            count = chunk_size;
+        if (dest && count > (uint32_t)valid)
+            count = (uint32_t)valid;
+
+        uint32_t got = (uint32_t)fread(data, 4, count, m_stream.get());
+        // the values which do not fit in memory are read and dropped
+        if (dest) {
+            if (ysfx::is_little_endian())
+                memcpy(values, data, 4 * got);
+            else {
+                for (uint32_t i = 0; i < got; ++i)
+                    values[i] = ysfx::unpack_f32le(&data[4 * i]);
+            }
+            ysfx::convert_in(values, dest, got, 0);
+        }
 
-    uint32_t read;
-    for (read = 0; read < length; ++read) {
-        ysfx_real value;
-        if (!var(&value))
+        read += got;
+        if (got < count)
             break;
-        writer.write_next(value);
+    }
+
+    return read;
+}
+
+uint32_t ysfx_raw_file_t::mem_mapped(uint32_t offset, uint32_t length)
+{
+    const uint8_t *data = m_map.data();
+    const bool direct = ysfx::is_little_endian();
+
+    // convert from the mapping directly into the blocks of memory
+    uint32_t read = 0;
+    while (read < length) {
+        uint64_t addr = (uint64_t)offset + read;
+        int32_t valid = 0;
+        EEL_F *dest = (addr < UINT32_MAX) ? NSEEL_VM_getramptr(m_vm, (uint32_t)addr, &valid) : nullptr;
+        if (valid <= 0)
+            dest = nullptr;
+
+        uint64_t count = std::min<uint64_t>(length - read, (m_map.size() - m_pos) / 4);
+        if (count == 0)
+            break;
+        if (dest && count > (uint32_t)valid)
+            count = (uint32_t)valid;
+
+        // the values which do not fit in memory are read and dropped
+        if (dest) {
+            const uint8_t *src = &data[m_pos];
+            if (direct && (uintptr_t)src % alignof(float) == 0)
+                ysfx::convert_in((const float *)src, dest, (uint32_t)count, 0);
+            else {
+                for (uint32_t i = 0; i < count; ++i)
+                    dest[i] = (EEL_F)ysfx::unpack_f32le(&src[4 * i]);
+            }
+        }
+
+        m_pos += 4 * (size_t)count;
+        read += (uint32_t)count;
     }
 
     return read;
@@ -100,6 +187,17 @@ uint32_t ysfx_raw_file_t::mem(uint32_t offset, uint32_t length)
 
 uint32_t ysfx_raw_file_t::string(std::string &str)
 {
+    if (m_map.is_open()) {
+        if (m_map.size() - m_pos < 4)
+            return 0;
+        uint32_t srclen = ysfx::unpack_u32le(&m_map.data()[m_pos]);
+        m_pos += 4;
+        uint32_t count = (uint32_t)std::min<uint64_t>(srclen, m_map.size() - m_pos);
+        str.assign((const char *)&m_map.data()[m_pos], std::min<uint32_t>(count, ysfx_string_max_length));
+        m_pos += count;
+        return count;
+    }
+
     if (!m_stream)
         return 0;
 
@@ -123,14 +221,18 @@ uint32_t ysfx_raw_file_t::string(std::string &str)
 
 //------------------------------------------------------------------------------
 ysfx_text_file_t::ysfx_text_file_t(NSEEL_VMCTX vm, const char *filename)
-    : m_vm(vm),
-      m_stream(ysfx::fopen_utf8(filename, "rb"))
+    : m_vm(vm)
 {
+    if (!ysfx_package_map_file(filename, m_map) && !m_map.open(filename))
+        m_stream.reset(ysfx::fopen_utf8(filename, "rb"));
     m_buf.reserve(256);
 }
 
 int32_t ysfx_text_file_t::avail()
 {
+    if (m_map.is_open())
+        return m_eof ? 0 : 1;
+
     if (!m_stream || ferror(m_stream.get()))
         return -1;
 
@@ -139,6 +241,9 @@ int32_t ysfx_text_file_t::avail()
 
 void ysfx_text_file_t::rewind()
 {
+    m_pos = 0;
+    m_eof = false;
+
     if (!m_stream)
         return;
 
@@ -147,6 +252,9 @@ void ysfx_text_file_t::rewind()
 
 bool ysfx_text_file_t::var(ysfx_real *var)
 {
+    if (m_map.is_open())
+        return var_mapped(var);
+
     if (!m_stream)
         return false;
 
@@ -171,9 +279,33 @@ bool ysfx_text_file_t::var(ysfx_real *var)
     return false;
 }
 
+bool ysfx_text_file_t::var_mapped(ysfx_real *var)
+{
+    const char *text = (const char *)m_map.data();
+    const size_t size = m_map.size();
+
+    // get the next number separated by newline or comma, like the stream
+    while (!m_eof) {
+        size_t start = m_pos;
+        size_t end = start;
+        while (end < size && text[end] != '\n' && text[end] != ',')
+            ++end;
+        m_eof = end == size;
+        m_pos = m_eof ? size : (end + 1);
+
+        double value;
+        if (ysfx::dot_parse_number(&text[start], &text[end], value) != &text[start]) {
+            *var = (EEL_F)value;
+            return true;
+        }
+    }
+
+    return false;
+}
+
 uint32_t ysfx_text_file_t::mem(uint32_t offset, uint32_t length)
 {
-    if (!m_stream)
+    if (!m_stream && !m_map.is_open())
         return 0;
 
     ysfx_eel_ram_writer writer{m_vm, offset};
@@ -191,6 +323,17 @@ uint32_t ysfx_text_file_t::mem(uint32_t offset, uint32_t length)
 
 uint32_t ysfx_text_file_t::string(std::string &str)
 {
+    if (m_map.is_open()) {
+        const char *text = (const char *)m_map.data();
+        const size_t size = m_map.size();
+        size_t end = m_pos;
+        while (end < size && text[end++] != '\n');
+        m_eof = m_eof || (end == size && (end == m_pos || text[end - 1] != '\n'));
+        str.assign(&text[m_pos], std::min<size_t>(end - m_pos, ysfx_string_max_length));
+        m_pos = end;
+        return (uint32_t)str.size();
+    }
+
     if (!m_stream)
         return 0;
 
@@ -208,55 +351,186 @@ uint32_t ysfx_text_file_t::string(std::string &str)
 }
 
 //------------------------------------------------------------------------------
-ysfx_audio_file_t::ysfx_audio_file_t(NSEEL_VMCTX vm, const ysfx_audio_format_t &fmt, const char *filename)
+ysfx_audio_file_t::ysfx_audio_file_t(NSEEL_VMCTX vm, const ysfx_audio_format_t &fmt, const char *filename, ysfx_real read_ahead, ysfx_audio_cache_t *cache, ysfx_real sample_rate)
     : m_vm(vm),
       m_fmt(fmt),
-      m_reader(fmt.open(filename), fmt.close)
+      m_reader(nullptr, fmt.close)
+{
+    if (cache)
+        m_decoded = ysfx_audio_cache_get(*cache, fmt, filename);
+    if (m_decoded)
+        m_info = m_decoded->info;
+    else {
+        m_reader.reset(fmt.open(filename));
+        if (!m_reader)
+            return;
+
+        m_info = fmt.info(m_reader.get());
+
+        if (read_ahead > 0) {
+            ysfx_real capacity = read_ahead * m_info.sample_rate * m_info.channels;
+            capacity = std::min<ysfx_real>(capacity, (ysfx_real)(1u << 28));
+            m_stream.reset(new ysfx_audio_stream_t(m_fmt, m_reader.get(), (uint32_t)capacity));
+        }
+    }
+
+    if (sample_rate > 0 && m_info.sample_rate > 0 && m_info.channels > 0 && sample_rate != m_info.sample_rate) {
+        m_resampler.reset(new ysfx_resampler_t);
+        m_resampler->setup(m_info.channels, m_info.sample_rate, sample_rate);
+        m_resampler_in.resize((size_t)(buffer_size / m_info.channels + 1) * m_info.channels);
+        m_resampler_out.resize(m_info.channels);
+        m_info.sample_rate = sample_rate;
+    }
+}
+
+uint64_t ysfx_audio_file_t::read(ysfx_real *samples, uint64_t count)
+{
+    if (m_resampler)
+        return read_resampled(samples, count);
+    return read_source(samples, count);
+}
+
+uint64_t ysfx_audio_file_t::read_resampled(ysfx_real *samples, uint64_t count)
+{
+    ysfx_resampler_t &resampler = *m_resampler;
+    const uint32_t channels = m_info.channels;
+    uint64_t readtotal = 0;
+
+    while (count > 0) {
+        // the rest of a frame which was read partially
+        if (m_resampler_pending > 0) {
+            uint32_t n = (uint32_t)std::min<uint64_t>(m_resampler_pending, count);
+            std::copy_n(&m_resampler_out[channels - m_resampler_pending], n, samples);
+            m_resampler_pending -= n;
+            samples += n;
+            count -= n;
+            readtotal += n;
+            continue;
+        }
+
+        // whole frames go directly to the destination, a last partial one goes to the side
+        uint64_t wanted = count / channels;
+        bool partial = wanted == 0;
+        uint32_t frames = partial ? 1 : (uint32_t)std::min<uint64_t>(wanted, 0x7fffffff);
+
+        for (uint64_t needed = resampler.input_needed(frames); needed > 0 && !resampler.finished(); ) {
+            uint64_t want = std::min<uint64_t>(needed, m_resampler_in.size() / channels) * channels;
+            uint64_t got = read_source(m_resampler_in.data(), want);
+            resampler.write(m_resampler_in.data(), (uint32_t)(got / channels));
+            needed -= std::min(needed, got / channels);
+            if (got < want)
+                resampler.finish();
+        }
+
+        if (partial) {
+            if (resampler.read(m_resampler_out.data(), 1) == 0)
+                break;
+            m_resampler_pending = channels;
+            continue;
+        }
+
+        uint32_t got = resampler.read(samples, frames);
+        if (got == 0)
+            break;
+        samples += (uint64_t)got * channels;
+        count -= (uint64_t)got * channels;
+        readtotal += (uint64_t)got * channels;
+    }
+
+    return readtotal;
+}
+
+uint64_t ysfx_audio_file_t::read_source(ysfx_real *samples, uint64_t count)
 {
+    if (m_decoded) {
+        const std::vector<ysfx_real> &decoded = m_decoded->samples;
+        uint64_t n = std::min<uint64_t>(count, decoded.size() - m_decoded_pos);
+        std::copy_n(&decoded[(size_t)m_decoded_pos], (size_t)n, samples);
+        m_decoded_pos += n;
+        return n;
+    }
+    if (m_stream)
+        return m_stream->read(samples, count);
+    return m_fmt.read(m_reader.get(), samples, count);
+}
+
+uint64_t ysfx_audio_file_t::avail_source()
+{
+    if (m_decoded)
+        return m_decoded->samples.size() - m_decoded_pos;
+    return m_stream ? m_stream->avail() : m_fmt.avail(m_reader.get());
 }
 
 int32_t ysfx_audio_file_t::avail()
 {
-    if (!m_reader)
+    if (!m_reader && !m_decoded)
         return -1;
 
-    uint64_t avail = m_fmt.avail(m_reader.get());
+    uint64_t avail;
+    if (!m_resampler)
+        avail = avail_source();
+    else {
+        // the frames which the rest of the source will produce
+        const uint32_t channels = m_info.channels;
+        uint64_t more = m_resampler->finished() ? 0 : (avail_source() / channels);
+        uint64_t total = m_resampler->output_total(more);
+        uint64_t done = m_resampler->output_read();
+        avail = m_resampler_pending + channels * ((total > done) ? (total - done) : 0);
+    }
     return (avail > 0x7fffffff) ? 0x7fffffff : (int32_t)avail;
 }
 
 void ysfx_audio_file_t::rewind()
 {
-    if (!m_reader)
-        return;
+    if (m_resampler) {
+        m_resampler->clear();
+        m_resampler_pending = 0;
+    }
 
-    m_fmt.rewind(m_reader.get());
+    if (m_decoded)
+        m_decoded_pos = 0;
+    else if (!m_reader)
+        return;
+    else if (m_stream)
+        m_stream->rewind();
+    else
+        m_fmt.rewind(m_reader.get());
 }
 
 bool ysfx_audio_file_t::var(ysfx_real *var)
 {
-    if (!m_reader)
+    if (!m_reader && !m_decoded)
         return false;
 
-    return m_fmt.read(m_reader.get(), var, 1) == 1;
+    return read(var, 1) == 1;
 }
 
 uint32_t ysfx_audio_file_t::mem(uint32_t offset, uint32_t length)
 {
-    if (!m_reader)
+    if (!m_reader && !m_decoded)
         return 0;
 
     uint32_t numread = 0;
-    ysfx_real *buf = m_buf.get();
-    ysfx_eel_ram_writer writer(m_vm, offset);
 
+    // decode straight into the blocks of memory, as far as each one goes
     while (numread < length) {
         uint32_t n = length - numread;
-        if (n > buffer_size)
-            n = buffer_size;
 
-        uint32_t m = (uint32_t)m_fmt.read(m_reader.get(), buf, n);
-        for (uint32_t i = 0; i < m; ++i)
-            writer.write_next(buf[i]);
+        int32_t valid = 0;
+        uint64_t addr = (uint64_t)offset + numread;
+        ysfx_real *dst = (addr > 0xFFFFFFFFu) ? nullptr : NSEEL_VM_getramptr(m_vm, (uint32_t)addr, &valid);
+        if (dst && valid > 0) {
+            if (n > (uint32_t)valid)
+                n = (uint32_t)valid;
+        }
+        else {
+            // past the memory, the samples are consumed and discarded
+            dst = m_buf.get();
+            if (n > buffer_size)
+                n = buffer_size;
+        }
+
+        uint32_t m = (uint32_t)read(dst, n);
 
         numread += m;
         if (m < n)
@@ -274,12 +548,147 @@ uint32_t ysfx_audio_file_t::string(std::string &str)
 
 bool ysfx_audio_file_t::riff(uint32_t &nch, ysfx_real &samplerate)
 {
-    if (!m_reader)
+    if (!m_reader && !m_decoded)
         return false;
 
-    ysfx_audio_file_info_t info = m_fmt.info(m_reader.get());
-    nch = info.channels;
-    samplerate = info.sample_rate;
+    nch = m_info.channels;
+    samplerate = m_info.sample_rate;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+ysfx_write_file_t::ysfx_write_file_t(NSEEL_VMCTX vm, const char *filename, kind_t kind, uint32_t channels, ysfx_real sample_rate, uint32_t capacity)
+    : m_vm(vm),
+      m_path(filename),
+      m_kind(kind),
+      m_channels(channels),
+      m_sample_rate(sample_rate),
+      m_buf(new uint8_t[buffer_size])
+{
+    m_writer.reset(new ysfx_file_writer_t([this]() { return open_sink(); }, capacity));
+}
+
+ysfx_file_sink_t *ysfx_write_file_t::open_sink()
+{
+    // NOTE: called on the thread of the writer, once the format is fixed
+    if (m_kind == kind_wav)
+        return ysfx_wav_sink_open(m_path.c_str(), m_channels, m_sample_rate);
+    return ysfx_stdio_sink_open(m_path.c_str());
+}
+
+// format a number like `dot_strtod` reads it, whatever the locale
+static uint32_t ysfx_format_number(ysfx_real value, char *text, uint32_t size)
+{
+    int len = snprintf(text, size, "%.17g", value);
+    if (len <= 0 || (uint32_t)len >= size)
+        return 0;
+    for (int i = 0; i < len; ++i) {
+        if (text[i] == ',')
+            text[i] = '.';
+    }
+    return (uint32_t)len;
+}
+
+bool ysfx_write_file_t::write_values(const ysfx_real *values, uint32_t count)
+{
+    m_started = true;
+    uint8_t *buf = m_buf.get();
+    bool ok = true;
+
+    if (m_kind != kind_text) {
+        while (count > 0) {
+            uint32_t n = std::min<uint32_t>(count, buffer_size / 4);
+            for (uint32_t i = 0; i < n; ++i)
+                ysfx::pack_f32le((float)values[i], &buf[4 * i]);
+            ok = m_writer->write(buf, 4 * n) && ok;
+            values += n;
+            count -= n;
+        }
+    }
+    else {
+        // one number per line, in pieces which fit the buffer
+        uint32_t len = 0;
+        for (uint32_t i = 0; i < count; ++i) {
+            if (buffer_size - len < 32) {
+                ok = m_writer->write(buf, len) && ok;
+                len = 0;
+            }
+            uint32_t n = ysfx_format_number(values[i], (char *)&buf[len], 31);
+            buf[len + n] = '\n';
+            len += n + 1;
+        }
+        if (len > 0)
+            ok = m_writer->write(buf, len) && ok;
+    }
+
+    return ok;
+}
+
+bool ysfx_write_file_t::var(ysfx_real *var)
+{
+    return write_values(var, 1);
+}
+
+uint32_t ysfx_write_file_t::mem(uint32_t offset, uint32_t length)
+{
+    uint32_t numwritten = 0;
+
+    // write from the blocks of memory, as far as each one goes
+    while (numwritten < length) {
+        uint32_t n = length - numwritten;
+        int32_t valid = 0;
+        uint64_t addr = (uint64_t)offset + numwritten;
+        const ysfx_real *src = (addr > 0xFFFFFFFFu) ? nullptr : NSEEL_VM_getramptr_noalloc(m_vm, (uint32_t)addr, &valid);
+        if (!src || valid <= 0)
+            break;
+        if (n > (uint32_t)valid)
+            n = (uint32_t)valid;
+        write_values(src, n);
+        numwritten += n;
+    }
+
+    return numwritten;
+}
+
+uint32_t ysfx_write_file_t::string(std::string &str)
+{
+    uint32_t len = (uint32_t)std::min<size_t>(str.size(), ysfx_string_max_length);
+
+    switch (m_kind) {
+    case kind_raw: {
+        uint8_t data[4];
+        ysfx::pack_u32le(len, data);
+        if (!m_writer->write(data, 4))
+            return 0;
+        break;
+    }
+    case kind_text:
+        break;
+    default:
+        return 0;
+    }
+
+    m_started = true;
+    if (!m_writer->write(str.data(), len))
+        return 0;
+    if (m_kind == kind_text && (len == 0 || str[len - 1] != '\n'))
+        m_writer->write("\n", 1);
+    return len;
+}
+
+bool ysfx_write_file_t::riff(uint32_t &nch, ysfx_real &samplerate)
+{
+    if (m_kind != kind_wav)
+        return false;
+
+    // the format can change until the first write
+    if (!m_started && nch > 0 && nch <= ysfx_max_channels && samplerate > 0) {
+        m_channels = nch;
+        m_sample_rate = samplerate;
+    }
+
+    nch = m_channels;
+    samplerate = m_sample_rate;
     return true;
 }
 
@@ -289,17 +698,45 @@ ysfx_serializer_t::ysfx_serializer_t(NSEEL_VMCTX vm)
 {
 }
 
-void ysfx_serializer_t::begin(bool write, std::string &buffer)
+void ysfx_serializer_t::begin_read(const uint8_t *data, size_t size, bool f64)
 {
-    m_write = (int)write;
-    m_buffer = &buffer;
+    m_write = 0;
+    m_f64 = f64;
+    m_data = data;
+    m_size = size;
     m_pos = 0;
 }
 
+void ysfx_serializer_t::begin_write(ysfx_serial_buffer_t &buffer, bool f64)
+{
+    m_write = 1;
+    m_f64 = f64;
+    m_out = &buffer;
+    m_overflow = false;
+}
+
 void ysfx_serializer_t::end()
 {
     m_write = -1;
-    m_buffer = nullptr;
+    m_data = nullptr;
+    m_size = 0;
+    m_out = nullptr;
+}
+
+uint8_t *ysfx_serializer_t::reserve(size_t size)
+{
+    ysfx_serial_buffer_t &out = *m_out;
+    if (size > out.capacity - out.size) {
+        // grow geometrically, so that the appends take linear time
+        size_t capacity = std::max(out.size + size, 2 * out.capacity);
+        if (!out.grow || !out.grow(&out, capacity) || size > out.capacity - out.size) {
+            m_overflow = true;
+            return nullptr;
+        }
+    }
+    uint8_t *data = out.data + out.size;
+    out.size += size;
+    return data;
 }
 
 int32_t ysfx_serializer_t::avail()
@@ -307,7 +744,7 @@ int32_t ysfx_serializer_t::avail()
     if (m_write)
         return -1;
     else
-        return (m_buffer->size() > m_pos) ? 1 : 0;
+        return (m_size > m_pos) ? 1 : 0;
 }
 
 void ysfx_serializer_t::rewind()
@@ -316,20 +753,28 @@ void ysfx_serializer_t::rewind()
 
 bool ysfx_serializer_t::var(ysfx_real *var)
 {
+    const uint32_t width = m_f64 ? 8 : 4;
     if (m_write == 1) {
-        uint8_t buf[4];
-        ysfx::pack_f32le((float)*var, buf);
-        m_buffer->append((char *)buf, 4);
+        uint8_t *dst = reserve(width);
+        if (!dst)
+            return false;
+        if (m_f64)
+            ysfx::convert_out_f64le(var, dst, 1);
+        else
+            ysfx::convert_out_f32le(var, dst, 1);
         return true;
     }
     else if (m_write == 0) {
-        if (m_pos + 4 > m_buffer->size()) {
-            m_pos = m_buffer->size();
+        if (m_pos + width > m_size) {
+            m_pos = m_size;
             *var = 0;
             return false;
         }
-        *var = (EEL_F)ysfx::unpack_f32le((uint8_t *)&(*m_buffer)[m_pos]);
-        m_pos += 4;
+        if (m_f64)
+            ysfx::convert_in_f64le(&m_data[m_pos], var, 1);
+        else
+            ysfx::convert_in_f32le(&m_data[m_pos], var, 1);
+        m_pos += width;
         return true;
     }
     return false;
@@ -337,26 +782,63 @@ bool ysfx_serializer_t::var(ysfx_real *var)
 
 uint32_t ysfx_serializer_t::mem(uint32_t offset, uint32_t length)
 {
-    if (m_write == 1) {
-        ysfx_eel_ram_reader reader{m_vm, offset};
-        for (uint32_t i = 0; i < length; ++i) {
-            ysfx_real value = reader.read_next();
-            if (!var(&value))
-                return i;
+    const uint32_t width = m_f64 ? 8 : 4;
+
+    // convert whole spans of memory at once, up to the ends of the blocks
+    uint32_t done = 0;
+    while (done < length) {
+        uint64_t addr = (uint64_t)offset + done;
+        uint32_t count = length - done;
+        uint32_t span = NSEEL_RAM_ITEMSPERBLOCK - (uint32_t)(addr & (NSEEL_RAM_ITEMSPERBLOCK - 1));
+        if (count > span)
+            count = span;
+
+        int32_t valid = 0;
+        EEL_F *ram = nullptr;
+        if (addr < UINT32_MAX) {
+            ram = (m_write == 1) ? NSEEL_VM_getramptr_noalloc(m_vm, (uint32_t)addr, &valid) :
+                NSEEL_VM_getramptr(m_vm, (uint32_t)addr, &valid);
         }
-        return length;
-    }
-    else if (m_write == 0) {
-        ysfx_eel_ram_writer writer{m_vm, offset};
-        for (uint32_t i = 0; i < length; ++i) {
-            ysfx_real value{};
-            if (!var(&value))
-                return i;
-            writer.write_next(value);
+        if (ram && count > (uint32_t)valid)
+            count = (uint32_t)valid;
+
+        if (m_write == 1) {
+            uint8_t *dst = reserve(width * (size_t)count);
+            if (!dst)
+                return done;
+            // the memory which is not allocated reads as zeros
+            if (!ram)
+                memset(dst, 0, width * (size_t)count);
+            else if (m_f64)
+                ysfx::convert_out_f64le(ram, dst, count);
+            else
+                ysfx::convert_out_f32le(ram, dst, count);
         }
-        return length;
+        else if (m_write == 0) {
+            size_t remain = (m_size - m_pos) / width;
+            bool partial = count > remain;
+            if (partial)
+                count = (uint32_t)remain;
+            // the values which do not fit in memory are read and dropped
+            if (ram) {
+                if (m_f64)
+                    ysfx::convert_in_f64le(&m_data[m_pos], ram, count);
+                else
+                    ysfx::convert_in_f32le(&m_data[m_pos], ram, count);
+            }
+            m_pos += width * (size_t)count;
+            if (partial) {
+                m_pos = m_size;
+                return done + count;
+            }
+        }
+        else
+            return 0;
+
+        done += count;
     }
-    return 0;
+
+    return done;
 }
 
 uint32_t ysfx_serializer_t::string(std::string &str)
@@ -367,44 +849,222 @@ uint32_t ysfx_serializer_t::string(std::string &str)
 }
 
 //------------------------------------------------------------------------------
-static EEL_F NSEEL_CGEN_CALL ysfx_api_file_open(void *opaque, EEL_F *file_)
+ysfx_file_t *ysfx_async_file_t::opened()
 {
-    ysfx_t *fx = (ysfx_t *)opaque;
+    if (!m_job->done.load(std::memory_order_acquire))
+        return nullptr;
+    return m_job->file.get();
+}
 
-    std::string filepath;
-    if (!ysfx_find_data_file(fx, file_, filepath))
-        return -1;
+int32_t ysfx_async_file_t::avail()
+{
+    if (!m_job->done.load(std::memory_order_acquire))
+        return pending_avail;
+    ysfx_file_t *file = m_job->file.get();
+    return file ? file->avail() : 0;
+}
+
+void ysfx_async_file_t::rewind()
+{
+    if (ysfx_file_t *file = opened())
+        file->rewind();
+}
+
+bool ysfx_async_file_t::var(ysfx_real *var)
+{
+    ysfx_file_t *file = opened();
+    return file && file->var(var);
+}
+
+uint32_t ysfx_async_file_t::mem(uint32_t offset, uint32_t length)
+{
+    ysfx_file_t *file = opened();
+    return file ? file->mem(offset, length) : 0;
+}
+
+uint32_t ysfx_async_file_t::string(std::string &str)
+{
+    ysfx_file_t *file = opened();
+    return file ? file->string(str) : 0;
+}
+
+bool ysfx_async_file_t::riff(uint32_t &nch, ysfx_real &samplerate)
+{
+    ysfx_file_t *file = opened();
+    return file && file->riff(nch, samplerate);
+}
+
+bool ysfx_async_file_t::is_text()
+{
+    ysfx_file_t *file = opened();
+    return file && file->is_text();
+}
+
+//------------------------------------------------------------------------------
+ysfx_file_opener_t::ysfx_file_opener_t()
+{
+    m_thread = std::thread([this]() { run(); });
+}
 
+ysfx_file_opener_t::~ysfx_file_opener_t()
+{
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_quit = true;
+        m_queue.clear();
+    }
+    m_cond.notify_all();
+    m_thread.join();
+}
+
+void ysfx_file_opener_t::post(std::function<void()> job)
+{
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_queue.push_back(std::move(job));
+    }
+    m_cond.notify_all();
+}
+
+void ysfx_file_opener_t::run()
+{
+    std::unique_lock<std::mutex> lock{m_mutex};
+    for (;;) {
+        m_cond.wait(lock, [this]() -> bool { return m_quit || !m_queue.empty(); });
+        if (m_quit)
+            break;
+        std::function<void()> job = std::move(m_queue.front());
+        m_queue.pop_front();
+        lock.unlock();
+        job();
+        job = nullptr;
+        lock.lock();
+    }
+}
+
+//------------------------------------------------------------------------------
+// find and open a file for reading, with the settings which the effect has for audio files
+static ysfx_file_t *ysfx_open_data_file(ysfx_t *fx, const ysfx_data_file_name_t &name, ysfx_real read_ahead, ysfx_real sample_rate)
+{
+    std::string filepath;
+    ysfx_file_type_t ftype = ysfx_file_type_none;
     void *fmtobj = nullptr;
-    ysfx_file_type_t ftype = ysfx_detect_file_type(fx, filepath.c_str(), &fmtobj);
+    if (!ysfx_resolve_data_file(fx, name, filepath, &ftype, &fmtobj))
+        return nullptr;
 
-    ysfx_file_u file;
     switch (ftype) {
     case ysfx_file_type_txt:
-        file.reset(new ysfx_text_file_t(fx->vm.get(), filepath.c_str()));
-        break;
+        return new ysfx_text_file_t(fx->vm.get(), filepath.c_str());
     case ysfx_file_type_raw:
-        file.reset(new ysfx_raw_file_t(fx->vm.get(), filepath.c_str()));
-        break;
+        return new ysfx_raw_file_t(fx->vm.get(), filepath.c_str());
     case ysfx_file_type_audio:
-        file.reset(new ysfx_audio_file_t(fx->vm.get(), *(ysfx_audio_format_t *)fmtobj, filepath.c_str()));
-        break;
+        return new ysfx_audio_file_t(fx->vm.get(), *(ysfx_audio_format_t *)fmtobj, filepath.c_str(), read_ahead, fx->config->audio_cache.get(), sample_rate);
     case ysfx_file_type_none:
-        file.reset(new ysfx_raw_file_t(fx->vm.get(), filepath.c_str()));
-        break;
+        return new ysfx_raw_file_t(fx->vm.get(), filepath.c_str());
     default:
         assert(false);
+        return nullptr;
+    }
+}
+
+static EEL_F NSEEL_CGEN_CALL ysfx_api_file_open(void *opaque, EEL_F *file_)
+{
+    ysfx_t *fx = (ysfx_t *)opaque;
+
+    ysfx_data_file_name_t name;
+    if (!ysfx_get_data_file_name(fx, file_, name))
+        return -1;
+
+    ysfx_file_u file{ysfx_open_data_file(fx, name, fx->file.read_ahead, fx->file.resample ? fx->sample_rate : 0)};
+    if (!file)
+        return -1;
+
+    int32_t handle = ysfx_insert_file(fx, file.get());
+    if (handle == -1)
+        return -1;
+    (void)file.release();
+    return (EEL_F)(uint32_t)handle;
+}
+
+// the handle is valid at once, and the file opens on the thread of the opener;
+//   an offline render opens it at once, since it may block
+static EEL_F NSEEL_CGEN_CALL ysfx_api_file_open_async(void *opaque, EEL_F *file_)
+{
+    ysfx_t *fx = (ysfx_t *)opaque;
+
+    ysfx_file_opener_t *opener = fx->file.opener.get();
+    if (!opener || fx->transport.info.offline)
+        return ysfx_api_file_open(opaque, file_);
+
+    ysfx_data_file_name_t name;
+    if (!ysfx_get_data_file_name(fx, file_, name))
+        return -1;
+
+    std::shared_ptr<ysfx_async_open_t> job{new ysfx_async_open_t};
+    ysfx_file_u file{new ysfx_async_file_t(job)};
+    int32_t handle = ysfx_insert_file(fx, file.get());
+    if (handle == -1)
+        return -1;
+    (void)file.release();
+
+    ysfx_real read_ahead = fx->file.read_ahead;
+    ysfx_real sample_rate = fx->file.resample ? fx->sample_rate : 0;
+    opener->post([fx, job, name, read_ahead, sample_rate]() {
+        job->file.reset(ysfx_open_data_file(fx, name, read_ahead, sample_rate));
+        job->done.store(true, std::memory_order_release);
+    });
+    return (EEL_F)(uint32_t)handle;
+}
+
+static EEL_F NSEEL_CGEN_CALL ysfx_api_file_open_write(void *opaque, EEL_F *file_)
+{
+    ysfx_t *fx = (ysfx_t *)opaque;
+
+    // a name under the write root, which does not climb out of it
+    const std::string &root = fx->config->write_root;
+    std::string name;
+    if (root.empty())
+        return -1;
+    int32_t index = ysfx_eel_round<int32_t>(*file_);
+    if (index >= 0 && (uint32_t)index < fx->source.main->header.filenames.size())
+        name = fx->source.main->header.filenames[(uint32_t)index];
+    else if (!ysfx_string_get(fx, *file_, name))
+        return -1;
+    if (name.empty() || !ysfx::path_is_relative(name.c_str()))
+        return -1;
+    for (size_t start = 0, end; start <= name.size(); start = end + 1) {
+        end = start;
+        while (end < name.size() && !ysfx::is_path_separator(name[end]))
+            ++end;
+        if (name.compare(start, end - start, "..") == 0)
+            return -1;
     }
 
-    if (file) {
-        int32_t handle = ysfx_insert_file(fx, file.get());
-        if (handle == -1)
+    std::string filepath = root + name;
+
+    ysfx_write_file_t::kind_t kind = ysfx_write_file_t::kind_raw;
+    if (ysfx::path_has_suffix(filepath.c_str(), "txt"))
+        kind = ysfx_write_file_t::kind_text;
+    else if (ysfx::path_has_suffix(filepath.c_str(), "wav"))
+        kind = ysfx_write_file_t::kind_wav;
+
+    // create the file now, to report a failure to the code
+    {
+        ysfx::FILE_u stream{ysfx::fopen_utf8(filepath.c_str(), "wb")};
+        if (!stream)
             return -1;
-        (void)file.release();
-        return (EEL_F)(uint32_t)handle;
     }
 
-    return -1;
+    // a few seconds of stereo at a high rate
+    const uint32_t capacity = 4u << 20;
+    uint32_t channels = (fx->valid_input_channels > 0) ? fx->valid_input_channels : 2;
+    ysfx_file_u file{new ysfx_write_file_t(fx->vm.get(), filepath.c_str(), kind, channels, fx->sample_rate, capacity)};
+
+    int32_t handle = ysfx_insert_file(fx, file.get());
+    if (handle == -1)
+        return -1;
+    (void)file.release();
+    return (EEL_F)(uint32_t)handle;
 }
 
 static EEL_F NSEEL_CGEN_CALL ysfx_api_file_close(void *opaque, EEL_F *handle_)
@@ -414,18 +1074,8 @@ static EEL_F NSEEL_CGEN_CALL ysfx_api_file_close(void *opaque, EEL_F *handle_)
         return -1;
 
     ysfx_t *fx = (ysfx_t *)opaque;
-    std::unique_ptr<ysfx::mutex> file_mutex;
-    std::unique_lock<ysfx::mutex> lock;
-    std::unique_lock<ysfx::mutex> list_lock;
-
-    // hold both locks to protect file and list access during removal
-    if (!ysfx_get_file(fx, (uint32_t)handle, lock, &list_lock))
+    if (!ysfx_close_file(fx, (uint32_t)handle))
         return -1;
-
-    // preserve the locked mutex of the object being removed
-    file_mutex = std::move(fx->file.list[(uint32_t)handle]->m_mutex);
-
-    fx->file.list[(uint32_t)handle].reset();
     return 0;
 }
 
@@ -510,8 +1160,13 @@ static EEL_F *NSEEL_CGEN_CALL ysfx_api_file_riff(void *opaque, EEL_F *handle_, E
         return nch_;
     }
 
+    // in write mode, the arguments propose the format
     uint32_t nch = 0;
     ysfx_real samplerate = 0;
+    if (file->is_in_write_mode()) {
+        nch = (uint32_t)std::max<int32_t>(0, ysfx_eel_round<int32_t>(*nch_));
+        samplerate = *samplerate_;
+    }
     if (!file->riff(nch, samplerate)) {
         *nch_ = 0;
         *samplerate_ = 0;
@@ -567,6 +1222,8 @@ static EEL_F NSEEL_CGEN_CALL ysfx_api_file_string(void *opaque, EEL_F *handle_,
 void ysfx_api_init_file()
 {
     NSEEL_addfunc_retval("file_open", 1, NSEEL_PProc_THIS, &ysfx_api_file_open);
+    NSEEL_addfunc_retval("file_open_async", 1, NSEEL_PProc_THIS, &ysfx_api_file_open_async);
+    NSEEL_addfunc_retval("file_open_write", 1, NSEEL_PProc_THIS, &ysfx_api_file_open_write);
     NSEEL_addfunc_retval("file_close", 1, NSEEL_PProc_THIS, &ysfx_api_file_close);
     NSEEL_addfunc_retptr("file_rewind", 1, NSEEL_PProc_THIS, &ysfx_api_file_rewind);
     NSEEL_addfunc_retval("file_var", 2, NSEEL_PProc_THIS, &ysfx_api_file_var);
@@ -18,10 +18,20 @@
 #pragma once
 #include "ysfx.h"
 #include "ysfx_utils.hpp"
+#include "ysfx_audio_stream.hpp"
+#include "ysfx_audio_cache.hpp"
+#include "ysfx_resample.hpp"
+#include "ysfx_file_writer.hpp"
 #include "WDL/eel2/ns-eel.h"
 #include "WDL/eel2/ns-eel-int.h"
 #include <vector>
+#include <deque>
 #include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
 
 struct ysfx_file_t {
     virtual ~ysfx_file_t() {}
@@ -34,8 +44,6 @@ struct ysfx_file_t {
     virtual bool riff(uint32_t &nch, ysfx_real &samplerate) = 0;
     virtual bool is_text() = 0;
     virtual bool is_in_write_mode() = 0;
-
-    std::unique_ptr<ysfx::mutex> m_mutex{new ysfx::mutex};
 };
 
 using ysfx_file_u = std::unique_ptr<ysfx_file_t>;
@@ -53,8 +61,12 @@ struct ysfx_raw_file_t final : ysfx_file_t {
     bool riff(uint32_t &, ysfx_real &) override { return false; }
     bool is_text() override { return false; }
     bool is_in_write_mode() override { return false; }
+    uint32_t mem_mapped(uint32_t offset, uint32_t length);
 
     NSEEL_VMCTX m_vm = nullptr;
+    // the file is read from a mapping if possible, from the stream otherwise
+    ysfx::mapped_file m_map;
+    size_t m_pos = 0;
     ysfx::FILE_u m_stream;
 };
 
@@ -71,8 +83,13 @@ struct ysfx_text_file_t final : ysfx_file_t {
     bool riff(uint32_t &, ysfx_real &) override { return false; }
     bool is_text() override { return true; }
     bool is_in_write_mode() override { return false; }
+    bool var_mapped(ysfx_real *var);
 
     NSEEL_VMCTX m_vm = nullptr;
+    // the file is read from a mapping if possible, from the stream otherwise
+    ysfx::mapped_file m_map;
+    size_t m_pos = 0;
+    bool m_eof = false;
     ysfx::FILE_u m_stream;
     std::string m_buf;
 };
@@ -80,7 +97,10 @@ struct ysfx_text_file_t final : ysfx_file_t {
 //------------------------------------------------------------------------------
 
 struct ysfx_audio_file_t final : ysfx_file_t {
-    ysfx_audio_file_t(NSEEL_VMCTX vm, const ysfx_audio_format_t &fmt, const char *filename);
+    // with a cache, the file is read from memory if it fits
+    //   otherwise, with a read-ahead duration, the file streams from a thread of its own
+    //   with a sample rate, the file is resampled to this rate if it has another
+    ysfx_audio_file_t(NSEEL_VMCTX vm, const ysfx_audio_format_t &fmt, const char *filename, ysfx_real read_ahead = 0, ysfx_audio_cache_t *cache = nullptr, ysfx_real sample_rate = 0);
 
     int32_t avail() override;
     void rewind() override;
@@ -94,16 +114,64 @@ struct ysfx_audio_file_t final : ysfx_file_t {
     NSEEL_VMCTX m_vm = nullptr;
     ysfx_audio_format_t m_fmt{};
     std::unique_ptr<ysfx_audio_reader_t, void (*)(ysfx_audio_reader_t *)> m_reader;
+    ysfx_audio_file_info_t m_info{};
+    ysfx_audio_stream_u m_stream;
+    ysfx_decoded_audio_sp m_decoded;
+    uint64_t m_decoded_pos = 0;
+    std::unique_ptr<ysfx_resampler_t> m_resampler;
+    std::vector<ysfx_real> m_resampler_in;
+    std::vector<ysfx_real> m_resampler_out;
+    uint32_t m_resampler_pending = 0;
+    uint64_t read(ysfx_real *samples, uint64_t count);
+    uint64_t read_source(ysfx_real *samples, uint64_t count);
+    uint64_t read_resampled(ysfx_real *samples, uint64_t count);
+    uint64_t avail_source();
     enum { buffer_size = 256 };
     std::unique_ptr<ysfx_real[]> m_buf{new ysfx_real[buffer_size]};
 };
 
 //------------------------------------------------------------------------------
 
+// a file which the code writes, in the format which its name suffix tells
+//   the values of an audio file are interleaved frames, in the format which
+//   `file_riff` sets before the first write
+struct ysfx_write_file_t final : ysfx_file_t {
+    enum kind_t { kind_raw, kind_text, kind_wav };
+
+    ysfx_write_file_t(NSEEL_VMCTX vm, const char *filename, kind_t kind, uint32_t channels, ysfx_real sample_rate, uint32_t capacity);
+
+    int32_t avail() override { return -1; }
+    void rewind() override {}
+    bool var(ysfx_real *var) override;
+    uint32_t mem(uint32_t offset, uint32_t length) override;
+    uint32_t string(std::string &str) override;
+    bool riff(uint32_t &nch, ysfx_real &samplerate) override;
+    bool is_text() override { return m_kind == kind_text; }
+    bool is_in_write_mode() override { return true; }
+    ysfx_file_sink_t *open_sink();
+    bool write_values(const ysfx_real *values, uint32_t count);
+
+    NSEEL_VMCTX m_vm = nullptr;
+    std::string m_path;
+    kind_t m_kind = kind_raw;
+    uint32_t m_channels = 0;
+    ysfx_real m_sample_rate = 0;
+    // whether it has written, after which the format is fixed
+    bool m_started = false;
+    enum { buffer_size = 1024 };
+    std::unique_ptr<uint8_t[]> m_buf;
+    ysfx_file_writer_u m_writer;
+};
+
+//------------------------------------------------------------------------------
+
 struct ysfx_serializer_t final : ysfx_file_t {
     explicit ysfx_serializer_t(NSEEL_VMCTX vm);
 
-    void begin(bool write, std::string &buffer);
+    // read from memory which stays valid until the end, or append to a buffer of the host
+    //   the values are 32-bit floats like in Reaper, or 64-bit doubles if `f64`
+    void begin_read(const uint8_t *data, size_t size, bool f64 = false);
+    void begin_write(ysfx_serial_buffer_t &buffer, bool f64 = false);
     void end();
 
     int32_t avail() override;
@@ -115,13 +183,70 @@ struct ysfx_serializer_t final : ysfx_file_t {
     bool is_text() override { return false; }
     bool is_in_write_mode() override { return m_write == 1; }
 
+    uint8_t *reserve(size_t size);
+
     NSEEL_VMCTX m_vm{};
     int m_write = -1;
-    std::string *m_buffer = nullptr;
+    bool m_f64 = false;
+    const uint8_t *m_data = nullptr;
+    size_t m_size = 0;
     size_t m_pos = 0;
+    ysfx_serial_buffer_t *m_out = nullptr;
+    // whether some data did not fit in the buffer
+    bool m_overflow = false;
 };
 
 using ysfx_serializer_u = std::unique_ptr<ysfx_serializer_t>;
 
+//------------------------------------------------------------------------------
+
+// the file which a thread opens for `file_open_async`, once it is done
+struct ysfx_async_open_t {
+    std::atomic<bool> done{false};
+    // null if it failed to open
+    ysfx_file_u file;
+};
+
+// a file which opens in the background; it reads nothing until it is open,
+//   and its `avail` is `pending_avail`; if it fails to open, it acts as an empty file
+struct ysfx_async_file_t final : ysfx_file_t {
+    enum { pending_avail = -2 };
+
+    explicit ysfx_async_file_t(std::shared_ptr<ysfx_async_open_t> job) : m_job(std::move(job)) {}
+
+    int32_t avail() override;
+    void rewind() override;
+    bool var(ysfx_real *var) override;
+    uint32_t mem(uint32_t offset, uint32_t length) override;
+    uint32_t string(std::string &str) override;
+    bool riff(uint32_t &nch, ysfx_real &samplerate) override;
+    bool is_text() override;
+    bool is_in_write_mode() override { return false; }
+    // the file, once it is open
+    ysfx_file_t *opened();
+
+    std::shared_ptr<ysfx_async_open_t> m_job;
+};
+
+// opens the files of `file_open_async` one after the other, on a thread of its own
+struct ysfx_file_opener_t {
+    ysfx_file_opener_t();
+    // NOTE: this drops the files which are queued, and waits for the one in progress
+    ~ysfx_file_opener_t();
+
+    void post(std::function<void()> job);
+
+private:
+    void run();
+
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    std::deque<std::function<void()>> m_queue;
+    bool m_quit = false;
+    std::thread m_thread;
+};
+
+using ysfx_file_opener_u = std::unique_ptr<ysfx_file_opener_t>;
+
 //------------------------------------------------------------------------------
 void ysfx_api_init_file();
@@ -276,6 +276,54 @@ bool ysfx_gfx_state_is_dirty(ysfx_gfx_state_t *state)
     return state->lice->m_framebuffer_dirty;
 }
 
+bool ysfx_gfx_state_get_dirty_rect(ysfx_gfx_state_t *state, uint32_t rect[4])
+{
+    const RECT &r = state->lice->m_framebuffer_dirty_rect;
+    if (!state->lice->m_framebuffer_dirty || r.right <= r.left || r.bottom <= r.top) {
+        rect[0] = rect[1] = rect[2] = rect[3] = 0;
+        return false;
+    }
+    rect[0] = (uint32_t)r.left;
+    rect[1] = (uint32_t)r.top;
+    rect[2] = (uint32_t)(r.right - r.left);
+    rect[3] = (uint32_t)(r.bottom - r.top);
+    return true;
+}
+
+uint64_t ysfx_gfx_state_measure_images(ysfx_gfx_state_t *state, uint32_t *count)
+{
+    eel_lice_state *lice = state->lice.get();
+    uint32_t n = 0;
+    uint64_t size = 0;
+
+    if (lice) {
+        for (int i = 0, m = lice->m_gfx_images.GetSize(); i < m; ++i) {
+            if (LICE_IBitmap *bm = lice->m_gfx_images.Get()[i]) {
+                ++n;
+                size += (uint64_t)bm->getRowSpan() * (uint64_t)bm->getHeight() * sizeof(LICE_pixel);
+            }
+        }
+    }
+
+    *count = n;
+    return size;
+}
+
+void ysfx_gfx_state_release_images(ysfx_gfx_state_t *state)
+{
+    eel_lice_state *lice = state->lice.get();
+    if (!lice)
+        return;
+
+    for (int i = 0, m = lice->m_gfx_images.GetSize(); i < m; ++i) {
+        LICE__Destroy(lice->m_gfx_images.Get()[i]);
+        lice->m_gfx_images.Get()[i] = nullptr;
+        lice->m_gfx_images_shared[(size_t)i].reset();
+    }
+    LICE__Destroy(lice->m_framebuffer_extra);
+    lice->m_framebuffer_extra = nullptr;
+}
+
 void ysfx_gfx_state_add_key(ysfx_gfx_state_t *state, uint32_t mods, uint32_t key, bool press)
 {
     if (key < 1)
@@ -312,6 +360,105 @@ void ysfx_gfx_state_add_key(ysfx_gfx_state_t *state, uint32_t mods, uint32_t key
         state->keys_pressed.erase(key_id);
 }
 
+//------------------------------------------------------------------------------
+bool ysfx_gfx_input_send_key(ysfx_gfx_input_t &input, uint32_t mods, uint32_t key, bool press)
+{
+    uint32_t tail = input.key_tail.load(std::memory_order_relaxed);
+    uint32_t head = input.key_head.load(std::memory_order_acquire);
+    if (tail - head >= ysfx_gfx_input_t::key_capacity)
+        return false;
+
+    ysfx_gfx_key_event_t &event = input.keys[tail % ysfx_gfx_input_t::key_capacity];
+    event.mods = mods;
+    event.key = key;
+    event.press = press;
+    input.key_tail.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+void ysfx_gfx_input_send_mouse(ysfx_gfx_input_t &input, uint32_t mods, int32_t xpos, int32_t ypos, uint32_t buttons, ysfx_real wheel, ysfx_real hwheel)
+{
+    input.wheel_sent += wheel;
+    input.hwheel_sent += hwheel;
+
+    ysfx_gfx_mouse_event_t &event = input.mouse.back();
+    event.mods = mods;
+    event.xpos = xpos;
+    event.ypos = ypos;
+    event.buttons = buttons;
+    event.wheel = input.wheel_sent;
+    event.hwheel = input.hwheel_sent;
+    input.mouse.publish();
+}
+
+static void ysfx_gfx_apply_mouse(ysfx_t *fx, const ysfx_gfx_mouse_event_t &event)
+{
+    *fx->var.mouse_x = (EEL_F)event.xpos;
+    *fx->var.mouse_y = (EEL_F)event.ypos;
+    *fx->var.mouse_wheel += 512 * (event.wheel - fx->gfx.wheel_received);
+    *fx->var.mouse_hwheel += 512 * (event.hwheel - fx->gfx.hwheel_received);
+    fx->gfx.wheel_received = event.wheel;
+    fx->gfx.hwheel_received = event.hwheel;
+
+    /*
+        1: lmb
+        2: rmb
+        4: Control (Windows) or Command (macOS) key
+        8: Shift key
+        16: Alt (Windows) or Option (macOS) key
+        32: Windows (Windows) or Control (macOS) key
+        64: middle mouse button
+    */
+
+    uint32_t buttons = event.buttons;
+    uint32_t mods = event.mods;
+
+    uint32_t mouse_cap = 0;
+    if (buttons & ysfx_button_left)
+        mouse_cap |= 1;
+    if (buttons & ysfx_button_right)
+        mouse_cap |= 2;
+    if (buttons & ysfx_button_middle)
+        mouse_cap |= 64;
+
+    if (mouse_cap) {
+        if (mods & ysfx_mod_shift)
+            mouse_cap |= 8;
+        if (mods & ysfx_mod_alt)
+            mouse_cap |= 16;
+
+#ifdef __APPLE__
+        if (mods & ysfx_mod_ctrl)
+            mouse_cap |= 32;
+        if (mods & ysfx_mod_super)
+            mouse_cap |= 4;
+#else
+        // Windows key is currently unavailable
+        if (mods & ysfx_mod_ctrl)
+            mouse_cap |= 4;
+#endif
+    }
+
+    *fx->var.mouse_cap = (EEL_F)mouse_cap;
+}
+
+void ysfx_gfx_input_receive(ysfx_t *fx)
+{
+    ysfx_gfx_input_t &input = fx->gfx.input;
+    ysfx_gfx_state_t *state = fx->gfx.state.get();
+
+    uint32_t head = input.key_head.load(std::memory_order_relaxed);
+    uint32_t tail = input.key_tail.load(std::memory_order_acquire);
+    for (; head != tail; ++head) {
+        const ysfx_gfx_key_event_t &event = input.keys[head % ysfx_gfx_input_t::key_capacity];
+        ysfx_gfx_state_add_key(state, event.mods, event.key, event.press);
+    }
+    input.key_head.store(head, std::memory_order_release);
+
+    if (input.mouse.update())
+        ysfx_gfx_apply_mouse(fx, input.mouse.front());
+}
+
 #endif // !defined(YSFX_NO_GFX)
 
 //------------------------------------------------------------------------------
@@ -388,6 +535,7 @@ void ysfx_gfx_prepare(ysfx_t *fx)
     eel_lice_state *lice = state->lice.get();
 
     lice->m_framebuffer_dirty = false;
+    lice->m_framebuffer_dirty_rect = RECT{0, 0, 0, 0};
 
     // set variables `gfx_w` and `gfx_h`
     ysfx_real gfx_w = (ysfx_real)lice->m_framebuffer->getWidth();
@@ -17,6 +17,8 @@
 
 #pragma once
 #include "ysfx.h"
+#include "utility/triple_buffer.hpp"
+#include <atomic>
 
 #if !defined(YSFX_NO_GFX)
 struct ysfx_gfx_state_t;
@@ -30,9 +32,54 @@ void ysfx_gfx_state_set_show_menu_callback(ysfx_gfx_state_t *state, int (*callba
 void ysfx_gfx_state_set_set_cursor_callback(ysfx_gfx_state_t *state, void (*callback)(void *, int32_t));
 void ysfx_gfx_state_set_get_drop_file_callback(ysfx_gfx_state_t *state, const char *(*callback)(void *, int32_t));
 bool ysfx_gfx_state_is_dirty(ysfx_gfx_state_t *state);
+bool ysfx_gfx_state_get_dirty_rect(ysfx_gfx_state_t *state, uint32_t rect[4]);
+uint64_t ysfx_gfx_state_measure_images(ysfx_gfx_state_t *state, uint32_t *count);
+void ysfx_gfx_state_release_images(ysfx_gfx_state_t *state);
 void ysfx_gfx_state_add_key(ysfx_gfx_state_t *state, uint32_t mods, uint32_t key, bool press);
 void ysfx_gfx_state_update_mouse(ysfx_gfx_state_t *state, uint32_t mods, int xpos, int ypos, uint32_t buttons, int wheel, int hwheel);
 
+//------------------------------------------------------------------------------
+// The input of @gfx, which a single thread sends without taking the lock of
+// @gfx, and which @gfx takes at the start of each frame. The keys go through
+// a ring, and the mouse through a triple buffer, where the moves in between
+// two frames merge into the latest one.
+
+struct ysfx_gfx_key_event_t {
+    uint32_t mods = 0;
+    uint32_t key = 0;
+    bool press = false;
+};
+
+struct ysfx_gfx_mouse_event_t {
+    uint32_t mods = 0;
+    int32_t xpos = 0;
+    int32_t ypos = 0;
+    uint32_t buttons = 0;
+    // the totals of the wheels since the start, of which @gfx applies the difference
+    ysfx_real wheel = 0;
+    ysfx_real hwheel = 0;
+};
+
+struct ysfx_gfx_input_t {
+    // the sender writes at `key_tail`, and @gfx reads at `key_head`
+    enum { key_capacity = 256 };
+    ysfx_gfx_key_event_t keys[key_capacity];
+    std::atomic<uint32_t> key_head{0};
+    std::atomic<uint32_t> key_tail{0};
+    // the sender writes into `back`, @gfx owns `front`
+    ysfx::triple_buffer<ysfx_gfx_mouse_event_t> mouse;
+    // the totals of the wheels which the sender has reached
+    ysfx_real wheel_sent = 0;
+    ysfx_real hwheel_sent = 0;
+};
+
+// send a key to @gfx; returns false if the ring is full, and the key is dropped
+bool ysfx_gfx_input_send_key(ysfx_gfx_input_t &input, uint32_t mods, uint32_t key, bool press);
+// send the state of the mouse to @gfx, replacing any which it has not taken yet
+void ysfx_gfx_input_send_mouse(ysfx_gfx_input_t &input, uint32_t mods, int32_t xpos, int32_t ypos, uint32_t buttons, ysfx_real wheel, ysfx_real hwheel);
+// take the input which was sent since the last frame, from @gfx
+void ysfx_gfx_input_receive(ysfx_t *fx);
+
 //------------------------------------------------------------------------------
 void ysfx_gfx_enter(ysfx_t *fx, bool doinit);
 void ysfx_gfx_leave(ysfx_t *fx);
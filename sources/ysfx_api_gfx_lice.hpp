@@ -32,6 +32,9 @@
 
 #pragma once
 #include "ysfx_api_eel.hpp"
+#include "ysfx_lice_simd.hpp"
+#include "ysfx_image_cache.hpp"
+#include "utility/lru_cache.hpp"
 #include "WDL/wdlstring.h"
 #include "WDL/wdlcstring.h"
 #include "WDL/wdlutf8.h"
@@ -39,6 +42,9 @@
 #include <cmath>
 #include <cstdio>
 #include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
 
 // help clangd to figure things out
 #if defined(__CLANGD__)
@@ -60,6 +66,36 @@ static eel_lice_state *ysfx_get_lice_context(ysfx_t *fx)
     return gfx_state->lice.get();
 }
 
+// measures a call of a drawing function, while the profiling is enabled
+struct ysfx_gfx_draw_timer {
+    explicit ysfx_gfx_draw_timer(void *opaque, eel_lice_state *ctx)
+    {
+        ysfx_t *fx = (ysfx_t *)opaque;
+        if (ctx && fx->profile.enabled.load(std::memory_order_relaxed)) {
+            m_fx = fx;
+            m_begin = ysfx::monotonic_ns();
+        }
+    }
+    ~ysfx_gfx_draw_timer()
+    {
+        if (m_fx)
+            m_fx->profile.gfx_draw_ns.fetch_add(ysfx::monotonic_ns() - m_begin, std::memory_order_relaxed);
+    }
+    ysfx_gfx_draw_timer(const ysfx_gfx_draw_timer &) = delete;
+    ysfx_gfx_draw_timer &operator=(const ysfx_gfx_draw_timer &) = delete;
+    ysfx_t *m_fx = nullptr;
+    uint64_t m_begin = 0;
+};
+
+// LICE renders the glyphs of all fonts through a global bitmap, and SWELL keeps
+//   its fonts in globals, so the instances take turns for text; other drawing
+//   runs in parallel, since the rest of the state belongs to each instance
+static ysfx::mutex &ysfx_gfx_text_mutex()
+{
+  static ysfx::mutex mutex;
+  return mutex;
+}
+
 static HDC LICE__GetDC(LICE_IBitmap *bm)
 {
   return bm->getDC();
@@ -91,17 +127,41 @@ static void LICE__SetTextCombineMode(LICE_IFont* ifont, int mode, float alpha)
 }
 static int LICE__DrawText(LICE_IFont* ifont, LICE_IBitmap *bm, const char *str, int strcnt, RECT *rect, UINT dtFlags)
 {
-  if (ifont) return ifont->DrawText(bm, str, strcnt, rect, dtFlags);
-  return 0;
+  if (!ifont) return 0;
+  std::lock_guard<ysfx::mutex> lock(ysfx_gfx_text_mutex());
+  return ifont->DrawText(bm, str, strcnt, rect, dtFlags);
 }
 
 
+// the lines of text which were measured, by font and text; LICE_CachedFont
+//   keeps the glyphs, this saves measuring the same labels at every frame
+typedef ysfx::lru_cache<std::string, RECT> eel_lice_text_cache;
+
+static int LICE__MeasureTextLine(LICE_IFont *ifont, LICE_IBitmap *bm, const char *str, int strcnt, RECT *rect, eel_lice_text_cache *cache)
+{
+  const UINT dtFlags = DT_SINGLELINE|DT_NOPREFIX|DT_CALCRECT;
+  if (!cache || !ifont) return LICE__DrawText(ifont,bm,str,strcnt,rect,dtFlags);
+
+  std::string key((const char *)&ifont,sizeof(ifont));
+  key.append(str,strcnt);
+  if (const RECT *r = cache->find(key))
+  {
+    *rect = *r;
+    return r->bottom - r->top;
+  }
+  int lineh = LICE__DrawText(ifont,bm,str,strcnt,rect,dtFlags);
+  // the height which LICE returns is the one of the rectangle
+  if (lineh == rect->bottom - rect->top) cache->insert(key,*rect);
+  return lineh;
+}
+
 static LICE_IFont *LICE_CreateFont()
 {
   return new LICE_CachedFont();
 }
 static void LICE__DestroyFont(LICE_IFont *bm)
 {
+  std::lock_guard<ysfx::mutex> lock(ysfx_gfx_text_mutex());
   delete bm;
 }
 static bool LICE__resize(LICE_IBitmap *bm, int w, int h)
@@ -124,7 +184,11 @@ public:
 
   LICE_IBitmap *m_framebuffer, *m_framebuffer_extra;
   int m_framebuffer_dirty;
+  // the union of the regions of the framebuffer which the frame has drawn on
+  RECT m_framebuffer_dirty_rect;
   WDL_TypedBuf<LICE_IBitmap *> m_gfx_images;
+  // the decoded files which images show, shared with other instances until drawn on
+  std::vector<ysfx_image_sp> m_gfx_images_shared;
   struct gfxFontStruct {
     LICE_IFont *font;
     char last_fontname[128];
@@ -135,6 +199,8 @@ public:
     int use_fonth;
   }; 
   WDL_TypedBuf<gfxFontStruct> m_gfx_fonts;
+  eel_lice_text_cache m_gfx_text_extents{512};
+  WDL_FastString m_gfx_text; // the copy of the string which gfx_drawstr draws
   enum {
     EELFONT_FLAG_BOLD = (1<<24),
     EELFONT_FLAG_ITALIC = (2<<24),
@@ -157,17 +223,68 @@ public:
     return NULL;
   };
 
+  // the image of gfx_dest, made an own copy if it's shared
+  LICE_IBitmap *GetDestImage(const char *callername)
+  {
+    const EEL_F idx = *m_gfx_dest;
+    if (idx >= 0.0) DetachImage((int)idx);
+    return GetImageForIndex(idx,callername);
+  }
+
+  void DetachImage(int img);
+
+  // mark all of an image as drawn on
   void SetImageDirty(LICE_IBitmap *bm)
   {
-    if (bm == m_framebuffer && !m_framebuffer_dirty)
+    if (bm && bm == m_framebuffer) SetImageDirty(bm,0,0,LICE__GetWidth(bm),LICE__GetHeight(bm));
+  }
+
+  // mark a region of an image as drawn on; it grows by a pixel for antialiasing and rounding
+  void SetImageDirty(LICE_IBitmap *bm, int x, int y, int w, int h)
+  {
+    if (!bm || bm != m_framebuffer) return;
+
+    const int fbw=LICE__GetWidth(bm), fbh=LICE__GetHeight(bm);
+    if (!m_framebuffer_dirty)
     {
+      RECT none={0,0,0,0};
+      m_framebuffer_dirty_rect=none;
       if (m_gfx_clear && *m_gfx_clear > -1.0)
       {
         const int a=(int)*m_gfx_clear;
         if (LICE_FUNCTION_VALID(LICE_Clear)) LICE_Clear(m_framebuffer,LICE_RGBA((a&0xff),((a>>8)&0xff),((a>>16)&0xff),0));
+        RECT all={0,0,fbw,fbh};
+        m_framebuffer_dirty_rect=all;
       }
       m_framebuffer_dirty=1;
     }
+
+    const int l=wdl_max(x-1,0), t=wdl_max(y-1,0);
+    const int r=wdl_min(x+w+1,fbw), b=wdl_min(y+h+1,fbh);
+    if (r <= l || b <= t) return;
+
+    RECT &d=m_framebuffer_dirty_rect;
+    if (d.right <= d.left || d.bottom <= d.top)
+    {
+      d.left=l; d.top=t; d.right=r; d.bottom=b;
+    }
+    else
+    {
+      d.left=wdl_min(d.left,l); d.top=wdl_min(d.top,t);
+      d.right=wdl_max(d.right,r); d.bottom=wdl_max(d.bottom,b);
+    }
+  }
+
+  // mark the region which a text at a position has drawn on, until the position where it ended
+  void SetTextDirty(LICE_IBitmap *bm, int x, int y, int endx, int endy, const char *str, int len)
+  {
+    const int lineh=GetActiveFont() ? m_gfx_fonts.Get()[m_gfx_font_active].use_fonth : 8;
+    // leave room for italics, shadows and outlines
+    const int pad=2+lineh/4;
+    if (memchr(str,'\n',len))
+      SetImageDirty(bm,x-pad,y-pad,LICE__GetWidth(bm)-(x-pad),endy+lineh-y+2*pad);
+    else
+      SetImageDirty(bm,x-pad,y-pad,endx-x+2*pad,lineh+2*pad);
   }
 
   // R, G, B, A, w, h, x, y, mode(1=add,0=copy)
@@ -221,8 +338,10 @@ eel_lice_state::eel_lice_state(NSEEL_VMCTX vm, void *ctx, int image_slots, int f
 
   m_gfx_images.Resize(image_slots);
   memset(m_gfx_images.Get(),0,m_gfx_images.GetSize()*sizeof(m_gfx_images.Get()[0]));
+  m_gfx_images_shared.resize(m_gfx_images.GetSize());
   m_framebuffer=m_framebuffer_extra=0;
   m_framebuffer_dirty=0;
+  memset(&m_framebuffer_dirty_rect,0,sizeof(m_framebuffer_dirty_rect));
 
   m_gfx_r = NSEEL_VM_regvar(vm,"gfx_r");
   m_gfx_g = NSEEL_VM_regvar(vm,"gfx_g");
@@ -311,12 +430,14 @@ LICE_pixel eel_lice_state::getCurColor()
 static EEL_F * NSEEL_CGEN_CALL ysfx_api_gfx_lineto(void *opaque, EEL_F *xpos, EEL_F *ypos, EEL_F *useaa)
 {
   eel_lice_state *ctx=EEL_LICE_GET_CONTEXT(opaque);
+  ysfx_gfx_draw_timer timer{opaque, ctx};
   if (ctx) ctx->gfx_lineto(*xpos, *ypos, *useaa);
   return xpos;
 }
 static EEL_F * NSEEL_CGEN_CALL ysfx_api_gfx_lineto2(void *opaque, EEL_F *xpos, EEL_F *ypos)
 {
   eel_lice_state *ctx=EEL_LICE_GET_CONTEXT(opaque);
+  ysfx_gfx_draw_timer timer{opaque, ctx};
   if (ctx) ctx->gfx_lineto(*xpos, *ypos, 1.0f);
   return xpos;
 }
@@ -324,6 +445,7 @@ static EEL_F * NSEEL_CGEN_CALL ysfx_api_gfx_lineto2(void *opaque, EEL_F *xpos, E
 static EEL_F * NSEEL_CGEN_CALL ysfx_api_gfx_rectto(void *opaque, EEL_F *xpos, EEL_F *ypos)
 {
   eel_lice_state *ctx=EEL_LICE_GET_CONTEXT(opaque);
+  ysfx_gfx_draw_timer timer{opaque, ctx};
   if (ctx) ctx->gfx_rectto(*xpos, *ypos);
   return xpos;
 }
@@ -331,6 +453,7 @@ static EEL_F * NSEEL_CGEN_CALL ysfx_api_gfx_rectto(void *opaque, EEL_F *xpos, EE
 static EEL_F NSEEL_CGEN_CALL ysfx_api_gfx_line(void *opaque, INT_PTR np, EEL_F **parms)
 {
   eel_lice_state *ctx=EEL_LICE_GET_CONTEXT(opaque);
+  ysfx_gfx_draw_timer timer{opaque, ctx};
   if (ctx) ctx->gfx_line((int)np,parms);
   return 0.0;
 }
@@ -338,30 +461,35 @@ static EEL_F NSEEL_CGEN_CALL ysfx_api_gfx_line(void *opaque, INT_PTR np, EEL_F *
 static EEL_F NSEEL_CGEN_CALL ysfx_api_gfx_rect(void *opaque, INT_PTR np, EEL_F **parms)
 {
   eel_lice_state *ctx=EEL_LICE_GET_CONTEXT(opaque);
+  ysfx_gfx_draw_timer timer{opaque, ctx};
   if (ctx) ctx->gfx_rect((int)np,parms);
   return 0.0;
 }
 static EEL_F NSEEL_CGEN_CALL ysfx_api_gfx_roundrect(void *opaque, INT_PTR np, EEL_F **parms)
 {
   eel_lice_state *ctx=EEL_LICE_GET_CONTEXT(opaque);
+  ysfx_gfx_draw_timer timer{opaque, ctx};
   if (ctx) ctx->gfx_roundrect((int)np,parms);
   return 0.0;
 }
 static EEL_F NSEEL_CGEN_CALL ysfx_api_gfx_arc(void *opaque, INT_PTR np, EEL_F **parms)
 {
   eel_lice_state *ctx=EEL_LICE_GET_CONTEXT(opaque);
+  ysfx_gfx_draw_timer timer{opaque, ctx};
   if (ctx) ctx->gfx_arc((int)np,parms);
   return 0.0;
 }
 static EEL_F NSEEL_CGEN_CALL ysfx_api_gfx_set(void *opaque, INT_PTR np, EEL_F **parms)
 {
   eel_lice_state *ctx=EEL_LICE_GET_CONTEXT(opaque);
+  ysfx_gfx_draw_timer timer{opaque, ctx};
   if (ctx) ctx->gfx_set((int)np,parms);
   return 0.0;
 }
 static EEL_F NSEEL_CGEN_CALL ysfx_api_gfx_gradrect(void *opaque, INT_PTR np, EEL_F **parms)
 {
   eel_lice_state *ctx=EEL_LICE_GET_CONTEXT(opaque);
+  ysfx_gfx_draw_timer timer{opaque, ctx};
   if (ctx) ctx->gfx_grad_or_muladd_rect(0,(int)np,parms);
   return 0.0;
 }
@@ -369,6 +497,7 @@ static EEL_F NSEEL_CGEN_CALL ysfx_api_gfx_gradrect(void *opaque, INT_PTR np, EEL
 static EEL_F NSEEL_CGEN_CALL ysfx_api_gfx_muladdrect(void *opaque, INT_PTR np, EEL_F **parms)
 {
   eel_lice_state *ctx=EEL_LICE_GET_CONTEXT(opaque);
+  ysfx_gfx_draw_timer timer{opaque, ctx};
   if (ctx) ctx->gfx_grad_or_muladd_rect(1,(int)np,parms);
   return 0.0;
 }
@@ -376,6 +505,7 @@ static EEL_F NSEEL_CGEN_CALL ysfx_api_gfx_muladdrect(void *opaque, INT_PTR np, E
 static EEL_F NSEEL_CGEN_CALL ysfx_api_gfx_deltablit(void *opaque, INT_PTR np, EEL_F **parms)
 {
   eel_lice_state *ctx=EEL_LICE_GET_CONTEXT(opaque);
+  ysfx_gfx_draw_timer timer{opaque, ctx};
   if (ctx) ctx->gfx_blitext2((int)np,parms,1);
   return 0.0;
 }
@@ -383,6 +513,7 @@ static EEL_F NSEEL_CGEN_CALL ysfx_api_gfx_deltablit(void *opaque, INT_PTR np, EE
 static EEL_F NSEEL_CGEN_CALL ysfx_api_gfx_transformblit(void *opaque, INT_PTR np, EEL_F **parms)
 {
   eel_lice_state *ctx=EEL_LICE_GET_CONTEXT(opaque);
+  ysfx_gfx_draw_timer timer{opaque, ctx};
   if (ctx) 
   {
 #ifndef EEL_LICE_NO_RAM
@@ -419,6 +550,7 @@ static EEL_F NSEEL_CGEN_CALL ysfx_api_gfx_transformblit(void *opaque, INT_PTR np
 static EEL_F NSEEL_CGEN_CALL ysfx_api_gfx_circle(void *opaque, INT_PTR np, EEL_F **parms)
 {
   eel_lice_state *ctx=EEL_LICE_GET_CONTEXT(opaque);
+  ysfx_gfx_draw_timer timer{opaque, ctx};
   bool aa = true, fill = false;
   if (np>3) fill = parms[3][0] > 0.5;
   if (np>4) aa = parms[4][0] > 0.5;
@@ -429,6 +561,7 @@ static EEL_F NSEEL_CGEN_CALL ysfx_api_gfx_circle(void *opaque, INT_PTR np, EEL_F
 static EEL_F NSEEL_CGEN_CALL ysfx_api_gfx_triangle(void* opaque, INT_PTR np, EEL_F **parms)
 {
   eel_lice_state *ctx=EEL_LICE_GET_CONTEXT(opaque);
+  ysfx_gfx_draw_timer timer{opaque, ctx};
   if (ctx) ctx->gfx_triangle(parms, (int)np);
   return 0.0;
 }
@@ -436,6 +569,7 @@ static EEL_F NSEEL_CGEN_CALL ysfx_api_gfx_triangle(void* opaque, INT_PTR np, EEL
 static EEL_F * NSEEL_CGEN_CALL ysfx_api_gfx_drawnumber(void *opaque, EEL_F *n, EEL_F *nd)
 {
   eel_lice_state *ctx=EEL_LICE_GET_CONTEXT(opaque);
+  ysfx_gfx_draw_timer timer{opaque, ctx};
   if (ctx) ctx->gfx_drawnumber(*n, *nd);
   return n;
 }
@@ -443,6 +577,7 @@ static EEL_F * NSEEL_CGEN_CALL ysfx_api_gfx_drawnumber(void *opaque, EEL_F *n, E
 static EEL_F * NSEEL_CGEN_CALL ysfx_api_gfx_drawchar(void *opaque, EEL_F *n)
 {
   eel_lice_state *ctx=EEL_LICE_GET_CONTEXT(opaque);
+  ysfx_gfx_draw_timer timer{opaque, ctx};
   if (ctx) ctx->gfx_drawchar(*n);
   return n;
 }
@@ -450,6 +585,7 @@ static EEL_F * NSEEL_CGEN_CALL ysfx_api_gfx_drawchar(void *opaque, EEL_F *n)
 static EEL_F * NSEEL_CGEN_CALL ysfx_api_gfx_measurestr(void *opaque, EEL_F *str, EEL_F *xOut, EEL_F *yOut)
 {
   eel_lice_state *ctx=EEL_LICE_GET_CONTEXT(opaque);
+  ysfx_gfx_draw_timer timer{opaque, ctx};
   if (ctx) 
   {
     EEL_F *p[3]={str,xOut,yOut};
@@ -460,6 +596,7 @@ static EEL_F * NSEEL_CGEN_CALL ysfx_api_gfx_measurestr(void *opaque, EEL_F *str,
 static EEL_F * NSEEL_CGEN_CALL ysfx_api_gfx_measurechar(void *opaque, EEL_F *str, EEL_F *xOut, EEL_F *yOut)
 {
   eel_lice_state *ctx=EEL_LICE_GET_CONTEXT(opaque);
+  ysfx_gfx_draw_timer timer{opaque, ctx};
   if (ctx) 
   {
     EEL_F *p[3]={str,xOut,yOut};
@@ -471,6 +608,7 @@ static EEL_F * NSEEL_CGEN_CALL ysfx_api_gfx_measurechar(void *opaque, EEL_F *str
 static EEL_F NSEEL_CGEN_CALL ysfx_api_gfx_drawstr(void *opaque, INT_PTR nparms, EEL_F **parms)
 {
   eel_lice_state *ctx=EEL_LICE_GET_CONTEXT(opaque);
+  ysfx_gfx_draw_timer timer{opaque, ctx};
   if (ctx) ctx->gfx_drawstr(opaque,parms,(int)nparms,0);
   return parms[0][0];
 }
@@ -478,6 +616,7 @@ static EEL_F NSEEL_CGEN_CALL ysfx_api_gfx_drawstr(void *opaque, INT_PTR nparms,
 static EEL_F NSEEL_CGEN_CALL ysfx_api_gfx_printf(void *opaque, INT_PTR nparms, EEL_F **parms)
 {
   eel_lice_state *ctx=EEL_LICE_GET_CONTEXT(opaque);
+  ysfx_gfx_draw_timer timer{opaque, ctx};
   if (ctx && nparms>0) 
   {
     EEL_F v= **parms;
@@ -490,6 +629,7 @@ static EEL_F NSEEL_CGEN_CALL ysfx_api_gfx_printf(void *opaque, INT_PTR nparms, E
 static EEL_F * NSEEL_CGEN_CALL ysfx_api_gfx_setpixel(void *opaque, EEL_F *r, EEL_F *g, EEL_F *b)
 {
   eel_lice_state *ctx=EEL_LICE_GET_CONTEXT(opaque);
+  ysfx_gfx_draw_timer timer{opaque, ctx};
   if (ctx) ctx->gfx_setpixel(*r, *g, *b);
   return r;
 }
@@ -497,6 +637,7 @@ static EEL_F * NSEEL_CGEN_CALL ysfx_api_gfx_setpixel(void *opaque, EEL_F *r, EEL
 static EEL_F * NSEEL_CGEN_CALL ysfx_api_gfx_getpixel(void *opaque, EEL_F *r, EEL_F *g, EEL_F *b)
 {
   eel_lice_state *ctx=EEL_LICE_GET_CONTEXT(opaque);
+  ysfx_gfx_draw_timer timer{opaque, ctx};
   if (ctx) ctx->gfx_getpixel(r, g, b);
   return r;
 }
@@ -504,6 +645,7 @@ static EEL_F * NSEEL_CGEN_CALL ysfx_api_gfx_getpixel(void *opaque, EEL_F *r, EEL
 static EEL_F NSEEL_CGEN_CALL ysfx_api_gfx_setfont(void *opaque, INT_PTR np, EEL_F **parms)
 {
   eel_lice_state *ctx=EEL_LICE_GET_CONTEXT(opaque);
+  ysfx_gfx_draw_timer timer{opaque, ctx};
   if (ctx) return ctx->gfx_setfont(opaque,(int)np,parms);
   return 0.0;
 }
@@ -511,6 +653,7 @@ static EEL_F NSEEL_CGEN_CALL ysfx_api_gfx_setfont(void *opaque, INT_PTR np, EEL_
 static EEL_F NSEEL_CGEN_CALL ysfx_api_gfx_getfont(void *opaque, INT_PTR np, EEL_F **parms)
 {
   eel_lice_state *ctx=EEL_LICE_GET_CONTEXT(opaque);
+  ysfx_gfx_draw_timer timer{opaque, ctx};
   if (ctx) 
   {
     const int idx=ctx->m_gfx_font_active;
@@ -536,6 +679,7 @@ static EEL_F NSEEL_CGEN_CALL ysfx_api_gfx_getfont(void *opaque, INT_PTR np, EEL_
 static EEL_F NSEEL_CGEN_CALL ysfx_api_gfx_blit2(void *opaque, INT_PTR np, EEL_F **parms)
 {
   eel_lice_state *ctx=EEL_LICE_GET_CONTEXT(opaque);
+  ysfx_gfx_draw_timer timer{opaque, ctx};
   if (ctx && np>=3) 
   {
     ctx->gfx_blitext2((int)np,parms,0);
@@ -547,6 +691,7 @@ static EEL_F NSEEL_CGEN_CALL ysfx_api_gfx_blit2(void *opaque, INT_PTR np, EEL_F
 static EEL_F * NSEEL_CGEN_CALL ysfx_api_gfx_blitext(void *opaque, EEL_F *img, EEL_F *coordidx, EEL_F *rotate)
 {
   eel_lice_state *ctx=EEL_LICE_GET_CONTEXT(opaque);
+  ysfx_gfx_draw_timer timer{opaque, ctx};
   if (ctx) 
   {
 #ifndef EEL_LICE_NO_RAM
@@ -581,6 +726,7 @@ static EEL_F * NSEEL_CGEN_CALL ysfx_api_gfx_blitext(void *opaque, EEL_F *img, EE
 static EEL_F * NSEEL_CGEN_CALL ysfx_api_gfx_blurto(void *opaque, EEL_F *x, EEL_F *y)
 {
   eel_lice_state *ctx=EEL_LICE_GET_CONTEXT(opaque);
+  ysfx_gfx_draw_timer timer{opaque, ctx};
   if (ctx) ctx->gfx_blurto(*x,*y);
   return x;
 }
@@ -589,6 +735,7 @@ static EEL_F * NSEEL_CGEN_CALL ysfx_api_gfx_getimgdim(void *opaque, EEL_F *img,
 {
   EEL_IMG_MUTEXLOCK_SCOPE
   eel_lice_state *ctx=EEL_LICE_GET_CONTEXT(opaque);
+  ysfx_gfx_draw_timer timer{opaque, ctx};
   if (ctx) ctx->gfx_getimgdim(*img,w,h);
   return img;
 }
@@ -597,6 +744,7 @@ static EEL_F NSEEL_CGEN_CALL ysfx_api_gfx_loadimg(void *opaque, EEL_F *img, EEL_
 {
   EEL_IMG_MUTEXLOCK_SCOPE
   eel_lice_state *ctx=EEL_LICE_GET_CONTEXT(opaque);
+  ysfx_gfx_draw_timer timer{opaque, ctx};
   if (ctx) return ctx->gfx_loadimg(opaque,(int)*img,*fr);
   return 0.0;
 }
@@ -605,6 +753,7 @@ static EEL_F NSEEL_CGEN_CALL ysfx_api_gfx_setimgdim(void *opaque, EEL_F *img, EE
 {
   EEL_IMG_MUTEXLOCK_SCOPE
   eel_lice_state *ctx=EEL_LICE_GET_CONTEXT(opaque);
+  ysfx_gfx_draw_timer timer{opaque, ctx};
   if (ctx) return ctx->gfx_setimgdim((int)*img,w,h);
   return 0.0;
 }
@@ -616,7 +765,7 @@ static EEL_F NSEEL_CGEN_CALL ysfx_api_gfx_getsyscol(void* ctxe, INT_PTR np, EEL_
 
 void eel_lice_state::gfx_lineto(EEL_F xpos, EEL_F ypos, EEL_F aaflag)
 {
-  LICE_IBitmap *dest = GetImageForIndex(*m_gfx_dest,"gfx_lineto");
+  LICE_IBitmap *dest = GetDestImage("gfx_lineto");
   if (!dest) return;
 
   int x1=(int)floor(xpos),y1=(int)floor(ypos),x2=(int)floor(*m_gfx_x), y2=(int)floor(*m_gfx_y);
@@ -624,7 +773,7 @@ void eel_lice_state::gfx_lineto(EEL_F xpos, EEL_F ypos, EEL_F aaflag)
       LICE_FUNCTION_VALID(LICE_ClipLine) && 
       LICE_ClipLine(&x1,&y1,&x2,&y2,0,0,LICE__GetWidth(dest),LICE__GetHeight(dest))) 
   {
-    SetImageDirty(dest);
+    SetImageDirty(dest,wdl_min(x1,x2),wdl_min(y1,y2),abs(x2-x1)+1,abs(y2-y1)+1);
     LICE_Line(dest,x1,y1,x2,y2,getCurColor(),(float) *m_gfx_a,getCurMode(),aaflag > 0.5);
   }
   *m_gfx_x = xpos;
@@ -634,12 +783,13 @@ void eel_lice_state::gfx_lineto(EEL_F xpos, EEL_F ypos, EEL_F aaflag)
 
 void eel_lice_state::gfx_circle(float x, float y, float r, bool fill, bool aaflag)
 {
-  LICE_IBitmap *dest = GetImageForIndex(*m_gfx_dest,"gfx_circle");
+  LICE_IBitmap *dest = GetDestImage("gfx_circle");
   if (!dest) return;
 
   if (LICE_FUNCTION_VALID(LICE_Circle) && LICE_FUNCTION_VALID(LICE_FillCircle))
   {
-    SetImageDirty(dest);
+    const int rr=(int)ceil(fabs(r));
+    SetImageDirty(dest,(int)floor(x)-rr,(int)floor(y)-rr,2*rr+2,2*rr+2);
     if(fill)
       LICE_FillCircle(dest, x, y, r, getCurColor(), (float) *m_gfx_a, getCurMode(), aaflag);
     else
@@ -649,11 +799,19 @@ void eel_lice_state::gfx_circle(float x, float y, float r, bool fill, bool aafla
 
 void eel_lice_state::gfx_triangle(EEL_F** parms, int np)
 {
-  LICE_IBitmap *dest = GetImageForIndex(*m_gfx_dest, "gfx_triangle");
+  LICE_IBitmap *dest = GetDestImage("gfx_triangle");
   if (np >= 6)
   {
     np &= ~1;
-    SetImageDirty(dest);
+    {
+      int minx=(int)parms[0][0], miny=(int)parms[1][0], maxx=minx, maxy=miny;
+      for (int i=2; i+1 < np; i+=2)
+      {
+        minx=wdl_min(minx,(int)parms[i][0]); maxx=wdl_max(maxx,(int)parms[i][0]);
+        miny=wdl_min(miny,(int)parms[i+1][0]); maxy=wdl_max(maxy,(int)parms[i+1][0]);
+      }
+      SetImageDirty(dest,minx,miny,maxx-minx+1,maxy-miny+1);
+    }
     if (np == 6)
     {        
       if (!LICE_FUNCTION_VALID(LICE_FillTriangle)) return;
@@ -682,7 +840,7 @@ void eel_lice_state::gfx_triangle(EEL_F** parms, int np)
 
 void eel_lice_state::gfx_rectto(EEL_F xpos, EEL_F ypos)
 {
-  LICE_IBitmap *dest = GetImageForIndex(*m_gfx_dest,"gfx_rectto");
+  LICE_IBitmap *dest = GetDestImage("gfx_rectto");
   if (!dest) return;
 
   EEL_F x1=xpos,y1=ypos,x2=*m_gfx_x, y2=*m_gfx_y;
@@ -691,8 +849,9 @@ void eel_lice_state::gfx_rectto(EEL_F xpos, EEL_F ypos)
 
   if (LICE_FUNCTION_VALID(LICE_FillRect) && x2-x1 > 0.5 && y2-y1 > 0.5)
   {
-    SetImageDirty(dest);
-    LICE_FillRect(dest,(int)x1,(int)y1,(int)(x2-x1),(int)(y2-y1),getCurColor(),(float)*m_gfx_a,getCurMode());
+    SetImageDirty(dest,(int)x1,(int)y1,(int)(x2-x1),(int)(y2-y1));
+    if (!ysfx::lice_fill_rect(dest,(int)x1,(int)y1,(int)(x2-x1),(int)(y2-y1),getCurColor(),(float)*m_gfx_a,getCurMode()))
+      LICE_FillRect(dest,(int)x1,(int)y1,(int)(x2-x1),(int)(y2-y1),getCurColor(),(float)*m_gfx_a,getCurMode());
   }
   *m_gfx_x = xpos;
   *m_gfx_y = ypos;
@@ -701,7 +860,7 @@ void eel_lice_state::gfx_rectto(EEL_F xpos, EEL_F ypos)
 
 void eel_lice_state::gfx_line(int np, EEL_F **parms)
 {
-  LICE_IBitmap *dest = GetImageForIndex(*m_gfx_dest,"gfx_line");
+  LICE_IBitmap *dest = GetDestImage("gfx_line");
   if (!dest) return;
 
   int x1=(int)floor(parms[0][0]),y1=(int)floor(parms[1][0]),x2=(int)floor(parms[2][0]), y2=(int)floor(parms[3][0]);
@@ -710,14 +869,14 @@ void eel_lice_state::gfx_line(int np, EEL_F **parms)
       LICE_FUNCTION_VALID(LICE_Line) && 
       LICE_FUNCTION_VALID(LICE_ClipLine) && LICE_ClipLine(&x1,&y1,&x2,&y2,0,0,LICE__GetWidth(dest),LICE__GetHeight(dest))) 
   {
-    SetImageDirty(dest);
+    SetImageDirty(dest,wdl_min(x1,x2),wdl_min(y1,y2),abs(x2-x1)+1,abs(y2-y1)+1);
     LICE_Line(dest,x1,y1,x2,y2,getCurColor(),(float)*m_gfx_a,getCurMode(),np< 5 || parms[4][0] > 0.5);
   } 
 }
 
 void eel_lice_state::gfx_rect(int np, EEL_F **parms)
 {
-  LICE_IBitmap *dest = GetImageForIndex(*m_gfx_dest,"gfx_rect");
+  LICE_IBitmap *dest = GetDestImage("gfx_rect");
   if (!dest) return;
 
   int x1=(int)floor(parms[0][0]),y1=(int)floor(parms[1][0]),w=(int)floor(parms[2][0]),h=(int)floor(parms[3][0]);  
@@ -725,50 +884,54 @@ void eel_lice_state::gfx_rect(int np, EEL_F **parms)
 
   if (LICE_FUNCTION_VALID(LICE_FillRect) && LICE_FUNCTION_VALID(LICE_DrawRect) && w>0 && h>0)
   {
-    SetImageDirty(dest);
-    if (filled) LICE_FillRect(dest,x1,y1,w,h,getCurColor(),(float)*m_gfx_a,getCurMode());
+    SetImageDirty(dest,x1,y1,w,h);
+    if (filled) {
+      if (!ysfx::lice_fill_rect(dest,x1,y1,w,h,getCurColor(),(float)*m_gfx_a,getCurMode()))
+        LICE_FillRect(dest,x1,y1,w,h,getCurColor(),(float)*m_gfx_a,getCurMode());
+    }
     else LICE_DrawRect(dest, x1, y1, w-1, h-1, getCurColor(), (float)*m_gfx_a, getCurMode());
   }
 }
 
 void eel_lice_state::gfx_roundrect(int np, EEL_F **parms)
 {
-  LICE_IBitmap *dest = GetImageForIndex(*m_gfx_dest,"gfx_roundrect");
+  LICE_IBitmap *dest = GetDestImage("gfx_roundrect");
   if (!dest) return;
 
   const bool aa = np <= 5 || parms[5][0]>0.5;
 
   if (LICE_FUNCTION_VALID(LICE_RoundRect) && parms[2][0]>0 && parms[3][0]>0)
   {
-    SetImageDirty(dest);
+    SetImageDirty(dest,(int)floor(parms[0][0]),(int)floor(parms[1][0]),(int)ceil(parms[2][0])+2,(int)ceil(parms[3][0])+2);
     LICE_RoundRect(dest, (float)parms[0][0], (float)parms[1][0], (float)parms[2][0], (float)parms[3][0], (int)parms[4][0], getCurColor(), (float)*m_gfx_a, getCurMode(), aa);
   }
 }
 
 void eel_lice_state::gfx_arc(int np, EEL_F **parms)
 {
-  LICE_IBitmap *dest = GetImageForIndex(*m_gfx_dest,"gfx_arc");
+  LICE_IBitmap *dest = GetDestImage("gfx_arc");
   if (!dest) return;
 
   const bool aa = np <= 5 || parms[5][0]>0.5;
 
   if (LICE_FUNCTION_VALID(LICE_Arc))
   {
-    SetImageDirty(dest);
+    const int rr=(int)ceil(fabs(parms[2][0]));
+    SetImageDirty(dest,(int)floor(parms[0][0])-rr,(int)floor(parms[1][0])-rr,2*rr+2,2*rr+2);
     LICE_Arc(dest, (float)parms[0][0], (float)parms[1][0], (float)parms[2][0], (float)parms[3][0], (float)parms[4][0], getCurColor(), (float)*m_gfx_a, getCurMode(), aa);
   }
 }
 
 void eel_lice_state::gfx_grad_or_muladd_rect(int whichmode, int np, EEL_F **parms)
 {
-  LICE_IBitmap *dest = GetImageForIndex(*m_gfx_dest,whichmode==0?"gfx_gradrect":"gfx_muladdrect");
+  LICE_IBitmap *dest = GetDestImage(whichmode==0?"gfx_gradrect":"gfx_muladdrect");
   if (!dest) return;
 
   const int x1=(int)floor(parms[0][0]),y1=(int)floor(parms[1][0]),w=(int)floor(parms[2][0]), h=(int)floor(parms[3][0]);
 
   if (w>0 && h>0)
   {
-    SetImageDirty(dest);
+    SetImageDirty(dest,x1,y1,w,h);
     if (whichmode==0 && LICE_FUNCTION_VALID(LICE_GradRect) && np > 7)
     {
       LICE_GradRect(dest,x1,y1,w,h,(float)parms[4][0],(float)parms[5][0],(float)parms[6][0],(float)parms[7][0],
@@ -779,8 +942,10 @@ void eel_lice_state::gfx_grad_or_muladd_rect(int whichmode, int np, EEL_F **parm
     else if (whichmode==1 && LICE_FUNCTION_VALID(LICE_MultiplyAddRect) && np > 6)
     {
       const double sc = 255.0;
-      LICE_MultiplyAddRect(dest,x1,y1,w,h,(float)parms[4][0],(float)parms[5][0],(float)parms[6][0],np>7 ? (float)parms[7][0]:1.0f,
-        (float)(np > 8 ? sc*parms[8][0]:0.0), (float)(np > 9 ? sc*parms[9][0]:0.0),  (float)(np > 10 ? sc*parms[10][0]:0.0), (float)(np > 11 ? sc*parms[11][0]:0.0));
+      const float rsc=(float)parms[4][0], gsc=(float)parms[5][0], bsc=(float)parms[6][0], asc=np>7 ? (float)parms[7][0]:1.0f;
+      const float radd=(float)(np > 8 ? sc*parms[8][0]:0.0), gadd=(float)(np > 9 ? sc*parms[9][0]:0.0), badd=(float)(np > 10 ? sc*parms[10][0]:0.0), aadd=(float)(np > 11 ? sc*parms[11][0]:0.0);
+      if (!ysfx::lice_multiply_add_rect(dest,x1,y1,w,h,rsc,gsc,bsc,asc,radd,gadd,badd,aadd))
+        LICE_MultiplyAddRect(dest,x1,y1,w,h,rsc,gsc,bsc,asc,radd,gadd,badd,aadd);
     }
   }
 }
@@ -789,7 +954,7 @@ void eel_lice_state::gfx_grad_or_muladd_rect(int whichmode, int np, EEL_F **parm
 
 void eel_lice_state::gfx_setpixel(EEL_F r, EEL_F g, EEL_F b)
 {
-  LICE_IBitmap *dest = GetImageForIndex(*m_gfx_dest,"gfx_setpixel");
+  LICE_IBitmap *dest = GetDestImage("gfx_setpixel");
   if (!dest) return;
 
   int red=(int) (r*255.0);
@@ -801,7 +966,7 @@ void eel_lice_state::gfx_setpixel(EEL_F r, EEL_F g, EEL_F b)
 
   if (LICE_FUNCTION_VALID(LICE_PutPixel)) 
   {
-    SetImageDirty(dest);
+    SetImageDirty(dest,(int)*m_gfx_x,(int)*m_gfx_y,1,1);
     LICE_PutPixel(dest,(int)*m_gfx_x, (int)*m_gfx_y,LICE_RGBA(red,green,blue,255), (float)*m_gfx_a,getCurMode());
   }
 }
@@ -834,11 +999,14 @@ EEL_F eel_lice_state::gfx_loadimg(void *opaque, int img, EEL_F loadFrom)
 
     if (ok && fs.GetLength())
     {
-      LICE_IBitmap *bm = LICE_LoadImage(fs.Get(),NULL,false);
-      if (bm)
+      // the image shows the pixels of the shared file, until it's drawn on
+      ysfx_image_sp shared = ysfx_image_acquire(fs.Get());
+      LICE_IBitmap *src = shared ? shared->bitmap : NULL;
+      if (src)
       {
         LICE__Destroy(m_gfx_images.Get()[img]);
-        m_gfx_images.Get()[img]=bm;
+        m_gfx_images.Get()[img]=new LICE_WrapperBitmap(src->getBits(),src->getWidth(),src->getHeight(),src->getRowSpan(),src->isFlipped());
+        m_gfx_images_shared[img]=std::move(shared);
         return img;
       }
     }
@@ -847,6 +1015,18 @@ EEL_F eel_lice_state::gfx_loadimg(void *opaque, int img, EEL_F loadFrom)
 
 }
 
+void eel_lice_state::DetachImage(int img)
+{
+  if (img < 0 || img >= m_gfx_images.GetSize() || !m_gfx_images_shared[img]) return;
+
+  LICE_IBitmap *src = m_gfx_images_shared[img]->bitmap;
+  LICE_IBitmap *bm = __LICE_CreateBitmap(0,src->getWidth(),src->getHeight());
+  if (bm) LICE_Copy(bm,src);
+  LICE__Destroy(m_gfx_images.Get()[img]);
+  m_gfx_images.Get()[img]=bm;
+  m_gfx_images_shared[img].reset();
+}
+
 EEL_F eel_lice_state::gfx_setimgdim(int img, EEL_F *w, EEL_F *h)
 {
   int rv=0;
@@ -863,6 +1043,7 @@ EEL_F eel_lice_state::gfx_setimgdim(int img, EEL_F *w, EEL_F *h)
   LICE_IBitmap *bm=NULL;
   if (img >= 0 && img < m_gfx_images.GetSize()) 
   {
+    DetachImage(img);
     bm=m_gfx_images.Get()[img];  
     if (!bm) 
     {
@@ -880,21 +1061,20 @@ EEL_F eel_lice_state::gfx_setimgdim(int img, EEL_F *w, EEL_F *h)
 
 void eel_lice_state::gfx_blurto(EEL_F x, EEL_F y)
 {
-  LICE_IBitmap *dest = GetImageForIndex(*m_gfx_dest,"gfx_blurto");
+  LICE_IBitmap *dest = GetDestImage("gfx_blurto");
   if (!dest
 #ifdef DYNAMIC_LICE
     ||!LICE_Blur
 #endif
     ) return;
 
-  SetImageDirty(dest);
-  
   int srcx = (int)x;
   int srcy = (int)y;
   int srcw=(int) (*m_gfx_x-x);
   int srch=(int) (*m_gfx_y-y);
   if (srch < 0) { srch=-srch; srcy = (int)*m_gfx_y; }
   if (srcw < 0) { srcw=-srcw; srcx = (int)*m_gfx_x; }
+  SetImageDirty(dest,srcx,srcy,srcw,srch);
   LICE_Blur(dest,dest,srcx,srcy,srcx,srcy,srcw,srch);
   *m_gfx_x = x;
   *m_gfx_y = y;
@@ -911,7 +1091,7 @@ static bool CoordsSrcDestOverlap(EEL_F *coords)
 
 void eel_lice_state::gfx_transformblit(EEL_F **parms, int div_w, int div_h, EEL_F *tab)
 {
-  LICE_IBitmap *dest = GetImageForIndex(*m_gfx_dest,"gfx_transformblit");
+  LICE_IBitmap *dest = GetDestImage("gfx_transformblit");
 
   if (!dest
 #ifdef DYNAMIC_LICE
@@ -1002,7 +1182,9 @@ EEL_F eel_lice_state::gfx_setfont(void *opaque, int np, EEL_F **parms)
 
       if (doCreate)
       {
+        std::lock_guard<ysfx::mutex> lock(ysfx_gfx_text_mutex());
         s->actual_fontname[0]=0;
+        m_gfx_text_extents.clear();
         if (!s->font) s->font=LICE_CreateFont();
         if (s->font)
         {
@@ -1086,7 +1268,7 @@ EEL_F eel_lice_state::gfx_setfont(void *opaque, int np, EEL_F **parms)
 
 void eel_lice_state::gfx_blitext2(int np, EEL_F **parms, int blitmode)
 {
-  LICE_IBitmap *dest = GetImageForIndex(*m_gfx_dest,"gfx_blitext2");
+  LICE_IBitmap *dest = GetDestImage("gfx_blitext2");
 
   if (!dest
 #ifdef DYNAMIC_LICE
@@ -1120,7 +1302,9 @@ void eel_lice_state::gfx_blitext2(int np, EEL_F **parms, int blitmode)
   coords[7]=np > 8 ? parms[8][0] : coords[3]*sc;
  
   const bool isFromFB = bm == m_framebuffer;
-  SetImageDirty(dest);
+  // a rotation may reach out of the rectangle, so it marks all
+  if (blitmode==0 && fabs(angle)>0.000000001) SetImageDirty(dest);
+  else SetImageDirty(dest,(int)floor(coords[4]),(int)floor(coords[5]),(int)ceil(coords[6])+1,(int)ceil(coords[7])+1);
  
   if (bm == dest &&
       (blitmode != 0 || np > 1) && // legacy behavior to matech previous gfx_blit(3parm), do not use temp buffer
@@ -1161,14 +1345,16 @@ void eel_lice_state::gfx_blitext2(int np, EEL_F **parms, int blitmode)
   }
   else
   {
-    LICE_ScaledBlit(dest,bm,(int)coords[4],(int)coords[5],(int)coords[6],(int)coords[7],
-      (float)coords[0],(float)coords[1],(float)coords[2],(float)coords[3], (float)*m_gfx_a,getCurModeForBlit(isFromFB));
+    if (!ysfx::lice_scaled_blit(dest,bm,(int)coords[4],(int)coords[5],(int)coords[6],(int)coords[7],
+      (float)coords[0],(float)coords[1],(float)coords[2],(float)coords[3], (float)*m_gfx_a,getCurModeForBlit(isFromFB)))
+      LICE_ScaledBlit(dest,bm,(int)coords[4],(int)coords[5],(int)coords[6],(int)coords[7],
+        (float)coords[0],(float)coords[1],(float)coords[2],(float)coords[3], (float)*m_gfx_a,getCurModeForBlit(isFromFB));
   }
 }
 
 void eel_lice_state::gfx_blitext(EEL_F img, EEL_F *coords, EEL_F angle)
 {
-  LICE_IBitmap *dest = GetImageForIndex(*m_gfx_dest,"gfx_blitext");
+  LICE_IBitmap *dest = GetDestImage("gfx_blitext");
 
   if (!dest
 #ifdef DYNAMIC_LICE
@@ -1208,8 +1394,10 @@ void eel_lice_state::gfx_blitext(EEL_F img, EEL_F *coords, EEL_F angle)
   }
   else
   {
-    LICE_ScaledBlit(dest,bm,(int)coords[4],(int)coords[5],(int)coords[6],(int)coords[7],
-      (float)coords[0],(float)coords[1],(float)coords[2],(float)coords[3], (float)*m_gfx_a,getCurModeForBlit(isFromFB));
+    if (!ysfx::lice_scaled_blit(dest,bm,(int)coords[4],(int)coords[5],(int)coords[6],(int)coords[7],
+      (float)coords[0],(float)coords[1],(float)coords[2],(float)coords[3], (float)*m_gfx_a,getCurModeForBlit(isFromFB)))
+      LICE_ScaledBlit(dest,bm,(int)coords[4],(int)coords[5],(int)coords[6],(int)coords[7],
+        (float)coords[0],(float)coords[1],(float)coords[2],(float)coords[3], (float)*m_gfx_a,getCurModeForBlit(isFromFB));
   }
 }
 
@@ -1240,7 +1428,7 @@ void eel_lice_state::gfx_getpixel(EEL_F *r, EEL_F *g, EEL_F *b)
 
 
 static int __drawTextWithFont(LICE_IBitmap *dest, const RECT *rect, LICE_IFont *font, const char *buf, int buflen, 
-  int fg, int mode, float alpha, int flags, EEL_F *wantYoutput, EEL_F **measureOnly)
+  int fg, int mode, float alpha, int flags, EEL_F *wantYoutput, EEL_F **measureOnly, eel_lice_text_cache *cache=NULL)
 {
   if (font && LICE_FUNCTION_VALID(LICE__DrawText))
   {
@@ -1255,7 +1443,7 @@ static int __drawTextWithFont(LICE_IBitmap *dest, const RECT *rect, LICE_IFont *
       int thislen = 0;
       while (thislen < buflen && buf[thislen] != '\n') thislen++;
       memset(&r,0,sizeof(r));
-      int lineh = LICE__DrawText(font,dest,buf,thislen?thislen:1,&r,DT_SINGLELINE|DT_NOPREFIX|DT_CALCRECT);
+      int lineh = LICE__MeasureTextLine(font,dest,buf,thislen?thislen:1,&r,cache);
       if (!measureOnly)
       {
         r.right += tr.left;
@@ -1355,15 +1543,14 @@ void eel_lice_state::gfx_drawstr(void *opaque, EEL_F **parms, int nparms, int fo
                           formatmode==2?"gfx_measurestr":
                           formatmode==3?"gfx_measurechar" : "gfx_drawstr";
 
-  LICE_IBitmap *dest = GetImageForIndex(*m_gfx_dest,funcname);
+  // measuring draws nothing, so it leaves a shared image as it is
+  LICE_IBitmap *dest = formatmode>=2 ? GetImageForIndex(*m_gfx_dest,funcname) : GetDestImage(funcname);
   if (!dest) return;
 
 #ifdef DYNAMIC_LICE
   if (!LICE__GetWidth || !LICE__GetHeight) return;
 #endif
 
-  EEL_STRING_MUTEXLOCK_SCOPE
-
   WDL_FastString *fs=NULL;
   char buf[4096];
   int s_len=0;
@@ -1376,6 +1563,10 @@ void eel_lice_state::gfx_drawstr(void *opaque, EEL_F **parms, int nparms, int fo
   }
   else 
   {
+    // the text is copied out, so the drawing doesn't hold the string lock,
+    //   which the audio thread can be waiting for
+    EEL_STRING_MUTEXLOCK_SCOPE
+
     s=EEL_STRING_GET_FOR_INDEX(parms[0][0],&fs);
     #ifdef EEL_STRING_DEBUGOUT
       if (!s) EEL_STRING_DEBUGOUT("gfx_%s: invalid string identifier %f",funcname,parms[0][0]);
@@ -1395,19 +1586,22 @@ void eel_lice_state::gfx_drawstr(void *opaque, EEL_F **parms, int nparms, int fo
     else 
     {
       s_len = fs?fs->GetLength():(int)strlen(s);
+      m_gfx_text.SetRaw(s,s_len);
+      s=m_gfx_text.Get();
     }
   }
 
   if (s_len)
   {
-    SetImageDirty(dest);
     if (formatmode>=2)
     {
+      // measuring draws nothing, though the frame still counts as started
+      SetImageDirty(dest,0,0,0,0);
       if (nfmtparms==2)
       {
         RECT r={0,0,0,0};
         __drawTextWithFont(dest,&r,GetActiveFont(),s,s_len,
-          getCurColor(),getCurMode(),(float)*m_gfx_a,0,NULL,fmtparms);
+          getCurColor(),getCurMode(),(float)*m_gfx_a,0,NULL,fmtparms,&m_gfx_text_extents);
       }
     }
     else
@@ -1421,18 +1615,25 @@ void eel_lice_state::gfx_drawstr(void *opaque, EEL_F **parms, int nparms, int fo
         r.right=(int)*parms[2];
         r.bottom=(int)*parms[3];
       }
+      // a clipped text stays within its rectangle, once it is aligned
+      if (!(flags & DT_NOCLIP)) SetImageDirty(dest,r.left,r.top,r.right-r.left,r.bottom-r.top);
+      else if (flags & (DT_CENTER|DT_RIGHT|DT_VCENTER|DT_BOTTOM)) SetImageDirty(dest);
+      else SetImageDirty(dest,0,0,0,0);
+      const int startx=r.left, starty=r.top;
       *m_gfx_x=__drawTextWithFont(dest,&r,GetActiveFont(),s,s_len,
-        getCurColor(),getCurMode(),(float)*m_gfx_a,flags,m_gfx_y,NULL);
+        getCurColor(),getCurMode(),(float)*m_gfx_a,flags,m_gfx_y,NULL,&m_gfx_text_extents);
+      if ((flags & DT_NOCLIP) && !(flags & (DT_CENTER|DT_RIGHT|DT_VCENTER|DT_BOTTOM)))
+        SetTextDirty(dest,startx,starty,(int)*m_gfx_x,(int)*m_gfx_y,s,s_len);
     }
   }
 }
 
 void eel_lice_state::gfx_drawchar(EEL_F ch)
 {
-  LICE_IBitmap *dest = GetImageForIndex(*m_gfx_dest,"gfx_drawchar");
+  LICE_IBitmap *dest = GetDestImage("gfx_drawchar");
   if (!dest) return;
 
-  SetImageDirty(dest);
+  SetImageDirty(dest,0,0,0,0);
 
   int a=(int)(ch+0.5);
   if (a == '\r' || a=='\n') a=' ';
@@ -1443,17 +1644,18 @@ void eel_lice_state::gfx_drawchar(EEL_F ch)
   RECT r={(int)floor(*m_gfx_x),(int)floor(*m_gfx_y),0,0};
   *m_gfx_x = __drawTextWithFont(dest,&r,
                          GetActiveFont(),buf,buflen,
-                         getCurColor(),getCurMode(),(float)*m_gfx_a,DT_NOCLIP,NULL,NULL);
+                         getCurColor(),getCurMode(),(float)*m_gfx_a,DT_NOCLIP,NULL,NULL,&m_gfx_text_extents);
+  SetTextDirty(dest,r.left,r.top,(int)*m_gfx_x,r.top,buf,buflen);
 
 }
 
 
 void eel_lice_state::gfx_drawnumber(EEL_F n, EEL_F ndigits)
 {
-  LICE_IBitmap *dest = GetImageForIndex(*m_gfx_dest,"gfx_drawnumber");
+  LICE_IBitmap *dest = GetDestImage("gfx_drawnumber");
   if (!dest) return;
 
-  SetImageDirty(dest);
+  SetImageDirty(dest,0,0,0,0);
 
   char buf[512];
   int a=(int)(ndigits+0.5);
@@ -1464,5 +1666,6 @@ void eel_lice_state::gfx_drawnumber(EEL_F n, EEL_F ndigits)
   RECT r={(int)floor(*m_gfx_x),(int)floor(*m_gfx_y),0,0};
   *m_gfx_x = __drawTextWithFont(dest,&r,
                            GetActiveFont(),buf,(int)strlen(buf),
-                           getCurColor(),getCurMode(),(float)*m_gfx_a,DT_NOCLIP,NULL,NULL);
+                           getCurColor(),getCurMode(),(float)*m_gfx_a,DT_NOCLIP,NULL,NULL,&m_gfx_text_extents);
+  SetTextDirty(dest,r.left,r.top,(int)*m_gfx_x,r.top,buf,(int)strlen(buf));
 }
@@ -0,0 +1,166 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+#include "ysfx.hpp"
+#include "ysfx_api_lookahead.hpp"
+#include "ysfx_lookahead.hpp"
+#include "ysfx_eel_utils.hpp"
+#include <vector>
+#include <algorithm>
+
+enum {
+    ysfx_max_lookaheads = 64, // change if it needs more
+    ysfx_max_lookahead_delay = 1 << 20,
+};
+
+static ysfx_lookahead_t *ysfx_get_lookahead(ysfx_t *fx, EEL_F handle_)
+{
+    int32_t handle = ysfx_eel_round<int32_t>(handle_);
+    if (handle < 1 || (uint32_t)handle > fx->lookahead.list.size())
+        return nullptr;
+    return fx->lookahead.list[(uint32_t)handle - 1].get();
+}
+
+// apply a function to the pieces of a buffer of memory which are contiguous;
+//   returns the count of values which it could reach
+template <class Fn>
+static uint32_t ysfx_lookahead_for_ram(ysfx_t *fx, int64_t addr, uint32_t count, Fn &&fn)
+{
+    uint32_t done = 0;
+    while (done < count && addr + done <= 0xFFFFFFFFu) {
+        int32_t valid = 0;
+        EEL_F *values = NSEEL_VM_getramptr(fx->vm.get(), (uint32_t)(addr + done), &valid);
+        if (!values || valid <= 0)
+            break;
+        uint32_t n = std::min<uint32_t>(count - done, (uint32_t)valid);
+        fn(values, n);
+        done += n;
+    }
+    return done;
+}
+
+static EEL_F NSEEL_CGEN_CALL ysfx_api_la_create(void *opaque, INT_PTR np, EEL_F **parms)
+{
+    ysfx_t *fx = (ysfx_t *)opaque;
+    if (ysfx_get_thread_id() == ysfx_thread_id_gfx)
+        return 0;
+
+    int32_t channels = ysfx_eel_round<int32_t>(*parms[0]);
+    int32_t delay = ysfx_eel_round<int32_t>(*parms[1]);
+    int32_t block = (np > 2) ? ysfx_eel_round<int32_t>(*parms[2]) : (int32_t)*fx->var.samplesblock;
+    if (channels < 1 || channels > ysfx_max_channels || delay < 0 || delay > ysfx_max_lookahead_delay)
+        return 0;
+
+    std::vector<ysfx_lookahead_u> &list = fx->lookahead.list;
+    size_t index = 0;
+    while (index < list.size() && list[index])
+        ++index;
+    if (index == ysfx_max_lookaheads)
+        return 0;
+
+    ysfx_lookahead_u la{new ysfx_lookahead_t((uint32_t)channels, (uint32_t)delay, (uint32_t)std::max(block, 1))};
+    if (index == list.size())
+        list.push_back(std::move(la));
+    else
+        list[index] = std::move(la);
+
+    // the effect is late by its longest lookahead
+    if (*fx->var.pdc_delay < (EEL_F)delay)
+        *fx->var.pdc_delay = (EEL_F)delay;
+
+    return (EEL_F)(index + 1);
+}
+
+static EEL_F NSEEL_CGEN_CALL ysfx_api_la_push(void *opaque, EEL_F *handle_, EEL_F *buf_, EEL_F *len_)
+{
+    ysfx_t *fx = (ysfx_t *)opaque;
+    if (ysfx_get_thread_id() == ysfx_thread_id_gfx)
+        return 0;
+
+    ysfx_lookahead_t *la = ysfx_get_lookahead(fx, *handle_);
+    int64_t addr = ysfx_eel_round<int64_t>(*buf_);
+    int64_t len = ysfx_eel_round<int64_t>(*len_);
+    if (!la || addr < 0 || len <= 0)
+        return 0;
+
+    const uint32_t channels = la->channels();
+    uint32_t frames = (uint32_t)std::min<int64_t>(len, la->push_room());
+
+    uint32_t done = ysfx_lookahead_for_ram(fx, addr, frames * channels, [la](EEL_F *values, uint32_t n) {
+        la->push(values, n);
+    });
+    // what the memory lacks of the last frame is silence
+    const EEL_F zero = 0;
+    for (; done % channels != 0; ++done)
+        la->push(&zero, 1);
+
+    return (EEL_F)(done / channels);
+}
+
+static EEL_F NSEEL_CGEN_CALL ysfx_api_la_read(void *opaque, EEL_F *handle_, EEL_F *buf_, EEL_F *len_)
+{
+    ysfx_t *fx = (ysfx_t *)opaque;
+    if (ysfx_get_thread_id() == ysfx_thread_id_gfx)
+        return 0;
+
+    ysfx_lookahead_t *la = ysfx_get_lookahead(fx, *handle_);
+    int64_t addr = ysfx_eel_round<int64_t>(*buf_);
+    int64_t len = ysfx_eel_round<int64_t>(*len_);
+    if (!la || addr < 0 || len <= 0)
+        return 0;
+
+    const uint32_t channels = la->channels();
+    uint32_t frames = (uint32_t)std::min<int64_t>(len, la->read_room());
+
+    uint32_t done = ysfx_lookahead_for_ram(fx, addr, frames * channels, [la](EEL_F *values, uint32_t n) {
+        la->read(values, n);
+    });
+    // the rest of the last frame is dropped, where the memory ends
+    EEL_F dropped;
+    for (; done % channels != 0; ++done)
+        la->read(&dropped, 1);
+
+    return (EEL_F)(done / channels);
+}
+
+static EEL_F NSEEL_CGEN_CALL ysfx_api_la_latency(void *opaque, EEL_F *handle_)
+{
+    ysfx_t *fx = (ysfx_t *)opaque;
+    ysfx_lookahead_t *la = ysfx_get_lookahead(fx, *handle_);
+    return la ? (EEL_F)la->delay() : 0;
+}
+
+static EEL_F NSEEL_CGEN_CALL ysfx_api_la_free(void *opaque, EEL_F *handle_)
+{
+    ysfx_t *fx = (ysfx_t *)opaque;
+    if (ysfx_get_thread_id() == ysfx_thread_id_gfx)
+        return 0;
+
+    int32_t handle = ysfx_eel_round<int32_t>(*handle_);
+    if (!ysfx_get_lookahead(fx, *handle_))
+        return 0;
+    fx->lookahead.list[(uint32_t)handle - 1].reset();
+    return 1;
+}
+
+void ysfx_api_init_lookahead()
+{
+    NSEEL_addfunc_varparm("la_create", 2, NSEEL_PProc_THIS, &ysfx_api_la_create);
+    NSEEL_addfunc_retval("la_push", 3, NSEEL_PProc_THIS, &ysfx_api_la_push);
+    NSEEL_addfunc_retval("la_read", 3, NSEEL_PProc_THIS, &ysfx_api_la_read);
+    NSEEL_addfunc_retval("la_latency", 1, NSEEL_PProc_THIS, &ysfx_api_la_latency);
+    NSEEL_addfunc_retval("la_free", 1, NSEEL_PProc_THIS, &ysfx_api_la_free);
+}
@@ -29,6 +29,112 @@
 
 #define REAPER_GET_INTERFACE(opaque) ((opaque) ? (ysfx_t *)(opaque) : nullptr)
 
+//------------------------------------------------------------------------------
+// `spl(n)` and `slider(n)`; on x64, the compiler copies their code inline in
+//   place of a call, which saves a call per access in the loops over the channels
+//   the placeholders are the count of `spl`, the table of the variables and `ret_temp`
+
+#if !defined(EEL_TARGET_PORTABLE) && (defined(__x86_64__) || defined(_M_X64))
+#   define YSFX_API_INLINE_INDEXED 1
+
+#define YSFX_INLINE_IMM32(x) ((x) & 0xff), (((x) >> 8) & 0xff), (((x) >> 16) & 0xff), (((x) >> 24) & 0xff)
+#define YSFX_INLINE_PLACEHOLDER 0xfe, 0xfe, 0xfe, 0xfe, 0xfe, 0xfe, 0xfe, 0xfe
+#define YSFX_INLINE_ROUND_INDEX                                                   \
+    0xf2, 0x0f, 0x10, 0x00,                         /* movsd xmm0, [rax] */      \
+    0x48, 0xb9, 0x2d, 0x43, 0x1c, 0xeb, 0xe2, 0x36, 0x1a, 0x3f, /* mov rcx, 0.0001 */ \
+    0x66, 0x48, 0x0f, 0x6e, 0xc9,                   /* movq xmm1, rcx */         \
+    0xf2, 0x0f, 0x58, 0xc1,                         /* addsd xmm0, xmm1 */       \
+    0xf2, 0x48, 0x0f, 0x2c, 0xd0                    /* cvttsd2si rdx, xmm0 */
+#define YSFX_INLINE_PLACEHOLDER32 0xfd, 0xfd, 0xfd, 0xfd
+#define YSFX_INLINE_LOOKUP_BY(count)                                              \
+    0x48, 0x81, 0xfa, count,                        /* cmp rdx, count */         \
+    0x73, 0x10,                                     /* jae out */                \
+    0x48, 0xb8, YSFX_INLINE_PLACEHOLDER,            /* mov rax, table */         \
+    0x48, 0x8b, 0x04, 0xd0,                         /* mov rax, [rax + rdx*8] */ \
+    0xeb, 0x11,                                     /* jmp end */                \
+    0x48, 0xb8, YSFX_INLINE_PLACEHOLDER,            /* out: mov rax, ret_temp */ \
+    0x48, 0xc7, 0x00, 0x00, 0x00, 0x00, 0x00        /* mov qword [rax], 0 */
+#define YSFX_INLINE_LOOKUP(count) YSFX_INLINE_LOOKUP_BY(YSFX_INLINE_IMM32(count))
+// the signature which ends a piece of code for the compiler
+#define YSFX_INLINE_END 0x89, 0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0x00
+
+static_assert(sizeof(EEL_F) == 8, "the inline code assumes doubles");
+
+static const unsigned char ysfx_inline_spl[] = {
+    YSFX_INLINE_ROUND_INDEX,
+    YSFX_INLINE_LOOKUP_BY(YSFX_INLINE_PLACEHOLDER32), // the count of channels
+    YSFX_INLINE_END,
+};
+
+static const unsigned char ysfx_inline_slider[] = {
+    YSFX_INLINE_ROUND_INDEX,
+    0x48, 0x83, 0xea, 0x01,                         /* sub rdx, 1 */
+    YSFX_INLINE_LOOKUP(ysfx_max_sliders),
+    YSFX_INLINE_END,
+};
+
+static void *ysfx_inline_set_immediate(void *data, INT_PTR value)
+{
+    const INT_PTR placeholder = (INT_PTR)0xFEFEFEFEFEFEFEFEull;
+    unsigned char *p = (unsigned char *)data;
+    for (;;) {
+        INT_PTR current;
+        memcpy(&current, p, sizeof(current));
+        if (current == placeholder)
+            break;
+        ++p;
+    }
+    memcpy(p, &value, sizeof(value));
+    return p + sizeof(value);
+}
+
+static void *ysfx_inline_set_immediate32(void *data, uint32_t value)
+{
+    const uint32_t placeholder = 0xFDFDFDFDu;
+    unsigned char *p = (unsigned char *)data;
+    for (;;) {
+        uint32_t current;
+        memcpy(&current, p, sizeof(current));
+        if (current == placeholder)
+            break;
+        ++p;
+    }
+    memcpy(p, &value, sizeof(value));
+    return p + sizeof(value);
+}
+
+static void *ysfx_api_spl_pproc(void *data, int data_size, compileContext *ctx)
+{
+    ysfx_t *fx = (ysfx_t *)ctx->caller_this;
+    if (data_size > 0) {
+        // the channels are fixed once the code compiles
+        data = ysfx_inline_set_immediate32(data, (uint32_t)fx->var.spl.size());
+        data = ysfx_inline_set_immediate(data, (INT_PTR)fx->var.spl.data());
+        data = ysfx_inline_set_immediate(data, (INT_PTR)&fx->var.ret_temp);
+    }
+    return data;
+}
+
+static void *ysfx_api_slider_pproc(void *data, int data_size, compileContext *ctx)
+{
+    ysfx_t *fx = (ysfx_t *)ctx->caller_this;
+    if (data_size > 0) {
+        data = ysfx_inline_set_immediate(data, (INT_PTR)fx->var.slider);
+        data = ysfx_inline_set_immediate(data, (INT_PTR)&fx->var.ret_temp);
+    }
+    return data;
+}
+
+#undef YSFX_INLINE_IMM32
+#undef YSFX_INLINE_PLACEHOLDER
+#undef YSFX_INLINE_ROUND_INDEX
+#undef YSFX_INLINE_PLACEHOLDER32
+#undef YSFX_INLINE_LOOKUP_BY
+#undef YSFX_INLINE_LOOKUP
+#undef YSFX_INLINE_END
+
+#else
+
 static EEL_F *NSEEL_CGEN_CALL ysfx_api_spl(void *opaque, EEL_F *n_)
 {
     //NOTE: callable from @gfx thread
@@ -36,7 +142,7 @@ static EEL_F *NSEEL_CGEN_CALL ysfx_api_spl(void *opaque, EEL_F *n_)
     ysfx_t *fx = REAPER_GET_INTERFACE(opaque);
     int32_t n = ysfx_eel_round<int32_t>(*n_);
 
-    if (n < 0 || n >= ysfx_max_channels) {
+    if (n < 0 || (uint32_t)n >= fx->var.spl.size()) {
         fx->var.ret_temp = 0;
         return &fx->var.ret_temp;
     }
@@ -59,7 +165,9 @@ static EEL_F *NSEEL_CGEN_CALL ysfx_api_slider(void *opaque, EEL_F *n_)
     n -= 1;
     return fx->var.slider[(uint32_t)n];
 }
+#endif
 
+//------------------------------------------------------------------------------
 static EEL_F NSEEL_CGEN_CALL ysfx_api_slider_next_chg(void *opaque, EEL_F *index_, EEL_F *val_)
 {
     //TODO frame-accurate slider changes
@@ -92,6 +200,16 @@ static EEL_F NSEEL_CGEN_CALL ysfx_api_slider_automate(void *opaque, INT_PTR npar
     fx->slider.automate_mask[group] |= mask;
     fx->slider.change_mask[group] |= mask;
 
+    // record the timing, for hosts which write automation precisely
+    if (fx->slider.automation.capacity() > 0) {
+        uint32_t offset = (ysfx_get_thread_id() == ysfx_thread_id_dsp) ? fx->split.frame : 0;
+        for (uint32_t i = 0; i < 64; ++i) {
+            uint32_t index = 64 * group + i;
+            if ((mask & ((uint64_t)1 << i)) && fx->source.main->header.sliders[index].exists)
+                fx->slider.automation.push(ysfx_slider_event_t{index, offset, *fx->var.slider[index]});
+        }
+    }
+
     if (nparms > 1) {
         if (ysfx_eel_round<int32_t>(parms[1][0])) {
             fx->slider.touch_mask[group] &= ~mask;
@@ -149,18 +267,30 @@ static EEL_F NSEEL_CGEN_CALL ysfx_api_slider_show(void *opaque, EEL_F *mask_or_s
             mask = ysfx_eel_round<uint64_t>(std::fabs(*mask_or_slider_));
         }
 
+        uint64_t previous;
+        uint64_t changed;
         if (*value_ >= (EEL_F)+0.5) {
             // show
-            fx->slider.visible_mask[group] |= mask;
+            previous = fx->slider.visible_mask[group].fetch_or(mask);
+            changed = ~previous & mask;
         }
         else if (*value_ >= (EEL_F)-0.5) {
             // hide
+            previous = fx->slider.visible_mask[group].fetch_and(~mask);
+            changed = previous & mask;
             mask = ~mask;
-            fx->slider.visible_mask[group] &= mask;
         }
         else {
             // toggle
-            mask = fx->slider.visible_mask[group].fetch_xor(mask) ^ mask;
+            previous = fx->slider.visible_mask[group].fetch_xor(mask);
+            changed = mask;
+            mask = previous ^ mask;
+        }
+
+        if (changed) {
+            fx->slider.visible_change_mask[group].fetch_or(changed);
+            if (fx->slider.visible_callback)
+                fx->slider.visible_callback(fx->slider.visible_callback_data);
         }
         return (EEL_F)mask;
     }
@@ -452,6 +582,56 @@ static EEL_F NSEEL_CGEN_CALL ysfx_api_midirecv_str(void *opaque, EEL_F *offset_,
 }
 
 
+static EEL_F NSEEL_CGEN_CALL ysfx_api_midisend_ump(void *opaque, EEL_F *offset_, EEL_F *buf_)
+{
+    if (ysfx_get_thread_id() != ysfx_thread_id_dsp)
+        return 0;
+
+    int32_t offset = ysfx_eel_round<int32_t>(*offset_);
+    int32_t buf = ysfx_eel_round<int32_t>(*buf_);
+
+    if (offset < 0)
+        offset = 0;
+
+    ysfx_t *fx = REAPER_GET_INTERFACE(opaque);
+
+    ysfx_ump_event_t event;
+    event.bus = ysfx_current_midi_bus(fx);
+    event.offset = (uint32_t)offset;
+
+    ysfx_eel_ram_reader reader{fx->vm.get(), buf};
+    event.data[0] = (uint32_t)ysfx_eel_round<int64_t>(reader.read_next());
+    event.size = ysfx_ump_sizeof(event.data[0]);
+    for (uint32_t i = 1; i < event.size; ++i)
+        event.data[i] = (uint32_t)ysfx_eel_round<int64_t>(reader.read_next());
+
+    if (!ysfx_midi_push_ump(fx->midi.out.get(), &event))
+        return 0;
+
+    return event.size;
+}
+
+static EEL_F NSEEL_CGEN_CALL ysfx_api_midirecv_ump(void *opaque, EEL_F *offset_, EEL_F *buf_)
+{
+    if (ysfx_get_thread_id() != ysfx_thread_id_dsp)
+        return 0;
+
+    ysfx_t *fx = REAPER_GET_INTERFACE(opaque);
+    int32_t buf = ysfx_eel_round<int32_t>(*buf_);
+
+    ysfx_ump_event_t event;
+    if (!ysfx_midi_get_next_ump_from_bus(fx->midi.in.get(), ysfx_current_midi_bus(fx), &event))
+        return 0;
+
+    *offset_ = (EEL_F)event.offset;
+
+    ysfx_eel_ram_writer writer{fx->vm.get(), buf};
+    for (uint32_t i = 0; i < event.size; ++i)
+        writer.write_next((EEL_F)event.data[i]);
+
+    return event.size;
+}
+
 static EEL_F NSEEL_CGEN_CALL ysfx_api_strcpy_from_slider(void *opaque, EEL_F *str_, EEL_F *slider_)
 {
     int32_t handle = ysfx_eel_round<int32_t>(*slider_);
@@ -469,24 +649,30 @@ static EEL_F NSEEL_CGEN_CALL ysfx_api_strcpy_from_slider(void *opaque, EEL_F *st
     }
 
     uint32_t enum_idx = static_cast<uint32_t>(ysfx_slider_get_value(fx, slider_idx));
-    
-    const char* path = ysfx_slider_path(fx, slider_idx);
-    std::string name{ysfx_slider_get_enum_name(fx, slider_idx, enum_idx)};
-    std::string full_name;
-    if (path) {
-        std::string root{path};
-        root.erase(0, 1);
-        full_name = root + "/" + name;
-    } else {
-        full_name = name;
+
+    // written in place, so it allocates nothing once the string has grown
+    struct process_data {
+        const char *path = nullptr;
+        const char *name = nullptr;
     };
 
+    process_data pdata;
+    pdata.path = ysfx_slider_path(fx, slider_idx);
+    pdata.name = ysfx_slider_get_enum_name(fx, slider_idx, enum_idx);
+
     auto process_str = [](void *userdata, WDL_FastString &str) {
-        std::string *value = (std::string *)userdata;
-        str.SetRaw(value->c_str(), (int32_t)value->size());
+        process_data *pdata = (process_data *)userdata;
+        if (pdata->path) {
+            // the path without its first character
+            str.Set(pdata->path[0] ? (pdata->path + 1) : "");
+            str.Append("/");
+            str.Append(pdata->name);
+        }
+        else
+            str.Set(pdata->name);
     };
 
-    if (!ysfx_string_access(fx, *str_, true, +process_str, &full_name))
+    if (!ysfx_string_access(fx, *str_, true, +process_str, &pdata))
         return 0;
     
     return *str_;
@@ -495,8 +681,13 @@ static EEL_F NSEEL_CGEN_CALL ysfx_api_strcpy_from_slider(void *opaque, EEL_F *st
 //------------------------------------------------------------------------------
 void ysfx_api_init_reaper()
 {
+#if defined(YSFX_API_INLINE_INDEXED)
+    NSEEL_addfunctionex2("spl", 1, (char *)ysfx_inline_spl, 0, &ysfx_api_spl_pproc, nullptr, nullptr, NSEEL_ADDFUNC_DESTINATION);
+    NSEEL_addfunctionex2("slider", 1, (char *)ysfx_inline_slider, 0, &ysfx_api_slider_pproc, nullptr, nullptr, NSEEL_ADDFUNC_DESTINATION);
+#else
     NSEEL_addfunc_retptr("spl", 1, NSEEL_PProc_THIS, &ysfx_api_spl);
     NSEEL_addfunc_retptr("slider", 1, NSEEL_PProc_THIS, &ysfx_api_slider);
+#endif
 
     NSEEL_addfunc_retval("slider_next_chg", 2, NSEEL_PProc_THIS, &ysfx_api_slider_next_chg);
     NSEEL_addfunc_varparm("slider_automate", 1, NSEEL_PProc_THIS, &ysfx_api_slider_automate);
@@ -512,6 +703,8 @@ void ysfx_api_init_reaper()
     NSEEL_addfunc_retval("midirecv_buf", 3, NSEEL_PProc_THIS, &ysfx_api_midirecv_buf);
     NSEEL_addfunc_retval("midirecv_str", 2, NSEEL_PProc_THIS, &ysfx_api_midirecv_str);
     NSEEL_addfunc_retval("midisyx", 3, NSEEL_PProc_THIS, &ysfx_api_midisyx);
+    NSEEL_addfunc_retval("midisend_ump", 2, NSEEL_PProc_THIS, &ysfx_api_midisend_ump);
+    NSEEL_addfunc_retval("midirecv_ump", 2, NSEEL_PProc_THIS, &ysfx_api_midirecv_ump);
 
     NSEEL_addfunc_retval("strcpy_fromslider", 2, NSEEL_PProc_THIS, &ysfx_api_strcpy_from_slider);
 }
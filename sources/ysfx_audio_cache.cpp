@@ -0,0 +1,109 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+#include "ysfx_audio_cache.hpp"
+#include <algorithm>
+
+static uint64_t ysfx_audio_cache_sizeof(const ysfx_decoded_audio_t &audio)
+{
+    return audio.samples.size() * sizeof(ysfx_real);
+}
+
+static void ysfx_audio_cache_trim(ysfx_audio_cache_t &cache, uint64_t max_bytes)
+{
+    while (cache.num_bytes > max_bytes && !cache.lru.empty()) {
+        ysfx_audio_cache_t::entry_t &entry = cache.lru.back();
+        cache.num_bytes -= ysfx_audio_cache_sizeof(*entry.audio);
+        cache.index.erase(entry.key);
+        cache.lru.pop_back();
+    }
+}
+
+static ysfx_decoded_audio_sp ysfx_audio_decode(const ysfx_audio_format_t &fmt, const char *path, uint64_t max_bytes)
+{
+    std::unique_ptr<ysfx_audio_reader_t, void (*)(ysfx_audio_reader_t *)> reader{fmt.open(path), fmt.close};
+    if (!reader)
+        return nullptr;
+
+    uint64_t count = fmt.avail(reader.get());
+    if (count > max_bytes / sizeof(ysfx_real))
+        return nullptr;
+
+    std::shared_ptr<ysfx_decoded_audio_t> audio{new ysfx_decoded_audio_t};
+    audio->info = fmt.info(reader.get());
+    audio->samples.resize((size_t)count);
+
+    uint64_t numread = 0;
+    while (numread < count) {
+        uint64_t n = std::min<uint64_t>(count - numread, 65536);
+        uint64_t m = fmt.read(reader.get(), &audio->samples[(size_t)numread], n);
+        numread += m;
+        if (m < n)
+            break;
+    }
+    audio->samples.resize((size_t)numread);
+
+    return audio;
+}
+
+ysfx_decoded_audio_sp ysfx_audio_cache_get(ysfx_audio_cache_t &cache, const ysfx_audio_format_t &fmt, const char *path)
+{
+    ysfx_audio_cache_key_t key;
+    {
+        ysfx::FILE_u stream{ysfx::fopen_utf8(path, "rb")};
+        if (!stream || !ysfx::get_stream_file_uid(stream.get(), key.uid) || !ysfx::get_stream_file_stamp(stream.get(), key.stamp))
+            return nullptr;
+    }
+
+    uint64_t max_bytes;
+    {
+        std::lock_guard<std::mutex> lock(cache.mutex);
+        auto it = cache.index.find(key);
+        if (it != cache.index.end()) {
+            cache.lru.splice(cache.lru.begin(), cache.lru, it->second);
+            return it->second->audio;
+        }
+        max_bytes = cache.max_bytes;
+    }
+
+    // NOTE: decode outside of the lock; if two effects decode the same file
+    //   at once, the one which finishes first publishes its version
+    ysfx_decoded_audio_sp audio = ysfx_audio_decode(fmt, path, max_bytes);
+    if (!audio)
+        return nullptr;
+
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    auto it = cache.index.find(key);
+    if (it != cache.index.end()) {
+        cache.lru.splice(cache.lru.begin(), cache.lru, it->second);
+        return it->second->audio;
+    }
+
+    uint64_t size = ysfx_audio_cache_sizeof(*audio);
+    ysfx_audio_cache_trim(cache, (cache.max_bytes > size) ? (cache.max_bytes - size) : 0);
+    cache.lru.push_front(ysfx_audio_cache_t::entry_t{key, audio});
+    cache.index[key] = cache.lru.begin();
+    cache.num_bytes += size;
+
+    return audio;
+}
+
+void ysfx_audio_cache_resize(ysfx_audio_cache_t &cache, uint64_t max_bytes)
+{
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    cache.max_bytes = max_bytes;
+    ysfx_audio_cache_trim(cache, max_bytes);
+}
@@ -0,0 +1,66 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+#pragma once
+#include "ysfx.h"
+#include "ysfx_utils.hpp"
+#include <vector>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+
+// an audio file which is decoded in whole; immutable once published
+struct ysfx_decoded_audio_t {
+    ysfx_audio_file_info_t info{};
+    std::vector<ysfx_real> samples;
+};
+using ysfx_decoded_audio_sp = std::shared_ptr<const ysfx_decoded_audio_t>;
+
+// identifies a version of a file, independently of the path to it
+struct ysfx_audio_cache_key_t {
+    ysfx::file_uid uid;
+    ysfx::file_stamp stamp;
+    bool operator<(const ysfx_audio_cache_key_t &other) const
+    {
+        return (uid != other.uid) ? (uid < other.uid) : (stamp < other.stamp);
+    }
+};
+
+// decoded audio files, which the effects share; the least recently used are
+//   released past the size limit, but stay alive as long as files use them
+struct ysfx_audio_cache_t {
+    explicit ysfx_audio_cache_t(uint64_t max_bytes) : max_bytes(max_bytes) {}
+
+    struct entry_t {
+        ysfx_audio_cache_key_t key;
+        ysfx_decoded_audio_sp audio;
+    };
+
+    std::mutex mutex;
+    uint64_t max_bytes = 0;
+    uint64_t num_bytes = 0;
+    // the most recently used at the front
+    std::list<entry_t> lru;
+    std::map<ysfx_audio_cache_key_t, std::list<entry_t>::iterator> index;
+};
+using ysfx_audio_cache_sp = std::shared_ptr<ysfx_audio_cache_t>;
+
+// get the decoded contents of the audio file, decoding it if it is not cached yet
+//   files which do not fit in the cache are not decoded, and null is returned
+ysfx_decoded_audio_sp ysfx_audio_cache_get(ysfx_audio_cache_t &cache, const ysfx_audio_format_t &fmt, const char *path);
+// change the size limit, and release what no longer fits
+void ysfx_audio_cache_resize(ysfx_audio_cache_t &cache, uint64_t max_bytes);
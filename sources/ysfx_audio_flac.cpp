@@ -17,6 +17,8 @@
 
 #include "ysfx_audio_flac.hpp"
 #include "ysfx_utils.hpp"
+#include "ysfx_package.hpp"
+#include "ysfx_convert.hpp"
 #include <memory>
 #include <cstring>
 
@@ -41,6 +43,8 @@ using drflac_u = std::unique_ptr<drflac, drflac_u_deleter>;
 
 ///
 struct ysfx_flac_reader_t {
+    // the entry of a package, which the decoder reads in place
+    ysfx_package_data_sp packaged;
     drflac_u flac;
     uint32_t nbuff = 0;
     std::unique_ptr<float[]> buff;
@@ -53,14 +57,21 @@ static bool ysfx_flac_can_handle(const char *path)
 
 static ysfx_audio_reader_t *ysfx_flac_open(const char *path)
 {
+    ysfx_package_data_sp packaged = ysfx_package_read(path);
+    drflac_u flac;
+    if (packaged)
+        flac.reset(drflac_open_memory(packaged->data, packaged->size, NULL));
+    else {
 #if !defined(_WIN32)
-    drflac_u flac{drflac_open_file(path, NULL)};
+        flac.reset(drflac_open_file(path, NULL));
 #else
-    drflac_u flac{drflac_open_file_w(ysfx::widen(path).c_str(), NULL)};
+        flac.reset(drflac_open_file_w(ysfx::widen(path).c_str(), NULL));
 #endif
+    }
     if (!flac)
         return nullptr;
     std::unique_ptr<ysfx_flac_reader_t> reader{new ysfx_flac_reader_t};
+    reader->packaged = std::move(packaged);
     reader->flac = std::move(flac);
     reader->buff.reset(new float[reader->flac->channels]);
     return (ysfx_audio_reader_t *)reader.release();
@@ -134,9 +145,7 @@ static uint64_t ysfx_flac_read(ysfx_audio_reader_t *reader_, ysfx_real *samples,
         float *f32buf = (float *)samples;
         uint64_t readframes = drflac_read_pcm_frames_f32(reader->flac.get(), count / channels, f32buf);
         uint64_t readsamples = channels * readframes;
-        // f32->f64
-        for (uint64_t i = readsamples; i-- > 0; )
-            samples[i] = f32buf[i];
+        ysfx::widen_in_place(samples, readsamples);
         samples += readsamples;
         count -= readsamples;
         readtotal += readsamples;
@@ -0,0 +1,195 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#if !defined(YSFX_NO_MP3)
+#include "ysfx_audio_mp3.hpp"
+#include "ysfx_utils.hpp"
+#include "ysfx_package.hpp"
+#include "ysfx_convert.hpp"
+#include <memory>
+#include <cstring>
+
+#if defined(__GNUC__)
+#   pragma GCC diagnostic push
+#   pragma GCC diagnostic ignored "-Wunused-function"
+#endif
+
+#define DR_MP3_IMPLEMENTATION
+#define DRMP3_API static
+#define DRMP3_PRIVATE static
+#include "dr_mp3.h"
+
+#if defined(__GNUC__)
+#   pragma GCC diagnostic pop
+#endif
+
+struct ysfx_mp3_reader_t {
+    ~ysfx_mp3_reader_t() { drmp3_uninit(mp3.get()); }
+    // the entry of a package, which the decoder reads in place
+    ysfx_package_data_sp packaged;
+    std::unique_ptr<drmp3> mp3;
+    uint64_t total_frames = 0;
+    // one point per MP3 frame, so that rewinding does not decode from the top
+    std::unique_ptr<drmp3_seek_point[]> seek_points;
+    uint32_t nbuff = 0;
+    std::unique_ptr<float[]> buff;
+};
+
+static bool ysfx_mp3_can_handle(const char *path)
+{
+    return ysfx::path_has_suffix(path, "mp3");
+}
+
+static ysfx_audio_reader_t *ysfx_mp3_open(const char *path)
+{
+    std::unique_ptr<drmp3> mp3{new drmp3};
+    ysfx_package_data_sp packaged = ysfx_package_read(path);
+    drmp3_bool32 initok;
+    if (packaged)
+        initok = drmp3_init_memory(mp3.get(), packaged->data, packaged->size, nullptr);
+    else {
+#if !defined(_WIN32)
+        initok = drmp3_init_file(mp3.get(), path, nullptr);
+#else
+        initok = drmp3_init_file_w(mp3.get(), ysfx::widen(path).c_str(), nullptr);
+#endif
+    }
+    if (!initok)
+        return nullptr;
+    std::unique_ptr<ysfx_mp3_reader_t> reader{new ysfx_mp3_reader_t};
+    reader->packaged = std::move(packaged);
+    reader->mp3 = std::move(mp3);
+
+    // MP3 has no length in the header, so scan the frames once
+    //   and keep the positions as a table for the later seeks
+    drmp3_uint64 mp3_frames = 0;
+    drmp3_uint64 pcm_frames = 0;
+    if (!drmp3_get_mp3_and_pcm_frame_count(reader->mp3.get(), &mp3_frames, &pcm_frames))
+        return nullptr;
+    reader->total_frames = pcm_frames;
+
+    drmp3_uint32 num_points = (mp3_frames < 0xffffffffu) ? (drmp3_uint32)mp3_frames : 0xffffffffu;
+    if (num_points > 0) {
+        reader->seek_points.reset(new drmp3_seek_point[num_points]);
+        if (drmp3_calculate_seek_points(reader->mp3.get(), &num_points, reader->seek_points.get()))
+            drmp3_bind_seek_table(reader->mp3.get(), num_points, reader->seek_points.get());
+    }
+
+    reader->buff.reset(new float[reader->mp3->channels]);
+    return (ysfx_audio_reader_t *)reader.release();
+}
+
+static void ysfx_mp3_close(ysfx_audio_reader_t *reader_)
+{
+    ysfx_mp3_reader_t *reader = (ysfx_mp3_reader_t *)reader_;
+    delete reader;
+}
+
+static ysfx_audio_file_info_t ysfx_mp3_info(ysfx_audio_reader_t *reader_)
+{
+    ysfx_mp3_reader_t *reader = (ysfx_mp3_reader_t *)reader_;
+    ysfx_audio_file_info_t info;
+    info.channels = reader->mp3->channels;
+    info.sample_rate = (ysfx_real)reader->mp3->sampleRate;
+    return info;
+}
+
+static uint64_t ysfx_mp3_avail(ysfx_audio_reader_t *reader_)
+{
+    ysfx_mp3_reader_t *reader = (ysfx_mp3_reader_t *)reader_;
+    uint64_t current = reader->mp3->currentPCMFrame;
+    uint64_t remaining = (current < reader->total_frames) ? (reader->total_frames - current) : 0;
+    return reader->nbuff + reader->mp3->channels * remaining;
+}
+
+static void ysfx_mp3_rewind(ysfx_audio_reader_t *reader_)
+{
+    ysfx_mp3_reader_t *reader = (ysfx_mp3_reader_t *)reader_;
+    drmp3_seek_to_pcm_frame(reader->mp3.get(), 0);
+    reader->nbuff = 0;
+}
+
+static uint64_t ysfx_mp3_unload_buffer(ysfx_audio_reader_t *reader_, ysfx_real *samples, uint64_t count)
+{
+    ysfx_mp3_reader_t *reader = (ysfx_mp3_reader_t *)reader_;
+
+    uint32_t nbuff = reader->nbuff;
+    if (nbuff > count)
+        nbuff = (uint32_t)count;
+
+    if (nbuff == 0)
+        return 0;
+
+    const float *src = &reader->buff[reader->mp3->channels - reader->nbuff];
+    for (uint32_t i = 0; i < nbuff; ++i)
+        samples[i] = src[i];
+
+    reader->nbuff -= nbuff;
+    return nbuff;
+}
+
+static uint64_t ysfx_mp3_read(ysfx_audio_reader_t *reader_, ysfx_real *samples, uint64_t count)
+{
+    ysfx_mp3_reader_t *reader = (ysfx_mp3_reader_t *)reader_;
+    uint32_t channels = reader->mp3->channels;
+    uint64_t readtotal = 0;
+
+    if (count == 0)
+        return readtotal;
+    else {
+        uint64_t copied = ysfx_mp3_unload_buffer(reader_, samples, count);
+        samples += copied;
+        count -= copied;
+        readtotal += copied;
+    }
+
+    if (count == 0)
+        return readtotal;
+    else {
+        float *f32buf = (float *)samples;
+        uint64_t readframes = drmp3_read_pcm_frames_f32(reader->mp3.get(), count / channels, f32buf);
+        uint64_t readsamples = channels * readframes;
+        ysfx::widen_in_place(samples, readsamples);
+        samples += readsamples;
+        count -= readsamples;
+        readtotal += readsamples;
+    }
+
+    if (count == 0)
+        return readtotal;
+    else if (drmp3_read_pcm_frames_f32(reader->mp3.get(), 1, reader->buff.get()) == 1) {
+        reader->nbuff = channels;
+        uint64_t copied = ysfx_mp3_unload_buffer(reader_, samples, count);
+        samples += copied;
+        count -= copied;
+        readtotal += copied;
+    }
+
+    return readtotal;
+}
+
+const ysfx_audio_format_t ysfx_audio_format_mp3 = {
+    &ysfx_mp3_can_handle,
+    &ysfx_mp3_open,
+    &ysfx_mp3_close,
+    &ysfx_mp3_info,
+    &ysfx_mp3_avail,
+    &ysfx_mp3_rewind,
+    &ysfx_mp3_read,
+};
+
+#endif // !defined(YSFX_NO_MP3)
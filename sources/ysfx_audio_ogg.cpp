@@ -0,0 +1,225 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#if !defined(YSFX_NO_OGG)
+#include "ysfx_audio_ogg.hpp"
+#include "ysfx_utils.hpp"
+#include "ysfx_package.hpp"
+#include "ysfx_convert.hpp"
+#include <memory>
+#include <cstring>
+#include <cstdio>
+#include <climits>
+
+#if defined(__GNUC__)
+#   pragma GCC diagnostic push
+#   pragma GCC diagnostic ignored "-Wunused-function"
+#   pragma GCC diagnostic ignored "-Wunused-value"
+#endif
+
+#define STB_VORBIS_NO_PUSHDATA_API
+#include "stb_vorbis.c"
+
+#if defined(__GNUC__)
+#   pragma GCC diagnostic pop
+#endif
+
+struct stb_vorbis_u_deleter {
+    void operator()(stb_vorbis *x) const noexcept { stb_vorbis_close(x); }
+};
+using stb_vorbis_u = std::unique_ptr<stb_vorbis, stb_vorbis_u_deleter>;
+
+///
+struct ysfx_ogg_reader_t {
+    // the entry of a package, which the decoder reads in place
+    ysfx_package_data_sp packaged;
+    stb_vorbis_u vorbis;
+    uint32_t channels = 0;
+    uint32_t sample_rate = 0;
+    uint64_t total_frames = 0;
+    uint64_t current_frame = 0;
+    uint32_t nbuff = 0;
+    std::unique_ptr<float[]> buff;
+};
+
+static bool ysfx_ogg_can_handle(const char *path)
+{
+    return ysfx::path_has_suffix(path, "ogg");
+}
+
+static ysfx_audio_reader_t *ysfx_ogg_open(const char *path)
+{
+    int error = 0;
+    stb_vorbis_u vorbis;
+    ysfx_package_data_sp packaged = ysfx_package_read(path);
+    if (packaged) {
+        if (packaged->size > INT_MAX)
+            return nullptr;
+        vorbis.reset(stb_vorbis_open_memory(packaged->data, (int)packaged->size, &error, nullptr));
+        if (!vorbis)
+            return nullptr;
+    }
+    else {
+        // open the stream ourselves, since the decoder does not handle UTF-8 on Windows
+        FILE *stream = ysfx::fopen_utf8(path, "rb");
+        if (!stream)
+            return nullptr;
+        vorbis.reset(stb_vorbis_open_file(stream, true, &error, nullptr));
+        if (!vorbis) {
+            fclose(stream);
+            return nullptr;
+        }
+    }
+
+    stb_vorbis_info vinfo = stb_vorbis_get_info(vorbis.get());
+    if (vinfo.channels <= 0)
+        return nullptr;
+
+    std::unique_ptr<ysfx_ogg_reader_t> reader{new ysfx_ogg_reader_t};
+    reader->channels = (uint32_t)vinfo.channels;
+    reader->sample_rate = vinfo.sample_rate;
+    // the decoder finds the length from the last page, without decoding the stream
+    reader->total_frames = stb_vorbis_stream_length_in_samples(vorbis.get());
+    reader->packaged = std::move(packaged);
+    reader->vorbis = std::move(vorbis);
+    reader->buff.reset(new float[reader->channels]);
+    return (ysfx_audio_reader_t *)reader.release();
+}
+
+static void ysfx_ogg_close(ysfx_audio_reader_t *reader_)
+{
+    ysfx_ogg_reader_t *reader = (ysfx_ogg_reader_t *)reader_;
+    delete reader;
+}
+
+static ysfx_audio_file_info_t ysfx_ogg_info(ysfx_audio_reader_t *reader_)
+{
+    ysfx_ogg_reader_t *reader = (ysfx_ogg_reader_t *)reader_;
+    ysfx_audio_file_info_t info;
+    info.channels = reader->channels;
+    info.sample_rate = (ysfx_real)reader->sample_rate;
+    return info;
+}
+
+static uint64_t ysfx_ogg_avail(ysfx_audio_reader_t *reader_)
+{
+    ysfx_ogg_reader_t *reader = (ysfx_ogg_reader_t *)reader_;
+    uint64_t current = reader->current_frame;
+    uint64_t remaining = (current < reader->total_frames) ? (reader->total_frames - current) : 0;
+    return reader->nbuff + reader->channels * remaining;
+}
+
+static void ysfx_ogg_rewind(ysfx_audio_reader_t *reader_)
+{
+    ysfx_ogg_reader_t *reader = (ysfx_ogg_reader_t *)reader_;
+    stb_vorbis_seek_start(reader->vorbis.get());
+    reader->current_frame = 0;
+    reader->nbuff = 0;
+}
+
+static uint64_t ysfx_ogg_unload_buffer(ysfx_audio_reader_t *reader_, ysfx_real *samples, uint64_t count)
+{
+    ysfx_ogg_reader_t *reader = (ysfx_ogg_reader_t *)reader_;
+
+    uint32_t nbuff = reader->nbuff;
+    if (nbuff > count)
+        nbuff = (uint32_t)count;
+
+    if (nbuff == 0)
+        return 0;
+
+    const float *src = &reader->buff[reader->channels - reader->nbuff];
+    for (uint32_t i = 0; i < nbuff; ++i)
+        samples[i] = src[i];
+
+    reader->nbuff -= nbuff;
+    return nbuff;
+}
+
+static uint64_t ysfx_ogg_read_frames(ysfx_ogg_reader_t *reader, uint64_t frames, float *dest)
+{
+    uint32_t channels = reader->channels;
+    uint64_t readframes = 0;
+
+    // the decoder counts in int, so read large requests in pieces
+    while (readframes < frames) {
+        uint64_t want = frames - readframes;
+        const uint64_t maxwant = 0x7fffffff / channels;
+        if (want > maxwant)
+            want = maxwant;
+        int got = stb_vorbis_get_samples_float_interleaved(
+            reader->vorbis.get(), (int)channels, &dest[readframes * channels], (int)(want * channels));
+        if (got <= 0)
+            break;
+        readframes += (uint64_t)got;
+    }
+
+    reader->current_frame += readframes;
+    return readframes;
+}
+
+static uint64_t ysfx_ogg_read(ysfx_audio_reader_t *reader_, ysfx_real *samples, uint64_t count)
+{
+    ysfx_ogg_reader_t *reader = (ysfx_ogg_reader_t *)reader_;
+    uint32_t channels = reader->channels;
+    uint64_t readtotal = 0;
+
+    if (count == 0)
+        return readtotal;
+    else {
+        uint64_t copied = ysfx_ogg_unload_buffer(reader_, samples, count);
+        samples += copied;
+        count -= copied;
+        readtotal += copied;
+    }
+
+    if (count == 0)
+        return readtotal;
+    else {
+        float *f32buf = (float *)samples;
+        uint64_t readframes = ysfx_ogg_read_frames(reader, count / channels, f32buf);
+        uint64_t readsamples = channels * readframes;
+        ysfx::widen_in_place(samples, readsamples);
+        samples += readsamples;
+        count -= readsamples;
+        readtotal += readsamples;
+    }
+
+    if (count == 0)
+        return readtotal;
+    else if (ysfx_ogg_read_frames(reader, 1, reader->buff.get()) == 1) {
+        reader->nbuff = channels;
+        uint64_t copied = ysfx_ogg_unload_buffer(reader_, samples, count);
+        samples += copied;
+        count -= copied;
+        readtotal += copied;
+    }
+
+    return readtotal;
+}
+
+const ysfx_audio_format_t ysfx_audio_format_ogg = {
+    &ysfx_ogg_can_handle,
+    &ysfx_ogg_open,
+    &ysfx_ogg_close,
+    &ysfx_ogg_info,
+    &ysfx_ogg_avail,
+    &ysfx_ogg_rewind,
+    &ysfx_ogg_read,
+};
+
+#endif // !defined(YSFX_NO_OGG)
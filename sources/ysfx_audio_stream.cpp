@@ -0,0 +1,139 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+#include "ysfx_audio_stream.hpp"
+#include <algorithm>
+
+ysfx_audio_stream_t::ysfx_audio_stream_t(const ysfx_audio_format_t &fmt, ysfx_audio_reader_t *reader, uint32_t capacity)
+    : m_fmt(fmt),
+      m_reader(reader),
+      m_total(fmt.avail(reader)),
+      m_capacity(std::max<uint32_t>(capacity, 16)),
+      m_chunk(std::min<uint32_t>(m_capacity / 4, 4096)),
+      m_ring(new ysfx_real[m_capacity])
+{
+    m_thread = std::thread([this]() { run(); });
+}
+
+ysfx_audio_stream_t::~ysfx_audio_stream_t()
+{
+    m_quit.store(true);
+    m_wake.post();
+    m_thread.join();
+}
+
+uint64_t ysfx_audio_stream_t::avail() const
+{
+    uint64_t pos = m_read_pos.load(std::memory_order_relaxed);
+    return (pos < m_total) ? (m_total - pos) : 0;
+}
+
+void ysfx_audio_stream_t::rewind()
+{
+    m_rewind.store(true);
+    wake_thread();
+    while (m_rewind.load())
+        wait_thread();
+}
+
+uint64_t ysfx_audio_stream_t::read(ysfx_real *samples, uint64_t count)
+{
+    uint64_t numread = 0;
+
+    while (numread < count) {
+        uint64_t rpos = m_read_pos.load(std::memory_order_relaxed);
+        bool eof = m_eof.load();
+        uint64_t wpos = m_write_pos.load();
+
+        uint64_t n = std::min<uint64_t>(count - numread, wpos - rpos);
+        for (uint64_t i = 0; i < n; ++i)
+            samples[numread + i] = m_ring[(rpos + i) % m_capacity];
+        numread += n;
+
+        if (n > 0) {
+            m_read_pos.store(rpos + n);
+            wake_thread();
+        }
+        else if (eof)
+            break;
+        else {
+            // NOTE: this waits only when the read-ahead did not keep up
+            wait_thread();
+        }
+    }
+
+    return numread;
+}
+
+void ysfx_audio_stream_t::wake_thread()
+{
+    if (m_idle.exchange(false))
+        m_wake.post();
+}
+
+void ysfx_audio_stream_t::wait_thread()
+{
+    m_waiting.store(true);
+    wake_thread();
+    m_ready.wait();
+}
+
+bool ysfx_audio_stream_t::has_work() const
+{
+    if (m_quit.load() || m_rewind.load())
+        return true;
+    if (m_eof.load())
+        return false;
+    uint64_t used = m_write_pos.load() - m_read_pos.load();
+    uint64_t free = m_capacity - used;
+    return free >= m_chunk || (free > 0 && m_waiting.load());
+}
+
+void ysfx_audio_stream_t::run()
+{
+    while (!m_quit.load()) {
+        if (m_rewind.load()) {
+            m_fmt.rewind(m_reader);
+            m_read_pos.store(0);
+            m_write_pos.store(0);
+            m_eof.store(false);
+            m_rewind.store(false);
+        }
+        else if (has_work()) {
+            // fill the contiguous part of the free space, by a chunk at most
+            uint64_t wpos = m_write_pos.load(std::memory_order_relaxed);
+            uint64_t free = m_capacity - (wpos - m_read_pos.load());
+            uint32_t start = (uint32_t)(wpos % m_capacity);
+            uint64_t n = std::min<uint64_t>({free, m_chunk, m_capacity - start});
+            uint64_t m = m_fmt.read(m_reader, &m_ring[start], n);
+            m_write_pos.store(wpos + m);
+            if (m < n)
+                m_eof.store(true);
+        }
+
+        if (m_waiting.exchange(false))
+            m_ready.post();
+
+        if (!has_work()) {
+            m_idle.store(true);
+            // NOTE: the work may have come just before becoming idle; in which
+            //   case, the semaphore has been posted or is about to be
+            if (has_work() && m_idle.exchange(false))
+                continue;
+            m_wake.wait();
+        }
+    }
+}
@@ -0,0 +1,62 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+#pragma once
+#include "ysfx.h"
+#include "utility/rt_semaphore.h"
+#include <thread>
+#include <atomic>
+#include <memory>
+
+// reads an audio file ahead of the cursor on a thread of its own, into a ring
+//   buffer; the reader belongs to that thread, and the consumer only copies
+//   from memory, unless it gets ahead of the thread
+struct ysfx_audio_stream_t {
+    ysfx_audio_stream_t(const ysfx_audio_format_t &fmt, ysfx_audio_reader_t *reader, uint32_t capacity);
+    ~ysfx_audio_stream_t();
+
+    uint64_t avail() const;
+    void rewind();
+    uint64_t read(ysfx_real *samples, uint64_t count);
+
+private:
+    void run();
+    bool has_work() const;
+    void wake_thread();
+    void wait_thread();
+
+    const ysfx_audio_format_t &m_fmt;
+    ysfx_audio_reader_t *m_reader = nullptr;
+    // the samples from the opening of the file to its end
+    uint64_t m_total = 0;
+    uint32_t m_capacity = 0;
+    uint32_t m_chunk = 0;
+    std::unique_ptr<ysfx_real[]> m_ring;
+    // the positions in samples since the start of the file, the writer ahead
+    std::atomic<uint64_t> m_write_pos{0};
+    std::atomic<uint64_t> m_read_pos{0};
+    std::atomic<bool> m_eof{false};
+    std::atomic<bool> m_rewind{false};
+    std::atomic<bool> m_quit{false};
+    // whether the thread sleeps, and whether the consumer waits for it
+    std::atomic<bool> m_idle{false};
+    std::atomic<bool> m_waiting{false};
+    RTSemaphore m_wake;
+    RTSemaphore m_ready;
+    std::thread m_thread;
+};
+
+using ysfx_audio_stream_u = std::unique_ptr<ysfx_audio_stream_t>;
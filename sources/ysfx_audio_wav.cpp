@@ -17,6 +17,8 @@
 
 #include "ysfx_audio_wav.hpp"
 #include "ysfx_utils.hpp"
+#include "ysfx_package.hpp"
+#include "ysfx_convert.hpp"
 #include <memory>
 #include <cstring>
 
@@ -36,6 +38,8 @@
 
 struct ysfx_wav_reader_t {
     ~ysfx_wav_reader_t() { drwav_uninit(wav.get()); }
+    // the entry of a package, which the decoder reads in place
+    ysfx_package_data_sp packaged;
     std::unique_ptr<drwav> wav;
     uint32_t nbuff = 0;
     std::unique_ptr<float[]> buff;
@@ -49,14 +53,21 @@ static bool ysfx_wav_can_handle(const char *path)
 static ysfx_audio_reader_t *ysfx_wav_open(const char *path)
 {
     std::unique_ptr<drwav> wav{new drwav};
+    ysfx_package_data_sp packaged = ysfx_package_read(path);
+    drwav_bool32 initok;
+    if (packaged)
+        initok = drwav_init_memory(wav.get(), packaged->data, packaged->size, nullptr);
+    else {
 #if !defined(_WIN32)
-    drwav_bool32 initok = drwav_init_file(wav.get(), path, nullptr);
+        initok = drwav_init_file(wav.get(), path, nullptr);
 #else
-    drwav_bool32 initok = drwav_init_file_w(wav.get(), ysfx::widen(path).c_str(), nullptr);
+        initok = drwav_init_file_w(wav.get(), ysfx::widen(path).c_str(), nullptr);
 #endif
+    }
     if (!initok)
         return nullptr;
     std::unique_ptr<ysfx_wav_reader_t> reader{new ysfx_wav_reader_t};
+    reader->packaged = std::move(packaged);
     reader->wav = std::move(wav);
     reader->buff.reset(new float[reader->wav->channels]);
     return (ysfx_audio_reader_t *)reader.release();
@@ -130,9 +141,7 @@ static uint64_t ysfx_wav_read(ysfx_audio_reader_t *reader_, ysfx_real *samples,
         float *f32buf = (float *)samples;
         uint64_t readframes = drwav_read_pcm_frames_f32(reader->wav.get(), count / channels, f32buf);
         uint64_t readsamples = channels * readframes;
-        // f32->f64
-        for (uint64_t i = readsamples; i-- > 0; )
-            samples[i] = f32buf[i];
+        ysfx::widen_in_place(samples, readsamples);
         samples += readsamples;
         count -= readsamples;
         readtotal += readsamples;
@@ -151,6 +160,71 @@ static uint64_t ysfx_wav_read(ysfx_audio_reader_t *reader_, ysfx_real *samples,
     return readtotal;
 }
 
+//------------------------------------------------------------------------------
+namespace {
+
+struct ysfx_wav_sink_t final : ysfx_file_sink_t {
+    ~ysfx_wav_sink_t() override { if (initialized) drwav_uninit(&wav); }
+    bool write(const uint8_t *data, size_t size) override;
+
+    drwav wav{};
+    bool initialized = false;
+    uint32_t frame_size = 0;
+    // the start of a frame which the last write cut
+    uint32_t ncarry = 0;
+    std::unique_ptr<uint8_t[]> carry;
+};
+
+bool ysfx_wav_sink_t::write(const uint8_t *data, size_t size)
+{
+    if (ncarry > 0) {
+        size_t n = std::min<size_t>(frame_size - ncarry, size);
+        memcpy(&carry[ncarry], data, n);
+        ncarry += (uint32_t)n;
+        data += n;
+        size -= n;
+        if (ncarry < frame_size)
+            return true;
+        if (drwav_write_pcm_frames(&wav, 1, carry.get()) != 1)
+            return false;
+        ncarry = 0;
+    }
+
+    uint64_t frames = size / frame_size;
+    if (frames > 0 && drwav_write_pcm_frames(&wav, frames, data) != frames)
+        return false;
+
+    ncarry = (uint32_t)(size - frames * frame_size);
+    memcpy(carry.get(), data + frames * frame_size, ncarry);
+    return true;
+}
+
+} // namespace
+
+ysfx_file_sink_t *ysfx_wav_sink_open(const char *path, uint32_t channels, ysfx_real sample_rate)
+{
+    drwav_data_format fmt{};
+    fmt.container = drwav_container_riff;
+    fmt.format = DR_WAVE_FORMAT_IEEE_FLOAT;
+    fmt.channels = channels;
+    fmt.sampleRate = (uint32_t)sample_rate;
+    fmt.bitsPerSample = 32;
+
+    std::unique_ptr<ysfx_wav_sink_t> sink{new ysfx_wav_sink_t};
+#if !defined(_WIN32)
+    drwav_bool32 initok = drwav_init_file_write(&sink->wav, path, &fmt, nullptr);
+#else
+    drwav_bool32 initok = drwav_init_file_write_w(&sink->wav, ysfx::widen(path).c_str(), &fmt, nullptr);
+#endif
+    if (!initok)
+        return nullptr;
+
+    sink->initialized = true;
+    sink->frame_size = 4 * channels;
+    sink->carry.reset(new uint8_t[sink->frame_size]);
+    return sink.release();
+}
+
 const ysfx_audio_format_t ysfx_audio_format_wav = {
     &ysfx_wav_can_handle,
     &ysfx_wav_open,
@@ -17,5 +17,9 @@
 
 #pragma once
 #include "ysfx.h"
+#include "ysfx_file_writer.hpp"
 
 extern const ysfx_audio_format_t ysfx_audio_format_wav;
+
+// a sink which encodes little-endian 32-bit floats as a WAV file of the same
+ysfx_file_sink_t *ysfx_wav_sink_open(const char *path, uint32_t channels, ysfx_real sample_rate);
@@ -0,0 +1,198 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+#pragma once
+#include "ysfx.h"
+#include <cstdint>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#   define YSFX_BLOCK_MATH_SSE2 1
+#   include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#   define YSFX_BLOCK_MATH_NEON 1
+#   include <arm_neon.h>
+#endif
+
+// Kernels of the block math builtins, over contiguous spans of the VM's real type
+
+namespace ysfx {
+
+// multiply by another span, element by element
+inline void block_mul(ysfx_real *dst, const ysfx_real *src, uint32_t count)
+{
+    uint32_t i = 0;
+#if defined(YSFX_BLOCK_MATH_SSE2)
+    for (; i + 2 <= count; i += 2)
+        _mm_storeu_pd(&dst[i], _mm_mul_pd(_mm_loadu_pd(&dst[i]), _mm_loadu_pd(&src[i])));
+#elif defined(YSFX_BLOCK_MATH_NEON)
+    for (; i + 2 <= count; i += 2)
+        vst1q_f64(&dst[i], vmulq_f64(vld1q_f64(&dst[i]), vld1q_f64(&src[i])));
+#endif
+    for (; i < count; ++i)
+        dst[i] *= src[i];
+}
+
+// add another span, multiplied by a gain
+inline void block_add_scaled(ysfx_real *dst, const ysfx_real *src, ysfx_real gain, uint32_t count)
+{
+    uint32_t i = 0;
+#if defined(YSFX_BLOCK_MATH_SSE2)
+    const __m128d g = _mm_set1_pd(gain);
+    for (; i + 2 <= count; i += 2)
+        _mm_storeu_pd(&dst[i], _mm_add_pd(_mm_loadu_pd(&dst[i]), _mm_mul_pd(_mm_loadu_pd(&src[i]), g)));
+#elif defined(YSFX_BLOCK_MATH_NEON)
+    const float64x2_t g = vdupq_n_f64(gain);
+    for (; i + 2 <= count; i += 2)
+        vst1q_f64(&dst[i], vaddq_f64(vld1q_f64(&dst[i]), vmulq_f64(vld1q_f64(&src[i]), g)));
+#endif
+    for (; i < count; ++i)
+        dst[i] += src[i] * gain;
+}
+
+// multiply by a gain of (start + step * (first + i)), for the element i
+inline void block_ramp(ysfx_real *dst, uint32_t count, ysfx_real start, ysfx_real step, uint32_t first)
+{
+    uint32_t i = 0;
+#if defined(YSFX_BLOCK_MATH_SSE2)
+    const __m128d vstart = _mm_set1_pd(start);
+    const __m128d vstep = _mm_set1_pd(step);
+    __m128d index = _mm_set_pd((double)first + 1, (double)first);
+    const __m128d two = _mm_set1_pd(2.0);
+    for (; i + 2 <= count; i += 2) {
+        __m128d g = _mm_add_pd(vstart, _mm_mul_pd(vstep, index));
+        _mm_storeu_pd(&dst[i], _mm_mul_pd(_mm_loadu_pd(&dst[i]), g));
+        index = _mm_add_pd(index, two);
+    }
+#elif defined(YSFX_BLOCK_MATH_NEON)
+    const float64x2_t vstart = vdupq_n_f64(start);
+    const float64x2_t vstep = vdupq_n_f64(step);
+    const double first2[2] = {(double)first, (double)first + 1};
+    float64x2_t index = vld1q_f64(first2);
+    const float64x2_t two = vdupq_n_f64(2.0);
+    for (; i + 2 <= count; i += 2) {
+        float64x2_t g = vaddq_f64(vstart, vmulq_f64(vstep, index));
+        vst1q_f64(&dst[i], vmulq_f64(vld1q_f64(&dst[i]), g));
+        index = vaddq_f64(index, two);
+    }
+#endif
+    for (; i < count; ++i)
+        dst[i] *= start + step * (ysfx_real)(first + i);
+}
+
+// filter by the coefficients h of a FIR of the given order: dst[i] = sum(h[k] * x[i + order - 1 - k])
+//   the input has (order - 1) elements of history before those of the outputs
+inline void block_fir(ysfx_real *dst, const ysfx_real *x, const ysfx_real *h, uint32_t order, uint32_t count)
+{
+    uint32_t i = 0;
+    // each pair of outputs sums the products in the same order as one output alone
+#if defined(YSFX_BLOCK_MATH_SSE2)
+    for (; i + 2 <= count; i += 2) {
+        const ysfx_real *xi = &x[i + order - 1];
+        __m128d acc = _mm_setzero_pd();
+        for (uint32_t k = 0; k < order; ++k)
+            acc = _mm_add_pd(acc, _mm_mul_pd(_mm_set1_pd(h[k]), _mm_loadu_pd(xi - k)));
+        _mm_storeu_pd(&dst[i], acc);
+    }
+#elif defined(YSFX_BLOCK_MATH_NEON)
+    for (; i + 2 <= count; i += 2) {
+        const ysfx_real *xi = &x[i + order - 1];
+        float64x2_t acc = vdupq_n_f64(0.0);
+        for (uint32_t k = 0; k < order; ++k)
+            acc = vaddq_f64(acc, vmulq_f64(vdupq_n_f64(h[k]), vld1q_f64(xi - k)));
+        vst1q_f64(&dst[i], acc);
+    }
+#endif
+    for (; i < count; ++i) {
+        const ysfx_real *xi = &x[i + order - 1];
+        ysfx_real acc = 0;
+        for (uint32_t k = 0; k < order; ++k)
+            acc += h[k] * xi[-(int32_t)k];
+        dst[i] = acc;
+    }
+}
+
+// filter in place by a biquad, in transposed direct form II
+//   the coefficients are b0, b1, b2, a1, a2, normalized by a0; the state has 2 elements
+inline void block_biquad(ysfx_real *buf, uint32_t count, const ysfx_real coefs[5], ysfx_real state[2])
+{
+    const ysfx_real b0 = coefs[0], b1 = coefs[1], b2 = coefs[2], a1 = coefs[3], a2 = coefs[4];
+    ysfx_real s1 = state[0], s2 = state[1];
+    for (uint32_t i = 0; i < count; ++i) {
+        ysfx_real x = buf[i];
+        ysfx_real y = b0 * x + s1;
+        s1 = b1 * x - a1 * y + s2;
+        s2 = b2 * x - a2 * y;
+        buf[i] = y;
+    }
+    state[0] = s1;
+    state[1] = s2;
+}
+
+// maximum of the absolute values, at least the initial maximum
+inline ysfx_real block_abs_max(const ysfx_real *src, uint32_t count, ysfx_real max)
+{
+    uint32_t i = 0;
+#if defined(YSFX_BLOCK_MATH_SSE2)
+    if (count >= 2) {
+        const __m128d mask = _mm_castsi128_pd(_mm_set1_epi64x(0x7fffffffffffffffll));
+        __m128d vmax = _mm_set1_pd(max);
+        for (; i + 2 <= count; i += 2)
+            vmax = _mm_max_pd(vmax, _mm_and_pd(_mm_loadu_pd(&src[i]), mask));
+        max = std::fmax(_mm_cvtsd_f64(vmax), _mm_cvtsd_f64(_mm_unpackhi_pd(vmax, vmax)));
+    }
+#elif defined(YSFX_BLOCK_MATH_NEON)
+    if (count >= 2) {
+        float64x2_t vmax = vdupq_n_f64(max);
+        for (; i + 2 <= count; i += 2)
+            vmax = vmaxnmq_f64(vmax, vabsq_f64(vld1q_f64(&src[i])));
+        max = vmaxnmvq_f64(vmax);
+    }
+#endif
+    for (; i < count; ++i)
+        max = std::fmax(max, std::fabs(src[i]));
+    return max;
+}
+
+// sum of the squares
+inline ysfx_real block_sum_squares(const ysfx_real *src, uint32_t count)
+{
+    uint32_t i = 0;
+    ysfx_real sum = 0;
+#if defined(YSFX_BLOCK_MATH_SSE2)
+    __m128d acc0 = _mm_setzero_pd(), acc1 = _mm_setzero_pd();
+    for (; i + 4 <= count; i += 4) {
+        __m128d x0 = _mm_loadu_pd(&src[i]), x1 = _mm_loadu_pd(&src[i + 2]);
+        acc0 = _mm_add_pd(acc0, _mm_mul_pd(x0, x0));
+        acc1 = _mm_add_pd(acc1, _mm_mul_pd(x1, x1));
+    }
+    acc0 = _mm_add_pd(acc0, acc1);
+    sum = _mm_cvtsd_f64(acc0) + _mm_cvtsd_f64(_mm_unpackhi_pd(acc0, acc0));
+#elif defined(YSFX_BLOCK_MATH_NEON)
+    float64x2_t acc0 = vdupq_n_f64(0.0), acc1 = vdupq_n_f64(0.0);
+    for (; i + 4 <= count; i += 4) {
+        float64x2_t x0 = vld1q_f64(&src[i]), x1 = vld1q_f64(&src[i + 2]);
+        acc0 = vfmaq_f64(acc0, x0, x0);
+        acc1 = vfmaq_f64(acc1, x1, x1);
+    }
+    sum = vaddvq_f64(vaddq_f64(acc0, acc1));
+#endif
+    for (; i < count; ++i)
+        sum += src[i] * src[i];
+    return sum;
+}
+
+} // namespace ysfx
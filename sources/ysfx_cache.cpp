@@ -0,0 +1,324 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "ysfx_cache.hpp"
+#include "ysfx_config.hpp"
+#include <cstring>
+#include <cstdio>
+#include <atomic>
+#include <mutex>
+
+// The cache holds one file per entry, named after the hash of the key. The
+// contents are in the native byte order, since the cache is not meant to be
+// shared between different machines.
+
+static const char ysfx_cache_magic[] = "ysfx-cache-1";
+
+static uint64_t ysfx_cache_hash(const char *data, size_t size)
+{
+    // FNV-1a
+    uint64_t hash = 0xcbf29ce484222325u;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= (uint8_t)data[i];
+        hash *= 0x100000001b3u;
+    }
+    return hash;
+}
+
+std::string ysfx_cache_key_string(const ysfx_cache_key_t &key)
+{
+    std::string text;
+    char buf[128];
+    sprintf(buf, "%llx:%llx:%llx:%llx:",
+            (unsigned long long)key.uid.first, (unsigned long long)key.uid.second,
+            (unsigned long long)key.stamp.first, (unsigned long long)key.stamp.second);
+    text.append(buf);
+    text.append(key.import_root);
+    text.push_back('\n');
+    if (!key.entry.empty()) {
+        text.push_back('@');
+        text.append(key.entry);
+        text.push_back('\n');
+    }
+    for (const auto &item : key.preprocessor_values) {
+        uint64_t bits;
+        memcpy(&bits, &item.second, sizeof(bits));
+        sprintf(buf, "=%llx\n", (unsigned long long)bits);
+        text.append(item.first);
+        text.append(buf);
+    }
+    return text;
+}
+
+static std::string ysfx_cache_entry_path(ysfx_config_t &config, const std::string &key_string)
+{
+    char name[64];
+    sprintf(name, "%016llx.ysfxcache", (unsigned long long)ysfx_cache_hash(key_string.data(), key_string.size()));
+    return config.cache_root + name;
+}
+
+//------------------------------------------------------------------------------
+namespace {
+
+struct cache_writer {
+    std::string data;
+
+    void u32(uint32_t value) { data.append((const char *)&value, sizeof(value)); }
+    void u64(uint64_t value) { data.append((const char *)&value, sizeof(value)); }
+    void str(const std::string &value) { u64(value.size()); data.append(value); }
+    void real(ysfx_real value) { data.append((const char *)&value, sizeof(value)); }
+};
+
+struct cache_reader {
+    const char *pos;
+    const char *end;
+    bool ok = true;
+
+    bool get(void *dst, size_t size)
+    {
+        if (!ok || (size_t)(end - pos) < size)
+            return ok = false;
+        memcpy(dst, pos, size);
+        pos += size;
+        return true;
+    }
+    uint32_t u32() { uint32_t value = 0; get(&value, sizeof(value)); return value; }
+    uint64_t u64() { uint64_t value = 0; get(&value, sizeof(value)); return value; }
+    ysfx_real real() { ysfx_real value = 0; get(&value, sizeof(value)); return value; }
+    std::string str()
+    {
+        uint64_t size = u64();
+        if (!ok || (uint64_t)(end - pos) < size) {
+            ok = false;
+            return std::string();
+        }
+        std::string value(pos, (size_t)size);
+        pos += size;
+        return value;
+    }
+};
+
+} // namespace
+
+static ysfx_section_u ysfx_toplevel_t::*const ysfx_cache_sections[] = {
+    &ysfx_toplevel_t::header,
+    &ysfx_toplevel_t::init,
+    &ysfx_toplevel_t::slider,
+    &ysfx_toplevel_t::block,
+    &ysfx_toplevel_t::sample,
+    &ysfx_toplevel_t::serialize,
+    &ysfx_toplevel_t::gfx,
+};
+
+//------------------------------------------------------------------------------
+bool ysfx_cache_make_key(ysfx_config_t &config, FILE *stream, const ysfx::file_uid &uid, const std::map<std::string, ysfx_real> &preprocessor_values, ysfx_cache_key_t &key)
+{
+    if (!ysfx::get_stream_file_stamp(stream, key.stamp))
+        return false;
+
+    key.uid = uid;
+    key.import_root = config.import_root;
+    key.preprocessor_values = preprocessor_values;
+    return true;
+}
+
+void ysfx_cache_make_package_key(ysfx_config_t &config, const ysfx::file_uid &uid, const ysfx::file_stamp &stamp, const std::string &entry, const std::map<std::string, ysfx_real> &preprocessor_values, ysfx_cache_key_t &key)
+{
+    key.uid = uid;
+    key.stamp = stamp;
+    key.import_root = config.import_root;
+    key.entry = entry;
+    key.preprocessor_values = preprocessor_values;
+}
+
+bool ysfx_cache_load(ysfx_config_t &config, const std::string &key, ysfx_parsed_unit_t &unit)
+{
+    if (config.cache_root.empty())
+        return false;
+
+    const std::string path = ysfx_cache_entry_path(config, key);
+
+    std::string data;
+    {
+        ysfx::FILE_u stream{ysfx::fopen_utf8(path.c_str(), "rb")};
+        if (!stream)
+            return false;
+        char buf[8192];
+        size_t count;
+        while ((count = fread(buf, 1, sizeof(buf), stream.get())) > 0)
+            data.append(buf, count);
+        if (ferror(stream.get()))
+            return false;
+    }
+
+    // the payload is followed by its hash, which detects incomplete files
+    uint64_t hash;
+    if (data.size() < sizeof(hash))
+        return false;
+    memcpy(&hash, &data[data.size() - sizeof(hash)], sizeof(hash));
+    data.resize(data.size() - sizeof(hash));
+    if (hash != ysfx_cache_hash(data.data(), data.size()))
+        return false;
+
+    cache_reader reader{data.data(), data.data() + data.size()};
+
+    // verify that it matches the key, in case of a collision of hashes
+    if (reader.str() != ysfx_cache_magic || reader.str() != key)
+        return false;
+
+    ysfx_parsed_unit_t result;
+    result.toplevel.gfx_w = reader.u32();
+    result.toplevel.gfx_h = reader.u32();
+    for (ysfx_section_u ysfx_toplevel_t::*section : ysfx_cache_sections) {
+        if (reader.u32() == 0)
+            continue;
+        ysfx_section_u &sec = result.toplevel.*section;
+        sec.reset(new ysfx_section_t);
+        sec->line_offset = reader.u32();
+        sec->text = reader.str();
+    }
+    for (uint64_t i = 0, n = reader.u64(); reader.ok && i < n; ++i) {
+        std::string name = reader.str();
+        result.preprocessor_values[name] = reader.real();
+    }
+    for (uint64_t i = 0, n = reader.u64(); reader.ok && i < n; ++i) {
+        std::string name = reader.str();
+        result.imports[name] = reader.str();
+    }
+
+    if (!reader.ok || reader.pos != reader.end || !result.toplevel.header)
+        return false;
+
+    // the header is not stored, it's quick to parse again
+    ysfx_parse_error error;
+    if (!ysfx_parse_header(result.toplevel.header.get(), result.header, &error))
+        return false;
+
+    unit = std::move(result);
+    return true;
+}
+
+bool ysfx_cache_store(ysfx_config_t &config, const std::string &key, const ysfx_parsed_unit_t &unit)
+{
+    if (config.cache_root.empty())
+        return false;
+
+    const std::string path = ysfx_cache_entry_path(config, key);
+    const ysfx_toplevel_t &toplevel = unit.toplevel;
+
+    cache_writer writer;
+    writer.str(ysfx_cache_magic);
+    writer.str(key);
+    writer.u32(toplevel.gfx_w);
+    writer.u32(toplevel.gfx_h);
+    for (ysfx_section_u ysfx_toplevel_t::*section : ysfx_cache_sections) {
+        const ysfx_section_t *sec = (toplevel.*section).get();
+        writer.u32(sec != nullptr);
+        if (sec) {
+            writer.u32(sec->line_offset);
+            writer.str(sec->text);
+        }
+    }
+    writer.u64(unit.preprocessor_values.size());
+    for (const auto &item : unit.preprocessor_values) {
+        writer.str(item.first);
+        writer.real(item.second);
+    }
+    writer.u64(unit.imports.size());
+    for (const auto &item : unit.imports) {
+        writer.str(item.first);
+        writer.str(item.second);
+    }
+    writer.u64(ysfx_cache_hash(writer.data.data(), writer.data.size()));
+
+    // write a temporary, and move it in place, so readers never see a partial entry
+    static std::atomic<uint32_t> counter{0};
+    char suffix[64];
+    sprintf(suffix, ".%llx-%x.tmp",
+            (unsigned long long)(uintptr_t)&writer, counter.fetch_add(1, std::memory_order_relaxed));
+    const std::string temp_path = path + suffix;
+
+    {
+        ysfx::FILE_u stream{ysfx::fopen_utf8(temp_path.c_str(), "wb")};
+        if (!stream)
+            return false;
+        bool written = fwrite(writer.data.data(), 1, writer.data.size(), stream.get()) == writer.data.size();
+        written = fflush(stream.get()) == 0 && written;
+        if (!written) {
+            stream.reset();
+            remove(temp_path.c_str());
+            return false;
+        }
+    }
+
+    if (!ysfx::rename_file(temp_path.c_str(), path.c_str())) {
+        remove(temp_path.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+namespace {
+
+// the units which are in memory, shared by all instances of the process
+struct unit_registry {
+    std::mutex mutex;
+    std::map<std::string, std::weak_ptr<const ysfx_parsed_unit_t>> units;
+};
+
+unit_registry &get_unit_registry()
+{
+    static unit_registry registry;
+    return registry;
+}
+
+} // namespace
+
+ysfx_parsed_unit_sp ysfx_registry_find(const std::string &key)
+{
+    unit_registry &registry = get_unit_registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    auto it = registry.units.find(key);
+    if (it == registry.units.end())
+        return nullptr;
+
+    return it->second.lock();
+}
+
+ysfx_parsed_unit_sp ysfx_registry_insert(const std::string &key, ysfx_parsed_unit_sp unit)
+{
+    unit_registry &registry = get_unit_registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    // forget the units which are no longer used by any instance
+    for (auto it = registry.units.begin(); it != registry.units.end(); ) {
+        if (it->second.expired())
+            it = registry.units.erase(it);
+        else
+            ++it;
+    }
+
+    std::weak_ptr<const ysfx_parsed_unit_t> &slot = registry.units[key];
+    if (ysfx_parsed_unit_sp existing = slot.lock())
+        return existing;
+
+    slot = unit;
+    return unit;
+}
@@ -0,0 +1,65 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+#include "ysfx.h"
+#include "ysfx_parse.hpp"
+#include "ysfx_utils.hpp"
+#include <string>
+#include <map>
+#include <memory>
+
+// identifies the result of preprocessing and parsing a source file
+struct ysfx_cache_key_t {
+    ysfx::file_uid uid;
+    ysfx::file_stamp stamp;
+    std::string import_root;
+    // the entry, if the file is in a package identified by the uid and stamp
+    std::string entry;
+    std::map<std::string, ysfx_real> preprocessor_values;
+};
+
+// maps the names of imports to their resolved paths
+using ysfx_cache_imports_t = std::map<std::string, std::string>;
+
+// a source file after preprocessing and parsing; immutable once published
+struct ysfx_parsed_unit_t {
+    ysfx_toplevel_t toplevel;
+    ysfx_header_t header;
+    // the preprocessor configuration read from the header
+    std::map<std::string, ysfx_real> preprocessor_values;
+    // the imports which were found, at the time of parsing
+    ysfx_cache_imports_t imports;
+};
+using ysfx_parsed_unit_sp = std::shared_ptr<const ysfx_parsed_unit_t>;
+
+// compute the key of the open file
+bool ysfx_cache_make_key(ysfx_config_t &config, FILE *stream, const ysfx::file_uid &uid, const std::map<std::string, ysfx_real> &preprocessor_values, ysfx_cache_key_t &key);
+// compute the key of an entry of a package
+void ysfx_cache_make_package_key(ysfx_config_t &config, const ysfx::file_uid &uid, const ysfx::file_stamp &stamp, const std::string &entry, const std::map<std::string, ysfx_real> &preprocessor_values, ysfx_cache_key_t &key);
+// get the key as a string, which uniquely identifies the entry
+std::string ysfx_cache_key_string(const ysfx_cache_key_t &key);
+
+// look up the cache on disk, and return whether the entry was found
+bool ysfx_cache_load(ysfx_config_t &config, const std::string &key, ysfx_parsed_unit_t &unit);
+// write an entry into the cache on disk, replacing any previous version
+bool ysfx_cache_store(ysfx_config_t &config, const std::string &key, const ysfx_parsed_unit_t &unit);
+
+// look up a unit which is in memory, in use by another instance
+ysfx_parsed_unit_sp ysfx_registry_find(const std::string &key);
+// publish a unit; if another one was published first under the same key, that one is returned
+ysfx_parsed_unit_sp ysfx_registry_insert(const std::string &key, ysfx_parsed_unit_sp unit);
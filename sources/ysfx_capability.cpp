@@ -0,0 +1,180 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "ysfx_capability.hpp"
+#include "ysfx_utils.hpp"
+#include <algorithm>
+#include <cstring>
+
+static bool ysfx_is_ident_start(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+static bool ysfx_is_ident_char(char c)
+{
+    return ysfx_is_ident_start(c) || (c >= '0' && c <= '9') || c == '.';
+}
+
+// whether the name is the one of a slider, by its number or its alias
+static bool ysfx_is_slider_name(const std::string &name, const std::unordered_map<std::string, uint32_t> &slider_alias)
+{
+    if (name.size() > 6 && name.compare(0, 6, "slider") == 0) {
+        uint32_t number = 0;
+        size_t i = 6;
+        while (i < name.size() && name[i] >= '0' && name[i] <= '9' && number <= ysfx_max_sliders)
+            number = number * 10 + (uint32_t)(name[i++] - '0');
+        if (i == name.size() && name[6] != '0' && number >= 1 && number <= ysfx_max_sliders)
+            return true;
+    }
+    return slider_alias.find(name) != slider_alias.end();
+}
+
+static uint32_t ysfx_capability_of_call(const std::string &name)
+{
+    // the code which `eval` runs is not known until then, so it may do anything
+    if (name == "eval") {
+        return ysfx_capability_midi_in | ysfx_capability_midi_out | ysfx_capability_transport |
+            ysfx_capability_slider_output | ysfx_capability_latency;
+    }
+
+    static const char *const midi_in[] = {"midirecv", "midirecv_buf", "midirecv_str", "midirecv_ump"};
+    static const char *const midi_out[] = {"midisend", "midisend_buf", "midisend_str", "midisend_ump", "midisyx"};
+    static const char *const slider_output[] = {"slider", "slider_automate", "sliderchange"};
+    static const char *const latency[] = {"la_create"};
+
+    auto is_in = [&name](const auto &names) -> bool {
+        return std::any_of(std::begin(names), std::end(names), [&name](const char *n) { return name == n; });
+    };
+    uint32_t caps = 0;
+    if (is_in(midi_in))
+        caps |= ysfx_capability_midi_in;
+    if (is_in(midi_out))
+        caps |= ysfx_capability_midi_out;
+    if (is_in(slider_output))
+        caps |= ysfx_capability_slider_output;
+    if (is_in(latency))
+        caps |= ysfx_capability_latency;
+    return caps;
+}
+
+static uint32_t ysfx_capability_of_variable(const std::string &name)
+{
+    static const char *const transport[] = {"tempo", "play_state", "play_position", "beat_position", "ts_num", "ts_denom"};
+
+    if (std::any_of(std::begin(transport), std::end(transport), [&name](const char *n) { return name == n; }))
+        return ysfx_capability_transport;
+    if (name == "pdc_delay")
+        return ysfx_capability_latency;
+    return 0;
+}
+
+uint32_t ysfx_analyze_capabilities(const std::vector<const ysfx_section_t *> &sections, const std::unordered_map<std::string, uint32_t> &slider_alias)
+{
+    uint32_t caps = 0;
+    std::string ident;
+
+    for (const ysfx_section_t *section : sections) {
+        if (!section)
+            continue;
+
+        const std::string &text = section->text;
+        const char *src = text.data();
+        const size_t size = text.size();
+
+        // the token before the current one, which is not a blank
+        char prev = '\0';
+
+        size_t i = 0;
+        while (i < size) {
+            char c = src[i];
+
+            if (c == '/' && i + 1 < size && src[i + 1] == '/') {
+                while (i < size && src[i] != '\n')
+                    ++i;
+                continue;
+            }
+            if (c == '/' && i + 1 < size && src[i + 1] == '*') {
+                size_t end = text.find("*/", i + 2);
+                i = (end == std::string::npos) ? size : (end + 2);
+                continue;
+            }
+            if (c == '"' || c == '\'') {
+                size_t end = i + 1;
+                while (end < size && src[end] != c)
+                    end += (src[end] == '\\' && end + 1 < size) ? 2 : 1;
+                i = std::min(end + 1, size);
+                prev = c;
+                continue;
+            }
+            // the numbers and the constants like `$pi`, `$x1F`, `$'a'`
+            if (c == '$' && i + 1 < size && src[i + 1] == '\'') {
+                size_t end = text.find('\'', i + 2);
+                i = (end == std::string::npos) ? size : (end + 1);
+                prev = '0';
+                continue;
+            }
+            if (c == '$' || c == '#' || (c >= '0' && c <= '9') || (c == '.' && i + 1 < size && src[i + 1] >= '0' && src[i + 1] <= '9')) {
+                ++i;
+                while (i < size && (ysfx_is_ident_char(src[i]) || src[i] == '~'))
+                    ++i;
+                prev = '0';
+                continue;
+            }
+            if (!ysfx_is_ident_start(c)) {
+                if (!ysfx::ascii_isspace(c))
+                    prev = c;
+                ++i;
+                continue;
+            }
+
+            size_t start = i;
+            while (i < size && ysfx_is_ident_char(src[i]))
+                ++i;
+
+            ident.assign(src + start, i - start);
+            std::transform(ident.begin(), ident.end(), ident.begin(), ysfx::ascii_tolower);
+            // a global which a function names from within its namespace
+            if (ident.compare(0, 8, "_global.") == 0)
+                ident.erase(0, 8);
+
+            size_t next = i;
+            while (next < size && ysfx::ascii_isspace(src[next]))
+                ++next;
+            char n0 = (next < size) ? src[next] : '\0';
+            char n1 = (next + 1 < size) ? src[next + 1] : '\0';
+
+            if (n0 == '(')
+                caps |= ysfx_capability_of_call(ident);
+            else {
+                caps |= ysfx_capability_of_variable(ident);
+                // a slider is changed by an assignment, by a function which it is passed to,
+                //   or as a branch of a condition, which can be assigned too
+                if (ysfx_is_slider_name(ident, slider_alias)) {
+                    bool assigned = (n0 == '=' && n1 != '=') || (n1 == '=' && strchr("+-*/%^|&~", n0));
+                    bool passed = prev == '(' || prev == ',';
+                    bool branch = prev == '?' || prev == ':' || n0 == ':';
+                    if (assigned || passed || branch)
+                        caps |= ysfx_capability_slider_output;
+                }
+            }
+            prev = 'a';
+        }
+    }
+
+    return caps;
+}
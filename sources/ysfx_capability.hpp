@@ -0,0 +1,28 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+#include "ysfx.h"
+#include "ysfx_parse.hpp"
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+// find the flags of `ysfx_capability_t` for the code of the sections, by the names
+//   of the variables and the functions which it refers to; the sliders are known
+//   by their numbers, and by their names of `slider_alias`; a call of `eval` has all the flags
+uint32_t ysfx_analyze_capabilities(const std::vector<const ysfx_section_t *> &sections, const std::unordered_map<std::string, uint32_t> &slider_alias);
@@ -0,0 +1,720 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "ysfx_chain.hpp"
+#include "ysfx.hpp"
+#include "ysfx_convert.hpp"
+#include <algorithm>
+#include <cmath>
+
+static void ysfx_chain_run(ysfx_chain_t *chain, ysfx_chain_pool_t *pool, uint32_t num_channels, uint32_t num_frames);
+static void ysfx_chain_run_stages(ysfx_chain_t *chain, uint32_t begin, uint32_t end, ysfx_chain_pool_t *pool, ysfx_real *const *channels, uint32_t num_channels, uint32_t num_frames, ysfx_midi_buffer_t *midi);
+static void ysfx_chain_run_job(ysfx_chain_stage_t *stage, uint32_t index, ysfx_real *const *channels, uint32_t num_channels, uint32_t num_frames);
+
+ysfx_chain_t *ysfx_chain_new()
+{
+    ysfx_chain_t *chain = new ysfx_chain_t;
+    chain->channels.reserve(ysfx_max_channels);
+    chain->midi_in.reset(new ysfx_midi_buffer_t);
+    chain->midi_out.reset(new ysfx_midi_buffer_t);
+    ysfx_midi_reserve(chain->midi_in.get(), 1024, true);
+    ysfx_midi_reserve(chain->midi_out.get(), 1024, true);
+    return chain;
+}
+
+void ysfx_chain_free(ysfx_chain_t *chain)
+{
+    if (!chain)
+        return;
+
+    if (chain->ref_count.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        delete chain;
+}
+
+void ysfx_chain_add_ref(ysfx_chain_t *chain)
+{
+    chain->ref_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+void ysfx_chain_append(ysfx_chain_t *chain, ysfx_t *fx)
+{
+    ysfx_add_ref(fx);
+    ysfx_chain_stage_t stage;
+    stage.fx.reset(fx);
+    chain->stages.push_back(std::move(stage));
+}
+
+void ysfx_chain_append_parallel(ysfx_chain_t *chain, ysfx_chain_t *const *branches, uint32_t num_branches)
+{
+    ysfx_chain_stage_t stage;
+    stage.branches.reserve(num_branches);
+    for (uint32_t i = 0; i < num_branches; ++i) {
+        ysfx_chain_add_ref(branches[i]);
+        stage.branches.emplace_back(branches[i]);
+    }
+    chain->stages.push_back(std::move(stage));
+}
+
+void ysfx_chain_append_ganged(ysfx_chain_t *chain, ysfx_t *fx, uint32_t num_lanes)
+{
+    ysfx_chain_stage_t stage;
+    stage.lane_width = std::max(1u, std::max(ysfx_get_num_inputs(fx), ysfx_get_num_outputs(fx)));
+    stage.lanes.reserve(num_lanes);
+    if (num_lanes > 0) {
+        ysfx_add_ref(fx);
+        stage.lanes.emplace_back(fx);
+    }
+    for (uint32_t i = 1; i < num_lanes; ++i) {
+        ysfx_u copy{ysfx_clone(fx)};
+        if (!copy)
+            break;
+        stage.lanes.push_back(std::move(copy));
+    }
+    chain->stages.push_back(std::move(stage));
+}
+
+void ysfx_chain_append_voices(ysfx_chain_t *chain, ysfx_t *fx, uint32_t num_voices)
+{
+    ysfx_chain_stage_t stage;
+    stage.branches.reserve(num_voices);
+    for (uint32_t i = 0; i < num_voices; ++i) {
+        ysfx_u voice;
+        if (i == 0) {
+            ysfx_add_ref(fx);
+            voice.reset(fx);
+        }
+        else {
+            voice.reset(ysfx_clone(fx));
+            if (!voice)
+                break;
+        }
+        ysfx_chain_u branch{ysfx_chain_new()};
+        ysfx_chain_append(branch.get(), voice.get());
+        stage.branches.push_back(std::move(branch));
+    }
+    stage.voices.resize(stage.branches.size());
+    chain->stages.push_back(std::move(stage));
+}
+
+uint32_t ysfx_chain_get_active_voices(ysfx_chain_t *chain, uint32_t index)
+{
+    if (index >= chain->stages.size())
+        return 0;
+    uint32_t count = 0;
+    for (const ysfx_chain_voice_t &voice : chain->stages[index].voices)
+        count += voice.active;
+    return count;
+}
+
+uint32_t ysfx_chain_get_size(ysfx_chain_t *chain)
+{
+    return (uint32_t)chain->stages.size();
+}
+
+ysfx_t *ysfx_chain_get_effect(ysfx_chain_t *chain, uint32_t index)
+{
+    if (index >= chain->stages.size())
+        return nullptr;
+    const ysfx_chain_stage_t &stage = chain->stages[index];
+    if (!stage.lanes.empty())
+        return stage.lanes[0].get();
+    if (!stage.voices.empty())
+        return stage.branches[0]->stages[0].fx.get();
+    return stage.fx.get();
+}
+
+void ysfx_chain_set_capacity(ysfx_chain_t *chain, uint32_t num_channels, uint32_t num_frames)
+{
+    num_channels = std::min<uint32_t>(num_channels, ysfx_max_channels);
+    if (chain->buffer.size() < (size_t)num_channels * num_frames)
+        chain->buffer.resize((size_t)num_channels * num_frames);
+
+    for (ysfx_chain_stage_t &stage : chain->stages) {
+        for (ysfx_chain_u &branch : stage.branches)
+            ysfx_chain_set_capacity(branch.get(), num_channels, num_frames);
+    }
+
+    if (chain->pipeline)
+        chain->pipeline->prepare(num_channels, num_frames);
+}
+
+void ysfx_chain_set_num_threads(ysfx_chain_t *chain, uint32_t num_threads)
+{
+    ysfx_chain_executor_t *executor = chain->pool ? chain->pool->executor : nullptr;
+    void *executor_data = chain->pool ? chain->pool->executor_data : nullptr;
+
+    chain->num_threads = num_threads;
+    chain->pool.reset();
+    if (num_threads > 1 || executor) {
+        chain->pool.reset(new ysfx_chain_pool_t{(num_threads > 1) ? (num_threads - 1) : 0});
+        chain->pool->executor = executor;
+        chain->pool->executor_data = executor_data;
+    }
+}
+
+void ysfx_chain_set_executor(ysfx_chain_t *chain, ysfx_chain_executor_t *executor, void *userdata)
+{
+    if (executor && !chain->pool)
+        chain->pool.reset(new ysfx_chain_pool_t{0});
+    else if (!executor && chain->pool && chain->num_threads <= 1) {
+        chain->pool.reset();
+        return;
+    }
+
+    if (chain->pool) {
+        chain->pool->executor = executor;
+        chain->pool->executor_data = userdata;
+    }
+}
+
+void ysfx_chain_execute_task(ysfx_chain_t *chain, uint32_t index)
+{
+    chain->pool->run_job(index);
+}
+
+void ysfx_chain_set_pipeline(ysfx_chain_t *chain, uint32_t num_groups, const uint32_t *group_sizes)
+{
+    chain->pipeline.reset();
+    if (num_groups > 1)
+        chain->pipeline.reset(new ysfx_chain_pipeline_t{chain, num_groups, group_sizes});
+}
+
+ysfx_real ysfx_chain_get_pdc_delay(ysfx_chain_t *chain)
+{
+    const ysfx_chain_pipeline_t *pipeline = chain->pipeline.get();
+    if (!pipeline)
+        return 0;
+    return (ysfx_real)pipeline->num_groups * pipeline->num_frames;
+}
+
+bool ysfx_chain_send_midi(ysfx_chain_t *chain, const ysfx_midi_event_t *event)
+{
+    return ysfx_midi_push(chain->midi_in.get(), event);
+}
+
+bool ysfx_chain_receive_midi(ysfx_chain_t *chain, ysfx_midi_event_t *event)
+{
+    return ysfx_midi_get_next(chain->midi_out.get(), event);
+}
+
+//------------------------------------------------------------------------------
+
+ysfx_chain_pool_t::ysfx_chain_pool_t(uint32_t num_threads)
+{
+    auto work = [this]() {
+        for (;;) {
+            wake.wait();
+            if (quit.load(std::memory_order_relaxed))
+                break;
+            for (uint32_t i; (i = next_branch.fetch_add(1)) < stage->num_jobs(); )
+                ysfx_chain_run_job(stage, i, channels, num_channels, num_frames);
+            done.post();
+        }
+    };
+
+    threads.reserve(num_threads);
+    for (uint32_t i = 0; i < num_threads; ++i)
+        threads.emplace_back(work);
+}
+
+ysfx_chain_pool_t::~ysfx_chain_pool_t()
+{
+    quit.store(true, std::memory_order_relaxed);
+    for (size_t i = 0; i < threads.size(); ++i)
+        wake.post();
+    for (std::thread &thread : threads)
+        thread.join();
+}
+
+void ysfx_chain_pool_t::run(ysfx_chain_stage_t *stage_, ysfx_real *const *channels_, uint32_t num_channels_, uint32_t num_frames_)
+{
+    stage = stage_;
+    channels = channels_;
+    num_channels = num_channels_;
+    num_frames = num_frames_;
+    next_branch.store(0, std::memory_order_relaxed);
+
+    if (executor && executor(executor_data, stage->num_jobs()))
+        return;
+
+    for (size_t i = 0; i < threads.size(); ++i)
+        wake.post();
+
+    // the calling thread takes its share of the jobs too
+    for (uint32_t i; (i = next_branch.fetch_add(1)) < stage->num_jobs(); )
+        ysfx_chain_run_job(stage, i, channels, num_channels, num_frames);
+
+    for (size_t i = 0; i < threads.size(); ++i)
+        done.wait();
+}
+
+void ysfx_chain_pool_t::run_job(uint32_t index)
+{
+    if (index < stage->num_jobs())
+        ysfx_chain_run_job(stage, index, channels, num_channels, num_frames);
+}
+
+//------------------------------------------------------------------------------
+
+ysfx_chain_pipeline_t::ysfx_chain_pipeline_t(ysfx_chain_t *chain_, uint32_t num_groups_, const uint32_t *group_sizes_)
+    : chain(chain_),
+      num_groups(num_groups_)
+{
+    if (group_sizes_)
+        group_sizes.assign(group_sizes_, group_sizes_ + num_groups);
+    first.resize(num_groups + 1);
+    midi_out.reset(new ysfx_midi_buffer_t);
+    ysfx_midi_reserve(midi_out.get(), 1024, true);
+
+    blocks.resize(num_groups);
+    for (ysfx_chain_block_t &block : blocks) {
+        block.channels.reserve(ysfx_max_channels);
+        block.midi.reset(new ysfx_midi_buffer_t);
+        ysfx_midi_reserve(block.midi.get(), 1024, true);
+    }
+
+    workers.reserve(num_groups - 1);
+    for (uint32_t group = 1; group < num_groups; ++group) {
+        worker_t *worker = new worker_t;
+        workers.emplace_back(worker);
+        worker->thread = std::thread([this, worker, group]() {
+            for (;;) {
+                worker->wake.wait();
+                if (quit.load(std::memory_order_relaxed))
+                    break;
+                run_group(group);
+                done.post();
+            }
+        });
+    }
+}
+
+ysfx_chain_pipeline_t::~ysfx_chain_pipeline_t()
+{
+    quit.store(true, std::memory_order_relaxed);
+    for (std::unique_ptr<worker_t> &worker : workers)
+        worker->wake.post();
+    for (std::unique_ptr<worker_t> &worker : workers)
+        worker->thread.join();
+}
+
+void ysfx_chain_pipeline_t::prepare(uint32_t num_channels_, uint32_t num_frames_)
+{
+    if (num_channels == num_channels_ && num_frames == num_frames_)
+        return;
+
+    num_channels = num_channels_;
+    num_frames = num_frames_;
+    filled = 0;
+    position = 0;
+    ysfx_midi_clear(midi_out.get());
+    for (ysfx_chain_block_t &block : blocks) {
+        block.buffer.assign((size_t)num_channels * num_frames, 0);
+        block.channels.resize(num_channels);
+        for (uint32_t ch = 0; ch < num_channels; ++ch)
+            block.channels[ch] = &block.buffer[(size_t)ch * num_frames];
+        ysfx_midi_clear(block.midi.get());
+    }
+}
+
+void ysfx_chain_pipeline_t::run()
+{
+    // with the sizes given, the last group takes the stages which remain
+    const uint32_t num_stages = (uint32_t)chain->stages.size();
+    for (uint32_t group = 0; group < num_groups; ++group) {
+        if (group_sizes.empty())
+            first[group + 1] = (uint32_t)((uint64_t)(group + 1) * num_stages / num_groups);
+        else if (group + 1 < num_groups)
+            first[group + 1] = std::min(first[group] + group_sizes[group], num_stages);
+        else
+            first[group + 1] = num_stages;
+    }
+
+    // a group with no input yet would turn silence into output, so the blocks leave silent until it's full
+    filled = std::min(filled + 1, num_groups);
+    for (uint32_t group = 1; group < filled; ++group)
+        workers[group - 1]->wake.post();
+    run_group(0);
+    for (uint32_t group = 1; group < filled; ++group)
+        done.wait();
+
+    std::rotate(blocks.begin(), blocks.end() - 1, blocks.end());
+    ysfx_midi_swap(midi_out.get(), blocks[0].midi.get());
+    ysfx_midi_clear(blocks[0].midi.get());
+}
+
+void ysfx_chain_pipeline_t::run_group(uint32_t group)
+{
+    ysfx_chain_block_t &block = blocks[group];
+    ysfx_chain_run_stages(chain, first[group], first[group + 1], nullptr, block.channels.data(), num_channels, num_frames, block.midi.get());
+}
+
+//------------------------------------------------------------------------------
+
+static void ysfx_chain_prepare(ysfx_chain_t *chain, uint32_t num_channels, uint32_t num_frames)
+{
+    ysfx_chain_set_capacity(chain, num_channels, num_frames);
+    ysfx_real *buffer = chain->buffer.data();
+    chain->channels.resize(num_channels);
+    for (uint32_t ch = 0; ch < num_channels; ++ch)
+        chain->channels[ch] = &buffer[ch * num_frames];
+}
+
+// a job of a parallel stage: either a branch, on its own copy of the channels, or a lane, on its group of them
+static void ysfx_chain_run_job(ysfx_chain_stage_t *stage, uint32_t index, ysfx_real *const *channels, uint32_t num_channels, uint32_t num_frames)
+{
+    if (stage->lanes.empty()) {
+        if (stage->voices.empty() || stage->voices[index].runs)
+            ysfx_chain_run(stage->branches[index].get(), nullptr, num_channels, num_frames);
+        return;
+    }
+
+    const uint32_t first = index * stage->lane_width;
+    if (first >= num_channels)
+        return;
+    const uint32_t width = std::min(stage->lane_width, num_channels - first);
+    ysfx_process_double(stage->lanes[index].get(), &channels[first], &channels[first], width, width, num_frames);
+}
+
+// the lanes take the sliders of the first, and the same MIDI
+static void ysfx_chain_prepare_lanes(ysfx_chain_stage_t &stage, ysfx_midi_buffer_t *midi)
+{
+    ysfx_t *leader = stage.lanes[0].get();
+    ysfx_midi_swap(leader->midi.in.get(), midi);
+    ysfx_midi_clear(midi);
+
+    const ysfx_source_unit_t *main = leader->source.main.get();
+    for (size_t i = 1; i < stage.lanes.size(); ++i) {
+        ysfx_t *lane = stage.lanes[i].get();
+        if (main) {
+            for (uint32_t index : main->header.slider_indices) {
+                ysfx_real value = *leader->var.slider[index];
+                if (*lane->var.slider[index] != value)
+                    ysfx_slider_set_value(lane, index, value, true);
+            }
+        }
+        ysfx_midi_copy(lane->midi.in.get(), leader->midi.in.get());
+    }
+}
+
+// below this, a voice without a note is done sounding
+static const ysfx_real ysfx_chain_voice_silence = (ysfx_real)1e-6;
+
+// the voice for a new note: a free one, else the earliest released, else the earliest held
+static uint32_t ysfx_chain_pick_voice(const ysfx_chain_stage_t &stage)
+{
+    uint32_t best = 0;
+    auto rank = [](const ysfx_chain_voice_t &voice) -> int {
+        return !voice.active ? 0 : !voice.held ? 1 : 2;
+    };
+    for (uint32_t i = 1; i < (uint32_t)stage.voices.size(); ++i) {
+        const ysfx_chain_voice_t &a = stage.voices[i];
+        const ysfx_chain_voice_t &b = stage.voices[best];
+        if (rank(a) < rank(b) || (rank(a) == rank(b) && a.stamp < b.stamp))
+            best = i;
+    }
+    return best;
+}
+
+// give the notes to the voices, and the other events to all of them
+static void ysfx_chain_route_voices(ysfx_chain_stage_t &stage, ysfx_midi_buffer_t *midi)
+{
+    const ysfx_t *leader = stage.branches[0]->stages[0].fx.get();
+    const ysfx_source_unit_t *main = leader->source.main.get();
+
+    for (uint32_t i = 0; i < (uint32_t)stage.voices.size(); ++i) {
+        ysfx_chain_t *branch = stage.branches[i].get();
+        ysfx_midi_clear(branch->midi_out.get());
+        stage.voices[i].runs = stage.voices[i].active;
+
+        // the sliders of the first voice
+        ysfx_t *fx = branch->stages[0].fx.get();
+        if (main && fx != leader) {
+            for (uint32_t index : main->header.slider_indices) {
+                ysfx_real value = *leader->var.slider[index];
+                if (*fx->var.slider[index] != value)
+                    ysfx_slider_set_value(fx, index, value, true);
+            }
+        }
+    }
+
+    auto send = [&stage](uint32_t i, const ysfx_midi_event_t &event) {
+        ysfx_midi_push(stage.branches[i]->midi_out.get(), &event);
+        stage.voices[i].runs = true;
+    };
+
+    ysfx_midi_event_t event;
+    while (ysfx_midi_get_next(midi, &event)) {
+        const uint8_t status = (event.size == 3) ? (event.data[0] & 0xf0) : 0;
+        const uint8_t channel = event.data[0] & 0x0f;
+        const bool on = status == 0x90 && event.data[2] > 0;
+        const bool off = status == 0x80 || (status == 0x90 && event.data[2] == 0);
+
+        if (on) {
+            uint32_t i = ysfx_chain_pick_voice(stage);
+            ysfx_chain_voice_t &voice = stage.voices[i];
+            // a stolen voice releases its note first
+            if (voice.held) {
+                const uint8_t release[] = {(uint8_t)(0x80 | voice.channel), voice.note, 0};
+                ysfx_midi_event_t noteoff = event;
+                noteoff.data = release;
+                send(i, noteoff);
+            }
+            voice.channel = channel;
+            voice.note = event.data[1];
+            voice.held = true;
+            voice.active = true;
+            voice.stamp = ++stage.voice_stamp;
+            send(i, event);
+        }
+        else if (off) {
+            for (uint32_t i = 0; i < (uint32_t)stage.voices.size(); ++i) {
+                ysfx_chain_voice_t &voice = stage.voices[i];
+                if (voice.held && voice.channel == channel && voice.note == event.data[1]) {
+                    voice.held = false;
+                    voice.stamp = ++stage.voice_stamp;
+                    send(i, event);
+                }
+            }
+        }
+        else {
+            // all sound or notes off release every voice of the channel
+            const bool all_off = status == 0xb0 && (event.data[1] == 120 || event.data[1] == 123);
+            for (uint32_t i = 0; i < (uint32_t)stage.voices.size(); ++i) {
+                if (all_off && stage.voices[i].channel == channel)
+                    stage.voices[i].held = false;
+                send(i, event);
+            }
+        }
+    }
+}
+
+// the voices start from silence, and the sum of those which run is added to the signal
+static void ysfx_chain_run_voices(ysfx_chain_stage_t &stage, ysfx_chain_pool_t *pool, ysfx_real *const *channels, uint32_t num_channels, uint32_t num_frames, ysfx_midi_buffer_t *midi)
+{
+    ysfx_chain_route_voices(stage, midi);
+    ysfx_midi_clear(midi);
+
+    uint32_t num_running = 0;
+    for (uint32_t i = 0; i < (uint32_t)stage.voices.size(); ++i) {
+        if (!stage.voices[i].runs)
+            continue;
+        ysfx_chain_t *branch = stage.branches[i].get();
+        ysfx_chain_prepare(branch, num_channels, num_frames);
+        for (uint32_t ch = 0; ch < num_channels; ++ch)
+            std::fill_n(branch->channels[ch], num_frames, 0);
+        ++num_running;
+    }
+
+    if (pool && num_running > 1)
+        pool->run(&stage, channels, num_channels, num_frames);
+    else {
+        for (uint32_t i = 0; i < (uint32_t)stage.voices.size(); ++i)
+            ysfx_chain_run_job(&stage, i, channels, num_channels, num_frames);
+    }
+
+    for (uint32_t i = 0; i < (uint32_t)stage.voices.size(); ++i) {
+        ysfx_chain_voice_t &voice = stage.voices[i];
+        if (!voice.runs)
+            continue;
+        ysfx_chain_t *branch = stage.branches[i].get();
+        ysfx_real peak = 0;
+        for (uint32_t ch = 0; ch < num_channels; ++ch) {
+            const ysfx_real *src = branch->channels[ch];
+            ysfx_real *dst = channels[ch];
+            for (uint32_t f = 0; f < num_frames; ++f) {
+                dst[f] += src[f];
+                peak = std::max(peak, std::fabs(src[f]));
+            }
+        }
+        ysfx_midi_append(midi, branch->midi_out.get());
+        // a voice without a note rests once it is silent
+        voice.active = voice.held || peak >= ysfx_chain_voice_silence;
+    }
+}
+
+// process the channels in place; `midi_out` holds the input events on entry, and the output events on exit
+static void ysfx_chain_run(ysfx_chain_t *chain, ysfx_chain_pool_t *pool, uint32_t num_channels, uint32_t num_frames)
+{
+    ysfx_chain_run_stages(chain, 0, (uint32_t)chain->stages.size(), pool, chain->channels.data(), num_channels, num_frames, chain->midi_out.get());
+}
+
+// process the given channels through a range of stages; `midi` holds the input events on entry, and the output events on exit
+static void ysfx_chain_run_stages(ysfx_chain_t *chain, uint32_t begin, uint32_t end, ysfx_chain_pool_t *pool, ysfx_real *const *channels, uint32_t num_channels, uint32_t num_frames, ysfx_midi_buffer_t *midi)
+{
+    for (uint32_t index = begin; index < end; ++index) {
+        ysfx_chain_stage_t &stage = chain->stages[index];
+        if (ysfx_t *fx = stage.fx.get()) {
+            // hand the MIDI over to the effect and back, without copying
+            ysfx_midi_swap(fx->midi.in.get(), midi);
+            ysfx_midi_clear(midi);
+            ysfx_process_double(fx, channels, channels, num_channels, num_channels, num_frames);
+            ysfx_midi_swap(midi, fx->midi.out.get());
+            ysfx_midi_clear(fx->midi.out.get());
+            continue;
+        }
+
+        if (!stage.lanes.empty()) {
+            ysfx_chain_prepare_lanes(stage, midi);
+            if (pool && stage.lanes.size() > 1)
+                pool->run(&stage, channels, num_channels, num_frames);
+            else {
+                for (uint32_t i = 0; i < (uint32_t)stage.lanes.size(); ++i)
+                    ysfx_chain_run_job(&stage, i, channels, num_channels, num_frames);
+            }
+            // the MIDI out is the first lane's
+            ysfx_midi_swap(midi, stage.lanes[0]->midi.out.get());
+            for (ysfx_u &lane : stage.lanes)
+                ysfx_midi_clear(lane->midi.out.get());
+            continue;
+        }
+
+        if (!stage.voices.empty()) {
+            ysfx_chain_run_voices(stage, pool, channels, num_channels, num_frames, midi);
+            continue;
+        }
+
+        // every branch starts from a copy of the current signal
+        for (ysfx_chain_u &branch_u : stage.branches) {
+            ysfx_chain_t *branch = branch_u.get();
+            ysfx_chain_prepare(branch, num_channels, num_frames);
+            for (uint32_t ch = 0; ch < num_channels; ++ch)
+                std::copy_n(channels[ch], num_frames, branch->channels[ch]);
+            ysfx_midi_copy(branch->midi_out.get(), midi);
+        }
+
+        if (pool && stage.branches.size() > 1)
+            pool->run(&stage, channels, num_channels, num_frames);
+        else {
+            for (ysfx_chain_u &branch : stage.branches)
+                ysfx_chain_run(branch.get(), nullptr, num_channels, num_frames);
+        }
+
+        // mix the branches together
+        for (uint32_t ch = 0; ch < num_channels; ++ch)
+            std::fill_n(channels[ch], num_frames, 0);
+        ysfx_midi_clear(midi);
+        for (ysfx_chain_u &branch_u : stage.branches) {
+            ysfx_chain_t *branch = branch_u.get();
+            for (uint32_t ch = 0; ch < num_channels; ++ch) {
+                const ysfx_real *src = branch->channels[ch];
+                ysfx_real *dst = channels[ch];
+                for (uint32_t i = 0; i < num_frames; ++i)
+                    dst[i] += src[i];
+            }
+            ysfx_midi_append(midi, branch->midi_out.get());
+        }
+    }
+}
+
+// move the events of `src` in the frames [begin, end) to `dst`, from the frame `to`; the last piece also takes those after
+static void ysfx_chain_move_midi(ysfx_midi_buffer_t *dst, ysfx_midi_buffer_t *src, uint32_t begin, uint32_t end, uint32_t to, bool last)
+{
+    ysfx_midi_rewind(src);
+    ysfx_midi_event_t event;
+    while (ysfx_midi_get_next_raw(src, &event)) {
+        if (event.offset < begin || (event.offset >= end && !last))
+            continue;
+        event.offset = to + std::min(event.offset, end - 1) - begin;
+        ysfx_midi_push(dst, &event);
+    }
+}
+
+template <class Real>
+static void ysfx_chain_process_pipelined(ysfx_chain_t *chain, const Real *const *ins, Real *const *outs, uint32_t num_ins, uint32_t num_outs, uint32_t num_frames)
+{
+    ysfx_chain_pipeline_t *pipeline = chain->pipeline.get();
+    const uint32_t num_channels = pipeline->num_channels;
+    const uint32_t block_size = pipeline->num_frames;
+
+    // the blocks have the size of the capacity, and the cycles go in and out of the first in pieces
+    //   a frame is read out where the next one is written, and it comes back after a block per group
+    ysfx_midi_clear(chain->midi_out.get());
+    for (uint32_t done = 0; done < num_frames; ) {
+        ysfx_chain_block_t &block = pipeline->blocks[0];
+        const uint32_t position = pipeline->position;
+        const uint32_t count = std::min(num_frames - done, block_size - position);
+        if (count == 0)
+            break;
+
+        for (uint32_t ch = 0; ch < std::min(num_outs, num_channels); ++ch)
+            ysfx::convert_out(block.channels[ch] + position, outs[ch] + done, count);
+        for (uint32_t ch = 0; ch < std::min(num_ins, num_channels); ++ch)
+            ysfx::convert_in(ins[ch] + done, block.channels[ch] + position, count, 0);
+        for (uint32_t ch = num_ins; ch < num_channels; ++ch)
+            std::fill_n(block.channels[ch] + position, count, 0);
+
+        ysfx_chain_move_midi(chain->midi_out.get(), pipeline->midi_out.get(), position, position + count, done, position + count == block_size);
+        ysfx_chain_move_midi(block.midi.get(), chain->midi_in.get(), done, done + count, position, done + count == num_frames);
+
+        done += count;
+        pipeline->position = position + count;
+        if (pipeline->position == block_size) {
+            pipeline->position = 0;
+            pipeline->run();
+        }
+    }
+    ysfx_midi_clear(chain->midi_in.get());
+    ysfx_midi_rewind(chain->midi_out.get());
+
+    // the channels beyond the capacity are silent, and all of them until it's set
+    for (uint32_t ch = (block_size > 0) ? num_channels : 0; ch < num_outs; ++ch)
+        std::fill_n(outs[ch], num_frames, (Real)0);
+}
+
+template <class Real>
+static void ysfx_chain_process_generic(ysfx_chain_t *chain, const Real *const *ins, Real *const *outs, uint32_t num_ins, uint32_t num_outs, uint32_t num_frames)
+{
+    if (chain->pipeline) {
+        ysfx_chain_process_pipelined(chain, ins, outs, num_ins, num_outs, num_frames);
+        return;
+    }
+
+    const uint32_t num_channels = std::min<uint32_t>(std::max(num_ins, num_outs), ysfx_max_channels);
+    ysfx_chain_prepare(chain, num_channels, num_frames);
+    ysfx_real *const *channels = chain->channels.data();
+    ysfx_midi_buffer_t *midi = chain->midi_out.get();
+
+    // convert once on entry
+    for (uint32_t ch = 0; ch < std::min(num_ins, num_channels); ++ch)
+        ysfx::convert_in(ins[ch], channels[ch], num_frames, 0);
+    for (uint32_t ch = num_ins; ch < num_channels; ++ch)
+        std::fill_n(channels[ch], num_frames, 0);
+
+    ysfx_midi_clear(midi);
+    ysfx_midi_swap(midi, chain->midi_in.get());
+
+    ysfx_chain_run(chain, chain->pool.get(), num_channels, num_frames);
+
+    ysfx_midi_rewind(chain->midi_out.get());
+
+    // convert once on exit
+    for (uint32_t ch = 0; ch < std::min(num_outs, num_channels); ++ch)
+        ysfx::convert_out(channels[ch], outs[ch], num_frames);
+    for (uint32_t ch = num_channels; ch < num_outs; ++ch)
+        std::fill_n(outs[ch], num_frames, (Real)0);
+}
+
+void ysfx_chain_process_float(ysfx_chain_t *chain, const float *const *ins, float *const *outs, uint32_t num_ins, uint32_t num_outs, uint32_t num_frames)
+{
+    ysfx_chain_process_generic<float>(chain, ins, outs, num_ins, num_outs, num_frames);
+}
+
+void ysfx_chain_process_double(ysfx_chain_t *chain, const double *const *ins, double *const *outs, uint32_t num_ins, uint32_t num_outs, uint32_t num_frames)
+{
+    ysfx_chain_process_generic<double>(chain, ins, outs, num_ins, num_outs, num_frames);
+}
@@ -0,0 +1,135 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+#include "ysfx.h"
+#include "ysfx_midi.hpp"
+#include "utility/rt_semaphore.h"
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <memory>
+
+// the allocation of a voice, which is one of the branches of a stage of voices
+struct ysfx_chain_voice_t {
+    // the note which holds the voice, since the last note-on which it took
+    uint8_t channel = 0;
+    uint8_t note = 0;
+    bool held = false;
+    // whether it still sounds, or it waits for a note
+    bool active = false;
+    // whether it processes this cycle: it's active, or it has events
+    bool runs = false;
+    // the order of the last note-on or note-off, for stealing
+    uint64_t stamp = 0;
+};
+
+// a stage is either a single effect, a set of branches which run in parallel,
+//   the copies of an effect which run in parallel on groups of channels,
+//   or the voices of an effect, as branches which run only while they sound
+struct ysfx_chain_stage_t {
+    ysfx_u fx;
+    std::vector<ysfx_chain_u> branches;
+    // the first lane is the effect which was appended, whose sliders the others follow
+    std::vector<ysfx_u> lanes;
+    uint32_t lane_width = 0;
+    // one per branch, if this is a stage of voices; the first is the effect which was appended
+    std::vector<ysfx_chain_voice_t> voices;
+    uint64_t voice_stamp = 0;
+    // the jobs of a cycle, branches or lanes
+    uint32_t num_jobs() const { return (uint32_t)(lanes.empty() ? branches.size() : lanes.size()); }
+};
+
+// workers which take the branches of a parallel stage, or else the executor of the host
+struct ysfx_chain_pool_t {
+    explicit ysfx_chain_pool_t(uint32_t num_threads);
+    ~ysfx_chain_pool_t();
+    void run(ysfx_chain_stage_t *stage, ysfx_real *const *channels, uint32_t num_channels, uint32_t num_frames);
+    void run_job(uint32_t index);
+
+    std::vector<std::thread> threads;
+    RTSemaphore wake;
+    RTSemaphore done;
+    std::atomic<bool> quit{false};
+    // the current job
+    ysfx_chain_stage_t *stage = nullptr;
+    ysfx_real *const *channels = nullptr;
+    uint32_t num_channels = 0;
+    uint32_t num_frames = 0;
+    std::atomic<uint32_t> next_branch{0};
+    // the pool of the host, which is tried first
+    ysfx_chain_executor_t *executor = nullptr;
+    void *executor_data = nullptr;
+};
+using ysfx_chain_pool_u = std::unique_ptr<ysfx_chain_pool_t>;
+
+// a block of the signal which goes down a pipeline, with its MIDI
+struct ysfx_chain_block_t {
+    std::vector<ysfx_real> buffer;
+    std::vector<ysfx_real *> channels;
+    ysfx_midi_buffer_u midi;
+};
+
+// threads which run the groups of consecutive stages, each on the block of a different cycle
+struct ysfx_chain_pipeline_t {
+    ysfx_chain_pipeline_t(ysfx_chain_t *chain, uint32_t num_groups, const uint32_t *group_sizes);
+    ~ysfx_chain_pipeline_t();
+    // size the blocks, and start again from silence if it changes; not on the audio thread
+    void prepare(uint32_t num_channels, uint32_t num_frames);
+    // run every group on its block, then move the blocks down; the block which leaves comes first, its MIDI in `midi_out`
+    void run();
+    void run_group(uint32_t group);
+
+    ysfx_chain_t *chain = nullptr;
+    uint32_t num_groups = 0;
+    std::vector<uint32_t> group_sizes;
+    // the first stage of each group for this cycle, and the end of the last
+    std::vector<uint32_t> first;
+    // the block which each group processes this cycle
+    std::vector<ysfx_chain_block_t> blocks;
+    // the groups which hold a block of the input, from the first; the others wait for the pipeline to fill
+    uint32_t filled = 0;
+    uint32_t num_channels = 0;
+    uint32_t num_frames = 0;
+    // the frames of the cycles which entered the first block, which are also those read out of it
+    uint32_t position = 0;
+    // the MIDI of the block which left, read as the next one enters
+    ysfx_midi_buffer_u midi_out;
+    // a thread per group, from the second; the calling thread runs the first
+    struct worker_t {
+        std::thread thread;
+        RTSemaphore wake;
+    };
+    std::vector<std::unique_ptr<worker_t>> workers;
+    RTSemaphore done;
+    std::atomic<bool> quit{false};
+};
+using ysfx_chain_pipeline_u = std::unique_ptr<ysfx_chain_pipeline_t>;
+
+struct ysfx_chain_s {
+    std::vector<ysfx_chain_stage_t> stages;
+    // planar buffer, in the real type of the VM
+    std::vector<ysfx_real> buffer;
+    std::vector<ysfx_real *> channels;
+    // MIDI entering the chain, and MIDI leaving it
+    ysfx_midi_buffer_u midi_in;
+    ysfx_midi_buffer_u midi_out;
+    ysfx_chain_pool_u pool;
+    uint32_t num_threads = 1;
+    ysfx_chain_pipeline_u pipeline;
+    std::atomic<uint32_t> ref_count{1};
+};
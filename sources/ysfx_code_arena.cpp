@@ -0,0 +1,284 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "ysfx_code_arena.hpp"
+#include <algorithm>
+#if defined(_WIN32)
+#   include <windows.h>
+#else
+#   include <sys/mman.h>
+#   include <unistd.h>
+#endif
+
+size_t ysfx_code_arena_t::page_size()
+{
+    // the same as the compiler of EEL rounds its blocks to
+    static const size_t size = []() -> size_t {
+#if defined(_WIN32)
+        SYSTEM_INFO info{};
+        GetSystemInfo(&info);
+        return std::max<size_t>(info.dwPageSize, 4096);
+#else
+        long ps = sysconf(_SC_PAGESIZE);
+        return std::max<size_t>(ps > 0 ? (size_t)ps : 0, 4096);
+#endif
+    }();
+    return size;
+}
+
+// map pages which are not committed yet, aligned to a power of 2
+static uint8_t *ysfx_reserve_pages(size_t size, size_t align)
+{
+#if defined(_WIN32)
+    (void)align;
+    return (uint8_t *)VirtualAlloc(nullptr, size, MEM_RESERVE, PAGE_NOACCESS);
+#else
+    // map more, and cut what is around the aligned part
+    size_t extra = (align > ysfx_code_arena_t::page_size()) ? align : 0;
+    void *ptr = mmap(nullptr, size + extra, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE, -1, 0);
+    if (ptr == MAP_FAILED)
+        return nullptr;
+    uint8_t *base = (uint8_t *)ptr;
+    uint8_t *aligned = (uint8_t *)(((uintptr_t)base + extra) & ~(uintptr_t)(extra ? (align - 1) : 0));
+    if (extra) {
+        if (aligned > base)
+            munmap(base, (size_t)(aligned - base));
+        if (aligned + size < base + size + extra)
+            munmap(aligned + size, (size_t)(base + size + extra - (aligned + size)));
+    }
+    return aligned;
+#endif
+}
+
+static void ysfx_unreserve_pages(uint8_t *base, size_t size)
+{
+#if defined(_WIN32)
+    (void)size;
+    VirtualFree(base, 0, MEM_RELEASE);
+#else
+    munmap(base, size);
+#endif
+}
+
+static bool ysfx_commit_pages(uint8_t *ptr, size_t size)
+{
+#if defined(_WIN32)
+    return VirtualAlloc(ptr, size, MEM_COMMIT, PAGE_READWRITE) != nullptr;
+#else
+    // the pages of the regions stay readable and writable while they are free
+    (void)ptr;
+    (void)size;
+    return true;
+#endif
+}
+
+ysfx_code_arena_t::ysfx_code_arena_t(size_t region_size)
+    : m_region_size((region_size + page_size() - 1) / page_size() * page_size())
+{
+}
+
+ysfx_code_arena_t::~ysfx_code_arena_t()
+{
+    for (region_t *region : m_regions) {
+        ysfx_unreserve_pages(region->base, region->size);
+        delete region;
+    }
+}
+
+ysfx_code_arena_t::region_t *ysfx_code_arena_t::new_region()
+{
+    uint8_t *base = ysfx_reserve_pages(m_region_size, m_region_size);
+    if (!base)
+        return nullptr;
+
+#if defined(MADV_HUGEPAGE)
+    if (m_huge_pages)
+        madvise(base, m_region_size, MADV_HUGEPAGE);
+#endif
+
+    region_t *region = new region_t;
+    region->base = base;
+    region->size = m_region_size;
+    region->free.emplace(0, m_region_size);
+    m_regions.push_back(region);
+    return region;
+}
+
+void *ysfx_code_arena_t::allocate(size_t size)
+{
+    if (size == 0 || size % page_size() != 0)
+        return nullptr;
+
+    if (size > m_region_size) {
+        uint8_t *ptr = ysfx_reserve_pages(size, page_size());
+        if (ptr && !ysfx_commit_pages(ptr, size)) {
+            ysfx_unreserve_pages(ptr, size);
+            ptr = nullptr;
+        }
+        if (ptr) {
+            std::lock_guard<ysfx::mutex> lock{m_mutex};
+            m_large_bytes += size;
+        }
+        return ptr;
+    }
+
+    std::lock_guard<ysfx::mutex> lock{m_mutex};
+
+    // the first which fits, at the lowest address, which keeps the code together
+    auto take = [this, size](region_t *region) -> void * {
+        for (auto it = region->free.begin(); it != region->free.end(); ++it) {
+            if (it->second < size)
+                continue;
+            size_t offset = it->first;
+            size_t rest = it->second - size;
+            region->free.erase(it);
+            if (rest > 0)
+                region->free.emplace(offset + size, rest);
+            uint8_t *ptr = region->base + offset;
+            if (!ysfx_commit_pages(ptr, size)) {
+                deallocate_span(region, offset, size);
+                return nullptr;
+            }
+            region->used += size;
+            return ptr;
+        }
+        return nullptr;
+    };
+
+    for (region_t *region : m_regions) {
+        if (region->size - region->used < size)
+            continue;
+        if (void *ptr = take(region))
+            return ptr;
+    }
+
+    region_t *region = new_region();
+    return region ? take(region) : nullptr;
+}
+
+void ysfx_code_arena_t::deallocate(void *ptr_, size_t size)
+{
+    uint8_t *ptr = (uint8_t *)ptr_;
+    if (!ptr)
+        return;
+
+    std::unique_lock<ysfx::mutex> lock{m_mutex};
+
+    auto it = std::find_if(m_regions.begin(), m_regions.end(), [ptr](const region_t *region) -> bool {
+        return ptr >= region->base && ptr < region->base + region->size;
+    });
+    if (it == m_regions.end()) {
+        m_large_bytes -= size;
+        lock.unlock();
+        ysfx_unreserve_pages(ptr, size);
+        return;
+    }
+
+    region_t *region = *it;
+    release_pages(ptr, size);
+    deallocate_span(region, (size_t)(ptr - region->base), size);
+    region->used -= size;
+
+    // an empty region goes back to the system, but the last, which the next compilation takes
+    if (region->used == 0 && m_regions.size() > 1) {
+        ysfx_unreserve_pages(region->base, region->size);
+        delete region;
+        m_regions.erase(it);
+    }
+}
+
+void ysfx_code_arena_t::deallocate_span(region_t *region, size_t offset, size_t size)
+{
+    std::map<size_t, size_t> &free = region->free;
+    auto next = free.emplace(offset, size).first;
+
+    // merge with the free neighbors
+    if (next != free.begin()) {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == offset) {
+            prev->second += next->second;
+            free.erase(next);
+            next = prev;
+        }
+    }
+    auto after = std::next(next);
+    if (after != free.end() && next->first + next->second == after->first) {
+        next->second += after->second;
+        free.erase(after);
+    }
+}
+
+void ysfx_code_arena_t::release_pages(void *ptr, size_t size)
+{
+#if defined(_WIN32)
+    VirtualFree(ptr, size, MEM_DECOMMIT);
+#else
+    // the code was executable; the pages are writable again for the next, and their memory is dropped
+    mprotect(ptr, size, PROT_READ|PROT_WRITE);
+#   if defined(MADV_DONTNEED)
+    madvise(ptr, size, MADV_DONTNEED);
+#   endif
+#endif
+}
+
+void ysfx_code_arena_t::set_huge_pages(bool enable)
+{
+    std::lock_guard<ysfx::mutex> lock{m_mutex};
+    m_huge_pages = enable;
+}
+
+void ysfx_code_arena_t::get_stats(ysfx_code_arena_stats_t *stats)
+{
+    std::lock_guard<ysfx::mutex> lock{m_mutex};
+    stats->reserved_bytes = m_large_bytes;
+    stats->used_bytes = m_large_bytes;
+    for (const region_t *region : m_regions) {
+        stats->reserved_bytes += region->size;
+        stats->used_bytes += region->used;
+    }
+    stats->num_regions = (uint32_t)m_regions.size();
+}
+
+ysfx_code_arena_t &ysfx_get_code_arena()
+{
+    // it is never destroyed, since code may be freed at the exit of the process
+    static ysfx_code_arena_t *arena = new ysfx_code_arena_t;
+    return *arena;
+}
+
+void ysfx_set_code_huge_pages(bool enable)
+{
+    ysfx_get_code_arena().set_huge_pages(enable);
+}
+
+void ysfx_get_code_arena_stats(ysfx_code_arena_stats_t *stats)
+{
+    ysfx_get_code_arena().get_stats(stats);
+}
+
+//------------------------------------------------------------------------------
+// the allocator of the pages of the compiler of EEL, by `NSEEL_CODE_ALLOC`
+
+extern "C" void *ysfx_eel_code_alloc(size_t size)
+{
+    return ysfx_get_code_arena().allocate(size);
+}
+
+extern "C" void ysfx_eel_code_free(void *ptr, size_t size)
+{
+    ysfx_get_code_arena().deallocate(ptr, size);
+}
@@ -0,0 +1,77 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+#include "ysfx.h"
+#include "ysfx_utils.hpp"
+#include <map>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// The arena holds the generated code of all the effects of the process, in
+// regions which it maps once, so that the code of the sections is contiguous,
+// instead of scattered over as many mappings as there are compilations.
+//
+// The compiler asks for whole pages, which it writes, and then makes executable;
+// pages are never shared by two of its blocks, so that a page is not writable
+// while code runs from it. The pages which come back are released to the system
+// and merged with their free neighbors; a region which becomes empty is unmapped.
+
+class ysfx_code_arena_t {
+public:
+    explicit ysfx_code_arena_t(size_t region_size = 2 << 20);
+    ~ysfx_code_arena_t();
+
+    ysfx_code_arena_t(const ysfx_code_arena_t &) = delete;
+    ysfx_code_arena_t &operator=(const ysfx_code_arena_t &) = delete;
+
+    // get pages which are readable and writable, for a size which is a multiple of the page size
+    void *allocate(size_t size);
+    // give back pages, with the size which they were allocated with
+    void deallocate(void *ptr, size_t size);
+
+    // advise the system to back the regions created after, with huge pages where it can
+    void set_huge_pages(bool enable);
+    void get_stats(ysfx_code_arena_stats_t *stats);
+
+    static size_t page_size();
+
+private:
+    struct region_t {
+        uint8_t *base = nullptr;
+        size_t size = 0;
+        size_t used = 0;
+        // the free spans, as size by offset
+        std::map<size_t, size_t> free;
+    };
+
+    region_t *new_region();
+    void deallocate_span(region_t *region, size_t offset, size_t size);
+    void release_pages(void *ptr, size_t size);
+
+private:
+    const size_t m_region_size;
+    bool m_huge_pages = false;
+    ysfx::mutex m_mutex;
+    std::vector<region_t *> m_regions;
+    // the allocations larger than a region, which are mapped on their own
+    uint64_t m_large_bytes = 0;
+};
+
+// the arena of the process, which the compiler of EEL takes its pages from
+ysfx_code_arena_t &ysfx_get_code_arena();
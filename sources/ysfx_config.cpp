@@ -16,10 +16,16 @@
 //
 
 #include "ysfx_config.hpp"
+#include "ysfx.hpp"
 #include "ysfx_utils.hpp"
+#include "ysfx_import_index.hpp"
 #include "ysfx_audio_wav.hpp"
 #include "ysfx_audio_flac.hpp"
+#include "ysfx_audio_mp3.hpp"
+#include "ysfx_audio_ogg.hpp"
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 
 ysfx_config_t *ysfx_config_new()
 {
@@ -40,6 +46,58 @@ void ysfx_config_add_ref(ysfx_config_t *config)
     config->ref_count.fetch_add(1, std::memory_order_relaxed);
 }
 
+void ysfx_prewarm(ysfx_config_t *config, const char *filepath)
+{
+    // the thread loads with a copy of the settings, so it does not keep this one alive
+    ysfx_config_u copy{ysfx_config_new()};
+    copy->import_root = config->import_root;
+    copy->data_root = config->data_root;
+    copy->cache_root = config->cache_root;
+    copy->write_root = config->write_root;
+    copy->audio_formats = config->audio_formats;
+    copy->log_reporter = config->log_reporter;
+    copy->userdata = config->userdata;
+
+    std::lock_guard<std::mutex> lock{config->prewarmer_mutex};
+    if (!config->prewarmer)
+        config->prewarmer.reset(new ysfx_prewarmer_t);
+    config->prewarmer->request(filepath, std::move(copy));
+}
+
+void ysfx_prewarm_wait(ysfx_config_t *config)
+{
+    std::lock_guard<std::mutex> lock{config->prewarmer_mutex};
+    if (config->prewarmer)
+        config->prewarmer->wait();
+}
+
+void ysfx_preload(ysfx_config_t *config, const char *manifest)
+{
+    std::vector<std::string> paths = ysfx_preload_manifest_split(manifest);
+    if (paths.empty())
+        return;
+
+    std::shared_ptr<ysfx_preloader_t::settings_t> settings{new ysfx_preloader_t::settings_t};
+    settings->audio_cache = config->audio_cache;
+    settings->audio_formats = config->audio_formats;
+
+    std::lock_guard<std::mutex> lock{config->preloader_mutex};
+    if (!config->preloader) {
+        uint32_t num_threads = config->load_threads;
+        if (num_threads == 0)
+            num_threads = std::thread::hardware_concurrency();
+        config->preloader.reset(new ysfx_preloader_t(num_threads));
+    }
+    config->preloader->request(paths, std::move(settings));
+}
+
+void ysfx_preload_wait(ysfx_config_t *config)
+{
+    std::lock_guard<std::mutex> lock{config->preloader_mutex};
+    if (config->preloader)
+        config->preloader->wait();
+}
+
 void ysfx_set_import_root(ysfx_config_t *config, const char *root)
 {
     config->import_root = ysfx::path_ensure_final_separator(root ? root : "");
@@ -50,6 +108,21 @@ void ysfx_set_data_root(ysfx_config_t *config, const char *root)
     config->data_root = ysfx::path_ensure_final_separator(root ? root : "");
 }
 
+void ysfx_refresh_import_root(ysfx_config_t *config)
+{
+    ysfx_import_index_invalidate(config->import_root);
+}
+
+void ysfx_set_cache_root(ysfx_config_t *config, const char *root)
+{
+    config->cache_root = ysfx::path_ensure_final_separator(root ? root : "");
+}
+
+void ysfx_set_write_root(ysfx_config_t *config, const char *root)
+{
+    config->write_root = ysfx::path_ensure_final_separator(root ? root : "");
+}
+
 const char *ysfx_get_import_root(ysfx_config_t *config)
 {
     return config->import_root.c_str();
@@ -60,6 +133,16 @@ const char *ysfx_get_data_root(ysfx_config_t *config)
     return config->data_root.c_str();
 }
 
+const char *ysfx_get_cache_root(ysfx_config_t *config)
+{
+    return config->cache_root.c_str();
+}
+
+const char *ysfx_get_write_root(ysfx_config_t *config)
+{
+    return config->write_root.c_str();
+}
+
 void ysfx_guess_file_roots(ysfx_config_t *config, const char *sourcepath)
 {
     if (config->import_root.empty()) {
@@ -97,15 +180,30 @@ void ysfx_guess_file_roots(ysfx_config_t *config, const char *sourcepath)
     }
 }
 
+// the listings depend on the formats which the files can have
+static void ysfx_forget_dir_listings(ysfx_config_t *config)
+{
+    std::lock_guard<std::mutex> lock(config->dir_listings_mutex);
+    config->dir_listings.clear();
+}
+
 void ysfx_register_audio_format(ysfx_config_t *config, ysfx_audio_format_t *afmt)
 {
     config->audio_formats.push_back(*afmt);
+    ysfx_forget_dir_listings(config);
 }
 
 void ysfx_register_builtin_audio_formats(ysfx_config_t *config)
 {
+    ysfx_forget_dir_listings(config);
     config->audio_formats.push_back(ysfx_audio_format_wav);
     config->audio_formats.push_back(ysfx_audio_format_flac);
+#if !defined(YSFX_NO_MP3)
+    config->audio_formats.push_back(ysfx_audio_format_mp3);
+#endif
+#if !defined(YSFX_NO_OGG)
+    config->audio_formats.push_back(ysfx_audio_format_ogg);
+#endif
 }
 
 void ysfx_set_log_reporter(ysfx_config_t *config, ysfx_log_reporter_t *reporter)
@@ -113,11 +211,42 @@ void ysfx_set_log_reporter(ysfx_config_t *config, ysfx_log_reporter_t *reporter)
     config->log_reporter = reporter;
 }
 
+void ysfx_set_audio_cache_size(ysfx_config_t *config, uint64_t max_bytes)
+{
+    if (max_bytes == 0)
+        config->audio_cache.reset();
+    else if (config->audio_cache)
+        ysfx_audio_cache_resize(*config->audio_cache, max_bytes);
+    else
+        config->audio_cache.reset(new ysfx_audio_cache_t(max_bytes));
+}
+
+void ysfx_set_load_threads(ysfx_config_t *config, uint32_t num_threads)
+{
+    config->load_threads = num_threads;
+}
+
+void ysfx_share_audio_cache(ysfx_config_t *config, ysfx_config_t *other)
+{
+    config->audio_cache = other->audio_cache;
+}
+
 void ysfx_set_user_data(ysfx_config_t *config, intptr_t userdata)
 {
     config->userdata = userdata;
 }
 
+void ysfx_set_gmem_file(ysfx_config_t *config, const char *name, const char *path, uint32_t size)
+{
+    if (!path || !*path) {
+        config->gmem_files.erase(name);
+        return;
+    }
+    ysfx_gmem_file_t &file = config->gmem_files[name];
+    file.path.assign(path);
+    file.size = size;
+}
+
 //------------------------------------------------------------------------------
 const char *ysfx_log_level_string(ysfx_log_level level)
 {
@@ -136,6 +265,11 @@ const char *ysfx_log_level_string(ysfx_log_level level)
 
 void ysfx_log(ysfx_config_t &conf, ysfx_log_level level, const char *message)
 {
+    if (ysfx_get_thread_id() == ysfx_thread_id_dsp) {
+        conf.log_queue->post(level, message, strlen(message));
+        return;
+    }
+
     if (conf.log_reporter)
         conf.log_reporter(conf.userdata, level, message);
     else
@@ -157,3 +291,18 @@ void ysfx_logf(ysfx_config_t &conf, ysfx_log_level level, const char *format, ..
     ysfx_logfv(conf, level, format, ap);
     va_end(ap);
 }
+
+void ysfx_log_stdout(ysfx_config_t &conf, const char *text, size_t length)
+{
+    if (ysfx_get_thread_id() == ysfx_thread_id_dsp) {
+        const size_t chunk = ysfx_log_queue_t::message_size - 1;
+        for (size_t i = 0; i < length; i += chunk) {
+            if (!conf.log_queue->post(ysfx_log_queue_t::stdout_kind, text + i, std::min(chunk, length - i)))
+                break;
+        }
+        return;
+    }
+
+    fwrite(text, length, 1, stdout);
+    fflush(stdout);
+}
@@ -17,23 +17,59 @@
 
 #pragma once
 #include "ysfx.h"
+#include "ysfx_audio_cache.hpp"
+#include "ysfx_gmem.hpp"
+#include "ysfx_log_queue.hpp"
+#include "ysfx_prewarm.hpp"
+#include "ysfx_preload.hpp"
+#include "ysfx_utils.hpp"
 #include <vector>
 #include <string>
+#include <map>
+#include <mutex>
 #include <atomic>
 #include <cstdarg>
 
+// the files of a directory which effects can open, as of a stamp of the directory
+struct ysfx_dir_listing_t {
+    ysfx::file_stamp stamp{};
+    ysfx::string_list files;
+};
+
 struct ysfx_config_s {
     std::string import_root;
     std::string data_root;
+    std::string cache_root;
+    std::string write_root;
     std::vector<ysfx_audio_format_t> audio_formats;
+    // the decoded audio files, possibly shared with other configurations
+    ysfx_audio_cache_sp audio_cache;
+    // the listings of the directories of file sliders, by path
+    std::map<std::string, ysfx_dir_listing_t> dir_listings;
+    std::mutex dir_listings_mutex;
+    // the threads which load the imports, or 0 for one per processor
+    uint32_t load_threads = 0;
     ysfx_log_reporter_t *log_reporter = nullptr;
     intptr_t userdata = 0;
+    // the files which back the global memories, by name
+    std::map<std::string, ysfx_gmem_file_t> gmem_files;
+    // the thread which loads files ahead, started by the first of them
+    std::unique_ptr<ysfx_prewarmer_t> prewarmer;
+    std::mutex prewarmer_mutex;
+    // the threads which decode the files of the manifests ahead, started by the first of them
+    std::unique_ptr<ysfx_preloader_t> preloader;
+    std::mutex preloader_mutex;
     std::atomic<uint32_t> ref_count{1};
+    // the messages of the processing, which go to the reporter later
+    std::unique_ptr<ysfx_log_queue_t> log_queue{new ysfx_log_queue_t(this)};
 };
 
+// NOTE: on the thread of the processing, the message is queued; the others report it at once
 void ysfx_log(ysfx_config_t &conf, ysfx_log_level level, const char *message);
 void ysfx_logfv(ysfx_config_t &conf, ysfx_log_level level, const char *format, va_list ap);
 #if defined(__GNUC__)
 __attribute__((format(printf, 3, 4)))
 #endif
 void ysfx_logf(ysfx_config_t &conf, ysfx_log_level level, const char *format, ...);
+// write to the standard output, which is queued as the log on the thread of the processing
+void ysfx_log_stdout(ysfx_config_t &conf, const char *text, size_t length);
@@ -0,0 +1,396 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+#include "ysfx.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#   define YSFX_CONVERT_SSE2 1
+#   include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#   define YSFX_CONVERT_NEON 1
+#   include <arm_neon.h>
+#endif
+
+namespace ysfx {
+
+// convert a channel of samples into the VM's real type, adding an offset
+inline void convert_in(const float *src, ysfx_real *dst, uint32_t count, ysfx_real add)
+{
+    uint32_t i = 0;
+#if defined(YSFX_CONVERT_SSE2)
+    const __m128d vadd = _mm_set1_pd(add);
+    for (; i + 4 <= count; i += 4) {
+        __m128 f = _mm_loadu_ps(&src[i]);
+        _mm_storeu_pd(&dst[i], _mm_add_pd(_mm_cvtps_pd(f), vadd));
+        _mm_storeu_pd(&dst[i + 2], _mm_add_pd(_mm_cvtps_pd(_mm_movehl_ps(f, f)), vadd));
+    }
+#elif defined(YSFX_CONVERT_NEON)
+    const float64x2_t vadd = vdupq_n_f64(add);
+    for (; i + 4 <= count; i += 4) {
+        float32x4_t f = vld1q_f32(&src[i]);
+        vst1q_f64(&dst[i], vaddq_f64(vcvt_f64_f32(vget_low_f32(f)), vadd));
+        vst1q_f64(&dst[i + 2], vaddq_f64(vcvt_high_f64_f32(f), vadd));
+    }
+#endif
+    for (; i < count; ++i)
+        dst[i] = (ysfx_real)src[i] + add;
+}
+
+inline void convert_in(const double *src, ysfx_real *dst, uint32_t count, ysfx_real add)
+{
+    uint32_t i = 0;
+#if defined(YSFX_CONVERT_SSE2)
+    const __m128d vadd = _mm_set1_pd(add);
+    for (; i + 2 <= count; i += 2)
+        _mm_storeu_pd(&dst[i], _mm_add_pd(_mm_loadu_pd(&src[i]), vadd));
+#elif defined(YSFX_CONVERT_NEON)
+    const float64x2_t vadd = vdupq_n_f64(add);
+    for (; i + 2 <= count; i += 2)
+        vst1q_f64(&dst[i], vaddq_f64(vld1q_f64(&src[i]), vadd));
+#endif
+    for (; i < count; ++i)
+        dst[i] = src[i] + add;
+}
+
+// convert a channel of samples from the VM's real type
+inline void convert_out(const ysfx_real *src, float *dst, uint32_t count)
+{
+    uint32_t i = 0;
+#if defined(YSFX_CONVERT_SSE2)
+    for (; i + 4 <= count; i += 4) {
+        __m128 lo = _mm_cvtpd_ps(_mm_loadu_pd(&src[i]));
+        __m128 hi = _mm_cvtpd_ps(_mm_loadu_pd(&src[i + 2]));
+        _mm_storeu_ps(&dst[i], _mm_movelh_ps(lo, hi));
+    }
+#elif defined(YSFX_CONVERT_NEON)
+    for (; i + 4 <= count; i += 4) {
+        float32x2_t lo = vcvt_f32_f64(vld1q_f64(&src[i]));
+        vst1q_f32(&dst[i], vcvt_high_f32_f64(lo, vld1q_f64(&src[i + 2])));
+    }
+#endif
+    for (; i < count; ++i)
+        dst[i] = (float)src[i];
+}
+
+inline void convert_out(const ysfx_real *src, double *dst, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; ++i)
+        dst[i] = src[i];
+}
+
+// convert samples which a decoder wrote as floats at the start of the buffer
+//   it goes backwards, so each double lands on floats which are already read
+inline void widen_in_place(ysfx_real *buf, uint64_t count)
+{
+    const float *src = (const float *)buf;
+    uint64_t i = count;
+    while (i % 4 != 0) {
+        --i;
+        buf[i] = src[i];
+    }
+#if defined(YSFX_CONVERT_SSE2)
+    while (i > 0) {
+        i -= 4;
+        __m128 f = _mm_loadu_ps(&src[i]);
+        _mm_storeu_pd(&buf[i + 2], _mm_cvtps_pd(_mm_movehl_ps(f, f)));
+        _mm_storeu_pd(&buf[i], _mm_cvtps_pd(f));
+    }
+#elif defined(YSFX_CONVERT_NEON)
+    while (i > 0) {
+        i -= 4;
+        float32x4_t f = vld1q_f32(&src[i]);
+        vst1q_f64(&buf[i + 2], vcvt_high_f64_f32(f));
+        vst1q_f64(&buf[i], vcvt_f64_f32(vget_low_f32(f)));
+    }
+#endif
+    while (i > 0) {
+        --i;
+        buf[i] = src[i];
+    }
+}
+
+// strided variants, for interleaved buffers; a stride of 1 is contiguous
+template <class Real>
+inline void convert_in(const Real *src, uint32_t stride, ysfx_real *dst, uint32_t count, ysfx_real add)
+{
+    if (stride == 1)
+        return convert_in(src, dst, count, add);
+    for (uint32_t i = 0; i < count; ++i)
+        dst[i] = (ysfx_real)src[i * stride] + add;
+}
+
+template <class Real>
+inline void convert_out(const ysfx_real *src, Real *dst, uint32_t stride, uint32_t count)
+{
+    if (stride == 1)
+        return convert_out(src, dst, count);
+    for (uint32_t i = 0; i < count; ++i)
+        dst[i * stride] = (Real)src[i];
+}
+
+template <class Real>
+inline void clear_samples(Real *dst, uint32_t stride, uint32_t count);
+
+// a null channel is silent for reading, and discards the writes
+template <class Real>
+inline void copy_samples(const Real *src, Real *dst, uint32_t stride, uint32_t count)
+{
+    if (src == dst)
+        return;
+    if (!src)
+        return clear_samples(dst, stride, count);
+    if (!dst)
+        return;
+    if (stride == 1)
+        memcpy(dst, src, count * sizeof(Real));
+    else {
+        for (uint32_t i = 0; i < count; ++i)
+            dst[i * stride] = src[i * stride];
+    }
+}
+
+template <class Real>
+inline void clear_samples(Real *dst, uint32_t stride, uint32_t count)
+{
+    if (!dst)
+        return;
+    if (stride == 1)
+        memset(dst, 0, count * sizeof(Real));
+    else {
+        for (uint32_t i = 0; i < count; ++i)
+            dst[i * stride] = 0;
+    }
+}
+
+//------------------------------------------------------------------------------
+// find the highest magnitude and the sum of squares of a channel, for the meters
+inline void measure_levels(const float *src, uint32_t count, ysfx_real &peak, ysfx_real &sum_squares)
+{
+    uint32_t i = 0;
+    ysfx_real top = 0;
+    ysfx_real sum = 0;
+#if defined(YSFX_CONVERT_SSE2)
+    const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    __m128 vtop = _mm_setzero_ps();
+    __m128d vsum = _mm_setzero_pd();
+    for (; i + 4 <= count; i += 4) {
+        __m128 f = _mm_loadu_ps(&src[i]);
+        vtop = _mm_max_ps(vtop, _mm_and_ps(f, abs_mask));
+        __m128d lo = _mm_cvtps_pd(f);
+        __m128d hi = _mm_cvtps_pd(_mm_movehl_ps(f, f));
+        vsum = _mm_add_pd(vsum, _mm_add_pd(_mm_mul_pd(lo, lo), _mm_mul_pd(hi, hi)));
+    }
+    float tops[4];
+    double sums[2];
+    _mm_storeu_ps(tops, vtop);
+    _mm_storeu_pd(sums, vsum);
+    top = std::max(std::max(tops[0], tops[1]), std::max(tops[2], tops[3]));
+    sum = sums[0] + sums[1];
+#elif defined(YSFX_CONVERT_NEON)
+    float32x4_t vtop = vdupq_n_f32(0);
+    float64x2_t vsum = vdupq_n_f64(0);
+    for (; i + 4 <= count; i += 4) {
+        float32x4_t f = vld1q_f32(&src[i]);
+        vtop = vmaxq_f32(vtop, vabsq_f32(f));
+        float64x2_t lo = vcvt_f64_f32(vget_low_f32(f));
+        float64x2_t hi = vcvt_high_f64_f32(f);
+        vsum = vaddq_f64(vsum, vaddq_f64(vmulq_f64(lo, lo), vmulq_f64(hi, hi)));
+    }
+    top = vmaxvq_f32(vtop);
+    sum = vaddvq_f64(vsum);
+#endif
+    for (; i < count; ++i) {
+        ysfx_real x = src[i];
+        top = std::max(top, std::fabs(x));
+        sum += x * x;
+    }
+    peak = top;
+    sum_squares = sum;
+}
+
+inline void measure_levels(const double *src, uint32_t count, ysfx_real &peak, ysfx_real &sum_squares)
+{
+    uint32_t i = 0;
+    ysfx_real top = 0;
+    ysfx_real sum = 0;
+#if defined(YSFX_CONVERT_SSE2)
+    const __m128d abs_mask = _mm_castsi128_pd(_mm_set1_epi64x(0x7fffffffffffffff));
+    __m128d vtop = _mm_setzero_pd();
+    __m128d vsum = _mm_setzero_pd();
+    for (; i + 2 <= count; i += 2) {
+        __m128d d = _mm_loadu_pd(&src[i]);
+        vtop = _mm_max_pd(vtop, _mm_and_pd(d, abs_mask));
+        vsum = _mm_add_pd(vsum, _mm_mul_pd(d, d));
+    }
+    double tops[2];
+    double sums[2];
+    _mm_storeu_pd(tops, vtop);
+    _mm_storeu_pd(sums, vsum);
+    top = std::max(tops[0], tops[1]);
+    sum = sums[0] + sums[1];
+#elif defined(YSFX_CONVERT_NEON)
+    float64x2_t vtop = vdupq_n_f64(0);
+    float64x2_t vsum = vdupq_n_f64(0);
+    for (; i + 2 <= count; i += 2) {
+        float64x2_t d = vld1q_f64(&src[i]);
+        vtop = vmaxq_f64(vtop, vabsq_f64(d));
+        vsum = vaddq_f64(vsum, vmulq_f64(d, d));
+    }
+    top = vmaxvq_f64(vtop);
+    sum = vaddvq_f64(vsum);
+#endif
+    for (; i < count; ++i) {
+        ysfx_real x = src[i];
+        top = std::max(top, std::fabs(x));
+        sum += x * x;
+    }
+    peak = top;
+    sum_squares = sum;
+}
+
+template <class Real>
+inline void measure_levels(const Real *src, uint32_t stride, uint32_t count, ysfx_real &peak, ysfx_real &sum_squares)
+{
+    if (stride == 1)
+        return measure_levels(src, count, peak, sum_squares);
+    ysfx_real top = 0;
+    ysfx_real sum = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        ysfx_real x = src[i * stride];
+        top = std::max(top, std::fabs(x));
+        sum += x * x;
+    }
+    peak = top;
+    sum_squares = sum;
+}
+
+//------------------------------------------------------------------------------
+// byte order of the host
+inline bool is_little_endian()
+{
+    const uint16_t value = 1;
+    uint8_t first;
+    memcpy(&first, &value, 1);
+    return first == 1;
+}
+
+inline uint32_t byte_swap(uint32_t x)
+{
+    return (x >> 24) | ((x >> 8) & 0xff00) | ((x << 8) & 0xff0000) | (x << 24);
+}
+
+inline uint64_t byte_swap(uint64_t x)
+{
+    return ((uint64_t)byte_swap((uint32_t)x) << 32) | byte_swap((uint32_t)(x >> 32));
+}
+
+// convert from the VM's real type into packed little-endian floats, at any alignment
+inline void convert_out_f32le(const ysfx_real *src, uint8_t *dst, uint32_t count)
+{
+    uint32_t i = 0;
+    const bool le = is_little_endian();
+#if defined(YSFX_CONVERT_SSE2)
+    for (; i + 4 <= count; i += 4) {
+        __m128 lo = _mm_cvtpd_ps(_mm_loadu_pd(&src[i]));
+        __m128 hi = _mm_cvtpd_ps(_mm_loadu_pd(&src[i + 2]));
+        _mm_storeu_si128((__m128i *)&dst[4 * i], _mm_castps_si128(_mm_movelh_ps(lo, hi)));
+    }
+#elif defined(YSFX_CONVERT_NEON)
+    for (; i + 4 <= count; i += 4) {
+        float32x2_t lo = vcvt_f32_f64(vld1q_f64(&src[i]));
+        uint8x16_t f = vreinterpretq_u8_f32(vcvt_high_f32_f64(lo, vld1q_f64(&src[i + 2])));
+        vst1q_u8(&dst[4 * i], le ? f : vrev32q_u8(f));
+    }
+#endif
+    for (; i < count; ++i) {
+        float f = (float)src[i];
+        uint32_t u;
+        memcpy(&u, &f, 4);
+        if (!le)
+            u = byte_swap(u);
+        memcpy(&dst[4 * i], &u, 4);
+    }
+}
+
+// convert from packed little-endian floats into the VM's real type, at any alignment
+inline void convert_in_f32le(const uint8_t *src, ysfx_real *dst, uint32_t count)
+{
+    uint32_t i = 0;
+    const bool le = is_little_endian();
+#if defined(YSFX_CONVERT_SSE2)
+    for (; i + 4 <= count; i += 4) {
+        __m128 f = _mm_castsi128_ps(_mm_loadu_si128((const __m128i *)&src[4 * i]));
+        _mm_storeu_pd(&dst[i], _mm_cvtps_pd(f));
+        _mm_storeu_pd(&dst[i + 2], _mm_cvtps_pd(_mm_movehl_ps(f, f)));
+    }
+#elif defined(YSFX_CONVERT_NEON)
+    for (; i + 4 <= count; i += 4) {
+        uint8x16_t b = vld1q_u8(&src[4 * i]);
+        float32x4_t f = vreinterpretq_f32_u8(le ? b : vrev32q_u8(b));
+        vst1q_f64(&dst[i], vcvt_f64_f32(vget_low_f32(f)));
+        vst1q_f64(&dst[i + 2], vcvt_high_f64_f32(f));
+    }
+#endif
+    for (; i < count; ++i) {
+        uint32_t u;
+        memcpy(&u, &src[4 * i], 4);
+        if (!le)
+            u = byte_swap(u);
+        float f;
+        memcpy(&f, &u, 4);
+        dst[i] = (ysfx_real)f;
+    }
+}
+
+// copy the VM's real type as packed little-endian doubles, at any alignment
+inline void convert_out_f64le(const ysfx_real *src, uint8_t *dst, uint32_t count)
+{
+    if (is_little_endian()) {
+        memcpy(dst, src, 8 * (size_t)count);
+        return;
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+        double d = (double)src[i];
+        uint64_t u;
+        memcpy(&u, &d, 8);
+        u = byte_swap(u);
+        memcpy(&dst[8 * i], &u, 8);
+    }
+}
+
+inline void convert_in_f64le(const uint8_t *src, ysfx_real *dst, uint32_t count)
+{
+    if (is_little_endian()) {
+        memcpy(dst, src, 8 * (size_t)count);
+        return;
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+        uint64_t u;
+        memcpy(&u, &src[8 * i], 8);
+        u = byte_swap(u);
+        double d;
+        memcpy(&d, &u, 8);
+        dst[i] = (ysfx_real)d;
+    }
+}
+
+} // namespace ysfx
@@ -0,0 +1,250 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+#include "ysfx_convolver.hpp"
+#include "WDL/fft.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#   define YSFX_CONVOLVER_SSE2 1
+#   include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#   define YSFX_CONVOLVER_NEON 1
+#   include <arm_neon.h>
+#endif
+
+static_assert(sizeof(WDL_FFT_REAL) == sizeof(ysfx_real), "the transforms operate on the real type");
+
+// multiply and accumulate spectra in the packed format of WDL_real_fft, where
+//   the first pair has the real values of the zero and the Nyquist frequencies
+static void ysfx_spectrum_mac(ysfx_real *acc, const ysfx_real *x, const ysfx_real *h, uint32_t pairs)
+{
+    acc[0] += x[0] * h[0];
+    acc[1] += x[1] * h[1];
+
+    uint32_t i = 1;
+#if defined(YSFX_CONVOLVER_SSE2)
+    const __m128d sign = _mm_set_pd(0.0, -0.0);
+    for (; i < pairs; ++i) {
+        __m128d vx = _mm_loadu_pd(&x[2 * i]), vh = _mm_loadu_pd(&h[2 * i]);
+        __m128d hre = _mm_unpacklo_pd(vh, vh), him = _mm_unpackhi_pd(vh, vh);
+        // x * h = x * (hre, hre) + (-xim, xre) * (him, him)
+        __m128d xswap = _mm_xor_pd(_mm_shuffle_pd(vx, vx, 1), sign);
+        __m128d prod = _mm_add_pd(_mm_mul_pd(vx, hre), _mm_mul_pd(xswap, him));
+        _mm_storeu_pd(&acc[2 * i], _mm_add_pd(_mm_loadu_pd(&acc[2 * i]), prod));
+    }
+#elif defined(YSFX_CONVOLVER_NEON)
+    const double signs[2] = {-1.0, 1.0};
+    const float64x2_t sign = vld1q_f64(signs);
+    for (; i < pairs; ++i) {
+        float64x2_t vx = vld1q_f64(&x[2 * i]), vh = vld1q_f64(&h[2 * i]);
+        float64x2_t xswap = vmulq_f64(vextq_f64(vx, vx, 1), sign);
+        float64x2_t a = vld1q_f64(&acc[2 * i]);
+        a = vfmaq_laneq_f64(a, vx, vh, 0);
+        a = vfmaq_laneq_f64(a, xswap, vh, 1);
+        vst1q_f64(&acc[2 * i], a);
+    }
+#endif
+    for (; i < pairs; ++i) {
+        ysfx_real xre = x[2 * i], xim = x[2 * i + 1];
+        ysfx_real hre = h[2 * i], him = h[2 * i + 1];
+        acc[2 * i] += xre * hre - xim * him;
+        acc[2 * i + 1] += xre * him + xim * hre;
+    }
+}
+
+//------------------------------------------------------------------------------
+ysfx_convolver_t::ysfx_convolver_t(const ysfx_real *impulse, uint32_t length, uint32_t block, bool threaded)
+{
+    WDL_fft_init();
+
+    uint32_t size = 16;
+    while (size < block && size < max_partition)
+        size *= 2;
+    m_block = size;
+
+    bool any_threaded = false;
+    uint32_t largest = size;
+    uint32_t offset = 0;
+    while (offset < length) {
+        // the next stage starts where it has a whole partition of time
+        uint32_t next = std::min(4 * size, (uint32_t)max_partition);
+        uint32_t end = (next == size) ? length : std::min(length, 2 * next - m_block);
+
+        std::unique_ptr<stage_t> stage{new stage_t};
+        stage->size = size;
+        stage->offset = offset;
+        stage->count = (end - offset + size - 1) / size;
+        stage->threaded = threaded && offset > 0;
+        any_threaded = any_threaded || stage->threaded;
+        largest = size;
+
+        // the spectra of the partitions, scaled for the inverse transform
+        const uint32_t fftsize = 2 * size;
+        const ysfx_real scale = (ysfx_real)1 / (4 * fftsize);
+        stage->impulse.resize((size_t)stage->count * fftsize);
+        stage->input.resize((size_t)stage->count * fftsize);
+        stage->work.resize(fftsize);
+        for (uint32_t p = 0; p < stage->count; ++p) {
+            ysfx_real *spectrum = &stage->impulse[(size_t)p * fftsize];
+            uint32_t start = offset + p * size;
+            uint32_t n = std::min(size, length - start);
+            for (uint32_t i = 0; i < n; ++i)
+                spectrum[i] = impulse[start + i] * scale;
+            WDL_real_fft(spectrum, (int)fftsize, 0);
+        }
+
+        m_stages.push_back(std::move(stage));
+        offset += m_stages.back()->count * size;
+        size = next;
+    }
+
+    m_in_block.resize(m_block);
+    m_out_block.resize(m_block);
+    m_history.resize(2 * (size_t)largest);
+    m_output.resize(4 * (size_t)largest);
+
+    if (any_threaded)
+        m_thread = std::thread([this]() { run(); });
+}
+
+ysfx_convolver_t::~ysfx_convolver_t()
+{
+    if (m_thread.joinable()) {
+        m_quit.store(true);
+        m_wake.post();
+        m_thread.join();
+    }
+}
+
+void ysfx_convolver_t::process(ysfx_real *samples, uint32_t count)
+{
+    uint32_t i = 0;
+    while (i < count) {
+        uint32_t n = std::min(count - i, m_block - m_block_pos);
+        memcpy(&m_in_block[m_block_pos], &samples[i], n * sizeof(ysfx_real));
+        memcpy(&samples[i], &m_out_block[m_block_pos], n * sizeof(ysfx_real));
+        m_block_pos += n;
+        i += n;
+        if (m_block_pos == m_block) {
+            m_block_pos = 0;
+            end_block();
+        }
+    }
+}
+
+void ysfx_convolver_t::end_block()
+{
+    const size_t history_mask = m_history.size() - 1;
+    const size_t output_mask = m_output.size() - 1;
+
+    size_t pos = (size_t)m_time & history_mask;
+    memcpy(&m_history[pos], m_in_block.data(), m_block * sizeof(ysfx_real));
+    m_time += m_block;
+    const uint64_t time = m_time;
+
+    for (std::unique_ptr<stage_t> &stage_ptr : m_stages) {
+        stage_t &stage = *stage_ptr;
+        if (time % stage.size != 0)
+            continue;
+
+        // the result of the last time is due by now
+        if (stage.threaded) {
+            wait_stage(stage);
+            // there is none before the first time
+            if (stage.result_time != 0)
+                mix_stage(stage);
+        }
+
+        // the window of input which ends here, of 2 partitions
+        const uint32_t fftsize = 2 * stage.size;
+        size_t start = (size_t)(time - fftsize) & history_mask;
+        size_t n = std::min<size_t>(fftsize, m_history.size() - start);
+        memcpy(stage.work.data(), &m_history[start], n * sizeof(ysfx_real));
+        memcpy(&stage.work[n], m_history.data(), (fftsize - n) * sizeof(ysfx_real));
+        stage.result_time = time - stage.size + stage.offset;
+
+        if (stage.threaded) {
+            stage.busy.store(true);
+            m_wake.post();
+        }
+        else {
+            compute_stage(stage);
+            mix_stage(stage);
+        }
+    }
+
+    // the output of the block just completed, delayed by the block
+    for (uint32_t i = 0; i < m_block; ++i) {
+        ysfx_real &out = m_output[(size_t)(time - m_block + i) & output_mask];
+        m_out_block[i] = out;
+        out = 0;
+    }
+}
+
+void ysfx_convolver_t::compute_stage(stage_t &stage)
+{
+    const uint32_t fftsize = 2 * stage.size;
+    ysfx_real *work = stage.work.data();
+
+    WDL_real_fft(work, (int)fftsize, 0);
+    memcpy(&stage.input[(size_t)stage.input_head * fftsize], work, fftsize * sizeof(ysfx_real));
+
+    std::fill_n(work, fftsize, (ysfx_real)0);
+    for (uint32_t p = 0, index = stage.input_head; p < stage.count; ++p) {
+        ysfx_spectrum_mac(work, &stage.input[(size_t)index * fftsize], &stage.impulse[(size_t)p * fftsize], stage.size);
+        index = (index > 0) ? (index - 1) : (stage.count - 1);
+    }
+    stage.input_head = (stage.input_head + 1 < stage.count) ? (stage.input_head + 1) : 0;
+
+    // the second half is the valid part of the circular convolution
+    WDL_real_fft(work, (int)fftsize, 1);
+}
+
+void ysfx_convolver_t::mix_stage(stage_t &stage)
+{
+    const size_t output_mask = m_output.size() - 1;
+    const ysfx_real *result = &stage.work[stage.size];
+    for (uint32_t i = 0; i < stage.size; ++i)
+        m_output[(size_t)(stage.result_time + i) & output_mask] += result[i];
+}
+
+void ysfx_convolver_t::wait_stage(stage_t &stage)
+{
+    // NOTE: this waits only when the thread did not keep up
+    while (stage.busy.load()) {
+        m_waiting.store(true);
+        if (!stage.busy.load())
+            break;
+        m_ready.wait();
+    }
+}
+
+void ysfx_convolver_t::run()
+{
+    while (!m_quit.load()) {
+        m_wake.wait();
+        for (std::unique_ptr<stage_t> &stage : m_stages) {
+            if (stage->threaded && stage->busy.load()) {
+                compute_stage(*stage);
+                stage->busy.store(false);
+                if (m_waiting.exchange(false))
+                    m_ready.post();
+            }
+        }
+    }
+}
@@ -0,0 +1,83 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+#pragma once
+#include "ysfx.h"
+#include "utility/rt_semaphore.h"
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <memory>
+
+// convolves by an impulse response, partitioned in sizes which grow along it
+//   the head has partitions of the block size, which is also the latency;
+//   each next stage has partitions 4 times larger, computed 4 times less often,
+//   and starts late enough that its result has a whole partition of time to
+//   be ready, so the stages after the first may run on a thread of their own
+struct ysfx_convolver_t {
+    ysfx_convolver_t(const ysfx_real *impulse, uint32_t length, uint32_t block, bool threaded);
+    ~ysfx_convolver_t();
+
+    uint32_t latency() const { return m_block; }
+    uint32_t stage_count() const { return (uint32_t)m_stages.size(); }
+    void process(ysfx_real *samples, uint32_t count);
+
+    // the sizes of partitions, from the block size up to this
+    static constexpr uint32_t max_partition = 16384;
+
+private:
+    struct stage_t {
+        uint32_t size = 0;
+        uint32_t offset = 0;
+        uint32_t count = 0;
+        // the spectra of the partitions of the impulse, and of the past inputs
+        std::vector<ysfx_real> impulse;
+        std::vector<ysfx_real> input;
+        uint32_t input_head = 0;
+        // the window of input, transformed into the result in place
+        std::vector<ysfx_real> work;
+        // the time of the output where the result goes
+        uint64_t result_time = 0;
+        bool threaded = false;
+        std::atomic<bool> busy{false};
+    };
+
+    void end_block();
+    void compute_stage(stage_t &stage);
+    void mix_stage(stage_t &stage);
+    void wait_stage(stage_t &stage);
+    void run();
+
+    uint32_t m_block = 0;
+    std::vector<std::unique_ptr<stage_t>> m_stages;
+    // the input of the current block, and the output which it replaces
+    std::vector<ysfx_real> m_in_block;
+    std::vector<ysfx_real> m_out_block;
+    uint32_t m_block_pos = 0;
+    // the samples of input since the start, at the end of the last block
+    uint64_t m_time = 0;
+    // the recent input, and the accumulated output, by the time modulo the size
+    std::vector<ysfx_real> m_history;
+    std::vector<ysfx_real> m_output;
+    // the thread which computes the later stages
+    std::atomic<bool> m_quit{false};
+    std::atomic<bool> m_waiting{false};
+    RTSemaphore m_wake;
+    RTSemaphore m_ready;
+    std::thread m_thread;
+};
+
+using ysfx_convolver_u = std::unique_ptr<ysfx_convolver_t>;
@@ -0,0 +1,78 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "ysfx_curve_table.hpp"
+#include <algorithm>
+#include <cmath>
+
+void ysfx_curve_table_t::build(const ysfx_slider_curve_t &curve)
+{
+    m_curve = curve;
+    m_points.clear();
+
+    if (curve.shape == 0 || curve.min == curve.max)
+        return;
+
+    std::vector<ysfx_real> points(num_segments + 1);
+    for (uint32_t i = 0; i <= num_segments; ++i)
+        points[i] = ysfx_normalized_to_ysfx_value((ysfx_real)i / num_segments, &curve);
+
+    // the inverse needs the points in a strict order
+    const bool ascending = points[num_segments] > points[0];
+    for (uint32_t i = 0; i <= num_segments; ++i) {
+        if (!std::isfinite(points[i]))
+            return;
+        if (i > 0 && (ascending ? (points[i] <= points[i - 1]) : (points[i] >= points[i - 1])))
+            return;
+    }
+
+    m_points = std::move(points);
+    m_ascending = ascending;
+}
+
+ysfx_real ysfx_curve_table_t::from_normalized(ysfx_real value) const
+{
+    value = std::max((ysfx_real)0, std::min((ysfx_real)1, value));
+    if (m_points.empty())
+        return ysfx_normalized_to_ysfx_value(value, &m_curve);
+
+    ysfx_real pos = value * num_segments;
+    uint32_t index = std::min((uint32_t)pos, (uint32_t)num_segments - 1);
+    ysfx_real frac = pos - index;
+    return m_points[index] + frac * (m_points[index + 1] - m_points[index]);
+}
+
+ysfx_real ysfx_curve_table_t::to_normalized(ysfx_real value) const
+{
+    if (m_points.empty()) {
+        ysfx_real normalized = ysfx_ysfx_value_to_normalized(value, &m_curve);
+        return std::max((ysfx_real)0, std::min((ysfx_real)1, normalized));
+    }
+
+    // the segment which contains the value
+    auto it = m_ascending ?
+        std::upper_bound(m_points.begin(), m_points.end(), value) :
+        std::upper_bound(m_points.begin(), m_points.end(), value, std::greater<ysfx_real>());
+    if (it == m_points.begin())
+        return 0;
+    if (it == m_points.end())
+        return 1;
+
+    uint32_t index = (uint32_t)(it - m_points.begin()) - 1;
+    ysfx_real frac = (value - m_points[index]) / (m_points[index + 1] - m_points[index]);
+    return (index + frac) / num_segments;
+}
@@ -0,0 +1,38 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+#include "ysfx.h"
+#include <vector>
+
+// the curve of a slider, sampled at load time, so that the conversions between the values
+//   and the normalized values interpolate, instead of computing the shape each time;
+//   the linear curves are exact, and those which cannot be sampled are computed as before
+struct ysfx_curve_table_t {
+    enum { num_segments = 1024 };
+
+    void build(const ysfx_slider_curve_t &curve);
+    ysfx_real from_normalized(ysfx_real value) const;
+    // the normalized value is clamped to the range
+    ysfx_real to_normalized(ysfx_real value) const;
+
+private:
+    ysfx_slider_curve_t m_curve{};
+    // the values at the ends of the segments, in the order of the normalized values; empty if none are sampled
+    std::vector<ysfx_real> m_points;
+    bool m_ascending = true;
+};
@@ -16,6 +16,7 @@
 //
 
 #include "ysfx_eel_utils.hpp"
+#include <cstring>
 
 ysfx_eel_ram_reader::ysfx_eel_ram_reader(NSEEL_VMCTX vm, int64_t addr)
     : m_vm(vm),
@@ -64,3 +65,39 @@ bool ysfx_eel_ram_writer::write_next(EEL_F value)
     m_block_avail -= 1;
     return true;
 }
+
+//------------------------------------------------------------------------------
+static bool ysfx_eel_is_ident_char(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == '.';
+}
+
+void ysfx_eel_find_literal_calls(const std::string &source, const char *function, const std::function<void(const std::string &)> &found)
+{
+    const size_t length = strlen(function);
+
+    for (size_t pos = 0; (pos = source.find(function, pos)) != std::string::npos; ) {
+        size_t start = pos;
+        pos += length;
+        if (start > 0 && ysfx_eel_is_ident_char(source[start - 1]))
+            continue;
+
+        size_t i = pos;
+        while (i < source.size() && (source[i] == ' ' || source[i] == '\t'))
+            ++i;
+        if (i >= source.size() || source[i] != '(')
+            continue;
+        ++i;
+        while (i < source.size() && (source[i] == ' ' || source[i] == '\t'))
+            ++i;
+        if (i >= source.size() || source[i] != '"')
+            continue;
+
+        size_t end = source.find_first_of("\"\\", i + 1);
+        if (end == std::string::npos || source[end] != '"')
+            continue;
+        pos = end + 1;
+        if (end > i + 1)
+            found(source.substr(i + 1, end - (i + 1)));
+    }
+}
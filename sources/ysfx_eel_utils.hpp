@@ -18,6 +18,8 @@
 #pragma once
 #include "WDL/eel2/ns-eel.h"
 #include "WDL/eel2/ns-eel-int.h"
+#include <string>
+#include <functional>
 #include <type_traits>
 #include <cstdint>
 
@@ -55,3 +57,9 @@ private:
     EEL_F *m_block = nullptr;
     uint32_t m_block_avail = 0;
 };
+
+//------------------------------------------------------------------------------
+// find the calls of the function whose first argument is a string literal, to
+//   prepare for these texts ahead of the first run; the literals with escapes
+//   are skipped, since EEL decodes them
+void ysfx_eel_find_literal_calls(const std::string &source, const char *function, const std::function<void(const std::string &)> &found);
@@ -0,0 +1,106 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "ysfx_eval_cache.hpp"
+#include "ysfx_eel_utils.hpp"
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+
+ysfx_eval_cache_t::ysfx_eval_cache_t()
+{
+    // the audio thread inserts without allocating
+    m_entries.reserve(max_entries + 1);
+}
+
+ysfx_eval_cache_t::~ysfx_eval_cache_t()
+{
+    for (entry_t &entry : m_entries) {
+        NSEEL_code_free(entry.code);
+        free(entry.text);
+    }
+}
+
+char *ysfx_eval_cache_t::take(const char *text, NSEEL_CODEHANDLE &code)
+{
+    std::lock_guard<ysfx::mutex> lock{m_mutex};
+    auto it = std::find_if(m_entries.begin(), m_entries.end(), [text](const entry_t &entry) {
+        return !strcmp(entry.text, text);
+    });
+    if (it == m_entries.end())
+        return nullptr;
+
+    entry_t entry = *it;
+    m_entries.erase(it);
+    code = entry.code;
+    return entry.text;
+}
+
+void ysfx_eval_cache_t::put(char *text, NSEEL_CODEHANDLE code)
+{
+    entry_t evicted;
+    {
+        std::lock_guard<ysfx::mutex> lock{m_mutex};
+        auto it = std::find_if(m_entries.begin(), m_entries.end(), [text](const entry_t &entry) {
+            return !strcmp(entry.text, text);
+        });
+        if (it != m_entries.end()) {
+            // a nested run has put it back first
+            evicted = entry_t{text, code};
+        }
+        else {
+            m_entries.insert(m_entries.begin(), entry_t{text, code});
+            if (m_entries.size() > max_entries) {
+                evicted = m_entries.back();
+                m_entries.pop_back();
+            }
+        }
+    }
+    NSEEL_code_free(evicted.code);
+    free(evicted.text);
+}
+
+void ysfx_eval_cache_t::precompile(NSEEL_VMCTX vm, const std::string &source)
+{
+    ysfx_eel_find_literal_calls(source, "eval", [this, vm](const std::string &text) {
+        {
+            std::lock_guard<ysfx::mutex> lock{m_mutex};
+            if (m_entries.size() >= max_entries)
+                return;
+            bool found = std::any_of(m_entries.begin(), m_entries.end(), [&text](const entry_t &entry) {
+                return text == entry.text;
+            });
+            if (found)
+                return;
+        }
+
+        // the same as `eval` compiles it
+        NSEEL_CODEHANDLE code = NSEEL_code_compile(vm, text.c_str(), 0);
+        if (!code)
+            return;
+
+        // the literals go behind the texts which ran already
+        std::lock_guard<ysfx::mutex> lock{m_mutex};
+        m_entries.push_back(entry_t{strdup(text.c_str()), code});
+    });
+}
+
+uint32_t ysfx_eval_cache_t::size()
+{
+    std::lock_guard<ysfx::mutex> lock{m_mutex};
+    return (uint32_t)m_entries.size();
+}
@@ -0,0 +1,56 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+#include "ysfx.h"
+#include "ysfx_utils.hpp"
+#include "WDL/eel2/ns-eel.h"
+#include <string>
+#include <vector>
+#include <memory>
+
+// keeps the code of `eval` compiled, for the texts which repeat; the least
+//   recently used is freed once it's full, and all are freed with the code
+//   an entry is taken out while it runs, so that a nested `eval` of the same
+//   text compiles its own; the texts are allocated by `malloc`, as `eval` frees them
+struct ysfx_eval_cache_t {
+    ysfx_eval_cache_t();
+    ~ysfx_eval_cache_t();
+
+    // take the code of the text, and its copy of the text, or null if it's not cached
+    char *take(const char *text, NSEEL_CODEHANDLE &code);
+    // give back the code after it ran, with its text
+    void put(char *text, NSEEL_CODEHANDLE code);
+    // compile ahead the literal texts of `eval("...")` which the source contains,
+    //   those which do not compile yet are left for their first run
+    void precompile(NSEEL_VMCTX vm, const std::string &source);
+    uint32_t size();
+
+private:
+    enum { max_entries = 32 };
+
+    struct entry_t {
+        char *text = nullptr;
+        NSEEL_CODEHANDLE code = nullptr;
+    };
+
+    ysfx::mutex m_mutex;
+    // the most recent first
+    std::vector<entry_t> m_entries;
+};
+
+using ysfx_eval_cache_u = std::unique_ptr<ysfx_eval_cache_t>;
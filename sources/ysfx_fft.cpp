@@ -0,0 +1,285 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+#include "ysfx_fft.hpp"
+#include <memory>
+#include <cmath>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#   define YSFX_FFT_SSE2 1
+#   include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#   define YSFX_FFT_NEON 1
+#   include <arm_neon.h>
+#endif
+
+static_assert(sizeof(WDL_FFT_REAL) == 8, "the vectorized FFT operates on doubles");
+
+// The complex FFT is the split-radix decomposition of DJB, as WDL has it, so the
+// outputs come in the same order. The passes of the larger sizes are vectorized,
+// with a complex number per register, and the small sizes go to WDL.
+
+namespace {
+
+enum {
+    fft_max_bits = 15,
+    // the size up to which WDL computes the transform
+    fft_leaf_bits = 5,
+};
+
+static const double fft_pi = 3.14159265358979323846;
+
+//------------------------------------------------------------------------------
+// complex numbers in a register, as real and imaginary parts
+
+#if defined(YSFX_FFT_SSE2)
+typedef __m128d c2d;
+inline c2d c2_load(const double *p) { return _mm_loadu_pd(p); }
+inline void c2_store(double *p, c2d x) { _mm_storeu_pd(p, x); }
+inline c2d c2_add(c2d a, c2d b) { return _mm_add_pd(a, b); }
+inline c2d c2_sub(c2d a, c2d b) { return _mm_sub_pd(a, b); }
+inline c2d c2_mul(c2d a, c2d b) { return _mm_mul_pd(a, b); }
+inline c2d c2_swap(c2d a) { return _mm_shuffle_pd(a, a, 1); }
+// i * (re, im) = (-im, re)
+inline c2d c2_mul_i(c2d a) { return _mm_xor_pd(c2_swap(a), _mm_set_pd(0.0, -0.0)); }
+#elif defined(YSFX_FFT_NEON)
+typedef float64x2_t c2d;
+inline c2d c2_load(const double *p) { return vld1q_f64(p); }
+inline void c2_store(double *p, c2d x) { vst1q_f64(p, x); }
+inline c2d c2_add(c2d a, c2d b) { return vaddq_f64(a, b); }
+inline c2d c2_sub(c2d a, c2d b) { return vsubq_f64(a, b); }
+inline c2d c2_mul(c2d a, c2d b) { return vmulq_f64(a, b); }
+inline c2d c2_swap(c2d a) { return vextq_f64(a, a, 1); }
+inline c2d c2_mul_i(c2d a)
+{
+    const uint64x2_t sign = vcombine_u64(vcreate_u64(0x8000000000000000ull), vcreate_u64(0));
+    return vreinterpretq_f64_u64(veorq_u64(vreinterpretq_u64_f64(c2_swap(a)), sign));
+}
+#else
+struct c2d { double re, im; };
+inline c2d c2_load(const double *p) { return c2d{p[0], p[1]}; }
+inline void c2_store(double *p, c2d x) { p[0] = x.re; p[1] = x.im; }
+inline c2d c2_add(c2d a, c2d b) { return c2d{a.re + b.re, a.im + b.im}; }
+inline c2d c2_sub(c2d a, c2d b) { return c2d{a.re - b.re, a.im - b.im}; }
+inline c2d c2_mul(c2d a, c2d b) { return c2d{a.re * b.re, a.im * b.im}; }
+inline c2d c2_swap(c2d a) { return c2d{a.im, a.re}; }
+inline c2d c2_mul_i(c2d a) { return c2d{-a.im, a.re}; }
+#endif
+
+//------------------------------------------------------------------------------
+struct fft_tables {
+    fft_tables();
+
+    // for a size N, the twiddles w = exp(2*pi*i*k/N) of k < N/4,
+    // each as 4 values (cos, cos, -sin, sin) which make the products
+    //   z * w = z * (cos, cos) + swap(z) * (-sin, sin)
+    //   z * conj(w) = z * (cos, cos) - swap(z) * (-sin, sin)
+    std::unique_ptr<double[]> twiddles;
+    const double *twiddles_of[fft_max_bits + 1] {};
+};
+
+fft_tables::fft_tables()
+{
+    ysfx_wdl_fft_init();
+
+    size_t total = 0;
+    for (uint32_t bits = 2; bits <= fft_max_bits; ++bits)
+        total += (size_t)1 << bits;
+    twiddles.reset(new double[total]);
+
+    double *tw = twiddles.get();
+    for (uint32_t bits = 2; bits <= fft_max_bits; ++bits) {
+        const uint32_t n = (uint32_t)1 << bits;
+        twiddles_of[bits] = tw;
+        for (uint32_t k = 0; k < n / 4; ++k) {
+            const double angle = 2.0 * fft_pi * (double)k / (double)n;
+            const double c = std::cos(angle), s = std::sin(angle);
+            tw[4 * k] = c;
+            tw[4 * k + 1] = c;
+            tw[4 * k + 2] = -s;
+            tw[4 * k + 3] = s;
+        }
+        tw += n;
+    }
+}
+
+static const fft_tables &get_fft_tables()
+{
+    static const fft_tables tables;
+    return tables;
+}
+
+//------------------------------------------------------------------------------
+// the pass of the forward transform, as TRANSFORM of WDL, on a[N] with q = N/4
+//   a0 += a2, a1 += a3, a2 = (x + i*y) * w, a3 = (x - i*y) * conj(w)
+//   where x = a0 - a2, y = a1 - a3
+static void fft_pass(double *a, uint32_t q, const double *tw)
+{
+    double *a1 = a + 2 * q, *a2 = a1 + 2 * q, *a3 = a2 + 2 * q;
+    for (uint32_t k = 0; k < 2 * q; k += 2, tw += 4) {
+        c2d x0 = c2_load(a + k), x1 = c2_load(a1 + k);
+        c2d x2 = c2_load(a2 + k), x3 = c2_load(a3 + k);
+        c2d x = c2_sub(x0, x2), iy = c2_mul_i(c2_sub(x1, x3));
+        c2_store(a + k, c2_add(x0, x2));
+        c2_store(a1 + k, c2_add(x1, x3));
+        c2d wr = c2_load(tw), wi = c2_load(tw + 2);
+        c2d z2 = c2_add(x, iy), z3 = c2_sub(x, iy);
+        c2_store(a2 + k, c2_add(c2_mul(z2, wr), c2_mul(c2_swap(z2), wi)));
+        c2_store(a3 + k, c2_sub(c2_mul(z3, wr), c2_mul(c2_swap(z3), wi)));
+    }
+}
+
+// the pass of the inverse transform, as UNTRANSFORM of WDL
+//   with s = a2 * conj(w) + a3 * w, d = a2 * conj(w) - a3 * w
+//   a0, a2 = a0 +/- s, a1, a3 = a1 -/+ i*d
+static void fft_unpass(double *a, uint32_t q, const double *tw)
+{
+    double *a1 = a + 2 * q, *a2 = a1 + 2 * q, *a3 = a2 + 2 * q;
+    for (uint32_t k = 0; k < 2 * q; k += 2, tw += 4) {
+        c2d x0 = c2_load(a + k), x1 = c2_load(a1 + k);
+        c2d x2 = c2_load(a2 + k), x3 = c2_load(a3 + k);
+        c2d wr = c2_load(tw), wi = c2_load(tw + 2);
+        c2d y2 = c2_sub(c2_mul(x2, wr), c2_mul(c2_swap(x2), wi));
+        c2d y3 = c2_add(c2_mul(x3, wr), c2_mul(c2_swap(x3), wi));
+        c2d sum = c2_add(y2, y3), idiff = c2_mul_i(c2_sub(y2, y3));
+        c2_store(a + k, c2_add(x0, sum));
+        c2_store(a2 + k, c2_sub(x0, sum));
+        c2_store(a1 + k, c2_sub(x1, idiff));
+        c2_store(a3 + k, c2_add(x1, idiff));
+    }
+}
+
+// the split-radix recursion: a pass, then the transforms of N/2, N/4 and N/4
+static void fft_forward(WDL_FFT_COMPLEX *a, uint32_t bits, const fft_tables &tables)
+{
+    if (bits <= fft_leaf_bits) {
+        ysfx_wdl_fft(a, 1 << bits, 0);
+        return;
+    }
+    const uint32_t n = (uint32_t)1 << bits;
+    fft_pass((double *)a, n / 4, tables.twiddles_of[bits]);
+    fft_forward(a, bits - 1, tables);
+    fft_forward(a + n / 2, bits - 2, tables);
+    fft_forward(a + 3 * n / 4, bits - 2, tables);
+}
+
+static void fft_inverse(WDL_FFT_COMPLEX *a, uint32_t bits, const fft_tables &tables)
+{
+    if (bits <= fft_leaf_bits) {
+        ysfx_wdl_fft(a, 1 << bits, 1);
+        return;
+    }
+    const uint32_t n = (uint32_t)1 << bits;
+    fft_inverse(a, bits - 1, tables);
+    fft_inverse(a + n / 2, bits - 2, tables);
+    fft_inverse(a + 3 * n / 4, bits - 2, tables);
+    fft_unpass((double *)a, n / 4, tables.twiddles_of[bits]);
+}
+
+static uint32_t fft_bits_of(int len)
+{
+    if (len < 2 || len > (1 << fft_max_bits) || (len & (len - 1)) != 0)
+        return 0;
+    uint32_t bits = 0;
+    while ((1 << bits) < len)
+        ++bits;
+    return bits;
+}
+
+// the real transform, as two_for_one of WDL
+static void fft_two_for_one(WDL_FFT_REAL *buf, uint32_t bits, bool inverse)
+{
+    const uint32_t len = (uint32_t)1 << bits;
+    const uint32_t half = len >> 1, quart = half >> 1;
+    const int *permute = WDL_fft_permute_tab((int)half);
+    const double *tw = get_fft_tables().twiddles_of[bits];
+    WDL_FFT_COMPLEX *data = (WDL_FFT_COMPLEX *)buf;
+
+    if (!inverse) {
+        WDL_fft(data, (int)half, 0);
+        double t1 = buf[0] + buf[1];
+        double t2 = buf[0] - buf[1];
+        buf[0] = t1 * 2;
+        buf[1] = t2 * 2;
+    }
+    else {
+        double t1 = buf[0] + buf[1];
+        double t2 = buf[0] - buf[1];
+        buf[0] = t1;
+        buf[1] = t2;
+    }
+
+    uint32_t i = 1;
+    for (; i < quart; ++i) {
+        WDL_FFT_COMPLEX *p = data + permute[i];
+        WDL_FFT_COMPLEX *q = data + permute[half - i];
+
+        // the twiddle is (cos, sin) of 2*pi*i/len
+        double twre = tw[4 * i], twim = tw[4 * i + 3];
+        if (!inverse)
+            twre = -twre;
+
+        double sumre = p->re + q->re, sumim = p->im + q->im;
+        double diffre = p->re - q->re, diffim = p->im - q->im;
+        double tw1 = twre * sumim + twim * diffre;
+        double tw2 = twim * sumim - twre * diffre;
+
+        p->re = sumre - tw1;
+        p->im = diffim - tw2;
+        q->re = sumre + tw1;
+        q->im = -(diffim + tw2);
+    }
+
+    WDL_FFT_COMPLEX *p = data + permute[i];
+    p->re *= 2;
+    p->im *= -2;
+
+    if (inverse)
+        WDL_fft(data, (int)half, 1);
+}
+
+} // namespace
+
+//------------------------------------------------------------------------------
+void WDL_fft_init()
+{
+    get_fft_tables();
+}
+
+void WDL_fft(WDL_FFT_COMPLEX *buf, int len, int isInverse)
+{
+    const uint32_t bits = fft_bits_of(len);
+    if (bits == 0)
+        return;
+    const fft_tables &tables = get_fft_tables();
+    if (!isInverse)
+        fft_forward(buf, bits, tables);
+    else
+        fft_inverse(buf, bits, tables);
+}
+
+void WDL_real_fft(WDL_FFT_REAL *buf, int len, int isInverse)
+{
+    const uint32_t bits = fft_bits_of(len);
+    if (bits == 0)
+        return;
+    if (bits == 1) {
+        ysfx_wdl_real_fft(buf, len, isInverse);
+        return;
+    }
+    fft_two_for_one(buf, bits, isInverse != 0);
+}
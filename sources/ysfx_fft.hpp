@@ -0,0 +1,30 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+#pragma once
+#include "WDL/fft.h"
+
+// The vectorized FFT takes the place of WDL_fft and WDL_real_fft, which keep
+// their semantics and the order of their outputs, as given by WDL_fft_permute.
+// The original implementations of WDL remain under the following names.
+
+#if defined(YSFX_FFT_SIMD)
+extern "C" {
+void ysfx_wdl_fft_init();
+void ysfx_wdl_fft(WDL_FFT_COMPLEX *buf, int len, int isInverse);
+void ysfx_wdl_real_fft(WDL_FFT_REAL *buf, int len, int isInverse);
+}
+#endif
@@ -0,0 +1,130 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "ysfx_file_writer.hpp"
+#include "ysfx_utils.hpp"
+#include <algorithm>
+#include <cstring>
+
+ysfx_file_writer_t::ysfx_file_writer_t(opener_t opener, uint32_t capacity)
+    : m_opener(std::move(opener)),
+      m_capacity(std::max<uint32_t>(capacity, 16)),
+      m_chunk(std::min<uint32_t>(m_capacity / 4, 65536)),
+      m_ring(new uint8_t[m_capacity])
+{
+    m_thread = std::thread([this]() { run(); });
+}
+
+ysfx_file_writer_t::~ysfx_file_writer_t()
+{
+    m_quit.store(true);
+    m_wake.post();
+    m_thread.join();
+}
+
+bool ysfx_file_writer_t::write(const void *data, size_t size)
+{
+    uint64_t wpos = m_write_pos.load(std::memory_order_relaxed);
+    uint64_t used = wpos - m_read_pos.load();
+    if (size > m_capacity - used) {
+        m_dropped.fetch_add(size, std::memory_order_relaxed);
+        return false;
+    }
+
+    const uint8_t *src = (const uint8_t *)data;
+    uint32_t start = (uint32_t)(wpos % m_capacity);
+    size_t n = std::min<size_t>(size, m_capacity - start);
+    memcpy(&m_ring[start], src, n);
+    memcpy(&m_ring[0], src + n, size - n);
+    m_write_pos.store(wpos + size);
+
+    if (used + size >= m_chunk)
+        wake_thread();
+    return true;
+}
+
+void ysfx_file_writer_t::wake_thread()
+{
+    if (m_idle.exchange(false))
+        m_wake.post();
+}
+
+bool ysfx_file_writer_t::has_work() const
+{
+    uint64_t used = m_write_pos.load() - m_read_pos.load();
+    return used >= m_chunk || (used > 0 && m_quit.load());
+}
+
+void ysfx_file_writer_t::run()
+{
+    ysfx_file_sink_u sink;
+    bool failed = false;
+
+    for (;;) {
+        if (has_work()) {
+            if (!sink && !failed) {
+                sink.reset(m_opener());
+                failed = !sink;
+            }
+
+            // write the contiguous part of the used space
+            uint64_t rpos = m_read_pos.load(std::memory_order_relaxed);
+            uint64_t used = m_write_pos.load() - rpos;
+            uint32_t start = (uint32_t)(rpos % m_capacity);
+            uint64_t n = std::min<uint64_t>(used, m_capacity - start);
+            if (!failed && !sink->write(&m_ring[start], (size_t)n)) {
+                failed = true;
+                sink.reset();
+            }
+            // NOTE: after a failure, the bytes are consumed and lost
+            m_read_pos.store(rpos + n);
+            continue;
+        }
+
+        if (m_quit.load())
+            break;
+
+        m_idle.store(true);
+        // NOTE: the work may have come just before becoming idle; in which
+        //   case, the semaphore has been posted or is about to be
+        if ((has_work() || m_quit.load()) && m_idle.exchange(false))
+            continue;
+        m_wake.wait();
+    }
+}
+
+//------------------------------------------------------------------------------
+namespace {
+
+struct ysfx_stdio_sink_t final : ysfx_file_sink_t {
+    explicit ysfx_stdio_sink_t(FILE *stream) : m_stream(stream) {}
+    bool write(const uint8_t *data, size_t size) override
+    {
+        return fwrite(data, 1, size, m_stream.get()) == size;
+    }
+    ysfx::FILE_u m_stream;
+};
+
+} // namespace
+
+ysfx_file_sink_t *ysfx_stdio_sink_open(const char *path)
+{
+    FILE *stream = ysfx::fopen_utf8(path, "wb");
+    if (!stream)
+        return nullptr;
+    return new ysfx_stdio_sink_t(stream);
+}
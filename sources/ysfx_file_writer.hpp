@@ -0,0 +1,71 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+#include "ysfx.h"
+#include "utility/rt_semaphore.h"
+#include <functional>
+#include <thread>
+#include <atomic>
+#include <memory>
+
+// the destination of the bytes which a writer collects
+struct ysfx_file_sink_t {
+    virtual ~ysfx_file_sink_t() {}
+    virtual bool write(const uint8_t *data, size_t size) = 0;
+};
+
+using ysfx_file_sink_u = std::unique_ptr<ysfx_file_sink_t>;
+
+// writes a file on a thread of its own, from a ring buffer which the code fills;
+//   the code only copies to memory, and what does not fit in the ring is dropped
+//   the sink is opened by the thread when the first bytes come, and closed by it
+struct ysfx_file_writer_t {
+    using opener_t = std::function<ysfx_file_sink_t *()>;
+
+    ysfx_file_writer_t(opener_t opener, uint32_t capacity);
+    // NOTE: this waits for the thread to write the rest and close the sink
+    ~ysfx_file_writer_t();
+
+    // add all of the bytes or none of them, returning whether they were added
+    bool write(const void *data, size_t size);
+    // the count of bytes which were dropped for lack of space
+    uint64_t dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+
+private:
+    void run();
+    bool has_work() const;
+    void wake_thread();
+
+    opener_t m_opener;
+    uint32_t m_capacity = 0;
+    uint32_t m_chunk = 0;
+    std::unique_ptr<uint8_t[]> m_ring;
+    // the positions in bytes since the start of the file, the reader behind
+    std::atomic<uint64_t> m_write_pos{0};
+    std::atomic<uint64_t> m_read_pos{0};
+    std::atomic<uint64_t> m_dropped{0};
+    std::atomic<bool> m_quit{false};
+    std::atomic<bool> m_idle{false};
+    RTSemaphore m_wake;
+    std::thread m_thread;
+};
+
+using ysfx_file_writer_u = std::unique_ptr<ysfx_file_writer_t>;
+
+// a sink which writes the bytes as they are
+ysfx_file_sink_t *ysfx_stdio_sink_open(const char *path);
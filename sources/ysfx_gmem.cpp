@@ -0,0 +1,100 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "ysfx_gmem.hpp"
+#include "WDL/eel2/ns-eel.h"
+#include <map>
+#include <mutex>
+#include <algorithm>
+#include <cstdlib>
+
+namespace {
+
+struct gmem_registry {
+    std::mutex mutex;
+    std::map<std::string, std::weak_ptr<ysfx_gmem_t>> entries;
+};
+
+gmem_registry &get_gmem_registry()
+{
+    static gmem_registry registry;
+    return registry;
+}
+
+} // namespace
+
+ysfx_gmem_t::~ysfx_gmem_t()
+{
+    if (!file.is_open()) {
+        NSEEL_VM_FreeGRAM(&gram);
+        return;
+    }
+
+    // only the blocks after the mapped ones were allocated by EEL2
+    EEL_F **blocks = (EEL_F **)gram;
+    for (uint32_t i = mapped_blocks; i < NSEEL_RAM_BLOCKS; ++i)
+        free(blocks[i]);
+    free(blocks);
+    gram = nullptr;
+}
+
+// put the blocks of the file in the context, where EEL2 finds them allocated
+static bool ysfx_gmem_map(ysfx_gmem_t &gmem, const ysfx_gmem_file_t &file)
+{
+    const uint32_t max_size = NSEEL_RAM_BLOCKS * NSEEL_RAM_ITEMSPERBLOCK;
+    const uint32_t size = std::min(file.size, max_size);
+    const uint32_t num_blocks = (size + NSEEL_RAM_ITEMSPERBLOCK - 1) / NSEEL_RAM_ITEMSPERBLOCK;
+    const size_t block_bytes = NSEEL_RAM_ITEMSPERBLOCK * sizeof(EEL_F);
+    if (num_blocks == 0 || !gmem.file.open(file.path.c_str(), num_blocks * block_bytes))
+        return false;
+
+    EEL_F **blocks = (EEL_F **)calloc(NSEEL_RAM_BLOCKS, sizeof(EEL_F *));
+    if (!blocks) {
+        gmem.file.close();
+        return false;
+    }
+    for (uint32_t i = 0; i < num_blocks; ++i)
+        blocks[i] = (EEL_F *)(gmem.file.data() + i * block_bytes);
+    gmem.gram = blocks;
+    gmem.mapped_blocks = num_blocks;
+    return true;
+}
+
+ysfx_gmem_sp ysfx_gmem_acquire(const std::string &name, const ysfx_gmem_file_t *file)
+{
+    gmem_registry &registry = get_gmem_registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    // forget the memories which are no longer used by any instance
+    for (auto it = registry.entries.begin(); it != registry.entries.end(); ) {
+        if (it->second.expired())
+            it = registry.entries.erase(it);
+        else
+            ++it;
+    }
+
+    std::weak_ptr<ysfx_gmem_t> &slot = registry.entries[name];
+    if (ysfx_gmem_sp existing = slot.lock())
+        return existing;
+
+    ysfx_gmem_sp gmem{new ysfx_gmem_t};
+    gmem->name = name;
+    if (file)
+        ysfx_gmem_map(*gmem, *file);
+    slot = gmem;
+    return gmem;
+}
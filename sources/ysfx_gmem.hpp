@@ -0,0 +1,52 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+#include "ysfx_utils.hpp"
+#include <string>
+#include <memory>
+#include <cstdint>
+
+// Named global memory, which instances share by `options:gmem=NAME`. Each
+// name maps to one EEL2 context of global RAM, for all the instances of the
+// process, and it's released with the last instance which uses it.
+//
+// The memory may be backed by a file, whose blocks are mapped into the context
+// in place of the ones which EEL2 allocates; the contents then persist with the
+// file, and the processes which map it share them.
+
+// the file which backs a global memory, and how many of its items it maps
+struct ysfx_gmem_file_t {
+    std::string path;
+    uint32_t size = 0;
+};
+
+struct ysfx_gmem_t {
+    ~ysfx_gmem_t();
+    std::string name;
+    // the context of global RAM, in the form which EEL2 uses
+    void *gram = nullptr;
+    // the file of the first blocks, if it's backed by one
+    ysfx::shared_mapped_file file;
+    uint32_t mapped_blocks = 0;
+};
+
+using ysfx_gmem_sp = std::shared_ptr<ysfx_gmem_t>;
+
+// get the global memory of the given name, creating it if it doesn't exist;
+//   a memory which is created maps the file if one is given, and if it can
+ysfx_gmem_sp ysfx_gmem_acquire(const std::string &name, const ysfx_gmem_file_t *file = nullptr);
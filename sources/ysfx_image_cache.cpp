@@ -0,0 +1,113 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+#include "ysfx_image_cache.hpp"
+#if !defined(YSFX_NO_GFX)
+#include "ysfx_utils.hpp"
+#include "ysfx_package.hpp"
+#define WDL_NO_DEFINE_MINMAX
+#include "WDL/swell/swell.h"
+#include "WDL/lice/lice.h"
+#include <map>
+#include <climits>
+#include <mutex>
+#include <string>
+
+namespace {
+
+struct image_registry {
+    std::mutex mutex;
+    std::map<std::string, std::weak_ptr<const ysfx_image_t>> entries;
+};
+
+image_registry &get_image_registry()
+{
+    static image_registry registry;
+    return registry;
+}
+
+} // namespace
+
+// decode an image of a package, in the formats which decode from memory
+static LICE_IBitmap *ysfx_image_load_packaged(const char *path, const ysfx_package_data_t &packaged)
+{
+    if (packaged.size > INT_MAX)
+        return nullptr;
+    if (ysfx::path_has_suffix(path, "png"))
+        return LICE_LoadPNGFromMemory(packaged.data, (int)packaged.size);
+    if (ysfx::path_has_suffix(path, "jpg") || ysfx::path_has_suffix(path, "jpeg"))
+        return LICE_LoadJPGFromMemory(packaged.data, (int)packaged.size);
+    return nullptr;
+}
+
+ysfx_image_t::~ysfx_image_t()
+{
+    delete bitmap;
+}
+
+ysfx_image_sp ysfx_image_acquire(const char *path)
+{
+    ysfx::file_stamp stamp;
+    if (!ysfx_package_get_file_stamp(path, stamp))
+        return nullptr;
+
+    std::string key{path};
+    key.push_back('\0');
+    key.append(std::to_string(stamp.first));
+    key.push_back(':');
+    key.append(std::to_string(stamp.second));
+
+    image_registry &registry = get_image_registry();
+    {
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        auto it = registry.entries.find(key);
+        if (it != registry.entries.end()) {
+            if (ysfx_image_sp existing = it->second.lock())
+                return existing;
+        }
+    }
+
+    // decode without the lock, so the instances can load different files at once
+    LICE_IBitmap *bitmap;
+    if (ysfx_package_data_sp packaged = ysfx_package_read(path))
+        bitmap = ysfx_image_load_packaged(path, *packaged);
+    else
+        bitmap = LICE_LoadImage(path, nullptr, false);
+    if (!bitmap)
+        return nullptr;
+    std::shared_ptr<ysfx_image_t> image{new ysfx_image_t};
+    image->bitmap = bitmap;
+
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    // forget the images which are no longer used by any instance
+    for (auto it = registry.entries.begin(); it != registry.entries.end(); ) {
+        if (it->second.expired())
+            it = registry.entries.erase(it);
+        else
+            ++it;
+    }
+
+    // in case another instance has decoded it meanwhile
+    std::weak_ptr<const ysfx_image_t> &slot = registry.entries[key];
+    if (ysfx_image_sp existing = slot.lock())
+        return existing;
+
+    slot = image;
+    return image;
+}
+
+#endif
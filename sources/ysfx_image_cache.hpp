@@ -0,0 +1,38 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+#pragma once
+#if !defined(YSFX_NO_GFX)
+#include <memory>
+
+class LICE_IBitmap;
+
+// Decoded images, which instances share by `gfx_loadimg`. Each version of a
+// file, by path and modification time, is decoded once for the process, and
+// it's released with the last instance which uses it. The bitmap must not be
+// modified; an instance which draws on an image makes its own copy first.
+
+struct ysfx_image_t {
+    ~ysfx_image_t();
+    LICE_IBitmap *bitmap = nullptr;
+};
+
+using ysfx_image_sp = std::shared_ptr<const ysfx_image_t>;
+
+// get the decoded image of the given file, decoding it if it isn't already
+ysfx_image_sp ysfx_image_acquire(const char *path);
+
+#endif
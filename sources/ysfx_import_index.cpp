@@ -0,0 +1,163 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "ysfx_import_index.hpp"
+#include "ysfx_utils.hpp"
+#include <unordered_map>
+#include <vector>
+#include <memory>
+#include <mutex>
+
+namespace {
+
+struct import_index {
+    // lowercase file name -> paths, in the order of the directory walk
+    std::unordered_map<std::string, std::vector<std::string>> files;
+};
+using import_index_p = std::shared_ptr<const import_index>;
+
+struct import_index_registry {
+    std::mutex mutex;
+    std::unordered_map<std::string, import_index_p> roots;
+};
+
+import_index_registry &get_registry()
+{
+    static import_index_registry registry;
+    return registry;
+}
+
+std::string to_lower(std::string text)
+{
+    for (char &c : text)
+        c = ysfx::ascii_tolower(c);
+    return text;
+}
+
+// make paths comparable, using a single '/' between components
+std::string normalize_path(const std::string &path)
+{
+    std::string result;
+    result.reserve(path.size());
+    for (char c : path) {
+        if (ysfx::is_path_separator(c)) {
+            // keep the prefix of network paths
+            if (result.size() > 1 && result.back() == '/')
+                continue;
+            c = '/';
+        }
+        result.push_back(c);
+    }
+    return result;
+}
+
+import_index_p build_index(const std::string &root)
+{
+    std::shared_ptr<import_index> index{new import_index};
+
+    auto visit = [](const std::string &dir, void *data) -> bool {
+        import_index &index = *(import_index *)data;
+        std::string dirpath = ysfx::path_ensure_final_separator(normalize_path(dir).c_str());
+        for (const std::string &entry : ysfx::list_directory(dir.c_str())) {
+            if (entry.empty() || entry.back() == '/')
+                continue;
+            index.files[to_lower(entry)].push_back(dirpath + entry);
+        }
+        return true;
+    };
+    ysfx::visit_directories(root.c_str(), +visit, index.get());
+
+    return index;
+}
+
+import_index_p get_index(const std::string &root, bool rebuild)
+{
+    import_index_registry &registry = get_registry();
+
+    if (!rebuild) {
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        auto it = registry.roots.find(root);
+        if (it != registry.roots.end())
+            return it->second;
+    }
+
+    // walk the tree without holding the lock
+    import_index_p index = build_index(root);
+
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.roots[root] = index;
+    return index;
+}
+
+bool search_index(const import_index &index, const std::string &dir, const std::string &fragment, std::string &result)
+{
+    std::string tail = to_lower(normalize_path(fragment));
+    size_t name_pos = tail.rfind('/');
+    std::string name = (name_pos == std::string::npos) ? tail : tail.substr(name_pos + 1);
+
+    auto it = index.files.find(name);
+    if (it == index.files.end())
+        return false;
+
+    for (const std::string &path : it->second) {
+        // the path must be dir + something + fragment
+        if (path.size() < dir.size() + tail.size() || path.compare(0, dir.size(), dir) != 0)
+            continue;
+        size_t tail_pos = path.size() - tail.size();
+        if (to_lower(path.substr(tail_pos)) != tail || path[tail_pos - 1] != '/')
+            continue;
+        result = path;
+        return true;
+    }
+
+    return false;
+}
+
+} // namespace
+
+ysfx_import_index_result_t ysfx_import_index_find(const std::string &root_, const std::string &dir_, const std::string &fragment, std::string &result)
+{
+    std::string root = ysfx::path_ensure_final_separator(normalize_path(root_).c_str());
+    std::string dir = ysfx::path_ensure_final_separator(normalize_path(dir_).c_str());
+
+    if (root.empty() || dir.compare(0, root.size(), root) != 0)
+        return ysfx_import_index_unavailable;
+
+    import_index_p index = get_index(root, false);
+
+    // rebuild once if the file has gone, or if it's not known
+    std::string found;
+    bool success = search_index(*index, dir, fragment, found);
+    if (!success || !ysfx::exists(found.c_str())) {
+        index = get_index(root, true);
+        success = search_index(*index, dir, fragment, found);
+    }
+
+    if (!success)
+        return ysfx_import_index_not_found;
+
+    result = std::move(found);
+    return ysfx_import_index_found;
+}
+
+void ysfx_import_index_invalidate(const std::string &root_)
+{
+    std::string root = ysfx::path_ensure_final_separator(normalize_path(root_).c_str());
+    import_index_registry &registry = get_registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.roots.erase(root);
+}
@@ -0,0 +1,35 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+#include <string>
+
+// Index of the files below the import root, which replaces the recursive
+// search of imports. It's shared by all the instances of the process.
+
+enum ysfx_import_index_result_t {
+    // the directory is outside the import root
+    ysfx_import_index_unavailable = -1,
+    ysfx_import_index_not_found = 0,
+    ysfx_import_index_found = 1,
+};
+
+// find the first file below the directory which matches the fragment case-insensitively,
+// in depth-first order; the directory must be the import root or one of its subdirectories
+ysfx_import_index_result_t ysfx_import_index_find(const std::string &root, const std::string &dir, const std::string &fragment, std::string &result);
+// forget the index of a root, so that it's rebuilt at the next search
+void ysfx_import_index_invalidate(const std::string &root);
@@ -0,0 +1,62 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "ysfx_init_worker.hpp"
+
+ysfx_init_worker_t::ysfx_init_worker_t(std::function<void()> job)
+    : m_job(std::move(job))
+{
+    m_thread = std::thread([this]() { run(); });
+}
+
+ysfx_init_worker_t::~ysfx_init_worker_t()
+{
+    m_quit.store(true);
+    m_wake.post();
+    m_thread.join();
+}
+
+void ysfx_init_worker_t::start()
+{
+    m_running.store(true, std::memory_order_release);
+    m_wake.post();
+}
+
+void ysfx_init_worker_t::wait()
+{
+    if (!running())
+        return;
+    std::unique_lock<std::mutex> lock{m_done_mutex};
+    m_done.wait(lock, [this]() -> bool { return !running(); });
+}
+
+void ysfx_init_worker_t::run()
+{
+    for (;;) {
+        m_wake.wait();
+        if (m_quit.load())
+            break;
+        if (!running())
+            continue;
+
+        m_job();
+
+        std::lock_guard<std::mutex> lock{m_done_mutex};
+        m_running.store(false, std::memory_order_release);
+        m_done.notify_all();
+    }
+}
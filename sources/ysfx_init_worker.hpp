@@ -0,0 +1,54 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+#include "utility/rt_semaphore.h"
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+
+// runs the @init of an effect on a thread of its own, when the processing
+//   finds it due; the processing passes the audio through until it is done
+// it also prepares the variants of config items, which is a job of the same kind
+struct ysfx_init_worker_t {
+    explicit ysfx_init_worker_t(std::function<void()> job);
+    // NOTE: this waits for the job which is in progress, if any
+    ~ysfx_init_worker_t();
+
+    // start the job, which must not be running; this is for the audio thread
+    void start();
+    // whether the job is running; once it is not, what it did is visible
+    bool running() const { return m_running.load(std::memory_order_acquire); }
+    // wait for the job which is in progress, if any; not for the audio thread
+    void wait();
+
+private:
+    void run();
+
+    std::function<void()> m_job;
+    std::atomic<bool> m_running{false};
+    std::atomic<bool> m_quit{false};
+    RTSemaphore m_wake;
+    std::mutex m_done_mutex;
+    std::condition_variable m_done;
+    std::thread m_thread;
+};
+
+using ysfx_init_worker_u = std::unique_ptr<ysfx_init_worker_t>;
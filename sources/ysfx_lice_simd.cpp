@@ -0,0 +1,471 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+#include "ysfx_lice_simd.hpp"
+#if !defined(YSFX_NO_GFX)
+#define WDL_NO_DEFINE_MINMAX
+#include "WDL/swell/swell.h"
+#include "WDL/lice/lice.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#   define YSFX_LICE_SSE2 1
+#   include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#   define YSFX_LICE_NEON 1
+#   include <arm_neon.h>
+#endif
+
+namespace ysfx {
+
+#if defined(YSFX_LICE_SSE2) || defined(YSFX_LICE_NEON)
+namespace {
+
+//------------------------------------------------------------------------------
+// 4 pixels as bytes, and the 8 channels of 2 pixels as 16-bit words;
+// the channels go in the memory order of LICE, which is B, G, R, A
+
+#if defined(YSFX_LICE_SSE2)
+using vpix = __m128i;
+using vchan = __m128i;
+
+inline vpix load_pixels(const LICE_pixel *p) { return _mm_loadu_si128((const __m128i *)p); }
+inline void store_pixels(LICE_pixel *p, vpix v) { _mm_storeu_si128((__m128i *)p, v); }
+inline vpix splat_pixel(LICE_pixel c) { return _mm_set1_epi32((int)c); }
+inline vchan widen_lo(vpix v) { return _mm_unpacklo_epi8(v, _mm_setzero_si128()); }
+inline vchan widen_hi(vpix v) { return _mm_unpackhi_epi8(v, _mm_setzero_si128()); }
+inline vpix narrow(vchan lo, vchan hi) { return _mm_packus_epi16(lo, hi); }
+inline vchan set_chans(int b, int g, int r, int a) { return _mm_set_epi16((short)a, (short)r, (short)g, (short)b, (short)a, (short)r, (short)g, (short)b); }
+inline vchan splat_chan(int x) { return _mm_set1_epi16((short)x); }
+inline vchan add_chans(vchan x, vchan y) { return _mm_add_epi16(x, y); }
+inline vchan sub_chans(vchan x, vchan y) { return _mm_sub_epi16(x, y); }
+inline vchan min_chans(vchan x, vchan y) { return _mm_min_epi16(x, y); }
+// (x * y) >> 8, for products which fit in 16 bits unsigned
+inline vchan mul_shr8(vchan x, vchan y) { return _mm_srli_epi16(_mm_mullo_epi16(x, y), 8); }
+inline vchan splat_alpha(vchan v) { return _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3)); }
+inline vchan merge_alpha(vchan rgb, vchan alpha)
+{
+    const __m128i mask = set_chans(0, 0, 0, -1);
+    return _mm_or_si128(_mm_and_si128(mask, alpha), _mm_andnot_si128(mask, rgb));
+}
+// s + (d - s) * sc / 256, which rounds towards zero like the division of C
+inline vchan lerp_chans(vchan d, vchan s, vchan sc)
+{
+    __m128i diff = _mm_sub_epi16(d, s);
+    __m128i neg = _mm_srai_epi16(diff, 15);
+    __m128i q = mul_shr8(_mm_sub_epi16(_mm_xor_si128(diff, neg), neg), sc);
+    return _mm_add_epi16(s, _mm_sub_epi16(_mm_xor_si128(q, neg), neg));
+}
+inline vpix adds_pixels(vpix x, vpix y) { return _mm_adds_epu8(x, y); }
+inline vpix add_words(vpix x, vpix y) { return _mm_add_epi32(x, y); }
+template <int n> inline vpix shr_masked(vpix v, LICE_pixel mask) { return _mm_and_si128(_mm_srli_epi32(v, n), _mm_set1_epi32((int)mask)); }
+// the pixels of `d` where the alpha of `s` is zero, else those of `blended`
+inline vpix select_transparent(vpix s, vpix d, vpix blended)
+{
+    __m128i z = _mm_cmpeq_epi32(_mm_and_si128(s, _mm_set1_epi32((int)0xff000000u)), _mm_setzero_si128());
+    return _mm_or_si128(_mm_and_si128(z, d), _mm_andnot_si128(z, blended));
+}
+// (x * scale + add) >> 8 in 32 bits, for 2 pixels, saturated into 16 bits
+inline vchan mul_add_shr8(vchan x, vchan scale, __m128i add)
+{
+    __m128i lo = _mm_mullo_epi16(x, scale);
+    __m128i hi = _mm_mulhi_epi16(x, scale);
+    __m128i p0 = _mm_srai_epi32(_mm_add_epi32(_mm_unpacklo_epi16(lo, hi), add), 8);
+    __m128i p1 = _mm_srai_epi32(_mm_add_epi32(_mm_unpackhi_epi16(lo, hi), add), 8);
+    return _mm_packs_epi32(p0, p1);
+}
+inline __m128i set_words(int b, int g, int r, int a) { return _mm_set_epi32(a, r, g, b); }
+#elif defined(YSFX_LICE_NEON)
+using vpix = uint8x16_t;
+using vchan = uint16x8_t;
+
+inline vpix load_pixels(const LICE_pixel *p) { return vld1q_u8((const uint8_t *)p); }
+inline void store_pixels(LICE_pixel *p, vpix v) { vst1q_u8((uint8_t *)p, v); }
+inline vpix splat_pixel(LICE_pixel c) { return vreinterpretq_u8_u32(vdupq_n_u32(c)); }
+inline vchan widen_lo(vpix v) { return vmovl_u8(vget_low_u8(v)); }
+inline vchan widen_hi(vpix v) { return vmovl_high_u8(v); }
+inline vpix narrow(vchan lo, vchan hi) { return vqmovun_high_s16(vqmovun_s16(vreinterpretq_s16_u16(lo)), vreinterpretq_s16_u16(hi)); }
+inline vchan set_chans(int b, int g, int r, int a)
+{
+    const uint16_t c[8] = {(uint16_t)b, (uint16_t)g, (uint16_t)r, (uint16_t)a, (uint16_t)b, (uint16_t)g, (uint16_t)r, (uint16_t)a};
+    return vld1q_u16(c);
+}
+inline vchan splat_chan(int x) { return vdupq_n_u16((uint16_t)x); }
+inline vchan add_chans(vchan x, vchan y) { return vaddq_u16(x, y); }
+inline vchan sub_chans(vchan x, vchan y) { return vsubq_u16(x, y); }
+inline vchan min_chans(vchan x, vchan y) { return vminq_u16(x, y); }
+inline vchan mul_shr8(vchan x, vchan y) { return vshrq_n_u16(vmulq_u16(x, y), 8); }
+inline vchan splat_alpha(vchan v)
+{
+    const uint8_t idx[16] = {6, 7, 6, 7, 6, 7, 6, 7, 14, 15, 14, 15, 14, 15, 14, 15};
+    return vreinterpretq_u16_u8(vqtbl1q_u8(vreinterpretq_u8_u16(v), vld1q_u8(idx)));
+}
+inline vchan merge_alpha(vchan rgb, vchan alpha) { return vbslq_u16(set_chans(0, 0, 0, 0xffff), alpha, rgb); }
+inline vchan lerp_chans(vchan d, vchan s, vchan sc)
+{
+    int16x8_t diff = vsubq_s16(vreinterpretq_s16_u16(d), vreinterpretq_s16_u16(s));
+    int16x8_t neg = vshrq_n_s16(diff, 15);
+    int16x8_t q = vreinterpretq_s16_u16(mul_shr8(vreinterpretq_u16_s16(vabsq_s16(diff)), sc));
+    return vreinterpretq_u16_s16(vaddq_s16(vreinterpretq_s16_u16(s), vsubq_s16(veorq_s16(q, neg), neg)));
+}
+inline vpix adds_pixels(vpix x, vpix y) { return vqaddq_u8(x, y); }
+inline vpix add_words(vpix x, vpix y) { return vreinterpretq_u8_u32(vaddq_u32(vreinterpretq_u32_u8(x), vreinterpretq_u32_u8(y))); }
+template <int n> inline vpix shr_masked(vpix v, LICE_pixel mask) { return vreinterpretq_u8_u32(vandq_u32(vshrq_n_u32(vreinterpretq_u32_u8(v), n), vdupq_n_u32(mask))); }
+inline vpix select_transparent(vpix s, vpix d, vpix blended)
+{
+    uint32x4_t z = vceqq_u32(vandq_u32(vreinterpretq_u32_u8(s), vdupq_n_u32(0xff000000u)), vdupq_n_u32(0));
+    return vbslq_u8(vreinterpretq_u8_u32(z), d, blended);
+}
+inline vchan mul_add_shr8(vchan x, vchan scale, int32x4_t add)
+{
+    int16x8_t xs = vreinterpretq_s16_u16(x);
+    int16x8_t ss = vreinterpretq_s16_u16(scale);
+    int32x4_t p0 = vshrq_n_s32(vaddq_s32(vmull_s16(vget_low_s16(xs), vget_low_s16(ss)), add), 8);
+    int32x4_t p1 = vshrq_n_s32(vaddq_s32(vmull_high_s16(xs, ss), add), 8);
+    return vreinterpretq_u16_s16(vqmovn_high_s32(vqmovn_s32(p0), p1));
+}
+inline int32x4_t set_words(int b, int g, int r, int a)
+{
+    const int32_t c[4] = {b, g, r, a};
+    return vld1q_s32(c);
+}
+#endif
+
+//------------------------------------------------------------------------------
+// the scalar forms of the same, for the pixels which remain after the vectors
+
+inline int lerp_chan(int d, int s, int sc) { return s + ((d - s) * sc) / 256; }
+
+inline LICE_pixel adds_pixel(LICE_pixel x, LICE_pixel y)
+{
+    LICE_pixel out = 0;
+    for (int k = 0; k < 32; k += 8) {
+        LICE_pixel v = ((x >> k) & 0xff) + ((y >> k) & 0xff);
+        out |= (v > 255 ? 255 : v) << k;
+    }
+    return out;
+}
+
+inline int clamp_chan(int x) { return (x < 0) ? 0 : (x > 255) ? 255 : x; }
+
+template <class VecFn, class PixFn>
+void fill_rows(LICE_pixel *p, int span, int w, int h, VecFn vec, PixFn pix)
+{
+    for (; h > 0; --h, p += span) {
+        int i = 0;
+        for (; i + 4 <= w; i += 4)
+            store_pixels(&p[i], vec(load_pixels(&p[i])));
+        for (; i < w; ++i)
+            p[i] = pix(p[i]);
+    }
+}
+
+template <class VecFn, class PixFn>
+void blit_rows(LICE_pixel *d, int dspan, const LICE_pixel *s, int sspan, int w, int h, VecFn vec, PixFn pix)
+{
+    for (; h > 0; --h, d += dspan, s += sspan) {
+        int i = 0;
+        for (; i + 4 <= w; i += 4)
+            store_pixels(&d[i], vec(load_pixels(&d[i]), load_pixels(&s[i])));
+        for (; i < w; ++i)
+            d[i] = pix(d[i], s[i]);
+    }
+}
+
+bool is_scaled(LICE_IBitmap *bm)
+{
+    return (int)bm->Extended(LICE_EXT_GET_SCALING, nullptr) > 0;
+}
+
+// find the rows of a rectangle clipped to the bitmap, the same way as LICE
+bool clip_rect(LICE_IBitmap *dest, int x, int y, int &w, int &h, LICE_pixel *&p, int &span)
+{
+    const int destbm_w = dest->getWidth();
+    const int destbm_h = dest->getHeight();
+    p = dest->getBits();
+    span = dest->getRowSpan();
+
+    if (x < 0) { w += x; x = 0; }
+    if (y < 0) { h += y; y = 0; }
+    if (!p || !span || w < 1 || h < 1 || x >= destbm_w || y >= destbm_h)
+        return false;
+
+    if (w > destbm_w - x) w = destbm_w - x;
+    if (h > destbm_h - y) h = destbm_h - y;
+
+    p += dest->isFlipped() ? (destbm_h - y - h) * span : span * y;
+    p += x;
+    return true;
+}
+
+} // namespace
+
+//------------------------------------------------------------------------------
+bool lice_fill_rect(LICE_IBitmap *dest, int x, int y, int w, int h, uint32_t color, float alpha, int mode)
+{
+    const int blend = mode & LICE_BLIT_MODE_MASK;
+    if (!dest || is_scaled(dest) || (blend != LICE_BLIT_MODE_COPY && blend != LICE_BLIT_MODE_ADD))
+        return false;
+
+    if (mode & LICE_BLIT_USE_ALPHA)
+        alpha *= LICE_GETA(color) / 255.0f;
+
+    LICE_pixel *p;
+    int span;
+    if (!alpha || !clip_rect(dest, x, y, w, h, p, span))
+        return true;
+
+    const int ia = (int)(alpha * 256.0);
+    if (ia == 0)
+        return true;
+    if (ia < 0 || ia > 256)
+        return false;
+
+    const int r = LICE_GETR(color), g = LICE_GETG(color), b = LICE_GETB(color);
+
+    if (blend == LICE_BLIT_MODE_ADD) {
+        // the alpha channel adds the alpha itself, as in LICE
+        const LICE_pixel t = LICE_RGBA((r * ia) / 256, (g * ia) / 256, (b * ia) / 256, std::min(255, (ia * ia) / 256));
+        const vpix vt = splat_pixel(t);
+        fill_rows(p, span, w, h,
+            [vt](vpix d) { return adds_pixels(d, vt); },
+            [t](LICE_pixel d) { return adds_pixel(d, t); });
+        return true;
+    }
+
+    // the special alphas, which LICE mixes by shifts
+    if (ia == 256) {
+        const vpix vc = splat_pixel(color);
+        fill_rows(p, span, w, h,
+            [vc](vpix) { return vc; },
+            [color](LICE_pixel) { return (LICE_pixel)color; });
+        return true;
+    }
+    if (ia == 128) {
+        const LICE_pixel c = (color >> 1) & 0x7f7f7f7f;
+        const vpix vc = splat_pixel(c);
+        fill_rows(p, span, w, h,
+            [vc](vpix d) { return add_words(shr_masked<1>(d, 0x7f7f7f7f), vc); },
+            [c](LICE_pixel d) { return ((d >> 1) & 0x7f7f7f7f) + c; });
+        return true;
+    }
+    if (ia == 64) {
+        const LICE_pixel c = (color >> 2) & 0x3f3f3f3f;
+        const vpix vc = splat_pixel(c);
+        fill_rows(p, span, w, h,
+            [vc](vpix d) { return add_words(add_words(shr_masked<1>(d, 0x7f7f7f7f), shr_masked<2>(d, 0x3f3f3f3f)), vc); },
+            [c](LICE_pixel d) { return ((d >> 1) & 0x7f7f7f7f) + ((d >> 2) & 0x3f3f3f3f) + c; });
+        return true;
+    }
+    if (ia == 192) {
+        const LICE_pixel c = ((color >> 1) & 0x7f7f7f7f) + ((color >> 2) & 0x3f3f3f3f);
+        const vpix vc = splat_pixel(c);
+        fill_rows(p, span, w, h,
+            [vc](vpix d) { return add_words(shr_masked<2>(d, 0x3f3f3f3f), vc); },
+            [c](LICE_pixel d) { return ((d >> 2) & 0x3f3f3f3f) + c; });
+        return true;
+    }
+
+    // the alpha channel mixes towards the alpha itself, as in LICE
+    const int sc = 256 - ia;
+    const vchan vc = set_chans(b, g, r, ia);
+    const vchan vsc = splat_chan(sc);
+    fill_rows(p, span, w, h,
+        [vc, vsc](vpix d) { return narrow(lerp_chans(widen_lo(d), vc, vsc), lerp_chans(widen_hi(d), vc, vsc)); },
+        [r, g, b, ia, sc](LICE_pixel d) {
+            return (LICE_pixel)LICE_RGBA(lerp_chan(LICE_GETR(d), r, sc), lerp_chan(LICE_GETG(d), g, sc),
+                                         lerp_chan(LICE_GETB(d), b, sc), lerp_chan(LICE_GETA(d), ia, sc));
+        });
+    return true;
+}
+
+bool lice_multiply_add_rect(LICE_IBitmap *dest, int x, int y, int w, int h,
+                            float rsc, float gsc, float bsc, float asc,
+                            float radd, float gadd, float badd, float aadd)
+{
+    if (!dest || is_scaled(dest))
+        return false;
+
+    const int ir = (int)(rsc * 256.0), ig = (int)(gsc * 256.0), ib = (int)(bsc * 256.0), ia = (int)(asc * 256.0);
+    const int ir2 = (int)(radd * 256.0), ig2 = (int)(gadd * 256.0), ib2 = (int)(badd * 256.0), ia2 = (int)(aadd * 256.0);
+
+    // the vectors multiply in 16 bits, and add in 32 bits without overflow
+    auto fits16 = [](int v) -> bool { return v >= -32768 && v <= 32767; };
+    auto fitsAdd = [](int v) -> bool { return v >= -(1 << 30) && v <= (1 << 30); };
+    if (!fits16(ir) || !fits16(ig) || !fits16(ib) || !fits16(ia) ||
+        !fitsAdd(ir2) || !fitsAdd(ig2) || !fitsAdd(ib2) || !fitsAdd(ia2))
+        return false;
+
+    LICE_pixel *p;
+    int span;
+    if (!clip_rect(dest, x, y, w, h, p, span))
+        return true;
+
+    const vchan vscale = set_chans(ib, ig, ir, ia);
+    const auto vadd = set_words(ib2, ig2, ir2, ia2);
+    fill_rows(p, span, w, h,
+        [vscale, vadd](vpix d) { return narrow(mul_add_shr8(widen_lo(d), vscale, vadd), mul_add_shr8(widen_hi(d), vscale, vadd)); },
+        [=](LICE_pixel d) {
+            return (LICE_pixel)LICE_RGBA(clamp_chan((int)(LICE_GETR(d) * ir + ir2) >> 8), clamp_chan((int)(LICE_GETG(d) * ig + ig2) >> 8),
+                                         clamp_chan((int)(LICE_GETB(d) * ib + ib2) >> 8), clamp_chan((int)(LICE_GETA(d) * ia + ia2) >> 8));
+        });
+    return true;
+}
+
+bool lice_scaled_blit(LICE_IBitmap *dest, LICE_IBitmap *src,
+                      int dstx, int dsty, int dstw, int dsth,
+                      float srcx, float srcy, float srcw, float srch,
+                      float alpha, int mode)
+{
+    if (!dest || !src || !dstw || !dsth || !alpha)
+        return false;
+    if (src == dest || is_scaled(dest) || is_scaled(src))
+        return false;
+
+    // only the blits which LICE makes without scaling, nor filtering
+    if (!(fabs(srcw - dstw) < 0.001 && fabs(srch - dsth) < 0.001))
+        return false;
+    if ((mode & LICE_BLIT_FILTER_MASK) == LICE_BLIT_FILTER_BILINEAR &&
+        !(fabs(srcx - floor(srcx + 0.5f)) < 0.03 && fabs(srcy - floor(srcy + 0.5f)) < 0.03))
+        return false;
+
+    const int blend = mode & (LICE_BLIT_MODE_MASK | LICE_BLIT_USE_ALPHA);
+    const bool half = blend == LICE_BLIT_MODE_COPY && alpha == 0.5;
+    const int ia = (int)(alpha * 256.0);
+    if (blend == LICE_BLIT_MODE_COPY && alpha == 1.0)
+        return false; // it's a copy of rows, which LICE already does
+    if (blend != LICE_BLIT_MODE_COPY && blend != (LICE_BLIT_MODE_COPY | LICE_BLIT_USE_ALPHA) && blend != LICE_BLIT_MODE_ADD)
+        return false;
+    if (!half && (ia < 0 || ia > 256))
+        return false;
+
+    int sl = (int)(srcx + 0.5f), st = (int)(srcy + 0.5f);
+    int sr = sl + (int)(srcw + 0.5), sb = st + (int)(srch + 0.5);
+
+    // clip like LICE_Blit
+    const int srcbm_w = src->getWidth(), srcbm_h = src->getHeight();
+    const int destbm_w = dest->getWidth(), destbm_h = dest->getHeight();
+    if (sl < 0) { dstx -= sl; sl = 0; }
+    if (st < 0) { dsty -= st; st = 0; }
+    if (sr > srcbm_w) sr = srcbm_w;
+    if (sb > srcbm_h) sb = srcbm_h;
+    if (dstx < 0) { sl -= dstx; dstx = 0; }
+    if (dsty < 0) { st -= dsty; dsty = 0; }
+    if (sl < 0 || st < 0)
+        return true;
+    if (sr <= sl || sb <= st || dstx >= destbm_w || dsty >= destbm_h)
+        return true;
+    if (sr > sl + (destbm_w - dstx)) sr = sl + (destbm_w - dstx);
+    if (sb > st + (destbm_h - dsty)) sb = st + (destbm_h - dsty);
+    if (sr <= sl || sb <= st)
+        return true;
+
+    const LICE_pixel *psrc = src->getBits();
+    LICE_pixel *pdest = dest->getBits();
+    if (!psrc || !pdest)
+        return true;
+
+    int src_span = src->getRowSpan();
+    int dest_span = dest->getRowSpan();
+    if (src->isFlipped()) {
+        psrc += (srcbm_h - st - 1) * src_span;
+        src_span = -src_span;
+    }
+    else
+        psrc += st * src_span;
+    psrc += sl;
+    if (dest->isFlipped()) {
+        pdest += (destbm_h - dsty - 1) * dest_span;
+        dest_span = -dest_span;
+    }
+    else
+        pdest += dsty * dest_span;
+    pdest += dstx;
+
+    const int w = sr - sl, h = sb - st;
+
+    if (half) {
+        blit_rows(pdest, dest_span, psrc, src_span, w, h,
+            [](vpix d, vpix s) { return add_words(shr_masked<1>(d, 0x7f7f7f7f), shr_masked<1>(s, 0x7f7f7f7f)); },
+            [](LICE_pixel d, LICE_pixel s) { return ((d >> 1) & 0x7f7f7f7f) + ((s >> 1) & 0x7f7f7f7f); });
+        return true;
+    }
+
+    if (ia == 0)
+        return true;
+
+    if (blend == LICE_BLIT_MODE_ADD) {
+        const vchan via = splat_chan(ia);
+        blit_rows(pdest, dest_span, psrc, src_span, w, h,
+            [via](vpix d, vpix s) { return adds_pixels(d, narrow(mul_shr8(widen_lo(s), via), mul_shr8(widen_hi(s), via))); },
+            [ia](LICE_pixel d, LICE_pixel s) {
+                return adds_pixel(d, LICE_RGBA((LICE_GETR(s) * ia) / 256, (LICE_GETG(s) * ia) / 256,
+                                               (LICE_GETB(s) * ia) / 256, (LICE_GETA(s) * ia) / 256));
+            });
+        return true;
+    }
+
+    if (blend == LICE_BLIT_MODE_COPY) {
+        const int sc = 256 - ia;
+        const vchan vsc = splat_chan(sc);
+        blit_rows(pdest, dest_span, psrc, src_span, w, h,
+            [vsc](vpix d, vpix s) { return narrow(lerp_chans(widen_lo(d), widen_lo(s), vsc), lerp_chans(widen_hi(d), widen_hi(s), vsc)); },
+            [sc](LICE_pixel d, LICE_pixel s) {
+                return (LICE_pixel)LICE_RGBA(lerp_chan(LICE_GETR(d), LICE_GETR(s), sc), lerp_chan(LICE_GETG(d), LICE_GETG(s), sc),
+                                             lerp_chan(LICE_GETB(d), LICE_GETB(s), sc), lerp_chan(LICE_GETA(d), LICE_GETA(s), sc));
+            });
+        return true;
+    }
+
+    // the copy with source alpha; at full alpha, LICE mixes by 255 - a and adds a to the alpha
+    const bool full = ia == 256;
+    const vchan via = splat_chan(ia);
+    const vchan one = splat_chan(1);
+    const vchan v255 = splat_chan(255);
+    const vchan v256 = splat_chan(256);
+    auto mix = [=](vchan d, vchan s) -> vchan {
+        vchan a = splat_alpha(s);
+        vchan sc2 = full ? add_chans(a, one) : mul_shr8(add_chans(a, one), via);
+        vchan rgb = lerp_chans(d, s, sub_chans(v256, sc2));
+        vchan alpha = min_chans(add_chans(full ? a : sc2, d), v255);
+        return merge_alpha(rgb, alpha);
+    };
+    blit_rows(pdest, dest_span, psrc, src_span, w, h,
+        [mix](vpix d, vpix s) { return select_transparent(s, d, narrow(mix(widen_lo(d), widen_lo(s)), mix(widen_hi(d), widen_hi(s)))); },
+        [full, ia](LICE_pixel d, LICE_pixel s) {
+            const int a = LICE_GETA(s);
+            if (!a)
+                return d;
+            const int sc2 = full ? (a + 1) : (ia * (a + 1)) / 256;
+            const int sc = 256 - sc2;
+            return (LICE_pixel)LICE_RGBA(lerp_chan(LICE_GETR(d), LICE_GETR(s), sc), lerp_chan(LICE_GETG(d), LICE_GETG(s), sc),
+                                         lerp_chan(LICE_GETB(d), LICE_GETB(s), sc), std::min(255, (full ? a : sc2) + (int)LICE_GETA(d)));
+        });
+    return true;
+}
+
+#else
+
+// without vectors, LICE does it all
+bool lice_fill_rect(LICE_IBitmap *, int, int, int, int, uint32_t, float, int) { return false; }
+bool lice_multiply_add_rect(LICE_IBitmap *, int, int, int, int, float, float, float, float, float, float, float, float) { return false; }
+bool lice_scaled_blit(LICE_IBitmap *, LICE_IBitmap *, int, int, int, int, float, float, float, float, float, int) { return false; }
+
+#endif
+
+} // namespace ysfx
+#endif
@@ -0,0 +1,37 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+#pragma once
+#if !defined(YSFX_NO_GFX)
+#include <cstdint>
+
+class LICE_IBitmap;
+
+namespace ysfx {
+
+// vectorized paths of the LICE drawing which JSFX use the most, giving the same pixels as LICE
+//   each returns false when it does not handle the arguments, and the caller falls back to LICE
+bool lice_fill_rect(LICE_IBitmap *dest, int x, int y, int w, int h, uint32_t color, float alpha, int mode);
+bool lice_multiply_add_rect(LICE_IBitmap *dest, int x, int y, int w, int h,
+                            float rsc, float gsc, float bsc, float asc,
+                            float radd, float gadd, float badd, float aadd);
+bool lice_scaled_blit(LICE_IBitmap *dest, LICE_IBitmap *src,
+                      int dstx, int dsty, int dstw, int dsth,
+                      float srcx, float srcy, float srcw, float srch,
+                      float alpha, int mode);
+
+} // namespace ysfx
+#endif
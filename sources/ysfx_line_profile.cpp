@@ -0,0 +1,140 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "ysfx_line_profile.hpp"
+#include <algorithm>
+#include <chrono>
+
+std::string ysfx_instrument_lines(const std::string &text, uint32_t first_line, uint32_t unit)
+{
+    const char *src = text.data();
+    const size_t size = text.size();
+
+    std::string out;
+    out.reserve(size + size / 2);
+
+    uint32_t line = first_line;
+    // a statement starts at the next token
+    bool pending = true;
+
+    size_t i = 0;
+    while (i < size) {
+        char c = src[i];
+
+        // the blanks and comments which are before the statement
+        if (c == '\n')
+            ++line;
+        if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+            out.push_back(c);
+            ++i;
+            continue;
+        }
+        if (c == '/' && i + 1 < size && src[i + 1] == '/') {
+            while (i < size && src[i] != '\n')
+                out.push_back(src[i++]);
+            continue;
+        }
+        if (c == '/' && i + 1 < size && src[i + 1] == '*') {
+            size_t end = text.find("*/", i + 2);
+            end = (end == std::string::npos) ? size : (end + 2);
+            line += (uint32_t)std::count(src + i, src + end, '\n');
+            out.append(src + i, end - i);
+            i = end;
+            continue;
+        }
+
+        // a separator before a parenthesis ends a block, and a probe there
+        //   would change the value of the block
+        if (pending && c != ')' && c != ';') {
+            uint32_t probe = (unit << ysfx_line_probe_unit_shift) | (line + 1);
+            out.append("__ysfx_line(");
+            out.append(std::to_string(probe));
+            out.append(");");
+        }
+        pending = false;
+
+        if (c == '"' || c == '\'') {
+            size_t end = i + 1;
+            while (end < size && src[end] != c)
+                end += (src[end] == '\\' && end + 1 < size) ? 2 : 1;
+            end = std::min(end + 1, size);
+            line += (uint32_t)std::count(src + i, src + end, '\n');
+            out.append(src + i, end - i);
+            i = end;
+            continue;
+        }
+
+        pending = (c == ';');
+        out.push_back(c);
+        ++i;
+    }
+
+    return out;
+}
+
+//------------------------------------------------------------------------------
+ysfx_line_sampler_t::ysfx_line_sampler_t(const std::atomic<uint32_t> *slots, uint32_t period_us)
+    : m_slots(slots),
+      m_period_us(std::min<uint32_t>(std::max<uint32_t>(period_us, 50), 100000))
+{
+    m_thread = std::thread([this]() { run(); });
+}
+
+ysfx_line_sampler_t::~ysfx_line_sampler_t()
+{
+    m_quit.store(true);
+    m_thread.join();
+}
+
+std::map<uint32_t, uint64_t> ysfx_line_sampler_t::counts()
+{
+    std::lock_guard<ysfx::mutex> lock{m_mutex};
+    return m_counts;
+}
+
+void ysfx_line_sampler_t::reset()
+{
+    std::lock_guard<ysfx::mutex> lock{m_mutex};
+    m_counts.clear();
+}
+
+void ysfx_line_sampler_t::run()
+{
+    const std::chrono::microseconds period{m_period_us};
+    std::chrono::steady_clock::time_point next = std::chrono::steady_clock::now();
+
+    while (!m_quit.load()) {
+        next += period;
+        std::this_thread::sleep_until(next);
+
+        uint32_t probes[ysfx_line_probe_slots];
+        for (uint32_t i = 0; i < ysfx_line_probe_slots; ++i)
+            probes[i] = m_slots[i].load(std::memory_order_relaxed);
+
+        std::lock_guard<ysfx::mutex> lock{m_mutex};
+        for (uint32_t probe : probes) {
+            // a zero is no code running
+            if (probe != 0)
+                ++m_counts[probe];
+        }
+
+        // after a stall, do not try to catch up
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (now > next + 10 * period)
+            next = now;
+    }
+}
@@ -0,0 +1,65 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+#include "ysfx.h"
+#include "ysfx_utils.hpp"
+#include <string>
+#include <thread>
+#include <atomic>
+#include <map>
+#include <memory>
+
+enum {
+    // a probe gives the line in its low bits, and the index of the file above
+    ysfx_line_probe_unit_shift = 24,
+    // the slots of the lines which run, one for each thread which runs code
+    ysfx_line_probe_dsp = 0,
+    ysfx_line_probe_gfx = 1,
+    ysfx_line_probe_slots = 2,
+};
+
+// insert a probe before each statement of the text of a section, which tells
+//   the number of its line within the file; no line is added, so that the
+//   errors of the compiler keep their line numbers
+//   the `first_line` is the one of the start of the text, starting from 0
+std::string ysfx_instrument_lines(const std::string &text, uint32_t first_line, uint32_t unit);
+
+// a thread which looks at the lines which run, at a regular period, and
+//   counts the times which it sees each line
+struct ysfx_line_sampler_t {
+    ysfx_line_sampler_t(const std::atomic<uint32_t> *slots, uint32_t period_us);
+    // NOTE: this waits at most one period for the thread to stop
+    ~ysfx_line_sampler_t();
+
+    // the counts by probe, which has the file and the line
+    std::map<uint32_t, uint64_t> counts();
+    void reset();
+    uint32_t period_us() const { return m_period_us; }
+
+private:
+    void run();
+
+    const std::atomic<uint32_t> *m_slots = nullptr;
+    uint32_t m_period_us = 0;
+    ysfx::mutex m_mutex;
+    std::map<uint32_t, uint64_t> m_counts;
+    std::atomic<bool> m_quit{false};
+    std::thread m_thread;
+};
+
+using ysfx_line_sampler_u = std::unique_ptr<ysfx_line_sampler_t>;
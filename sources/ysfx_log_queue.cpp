@@ -0,0 +1,134 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "ysfx_log_queue.hpp"
+#include "ysfx_config.hpp"
+#include "ysfx_utils.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <cstdio>
+
+ysfx_log_queue_t::ysfx_log_queue_t(ysfx_config_t *config)
+    : m_config(config),
+      m_slots(new slot_t[capacity])
+{
+    for (uint32_t i = 0; i < capacity; ++i)
+        m_slots[i].sequence.store(i, std::memory_order_relaxed);
+}
+
+ysfx_log_queue_t::~ysfx_log_queue_t()
+{
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_quit = true;
+    }
+    m_cond.notify_all();
+    if (m_thread.joinable())
+        m_thread.join();
+}
+
+void ysfx_log_queue_t::start()
+{
+    std::lock_guard<std::mutex> lock{m_mutex};
+    if (!m_thread.joinable() && !m_quit)
+        m_thread = std::thread([this]() { run(); });
+}
+
+bool ysfx_log_queue_t::post(int kind, const char *text, size_t length)
+{
+    // the rate is counted by windows of a second
+    const uint64_t second = ysfx::monotonic_ns() / 1000000000u;
+    uint64_t window = m_window.load(std::memory_order_relaxed);
+    if (window != second && m_window.compare_exchange_strong(window, second, std::memory_order_relaxed))
+        m_window_count.store(0, std::memory_order_relaxed);
+    if (m_window_count.fetch_add(1, std::memory_order_relaxed) >= max_per_second) {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // the writers are several, the instances sharing the configuration
+    slot_t *slot;
+    uint32_t pos = m_write_pos.load(std::memory_order_relaxed);
+    for (;;) {
+        slot = &m_slots[pos % capacity];
+        int32_t diff = (int32_t)(slot->sequence.load(std::memory_order_acquire) - pos);
+        if (diff == 0) {
+            if (m_write_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+        }
+        else if (diff < 0) {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        else
+            pos = m_write_pos.load(std::memory_order_relaxed);
+    }
+
+    length = std::min<size_t>(length, message_size - 1);
+    memcpy(slot->text, text, length);
+    slot->text[length] = '\0';
+    slot->length = (uint32_t)length;
+    slot->kind = kind;
+    slot->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+void ysfx_log_queue_t::drain()
+{
+    // delivered one at a time, the reporter running without the slot
+    char text[message_size];
+    for (;;) {
+        int kind;
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+            slot_t &slot = m_slots[m_read_pos % capacity];
+            if ((int32_t)(slot.sequence.load(std::memory_order_acquire) - (m_read_pos + 1)) < 0)
+                break;
+            kind = slot.kind;
+            memcpy(text, slot.text, slot.length + 1);
+            slot.sequence.store(m_read_pos + capacity, std::memory_order_release);
+            ++m_read_pos;
+        }
+        deliver(kind, text);
+    }
+
+    uint32_t dropped = m_dropped.exchange(0, std::memory_order_relaxed);
+    if (dropped > 0)
+        ysfx_logf(*m_config, ysfx_log_warning, "%u messages of the processing were dropped", dropped);
+}
+
+void ysfx_log_queue_t::run()
+{
+    std::unique_lock<std::mutex> lock{m_mutex};
+    while (!m_quit) {
+        m_cond.wait_for(lock, std::chrono::milliseconds(drain_interval_ms));
+        lock.unlock();
+        drain();
+        lock.lock();
+    }
+}
+
+void ysfx_log_queue_t::deliver(int kind, const char *text)
+{
+    if (kind == stdout_kind) {
+        fputs(text, stdout);
+        fflush(stdout);
+    }
+    else
+        ysfx_log(*m_config, (ysfx_log_level)kind, text);
+}
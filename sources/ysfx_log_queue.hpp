@@ -0,0 +1,79 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+#include "ysfx.h"
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// carries the messages of the processing to the reporter, on a thread of its own;
+//   the processing posts into slots allocated ahead, without locking, and the
+//   messages in excess of the rate, or which do not fit, are counted as dropped
+struct ysfx_log_queue_t {
+    enum {
+        capacity = 64,
+        // the longer messages are truncated
+        message_size = 256,
+        // the most messages which a second accepts
+        max_per_second = 100,
+        // the period of the delivery
+        drain_interval_ms = 50,
+    };
+
+    // the kind of the text which goes to the standard output, the others being the log levels
+    enum { stdout_kind = -1 };
+
+    explicit ysfx_log_queue_t(ysfx_config_t *config);
+    // NOTE: the messages which remain are discarded, as the reporter may be gone with its configuration
+    ~ysfx_log_queue_t();
+
+    // start the thread of delivery, if it's not yet; the messages which are posted before wait for it
+    void start();
+    // post a message, without blocking nor allocating; false if it's dropped
+    bool post(int kind, const char *text, size_t length);
+    // deliver the messages which are posted, on the calling thread
+    void drain();
+
+private:
+    void run();
+    void deliver(int kind, const char *text);
+
+    struct slot_t {
+        std::atomic<uint32_t> sequence{0};
+        int32_t kind = 0;
+        uint32_t length = 0;
+        char text[message_size];
+    };
+
+    ysfx_config_t *m_config = nullptr;
+    std::unique_ptr<slot_t[]> m_slots;
+    std::atomic<uint32_t> m_write_pos{0};
+    // the reader holds the mutex
+    uint32_t m_read_pos = 0;
+    std::atomic<uint64_t> m_window{0};
+    std::atomic<uint32_t> m_window_count{0};
+    std::atomic<uint32_t> m_dropped{0};
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    bool m_quit = false;
+    std::thread m_thread;
+};
@@ -0,0 +1,61 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+#include "ysfx_lookahead.hpp"
+#include <algorithm>
+
+ysfx_lookahead_t::ysfx_lookahead_t(uint32_t channels, uint32_t delay, uint32_t max_block)
+    : m_channels(std::max<uint32_t>(channels, 1)),
+      m_delay(delay)
+{
+    uint64_t capacity = 1;
+    while (capacity < ((uint64_t)delay + std::max<uint32_t>(max_block, 1)) * m_channels)
+        capacity <<= 1;
+    m_ring.resize((size_t)capacity);
+    m_mask = capacity - 1;
+}
+
+uint32_t ysfx_lookahead_t::push_room() const
+{
+    // what is unread and the delay behind it must stay in the ring
+    const uint64_t used = m_written - m_read + (uint64_t)m_delay * m_channels;
+    return (uint32_t)((m_ring.size() - used) / m_channels);
+}
+
+uint32_t ysfx_lookahead_t::read_room() const
+{
+    return (uint32_t)((m_written - m_read) / m_channels);
+}
+
+void ysfx_lookahead_t::push(const ysfx_real *values, uint32_t count)
+{
+    const uint64_t pos = m_written & m_mask;
+    const uint64_t first = std::min<uint64_t>(count, m_ring.size() - pos);
+    std::copy_n(values, (size_t)first, &m_ring[(size_t)pos]);
+    std::copy_n(values + first, (size_t)(count - first), m_ring.data());
+    m_written += count;
+}
+
+void ysfx_lookahead_t::read(ysfx_real *values, uint32_t count)
+{
+    // the positions before the start wrap to the end of the ring,
+    //   which is still zero, since the room keeps the pushes away from it
+    const uint64_t pos = (m_read - (uint64_t)m_delay * m_channels) & m_mask;
+    const uint64_t first = std::min<uint64_t>(count, m_ring.size() - pos);
+    std::copy_n(&m_ring[(size_t)pos], (size_t)first, values);
+    std::copy_n(m_ring.data(), (size_t)(count - first), values + first);
+    m_read += count;
+}
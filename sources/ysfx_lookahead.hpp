@@ -0,0 +1,51 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+#pragma once
+#include "ysfx.h"
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+// delays interleaved frames of a number of channels, for effects which look
+//   ahead: a block is pushed as soon as it comes, which lets the effect look at
+//   it, and the same frames are read back `delay` frames later; the ring holds
+//   the delay and one block, which is the most which can be pushed unread
+struct ysfx_lookahead_t {
+    ysfx_lookahead_t(uint32_t channels, uint32_t delay, uint32_t max_block);
+
+    uint32_t channels() const { return m_channels; }
+    uint32_t delay() const { return m_delay; }
+    // the frames which can be pushed, or read, at this time
+    uint32_t push_room() const;
+    uint32_t read_room() const;
+    // push or read interleaved values; the counts are in values, for buffers which come in pieces,
+    //   and the caller keeps them within the rooms, times the channels
+    void push(const ysfx_real *values, uint32_t count);
+    void read(ysfx_real *values, uint32_t count);
+
+private:
+    uint32_t m_channels = 0;
+    uint32_t m_delay = 0;
+    // the ring of values, of a size which is a power of 2
+    std::vector<ysfx_real> m_ring;
+    uint64_t m_mask = 0;
+    // the values pushed and read since the start
+    uint64_t m_written = 0;
+    uint64_t m_read = 0;
+};
+
+using ysfx_lookahead_u = std::unique_ptr<ysfx_lookahead_t>;
@@ -0,0 +1,161 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "ysfx_match.hpp"
+#include "ysfx_eel_utils.hpp"
+#include <algorithm>
+#include <cstring>
+
+void ysfx_match_program_t::compile(const char *fmt, const char *fmt_end)
+{
+    // parse the copy, which the terminator ends like the strings of EEL
+    m_pattern.assign(fmt, fmt_end);
+    m_ops.clear();
+    fmt = m_pattern.c_str();
+    fmt_end = fmt + m_pattern.size();
+
+    while (fmt < fmt_end) {
+        ysfx_match_op_t op;
+        const char c = *fmt++;
+
+        switch (c) {
+        case '*':
+        case '+':
+            op.type = (c == '*') ? ysfx_match_star : ysfx_match_plus;
+            if (*fmt == '?') {
+                op.lazy = true;
+                ++fmt;
+            }
+            break;
+
+        case '?':
+            op.type = ysfx_match_any;
+            break;
+
+        case '%':
+            {
+                // the same arithmetic as the interpreter, lengths included
+                uint16_t min_length = 1, max_length = 0;
+                if (*fmt >= '0' && *fmt <= '9') {
+                    min_length = *fmt++ - '0';
+                    while (*fmt >= '0' && *fmt <= '9')
+                        min_length = min_length * 10 + (*fmt++ - '0');
+                    max_length = min_length;
+                }
+                if (*fmt == '-') {
+                    ++fmt;
+                    max_length = 0;
+                    while (*fmt >= '0' && *fmt <= '9')
+                        max_length = max_length * 10 + (*fmt++ - '0');
+                }
+                op.min_length = min_length;
+                op.max_length = max_length;
+
+                if (*fmt == '{') {
+                    const char *name = ++fmt;
+                    while (*fmt && fmt < fmt_end && *fmt != '}')
+                        ++fmt;
+                    if (fmt >= fmt_end - 1 || *fmt != '}') {
+                        // the rest is never reached
+                        m_ops.push_back(op);
+                        return;
+                    }
+                    op.named = true;
+                    op.name.assign(name, std::min<size_t>(fmt - name, 127));
+                    ++fmt;
+                }
+
+                char fmt_char = *fmt++;
+                if (fmt_char == '*' || fmt_char == '?' || fmt_char == '+' || fmt_char == '%') {
+                    op.type = ysfx_match_escape;
+                    op.ch = fmt_char;
+                }
+                else if (fmt_char == 'c')
+                    op.type = ysfx_match_byte;
+                else {
+                    if (fmt_char >= 'A' && fmt_char <= 'Z') {
+                        op.lazy = true;
+                        fmt_char += 'a' - 'A';
+                    }
+                    if (fmt_char && strchr("sxfdui", fmt_char)) {
+                        op.type = ysfx_match_value;
+                        op.ch = fmt_char;
+                    }
+                }
+
+                if (op.type == ysfx_match_invalid) {
+                    m_ops.push_back(op);
+                    return;
+                }
+            }
+            break;
+
+        default:
+            // the characters which follow go together
+            if (!m_ops.empty() && m_ops.back().type == ysfx_match_text) {
+                m_ops.back().text.push_back(c);
+                continue;
+            }
+            op.type = ysfx_match_text;
+            op.text.assign(1, c);
+            break;
+        }
+
+        m_ops.push_back(std::move(op));
+    }
+}
+
+bool ysfx_match_program_t::is_pattern(const char *fmt, const char *fmt_end) const
+{
+    size_t size = (size_t)(fmt_end - fmt);
+    return size == m_pattern.size() && !memcmp(fmt, m_pattern.data(), size);
+}
+
+//------------------------------------------------------------------------------
+ysfx_match_cache_t::ysfx_match_cache_t()
+{
+    m_programs.reserve(max_programs);
+}
+
+const ysfx_match_program_t &ysfx_match_cache_t::get(const char *fmt, const char *fmt_end)
+{
+    auto it = std::find_if(m_programs.begin(), m_programs.end(), [fmt, fmt_end](const std::unique_ptr<ysfx_match_program_t> &program) {
+        return program->is_pattern(fmt, fmt_end);
+    });
+
+    if (it == m_programs.end()) {
+        // the least recent one is compiled again, when it's full
+        if (m_programs.size() < max_programs)
+            m_programs.emplace_back(new ysfx_match_program_t);
+        it = m_programs.end() - 1;
+        (*it)->compile(fmt, fmt_end);
+    }
+
+    std::rotate(m_programs.begin(), it, it + 1);
+    return *m_programs.front();
+}
+
+void ysfx_match_cache_t::precompile(const std::string &source)
+{
+    auto found = [this](const std::string &pattern) {
+        const char *fmt = pattern.data();
+        if (m_programs.size() < max_programs)
+            get(fmt, fmt + pattern.size());
+    };
+    ysfx_eel_find_literal_calls(source, "match", found);
+    ysfx_eel_find_literal_calls(source, "matchi", found);
+}
@@ -0,0 +1,284 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+#include "ysfx.h"
+#include "WDL/eel2/ns-eel.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <cctype>
+#include <cstring>
+
+// the patterns of `match` and `matchi`, compiled into a list of operations,
+//   which match the same way as `eel_string_match` of eel_strings.h, without
+//   parsing the pattern again at each step of the search
+//   the variables which receive the values are found and set by a sink:
+//     EEL_F *resolve(const ysfx_match_op_t &op, int position, EEL_F &alt);
+//     void store_char(EEL_F *var, EEL_F &alt, const char *msg);
+//     void store_value(const ysfx_match_op_t &op, EEL_F *var, EEL_F &alt, const char *msg, int len);
+
+enum ysfx_match_op_type_t : uint8_t {
+    // a run of characters
+    ysfx_match_text,
+    // `?`
+    ysfx_match_any,
+    // `*` or `*?`
+    ysfx_match_star,
+    // `+` or `+?`
+    ysfx_match_plus,
+    // `%%`, `%*`, `%?`, `%+`
+    ysfx_match_escape,
+    // `%c`
+    ysfx_match_byte,
+    // `%s`, `%d`, `%u`, `%i`, `%x`, `%f`, lazy in upper case
+    ysfx_match_value,
+    // a malformed format, which fails where it's reached
+    ysfx_match_invalid,
+};
+
+struct ysfx_match_op_t {
+    uint8_t type = ysfx_match_invalid;
+    // the escaped character, or the kind of value in lower case
+    char ch = 0;
+    bool lazy = false;
+    // whether the value goes to the variable of `%{name}`, not to the next one
+    bool named = false;
+    uint16_t min_length = 1;
+    uint16_t max_length = 0;
+    std::string name;
+    std::string text;
+};
+
+struct ysfx_match_program_t {
+    void compile(const char *fmt, const char *fmt_end);
+    bool is_pattern(const char *fmt, const char *fmt_end) const;
+
+    template <class Sink>
+    bool run(Sink &sink, const char *msg, const char *msg_end, bool ignorecase) const;
+
+private:
+    template <class Sink>
+    bool run(Sink &sink, size_t index, const char *msg, const char *msg_end, int position, bool ignorecase) const;
+    // whether the operation fails at once where the string is, which it does without
+    //   storing anything, so the search can skip this position
+    bool fails_at(size_t index, const char *msg, const char *msg_end, bool ignorecase) const;
+    static bool match_text(const ysfx_match_op_t &op, const char *msg, const char *msg_end, bool ignorecase);
+
+private:
+    std::string m_pattern;
+    std::vector<ysfx_match_op_t> m_ops;
+};
+
+// the programs of the patterns of an instance, the most recent ones; it's used
+//   under the lock of the strings, with which the builtins run
+struct ysfx_match_cache_t {
+    ysfx_match_cache_t();
+    // get the program of the pattern, compiled if it's not cached; the reference
+    //   is valid until the next call
+    const ysfx_match_program_t &get(const char *fmt, const char *fmt_end);
+    // compile ahead the literal patterns of `match("...")` and `matchi("...")`
+    void precompile(const std::string &source);
+    uint32_t size() const { return (uint32_t)m_programs.size(); }
+
+private:
+    enum { max_programs = 32 };
+    // the most recent first
+    std::vector<std::unique_ptr<ysfx_match_program_t>> m_programs;
+};
+
+using ysfx_match_cache_u = std::unique_ptr<ysfx_match_cache_t>;
+
+//------------------------------------------------------------------------------
+inline bool ysfx_match_program_t::match_text(const ysfx_match_op_t &op, const char *msg, const char *msg_end, bool ignorecase)
+{
+    const size_t length = op.text.size();
+    if ((size_t)(msg_end - msg) < length)
+        return false;
+    // the first character rejects most of the positions of a search
+    if (!ignorecase)
+        return *msg == op.text[0] && !memcmp(msg + 1, op.text.data() + 1, length - 1);
+    for (size_t i = 0; i < length; ++i) {
+        if (toupper((unsigned char)op.text[i]) != toupper((unsigned char)msg[i]))
+            return false;
+    }
+    return true;
+}
+
+inline bool ysfx_match_program_t::fails_at(size_t index, const char *msg, const char *msg_end, bool ignorecase) const
+{
+    if (index >= m_ops.size())
+        return msg < msg_end;
+    const ysfx_match_op_t &op = m_ops[index];
+    switch (op.type) {
+    case ysfx_match_text:
+        return !match_text(op, msg, msg_end, ignorecase);
+    case ysfx_match_any:
+    case ysfx_match_plus:
+        return msg >= msg_end;
+    case ysfx_match_escape:
+        return msg >= msg_end || *msg != op.ch;
+    default:
+        return false;
+    }
+}
+
+template <class Sink>
+bool ysfx_match_program_t::run(Sink &sink, const char *msg, const char *msg_end, bool ignorecase) const
+{
+    return run(sink, 0, msg, msg_end, 0, ignorecase);
+}
+
+template <class Sink>
+bool ysfx_match_program_t::run(Sink &sink, size_t index, const char *msg, const char *msg_end, int position, bool ignorecase) const
+{
+    const size_t count = m_ops.size();
+
+    for (;;) {
+        if (index >= count)
+            return msg >= msg_end;
+
+        const ysfx_match_op_t &op = m_ops[index];
+
+        // if the string ends, only a `*` or a `%` can match further
+        if (msg >= msg_end && (op.type == ysfx_match_text || op.type == ysfx_match_any || op.type == ysfx_match_plus))
+            return false;
+
+        switch (op.type) {
+        case ysfx_match_text:
+            if (!match_text(op, msg, msg_end, ignorecase))
+                return false;
+            ++index;
+            msg += op.text.size();
+            break;
+
+        case ysfx_match_any:
+            ++index;
+            ++msg;
+            break;
+
+        case ysfx_match_star:
+        case ysfx_match_plus:
+            // the last of the pattern takes the rest
+            if (index + 1 >= count)
+                return op.type == ysfx_match_star || msg < msg_end;
+            if (op.type == ysfx_match_plus)
+                ++msg;
+            if (op.lazy) {
+                while (msg < msg_end && (fails_at(index + 1, msg, msg_end, ignorecase) || !run(sink, index + 1, msg, msg_end, position, ignorecase)))
+                    ++msg;
+                return msg < msg_end;
+            }
+            else {
+                for (ptrdiff_t len = msg_end - msg; len >= 0; --len) {
+                    if (!fails_at(index + 1, msg + len, msg_end, ignorecase) && run(sink, index + 1, msg + len, msg_end, position, ignorecase))
+                        return true;
+                }
+                return false;
+            }
+
+        case ysfx_match_escape:
+            if (msg >= msg_end || *msg != op.ch)
+                return false;
+            ++index;
+            ++msg;
+            break;
+
+        case ysfx_match_byte:
+            {
+                EEL_F alt = 0;
+                EEL_F *var = sink.resolve(op, op.named ? -1 : position++, alt);
+                if (msg >= msg_end)
+                    return false;
+                if (var)
+                    sink.store_char(var, alt, msg);
+                ++index;
+                ++msg;
+            }
+            break;
+
+        case ysfx_match_value:
+            {
+                int len = 0;
+                const int avail = (int)(msg_end - msg);
+                auto is_digit = [msg, &len, avail]() -> bool {
+                    return len < avail && msg[len] >= '0' && msg[len] <= '9';
+                };
+                switch (op.ch) {
+                case 's':
+                    len = avail;
+                    break;
+                case 'x':
+                    while (len < avail && isxdigit((unsigned char)msg[len]))
+                        ++len;
+                    break;
+                case 'f':
+                    if (len < avail && msg[len] == '-')
+                        ++len;
+                    while (is_digit())
+                        ++len;
+                    if (len < avail && msg[len] == '.') {
+                        ++len;
+                        while (is_digit())
+                            ++len;
+                    }
+                    break;
+                default: // 'd', 'u', 'i'
+                    if (op.ch != 'u' && len < avail && msg[len] == '-')
+                        ++len;
+                    while (is_digit())
+                        ++len;
+                    break;
+                }
+
+                int min_length = op.min_length;
+                int max_length = op.max_length;
+                if (max_length > 0 && len > max_length)
+                    len = max_length;
+
+                if (!op.named)
+                    ++position;
+
+                if (op.lazy) {
+                    if (max_length < 1 || max_length > len)
+                        max_length = len;
+                    len = min_length;
+                    while (len <= max_length && (fails_at(index + 1, msg + len, msg_end, ignorecase) || !run(sink, index + 1, msg + len, msg_end, position, ignorecase)))
+                        ++len;
+                    if (len > max_length)
+                        return false;
+                }
+                else {
+                    while (len >= min_length && (fails_at(index + 1, msg + len, msg_end, ignorecase) || !run(sink, index + 1, msg + len, msg_end, position, ignorecase)))
+                        --len;
+                    if (len < min_length)
+                        return false;
+                }
+
+                EEL_F alt = 0;
+                EEL_F *var = sink.resolve(op, op.named ? -1 : position - 1, alt);
+                if (var)
+                    sink.store_value(op, var, alt, msg, len);
+                return true;
+            }
+
+        default:
+            return false;
+        }
+    }
+}
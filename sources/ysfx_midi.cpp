@@ -24,130 +24,574 @@ void ysfx_midi_reserve(ysfx_midi_buffer_t *midi, uint32_t capacity, bool extensi
     std::vector<uint8_t> data;
     data.reserve(capacity);
     std::swap(data, midi->data);
+    std::vector<ysfx_midi_index_entry_t> index;
+    index.reserve(capacity / ysfx_midi_header_min_size);
+    std::swap(index, midi->index);
+    std::vector<uint8_t> translated;
+    translated.reserve(capacity / 2);
+    std::swap(translated, midi->translated);
+    midi->pool.clear();
     midi->extensible = extensible;
     ysfx_midi_rewind(midi);
 }
 
+void ysfx_midi_reserve_pool(ysfx_midi_buffer_t *midi, uint32_t capacity)
+{
+    std::vector<uint8_t> pool;
+    pool.reserve(capacity);
+    std::swap(pool, midi->pool);
+    midi->has_pool = capacity > 0;
+    midi->data.clear();
+    ysfx_midi_rewind(midi);
+}
+
 void ysfx_midi_clear(ysfx_midi_buffer_t *midi)
 {
     midi->data.clear();
+    midi->pool.clear();
     ysfx_midi_rewind(midi);
 }
 
+void ysfx_midi_swap(ysfx_midi_buffer_t *a, ysfx_midi_buffer_t *b)
+{
+    std::swap(a->data, b->data);
+    std::swap(a->pool, b->pool);
+    std::swap(a->has_pool, b->has_pool);
+    std::swap(a->extensible, b->extensible);
+    std::swap(a->index, b->index);
+    ysfx_midi_rewind(a);
+    ysfx_midi_rewind(b);
+}
+
+void ysfx_midi_copy(ysfx_midi_buffer_t *dst, const ysfx_midi_buffer_t *src)
+{
+    dst->data.assign(src->data.begin(), src->data.end());
+    dst->pool.assign(src->pool.begin(), src->pool.end());
+    ysfx_midi_rewind(dst);
+}
+
+// encode the header, and return its size
+//   with `fixed`, the size takes 4 bytes whatever its value, so it can be patched later
+static uint32_t ysfx_midi_encode_header(const ysfx_midi_header_t &header, uint8_t *dst, bool fixed = false)
+{
+    uint32_t word = (header.bus & 0xf) |
+        ((header.bus & ysfx_midi_bus_pooled) ? 0x10 : 0) |
+        ((header.bus & ysfx_midi_bus_ump) ? 0x20 : 0) |
+        (std::min<uint32_t>(header.offset, ysfx_midi_offset_max) << 8);
+    memcpy(dst, &word, sizeof(word));
+
+    uint32_t length = sizeof(word);
+    uint32_t size = header.size;
+    if (fixed) {
+        for (uint32_t i = 0; i < 3; ++i, size >>= 7)
+            dst[length++] = (uint8_t)(size & 0x7f) | 0x80;
+        dst[length++] = (uint8_t)size;
+    }
+    else {
+        while (size >= 0x80) {
+            dst[length++] = (uint8_t)(size & 0x7f) | 0x80;
+            size >>= 7;
+        }
+        dst[length++] = (uint8_t)size;
+    }
+    return length;
+}
+
+// decode the header, and return its size
+static uint32_t ysfx_midi_decode_header(const uint8_t *src, ysfx_midi_header_t *header)
+{
+    uint32_t word;
+    memcpy(&word, src, sizeof(word));
+    header->bus = (word & 0xf) |
+        ((word & 0x10) ? ysfx_midi_bus_pooled : 0) |
+        ((word & 0x20) ? ysfx_midi_bus_ump : 0);
+    header->offset = word >> 8;
+
+    uint32_t length = sizeof(word);
+    uint8_t byte = src[length++];
+    uint32_t size = byte & 0x7f;
+    for (uint32_t shift = 7; byte & 0x80; shift += 7) {
+        byte = src[length++];
+        size |= (uint32_t)(byte & 0x7f) << shift;
+    }
+    header->size = size;
+    return length;
+}
+
+// the size of the payload in the data, for an event which has this header
+static size_t ysfx_midi_inline_size(const ysfx_midi_header_t &header)
+{
+    return (header.bus & ysfx_midi_bus_pooled) ? sizeof(uint32_t) : header.size;
+}
+
+// get the header at this position, and return the size of the event in the data
+static size_t ysfx_midi_header_at(const ysfx_midi_buffer_t *midi, size_t pos, ysfx_midi_header_t *header)
+{
+    assert(midi->data.size() - pos >= ysfx_midi_header_min_size);
+    size_t stride = ysfx_midi_decode_header(&midi->data[pos], header) + ysfx_midi_inline_size(*header);
+    assert(midi->data.size() - pos >= stride);
+    return stride;
+}
+
+// read the event whose header is at this position, and return its size in the data
+static size_t ysfx_midi_read_at(const ysfx_midi_buffer_t *midi, size_t pos, ysfx_midi_event_t *event)
+{
+    ysfx_midi_header_t header;
+    size_t stride = ysfx_midi_header_at(midi, pos, &header);
+    const uint8_t *payload = &midi->data[pos + stride - ysfx_midi_inline_size(header)];
+
+    event->bus = header.bus & ~ysfx_midi_bus_pooled;
+    event->offset = header.offset;
+    event->size = header.size;
+    if (header.bus & ysfx_midi_bus_pooled) {
+        uint32_t pool_pos;
+        memcpy(&pool_pos, payload, sizeof(pool_pos));
+        assert(midi->pool.size() - pool_pos >= header.size);
+        event->data = &midi->pool[pool_pos];
+    }
+    else
+        event->data = payload;
+    return stride;
+}
+
 bool ysfx_midi_push(ysfx_midi_buffer_t *midi, const ysfx_midi_event_t *event)
 {
     if (event->size > ysfx_midi_message_max_size)
         return false;
-    if (event->bus >= ysfx_max_midi_buses)
+    if ((event->bus & ~ysfx_midi_bus_ump) >= ysfx_max_midi_buses)
         return false;
 
     ysfx_midi_header_t header;
+    const bool pooled = midi->has_pool && event->size > ysfx_midi_pool_threshold;
+    header.bus = event->bus | (pooled ? ysfx_midi_bus_pooled : 0);
+    header.offset = event->offset;
+    header.size = event->size;
+
+    uint8_t head[ysfx_midi_header_max_size];
+    const uint32_t head_size = ysfx_midi_encode_header(header, head);
 
     if (!midi->extensible) {
         size_t writable = midi->data.capacity() - midi->data.size();
-        if (writable < sizeof(header) + event->size)
+        size_t pool_writable = midi->pool.capacity() - midi->pool.size();
+        if (writable < head_size + ysfx_midi_inline_size(header) || (pooled && pool_writable < event->size)) {
+            ++midi->overflow;
             return false;
+        }
     }
 
     const uint8_t *data = event->data;
-    const uint8_t *headp = (const uint8_t *)&header;
-    header.bus = event->bus;
-    header.offset = event->offset;
-    header.size = event->size;
-
-    midi->data.insert(midi->data.end(), headp, headp + sizeof(header));
-    midi->data.insert(midi->data.end(), data, data + header.size);
+    midi->data.insert(midi->data.end(), head, head + head_size);
+    if (pooled) {
+        uint32_t pool_pos = (uint32_t)midi->pool.size();
+        const uint8_t *posp = (const uint8_t *)&pool_pos;
+        midi->data.insert(midi->data.end(), posp, posp + sizeof(pool_pos));
+        midi->pool.insert(midi->pool.end(), data, data + header.size);
+    }
+    else
+        midi->data.insert(midi->data.end(), data, data + header.size);
     return true;
 }
 
+uint32_t ysfx_midi_push_batch(ysfx_midi_buffer_t *midi, const ysfx_midi_event_t *events, uint32_t count)
+{
+    uint32_t accepted = 0;
+    for (uint32_t i = 0; i < count; ++i)
+        accepted += ysfx_midi_push(midi, &events[i]);
+    return accepted;
+}
+
+void ysfx_midi_append(ysfx_midi_buffer_t *dst, const ysfx_midi_buffer_t *src)
+{
+    size_t pos = 0;
+    size_t size = src->data.size();
+    ysfx_midi_event_t event;
+
+    while (pos < size) {
+        pos += ysfx_midi_read_at(src, pos, &event);
+        ysfx_midi_push(dst, &event);
+    }
+}
+
 void ysfx_midi_rewind(ysfx_midi_buffer_t *midi)
 {
     midi->read_pos = 0;
-    for (uint32_t i = 0; i < ysfx_max_midi_buses; ++i)
-        midi->read_pos_for_bus[i] = 0;
+    midi->index.clear();
+    midi->indexed_size = 0;
+    midi->translated.clear();
+    midi->ump_done = 0;
+    for (uint32_t i = 0; i < ysfx_max_midi_buses; ++i) {
+        midi->first_on_bus[i] = ysfx_midi_no_entry;
+        midi->last_on_bus[i] = ysfx_midi_no_entry;
+        midi->read_entry_for_bus[i] = ysfx_midi_no_entry;
+        midi->ump_done_for_bus[i] = 0;
+    }
 }
 
-bool ysfx_midi_get_next(ysfx_midi_buffer_t *midi, ysfx_midi_event_t *event)
+// add the events appended since the last time to the per-bus index
+static void ysfx_midi_update_index(ysfx_midi_buffer_t *midi)
 {
-    size_t *pos_ptr = &midi->read_pos;
-    size_t pos = *pos_ptr;
-
-    size_t avail = midi->data.size() - pos;
+    size_t pos = midi->indexed_size;
+    size_t size = midi->data.size();
     ysfx_midi_header_t header;
-    if (avail == 0)
+
+    while (pos < size) {
+        size_t stride = ysfx_midi_header_at(midi, pos, &header);
+        uint32_t bus = header.bus & ~ysfx_midi_bus_flags;
+        assert(bus < ysfx_max_midi_buses);
+
+        uint32_t entry = (uint32_t)midi->index.size();
+        midi->index.push_back(ysfx_midi_index_entry_t{(uint32_t)pos, ysfx_midi_no_entry});
+        uint32_t last = midi->last_on_bus[bus];
+        if (last == ysfx_midi_no_entry)
+            midi->first_on_bus[bus] = entry;
+        else
+            midi->index[last].next = entry;
+        midi->last_on_bus[bus] = entry;
+
+        pos += stride;
+    }
+
+    midi->indexed_size = pos;
+}
+
+// translate the universal packet in the event to MIDI 1.0, or return false if it has no translation
+static bool ysfx_midi_translate_ump(ysfx_midi_buffer_t *midi, ysfx_midi_event_t *event)
+{
+    uint32_t words[4] = {};
+    memcpy(words, event->data, std::min<uint32_t>(event->size, sizeof(words)));
+
+    uint8_t bytes[8];
+    uint32_t size = ysfx_midi_ump_to_bytes(words, bytes);
+    if (size == 0)
         return false;
 
-    assert(avail >= sizeof(header));
-    memcpy(&header, &midi->data[pos], sizeof(header));
-    assert(avail >= sizeof(header) + header.size);
+    std::vector<uint8_t> &translated = midi->translated;
+    size_t pos = translated.size();
+    translated.insert(translated.end(), bytes, bytes + size);
 
-    event->bus = header.bus;
-    event->offset = header.offset;
-    event->size = header.size;
-    event->data = &midi->data[pos + sizeof(header)];
-    *pos_ptr = pos + (sizeof(header) + header.size);
+    event->bus &= ~ysfx_midi_bus_ump;
+    event->size = size;
+    event->data = &translated[pos];
+    return true;
+}
+
+bool ysfx_midi_get_next(ysfx_midi_buffer_t *midi, ysfx_midi_event_t *event)
+{
+    while (ysfx_midi_get_next_raw(midi, event)) {
+        if (!(event->bus & ysfx_midi_bus_ump) || ysfx_midi_translate_ump(midi, event))
+            return true;
+    }
+    return false;
+}
+
+bool ysfx_midi_get_next_raw(ysfx_midi_buffer_t *midi, ysfx_midi_event_t *event)
+{
+    size_t pos = midi->read_pos;
+    if (pos == midi->data.size())
+        return false;
+
+    midi->read_pos = pos + ysfx_midi_read_at(midi, pos, event);
     return true;
 }
 
+uint32_t ysfx_midi_get_next_batch(ysfx_midi_buffer_t *midi, ysfx_midi_event_t *events, uint32_t max)
+{
+    uint32_t count = 0;
+    while (count < max && ysfx_midi_get_next(midi, &events[count]))
+        ++count;
+    return count;
+}
+
+// get the entry of the next event on the bus, without consuming it
+static uint32_t ysfx_midi_peek_entry_on_bus(ysfx_midi_buffer_t *midi, uint32_t bus)
+{
+    if (midi->indexed_size < midi->data.size())
+        ysfx_midi_update_index(midi);
+
+    uint32_t entry = midi->read_entry_for_bus[bus];
+    return (entry == ysfx_midi_no_entry) ? midi->first_on_bus[bus] : midi->index[entry].next;
+}
+
 bool ysfx_midi_get_next_from_bus(ysfx_midi_buffer_t *midi, uint32_t bus, ysfx_midi_event_t *event)
 {
     if (bus >= ysfx_max_midi_buses)
         return false;
 
-    size_t *pos_ptr = &midi->read_pos_for_bus[bus];
-    size_t pos = *pos_ptr;
-    size_t avail = midi->data.size() - pos;
-    ysfx_midi_header_t header;
+    for (;;) {
+        uint32_t entry = ysfx_midi_peek_entry_on_bus(midi, bus);
+        if (entry == ysfx_midi_no_entry)
+            return false;
 
-    bool found = false;
-    while (!found && avail > 0) {
-        assert(avail >= sizeof(header));
-        memcpy(&header, &midi->data[pos], sizeof(header));
-        assert(avail >= sizeof(header) + header.size);
+        ysfx_midi_read_at(midi, midi->index[entry].pos, event);
+        assert((event->bus & ~ysfx_midi_bus_ump) == bus);
+        midi->read_entry_for_bus[bus] = entry;
+        midi->ump_done_for_bus[bus] = 0;
+
+        if (!(event->bus & ysfx_midi_bus_ump) || ysfx_midi_translate_ump(midi, event))
+            return true;
+    }
+}
 
-        found = header.bus == bus;
-        if (!found) {
-            pos += sizeof(header) + header.size;
-            avail -= sizeof(header) + header.size;
+bool ysfx_midi_push_ump(ysfx_midi_buffer_t *midi, const ysfx_ump_event_t *event)
+{
+    if (event->size == 0 || event->size != ysfx_ump_sizeof(event->data[0]))
+        return false;
+    if (event->bus >= ysfx_max_midi_buses)
+        return false;
+
+    ysfx_midi_event_t raw;
+    raw.bus = event->bus | ysfx_midi_bus_ump;
+    raw.offset = event->offset;
+    raw.size = event->size * sizeof(uint32_t);
+    raw.data = (const uint8_t *)event->data;
+    return ysfx_midi_push(midi, &raw);
+}
+
+// get the next packet of the event, and return whether the event is finished
+//   the output size is 0 if there is no packet for it
+static bool ysfx_midi_event_to_ump(const ysfx_midi_event_t *raw, uint32_t *done, ysfx_ump_event_t *event)
+{
+    event->bus = raw->bus & ~ysfx_midi_bus_ump;
+    event->offset = raw->offset;
+
+    if (raw->bus & ysfx_midi_bus_ump) {
+        event->size = raw->size / sizeof(uint32_t);
+        memcpy(event->data, raw->data, raw->size);
+        return true;
+    }
+
+    bool finished = true;
+    event->size = ysfx_midi_bytes_to_ump(raw->data, raw->size, done, &finished, event->data);
+    return finished;
+}
+
+bool ysfx_midi_get_next_ump(ysfx_midi_buffer_t *midi, ysfx_ump_event_t *event)
+{
+    for (;;) {
+        size_t pos = midi->read_pos;
+        if (pos == midi->data.size())
+            return false;
+
+        ysfx_midi_event_t raw;
+        size_t stride = ysfx_midi_read_at(midi, pos, &raw);
+        if (ysfx_midi_event_to_ump(&raw, &midi->ump_done, event)) {
+            midi->read_pos = pos + stride;
+            midi->ump_done = 0;
         }
+        if (event->size > 0)
+            return true;
     }
+}
 
-    if (!found) {
-        *pos_ptr = pos;
+bool ysfx_midi_get_next_ump_from_bus(ysfx_midi_buffer_t *midi, uint32_t bus, ysfx_ump_event_t *event)
+{
+    if (bus >= ysfx_max_midi_buses)
         return false;
+
+    for (;;) {
+        uint32_t entry = ysfx_midi_peek_entry_on_bus(midi, bus);
+        if (entry == ysfx_midi_no_entry)
+            return false;
+
+        ysfx_midi_event_t raw;
+        ysfx_midi_read_at(midi, midi->index[entry].pos, &raw);
+        if (ysfx_midi_event_to_ump(&raw, &midi->ump_done_for_bus[bus], event)) {
+            midi->read_entry_for_bus[bus] = entry;
+            midi->ump_done_for_bus[bus] = 0;
+        }
+        if (event->size > 0)
+            return true;
     }
+}
 
-    event->bus = header.bus;
-    event->offset = header.offset;
-    event->size = header.size;
-    event->data = &midi->data[pos + sizeof(header)];
-    *pos_ptr = pos + (sizeof(header) + header.size);
-    return true;
+void ysfx_midi_sort(ysfx_midi_buffer_t *midi)
+{
+    size_t pos = 0;
+    size_t size = midi->data.size();
+    ysfx_midi_header_t header;
+    bool sorted = true;
+
+    // the index is borrowed to hold the position and offset of each event
+    std::vector<ysfx_midi_index_entry_t> &events = midi->index;
+    events.clear();
+    uint32_t last_offset = 0;
+    while (pos < size) {
+        size_t stride = ysfx_midi_header_at(midi, pos, &header);
+        sorted = sorted && header.offset >= last_offset;
+        last_offset = header.offset;
+        events.push_back(ysfx_midi_index_entry_t{(uint32_t)pos, header.offset});
+        pos += stride;
+    }
+
+    if (!sorted) {
+        // positions are unique and increasing, which makes the sort stable
+        std::sort(events.begin(), events.end(), [](const ysfx_midi_index_entry_t &a, const ysfx_midi_index_entry_t &b) {
+            return a.next < b.next || (a.next == b.next && a.pos < b.pos);
+        });
+
+        std::vector<uint8_t> &scratch = midi->scratch;
+        scratch.clear();
+        scratch.reserve(midi->data.capacity());
+        for (const ysfx_midi_index_entry_t &event : events) {
+            const uint8_t *src = &midi->data[event.pos];
+            scratch.insert(scratch.end(), src, src + ysfx_midi_header_at(midi, event.pos, &header));
+        }
+        std::swap(scratch, midi->data);
+    }
+
+    ysfx_midi_rewind(midi);
+}
+
+// get the key and value of a controller event, or return false if the event is of another kind
+static bool ysfx_midi_dedup_key(const ysfx_midi_event_t &event, uint32_t *key, uint32_t *value)
+{
+    if (event.bus & ysfx_midi_bus_ump)
+        return false;
+
+    const uint8_t *data = event.data;
+    uint8_t status = (event.size > 0) ? data[0] : 0;
+    switch (status & 0xf0) {
+    case 0xa0:
+    case 0xb0:
+        if (event.size != 3)
+            return false;
+        *key = (event.bus << 16) | (status << 8) | data[1];
+        *value = data[2];
+        return true;
+    case 0xd0:
+        if (event.size != 2)
+            return false;
+        *key = (event.bus << 16) | (status << 8);
+        *value = data[1];
+        return true;
+    case 0xe0:
+        if (event.size != 3)
+            return false;
+        *key = (event.bus << 16) | (status << 8);
+        *value = data[1] | (data[2] << 7);
+        return true;
+    default:
+        return false;
+    }
+}
+
+void ysfx_midi_deduplicate(ysfx_midi_buffer_t *midi, uint32_t min_interval)
+{
+    size_t pos = 0;
+    size_t size = midi->data.size();
+    ysfx_midi_event_t event;
+
+    std::vector<ysfx_midi_dedup_entry_t> &entries = midi->dedup;
+    entries.clear();
+    while (pos < size) {
+        size_t stride = ysfx_midi_read_at(midi, pos, &event);
+        uint32_t key, value;
+        if (ysfx_midi_dedup_key(event, &key, &value))
+            entries.push_back(ysfx_midi_dedup_entry_t{key, (uint32_t)pos, event.offset, value, true});
+        pos += stride;
+    }
+
+    // group the events by key, each group in the order of the data
+    std::sort(entries.begin(), entries.end(), [](const ysfx_midi_dedup_entry_t &a, const ysfx_midi_dedup_entry_t &b) {
+        return a.key < b.key || (a.key == b.key && a.pos < b.pos);
+    });
+
+    bool removed = false;
+    for (size_t i = 0, n = entries.size(); i < n; ) {
+        const ysfx_midi_dedup_entry_t *kept = &entries[i];
+        size_t j = i + 1;
+        for (; j < n && entries[j].key == kept->key; ++j) {
+            ysfx_midi_dedup_entry_t &entry = entries[j];
+            bool last = j + 1 == n || entries[j + 1].key != entry.key;
+            bool early = min_interval > 0 && entry.offset - kept->offset < min_interval;
+            entry.keep = entry.value != kept->value && (last || !early);
+            if (entry.keep)
+                kept = &entry;
+            else
+                removed = true;
+        }
+        i = j;
+    }
+
+    if (removed) {
+        std::sort(entries.begin(), entries.end(), [](const ysfx_midi_dedup_entry_t &a, const ysfx_midi_dedup_entry_t &b) {
+            return a.pos < b.pos;
+        });
+
+        std::vector<uint8_t> &scratch = midi->scratch;
+        scratch.clear();
+        scratch.reserve(midi->data.capacity());
+        ysfx_midi_header_t header;
+        size_t e = 0;
+        for (pos = 0; pos < size; ) {
+            size_t stride = ysfx_midi_header_at(midi, pos, &header);
+            bool keep = true;
+            if (e < entries.size() && entries[e].pos == pos)
+                keep = entries[e++].keep;
+            if (keep) {
+                const uint8_t *src = &midi->data[pos];
+                scratch.insert(scratch.end(), src, src + stride);
+            }
+            pos += stride;
+        }
+        std::swap(scratch, midi->data);
+    }
+
+    ysfx_midi_rewind(midi);
+}
+
+void ysfx_midi_scale_offsets(ysfx_midi_buffer_t *midi, uint32_t num, uint32_t den)
+{
+    size_t pos = 0;
+    size_t size = midi->data.size();
+    ysfx_midi_header_t header;
+
+    while (pos < size) {
+        uint8_t *word = &midi->data[pos];
+        pos += ysfx_midi_header_at(midi, pos, &header);
+        // the offset is in the first word, which is rewritten in place
+        uint64_t offset = (uint64_t)header.offset * num / den;
+        header.offset = (uint32_t)std::min<uint64_t>(offset, ysfx_midi_offset_max);
+        uint8_t head[ysfx_midi_header_max_size];
+        ysfx_midi_encode_header(header, head);
+        memcpy(word, head, sizeof(uint32_t));
+    }
 }
 
 bool ysfx_midi_push_begin(ysfx_midi_buffer_t *midi, uint32_t bus, uint32_t offset, ysfx_midi_push_t *mp)
 {
     ysfx_midi_header_t header;
 
+    // the size is not known yet, so the payload goes into the pool if there is one
     mp->midi = midi;
     mp->start = midi->data.size();
     mp->count = 0;
     mp->eob = false;
+    mp->pooled = midi->has_pool;
+    mp->pool_start = midi->pool.size();
+
+    header.bus = bus | (mp->pooled ? ysfx_midi_bus_pooled : 0);
+    header.offset = offset;
+    header.size = 0;
+
+    uint8_t head[ysfx_midi_header_max_size];
+    const uint32_t head_size = ysfx_midi_encode_header(header, head, true);
 
     if (!midi->extensible) {
         size_t writable = midi->data.capacity() - midi->data.size();
-        if (writable < sizeof(header)) {
+        if (writable < head_size + ysfx_midi_inline_size(header)) {
+            ++midi->overflow;
             mp->eob = true;
             return false;
         }
     }
 
-    header.bus = bus;
-    header.offset = offset;
-    header.size = 0;
-
-    const uint8_t *headp = (const uint8_t *)&header;
-    midi->data.insert(midi->data.end(), headp, headp + sizeof(header));
+    midi->data.insert(midi->data.end(), head, head + head_size);
+    if (mp->pooled) {
+        uint32_t pool_pos = (uint32_t)mp->pool_start;
+        const uint8_t *posp = (const uint8_t *)&pool_pos;
+        midi->data.insert(midi->data.end(), posp, posp + sizeof(pool_pos));
+    }
 
     return true;
 }
@@ -163,16 +607,18 @@ bool ysfx_midi_push_data(ysfx_midi_push_t *mp, const uint8_t *data, uint32_t siz
     }
 
     ysfx_midi_buffer_t *midi = mp->midi;
+    std::vector<uint8_t> &dst = mp->pooled ? midi->pool : midi->data;
 
     if (!midi->extensible) {
-        size_t writable = midi->data.capacity() - midi->data.size();
+        size_t writable = dst.capacity() - dst.size();
         if (writable < size) {
+            ++midi->overflow;
             mp->eob = true;
             return false;
         }
     }
 
-    midi->data.insert(midi->data.end(), data, data + size);
+    dst.insert(dst.end(), data, data + size);
     mp->count += size;
     return true;
 }
@@ -181,17 +627,54 @@ bool ysfx_midi_push_end(ysfx_midi_push_t *mp)
 {
     if (mp->eob) {
         mp->midi->data.resize(mp->start);
+        mp->midi->pool.resize(mp->pool_start);
         return false;
     }
 
     ysfx_midi_header_t header;
     uint8_t *headp = &mp->midi->data[mp->start];
-    memcpy(&header, headp, sizeof(header));
+    ysfx_midi_decode_header(headp, &header);
     header.size = mp->count;
-    memcpy(headp, &header, sizeof(header));
+    ysfx_midi_encode_header(header, headp, true);
     return true;
 }
 
+//------------------------------------------------------------------------------
+void ysfx_midi_queue_reserve(ysfx_midi_queue_t *queue, uint32_t capacity)
+{
+    queue->events.reserve(capacity);
+}
+
+bool ysfx_midi_queue_post(ysfx_midi_queue_t *queue, const ysfx_midi_event_t *event)
+{
+    if (queue->events.capacity() == 0 || event->size > ysfx_midi_queue_message_max_size)
+        return false;
+
+    ysfx_midi_queue_event_t copy;
+    copy.bus = event->bus;
+    copy.offset = event->offset;
+    copy.size = event->size;
+    memcpy(copy.data, event->data, event->size);
+    if (!queue->events.push(copy)) {
+        queue->overflow.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+void ysfx_midi_queue_drain(ysfx_midi_queue_t *queue, ysfx_midi_buffer_t *midi)
+{
+    ysfx_midi_queue_event_t copy;
+    while (queue->events.pop(copy)) {
+        ysfx_midi_event_t event;
+        event.bus = copy.bus;
+        event.offset = copy.offset;
+        event.size = copy.size;
+        event.data = copy.data;
+        ysfx_midi_push(midi, &event);
+    }
+}
+
 //------------------------------------------------------------------------------
 uint32_t ysfx_midi_sizeof(uint8_t id)
 {
@@ -212,3 +695,126 @@ uint32_t ysfx_midi_sizeof(uint8_t id)
         return sizetable[id & 0b1111];
     }
 }
+
+uint32_t ysfx_ump_sizeof(uint32_t word)
+{
+    static const uint8_t sizetable[16] = {
+        1, 1, 1, 2, 2, 4, 1, 1,
+        2, 2, 2, 3, 3, 4, 4, 4,
+    };
+    return sizetable[word >> 28];
+}
+
+uint32_t ysfx_midi_ump_to_bytes(const uint32_t *words, uint8_t *bytes)
+{
+    const uint32_t w0 = words[0];
+    const uint32_t w1 = words[1];
+
+    switch (w0 >> 28) {
+    case 0x1: // system
+    case 0x2: { // MIDI 1.0 channel voice
+        uint8_t status = (uint8_t)(w0 >> 16);
+        uint32_t size = ysfx_midi_sizeof(status);
+        if (size == 0 || (status == 0xf0 || status == 0xf7))
+            return 0;
+        bytes[0] = status;
+        bytes[1] = (uint8_t)((w0 >> 8) & 0x7f);
+        bytes[2] = (uint8_t)(w0 & 0x7f);
+        return size;
+    }
+    case 0x3: { // 7-bit SysEx
+        uint32_t status = (w0 >> 20) & 0xf;
+        uint32_t count = std::min<uint32_t>((w0 >> 16) & 0xf, 6);
+        const uint8_t payload[6] = {
+            (uint8_t)(w0 >> 8), (uint8_t)w0,
+            (uint8_t)(w1 >> 24), (uint8_t)(w1 >> 16), (uint8_t)(w1 >> 8), (uint8_t)w1,
+        };
+        uint32_t size = 0;
+        if (status == 0 || status == 1)
+            bytes[size++] = 0xf0;
+        for (uint32_t i = 0; i < count; ++i)
+            bytes[size++] = payload[i] & 0x7f;
+        if (status == 0 || status == 3)
+            bytes[size++] = 0xf7;
+        return size;
+    }
+    case 0x4: { // MIDI 2.0 channel voice, scaled down to 7 bits
+        uint8_t opcode = (uint8_t)((w0 >> 20) & 0xf);
+        uint8_t channel = (uint8_t)((w0 >> 16) & 0xf);
+        uint8_t index = (uint8_t)((w0 >> 8) & 0x7f);
+        uint8_t value = (uint8_t)(w1 >> 25);
+        bytes[0] = (uint8_t)((opcode << 4) | channel);
+        switch (opcode) {
+        case 0x9:
+            // a note-on does not become a note-off
+            if (value == 0)
+                value = 1;
+            // fall through
+        case 0x8:
+        case 0xa:
+        case 0xb:
+            bytes[1] = index;
+            bytes[2] = value;
+            return 3;
+        case 0xc:
+            bytes[1] = (uint8_t)((w1 >> 24) & 0x7f);
+            return 2;
+        case 0xd:
+            bytes[1] = value;
+            return 2;
+        case 0xe: {
+            uint32_t bend = w1 >> 18;
+            bytes[1] = (uint8_t)(bend & 0x7f);
+            bytes[2] = (uint8_t)(bend >> 7);
+            return 3;
+        }
+        default:
+            return 0;
+        }
+    }
+    default:
+        return 0;
+    }
+}
+
+uint32_t ysfx_midi_bytes_to_ump(const uint8_t *data, uint32_t size, uint32_t *done, bool *finished, uint32_t *words)
+{
+    *finished = true;
+    if (size == 0)
+        return 0;
+
+    uint8_t status = data[0];
+
+    if (status == 0xf0) {
+        const uint8_t *payload = data + 1;
+        uint32_t total = size - 1;
+        if (total > 0 && payload[total - 1] == 0xf7)
+            --total;
+
+        uint32_t start = *done;
+        uint32_t count = std::min<uint32_t>(total - start, 6);
+        bool first = start == 0;
+        bool last = start + count == total;
+        uint32_t sysex_status = (first && last) ? 0 : first ? 1 : last ? 3 : 2;
+
+        uint8_t bytes[6] = {};
+        for (uint32_t i = 0; i < count; ++i)
+            bytes[i] = payload[start + i] & 0x7f;
+        words[0] = (0x3u << 28) | (sysex_status << 20) | (count << 16) | ((uint32_t)bytes[0] << 8) | bytes[1];
+        words[1] = ((uint32_t)bytes[2] << 24) | ((uint32_t)bytes[3] << 16) | ((uint32_t)bytes[4] << 8) | bytes[5];
+
+        *done = start + count;
+        *finished = last;
+        return 2;
+    }
+
+    uint32_t length = ysfx_midi_sizeof(status);
+    if (length == 0 || status == 0xf7 || size < length)
+        return 0;
+
+    uint32_t type = (status < 0xf0) ? 0x2 : 0x1;
+    uint32_t data1 = (length > 1) ? (data[1] & 0x7f) : 0;
+    uint32_t data2 = (length > 2) ? (data[2] & 0x7f) : 0;
+    words[0] = (type << 28) | ((uint32_t)status << 16) | (data1 << 8) | data2;
+    return 1;
+}
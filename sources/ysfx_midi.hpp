@@ -17,27 +17,94 @@
 
 #pragma once
 #include "ysfx.h"
+#include "utility/bounded_queue.hpp"
 #include <vector>
 #include <memory>
+#include <atomic>
+#include <algorithm>
 
+// the header of an event, as decoded
+//   in the data, it is a word which packs the bus, its flags, and the offset,
+//   followed by the size as an unsigned LEB128, so it takes 5 bytes usually
 struct ysfx_midi_header_t {
     uint32_t bus;
     uint32_t offset;
     uint32_t size;
 };
 
+enum {
+    ysfx_midi_message_max_size = 1 << 24,
+    // events larger than this go into the SysEx pool, if the buffer has one
+    ysfx_midi_pool_threshold = 16,
+    // the range of the encoded header
+    ysfx_midi_header_min_size = 5,
+    ysfx_midi_header_max_size = 8,
+    // the offset is stored in 24 bits, and saturates
+    ysfx_midi_offset_max = (1 << 24) - 1,
+    // the largest message which can be posted into a queue
+    ysfx_midi_queue_message_max_size = 16,
+};
+
+enum : uint32_t {
+    ysfx_midi_no_entry = ~(uint32_t)0,
+    // flag of the header bus, if the payload is in the pool
+    //   the data which follows the header is then the position in the pool
+    ysfx_midi_bus_pooled = (uint32_t)1 << 31,
+    // flag of the header bus, if the payload is a MIDI 2.0 universal packet
+    ysfx_midi_bus_ump = (uint32_t)1 << 30,
+    ysfx_midi_bus_flags = ysfx_midi_bus_pooled|ysfx_midi_bus_ump,
+};
+
+// an event of the per-bus index, linked to the next event on the same bus
+struct ysfx_midi_index_entry_t {
+    uint32_t pos;
+    uint32_t next;
+};
+
+// a controller event considered for deduplication, keyed by bus, status, and controller number
+struct ysfx_midi_dedup_entry_t {
+    uint32_t key;
+    uint32_t pos;
+    uint32_t offset;
+    uint32_t value;
+    bool keep;
+};
+
 struct ysfx_midi_buffer_t {
+    ysfx_midi_buffer_t()
+    {
+        std::fill_n(first_on_bus, ysfx_max_midi_buses, ysfx_midi_no_entry);
+        std::fill_n(last_on_bus, ysfx_max_midi_buses, ysfx_midi_no_entry);
+        std::fill_n(read_entry_for_bus, ysfx_max_midi_buses, ysfx_midi_no_entry);
+    }
+
     std::vector<uint8_t> data;
     size_t read_pos = 0;
-    size_t read_pos_for_bus[ysfx_max_midi_buses] = {};
     bool extensible = false;
+    // payloads of large events, preallocated like the data
+    std::vector<uint8_t> pool;
+    bool has_pool = false;
+    // number of events which were dropped for lack of capacity
+    uint64_t overflow = 0;
+    // space to reorder the data into, if sorting is used
+    std::vector<uint8_t> scratch;
+    // the controller events, if deduplication is used
+    std::vector<ysfx_midi_dedup_entry_t> dedup;
+    // universal packets translated to MIDI 1.0, for the readers of bytes
+    std::vector<uint8_t> translated;
+    // bytes already translated to packets, of the event being read as packets
+    uint32_t ump_done = 0;
+    uint32_t ump_done_for_bus[ysfx_max_midi_buses] = {};
+    // per-bus index, built lazily up to `indexed_size` bytes of data
+    std::vector<ysfx_midi_index_entry_t> index;
+    size_t indexed_size = 0;
+    uint32_t first_on_bus[ysfx_max_midi_buses];
+    uint32_t last_on_bus[ysfx_max_midi_buses];
+    // entry of the last event read on the bus
+    uint32_t read_entry_for_bus[ysfx_max_midi_buses];
 };
 using ysfx_midi_buffer_u = std::unique_ptr<ysfx_midi_buffer_t>;
 
-enum {
-    ysfx_midi_message_max_size = 1 << 24,
-};
-
 // NOTE: regarding buses,
 //    The buffer keeps 2 kinds of read positions: global, and per-bus.
 //
@@ -46,13 +113,49 @@ enum {
 //
 //    The JSFX API `midi*` implementations should always use per-bus access:
 //    if `ext_midi_bus` is true, use the bus defined by `midi_bus`, otherwise 0.
+//
+//    The buffer carries both MIDI 1.0 messages and MIDI 2.0 universal packets,
+//    and each reading API translates the events of the other kind, skipping
+//    those which have no translation. A SysEx message is read as a sequence
+//    of 7-bit SysEx packets, and each of those is read as a part of a message.
+//
+//    Per-bus reading goes through an index which links the events of each bus,
+//    so it does not scan the events of other buses. The index follows events
+//    appended to the buffer, but if the data is modified in another way, the
+//    buffer must be rewound, which drops the index.
 
 void ysfx_midi_reserve(ysfx_midi_buffer_t *midi, uint32_t capacity, bool extensible);
+// reserve a pool for the payload of large events, or remove it if capacity is 0
+void ysfx_midi_reserve_pool(ysfx_midi_buffer_t *midi, uint32_t capacity);
 void ysfx_midi_clear(ysfx_midi_buffer_t *midi);
+// exchange the events of 2 buffers, along with their storage, and rewind them
+void ysfx_midi_swap(ysfx_midi_buffer_t *a, ysfx_midi_buffer_t *b);
+// replace the events of the buffer with a copy of another, and rewind it
+void ysfx_midi_copy(ysfx_midi_buffer_t *dst, const ysfx_midi_buffer_t *src);
+// append the events of another buffer
+void ysfx_midi_append(ysfx_midi_buffer_t *dst, const ysfx_midi_buffer_t *src);
 bool ysfx_midi_push(ysfx_midi_buffer_t *midi, const ysfx_midi_event_t *event);
+// push several events, and return the number of those accepted
+uint32_t ysfx_midi_push_batch(ysfx_midi_buffer_t *midi, const ysfx_midi_event_t *events, uint32_t count);
 void ysfx_midi_rewind(ysfx_midi_buffer_t *midi);
 bool ysfx_midi_get_next(ysfx_midi_buffer_t *midi, ysfx_midi_event_t *event);
+// get up to `max` next events, and return their number
+uint32_t ysfx_midi_get_next_batch(ysfx_midi_buffer_t *midi, ysfx_midi_event_t *events, uint32_t max);
 bool ysfx_midi_get_next_from_bus(ysfx_midi_buffer_t *midi, uint32_t bus, ysfx_midi_event_t *event);
+// get the next event as stored, universal packets having `ysfx_midi_bus_ump` in the bus
+//   this is for moving events between buffers, with `ysfx_midi_push`
+bool ysfx_midi_get_next_raw(ysfx_midi_buffer_t *midi, ysfx_midi_event_t *event);
+// the same API for universal packets
+bool ysfx_midi_push_ump(ysfx_midi_buffer_t *midi, const ysfx_ump_event_t *event);
+bool ysfx_midi_get_next_ump(ysfx_midi_buffer_t *midi, ysfx_ump_event_t *event);
+bool ysfx_midi_get_next_ump_from_bus(ysfx_midi_buffer_t *midi, uint32_t bus, ysfx_ump_event_t *event);
+// reorder the events by offset, keeping the order of events at the same offset
+void ysfx_midi_sort(ysfx_midi_buffer_t *midi);
+// remove the values of controllers, pitch bend, and aftertouch which repeat the previous on their channel and bus
+//   with a nonzero interval, also remove those closer than this after the previous, but keep the last of each
+void ysfx_midi_deduplicate(ysfx_midi_buffer_t *midi, uint32_t min_interval);
+// multiply the offsets of all events by num/den
+void ysfx_midi_scale_offsets(ysfx_midi_buffer_t *midi, uint32_t num, uint32_t den);
 
 // incremental writer into a midi buffer
 struct ysfx_midi_push_t {
@@ -60,6 +163,8 @@ struct ysfx_midi_push_t {
     size_t start = 0;
     uint32_t count = 0;
     bool eob = false;
+    bool pooled = false;
+    size_t pool_start = 0;
 };
 bool ysfx_midi_push_begin(ysfx_midi_buffer_t *midi, uint32_t bus, uint32_t offset, ysfx_midi_push_t *mp);
 bool ysfx_midi_push_data(ysfx_midi_push_t *mp, const uint8_t *data, uint32_t size);
@@ -67,6 +172,40 @@ bool ysfx_midi_push_end(ysfx_midi_push_t *mp);
 
 //------------------------------------------------------------------------------
 
+// an event of the queue, with a copy of its message
+struct ysfx_midi_queue_event_t {
+    uint32_t bus = 0;
+    uint32_t offset = 0;
+    uint32_t size = 0;
+    uint8_t data[ysfx_midi_queue_message_max_size] = {};
+};
+
+// queue of events, which any thread can post into without locking,
+// and which a single thread reads (the audio thread)
+struct ysfx_midi_queue_t {
+    ysfx::bounded_queue<ysfx_midi_queue_event_t> events;
+    // number of events which were dropped because the queue was full
+    std::atomic<uint64_t> overflow{0};
+};
+using ysfx_midi_queue_u = std::unique_ptr<ysfx_midi_queue_t>;
+
+// allocate the queue with at least the given number of slots, discarding its events, or remove it if capacity is 0
+//   this is not thread-safe with respect to the other queue functions
+void ysfx_midi_queue_reserve(ysfx_midi_queue_t *queue, uint32_t capacity);
+// post an event from any thread, and return false if it is too large or the queue is full
+bool ysfx_midi_queue_post(ysfx_midi_queue_t *queue, const ysfx_midi_event_t *event);
+// move the posted events into the buffer, from the reading thread
+void ysfx_midi_queue_drain(ysfx_midi_queue_t *queue, ysfx_midi_buffer_t *midi);
+
+//------------------------------------------------------------------------------
+
 // determine the length of a midi message according to its status byte
 // if length is dynamic, returns 0
 uint32_t ysfx_midi_sizeof(uint8_t id);
+
+// translate a universal packet to MIDI 1.0, and return the size, or 0 if it has no translation
+//   the output has space for 8 bytes
+uint32_t ysfx_midi_ump_to_bytes(const uint32_t *words, uint8_t *bytes);
+// translate a MIDI 1.0 message to a universal packet, and return the number of words, or 0 if it has no translation
+//   a SysEx message gives several packets: `done` counts the bytes translated so far, and `finished` is set after the last
+uint32_t ysfx_midi_bytes_to_ump(const uint8_t *data, uint32_t size, uint32_t *done, bool *finished, uint32_t *words);
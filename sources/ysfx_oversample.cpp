@@ -0,0 +1,203 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "ysfx_oversample.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// coefficients of the odd phase, normalized for unity gain at DC
+struct halfband_coefs {
+    enum { taps = ysfx_halfband_t::taps };
+    ysfx_real c[taps];
+
+    halfband_coefs()
+    {
+        const double pi = 3.14159265358979323846;
+        const double beta = 8.0; // Kaiser window
+
+        auto bessel_i0 = [](double x) -> double {
+            double sum = 1, term = 1;
+            for (int k = 1; k < 32; ++k) {
+                term *= (x / (2 * k)) * (x / (2 * k));
+                sum += term;
+            }
+            return sum;
+        };
+
+        // at the full rate, these are the odd points of a filter spanning [-taps, +taps]
+        double sum = 0;
+        for (int k = 0; k < taps; ++k) {
+            double x = k - (taps - 1) * 0.5;
+            double r = (2 * x) / taps;
+            double w = bessel_i0(beta * std::sqrt(1 - r * r)) / bessel_i0(beta);
+            c[k] = std::sin(pi * x) / (pi * x) * w;
+            sum += c[k];
+        }
+        for (int k = 0; k < taps; ++k)
+            c[k] /= sum;
+    }
+};
+
+const halfband_coefs coefs;
+
+// dot product of the coefficients, with the `taps` samples which end at `x`
+inline ysfx_real convolve(const ysfx_real *x)
+{
+    ysfx_real sum = 0;
+    for (int k = 0; k < ysfx_halfband_t::taps; ++k)
+        sum += coefs.c[k] * x[-k];
+    return sum;
+}
+
+inline void reserve_with_history(std::vector<ysfx_real> &buf, uint32_t count)
+{
+    if (buf.size() < ysfx_halfband_t::taps + (size_t)count)
+        buf.resize(ysfx_halfband_t::taps + (size_t)count);
+}
+
+inline void keep_history(std::vector<ysfx_real> &buf, uint32_t count)
+{
+    std::copy_n(&buf[count], (size_t)ysfx_halfband_t::taps, &buf[0]);
+}
+
+} // namespace
+
+void ysfx_halfband_t::clear()
+{
+    std::fill(m_up.begin(), m_up.end(), 0);
+    std::fill(m_down_even.begin(), m_down_even.end(), 0);
+    std::fill(m_down_odd.begin(), m_down_odd.end(), 0);
+}
+
+void ysfx_halfband_t::reserve(uint32_t max_count)
+{
+    reserve_with_history(m_up, max_count);
+    reserve_with_history(m_down_even, max_count);
+    reserve_with_history(m_down_odd, max_count);
+}
+
+void ysfx_halfband_t::upsample(const ysfx_real *in, ysfx_real *out, uint32_t count)
+{
+    reserve_with_history(m_up, count);
+    ysfx_real *x = &m_up[taps];
+    std::copy_n(in, count, x);
+
+    for (uint32_t n = 0; n < count; ++n) {
+        out[2 * n] = x[(int)n - taps / 2];
+        out[2 * n + 1] = convolve(&x[n]);
+    }
+
+    keep_history(m_up, count);
+}
+
+void ysfx_halfband_t::downsample(const ysfx_real *in, ysfx_real *out, uint32_t count)
+{
+    reserve_with_history(m_down_even, count);
+    reserve_with_history(m_down_odd, count);
+    ysfx_real *even = &m_down_even[taps];
+    ysfx_real *odd = &m_down_odd[taps];
+    for (uint32_t n = 0; n < count; ++n) {
+        even[n] = in[2 * n];
+        odd[n] = in[2 * n + 1];
+    }
+
+    for (uint32_t n = 0; n < count; ++n)
+        out[n] = (ysfx_real)0.5 * (even[(int)n - taps / 2 + 1] + convolve(&odd[n]));
+
+    keep_history(m_down_even, count);
+    keep_history(m_down_odd, count);
+}
+
+//------------------------------------------------------------------------------
+
+void ysfx_oversampler_t::setup(uint32_t factor, uint32_t max_frames)
+{
+    uint32_t num_stages = 0;
+    while ((2u << num_stages) <= factor)
+        ++num_stages;
+
+    m_factor = 1u << num_stages;
+    m_stages.resize(num_stages);
+    for (uint32_t i = 0; i < num_stages; ++i)
+        m_stages[i].reserve(max_frames << i);
+    for (std::vector<ysfx_real> &temp : m_temp) {
+        if (temp.size() < (size_t)max_frames * m_factor)
+            temp.resize((size_t)max_frames * m_factor);
+    }
+
+    clear();
+}
+
+void ysfx_oversampler_t::clear()
+{
+    for (ysfx_halfband_t &stage : m_stages)
+        stage.clear();
+}
+
+void ysfx_oversampler_t::upsample(const ysfx_real *in, ysfx_real *out, uint32_t count)
+{
+    const size_t num_stages = m_stages.size();
+    if (num_stages == 0) {
+        std::copy_n(in, count, out);
+        return;
+    }
+
+    for (std::vector<ysfx_real> &temp : m_temp) {
+        if (temp.size() < (size_t)count * m_factor)
+            temp.resize((size_t)count * m_factor);
+    }
+
+    // ping-pong between temporary buffers, and end into the output
+    const ysfx_real *src = in;
+    for (size_t i = 0; i < num_stages; ++i) {
+        ysfx_real *dst = (i + 1 == num_stages) ? out : m_temp[i & 1].data();
+        m_stages[i].upsample(src, dst, count << i);
+        src = dst;
+    }
+}
+
+void ysfx_oversampler_t::downsample(const ysfx_real *in, ysfx_real *out, uint32_t count)
+{
+    const size_t num_stages = m_stages.size();
+    if (num_stages == 0) {
+        std::copy_n(in, count, out);
+        return;
+    }
+
+    for (std::vector<ysfx_real> &temp : m_temp) {
+        if (temp.size() < (size_t)count * m_factor)
+            temp.resize((size_t)count * m_factor);
+    }
+
+    // the stages which upsampled last are the first to downsample
+    const ysfx_real *src = in;
+    for (size_t i = num_stages; i-- > 0; ) {
+        ysfx_real *dst = (i == 0) ? out : m_temp[i & 1].data();
+        m_stages[i].downsample(src, dst, count << i);
+        src = dst;
+    }
+}
+
+ysfx_real ysfx_oversampler_t::latency() const
+{
+    ysfx_real latency = 0;
+    for (size_t i = 0; i < m_stages.size(); ++i)
+        latency += (ysfx_real)ysfx_halfband_t::round_trip_latency / (ysfx_real)(1u << i);
+    return latency;
+}
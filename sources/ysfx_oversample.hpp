@@ -0,0 +1,67 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+#include "ysfx.h"
+#include <vector>
+#include <memory>
+
+// 2x polyphase half-band FIR, for interpolation or decimation
+//    The even phase of the half-band filter is a pure delay, so only the
+//    odd phase needs computing: it's a windowed sinc, evaluated halfway
+//    between the samples.
+struct ysfx_halfband_t {
+    enum { taps = 16 };
+
+    void clear();
+    void reserve(uint32_t max_count);
+
+    // produce 2*count samples from count samples
+    void upsample(const ysfx_real *in, ysfx_real *out, uint32_t count);
+    // produce count samples from 2*count samples
+    void downsample(const ysfx_real *in, ysfx_real *out, uint32_t count);
+
+    // delay of upsampling then downsampling, in samples of the lower rate
+    static constexpr uint32_t round_trip_latency = taps - 1;
+
+private:
+    // the inputs, preceded by the history of previous inputs
+    std::vector<ysfx_real> m_up;
+    std::vector<ysfx_real> m_down_even;
+    std::vector<ysfx_real> m_down_odd;
+};
+
+// oversampler of a single channel, as a cascade of 2x stages
+struct ysfx_oversampler_t {
+    // set the factor, which is a power of 2
+    void setup(uint32_t factor, uint32_t max_frames);
+    void clear();
+    uint32_t factor() const { return m_factor; }
+
+    // produce factor*count samples from count samples
+    void upsample(const ysfx_real *in, ysfx_real *out, uint32_t count);
+    // produce count samples from factor*count samples
+    void downsample(const ysfx_real *in, ysfx_real *out, uint32_t count);
+
+    // delay of upsampling then downsampling, in samples of the base rate
+    ysfx_real latency() const;
+
+private:
+    uint32_t m_factor = 1;
+    std::vector<ysfx_halfband_t> m_stages;
+    std::vector<ysfx_real> m_temp[2];
+};
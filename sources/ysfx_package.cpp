@@ -0,0 +1,538 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "ysfx_package.hpp"
+#include "ysfx_parse.hpp"
+#include "ysfx_reader.hpp"
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstring>
+#include <map>
+#include <mutex>
+
+#if defined(__GNUC__)
+#   pragma GCC diagnostic push
+#   pragma GCC diagnostic ignored "-Wunused-function"
+#endif
+
+#define STB_IMAGE_IMPLEMENTATION
+#define STB_IMAGE_STATIC
+#define STBI_ONLY_ZLIB
+#define STBI_SUPPORT_ZLIB
+#define STBI_NO_STDIO
+#include "stb_image.h"
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#define STB_IMAGE_WRITE_STATIC
+#define STBI_WRITE_NO_STDIO
+#include "stb_image_write.h"
+
+#if defined(__GNUC__)
+#   pragma GCC diagnostic pop
+#endif
+
+// The package starts with a preamble, which locates the index at the end.
+// The numbers are in little endian, and the strings are prefixed by their
+// 32-bit size.
+//
+//   preamble: magic[8] version:u32 count:u32 index_offset:u64 index_size:u64
+//   index:    main:str header:str {name:str offset:u64 stored_size:u64 size:u64 method:u32}[count]
+
+static const char ysfx_package_magic[8] = {'Y', 'S', 'F', 'X', 'P', 'K', 'G', '\0'};
+static constexpr uint32_t ysfx_package_version = 1;
+static constexpr size_t ysfx_package_preamble_size = 32;
+static const char ysfx_package_suffix[] = ".ysfxpkg";
+
+namespace {
+
+struct package_reader {
+    const uint8_t *pos = nullptr;
+    const uint8_t *end = nullptr;
+    bool ok = true;
+
+    uint32_t u32()
+    {
+        if (!ok || end - pos < 4) {
+            ok = false;
+            return 0;
+        }
+        uint32_t value = ysfx::unpack_u32le(pos);
+        pos += 4;
+        return value;
+    }
+
+    uint64_t u64()
+    {
+        if (!ok || end - pos < 8) {
+            ok = false;
+            return 0;
+        }
+        uint64_t value = ysfx::unpack_u64le(pos);
+        pos += 8;
+        return value;
+    }
+
+    std::string str()
+    {
+        uint32_t size = u32();
+        if (!ok || (size_t)(end - pos) < size) {
+            ok = false;
+            return std::string();
+        }
+        std::string value((const char *)pos, size);
+        pos += size;
+        return value;
+    }
+};
+
+struct package_writer {
+    std::vector<uint8_t> data;
+
+    void u32(uint32_t value)
+    {
+        uint8_t bytes[4];
+        ysfx::pack_u32le(value, bytes);
+        data.insert(data.end(), bytes, bytes + 4);
+    }
+
+    void u64(uint64_t value)
+    {
+        uint8_t bytes[8];
+        ysfx::pack_u64le(value, bytes);
+        data.insert(data.end(), bytes, bytes + 8);
+    }
+
+    void str(const std::string &value)
+    {
+        u32((uint32_t)value.size());
+        data.insert(data.end(), value.begin(), value.end());
+    }
+};
+
+} // namespace
+
+// the name of an entry in lower case, with '/' as separator
+static std::string ysfx_package_key(const std::string &name)
+{
+    std::string key = name;
+    for (char &c : key)
+        c = ysfx::is_path_separator(c) ? '/' : ysfx::ascii_tolower(c);
+    return key;
+}
+
+// the name of a directory as a prefix of keys, which is empty for the root
+static std::string ysfx_package_dir_key(const std::string &dir)
+{
+    std::string key = ysfx_package_key(dir);
+    if (!key.empty() && key.back() != '/')
+        key.push_back('/');
+    return key;
+}
+
+bool ysfx_package_t::open(const char *path_)
+{
+    if (!map.open(path_))
+        return false;
+
+    const uint8_t *data = map.data();
+    const size_t size = map.size();
+    if (size < ysfx_package_preamble_size || memcmp(data, ysfx_package_magic, sizeof(ysfx_package_magic)) != 0)
+        return false;
+    if (ysfx::unpack_u32le(data + 8) != ysfx_package_version)
+        return false;
+
+    const uint32_t count = ysfx::unpack_u32le(data + 12);
+    const uint64_t index_offset = ysfx::unpack_u64le(data + 16);
+    const uint64_t index_size = ysfx::unpack_u64le(data + 24);
+    if (index_offset > size || index_size > size - index_offset)
+        return false;
+
+    package_reader reader{data + index_offset, data + index_offset + index_size};
+    main = reader.str();
+    header = reader.str();
+
+    entries.reserve(std::min<uint64_t>(count, index_size / 32));
+    for (uint32_t i = 0; i < count && reader.ok; ++i) {
+        ysfx_package_entry_t entry;
+        entry.name = reader.str();
+        entry.key = ysfx_package_key(entry.name);
+        entry.offset = reader.u64();
+        entry.stored_size = reader.u64();
+        entry.size = reader.u64();
+        entry.method = reader.u32();
+        if (entry.offset > size || entry.stored_size > size - entry.offset)
+            return false;
+        if (entry.method == ysfx_package_stored && entry.size != entry.stored_size)
+            return false;
+        entries.push_back(std::move(entry));
+    }
+    if (!reader.ok)
+        return false;
+
+    std::sort(entries.begin(), entries.end(),
+              [](const ysfx_package_entry_t &a, const ysfx_package_entry_t &b) { return a.key < b.key; });
+
+    path.assign(path_);
+    ysfx::get_file_uid(path_, uid);
+    ysfx::get_file_stamp(path_, stamp);
+    return true;
+}
+
+const ysfx_package_entry_t *ysfx_package_t::find(const std::string &name) const
+{
+    const std::string key = ysfx_package_key(name);
+    auto it = std::lower_bound(
+        entries.begin(), entries.end(), key,
+        [](const ysfx_package_entry_t &entry, const std::string &key) { return entry.key < key; });
+    if (it == entries.end() || it->key != key)
+        return nullptr;
+    return &*it;
+}
+
+const ysfx_package_entry_t *ysfx_package_t::search(const std::string &dir, const std::string &fragment) const
+{
+    const std::string prefix = ysfx_package_dir_key(dir);
+    const std::string suffix = ysfx_package_key(fragment);
+
+    const ysfx_package_entry_t *best = nullptr;
+    size_t best_depth = ~(size_t)0;
+
+    auto it = std::lower_bound(
+        entries.begin(), entries.end(), prefix,
+        [](const ysfx_package_entry_t &entry, const std::string &key) { return entry.key < key; });
+    for (; it != entries.end() && it->key.compare(0, prefix.size(), prefix) == 0; ++it) {
+        const std::string &key = it->key;
+        const size_t rest = key.size() - prefix.size();
+        if (rest < suffix.size() || key.compare(key.size() - suffix.size(), suffix.size(), suffix) != 0)
+            continue;
+        // the fragment matches whole components
+        if (rest > suffix.size() && key[key.size() - suffix.size() - 1] != '/')
+            continue;
+        size_t depth = (size_t)std::count(key.begin() + prefix.size(), key.end(), '/');
+        if (depth < best_depth) {
+            best = &*it;
+            best_depth = depth;
+        }
+    }
+
+    return best;
+}
+
+bool ysfx_package_t::has_directory(const std::string &dir) const
+{
+    const std::string prefix = ysfx_package_dir_key(dir);
+    auto it = std::lower_bound(
+        entries.begin(), entries.end(), prefix,
+        [](const ysfx_package_entry_t &entry, const std::string &key) { return entry.key < key; });
+    return it != entries.end() && it->key.compare(0, prefix.size(), prefix) == 0;
+}
+
+ysfx::string_list ysfx_package_t::list_directory(const std::string &dir) const
+{
+    const std::string prefix = ysfx_package_dir_key(dir);
+    ysfx::string_list list;
+
+    auto it = std::lower_bound(
+        entries.begin(), entries.end(), prefix,
+        [](const ysfx_package_entry_t &entry, const std::string &key) { return entry.key < key; });
+    for (; it != entries.end() && it->key.compare(0, prefix.size(), prefix) == 0; ++it) {
+        size_t slash = it->key.find('/', prefix.size());
+        std::string element = it->name.substr(prefix.size(), (slash == std::string::npos) ? std::string::npos : (slash + 1 - prefix.size()));
+        // the entries of a subdirectory are consecutive
+        if (list.empty() || ysfx_package_key(list.back()) != ysfx_package_key(element))
+            list.push_back(std::move(element));
+    }
+
+    return list;
+}
+
+//------------------------------------------------------------------------------
+
+bool ysfx_package_split(const std::string &path, std::string &package, std::string &entry)
+{
+    const size_t suffix_size = sizeof(ysfx_package_suffix) - 1;
+
+    for (size_t end = suffix_size; end <= path.size(); ++end) {
+        if (end < path.size() && !ysfx::is_path_separator(path[end]))
+            continue;
+        bool match = true;
+        for (size_t i = 0; i < suffix_size && match; ++i)
+            match = ysfx::ascii_tolower(path[end - suffix_size + i]) == ysfx_package_suffix[i];
+        if (!match)
+            continue;
+        package = path.substr(0, end);
+        entry = (end < path.size()) ? path.substr(end + 1) : std::string();
+        return true;
+    }
+
+    return false;
+}
+
+namespace {
+
+struct package_registry {
+    std::mutex mutex;
+    std::map<std::string, ysfx_package_sp> packages;
+};
+
+package_registry &get_package_registry()
+{
+    static package_registry registry;
+    return registry;
+}
+
+} // namespace
+
+ysfx_package_sp ysfx_package_find(const std::string &path, std::string *entry)
+{
+    std::string package_path;
+    std::string name;
+    if (!ysfx_package_split(path, package_path, name))
+        return nullptr;
+
+    ysfx::file_stamp stamp;
+    if (!ysfx::get_file_stamp(package_path.c_str(), stamp))
+        return nullptr;
+
+    if (entry)
+        *entry = std::move(name);
+
+    package_registry &registry = get_package_registry();
+    {
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        auto it = registry.packages.find(package_path);
+        if (it != registry.packages.end() && it->second->stamp == stamp)
+            return it->second;
+    }
+
+    // open without the lock; a package which was replaced on disk is opened again,
+    //   and the previous version is released with the last user
+    std::shared_ptr<ysfx_package_t> package{new ysfx_package_t};
+    if (!package->open(package_path.c_str()))
+        return nullptr;
+
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    ysfx_package_sp &slot = registry.packages[package_path];
+    if (!slot || slot->stamp != package->stamp)
+        slot = std::move(package);
+    return slot;
+}
+
+ysfx_package_data_sp ysfx_package_read(const std::string &path)
+{
+    std::string name;
+    ysfx_package_sp package = ysfx_package_find(path, &name);
+    if (!package)
+        return nullptr;
+    const ysfx_package_entry_t *entry = package->find(name);
+    if (!entry)
+        return nullptr;
+
+    std::shared_ptr<ysfx_package_data_t> contents{new ysfx_package_data_t};
+    const uint8_t *stored = package->map.data() + entry->offset;
+
+    switch (entry->method) {
+    case ysfx_package_stored:
+        contents->data = stored;
+        contents->size = (size_t)entry->size;
+        break;
+    case ysfx_package_deflated:
+        if (entry->size > INT_MAX || entry->stored_size > INT_MAX)
+            return nullptr;
+        contents->inflated.resize((size_t)entry->size);
+        if (stbi_zlib_decode_buffer((char *)contents->inflated.data(), (int)entry->size, (const char *)stored, (int)entry->stored_size) != (int)entry->size)
+            return nullptr;
+        contents->data = contents->inflated.data();
+        contents->size = contents->inflated.size();
+        break;
+    default:
+        return nullptr;
+    }
+
+    contents->package = std::move(package);
+    contents->entry = entry;
+    return contents;
+}
+
+bool ysfx_package_map_file(const std::string &path, ysfx::mapped_file &map)
+{
+    ysfx_package_data_sp contents = ysfx_package_read(path);
+    // an empty file does not map, like one on disk
+    if (!contents || contents->size == 0)
+        return false;
+    const uint8_t *data = contents->data;
+    size_t size = contents->size;
+    map.view(std::move(contents), data, size);
+    return true;
+}
+
+bool ysfx_package_get_file_stamp(const std::string &path, ysfx::file_stamp &stamp)
+{
+    std::string name;
+    std::string package_path;
+    if (!ysfx_package_split(path, package_path, name))
+        return ysfx::get_file_stamp(path.c_str(), stamp);
+
+    ysfx_package_sp package = ysfx_package_find(path);
+    if (!package || !(name.empty() || package->find(name) || package->has_directory(name)))
+        return false;
+    stamp = package->stamp;
+    return true;
+}
+
+bool ysfx_package_exists(const std::string &path)
+{
+    std::string name;
+    std::string package_path;
+    if (!ysfx_package_split(path, package_path, name))
+        return ysfx::exists(path.c_str());
+
+    ysfx_package_sp package = ysfx_package_find(path);
+    return package && package->find(name);
+}
+
+//------------------------------------------------------------------------------
+
+static bool ysfx_package_read_file(const std::string &path, std::vector<uint8_t> &data)
+{
+    ysfx::FILE_u stream{ysfx::fopen_utf8(path.c_str(), "rb")};
+    if (!stream)
+        return false;
+    data.clear();
+    uint8_t buf[8192];
+    size_t count;
+    while ((count = fread(buf, 1, sizeof(buf), stream.get())) > 0)
+        data.insert(data.end(), buf, buf + count);
+    return !ferror(stream.get());
+}
+
+// list the files below the directory, by their names relative to the root
+static void ysfx_package_list_files(const std::string &root, const std::string &dir, ysfx::string_list &names)
+{
+    for (const std::string &element : ysfx::list_directory((root + dir).c_str())) {
+        if (element.empty() || element == "./" || element == "../")
+            continue;
+        if (ysfx::is_path_separator(element.back()))
+            ysfx_package_list_files(root, dir + element.substr(0, element.size() - 1) + '/', names);
+        else
+            names.push_back(dir + element);
+    }
+}
+
+bool ysfx_package_create(const char *package_path, const char *directory, const char *main_file, bool compress)
+{
+    const std::string root = ysfx::path_ensure_final_separator(directory);
+
+    ysfx::string_list names;
+    ysfx_package_list_files(root, std::string(), names);
+
+    // the package does not contain itself, if it's written in the directory
+    ysfx::file_uid package_uid;
+    if (ysfx::get_file_uid(package_path, package_uid)) {
+        names.erase(std::remove_if(names.begin(), names.end(), [&](const std::string &name) {
+            ysfx::file_uid uid;
+            return ysfx::get_file_uid((root + name).c_str(), uid) && uid == package_uid;
+        }), names.end());
+    }
+
+    std::string main = ysfx_package_key(main_file);
+    auto main_it = std::find_if(names.begin(), names.end(), [&main](const std::string &name) { return ysfx_package_key(name) == main; });
+    if (main_it == names.end())
+        return false;
+    main = *main_it;
+
+    package_writer writer;
+    writer.data.resize(ysfx_package_preamble_size);
+    package_writer index;
+    std::string header;
+
+    std::vector<uint8_t> contents;
+    for (const std::string &name : names) {
+        if (!ysfx_package_read_file(root + name, contents))
+            return false;
+
+        // the header of the effect, which scans it without reading the rest
+        if (name == main) {
+            std::string text((const char *)contents.data(), contents.size());
+            ysfx::string_text_reader reader(text.c_str());
+            ysfx_toplevel_t toplevel;
+            ysfx_parse_error error;
+            if (ysfx_parse_toplevel(reader, toplevel, &error, true) && toplevel.header)
+                header = toplevel.header->text;
+        }
+
+        const uint64_t offset = writer.data.size();
+        uint32_t method = ysfx_package_stored;
+        int compressed_size = 0;
+        unsigned char *compressed = nullptr;
+        if (compress && !contents.empty() && contents.size() <= INT_MAX)
+            compressed = stbi_zlib_compress(contents.data(), (int)contents.size(), &compressed_size, 8);
+        if (compressed && (size_t)compressed_size < contents.size()) {
+            method = ysfx_package_deflated;
+            writer.data.insert(writer.data.end(), compressed, compressed + compressed_size);
+        }
+        else
+            writer.data.insert(writer.data.end(), contents.begin(), contents.end());
+        STBIW_FREE(compressed);
+
+        index.str(name);
+        index.u64(offset);
+        index.u64(writer.data.size() - offset);
+        index.u64(contents.size());
+        index.u32(method);
+    }
+
+    package_writer head;
+    head.str(main);
+    head.str(header);
+
+    const uint64_t index_offset = writer.data.size();
+    writer.data.insert(writer.data.end(), head.data.begin(), head.data.end());
+    writer.data.insert(writer.data.end(), index.data.begin(), index.data.end());
+    const uint64_t index_size = writer.data.size() - index_offset;
+
+    uint8_t *preamble = writer.data.data();
+    memcpy(preamble, ysfx_package_magic, sizeof(ysfx_package_magic));
+    ysfx::pack_u32le(ysfx_package_version, preamble + 8);
+    ysfx::pack_u32le((uint32_t)names.size(), preamble + 12);
+    ysfx::pack_u64le(index_offset, preamble + 16);
+    ysfx::pack_u64le(index_size, preamble + 24);
+
+    // write a temporary, and move it in place, so readers never see a partial package
+    static std::atomic<uint32_t> counter{0};
+    const std::string temp_path = std::string(package_path) + ".tmp" + std::to_string(counter.fetch_add(1, std::memory_order_relaxed));
+    {
+        ysfx::FILE_u stream{ysfx::fopen_utf8(temp_path.c_str(), "wb")};
+        if (!stream)
+            return false;
+        bool written = fwrite(writer.data.data(), 1, writer.data.size(), stream.get()) == writer.data.size();
+        written = fflush(stream.get()) == 0 && written;
+        if (!written) {
+            stream.reset();
+            remove(temp_path.c_str());
+            return false;
+        }
+    }
+
+    if (!ysfx::rename_file(temp_path.c_str(), package_path)) {
+        remove(temp_path.c_str());
+        return false;
+    }
+
+    return true;
+}
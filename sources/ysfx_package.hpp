@@ -0,0 +1,88 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+#include "ysfx.h"
+#include "ysfx_utils.hpp"
+#include <string>
+#include <vector>
+#include <memory>
+
+// A package holds an effect with its imports and data in a single file, which
+// is mapped in memory and read in place. The path of the package stands for
+// the directory of its entries, so `dir/fx.ysfxpkg/data/a.wav` names the entry
+// `data/a.wav`. The names of the entries are looked up case-insensitively.
+// The packages are opened once, and shared by all the instances of the process.
+
+enum ysfx_package_method_t {
+    ysfx_package_stored = 0,
+    // zlib, as decoded by stb_image
+    ysfx_package_deflated = 1,
+};
+
+struct ysfx_package_entry_t {
+    std::string name;
+    // the name in lower case, by which the entries are sorted
+    std::string key;
+    uint64_t offset = 0;
+    uint64_t stored_size = 0;
+    uint64_t size = 0;
+    uint32_t method = ysfx_package_stored;
+};
+
+struct ysfx_package_t {
+    bool open(const char *path);
+    const ysfx_package_entry_t *find(const std::string &name) const;
+    // find the entry below a directory, at any depth, whose name ends with the fragment; the shallowest comes first
+    const ysfx_package_entry_t *search(const std::string &dir, const std::string &fragment) const;
+    bool has_directory(const std::string &dir) const;
+    // list the elements of a directory; directories are distinguished with a final '/'
+    ysfx::string_list list_directory(const std::string &dir) const;
+
+    std::string path;
+    ysfx::file_uid uid{};
+    ysfx::file_stamp stamp{};
+    ysfx::mapped_file map;
+    // the entry of the effect, and the text of its header, to scan it without reading the rest
+    std::string main;
+    std::string header;
+    std::vector<ysfx_package_entry_t> entries;
+};
+using ysfx_package_sp = std::shared_ptr<const ysfx_package_t>;
+
+// the contents of an entry, which keep its package open
+struct ysfx_package_data_t {
+    ysfx_package_sp package;
+    const ysfx_package_entry_t *entry = nullptr;
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+    std::vector<uint8_t> inflated;
+};
+using ysfx_package_data_sp = std::shared_ptr<const ysfx_package_data_t>;
+
+// split a path within a package into the path of the package and the name of the entry, which is empty for the package itself
+bool ysfx_package_split(const std::string &path, std::string &package, std::string &entry);
+// get the package which holds the path, or null if there is none
+ysfx_package_sp ysfx_package_find(const std::string &path, std::string *entry = nullptr);
+// read an entry of a package, given by its path
+ysfx_package_data_sp ysfx_package_read(const std::string &path);
+// map an entry of a package, given by its path, as if it were a file
+bool ysfx_package_map_file(const std::string &path, ysfx::mapped_file &map);
+// get the stamp of a file or a directory, on disk or in a package, whose stamp it takes then
+bool ysfx_package_get_file_stamp(const std::string &path, ysfx::file_stamp &stamp);
+// check whether a file exists, on disk or in a package
+bool ysfx_package_exists(const std::string &path);
@@ -70,6 +70,8 @@ bool ysfx_parse_toplevel(ysfx::text_reader &reader, ysfx_toplevel_t &toplevel, y
                 current = new_or_append(toplevel.sample, lineno);
             else if (tokens[0] == "@serialize")
                 current = new_or_append(toplevel.serialize, lineno);
+            else if (tokens[0] == "@midi")
+                current = new_or_append(toplevel.midi, lineno);
             else if (tokens[0] == "@gfx") {
                 current = new_or_append(toplevel.gfx, lineno);
                 long gfx_w = 0;
@@ -196,6 +198,19 @@ bool ysfx_config_item_is_valid(const ysfx_config_item& item) {
     return true;
 }
 
+// whether the name of a pin designates a sidechain or an auxiliary input,
+//   as "Sidechain L", "side-chain in", or "Aux R"
+static bool ysfx_pin_is_sidechain(const std::string &name)
+{
+    std::string lower{name};
+    std::transform(lower.begin(), lower.end(), lower.begin(), ysfx::ascii_tolower);
+    for (const char *word : {"sidechain", "side-chain", "side chain", "aux"}) {
+        if (lower.find(word) != std::string::npos)
+            return true;
+    }
+    return false;
+}
+
 bool ysfx_parse_header(ysfx_section_t *section, ysfx_header_t &header, ysfx_parse_error *error)
 {
     header = ysfx_header_t{};
@@ -293,6 +308,12 @@ bool ysfx_parse_header(ysfx_section_t *section, ysfx_header_t &header, ysfx_pars
                     if (gfx_hz > 0 && gfx_hz < 2000) {
                         header.options.gfx_hz = static_cast<uint32_t>(gfx_hz);
                     }
+                } else if (name == "const") {
+                    for (std::string &var : ysfx::split_strings_noempty(value.c_str(), [](char c) -> bool { return c == ','; })) {
+                        std::transform(var.begin(), var.end(), var.begin(), ysfx::ascii_tolower);
+                        if (std::find(header.options.constants.begin(), header.options.constants.end(), var) == header.options.constants.end())
+                            header.options.constants.push_back(std::move(var));
+                    }
                 }
             }
         }
@@ -302,7 +323,7 @@ bool ysfx_parse_header(ysfx_section_t *section, ysfx_header_t &header, ysfx_pars
             if (slider.id >= ysfx_max_sliders)
                 continue;
             slider.exists = true;
-            header.sliders[slider.id] = slider;
+            header.sliders.set(slider.id, slider);
         }
         else if (ysfx_parse_filename(linep, filename)) {
             if (filename.index != header.filenames.size())
@@ -313,6 +334,12 @@ bool ysfx_parse_header(ysfx_section_t *section, ysfx_header_t &header, ysfx_pars
         ++lineno;
     }
 
+    header.slider_indices.clear();
+    for (uint32_t i = 0; i < ysfx_max_sliders; ++i) {
+        if (header.sliders[i].exists)
+            header.slider_indices.push_back(i);
+    }
+
     //--------------------------------------------------------------------------
     // pass 2: comments
 
@@ -348,9 +375,35 @@ bool ysfx_parse_header(ysfx_section_t *section, ysfx_header_t &header, ysfx_pars
     if (header.out_pins.size() > ysfx_max_channels)
         header.out_pins.resize(ysfx_max_channels);
 
+    header.sidechain_pins.resize(header.in_pins.size());
+    for (size_t i = 0; i < header.in_pins.size(); ++i)
+        header.sidechain_pins[i] = ysfx_pin_is_sidechain(header.in_pins[i]);
+
     return true;
 }
 
+const ysfx_slider_t &ysfx_slider_table_t::operator[](uint32_t index) const
+{
+    static const ysfx_slider_t empty;
+    uint32_t slot = (index < ysfx_max_sliders) ? m_slots[index] : 0;
+    return slot ? m_items[slot - 1] : empty;
+}
+
+ysfx_slider_t *ysfx_slider_table_t::find(uint32_t index)
+{
+    uint32_t slot = (index < ysfx_max_sliders) ? m_slots[index] : 0;
+    return slot ? &m_items[slot - 1] : nullptr;
+}
+
+ysfx_slider_t &ysfx_slider_table_t::set(uint32_t index, const ysfx_slider_t &slider)
+{
+    if (ysfx_slider_t *existing = find(index))
+        return *existing = slider;
+    m_items.push_back(slider);
+    m_slots[index] = (uint16_t)m_items.size();
+    return m_items.back();
+}
+
 bool ysfx_parse_slider(const char *line, ysfx_slider_t &slider)
 {
     // NOTE this parser is intentionally very permissive,
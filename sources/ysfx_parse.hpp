@@ -54,6 +54,7 @@ struct ysfx_toplevel_t {
     ysfx_section_u sample;
     ysfx_section_u serialize;
     ysfx_section_u gfx;
+    ysfx_section_u midi;
     uint32_t gfx_w = 0;
     uint32_t gfx_h = 0;
 };
@@ -81,6 +82,22 @@ struct ysfx_slider_t {
     bool initially_visible = false;
 };
 
+// the sliders of a header, of which only those which exist are stored
+class ysfx_slider_table_t {
+public:
+    // get a slider by index; one which does not exist reads as empty
+    const ysfx_slider_t &operator[](uint32_t index) const;
+    // get a slider to modify, or null if it does not exist
+    ysfx_slider_t *find(uint32_t index);
+    // set a slider, replacing any which has the same index
+    ysfx_slider_t &set(uint32_t index, const ysfx_slider_t &slider);
+
+private:
+    std::vector<ysfx_slider_t> m_items;
+    // the position of each slider in the items, plus 1, or 0 if it does not exist
+    uint16_t m_slots[ysfx_max_sliders] = {};
+};
+
 struct ysfx_options_t {
     std::string gmem;
     uint32_t maxmem = 0;
@@ -88,6 +105,8 @@ struct ysfx_options_t {
     bool want_all_kb = false;
     bool no_meter = false;
     uint32_t gfx_hz = 30;
+    // the variables which do not change in @sample, in lower case
+    std::vector<std::string> constants;
 };
 
 struct ysfx_config_item {
@@ -106,9 +125,13 @@ struct ysfx_header_t {
     ysfx::string_list in_pins;
     ysfx::string_list out_pins;
     bool explicit_pins = false;
+    // the input pins which are named as a sidechain, one per pin
+    std::vector<bool> sidechain_pins;
     ysfx::string_list filenames;
     ysfx_options_t options;
-    ysfx_slider_t sliders[ysfx_max_sliders];
+    ysfx_slider_table_t sliders;
+    // the indices of the sliders which exist, in increasing order
+    std::vector<uint32_t> slider_indices;
     std::vector<ysfx_config_item> config_items;
 };
 
@@ -0,0 +1,148 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "ysfx_preload.hpp"
+#include "ysfx_package.hpp"
+#include "ysfx_utils.hpp"
+#include <algorithm>
+#include <cstring>
+
+std::string ysfx_preload_manifest_join(const std::vector<std::string> &paths)
+{
+    std::string manifest;
+    for (const std::string &path : paths) {
+        manifest.append(path);
+        manifest.push_back('\n');
+    }
+    return manifest;
+}
+
+std::vector<std::string> ysfx_preload_manifest_split(const char *manifest)
+{
+    std::vector<std::string> paths;
+    for (const char *pos = manifest; pos && *pos; ) {
+        const char *end = strchr(pos, '\n');
+        size_t length = end ? (size_t)(end - pos) : strlen(pos);
+        if (length > 0 && pos[length - 1] == '\r')
+            --length;
+        if (length > 0)
+            paths.emplace_back(pos, length);
+        pos += end ? (size_t)(end - pos) + 1 : length;
+    }
+    return paths;
+}
+
+ysfx_preloader_t::ysfx_preloader_t(uint32_t num_threads)
+    : m_num_threads(std::max(1u, num_threads))
+{
+}
+
+ysfx_preloader_t::~ysfx_preloader_t()
+{
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_quit = true;
+        m_queue.clear();
+    }
+    m_cond.notify_all();
+    for (std::thread &thread : m_threads)
+        thread.join();
+}
+
+void ysfx_preloader_t::request(const std::vector<std::string> &paths, settings_sp settings)
+{
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        for (const std::string &path : paths) {
+            bool queued = std::any_of(m_queue.begin(), m_queue.end(),
+                [&path](const request_t &req) -> bool { return req.path == path; });
+            if (!queued)
+                m_queue.push_back(request_t{path, settings});
+        }
+        // the threads start with the first files, and stay for the next
+        while (m_threads.size() < std::min<size_t>(m_num_threads, m_queue.size()))
+            m_threads.emplace_back([this]() { run(); });
+    }
+    m_cond.notify_all();
+}
+
+void ysfx_preloader_t::wait()
+{
+    std::unique_lock<std::mutex> lock{m_mutex};
+    m_cond.wait(lock, [this]() -> bool { return m_queue.empty() && m_busy == 0; });
+}
+
+void ysfx_preloader_t::run()
+{
+    std::unique_lock<std::mutex> lock{m_mutex};
+    for (;;) {
+        m_cond.wait(lock, [this]() -> bool { return m_quit || !m_queue.empty(); });
+        if (m_quit)
+            break;
+
+        request_t req = std::move(m_queue.front());
+        m_queue.pop_front();
+        ++m_busy;
+        lock.unlock();
+
+        load(req.path, *req.settings);
+
+        lock.lock();
+        --m_busy;
+        m_cond.notify_all();
+    }
+}
+
+void ysfx_preloader_t::load(const std::string &path, const settings_t &settings)
+{
+    for (const ysfx_audio_format_t &fmt : settings.audio_formats) {
+        if (fmt.can_handle(path.c_str())) {
+            // without a cache, the files are not kept decoded, only read
+            if (settings.audio_cache) {
+                ysfx_audio_cache_get(*settings.audio_cache, fmt, path.c_str());
+                return;
+            }
+            break;
+        }
+    }
+
+#if !defined(YSFX_NO_GFX)
+    static const char *const image_suffixes[] = {"png", "jpg", "jpeg", "bmp", "gif"};
+    for (const char *suffix : image_suffixes) {
+        if (ysfx::path_has_suffix(path.c_str(), suffix)) {
+            if (ysfx_image_sp image = ysfx_image_acquire(path.c_str())) {
+                std::lock_guard<std::mutex> lock{m_mutex};
+                m_images.push_back(std::move(image));
+                if (m_images.size() > image_capacity)
+                    m_images.pop_front();
+            }
+            return;
+        }
+    }
+#endif
+
+    // the entries of packages are in the mapping of their package already
+    if (ysfx_package_find(path))
+        return;
+
+    ysfx::FILE_u stream{ysfx::fopen_utf8(path.c_str(), "rb")};
+    if (!stream)
+        return;
+    char buffer[64 * 1024];
+    while (fread(buffer, 1, sizeof(buffer), stream.get()) == sizeof(buffer))
+        ;
+}
@@ -0,0 +1,78 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+#include "ysfx.h"
+#include "ysfx_audio_cache.hpp"
+#include "ysfx_image_cache.hpp"
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// the paths of the files which @init found, one per line
+std::string ysfx_preload_manifest_join(const std::vector<std::string> &paths);
+std::vector<std::string> ysfx_preload_manifest_split(const char *manifest);
+
+// decodes ahead the data files which the instances are about to open, on threads of its
+//   own, into the caches which they share: the audio files into the audio cache, and the
+//   images into the registry of images, where this keeps them until the instances take them;
+//   the other files are read through, so that the system has them in memory
+struct ysfx_preloader_t {
+    // the most images which stay decoded, the oldest being released first
+    enum { image_capacity = 64 };
+
+    // what the files decode with, as of the request
+    struct settings_t {
+        ysfx_audio_cache_sp audio_cache;
+        std::vector<ysfx_audio_format_t> audio_formats;
+    };
+    using settings_sp = std::shared_ptr<const settings_t>;
+
+    explicit ysfx_preloader_t(uint32_t num_threads);
+    // NOTE: this waits for the files which are in progress, if any
+    ~ysfx_preloader_t();
+
+    // queue the files, which are loaded in parallel
+    void request(const std::vector<std::string> &paths, settings_sp settings);
+    // wait until no file remains in the queue
+    void wait();
+
+private:
+    void run();
+    void load(const std::string &path, const settings_t &settings);
+
+    struct request_t {
+        std::string path;
+        settings_sp settings;
+    };
+
+    uint32_t m_num_threads = 0;
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    std::deque<request_t> m_queue;
+    uint32_t m_busy = 0;
+    bool m_quit = false;
+#if !defined(YSFX_NO_GFX)
+    // the latest is at the back
+    std::deque<ysfx_image_sp> m_images;
+#endif
+    std::vector<std::thread> m_threads;
+};
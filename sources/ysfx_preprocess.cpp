@@ -27,31 +27,36 @@
 #include "WDL/eel2/eel_pproc.h"
 
 
-bool ysfx_preprocess(ysfx::text_reader &reader, ysfx_parse_error *error, std::string& in_str, std::map<std::string, ysfx_real> preprocessor_values)
+bool ysfx_preprocess(ysfx::text_reader &reader, ysfx_parse_error *error, std::string& in_str, const std::map<std::string, ysfx_real> &preprocessor_values)
 {
-    std::string line;
-    line.reserve(256);
-
-    WDL_FastString file_str, pp_str;
+    // gather the lines, with their endings made uniform
+    const size_t start = in_str.size();
+    std::string_view line;
     while (reader.read_next_line(line)) {
-        line += "\n";
-        const char *linep = line.c_str();
-        file_str.Append(linep);
+        in_str.append(line);
+        in_str.push_back('\n');
     }
 
+    // text without any <? ?> block is unchanged, don't start the preprocessor
+    if (in_str.find("<?", start) == std::string::npos)
+        return true;
+
     EEL2_PreProcessor pproc;
 
     for (auto it = preprocessor_values.begin(); it != preprocessor_values.end(); ++it) {
         pproc.define(it->first.c_str(), it->second);
     }
 
-    const char *err = pproc.preprocess(file_str.Get(), &pp_str);
+    WDL_FastString pp_str;
+    const char *err = pproc.preprocess(in_str.c_str() + start, &pp_str);
     if (err) {
+        in_str.resize(start);
         error->line = 0;
         error->message = std::string("Invalid section: ") + err;
         return false;
     }
 
+    in_str.resize(start);
     in_str.append(pp_str.Get(), pp_str.GetLength());
     return true;
 }
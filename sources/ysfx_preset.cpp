@@ -26,6 +26,8 @@
 #include <cstring>
 #include <cmath>
 #include <algorithm>
+#include <memory>
+#include <mutex>
 
 #include <iomanip>
 #include <sstream>
@@ -33,125 +35,522 @@
 
 #include "WDL/lineparse.h"
 
-static ysfx_bank_t *ysfx_load_bank_from_rpl_text(const std::string &text);
+// the RPL preset format holds at most this many sliders
+enum { ysfx_rpl_max_sliders = 256 };
+
 static void ysfx_parse_preset_from_rpl_blob(ysfx_preset_t *preset, const char *name, const std::vector<uint8_t> &data);
 
-ysfx_bank_t *ysfx_load_bank(const char *path)
+// the RPL file which the presets of banks are decoded from
+struct ysfx_bank_source_t {
+    std::string path;
+    ysfx::file_stamp stamp;
+    // the contents of the file, unless the ranges are read from it
+    std::string text;
+    bool has_text = false;
+};
+
+struct ysfx_rpl_range_t {
+    uint64_t offset = 0;
+    uint64_t length = 0;
+};
+
+// a preset, which the banks that have it in common share
+struct ysfx_bank_entry_t {
+    ~ysfx_bank_entry_t();
+    char *name = nullptr;
+    char *blob_name = nullptr;
+    ysfx_state_t *state = nullptr;
+    // the source while the preset is still to be decoded from the range, or null
+    std::shared_ptr<ysfx_bank_source_t> source;
+    ysfx_rpl_range_t range;
+    std::mutex mutex;
+};
+
+using ysfx_bank_entry_sp = std::shared_ptr<ysfx_bank_entry_t>;
+
+struct ysfx_bank_index_s {
+    // the presets, which the array of the bank points into
+    std::vector<ysfx_bank_entry_sp> entries;
+};
+
+ysfx_bank_entry_t::~ysfx_bank_entry_t()
+{
+    delete[] name;
+    delete[] blob_name;
+    ysfx_state_free(state);
+}
+
+static ysfx_bank_entry_sp ysfx_bank_entry_new(const char *name, const char *blob_name, ysfx_state_t *state)
+{
+    ysfx_bank_entry_sp entry{new ysfx_bank_entry_t};
+    entry->name = ysfx::strdup_using_new(name);
+    entry->blob_name = blob_name ? ysfx::strdup_using_new(blob_name) : nullptr;
+    entry->state = state;
+    return entry;
+}
+
+// make a bank which has these presets
+static ysfx_bank_t *ysfx_bank_from_entries(const char *name, std::vector<ysfx_bank_entry_sp> entries)
+{
+    ysfx_bank_u bank{new ysfx_bank_t{}};
+    bank->name = ysfx::strdup_using_new(name);
+    bank->presets = new ysfx_preset_t[(uint32_t)entries.size()]{};
+    bank->preset_count = (uint32_t)entries.size();
+
+    for (uint32_t i = 0; i < bank->preset_count; ++i) {
+        ysfx_bank_entry_t &entry = *entries[i];
+        std::lock_guard<std::mutex> lock{entry.mutex};
+        ysfx_preset_t &preset = bank->presets[i];
+        preset.name = entry.name;
+        preset.blob_name = entry.blob_name;
+        preset.state = entry.state;
+    }
+
+    bank->index = new ysfx_bank_index_t;
+    bank->index->entries = std::move(entries);
+    return bank.release();
+}
+
+std::string escapeString(const char *in);
+
+// get the presets of a bank to share; a bank which the host put together has them copied
+static std::vector<ysfx_bank_entry_sp> ysfx_bank_entries(ysfx_bank_t *bank)
+{
+    if (bank->index)
+        return bank->index->entries;
+
+    std::vector<ysfx_bank_entry_sp> entries;
+    entries.reserve(bank->preset_count);
+    for (uint32_t i = 0; i < bank->preset_count; ++i) {
+        const ysfx_preset_t &preset = bank->presets[i];
+        std::string blob_name = preset.blob_name ? std::string{preset.blob_name} : escapeString(preset.name);
+        entries.push_back(ysfx_bank_entry_new(preset.name, blob_name.c_str(), ysfx_state_dup(preset.state)));
+    }
+    return entries;
+}
+
+static bool ysfx_rpl_is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// find the next token, which is either quoted, or goes until a space
+static bool ysfx_rpl_next_token(const char *text, size_t size, size_t &pos, size_t &start, size_t &end)
+{
+    while (pos < size && ysfx_rpl_is_space(text[pos]))
+        ++pos;
+    if (pos >= size)
+        return false;
+
+    char quote = text[pos];
+    if (quote == '"' || quote == '\'' || quote == '`') {
+        start = ++pos;
+        while (pos < size && text[pos] != quote)
+            ++pos;
+        end = pos;
+        if (pos < size)
+            ++pos;
+    }
+    else {
+        start = pos;
+        while (pos < size && !ysfx_rpl_is_space(text[pos]))
+            ++pos;
+        end = pos;
+    }
+    return true;
+}
+
+static bool ysfx_rpl_token_is(const char *text, size_t start, size_t end, const char *word)
 {
-#if defined(_WIN32)
-    std::wstring wpath = ysfx::widen(path);
-    ysfx::FILE_u stream{_wfopen(wpath.c_str(), L"rb")};
-#else
-    ysfx::FILE_u stream{fopen(path, "rb")};
-#endif
+    size_t len = strlen(word);
+    return end - start == len && memcmp(&text[start], word, len) == 0;
+}
 
+static bool ysfx_read_whole_file(const char *path, std::string &input)
+{
+    ysfx::FILE_u stream{ysfx::fopen_utf8(path, "rb")};
     if (!stream)
-        return nullptr;
+        return false;
 
-    std::string input;
-    constexpr uint32_t max_input = 1u << 24;
+    constexpr size_t max_input = 1u << 24;
+    input.clear();
     input.reserve(1u << 16);
 
-    for (int ch; input.size() < max_input && (ch = fgetc(stream.get())) != EOF; ) {
-        ch = (ch == '\r' || ch == '\n') ? ' ' : ch;
-        input.push_back((unsigned char)ch);
-    }
+    char buf[1u << 16];
+    for (size_t count; input.size() < max_input && (count = fread(buf, 1, std::min(sizeof(buf), max_input - input.size()), stream.get())) > 0; )
+        input.append(buf, count);
 
-    if (ferror(stream.get()))
+    return !ferror(stream.get());
+}
+
+// find the names of the presets and the ranges of their data, without decoding it
+static ysfx_bank_t *ysfx_scan_bank_from_rpl_text(const std::shared_ptr<ysfx_bank_source_t> &source)
+{
+    const char *text = source->text.data();
+    size_t size = source->text.size();
+    size_t pos = 0, start = 0, end = 0;
+
+    if (!ysfx_rpl_next_token(text, size, pos, start, end) || !ysfx_rpl_token_is(text, start, end, "<REAPER_PRESET_LIBRARY"))
         return nullptr;
 
-    stream.reset();
-    return ysfx_load_bank_from_rpl_text(input);
+    std::string bank_name;
+    if (ysfx_rpl_next_token(text, size, pos, start, end))
+        bank_name.assign(&text[start], end - start);
+
+    std::vector<ysfx_bank_entry_sp> entries;
+
+    while (ysfx_rpl_next_token(text, size, pos, start, end)) {
+        if (!ysfx_rpl_token_is(text, start, end, "<PRESET"))
+            continue;
+
+        std::string name;
+        if (ysfx_rpl_next_token(text, size, pos, start, end))
+            name.assign(&text[start], end - start);
+
+        ysfx_bank_entry_sp entry = ysfx_bank_entry_new(name.c_str(), nullptr, nullptr);
+        entry->source = source;
+        entry->range.offset = pos;
+        size_t body_end = pos;
+        while (ysfx_rpl_next_token(text, size, pos, start, end) && !ysfx_rpl_token_is(text, start, end, ">"))
+            body_end = end;
+        entry->range.length = body_end - entry->range.offset;
+
+        entries.push_back(std::move(entry));
+    }
+
+    return ysfx_bank_from_entries(bank_name.c_str(), std::move(entries));
 }
 
-static void ysfx_preset_clear(ysfx_preset_t *preset)
+//------------------------------------------------------------------------------
+// the sidecar index is text: a header, the stamp of the bank, its name, the
+//   number of presets, and a line for each with the range of its data and its name
+
+static const char ysfx_bank_index_header[] = "ysfx-rpl-index 1";
+
+static bool ysfx_save_bank_index(const char *index_path, ysfx_bank_t *bank, const ysfx_bank_source_t &source)
 {
-    if (!preset) return;
+    auto is_single_line = [](const char *str) -> bool { return !strchr(str, '\n') && !strchr(str, '\r'); };
+    if (!is_single_line(bank->name))
+        return false;
+    for (uint32_t i = 0; i < bank->preset_count; ++i) {
+        if (!is_single_line(bank->presets[i].name))
+            return false;
+    }
 
-    delete[] preset->name;
-    preset->name = nullptr;
+    std::string text;
+    text.append(ysfx_bank_index_header).push_back('\n');
+    text.append(std::to_string(source.stamp.first)).push_back(' ');
+    text.append(std::to_string(source.stamp.second)).push_back('\n');
+    text.append(bank->name).push_back('\n');
+    text.append(std::to_string(bank->preset_count)).push_back('\n');
+    for (uint32_t i = 0; i < bank->preset_count; ++i) {
+        const ysfx_rpl_range_t &range = bank->index->entries[i]->range;
+        text.append(std::to_string(range.offset)).push_back(' ');
+        text.append(std::to_string(range.length)).push_back(' ');
+        text.append(bank->presets[i].name).push_back('\n');
+    }
 
-    delete[] preset->blob_name;
-    preset->blob_name = nullptr;
+    ysfx::FILE_u stream{ysfx::fopen_utf8(index_path, "wb")};
+    if (!stream)
+        return false;
+    return fwrite(text.data(), 1, text.size(), stream.get()) == text.size() && fflush(stream.get()) == 0;
+}
 
-    ysfx_state_free(preset->state);
-    preset->state = nullptr;
+static ysfx_bank_t *ysfx_load_bank_from_index(const char *index_path, const std::shared_ptr<ysfx_bank_source_t> &source)
+{
+    std::string text;
+    if (!ysfx_read_whole_file(index_path, text))
+        return nullptr;
+
+    std::vector<std::string> lines;
+    for (size_t pos = 0, next; pos < text.size(); pos = next + 1) {
+        next = text.find('\n', pos);
+        if (next == std::string::npos)
+            next = text.size();
+        lines.emplace_back(text, pos, next - pos);
+    }
+    if (lines.size() < 4 || lines[0] != ysfx_bank_index_header)
+        return nullptr;
+
+    unsigned long long mtime = 0, fsize = 0;
+    if (sscanf(lines[1].c_str(), "%llu %llu", &mtime, &fsize) != 2)
+        return nullptr;
+    if (mtime != source->stamp.first || fsize != source->stamp.second)
+        return nullptr;
+
+    unsigned long count = strtoul(lines[3].c_str(), nullptr, 10);
+    if (count != lines.size() - 4)
+        return nullptr;
+
+    std::vector<ysfx_bank_entry_sp> entries;
+    entries.reserve(count);
+
+    for (uint32_t i = 0; i < count; ++i) {
+        const char *line = lines[4 + i].c_str();
+        unsigned long long offset = 0, length = 0;
+        int namepos = 0;
+        if (sscanf(line, "%llu %llu %n", &offset, &length, &namepos) != 2 || namepos == 0)
+            return nullptr;
+        if (offset + length > source->stamp.second)
+            return nullptr;
+        ysfx_bank_entry_sp entry = ysfx_bank_entry_new(line + namepos, nullptr, nullptr);
+        entry->source = source;
+        entry->range.offset = offset;
+        entry->range.length = length;
+        entries.push_back(std::move(entry));
+    }
+
+    return ysfx_bank_from_entries(lines[2].c_str(), std::move(entries));
 }
 
-void ysfx_bank_free(ysfx_bank_t *bank)
+//------------------------------------------------------------------------------
+// the binary bank is little-endian: the magic, the version, flags which are 0
+//   for now, the number of presets and the name of the bank; then for each
+//   preset, its names, its sliders as index and raw double, the high water of
+//   its memory, and its serialized data as is; strings are prefixed with sizes
+
+static const char ysfx_bank_binary_magic[8] = {'Y', 'S', 'F', 'X', 'B', 'A', 'N', 'K'};
+static constexpr uint32_t ysfx_bank_binary_version = 1;
+
+namespace {
+struct ysfx_binary_reader_t {
+    const uint8_t *data;
+    size_t size;
+    size_t pos = 0;
+
+    const uint8_t *take(size_t count)
+    {
+        if (count > size - pos)
+            return nullptr;
+        const uint8_t *p = &data[pos];
+        pos += count;
+        return p;
+    }
+    bool u32(uint32_t &value)
+    {
+        const uint8_t *p = take(4);
+        return p && ((value = ysfx::unpack_u32le(p)), true);
+    }
+    bool u64(uint64_t &value)
+    {
+        const uint8_t *p = take(8);
+        return p && ((value = ysfx::unpack_u64le(p)), true);
+    }
+    bool f64(double &value)
+    {
+        const uint8_t *p = take(8);
+        return p && ((value = ysfx::unpack_f64le(p)), true);
+    }
+    bool str(std::string &value)
+    {
+        uint32_t length;
+        const uint8_t *p;
+        if (!u32(length) || !(p = take(length)))
+            return false;
+        value.assign((const char *)p, length);
+        return true;
+    }
+};
+} // namespace
+
+static bool ysfx_is_bank_binary(const char *path)
 {
-    if (!bank)
-        return;
+    ysfx::FILE_u stream{ysfx::fopen_utf8(path, "rb")};
+    char magic[sizeof(ysfx_bank_binary_magic)];
+    return stream && fread(magic, 1, sizeof(magic), stream.get()) == sizeof(magic) &&
+        memcmp(magic, ysfx_bank_binary_magic, sizeof(magic)) == 0;
+}
 
-    delete[] bank->name;
+static ysfx_bank_t *ysfx_load_bank_binary(const char *path)
+{
+    std::vector<uint8_t> input;
+    {
+        ysfx::FILE_u stream{ysfx::fopen_utf8(path, "rb")};
+        if (!stream)
+            return nullptr;
+        uint8_t buf[1u << 16];
+        for (size_t count; (count = fread(buf, 1, sizeof(buf), stream.get())) > 0; )
+            input.insert(input.end(), buf, buf + count);
+        if (ferror(stream.get()))
+            return nullptr;
+    }
 
-    if (ysfx_preset_t *presets = bank->presets) {
-        uint32_t count = bank->preset_count;
-        for (uint32_t i = 0; i < count; ++i)
-            ysfx_preset_clear(&presets[i]);
-        delete[] presets;
+    ysfx_binary_reader_t reader{input.data(), input.size()};
+    const uint8_t *magic = reader.take(sizeof(ysfx_bank_binary_magic));
+    uint32_t version, flags, count;
+    std::string bank_name;
+    if (!magic || memcmp(magic, ysfx_bank_binary_magic, sizeof(ysfx_bank_binary_magic)) != 0 ||
+        !reader.u32(version) || version != ysfx_bank_binary_version ||
+        !reader.u32(flags) || flags != 0 || !reader.u32(count) || !reader.str(bank_name))
+        return nullptr;
+
+    std::vector<ysfx_bank_entry_sp> entries;
+    entries.reserve(std::min<size_t>(count, input.size()));
+
+    for (uint32_t i = 0; i < count; ++i) {
+        std::string name, blob_name;
+        uint32_t slider_count;
+        if (!reader.str(name) || !reader.str(blob_name) || !reader.u32(slider_count) ||
+            slider_count > (reader.size - reader.pos) / 12)
+            return nullptr;
+
+        ysfx_state_u state{new ysfx_state_t{}};
+        state->sliders = new ysfx_state_slider_t[slider_count];
+        state->slider_count = slider_count;
+        for (uint32_t j = 0; j < slider_count; ++j) {
+            double value;
+            if (!reader.u32(state->sliders[j].index) || !reader.f64(value))
+                return nullptr;
+            state->sliders[j].value = (ysfx_real)value;
+        }
+
+        uint64_t data_size;
+        const uint8_t *data;
+        if (!reader.u32(state->mem_high_water) || !reader.u64(data_size) ||
+            data_size > reader.size - reader.pos || !(data = reader.take((size_t)data_size)))
+            return nullptr;
+        state->data = new uint8_t[(size_t)data_size];
+        state->data_size = (size_t)data_size;
+        memcpy(state->data, data, (size_t)data_size);
+
+        entries.push_back(ysfx_bank_entry_new(name.c_str(), blob_name.c_str(), state.release()));
     }
 
-    delete bank;
+    return ysfx_bank_from_entries(bank_name.c_str(), std::move(entries));
 }
 
-static ysfx_bank_t *ysfx_load_bank_from_rpl_text(const std::string &text)
+ysfx_bank_t *ysfx_load_bank_index(const char *path, const char *index_path)
 {
-    LineParser parser;
-    if (parser.parse(text.c_str()) < 0)
+    // a binary bank loads whole, since reading it is as fast as an index
+    if (ysfx_is_bank_binary(path))
+        return ysfx_load_bank_binary(path);
+
+    std::shared_ptr<ysfx_bank_source_t> source{new ysfx_bank_source_t};
+    source->path.assign(path);
+    if (!ysfx::get_file_stamp(path, source->stamp))
         return nullptr;
 
-    ///
-    std::vector<ysfx_preset_t> preset_list;
-    preset_list.reserve(256);
+    if (index_path) {
+        if (ysfx_bank_t *bank = ysfx_load_bank_from_index(index_path, source))
+            return bank;
+    }
 
-    auto list_cleanup = ysfx::defer([&preset_list]() {
-        for (ysfx_preset_t &pst : preset_list)
-            ysfx_preset_clear(&pst);
-    });
+    if (!ysfx_read_whole_file(path, source->text))
+        return nullptr;
+    source->has_text = true;
 
-    ///
-    int ntok = parser.getnumtokens();
-    int itok = 0;
+    ysfx_bank_u bank{ysfx_scan_bank_from_rpl_text(source)};
+    if (bank && index_path)
+        ysfx_save_bank_index(index_path, bank.get(), *source);
+    return bank.release();
+}
 
-    if (strcmp("<REAPER_PRESET_LIBRARY", parser.gettoken_str(itok++)) != 0)
+ysfx_bank_t *ysfx_load_bank(const char *path)
+{
+    ysfx_bank_u bank{ysfx_load_bank_index(path, nullptr)};
+    if (!bank)
         return nullptr;
 
-    const char *bank_name = parser.gettoken_str(itok++);
+    // decode all now, which lets go of the source
+    for (uint32_t i = 0; i < bank->preset_count; ++i) {
+        if (!ysfx_bank_get_preset(bank.get(), i))
+            return nullptr;
+    }
+    return bank.release();
+}
 
-    while (itok < ntok) {
-        if (strcmp("<PRESET", parser.gettoken_str(itok++)) == 0) {
-            const char *preset_name = parser.gettoken_str(itok++);
+static bool ysfx_read_bank_range(const ysfx_bank_source_t &source, const ysfx_rpl_range_t &range, std::string &body)
+{
+    if (source.has_text) {
+        if (range.offset + range.length > source.text.size())
+            return false;
+        body.assign(&source.text[(size_t)range.offset], (size_t)range.length);
+        return true;
+    }
 
-            std::vector<uint8_t> blob;
-            blob.reserve(64 * 1024);
+    // the file must be the same which the index was made from
+    ysfx::FILE_u stream{ysfx::fopen_utf8(source.path.c_str(), "rb")};
+    ysfx::file_stamp stamp;
+    if (!stream || !ysfx::get_stream_file_stamp(stream.get(), stamp) || stamp != source.stamp)
+        return false;
+    if (fseek(stream.get(), (long)range.offset, SEEK_SET) != 0)
+        return false;
+    body.resize((size_t)range.length);
+    return fread(&body[0], 1, body.size(), stream.get()) == body.size();
+}
 
-            for (const char *part; itok < ntok &&
-                     strcmp(">", (part = parser.gettoken_str(itok++))) != 0; )
-            {
-                std::vector<uint8_t> blobChunk = ysfx::decode_base64(part);
-                blob.insert(blob.end(), blobChunk.begin(), blobChunk.end());
-            }
+ysfx_preset_t *ysfx_bank_get_preset(ysfx_bank_t *bank, uint32_t index)
+{
+    if (!bank || index >= bank->preset_count)
+        return nullptr;
+
+    ysfx_preset_t *preset = &bank->presets[index];
+    if (!bank->index)
+        return preset;
+
+    ysfx_bank_entry_t &entry = *bank->index->entries[index];
+    std::lock_guard<std::mutex> lock{entry.mutex};
 
-            preset_list.emplace_back();
-            ysfx_preset_t &preset = preset_list.back();
+    if (entry.source) {
+        std::string body;
+        if (!ysfx_read_bank_range(*entry.source, entry.range, body))
+            return nullptr;
 
-            ysfx_parse_preset_from_rpl_blob(&preset, preset_name, blob);
+        // the data is in base64, in parts which are separated by spaces
+        std::vector<uint8_t> blob;
+        size_t pos = 0, start = 0, end = 0;
+        while (ysfx_rpl_next_token(body.data(), body.size(), pos, start, end)) {
+            std::vector<uint8_t> blobChunk = ysfx::decode_base64(&body[start], end - start);
+            blob.insert(blob.end(), blobChunk.begin(), blobChunk.end());
         }
+
+        ysfx_preset_t decoded{};
+        ysfx_parse_preset_from_rpl_blob(&decoded, entry.name, blob);
+        delete[] decoded.name;
+        entry.blob_name = decoded.blob_name;
+        entry.state = decoded.state;
+        entry.source.reset();
     }
 
-    ///
-    ysfx_bank_u bank{new ysfx_bank_t{}};
-    bank->name = ysfx::strdup_using_new(bank_name);
-    bank->presets = new ysfx_preset_t[(uint32_t)preset_list.size()]{};
-    bank->preset_count = (uint32_t)preset_list.size();
+    // another bank which shares the preset may have decoded it
+    preset->blob_name = entry.blob_name;
+    preset->state = entry.state;
+    return preset;
+}
 
-    for (uint32_t i = (uint32_t)preset_list.size(); i-- > 0; ) {
-        bank->presets[i] = preset_list[i];
-        preset_list.pop_back();
+static void ysfx_preset_clear(ysfx_preset_t *preset)
+{
+    if (!preset) return;
+
+    delete[] preset->name;
+    preset->name = nullptr;
+
+    delete[] preset->blob_name;
+    preset->blob_name = nullptr;
+
+    ysfx_state_free(preset->state);
+    preset->state = nullptr;
+}
+
+void ysfx_bank_free(ysfx_bank_t *bank)
+{
+    if (!bank)
+        return;
+
+    delete[] bank->name;
+
+    if (ysfx_preset_t *presets = bank->presets) {
+        // the shared presets go with their last bank, and others with this one
+        if (!bank->index) {
+            uint32_t count = bank->preset_count;
+            for (uint32_t i = 0; i < count; ++i)
+                ysfx_preset_clear(&presets[i]);
+        }
+        delete[] presets;
     }
 
-    return bank.release();
+    delete bank->index;
+    delete bank;
 }
 
 static int hasFunkyCharacters(const char *in)
@@ -287,8 +686,9 @@ static void ysfx_parse_preset_from_rpl_blob(ysfx_preset_t *preset, const char *n
         }
 
         if (str[0] != '\0') {
-            // Grab the rest
-            for (uint32_t i = 0; i < ysfx_max_sliders - 64; ++i) {
+            // Grab the rest, as many as the format and the build both hold
+            const uint32_t num_sliders = std::min<uint32_t>(ysfx_rpl_max_sliders, ysfx_max_sliders);
+            for (uint32_t i = 0; i < num_sliders - 64; ++i) {
                 const char *str = parser.gettoken_str(i + 65);
                 bool skip = str[0] == '-' && str[1] == '\0';
                 if (!skip) {
@@ -328,91 +728,86 @@ uint32_t ysfx_preset_exists(ysfx_bank_t *bank, const char* preset_name)
     return found;
 }
 
-ysfx_bank_t *ysfx_create_empty_bank(const char* bank_name)
+uint32_t ysfx_bank_find_state(ysfx_bank_t *bank, ysfx_state_t *state)
 {
-    ysfx_bank_u bank{new ysfx_bank_t{}};
+    if (!bank || !state)
+        return 0;
+
+    ysfx_state_hash(state);
+
+    for (uint32_t i = 0; i < bank->preset_count; ++i) {
+        const ysfx_preset_t *preset = ysfx_bank_get_preset(bank, i);
+        if (!preset || !preset->state)
+            continue;
+
+        // the entries are shared by the banks, so their hashes are cached under their locks
+        bool equal;
+        if (bank->index) {
+            ysfx_bank_entry_t &entry = *bank->index->entries[i];
+            std::lock_guard<std::mutex> lock{entry.mutex};
+            ysfx_state_hash(preset->state);
+            equal = ysfx_is_state_equal(preset->state, state);
+        }
+        else {
+            ysfx_state_hash(preset->state);
+            equal = ysfx_is_state_equal(preset->state, state);
+        }
+        if (equal)
+            return i + 1;
+    }
 
-    bank->name = ysfx::strdup_using_new(bank_name);
-    bank->preset_count = 0;
-    return bank.release();
+    return 0;
+}
+
+ysfx_bank_t *ysfx_create_empty_bank(const char* bank_name)
+{
+    return ysfx_bank_from_entries(bank_name, {});
 }
 
 // Adds preset to a bank and returns new bank with extra preset. Note that the preset takes responsibility for the memory 
 // ysfx_state_t* is pointing to. This function returns a *new* bank and you are responsible for cleaning up the old bank.
+// The banks share the other presets, so the copy is only as large as the list.
 ysfx_bank_t *ysfx_add_preset_to_bank(ysfx_bank_t *bank_in, const char* preset_name, ysfx_state_t *state)
 {
-    ysfx_bank_u bank{new ysfx_bank_t{}};
-    bank->name = ysfx::strdup_using_new(bank_in->name);
+    std::vector<ysfx_bank_entry_sp> entries = ysfx_bank_entries(bank_in);
+    ysfx_bank_entry_sp entry = ysfx_bank_entry_new(preset_name, escapeString(preset_name).c_str(), state);
 
     uint32_t found = ysfx_preset_exists(bank_in, preset_name);
-    bank->preset_count = (uint32_t)(bank_in->preset_count);
-    if (found == 0) bank->preset_count += 1;
-
-    bank->presets = new ysfx_preset_t[(uint32_t)bank->preset_count]{};
-    for (uint32_t i=0; i < bank_in->preset_count; i++) {
-        if ((!found) || (i != (found - 1))) {
-            bank->presets[i].name = ysfx::strdup_using_new(bank_in->presets[i].name);
-            bank->presets[i].blob_name = ysfx::strdup_using_new(bank_in->presets[i].blob_name);
-            bank->presets[i].state = ysfx_state_dup(bank_in->presets[i].state);
-        }
-    }
-
-    uint32_t index = (found == 0) ? (bank->preset_count - 1) : (found - 1);
-    bank->presets[index].name = ysfx::strdup_using_new(preset_name);
-    bank->presets[index].blob_name = ysfx::strdup_using_new(escapeString(preset_name).c_str());
-    bank->presets[index].state = state;
+    if (found == 0)
+        entries.push_back(std::move(entry));
+    else
+        entries[found - 1] = std::move(entry);
 
-    return bank.release();
+    return ysfx_bank_from_entries(bank_in->name, std::move(entries));
 }
 
 // Deletes a preset from the bank. This function returns a *new* bank and you are responsible for cleaning up the old bank.
 ysfx_bank_t *ysfx_delete_preset_from_bank(ysfx_bank_t *bank_in, const char* preset_name)
 {
-    ysfx_bank_u bank{new ysfx_bank_t{}};
-    bank->name = ysfx::strdup_using_new(bank_in->name);
+    std::vector<ysfx_bank_entry_sp> entries = ysfx_bank_entries(bank_in);
 
     uint32_t found = ysfx_preset_exists(bank_in, preset_name);
-    bank->preset_count = (uint32_t)(bank_in->preset_count);
-    if (found > 0) bank->preset_count -= 1;
-
-    bank->presets = new ysfx_preset_t[(uint32_t)bank->preset_count]{};
-    uint32_t j = 0;
-    for (uint32_t i=0; i < bank_in->preset_count; i++) {
-        if (i != (found - 1)) {
-            bank->presets[j].name = ysfx::strdup_using_new(bank_in->presets[i].name);
-            bank->presets[j].blob_name = ysfx::strdup_using_new(bank_in->presets[i].blob_name);
-            bank->presets[j].state = ysfx_state_dup(bank_in->presets[i].state);
-            j += 1;
-        }
-    }
+    if (found > 0)
+        entries.erase(entries.begin() + (found - 1));
 
-    return bank.release();
+    return ysfx_bank_from_entries(bank_in->name, std::move(entries));
 }
 
 // Rename a preset from the bank. This function returns a *new* bank and you are responsible for cleaning up the old bank.
 ysfx_bank_t *ysfx_rename_preset_from_bank(ysfx_bank_t *bank_in, const char* preset_name, const char* new_preset_name)
 {
-    ysfx_bank_u bank{new ysfx_bank_t{}};
-    bank->name = ysfx::strdup_using_new(bank_in->name);
+    std::vector<ysfx_bank_entry_sp> entries = ysfx_bank_entries(bank_in);
 
     uint32_t found = ysfx_preset_exists(bank_in, preset_name);
-    bank->preset_count = (uint32_t)(bank_in->preset_count);
-
-    bank->presets = new ysfx_preset_t[(uint32_t)bank->preset_count]{};
-    uint32_t j = 0;
-    for (uint32_t i=0; i < bank_in->preset_count; i++) {
-        bank->presets[j].state = ysfx_state_dup(bank_in->presets[i].state);
-        if (i != (found - 1)) {
-            bank->presets[j].name = ysfx::strdup_using_new(bank_in->presets[i].name);
-            bank->presets[j].blob_name = ysfx::strdup_using_new(bank_in->presets[i].blob_name);
-        } else {
-            bank->presets[j].name = ysfx::strdup_using_new(new_preset_name);
-            bank->presets[j].blob_name = ysfx::strdup_using_new(new_preset_name);
-        }
-        j += 1;
+    if (found > 0) {
+        // the renamed preset gets its state decoded, so that its new name stays
+        const ysfx_preset_t *preset = ysfx_bank_get_preset(bank_in, found - 1);
+        if (!preset)
+            return nullptr;
+        entries[found - 1] = ysfx_bank_entry_new(new_preset_name, new_preset_name, ysfx_state_dup(preset->state));
     }
 
-    return bank.release();
+    return ysfx_bank_from_entries(bank_in->name, std::move(entries));
 }
 
 std::string double_string(double value) {
@@ -434,12 +829,15 @@ static std::string preset_blob(std::string blob_preset_name, ysfx_state_t *state
     std::string blob{""};
     blob.reserve(4096);
 
-    std::vector<ysfx_real> slider_values(ysfx_max_sliders, 0.0);
-    std::vector<int> slider_used(ysfx_max_sliders, 0);
+    std::vector<ysfx_real> slider_values(ysfx_rpl_max_sliders, 0.0);
+    std::vector<int> slider_used(ysfx_rpl_max_sliders, 0);
 
     bool more_than_64 = true;
     for (uint32_t i = 0; i < state->slider_count; i++) {
         uint32_t slider_index = state->sliders[i].index;
+        // the sliders which the format does not hold are left out
+        if (slider_index >= ysfx_rpl_max_sliders)
+            continue;
         slider_used[slider_index] = 1;
         slider_values[slider_index] = state->sliders[i].value;
 
@@ -460,7 +858,7 @@ static std::string preset_blob(std::string blob_preset_name, ysfx_state_t *state
 
     // Serialize the remaining 192 sliders
     if (more_than_64) {
-        for (uint32_t i = 0; i < 192; i++) {
+        for (uint32_t i = 0; i < ysfx_rpl_max_sliders - 64; i++) {
             if (slider_used[i + 64]) {
                 blob += double_string(slider_values[i + 64]);
             } else {
@@ -492,7 +890,10 @@ std::string ysfx_save_bank_to_rpl_text(ysfx_bank_t *bank)
     std::string rpl_text{"<REAPER_PRESET_LIBRARY " + escapeString(bank->name) + "\n"};
 
     for (uint32_t i = 0; i < bank->preset_count; i++) {
-        ysfx_preset_t preset = bank->presets[i];
+        const ysfx_preset_t *decoded = ysfx_bank_get_preset(bank, i);
+        if (!decoded)
+            continue;
+        ysfx_preset_t preset = *decoded;
         std::string preset_name{preset.name};
         std::string blob_name{preset.blob_name};
         std::string presetString{"  <PRESET `" + preset_name + "`\n" + preset_blob(blob_name, preset.state) + "  >\n"};
@@ -504,27 +905,100 @@ std::string ysfx_save_bank_to_rpl_text(ysfx_bank_t *bank)
     return rpl_text;
 }
 
-bool ysfx_save_bank(const char *path, ysfx_bank_t *bank)
+// write another file, and replace the bank with it once it is complete
+static bool ysfx_write_bank_file(const char *path, const void *data, size_t size)
 {
-#if defined(_WIN32)
-    std::wstring wpath = ysfx::widen(path);
-    ysfx::FILE_u stream{_wfopen(wpath.c_str(), L"wb")};
-#else
-    ysfx::FILE_u stream{fopen(path, "wb")};
-#endif
+    const std::string temp_path = std::string{path} + ".tmp";
+    {
+        ysfx::FILE_u stream{ysfx::fopen_utf8(temp_path.c_str(), "wb")};
+        if (!stream)
+            return false;
+        bool written = fwrite(data, 1, size, stream.get()) == size;
+        written = fflush(stream.get()) == 0 && written;
+        if (!written) {
+            stream.reset();
+            remove(temp_path.c_str());
+            return false;
+        }
+    }
 
-    if (!stream) {
+    if (!ysfx::rename_file(temp_path.c_str(), path)) {
+        remove(temp_path.c_str());
         return false;
     }
 
+    return true;
+}
+
+bool ysfx_save_bank(const char *path, ysfx_bank_t *bank)
+{
+    // all the presets must be decoded before, since this may be the file they are in
+    for (uint32_t i = 0; i < bank->preset_count; i++) {
+        if (!ysfx_bank_get_preset(bank, i))
+            return false;
+    }
+
     std::string txt = ysfx_save_bank_to_rpl_text(bank);
-    fwrite(txt.data(), 1, txt.length(), stream.get());
-    
-    if (ferror(stream.get())) {
-        return false;
+    return ysfx_write_bank_file(path, txt.data(), txt.length());
+}
+
+static void ysfx_append_u32(std::vector<uint8_t> &out, uint32_t value)
+{
+    size_t pos = out.size();
+    out.resize(pos + 4);
+    ysfx::pack_u32le(value, &out[pos]);
+}
+
+static void ysfx_append_u64(std::vector<uint8_t> &out, uint64_t value)
+{
+    size_t pos = out.size();
+    out.resize(pos + 8);
+    ysfx::pack_u64le(value, &out[pos]);
+}
+
+static void ysfx_append_str(std::vector<uint8_t> &out, const char *value)
+{
+    size_t length = value ? strlen(value) : 0;
+    ysfx_append_u32(out, (uint32_t)length);
+    out.insert(out.end(), value, value + length);
+}
+
+bool ysfx_save_bank_binary(const char *path, ysfx_bank_t *bank)
+{
+    size_t total = 64 + (bank->name ? strlen(bank->name) : 0);
+    for (uint32_t i = 0; i < bank->preset_count; i++) {
+        const ysfx_preset_t *preset = ysfx_bank_get_preset(bank, i);
+        if (!preset)
+            return false;
+        total += 32 + strlen(preset->name) + (preset->blob_name ? strlen(preset->blob_name) : 0) +
+            12 * (size_t)preset->state->slider_count + preset->state->data_size;
     }
 
-    stream.reset();
+    std::vector<uint8_t> out;
+    out.reserve(total);
+    out.insert(out.end(), ysfx_bank_binary_magic, ysfx_bank_binary_magic + sizeof(ysfx_bank_binary_magic));
+    ysfx_append_u32(out, ysfx_bank_binary_version);
+    ysfx_append_u32(out, 0);
+    ysfx_append_u32(out, bank->preset_count);
+    ysfx_append_str(out, bank->name);
 
-    return true;
+    for (uint32_t i = 0; i < bank->preset_count; i++) {
+        const ysfx_preset_t *preset = &bank->presets[i];
+        const ysfx_state_t *state = preset->state;
+        std::string blob_name = preset->blob_name ? std::string{preset->blob_name} : escapeString(preset->name);
+        ysfx_append_str(out, preset->name);
+        ysfx_append_str(out, blob_name.c_str());
+        ysfx_append_u32(out, state->slider_count);
+        for (uint32_t j = 0; j < state->slider_count; ++j) {
+            ysfx_append_u32(out, state->sliders[j].index);
+            size_t pos = out.size();
+            out.resize(pos + 8);
+            ysfx::pack_f64le((double)state->sliders[j].value, &out[pos]);
+        }
+        ysfx_append_u32(out, state->mem_high_water);
+        ysfx_append_u64(out, state->data_size);
+        out.insert(out.end(), state->data, state->data + state->data_size);
+    }
+
+    return ysfx_write_bank_file(path, out.data(), out.size());
 }
@@ -0,0 +1,92 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+#include "ysfx_prewarm.hpp"
+#include "ysfx.hpp"
+#include "ysfx_config.hpp"
+#include <algorithm>
+
+ysfx_prewarmer_t::~ysfx_prewarmer_t()
+{
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_quit = true;
+        m_queue.clear();
+    }
+    m_cond.notify_all();
+    if (m_thread.joinable())
+        m_thread.join();
+}
+
+void ysfx_prewarmer_t::request(const std::string &path, ysfx_config_u config)
+{
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        for (const request_t &req : m_queue) {
+            if (req.path == path)
+                return;
+        }
+        m_queue.push_back(request_t{path, std::move(config)});
+        if (!m_thread.joinable())
+            m_thread = std::thread([this]() { run(); });
+    }
+    m_cond.notify_all();
+}
+
+void ysfx_prewarmer_t::wait()
+{
+    std::unique_lock<std::mutex> lock{m_mutex};
+    m_cond.wait(lock, [this]() -> bool { return m_queue.empty() && !m_busy; });
+}
+
+void ysfx_prewarmer_t::run()
+{
+    std::unique_lock<std::mutex> lock{m_mutex};
+    for (;;) {
+        m_cond.wait(lock, [this]() -> bool { return m_quit || !m_queue.empty(); });
+        if (m_quit)
+            break;
+
+        request_t req = std::move(m_queue.front());
+        m_queue.pop_front();
+        m_busy = true;
+        lock.unlock();
+
+        // load, without the rest which an instance does, which is also the part which cannot be shared
+        ysfx_prewarmed_t sections;
+        {
+            ysfx_u fx{ysfx_new(req.config.get())};
+            if (ysfx_load_file(fx.get(), req.path.c_str(), 0)) {
+                sections.push_back(fx->source.main->toplevel);
+                for (const ysfx_source_unit_u &unit : fx->source.imports)
+                    sections.push_back(unit->toplevel);
+            }
+        }
+
+        lock.lock();
+        m_busy = false;
+        auto it = std::find_if(m_kept.begin(), m_kept.end(),
+            [&req](const std::pair<std::string, ysfx_prewarmed_t> &kept) -> bool { return kept.first == req.path; });
+        if (it != m_kept.end())
+            m_kept.erase(it);
+        if (!sections.empty()) {
+            m_kept.emplace_back(std::move(req.path), std::move(sections));
+            if (m_kept.size() > capacity)
+                m_kept.pop_front();
+        }
+        m_cond.notify_all();
+    }
+}
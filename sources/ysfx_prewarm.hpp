@@ -0,0 +1,60 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+#pragma once
+#include "ysfx.h"
+#include "ysfx_parse.hpp"
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// the sections of a file and of its imports, which keep them in the registry of parsed units
+using ysfx_prewarmed_t = std::vector<std::shared_ptr<const ysfx_toplevel_t>>;
+
+// loads files on a thread of its own, ahead of the instances which load them next
+struct ysfx_prewarmer_t {
+    // the most files whose sections stay in memory, the oldest being released first
+    enum { capacity = 8 };
+
+    // NOTE: this waits for the file which is in progress, if any
+    ~ysfx_prewarmer_t();
+
+    // queue a file, which loads with a configuration of its own
+    void request(const std::string &path, ysfx_config_u config);
+    // wait until no file remains in the queue
+    void wait();
+
+private:
+    void run();
+
+    struct request_t {
+        std::string path;
+        ysfx_config_u config;
+    };
+
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    std::deque<request_t> m_queue;
+    bool m_busy = false;
+    bool m_quit = false;
+    // the latest is at the back
+    std::deque<std::pair<std::string, ysfx_prewarmed_t>> m_kept;
+    std::thread m_thread;
+};
@@ -0,0 +1,96 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "ysfx_process_pool.hpp"
+
+static void ysfx_process_pool_work(ysfx_process_pool_t *pool, uint32_t self);
+
+ysfx_process_pool_t *ysfx_process_pool_new(uint32_t num_threads)
+{
+    ysfx_process_pool_t *pool = new ysfx_process_pool_t;
+    num_threads = (num_threads > 1) ? num_threads : 1;
+    pool->shares.reset(new ysfx_process_share_t[num_threads]);
+
+    pool->threads.reserve(num_threads - 1);
+    for (uint32_t i = 0; i + 1 < num_threads; ++i) {
+        pool->threads.emplace_back([pool, i]() {
+            for (;;) {
+                pool->wake.wait();
+                if (pool->quit.load(std::memory_order_relaxed))
+                    break;
+                ysfx_process_pool_work(pool, i);
+                pool->done.post();
+            }
+        });
+    }
+    return pool;
+}
+
+void ysfx_process_pool_free(ysfx_process_pool_t *pool)
+{
+    if (!pool)
+        return;
+    pool->quit.store(true, std::memory_order_relaxed);
+    for (size_t i = 0; i < pool->threads.size(); ++i)
+        pool->wake.post();
+    for (std::thread &thread : pool->threads)
+        thread.join();
+    delete pool;
+}
+
+static void ysfx_process_job(const ysfx_process_job_t &job, uint32_t num_frames)
+{
+    ysfx_process_float(job.fx, job.ins, job.outs, job.num_ins, job.num_outs, num_frames);
+}
+
+// the own share first, then the others, starting from the next worker
+static void ysfx_process_pool_work(ysfx_process_pool_t *pool, uint32_t self)
+{
+    const uint32_t num_workers = (uint32_t)pool->threads.size() + 1;
+    for (uint32_t k = 0; k < num_workers; ++k) {
+        ysfx_process_share_t &share = pool->shares[(self + k) % num_workers];
+        for (uint32_t i; (i = share.next.fetch_add(1, std::memory_order_relaxed)) < share.end; )
+            ysfx_process_job(pool->jobs[i], pool->num_frames);
+    }
+}
+
+void ysfx_process_many(ysfx_process_pool_t *pool, const ysfx_process_job_t *jobs, uint32_t count, uint32_t num_frames)
+{
+    if (!pool || pool->threads.empty() || count < 2) {
+        for (uint32_t i = 0; i < count; ++i)
+            ysfx_process_job(jobs[i], num_frames);
+        return;
+    }
+
+    // the same position goes to the same worker every cycle, which keeps the effect in its cache
+    const uint32_t num_workers = (uint32_t)pool->threads.size() + 1;
+    for (uint32_t w = 0; w < num_workers; ++w) {
+        ysfx_process_share_t &share = pool->shares[w];
+        share.next.store((uint32_t)((uint64_t)count * w / num_workers), std::memory_order_relaxed);
+        share.end = (uint32_t)((uint64_t)count * (w + 1) / num_workers);
+    }
+    pool->jobs = jobs;
+    pool->num_frames = num_frames;
+
+    for (size_t i = 0; i < pool->threads.size(); ++i)
+        pool->wake.post();
+
+    ysfx_process_pool_work(pool, num_workers - 1);
+
+    for (size_t i = 0; i < pool->threads.size(); ++i)
+        pool->done.wait();
+}
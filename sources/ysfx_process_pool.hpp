@@ -0,0 +1,43 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+#include "ysfx.h"
+#include "utility/rt_semaphore.h"
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <memory>
+
+// the jobs which a worker takes first, before it steals those of the others
+//   each has a line of cache, since the others take from it too
+struct alignas(64) ysfx_process_share_t {
+    std::atomic<uint32_t> next{0};
+    uint32_t end = 0;
+};
+
+struct ysfx_process_pool_s {
+    std::vector<std::thread> threads;
+    // one per thread, with the calling thread last
+    std::unique_ptr<ysfx_process_share_t[]> shares;
+    RTSemaphore wake;
+    RTSemaphore done;
+    std::atomic<bool> quit{false};
+    // the current batch
+    const ysfx_process_job_t *jobs = nullptr;
+    uint32_t num_frames = 0;
+};
@@ -16,93 +16,166 @@
 //
 
 #include "ysfx_reader.hpp"
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#   define YSFX_READER_SSE2 1
+#   include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#   define YSFX_READER_NEON 1
+#   include <arm_neon.h>
+#endif
 
 namespace ysfx {
 
-//------------------------------------------------------------------------------
-bool text_reader::read_next_line(std::string &line)
+// the first CR or LF of a range, or its end
+static const char *find_line_break(const char *p, const char *end)
 {
-    line.clear();
-
-    char next = read_next_char();
-    if (next == '\0')
-        return false;
-
-    while (next != '\0' && next != '\r' && next != '\n') {
-        line.push_back(next);
-        next = read_next_char();
+#if defined(YSFX_READER_SSE2)
+    const __m128i cr = _mm_set1_epi8('\r');
+    const __m128i lf = _mm_set1_epi8('\n');
+    for (; end - p >= 16; p += 16) {
+        __m128i c = _mm_loadu_si128((const __m128i *)p);
+        int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(c, cr), _mm_cmpeq_epi8(c, lf)));
+        if (mask) {
+            while (!(mask & 1)) {
+                mask >>= 1;
+                ++p;
+            }
+            return p;
+        }
     }
-
-    if (next == '\r') {
-        next = peek_next_char();
-        if (next == '\n')
-            read_next_char();
+#elif defined(YSFX_READER_NEON)
+    const uint8x16_t cr = vdupq_n_u8('\r');
+    const uint8x16_t lf = vdupq_n_u8('\n');
+    for (; end - p >= 16; p += 16) {
+        uint8x16_t c = vld1q_u8((const uint8_t *)p);
+        if (vmaxvq_u8(vorrq_u8(vceqq_u8(c, cr), vceqq_u8(c, lf))))
+            break;
     }
-
-    return true;
+#endif
+    while (p != end && *p != '\r' && *p != '\n')
+        ++p;
+    return p;
 }
 
 //------------------------------------------------------------------------------
-char string_text_reader::read_next_char()
+char text_reader::read_next_char()
 {
-    const char *ptr = m_char_ptr;
-
-    if (!ptr || *ptr == '\0')
-        return '\0';
-
-    char next = *ptr;
-    m_char_ptr = ptr + 1;
-    return next;
+    return available() ? *m_pos++ : '\0';
 }
 
-char string_text_reader::peek_next_char()
+char text_reader::peek_next_char()
 {
-    const char *ptr = m_char_ptr;
-
-    if (!ptr)
-        return '\0';
+    return available() ? *m_pos : '\0';
+}
 
-    return *ptr;
+void text_reader::rewind()
+{
+    m_line.clear();
+    restart();
 }
 
-void string_text_reader::rewind()
+bool text_reader::read_next_line(std::string &line)
 {
-    m_char_ptr = m_char_start;
+    std::string_view view;
+    if (!read_next_line(view)) {
+        line.clear();
+        return false;
+    }
+    line.assign(view.data(), view.size());
+    return true;
 }
 
-//------------------------------------------------------------------------------
-char stdio_text_reader::read_next_char()
+bool text_reader::read_next_line(std::string_view &line)
 {
-    FILE *stream = m_stream;
+    m_line.clear();
 
-    if (!stream)
-        return '\0';
+    if (!available()) {
+        line = {};
+        return false;
+    }
 
-    int next = fgetc(stream);
-    if (next == EOF)
-        return '\0';
+    // the line is in the window, unless it goes past the block
+    const char *start = m_pos;
+    const char *brk = find_line_break(m_pos, m_end);
+    bool spans = false;
+    while (brk == m_end) {
+        m_line.append(start, (size_t)(brk - start));
+        spans = true;
+        m_pos = m_end;
+        if (!fill()) {
+            line = m_line;
+            return true;
+        }
+        start = m_pos;
+        brk = find_line_break(m_pos, m_end);
+    }
+    if (spans) {
+        m_line.append(start, (size_t)(brk - start));
+        line = m_line;
+    }
+    else
+        line = std::string_view(start, (size_t)(brk - start));
+
+    m_pos = brk + 1;
+    if (*brk == '\r') {
+        // the LF of CRLF can be in the next block, which leaves the line in place
+        if (m_pos == m_end && !spans) {
+            m_line.assign(line.data(), line.size());
+            line = m_line;
+        }
+        if (available() && *m_pos == '\n')
+            ++m_pos;
+    }
 
-    return (unsigned char)next;
+    return true;
 }
 
-char stdio_text_reader::peek_next_char()
+//------------------------------------------------------------------------------
+string_text_reader::string_text_reader(const char *text)
+    : m_start(text),
+      m_stop(text ? (text + strlen(text)) : nullptr)
 {
-    FILE *stream = m_stream;
+    m_pos = m_start;
+    m_end = m_stop;
+}
 
-    if (!stream)
-        return '\0';
+void string_text_reader::restart()
+{
+    m_pos = m_start;
+    m_end = m_stop;
+}
+
+//------------------------------------------------------------------------------
+bool stdio_text_reader::fill()
+{
+    if (!m_stream || m_ended)
+        return false;
 
-    int next = fgetc(stream);
-    if (next == EOF)
-        return '\0';
+    m_block.resize(block_size);
+    size_t count = fread(m_block.data(), 1, m_block.size(), m_stream);
+    // a null character ends the text
+    if (const void *nul = memchr(m_block.data(), '\0', count)) {
+        count = (size_t)((const char *)nul - m_block.data());
+        m_ended = true;
+    }
+    if (count < m_block.size())
+        m_ended = true;
 
-    ungetc(next, stream);
-    return (unsigned char)next;
+    m_pos = m_block.data();
+    m_end = m_pos + count;
+    return count > 0;
 }
 
-void stdio_text_reader::rewind()
+void stdio_text_reader::restart()
 {
-    fseek(m_stream, 0, SEEK_SET);
+    m_pos = m_end = nullptr;
+    m_ended = false;
+    if (m_stream) {
+        clearerr(m_stream);
+        fseek(m_stream, 0, SEEK_SET);
+    }
 }
 
 } // namespace ysfx
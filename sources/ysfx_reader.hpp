@@ -17,32 +17,52 @@
 
 #pragma once
 #include <string>
+#include <string_view>
+#include <vector>
 #include <cstdio>
 #include <cstddef>
 
 namespace ysfx {
 
+// reads text by blocks, which it scans for the ends of lines; the text ends
+//   at its end or at the first null character, and the lines end at any of
+//   CR, LF or CRLF
 class text_reader
 {
 public:
     virtual ~text_reader() = default;
-    virtual char read_next_char() = 0;
-    virtual char peek_next_char() = 0;
-    virtual void rewind() = 0;
+    char read_next_char();
+    char peek_next_char();
+    void rewind();
     bool read_next_line(std::string &line);
+    // the same, with a view which is valid until the next read or rewind
+    bool read_next_line(std::string_view &line);
+
+protected:
+    // get the next block into the window, return false at the end
+    virtual bool fill() = 0;
+    virtual void restart() = 0;
+    // the window of text which is not read yet
+    const char *m_pos = nullptr;
+    const char *m_end = nullptr;
+
+private:
+    bool available() { return m_pos != m_end || fill(); }
+    // the line which spans blocks, put together
+    std::string m_line;
 };
 
 //------------------------------------------------------------------------------
 class string_text_reader : public text_reader
 {
 public:
-    explicit string_text_reader(const char *text) : m_char_ptr(text), m_char_start(text) {}
-    char read_next_char() override;
-    char peek_next_char() override;
-    void rewind() override;
+    explicit string_text_reader(const char *text);
+protected:
+    bool fill() override { return false; }
+    void restart() override;
 private:
-    const char *m_char_ptr = nullptr;
-    const char *m_char_start = nullptr;
+    const char *m_start = nullptr;
+    const char *m_stop = nullptr;
 };
 
 //------------------------------------------------------------------------------
@@ -50,11 +70,14 @@ class stdio_text_reader : public text_reader
 {
 public:
     explicit stdio_text_reader(FILE *stream) : m_stream(stream) {}
-    char read_next_char() override;
-    char peek_next_char() override;
-    void rewind() override;
+protected:
+    bool fill() override;
+    void restart() override;
 private:
+    enum { block_size = 65536 };
     FILE *m_stream = nullptr;
+    std::vector<char> m_block;
+    bool m_ended = false;
 };
 
 } // namespace ysfx
@@ -0,0 +1,229 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "ysfx_resample.hpp"
+#include "ysfx_convert.hpp"
+#include <algorithm>
+#include <cmath>
+
+enum {
+    resampler_phases = 512,
+    resampler_base_taps = 32,
+    resampler_max_taps = 256,
+};
+
+// the Kaiser window uses the modified Bessel function of the first kind
+static double bessel_i0(double x)
+{
+    double sum = 1;
+    double term = 1;
+    double q = x * x / 4;
+    for (int k = 1; k < 50; ++k) {
+        term *= q / ((double)k * k);
+        sum += term;
+        if (term < sum * 1e-16)
+            break;
+    }
+    return sum;
+}
+
+void ysfx_resampler_t::setup(uint32_t channels, ysfx_real in_rate, ysfx_real out_rate)
+{
+    m_channels = channels;
+    m_ratio = in_rate / out_rate;
+
+    // when decimating, the filter cuts lower and needs more taps to keep its slope
+    const double cutoff = 0.97 * std::min(1.0, 1.0 / m_ratio);
+    uint32_t taps = (uint32_t)std::ceil(resampler_base_taps * std::max(1.0, m_ratio));
+    taps = std::min<uint32_t>((taps + 3) & ~3u, resampler_max_taps);
+    m_taps = taps;
+
+    const double beta = 9.0;
+    const double i0beta = bessel_i0(beta);
+    const double half = taps / 2;
+    const double pi = 3.14159265358979323846;
+
+    m_table.resize((size_t)(resampler_phases + 1) * taps);
+    for (uint32_t p = 0; p <= resampler_phases; ++p) {
+        double frac = (double)p / resampler_phases;
+        ysfx_real *row = &m_table[(size_t)p * taps];
+        for (uint32_t j = 0; j < taps; ++j) {
+            // the distance of the tap from the position of the output
+            double d = (half - 1) + frac - j;
+            double x = d * cutoff;
+            double sinc = (x == 0) ? 1.0 : (std::sin(pi * x) / (pi * x));
+            double w = d / half;
+            double window = (std::fabs(w) >= 1) ? 0.0 : (bessel_i0(beta * std::sqrt(1 - w * w)) / i0beta);
+            row[j] = (ysfx_real)(cutoff * sinc * window);
+        }
+    }
+
+    m_coefs.resize(taps);
+    m_history.resize(channels);
+    clear();
+}
+
+void ysfx_resampler_t::clear()
+{
+    // the history starts with the zeros which precede the first frame
+    for (std::vector<ysfx_real> &history : m_history)
+        history.assign(m_taps / 2 - 1, 0);
+    m_dropped = 0;
+    m_in_count = 0;
+    m_out_count = 0;
+    m_finished = false;
+}
+
+uint64_t ysfx_resampler_t::input_needed(uint32_t out_frames) const
+{
+    if (m_finished || out_frames == 0)
+        return 0;
+    uint64_t last = m_out_count + out_frames - 1;
+    uint64_t needed = (uint64_t)std::floor((ysfx_real)last * m_ratio) + m_taps / 2 + 1;
+    return (needed > m_in_count) ? (needed - m_in_count) : 0;
+}
+
+void ysfx_resampler_t::write(const ysfx_real *in, uint32_t frames)
+{
+    if (m_finished)
+        return;
+    const uint32_t channels = m_channels;
+    for (uint32_t c = 0; c < channels; ++c) {
+        std::vector<ysfx_real> &history = m_history[c];
+        size_t size = history.size();
+        history.resize(size + frames);
+        ysfx_real *dst = &history[size];
+        for (uint32_t i = 0; i < frames; ++i)
+            dst[i] = in[i * channels + c];
+    }
+    m_in_count += frames;
+}
+
+void ysfx_resampler_t::finish()
+{
+    if (m_finished)
+        return;
+    // the zeros which follow the last frame
+    for (std::vector<ysfx_real> &history : m_history)
+        history.resize(history.size() + m_taps / 2 + 1, 0);
+    m_finished = true;
+}
+
+uint64_t ysfx_resampler_t::output_total(uint64_t more_input) const
+{
+    return (uint64_t)std::ceil((ysfx_real)(m_in_count + more_input) / m_ratio);
+}
+
+void ysfx_resampler_t::compute_coefs(ysfx_real frac)
+{
+    ysfx_real pos = frac * resampler_phases;
+    uint32_t p = std::min<uint32_t>((uint32_t)pos, resampler_phases - 1);
+    ysfx_real mu = pos - p;
+
+    const ysfx_real *row0 = &m_table[(size_t)p * m_taps];
+    const ysfx_real *row1 = row0 + m_taps;
+    ysfx_real *coefs = m_coefs.data();
+    const uint32_t taps = m_taps;
+
+    uint32_t j = 0;
+#if defined(YSFX_CONVERT_SSE2)
+    const __m128d vmu = _mm_set1_pd(mu);
+    for (; j < taps; j += 2) {
+        __m128d a = _mm_loadu_pd(&row0[j]);
+        __m128d b = _mm_loadu_pd(&row1[j]);
+        _mm_storeu_pd(&coefs[j], _mm_add_pd(a, _mm_mul_pd(vmu, _mm_sub_pd(b, a))));
+    }
+#elif defined(YSFX_CONVERT_NEON)
+    const float64x2_t vmu = vdupq_n_f64(mu);
+    for (; j < taps; j += 2) {
+        float64x2_t a = vld1q_f64(&row0[j]);
+        float64x2_t b = vld1q_f64(&row1[j]);
+        vst1q_f64(&coefs[j], vfmaq_f64(a, vmu, vsubq_f64(b, a)));
+    }
+#endif
+    for (; j < taps; ++j)
+        coefs[j] = row0[j] + mu * (row1[j] - row0[j]);
+}
+
+static ysfx_real ysfx_resampler_dot(const ysfx_real *x, const ysfx_real *h, uint32_t taps)
+{
+    uint32_t j = 0;
+#if defined(YSFX_CONVERT_SSE2)
+    __m128d acc0 = _mm_setzero_pd();
+    __m128d acc1 = _mm_setzero_pd();
+    for (; j < taps; j += 4) {
+        acc0 = _mm_add_pd(acc0, _mm_mul_pd(_mm_loadu_pd(&x[j]), _mm_loadu_pd(&h[j])));
+        acc1 = _mm_add_pd(acc1, _mm_mul_pd(_mm_loadu_pd(&x[j + 2]), _mm_loadu_pd(&h[j + 2])));
+    }
+    __m128d acc = _mm_add_pd(acc0, acc1);
+    return _mm_cvtsd_f64(_mm_add_sd(acc, _mm_unpackhi_pd(acc, acc)));
+#elif defined(YSFX_CONVERT_NEON)
+    float64x2_t acc0 = vdupq_n_f64(0);
+    float64x2_t acc1 = vdupq_n_f64(0);
+    for (; j < taps; j += 4) {
+        acc0 = vfmaq_f64(acc0, vld1q_f64(&x[j]), vld1q_f64(&h[j]));
+        acc1 = vfmaq_f64(acc1, vld1q_f64(&x[j + 2]), vld1q_f64(&h[j + 2]));
+    }
+    return vaddvq_f64(vaddq_f64(acc0, acc1));
+#else
+    ysfx_real acc = 0;
+    for (; j < taps; ++j)
+        acc += x[j] * h[j];
+    return acc;
+#endif
+}
+
+uint32_t ysfx_resampler_t::read(ysfx_real *out, uint32_t frames)
+{
+    const uint32_t channels = m_channels;
+    const uint32_t taps = m_taps;
+    const uint64_t total = m_finished ? output_total() : ~(uint64_t)0;
+    const size_t size = m_history.empty() ? 0 : m_history[0].size();
+
+    uint32_t count = 0;
+    for (; count < frames && m_out_count < total; ++count) {
+        ysfx_real t = (ysfx_real)m_out_count * m_ratio;
+        ysfx_real base = std::floor(t);
+        size_t start = (size_t)((uint64_t)base - m_dropped);
+        if (start + taps > size)
+            break;
+
+        compute_coefs(t - base);
+        for (uint32_t c = 0; c < channels; ++c)
+            out[count * channels + c] = ysfx_resampler_dot(&m_history[c][start], m_coefs.data(), taps);
+        ++m_out_count;
+    }
+
+    discard_history();
+    return count;
+}
+
+void ysfx_resampler_t::discard_history()
+{
+    // drop the frames which precede the window of the next output
+    uint64_t next = (uint64_t)std::floor((ysfx_real)m_out_count * m_ratio);
+    if (next <= m_dropped)
+        return;
+    size_t drop = (size_t)(next - m_dropped);
+    if (drop < 1024 && !m_history.empty() && drop < m_history[0].size() / 2)
+        return;
+    for (std::vector<ysfx_real> &history : m_history) {
+        drop = std::min(drop, history.size());
+        history.erase(history.begin(), history.begin() + drop);
+    }
+    m_dropped += drop;
+}
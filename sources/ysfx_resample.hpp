@@ -0,0 +1,64 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+#include "ysfx.h"
+#include <vector>
+
+// windowed-sinc resampler of interleaved frames, at any ratio of rates
+//    The kernel is tabulated in many phases, and each output interpolates
+//    its coefficients between the two phases which surround its position.
+struct ysfx_resampler_t {
+    void setup(uint32_t channels, ysfx_real in_rate, ysfx_real out_rate);
+    void clear();
+
+    uint32_t channels() const { return m_channels; }
+    // frames of input per frame of output
+    ysfx_real ratio() const { return m_ratio; }
+
+    // frames of input to write before the next `out_frames` frames can be read
+    uint64_t input_needed(uint32_t out_frames) const;
+    // add frames of input
+    void write(const ysfx_real *in, uint32_t frames);
+    // mark the end of the input, so the remaining frames can be read
+    void finish();
+    bool finished() const { return m_finished; }
+    // read frames of output, returning how many were available
+    uint32_t read(ysfx_real *out, uint32_t frames);
+
+    // frames of output which the input written so far will produce in total
+    uint64_t output_total(uint64_t more_input = 0) const;
+    uint64_t output_read() const { return m_out_count; }
+
+private:
+    void compute_coefs(ysfx_real frac);
+    void discard_history();
+
+private:
+    uint32_t m_channels = 0;
+    uint32_t m_taps = 0;
+    ysfx_real m_ratio = 1;
+    // the kernel: (phases + 1) rows of taps, the last one for interpolation
+    std::vector<ysfx_real> m_table;
+    std::vector<ysfx_real> m_coefs;
+    // the input of each channel, after the frames which were dropped
+    std::vector<std::vector<ysfx_real>> m_history;
+    uint64_t m_dropped = 0;
+    uint64_t m_in_count = 0;
+    uint64_t m_out_count = 0;
+    bool m_finished = false;
+};
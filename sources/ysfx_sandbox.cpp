@@ -0,0 +1,612 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+#include "ysfx_sandbox.hpp"
+#include <algorithm>
+#include <chrono>
+#include <new>
+#include <thread>
+#include <cstring>
+#include <cstdio>
+#if defined(_WIN32)
+#   include "ysfx_utils.hpp"
+#else
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <fcntl.h>
+#   include <unistd.h>
+#   include <signal.h>
+#   include <cerrno>
+#   include <ctime>
+#   if defined(__linux__)
+#       include <linux/futex.h>
+#       include <sys/syscall.h>
+#   endif
+#endif
+namespace kro = std::chrono;
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "the words are shared between processes");
+
+// the time which a wait spins before it sleeps, which is where the short cycles finish
+static const uint64_t ysfx_sandbox_spin_us = 20;
+// how often the child looks whether the host is still there, while it has nothing to do
+static const uint64_t ysfx_sandbox_idle_us = 250000;
+
+size_t ysfx_sandbox_audio_offset()
+{
+    return (sizeof(ysfx_sandbox_shared_t) + 63) & ~(size_t)63;
+}
+
+size_t ysfx_sandbox_segment_size(uint32_t max_channels, uint32_t max_frames)
+{
+    return ysfx_sandbox_audio_offset() + 2 * (size_t)max_channels * max_frames * sizeof(ysfx_real);
+}
+
+//------------------------------------------------------------------------------
+bool ysfx_shared_segment_t::create(const std::string &name, size_t size)
+{
+    close();
+
+#if !defined(_WIN32)
+    std::string path = "/" + name;
+    int fd = shm_open(path.c_str(), O_RDWR|O_CREAT|O_EXCL, 0600);
+    if (fd == -1)
+        return false;
+    void *data = MAP_FAILED;
+    if (ftruncate(fd, (off_t)size) == 0)
+        data = mmap(nullptr, size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        shm_unlink(path.c_str());
+        return false;
+    }
+#else
+    std::wstring path = ysfx::widen("Local\\" + name);
+    HANDLE mapping = CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, (DWORD)((uint64_t)size >> 32), (DWORD)size, path.c_str());
+    if (!mapping)
+        return false;
+    if (GetLastError() == ERROR_ALREADY_EXISTS) {
+        CloseHandle(mapping);
+        return false;
+    }
+    void *data = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+    if (!data) {
+        CloseHandle(mapping);
+        return false;
+    }
+    m_mapping = mapping;
+#endif
+
+    m_data = (uint8_t *)data;
+    m_size = size;
+    m_owner = true;
+    m_name = name;
+    return true;
+}
+
+bool ysfx_shared_segment_t::open(const std::string &name)
+{
+    close();
+
+#if !defined(_WIN32)
+    std::string path = "/" + name;
+    int fd = shm_open(path.c_str(), O_RDWR, 0);
+    if (fd == -1)
+        return false;
+    struct stat st;
+    void *data = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(ysfx_sandbox_shared_t))
+        data = mmap(nullptr, (size_t)st.st_size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED)
+        return false;
+    size_t size = (size_t)st.st_size;
+#else
+    std::wstring path = ysfx::widen("Local\\" + name);
+    HANDLE mapping = OpenFileMappingW(FILE_MAP_ALL_ACCESS, FALSE, path.c_str());
+    if (!mapping)
+        return false;
+    void *data = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+    MEMORY_BASIC_INFORMATION info{};
+    if (!data || !VirtualQuery(data, &info, sizeof(info))) {
+        if (data)
+            UnmapViewOfFile(data);
+        CloseHandle(mapping);
+        return false;
+    }
+    size_t size = info.RegionSize;
+    m_mapping = mapping;
+#endif
+
+    m_data = (uint8_t *)data;
+    m_size = size;
+    m_owner = false;
+    m_name = name;
+    return true;
+}
+
+void ysfx_shared_segment_t::close()
+{
+    if (!m_data)
+        return;
+#if !defined(_WIN32)
+    munmap(m_data, m_size);
+    if (m_owner)
+        shm_unlink(("/" + m_name).c_str());
+#else
+    UnmapViewOfFile(m_data);
+    CloseHandle(m_mapping);
+    m_mapping = nullptr;
+#endif
+    m_data = nullptr;
+    m_size = 0;
+    m_owner = false;
+    m_name.clear();
+}
+
+//------------------------------------------------------------------------------
+bool ysfx_ipc_semaphore_t::create(const std::string &name, std::atomic<uint32_t> *word)
+{
+    close();
+    word->store(0, std::memory_order_relaxed);
+#if defined(_WIN32)
+    m_sem = CreateSemaphoreW(nullptr, 0, LONG_MAX, ysfx::widen("Local\\" + name).c_str());
+    if (!m_sem)
+        return false;
+#elif !defined(__linux__)
+    std::string path = "/" + name;
+    sem_unlink(path.c_str());
+    m_sem = sem_open(path.c_str(), O_CREAT|O_EXCL, 0600, 0);
+    if (m_sem == SEM_FAILED) {
+        m_sem = nullptr;
+        return false;
+    }
+    m_owner = true;
+    m_name = path;
+#else
+    (void)name;
+#endif
+    m_word = word;
+    return true;
+}
+
+bool ysfx_ipc_semaphore_t::open(const std::string &name, std::atomic<uint32_t> *word)
+{
+    close();
+#if defined(_WIN32)
+    m_sem = OpenSemaphoreW(SEMAPHORE_MODIFY_STATE|SYNCHRONIZE, FALSE, ysfx::widen("Local\\" + name).c_str());
+    if (!m_sem)
+        return false;
+#elif !defined(__linux__)
+    m_sem = sem_open(("/" + name).c_str(), 0);
+    if (m_sem == SEM_FAILED) {
+        m_sem = nullptr;
+        return false;
+    }
+#else
+    (void)name;
+#endif
+    m_word = word;
+    return true;
+}
+
+void ysfx_ipc_semaphore_t::close()
+{
+#if defined(_WIN32)
+    if (m_sem)
+        CloseHandle(m_sem);
+    m_sem = nullptr;
+#elif !defined(__linux__)
+    if (m_sem)
+        sem_close(m_sem);
+    if (m_owner)
+        sem_unlink(m_name.c_str());
+    m_sem = nullptr;
+    m_owner = false;
+    m_name.clear();
+#endif
+    m_word = nullptr;
+}
+
+void ysfx_ipc_semaphore_t::post()
+{
+    if (!m_word)
+        return;
+#if defined(_WIN32)
+    ReleaseSemaphore(m_sem, 1, nullptr);
+#elif !defined(__linux__)
+    sem_post(m_sem);
+#else
+    m_word->fetch_add(1, std::memory_order_release);
+    syscall(SYS_futex, (uint32_t *)m_word, FUTEX_WAKE, 1, nullptr, nullptr, 0);
+#endif
+}
+
+bool ysfx_ipc_semaphore_t::try_wait()
+{
+#if defined(_WIN32)
+    return WaitForSingleObject(m_sem, 0) == WAIT_OBJECT_0;
+#elif !defined(__linux__)
+    return sem_trywait(m_sem) == 0;
+#else
+    uint32_t count = m_word->load(std::memory_order_relaxed);
+    while (count > 0) {
+        if (m_word->compare_exchange_weak(count, count - 1, std::memory_order_acquire, std::memory_order_relaxed))
+            return true;
+    }
+    return false;
+#endif
+}
+
+bool ysfx_ipc_semaphore_t::wait(uint64_t timeout_us)
+{
+    const kro::steady_clock::time_point start = kro::steady_clock::now();
+    const kro::steady_clock::time_point deadline = start + kro::microseconds(timeout_us);
+    const kro::steady_clock::time_point spin_end = start + kro::microseconds(std::min(timeout_us, ysfx_sandbox_spin_us));
+
+    do {
+        if (try_wait())
+            return true;
+    } while (kro::steady_clock::now() < spin_end);
+
+    for (;;) {
+        kro::steady_clock::time_point now = kro::steady_clock::now();
+        if (now >= deadline)
+            return try_wait();
+        uint64_t remain_us = (uint64_t)kro::duration_cast<kro::microseconds>(deadline - now).count();
+#if defined(_WIN32)
+        DWORD ms = (DWORD)std::max<uint64_t>(1, (remain_us + 999) / 1000);
+        return WaitForSingleObject(m_sem, ms) == WAIT_OBJECT_0;
+#elif defined(__linux__)
+        if (try_wait())
+            return true;
+        struct timespec ts;
+        ts.tv_sec = (time_t)(remain_us / 1000000);
+        ts.tv_nsec = (long)(remain_us % 1000000) * 1000;
+        syscall(SYS_futex, (uint32_t *)m_word, FUTEX_WAIT, 0, &ts, nullptr, 0);
+#elif defined(__APPLE__)
+        // there is no timed wait of a named semaphore, it polls
+        if (try_wait())
+            return true;
+        std::this_thread::sleep_for(kro::microseconds(std::min<uint64_t>(remain_us, 100)));
+#else
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        uint64_t ns = (uint64_t)ts.tv_nsec + remain_us * 1000;
+        ts.tv_sec += (time_t)(ns / 1000000000);
+        ts.tv_nsec = (long)(ns % 1000000000);
+        if (sem_timedwait(m_sem, &ts) == 0)
+            return true;
+        if (errno == ETIMEDOUT)
+            return false;
+#endif
+    }
+}
+
+//------------------------------------------------------------------------------
+static uint64_t ysfx_sandbox_current_pid()
+{
+#if defined(_WIN32)
+    return (uint64_t)GetCurrentProcessId();
+#else
+    return (uint64_t)getpid();
+#endif
+}
+
+static bool ysfx_sandbox_pid_alive(uint64_t pid)
+{
+#if defined(_WIN32)
+    HANDLE process = OpenProcess(SYNCHRONIZE, FALSE, (DWORD)pid);
+    if (!process)
+        return false;
+    bool alive = WaitForSingleObject(process, 0) == WAIT_TIMEOUT;
+    CloseHandle(process);
+    return alive;
+#else
+    return kill((pid_t)pid, 0) == 0 || errno == EPERM;
+#endif
+}
+
+// append a MIDI event, as its header and its data padded to 4 bytes
+static bool ysfx_sandbox_put_midi(uint8_t *buffer, uint32_t &size, uint32_t capacity, const ysfx_midi_event_t &event)
+{
+    const uint32_t header[3] = {event.bus, event.offset, event.size};
+    const uint32_t total = (uint32_t)sizeof(header) + ((event.size + 3) & ~3u);
+    if (event.size > capacity || total > capacity - size)
+        return false;
+    memcpy(&buffer[size], header, sizeof(header));
+    memcpy(&buffer[size + sizeof(header)], event.data, event.size);
+    size += total;
+    return true;
+}
+
+static bool ysfx_sandbox_get_midi(const uint8_t *buffer, size_t size, size_t &pos, ysfx_midi_event_t &event)
+{
+    uint32_t header[3];
+    if (size - pos < sizeof(header))
+        return false;
+    memcpy(header, &buffer[pos], sizeof(header));
+    const size_t total = sizeof(header) + ((header[2] + 3) & ~3u);
+    if (total > size - pos)
+        return false;
+    event.bus = header[0];
+    event.offset = header[1];
+    event.size = header[2];
+    event.data = &buffer[pos + sizeof(header)];
+    pos += total;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+ysfx_sandbox_t *ysfx_sandbox_new(uint32_t max_channels, uint32_t max_frames)
+{
+    static std::atomic<uint32_t> counter{0};
+
+    if (max_channels > ysfx_max_channels || max_frames == 0)
+        return nullptr;
+
+    ysfx_sandbox_u sandbox{new ysfx_sandbox_t};
+
+    char name[64];
+    snprintf(name, sizeof(name), "ysfx-%llu-%u", (unsigned long long)ysfx_sandbox_current_pid(), counter.fetch_add(1));
+    sandbox->name = name;
+
+    if (!sandbox->segment.create(sandbox->name, ysfx_sandbox_segment_size(max_channels, max_frames)))
+        return nullptr;
+
+    ysfx_sandbox_shared_t *shared = new (sandbox->segment.data()) ysfx_sandbox_shared_t;
+    sandbox->shared = shared;
+    shared->max_channels = max_channels;
+    shared->max_frames = max_frames;
+    shared->host_pid = ysfx_sandbox_current_pid();
+    shared->connected.store(0, std::memory_order_relaxed);
+    shared->closed.store(0, std::memory_order_relaxed);
+    shared->cycle.store(0, std::memory_order_relaxed);
+    shared->done_cycle.store(0, std::memory_order_relaxed);
+    shared->version = ysfx_sandbox_version;
+
+    if (!sandbox->request.create(sandbox->name + "-q", &shared->request_count) ||
+        !sandbox->response.create(sandbox->name + "-r", &shared->response_count))
+        return nullptr;
+
+    // the magic is last, for the child not to open what is not ready
+    std::atomic_thread_fence(std::memory_order_release);
+    shared->magic = ysfx_sandbox_magic;
+
+    ysfx_real *audio = (ysfx_real *)(sandbox->segment.data() + ysfx_sandbox_audio_offset());
+    sandbox->ins.resize(max_channels);
+    sandbox->outs.resize(max_channels);
+    for (uint32_t i = 0; i < max_channels; ++i) {
+        sandbox->ins[i] = &audio[(size_t)i * max_frames];
+        sandbox->outs[i] = &audio[(size_t)(max_channels + i) * max_frames];
+    }
+
+    sandbox->slider_changes.reserve(ysfx_max_sliders);
+    sandbox->midi_in.resize(ysfx_sandbox_midi_capacity);
+    sandbox->midi_out.resize(ysfx_sandbox_midi_capacity);
+    return sandbox.release();
+}
+
+void ysfx_sandbox_free(ysfx_sandbox_t *sandbox)
+{
+    if (!sandbox)
+        return;
+
+    if (ysfx_sandbox_shared_t *shared = sandbox->shared) {
+        shared->closed.store(1, std::memory_order_release);
+        sandbox->request.post();
+    }
+    delete sandbox;
+}
+
+const char *ysfx_sandbox_get_name(ysfx_sandbox_t *sandbox)
+{
+    return sandbox->name.c_str();
+}
+
+bool ysfx_sandbox_wait_connected(ysfx_sandbox_t *sandbox, uint32_t timeout_ms)
+{
+    const kro::steady_clock::time_point deadline = kro::steady_clock::now() + kro::milliseconds(timeout_ms);
+    while (!sandbox->shared->connected.load(std::memory_order_acquire)) {
+        if (kro::steady_clock::now() >= deadline)
+            return false;
+        std::this_thread::sleep_for(kro::milliseconds(1));
+    }
+    return true;
+}
+
+ysfx_real *const *ysfx_sandbox_get_inputs(ysfx_sandbox_t *sandbox)
+{
+    return sandbox->ins.data();
+}
+
+ysfx_real *const *ysfx_sandbox_get_outputs(ysfx_sandbox_t *sandbox)
+{
+    return sandbox->outs.data();
+}
+
+void ysfx_sandbox_set_sample_rate(ysfx_sandbox_t *sandbox, ysfx_real samplerate)
+{
+    sandbox->sample_rate = samplerate;
+}
+
+void ysfx_sandbox_set_block_size(ysfx_sandbox_t *sandbox, uint32_t blocksize)
+{
+    sandbox->block_size = blocksize;
+}
+
+void ysfx_sandbox_set_time_info(ysfx_sandbox_t *sandbox, const ysfx_time_info_t *info)
+{
+    sandbox->time_info = *info;
+}
+
+bool ysfx_sandbox_slider_set_value(ysfx_sandbox_t *sandbox, uint32_t index, ysfx_real value)
+{
+    if (index >= ysfx_max_sliders)
+        return false;
+    for (ysfx_sandbox_slider_change_t &change : sandbox->slider_changes) {
+        if (change.index == index) {
+            change.value = value;
+            return true;
+        }
+    }
+    sandbox->slider_changes.push_back({index, value});
+    return true;
+}
+
+ysfx_real ysfx_sandbox_slider_get_value(ysfx_sandbox_t *sandbox, uint32_t index)
+{
+    if (index >= ysfx_max_sliders)
+        return 0;
+    return sandbox->slider_values[index];
+}
+
+bool ysfx_sandbox_send_midi(ysfx_sandbox_t *sandbox, const ysfx_midi_event_t *event)
+{
+    return ysfx_sandbox_put_midi(sandbox->midi_in.data(), sandbox->midi_in_size, ysfx_sandbox_midi_capacity, *event);
+}
+
+bool ysfx_sandbox_receive_midi(ysfx_sandbox_t *sandbox, ysfx_midi_event_t *event)
+{
+    return ysfx_sandbox_get_midi(sandbox->midi_out.data(), sandbox->midi_out_size, sandbox->midi_out_pos, *event);
+}
+
+bool ysfx_sandbox_process(ysfx_sandbox_t *sandbox, uint32_t num_ins, uint32_t num_outs, uint32_t num_frames, uint32_t timeout_us)
+{
+    ysfx_sandbox_shared_t *shared = sandbox->shared;
+    num_ins = std::min(num_ins, shared->max_channels);
+    num_outs = std::min(num_outs, shared->max_channels);
+    num_frames = std::min(num_frames, shared->max_frames);
+
+    sandbox->midi_out_size = 0;
+    sandbox->midi_out_pos = 0;
+
+    auto fail = [&]() -> bool {
+        for (uint32_t ch = 0; ch < num_outs; ++ch)
+            std::fill_n(sandbox->outs[ch], num_frames, (ysfx_real)0);
+        return false;
+    };
+
+    // the child holds the buffers until it has done the last cycle
+    if (!shared->connected.load(std::memory_order_acquire) ||
+        shared->done_cycle.load(std::memory_order_acquire) != sandbox->cycle)
+        return fail();
+
+    shared->num_ins = num_ins;
+    shared->num_outs = num_outs;
+    shared->num_frames = num_frames;
+    shared->block_size = sandbox->block_size;
+    shared->sample_rate = sandbox->sample_rate;
+    shared->time_info = sandbox->time_info;
+    shared->num_slider_changes = (uint32_t)sandbox->slider_changes.size();
+    std::copy(sandbox->slider_changes.begin(), sandbox->slider_changes.end(), shared->slider_changes);
+    sandbox->slider_changes.clear();
+    shared->midi_in_size = sandbox->midi_in_size;
+    memcpy(shared->midi_in, sandbox->midi_in.data(), sandbox->midi_in_size);
+    sandbox->midi_in_size = 0;
+
+    const uint32_t cycle = ++sandbox->cycle;
+    shared->cycle.store(cycle, std::memory_order_release);
+    sandbox->request.post();
+
+    const kro::steady_clock::time_point deadline = kro::steady_clock::now() + kro::microseconds(timeout_us);
+    while (shared->done_cycle.load(std::memory_order_acquire) != cycle) {
+        kro::steady_clock::time_point now = kro::steady_clock::now();
+        uint64_t remain_us = (now < deadline) ? (uint64_t)kro::duration_cast<kro::microseconds>(deadline - now).count() : 0;
+        if (!sandbox->response.wait(remain_us) && shared->done_cycle.load(std::memory_order_acquire) != cycle)
+            return fail();
+    }
+
+    std::copy_n(shared->slider_values, ysfx_max_sliders, sandbox->slider_values);
+    sandbox->midi_out_size = std::min<uint32_t>(shared->midi_out_size, ysfx_sandbox_midi_capacity);
+    memcpy(sandbox->midi_out.data(), shared->midi_out, sandbox->midi_out_size);
+    return true;
+}
+
+//------------------------------------------------------------------------------
+bool ysfx_sandbox_serve(ysfx_t *fx, const char *name)
+{
+    ysfx_shared_segment_t segment;
+    if (!segment.open(name))
+        return false;
+
+    ysfx_sandbox_shared_t *shared = (ysfx_sandbox_shared_t *)segment.data();
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (shared->magic != ysfx_sandbox_magic || shared->version != ysfx_sandbox_version ||
+        segment.size() < ysfx_sandbox_segment_size(shared->max_channels, shared->max_frames))
+        return false;
+
+    ysfx_ipc_semaphore_t request;
+    ysfx_ipc_semaphore_t response;
+    if (!request.open(std::string(name) + "-q", &shared->request_count) ||
+        !response.open(std::string(name) + "-r", &shared->response_count))
+        return false;
+
+    const uint32_t max_channels = shared->max_channels;
+    const uint32_t max_frames = shared->max_frames;
+    ysfx_real *audio = (ysfx_real *)(segment.data() + ysfx_sandbox_audio_offset());
+    std::vector<const ysfx_real *> ins(max_channels);
+    std::vector<ysfx_real *> outs(max_channels);
+    for (uint32_t i = 0; i < max_channels; ++i) {
+        ins[i] = &audio[(size_t)i * max_frames];
+        outs[i] = &audio[(size_t)(max_channels + i) * max_frames];
+    }
+
+    shared->connected.store(1, std::memory_order_release);
+
+    for (;;) {
+        if (!request.wait(ysfx_sandbox_idle_us)) {
+            if (shared->closed.load(std::memory_order_acquire) || !ysfx_sandbox_pid_alive(shared->host_pid))
+                return true;
+            continue;
+        }
+        if (shared->closed.load(std::memory_order_acquire))
+            return true;
+
+        const uint32_t cycle = shared->cycle.load(std::memory_order_acquire);
+        if (cycle == shared->done_cycle.load(std::memory_order_relaxed))
+            continue;
+
+        ysfx_set_sample_rate(fx, shared->sample_rate);
+        ysfx_set_block_size(fx, shared->block_size);
+        ysfx_set_time_info(fx, &shared->time_info);
+
+        const uint32_t num_slider_changes = std::min<uint32_t>(shared->num_slider_changes, ysfx_max_sliders);
+        for (uint32_t i = 0; i < num_slider_changes; ++i)
+            ysfx_slider_set_value(fx, shared->slider_changes[i].index, shared->slider_changes[i].value, true);
+
+        size_t pos = 0;
+        const size_t midi_in_size = std::min<uint32_t>(shared->midi_in_size, ysfx_sandbox_midi_capacity);
+        for (ysfx_midi_event_t event; ysfx_sandbox_get_midi(shared->midi_in, midi_in_size, pos, event); )
+            ysfx_send_midi(fx, &event);
+
+        const uint32_t num_ins = std::min(shared->num_ins, max_channels);
+        const uint32_t num_outs = std::min(shared->num_outs, max_channels);
+        const uint32_t num_frames = std::min(shared->num_frames, max_frames);
+        ysfx_process_double(fx, ins.data(), outs.data(), num_ins, num_outs, num_frames);
+
+        for (uint32_t i = 0; i < ysfx_max_sliders; ++i)
+            shared->slider_values[i] = ysfx_slider_get_value(fx, i);
+
+        uint32_t midi_out_size = 0;
+        for (ysfx_midi_event_t event; ysfx_receive_midi(fx, &event); )
+            ysfx_sandbox_put_midi(shared->midi_out, midi_out_size, ysfx_sandbox_midi_capacity, event);
+        shared->midi_out_size = midi_out_size;
+
+        shared->done_cycle.store(cycle, std::memory_order_release);
+        response.post();
+    }
+}
@@ -0,0 +1,156 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+#pragma once
+#include "ysfx.h"
+#include <atomic>
+#include <string>
+#include <vector>
+#include <cstdint>
+#if defined(_WIN32)
+#   include <windows.h>
+#elif !defined(__linux__)
+#   include <semaphore.h>
+#endif
+
+// The sandbox runs an effect in a child process, which shares a segment of
+// memory with the host. The segment holds what a cycle needs: the settings, the
+// slider changes and the MIDI of the host, what comes back of them from the
+// child, and the planes of audio, which the child processes in place.
+//
+// A cycle is a request of the host and a response of the child, numbered, so a
+// response which comes too late does not pass for the next one. Each holds the
+// buffers in turn, which is what makes them safe to use without locks.
+
+enum {
+    ysfx_sandbox_magic = 0x58425359, // "YSBX"
+    ysfx_sandbox_version = 1,
+    ysfx_sandbox_midi_capacity = 65536,
+};
+
+struct ysfx_sandbox_slider_change_t {
+    uint32_t index;
+    ysfx_real value;
+};
+
+struct ysfx_sandbox_shared_t {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t max_channels;
+    uint32_t max_frames;
+    uint64_t host_pid;
+    std::atomic<uint32_t> connected;
+    std::atomic<uint32_t> closed;
+    // the counts of the semaphores, as the futex words where they are
+    std::atomic<uint32_t> request_count;
+    std::atomic<uint32_t> response_count;
+    // the number of the cycle which the host requested, and of the one which the child did last
+    std::atomic<uint32_t> cycle;
+    std::atomic<uint32_t> done_cycle;
+
+    // the cycle, written by the host before its request
+    uint32_t num_ins;
+    uint32_t num_outs;
+    uint32_t num_frames;
+    uint32_t block_size;
+    ysfx_real sample_rate;
+    ysfx_time_info_t time_info;
+    uint32_t num_slider_changes;
+    ysfx_sandbox_slider_change_t slider_changes[ysfx_max_sliders];
+    uint32_t midi_in_size;
+    uint8_t midi_in[ysfx_sandbox_midi_capacity];
+
+    // the result, written by the child before its response
+    ysfx_real slider_values[ysfx_max_sliders];
+    uint32_t midi_out_size;
+    uint8_t midi_out[ysfx_sandbox_midi_capacity];
+};
+
+// the offset of the audio, after the header
+size_t ysfx_sandbox_audio_offset();
+// the size of the whole segment
+size_t ysfx_sandbox_segment_size(uint32_t max_channels, uint32_t max_frames);
+
+// a segment of memory which processes share by name
+class ysfx_shared_segment_t {
+public:
+    ysfx_shared_segment_t() = default;
+    ~ysfx_shared_segment_t() { close(); }
+    bool create(const std::string &name, size_t size);
+    bool open(const std::string &name);
+    void close();
+    uint8_t *data() const { return m_data; }
+    size_t size() const { return m_size; }
+private:
+    uint8_t *m_data = nullptr;
+    size_t m_size = 0;
+    bool m_owner = false;
+    std::string m_name;
+#if defined(_WIN32)
+    HANDLE m_mapping = nullptr;
+#endif
+    ysfx_shared_segment_t(const ysfx_shared_segment_t &) = delete;
+    ysfx_shared_segment_t &operator=(const ysfx_shared_segment_t &) = delete;
+};
+
+// a semaphore which processes share; on Linux, it's a futex on a word of the segment,
+//   elsewhere it's a semaphore of the system by name
+class ysfx_ipc_semaphore_t {
+public:
+    ysfx_ipc_semaphore_t() = default;
+    ~ysfx_ipc_semaphore_t() { close(); }
+    bool create(const std::string &name, std::atomic<uint32_t> *word);
+    bool open(const std::string &name, std::atomic<uint32_t> *word);
+    void close();
+    void post();
+    // wait for a post, spinning a little before it sleeps; false if the time is out
+    bool wait(uint64_t timeout_us);
+private:
+    bool try_wait();
+    std::atomic<uint32_t> *m_word = nullptr;
+#if defined(_WIN32)
+    HANDLE m_sem = nullptr;
+#elif !defined(__linux__)
+    sem_t *m_sem = nullptr;
+    bool m_owner = false;
+    std::string m_name;
+#endif
+    ysfx_ipc_semaphore_t(const ysfx_ipc_semaphore_t &) = delete;
+    ysfx_ipc_semaphore_t &operator=(const ysfx_ipc_semaphore_t &) = delete;
+};
+
+struct ysfx_sandbox_s {
+    std::string name;
+    ysfx_shared_segment_t segment;
+    ysfx_sandbox_shared_t *shared = nullptr;
+    ysfx_ipc_semaphore_t request;
+    ysfx_ipc_semaphore_t response;
+    std::vector<ysfx_real *> ins;
+    std::vector<ysfx_real *> outs;
+    uint32_t cycle = 0;
+    // the settings of the next cycle
+    uint32_t block_size = 128;
+    ysfx_real sample_rate = 44100;
+    ysfx_time_info_t time_info{120, ysfx_playback_playing, 0, 0, {4, 4}, false};
+    // what waits for the next cycle, and what came back of the last one
+    std::vector<ysfx_sandbox_slider_change_t> slider_changes;
+    std::vector<uint8_t> midi_in;
+    uint32_t midi_in_size = 0;
+    std::vector<uint8_t> midi_out;
+    uint32_t midi_out_size = 0;
+    size_t midi_out_pos = 0;
+    ysfx_real slider_values[ysfx_max_sliders] = {};
+};
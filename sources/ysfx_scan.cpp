@@ -0,0 +1,205 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "ysfx_scan.hpp"
+#include "ysfx_cache.hpp"
+#include "ysfx_config.hpp"
+#include "ysfx_package.hpp"
+#include "ysfx_reader.hpp"
+#include "ysfx_utils.hpp"
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <memory>
+
+// scan a package by the header which it holds, without reading its entries
+static ysfx_scan_t *ysfx_scan_package_header(ysfx_config_t *config, const char *filepath, const ysfx_package_t &package)
+{
+    std::unique_ptr<ysfx_scan_t> scan{new ysfx_scan_t};
+
+    ysfx_section_t section;
+    section.text = package.header;
+    ysfx_parse_error error;
+    if (!ysfx_parse_header(&section, scan->header, &error)) {
+        ysfx_logf(*config, ysfx_log_error, "%s:%u: %s", ysfx::path_file_name(filepath).c_str(), error.line + 1, error.message.c_str());
+        return nullptr;
+    }
+
+    if (scan->header.desc.empty())
+        scan->header.desc = ysfx::path_file_name(package.main.c_str());
+
+    return scan.release();
+}
+
+ysfx_scan_t *ysfx_scan_header(ysfx_config_t *config, const char *filepath)
+{
+    std::string entry;
+    ysfx_package_sp package = ysfx_package_find(filepath, &entry);
+    if (package && entry.empty())
+        return ysfx_scan_package_header(config, filepath, *package);
+
+    ysfx::file_uid uid;
+    ysfx::FILE_u stream;
+    ysfx_package_data_sp packaged = package ? ysfx_package_read(filepath) : nullptr;
+    if (packaged)
+        uid = packaged->package->uid;
+    else
+        stream.reset(ysfx::fopen_utf8(filepath, "rb"));
+    if (!packaged && (!stream || !ysfx::get_stream_file_uid(stream.get(), uid))) {
+        ysfx_logf(*config, ysfx_log_error, "%s: cannot open file for reading", ysfx::path_file_name(filepath).c_str());
+        return nullptr;
+    }
+
+    // the header is cached apart from the complete parse of the file
+    ysfx_cache_key_t key;
+    std::string key_string;
+    if (packaged) {
+        ysfx_cache_make_package_key(*config, uid, packaged->package->stamp, packaged->entry->key, {}, key);
+        key_string = "scan:" + ysfx_cache_key_string(key);
+    }
+    else if (ysfx_cache_make_key(*config, stream.get(), uid, {}, key))
+        key_string = "scan:" + ysfx_cache_key_string(key);
+
+    std::unique_ptr<ysfx_scan_t> scan{new ysfx_scan_t};
+    ysfx_parsed_unit_t unit;
+
+    if (key_string.empty() || !ysfx_cache_load(*config, key_string, unit)) {
+        ysfx_parse_error error;
+        std::unique_ptr<ysfx::text_reader> reader;
+        std::string text;
+        if (packaged) {
+            text.assign((const char *)packaged->data, packaged->size);
+            reader.reset(new ysfx::string_text_reader(text.c_str()));
+        }
+        else
+            reader.reset(new ysfx::stdio_text_reader(stream.get()));
+        if (!ysfx_parse_toplevel(*reader, unit.toplevel, &error, true) ||
+            !ysfx_parse_header(unit.toplevel.header.get(), unit.header, &error))
+        {
+            ysfx_logf(*config, ysfx_log_error, "%s:%u: %s", ysfx::path_file_name(filepath).c_str(), error.line + 1, error.message.c_str());
+            return nullptr;
+        }
+        if (!key_string.empty())
+            ysfx_cache_store(*config, key_string, unit);
+    }
+
+    scan->header = std::move(unit.header);
+    if (scan->header.desc.empty())
+        scan->header.desc = ysfx::path_file_name(filepath);
+
+    return scan.release();
+}
+
+void ysfx_scan_headers(ysfx_config_t *config, const char *const *filepaths, uint32_t count, ysfx_scan_t **results, uint32_t num_threads)
+{
+    std::atomic<uint32_t> next{0};
+
+    auto work = [&]() {
+        for (uint32_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < count; )
+            results[i] = ysfx_scan_header(config, filepaths[i]);
+    };
+
+    num_threads = std::max<uint32_t>(1, std::min(num_threads, count));
+
+    std::vector<std::thread> threads;
+    threads.reserve(num_threads - 1);
+    for (uint32_t i = 1; i < num_threads; ++i)
+        threads.emplace_back(work);
+    work();
+    for (std::thread &thread : threads)
+        thread.join();
+}
+
+void ysfx_scan_free(ysfx_scan_t *scan)
+{
+    delete scan;
+}
+
+const char *ysfx_scan_get_name(ysfx_scan_t *scan)
+{
+    return scan->header.desc.c_str();
+}
+
+const char *ysfx_scan_get_author(ysfx_scan_t *scan)
+{
+    return scan->header.author.c_str();
+}
+
+uint32_t ysfx_scan_get_tags(ysfx_scan_t *scan, const char **dest, uint32_t destsize)
+{
+    uint32_t count = (uint32_t)scan->header.tags.size();
+
+    uint32_t copysize = (destsize < count) ? destsize : count;
+    for (uint32_t i = 0; i < copysize; ++i)
+        dest[i] = scan->header.tags[i].c_str();
+
+    return count;
+}
+
+uint32_t ysfx_scan_get_num_inputs(ysfx_scan_t *scan)
+{
+    return (uint32_t)scan->header.in_pins.size();
+}
+
+uint32_t ysfx_scan_get_num_outputs(ysfx_scan_t *scan)
+{
+    return (uint32_t)scan->header.out_pins.size();
+}
+
+const char *ysfx_scan_get_input_name(ysfx_scan_t *scan, uint32_t index)
+{
+    if (index >= scan->header.in_pins.size())
+        return "";
+    return scan->header.in_pins[index].c_str();
+}
+
+const char *ysfx_scan_get_output_name(ysfx_scan_t *scan, uint32_t index)
+{
+    if (index >= scan->header.out_pins.size())
+        return "";
+    return scan->header.out_pins[index].c_str();
+}
+
+bool ysfx_scan_slider_exists(ysfx_scan_t *scan, uint32_t index)
+{
+    if (index >= ysfx_max_sliders)
+        return false;
+    return scan->header.sliders[index].exists;
+}
+
+const char *ysfx_scan_slider_get_name(ysfx_scan_t *scan, uint32_t index)
+{
+    if (index >= ysfx_max_sliders)
+        return "";
+    return scan->header.sliders[index].desc.c_str();
+}
+
+bool ysfx_scan_slider_get_curve(ysfx_scan_t *scan, uint32_t index, ysfx_slider_curve_t *curve)
+{
+    if (index >= ysfx_max_sliders)
+        return false;
+
+    const ysfx_slider_t &slider = scan->header.sliders[index];
+    curve->def = slider.def;
+    curve->min = slider.min;
+    curve->max = slider.max;
+    curve->inc = slider.inc;
+    curve->shape = slider.shape;
+    curve->modifier = slider.shape_modifier;
+    return true;
+}
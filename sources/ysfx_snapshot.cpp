@@ -0,0 +1,126 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+#include "ysfx_snapshot.hpp"
+#include "ysfx.hpp"
+#include <cstring>
+
+ysfx_snapshot_t *ysfx_snapshot_take(ysfx_t *fx, ysfx_snapshot_t *base)
+{
+    if (!fx->code.compiled)
+        return nullptr;
+
+    NSEEL_VMCTX vm = fx->vm.get();
+    std::unique_ptr<ysfx_snapshot_t> snap{new ysfx_snapshot_t};
+
+    auto save_var = [](const char *name, EEL_F *var, void *userdata) -> int {
+        ((ysfx_snapshot_t *)userdata)->vars.emplace_back(name, *var);
+        return 1;
+    };
+    NSEEL_VM_enumallvars(vm, +save_var, snap.get());
+
+    const size_t block_size = NSEEL_RAM_ITEMSPERBLOCK * sizeof(EEL_F);
+    snap->blocks.resize(NSEEL_RAM_BLOCKS);
+    for (uint32_t block = 0; block < NSEEL_RAM_BLOCKS; ++block) {
+        int valid = 0;
+        const EEL_F *src = NSEEL_VM_getramptr_noalloc(vm, block * NSEEL_RAM_ITEMSPERBLOCK, &valid);
+        if (!src || valid <= 0)
+            continue;
+        const ysfx_snapshot_block_sp *prev = base ? &base->blocks[block] : nullptr;
+        if (prev && *prev && !memcmp(prev->get(), src, block_size))
+            snap->blocks[block] = *prev;
+        else {
+            EEL_F *copy = new EEL_F[NSEEL_RAM_ITEMSPERBLOCK];
+            memcpy(copy, src, block_size);
+            snap->blocks[block].reset(copy, std::default_delete<ysfx_real[]>());
+        }
+    }
+
+    snap->strings.reset(ysfx_eel_string_context_new());
+    {
+        ysfx_string_scoped_lock lock{fx};
+        ysfx_eel_string_context_copy(snap->strings.get(), fx->string_ctx.get());
+    }
+
+    return snap.release();
+}
+
+bool ysfx_snapshot_restore(ysfx_t *fx, ysfx_snapshot_t *snap)
+{
+    if (!fx->code.compiled)
+        return false;
+
+    NSEEL_VMCTX vm = fx->vm.get();
+
+    for (const std::pair<std::string, ysfx_real> &var : snap->vars)
+        *NSEEL_VM_regvar(vm, var.first.c_str()) = var.second;
+
+    // write only the blocks which have changed since the snapshot
+    const size_t block_size = NSEEL_RAM_ITEMSPERBLOCK * sizeof(EEL_F);
+    for (uint32_t block = 0; block < NSEEL_RAM_BLOCKS; ++block) {
+        const EEL_F *src = snap->blocks[block].get();
+        unsigned addr = block * NSEEL_RAM_ITEMSPERBLOCK;
+        int valid = 0;
+        EEL_F *dst = src ? NSEEL_VM_getramptr(vm, addr, &valid) : NSEEL_VM_getramptr_noalloc(vm, addr, &valid);
+        if (!dst || valid < NSEEL_RAM_ITEMSPERBLOCK)
+            continue;
+        if (src) {
+            if (memcmp(dst, src, block_size))
+                memcpy(dst, src, block_size);
+        }
+        else
+            memset(dst, 0, block_size);
+    }
+
+    {
+        ysfx_string_scoped_lock lock{fx};
+        ysfx_eel_string_context_copy(fx->string_ctx.get(), snap->strings.get());
+    }
+    ysfx_eel_string_context_update_named_vars(fx->string_ctx.get(), vm);
+
+    fx->must_compute_slider = true;
+    return true;
+}
+
+void ysfx_snapshot_drop_zero_blocks(ysfx_snapshot_t *snap)
+{
+    for (ysfx_snapshot_block_sp &blk : snap->blocks) {
+        if (!blk)
+            continue;
+        const EEL_F *data = blk.get();
+        uint32_t i = 0;
+        while (i < NSEEL_RAM_ITEMSPERBLOCK && data[i] == 0)
+            ++i;
+        if (i == NSEEL_RAM_ITEMSPERBLOCK)
+            blk.reset();
+    }
+}
+
+void ysfx_snapshot_free(ysfx_snapshot_t *snap)
+{
+    delete snap;
+}
+
+size_t ysfx_snapshot_get_memory_size(ysfx_snapshot_t *snap, ysfx_snapshot_t *base)
+{
+    size_t size = 0;
+    for (uint32_t block = 0; block < NSEEL_RAM_BLOCKS; ++block) {
+        const ysfx_snapshot_block_sp &blk = snap->blocks[block];
+        if (blk && !(base && base->blocks[block] == blk))
+            size += NSEEL_RAM_ITEMSPERBLOCK * sizeof(EEL_F);
+    }
+    return size;
+}
@@ -0,0 +1,35 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+#pragma once
+#include "ysfx.h"
+#include "ysfx_eel_utils.hpp"
+#include "ysfx_api_eel.hpp"
+#include <memory>
+#include <string>
+#include <vector>
+
+// a copy of a block of VM memory, shared by the snapshots in which it's the same
+using ysfx_snapshot_block_sp = std::shared_ptr<const ysfx_real>;
+
+struct ysfx_snapshot_s {
+    std::vector<std::pair<std::string, ysfx_real>> vars;
+    std::vector<ysfx_snapshot_block_sp> blocks;
+    eel_string_context_state_u strings;
+};
+
+// release the copies of blocks which are all zero; a restore zeroes these blocks
+void ysfx_snapshot_drop_zero_blocks(ysfx_snapshot_t *snap);
@@ -0,0 +1,274 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "ysfx_specialize.hpp"
+#include "ysfx.hpp"
+#include "ysfx_config.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+static bool ysfx_is_ident_start(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+static bool ysfx_is_ident_char(char c)
+{
+    return ysfx_is_ident_start(c) || (c >= '0' && c <= '9') || c == '.';
+}
+
+// format a number which the lexer of EEL reads back identically
+//   it has no exponent notation, so these values are not substituted
+static bool ysfx_format_constant(EEL_F value, std::string &result)
+{
+    if (!std::isfinite(value))
+        return false;
+    char text[64];
+    int len = snprintf(text, sizeof(text), "%.17g", value);
+    if (len <= 0 || (size_t)len >= sizeof(text))
+        return false;
+    for (int i = 0; i < len; ++i) {
+        if (text[i] == ',')
+            text[i] = '.';
+        else if (text[i] == 'e' || text[i] == 'E')
+            return false;
+    }
+    result.assign("(");
+    result.append(text, (size_t)len);
+    result.push_back(')');
+    return true;
+}
+
+bool ysfx_specialize_text(const std::string &text, const std::vector<std::string> &names, const EEL_F *values, std::string &result)
+{
+    const char *src = text.data();
+    const size_t size = text.size();
+
+    struct occurrence_t {
+        size_t start;
+        size_t length;
+        size_t name;
+    };
+    std::vector<occurrence_t> occurrences;
+    std::vector<bool> excluded(names.size());
+
+    std::string ident;
+    size_t i = 0;
+    while (i < size) {
+        char c = src[i];
+
+        if (c == '/' && i + 1 < size && src[i + 1] == '/') {
+            while (i < size && src[i] != '\n')
+                ++i;
+            continue;
+        }
+        if (c == '/' && i + 1 < size && src[i + 1] == '*') {
+            size_t end = text.find("*/", i + 2);
+            i = (end == std::string::npos) ? size : (end + 2);
+            continue;
+        }
+        if (c == '"' || c == '\'') {
+            size_t end = i + 1;
+            while (end < size && src[end] != c)
+                end += (src[end] == '\\' && end + 1 < size) ? 2 : 1;
+            i = std::min(end + 1, size);
+            continue;
+        }
+        // the numbers and the constants like `$pi`, `$x1F`, `$'a'`
+        if (c == '$' && i + 1 < size && src[i + 1] == '\'') {
+            size_t end = text.find('\'', i + 2);
+            i = (end == std::string::npos) ? size : (end + 1);
+            continue;
+        }
+        if (c == '$' || c == '#' || (c >= '0' && c <= '9') || (c == '.' && i + 1 < size && src[i + 1] >= '0' && src[i + 1] <= '9')) {
+            ++i;
+            while (i < size && (ysfx_is_ident_char(src[i]) || src[i] == '~'))
+                ++i;
+            continue;
+        }
+        if (!ysfx_is_ident_start(c)) {
+            ++i;
+            continue;
+        }
+
+        size_t start = i;
+        while (i < size && ysfx_is_ident_char(src[i]))
+            ++i;
+        size_t length = i - start;
+
+        ident.assign(src + start, length);
+        std::transform(ident.begin(), ident.end(), ident.begin(), ysfx::ascii_tolower);
+
+        // the locals of the functions could have the same names
+        if (ident == "function")
+            return false;
+
+        size_t name = std::find(names.begin(), names.end(), ident) - names.begin();
+        if (name == names.size())
+            continue;
+
+        size_t next = i;
+        while (next < size && ysfx::ascii_isspace(src[next]))
+            ++next;
+        char n0 = (next < size) ? src[next] : '\0';
+        char n1 = (next + 1 < size) ? src[next + 1] : '\0';
+
+        // a call of a function which has the same name
+        if (n0 == '(')
+            continue;
+        // an assignment, or a use as the base of the memory
+        if ((n0 == '=' && n1 != '=') || n0 == '[' || (n1 == '=' && strchr("+-*/%^|&~", n0)))
+            excluded[name] = true;
+        else
+            occurrences.push_back(occurrence_t{start, length, name});
+    }
+
+    std::vector<std::string> literals(names.size());
+    for (size_t k = 0; k < names.size(); ++k) {
+        if (!excluded[k] && !ysfx_format_constant(values[k], literals[k]))
+            excluded[k] = true;
+    }
+
+    result.clear();
+    result.reserve(size + size / 4);
+    size_t pos = 0;
+    for (const occurrence_t &occ : occurrences) {
+        if (excluded[occ.name])
+            continue;
+        result.append(src + pos, occ.start - pos);
+        result.append(literals[occ.name]);
+        pos = occ.start + occ.length;
+    }
+    result.append(src + pos, size - pos);
+    return true;
+}
+
+//------------------------------------------------------------------------------
+ysfx_specializer_t::ysfx_specializer_t(ysfx_t *fx, const char *text, uint32_t line_offset, std::vector<std::string> names)
+    : m_fx(fx),
+      m_text(text),
+      m_line_offset(line_offset),
+      m_names(std::move(names))
+{
+    const size_t count = m_names.size();
+    m_vars.resize(count);
+    for (size_t i = 0; i < count; ++i)
+        m_vars[i] = NSEEL_VM_regvar(fx->vm.get(), m_names[i].c_str());
+    m_requested.resize(count);
+    m_request.reset(new std::atomic<ysfx_real>[count]);
+    for (size_t i = 0; i < count; ++i)
+        m_request[i].store(0);
+
+    m_thread = std::thread([this]() { run(); });
+}
+
+ysfx_specializer_t::~ysfx_specializer_t()
+{
+    m_quit.store(true);
+    m_wake.post();
+    m_thread.join();
+
+    uint32_t count = m_count.load();
+    for (uint32_t i = 0; i < count; ++i) {
+        if (m_variants[i].code)
+            NSEEL_code_free(m_variants[i].code);
+    }
+}
+
+bool ysfx_specializer_t::matches(const variant_t &variant) const
+{
+    for (size_t i = 0, n = m_vars.size(); i < n; ++i) {
+        if (memcmp(&variant.values[i], m_vars[i], sizeof(EEL_F)) != 0)
+            return false;
+    }
+    return true;
+}
+
+NSEEL_CODEHANDLE ysfx_specializer_t::code()
+{
+    uint32_t count = m_count.load(std::memory_order_acquire);
+
+    if (m_current < count && matches(m_variants[m_current]))
+        return m_variants[m_current].code;
+    for (uint32_t i = 0; i < count; ++i) {
+        if (matches(m_variants[i])) {
+            m_current = i;
+            return m_variants[i].code;
+        }
+    }
+
+    // when the cache is full, the values which come next run the generic code
+    if (count == max_variants)
+        return nullptr;
+
+    const size_t n = m_vars.size();
+    bool same = m_has_requested;
+    for (size_t i = 0; same && i < n; ++i)
+        same = memcmp(&m_requested[i], m_vars[i], sizeof(EEL_F)) == 0;
+    if (!same) {
+        for (size_t i = 0; i < n; ++i) {
+            m_requested[i] = *m_vars[i];
+            m_request[i].store(m_requested[i], std::memory_order_relaxed);
+        }
+        m_has_requested = true;
+        m_wake.post();
+    }
+    return nullptr;
+}
+
+void ysfx_specializer_t::run()
+{
+    std::string text;
+    const size_t n = m_names.size();
+
+    for (;;) {
+        m_wake.wait();
+        if (m_quit.load())
+            break;
+
+        uint32_t count = m_count.load();
+        if (count == max_variants)
+            continue;
+
+        variant_t &variant = m_variants[count];
+        variant.values.resize(n);
+        for (size_t i = 0; i < n; ++i)
+            variant.values[i] = m_request[i].load(std::memory_order_relaxed);
+
+        // the requests can repeat, if the values went back and forth
+        bool known = false;
+        for (uint32_t k = 0; k < count && !known; ++k)
+            known = memcmp(m_variants[k].values.data(), variant.values.data(), n * sizeof(EEL_F)) == 0;
+        if (known)
+            continue;
+
+        if (!ysfx_specialize_text(m_text, m_names, variant.values.data(), text))
+            continue;
+
+        {
+            std::lock_guard<ysfx::mutex> lock{m_fx->lazy_code_mutex};
+            NSEEL_VMCTX vm = m_fx->vm.get();
+            variant.code = NSEEL_code_compile_ex(vm, text.c_str(), m_line_offset, NSEEL_CODE_COMPILE_FLAG_COMMONFUNCS);
+            if (!variant.code)
+                ysfx_logf(*m_fx->config, ysfx_log_warning, "@sample: cannot specialize: %s", NSEEL_code_getcodeerror(vm));
+        }
+
+        m_count.store(count + 1, std::memory_order_release);
+    }
+}
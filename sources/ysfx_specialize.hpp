@@ -0,0 +1,80 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+#include "ysfx.h"
+#include "utility/rt_semaphore.h"
+#include "WDL/eel2/ns-eel.h"
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <memory>
+
+// replace the reads of the variables by their values, in the text of a section;
+//   the compiler of EEL then folds the constant expressions, and removes the
+//   branches which do not run with these values
+//   the names are in lower case; a variable which the text assigns is left as is
+//   it fails if the text defines functions, whose variables may be local
+bool ysfx_specialize_text(const std::string &text, const std::vector<std::string> &names, const EEL_F *values, std::string &result);
+
+// keeps variants of a section compiled for the values of the variables which
+//   the header declares constant, using `options:const=name1,name2`
+//   they compile on a thread of their own, while the code which is not
+//   specialized runs; the variants are kept until the code is unloaded
+struct ysfx_specializer_t {
+    ysfx_specializer_t(ysfx_t *fx, const char *text, uint32_t line_offset, std::vector<std::string> names);
+    // NOTE: this waits for the compilation which is in progress, if any
+    ~ysfx_specializer_t();
+
+    // get the variant for the current values, or null if it is not ready yet,
+    //   which requests it; this is for the audio thread
+    NSEEL_CODEHANDLE code();
+    // the count of the variants which are compiled
+    uint32_t variant_count() const { return m_count.load(); }
+
+private:
+    enum { max_variants = 16 };
+
+    struct variant_t {
+        std::vector<ysfx_real> values;
+        // null if the compilation failed, which makes the generic code run
+        NSEEL_CODEHANDLE code = nullptr;
+    };
+
+    bool matches(const variant_t &variant) const;
+    void run();
+
+    ysfx_t *m_fx = nullptr;
+    std::string m_text;
+    uint32_t m_line_offset = 0;
+    std::vector<std::string> m_names;
+    std::vector<ysfx_real *> m_vars;
+    variant_t m_variants[max_variants];
+    std::atomic<uint32_t> m_count{0};
+    // the variant which ran last, for the audio thread
+    uint32_t m_current = ~(uint32_t)0;
+    // the values of the last request, to not repeat it
+    std::vector<ysfx_real> m_requested;
+    bool m_has_requested = false;
+    std::unique_ptr<std::atomic<ysfx_real>[]> m_request;
+    std::atomic<bool> m_quit{false};
+    RTSemaphore m_wake;
+    std::thread m_thread;
+};
+
+using ysfx_specializer_u = std::unique_ptr<ysfx_specializer_t>;
@@ -0,0 +1,157 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "ysfx_swap.hpp"
+#include "ysfx.hpp"
+#include <algorithm>
+#include <cstring>
+
+ysfx_swap_t *ysfx_swap_new(ysfx_t *fx)
+{
+    ysfx_swap_t *swap = new ysfx_swap_t;
+    ysfx_add_ref(fx);
+    swap->current = fx;
+    return swap;
+}
+
+void ysfx_swap_free(ysfx_swap_t *swap)
+{
+    if (!swap)
+        return;
+
+    delete swap->pending.exchange(nullptr);
+    delete swap->retired.exchange(nullptr);
+    ysfx_free(swap->current.load());
+    delete swap;
+}
+
+// give the replacement the settings of the host, and the blocks of memory which it will receive
+static void ysfx_swap_prepare(ysfx_t *fx, ysfx_t *old, uint32_t options)
+{
+    ysfx_set_sample_rate(fx, old->sample_rate);
+    ysfx_set_block_size(fx, old->block_size);
+    ysfx_set_midi_capacity(fx, (uint32_t)old->midi.in->data.capacity(), old->midi.in->extensible);
+    ysfx_set_midi_sysex_capacity(fx, old->midi.in->has_pool ? (uint32_t)old->midi.in->pool.capacity() : 0);
+    ysfx_set_midi_output_sorted(fx, old->midi.sort_output);
+    ysfx_set_midi_output_deduplicated(fx, old->midi.dedup_output, old->midi.dedup_interval);
+    ysfx_set_midi_queue_capacity(fx, old->midi.queue->events.capacity());
+    ysfx_set_denormal_mode(fx, old->denormal_mode);
+    ysfx_set_silence_skip(fx, old->silence.num_blocks, old->silence.threshold);
+    ysfx_set_sample_accurate(fx, old->split.min_frames);
+    ysfx_set_audio_file_read_ahead(fx, old->file.read_ahead);
+    ysfx_set_audio_file_resampling(fx, old->file.resample);
+    ysfx_set_lossless_serialization(fx, old->file.serialize_f64);
+    ysfx_set_slider_queue_capacity(fx, old->slider.queue.capacity());
+    ysfx_set_slider_automation_capacity(fx, old->slider.automation.capacity());
+    ysfx_set_oversampling(fx, old->oversampling.factor);
+    ysfx_set_profiling(fx, old->profile.enabled.load(std::memory_order_relaxed));
+    if (old->profile.line_sampler)
+        ysfx_set_line_sampling(fx, true, old->profile.line_sampler->period_us());
+
+    ysfx_init(fx);
+
+    if (options & ysfx_swap_keep_memory) {
+        // allocate now, so the audio thread only has to copy
+        // NOTE: blocks which the old effect allocates after this point are not kept
+        for (uint32_t block = 0; block < NSEEL_RAM_BLOCKS; ++block) {
+            int valid = 0;
+            unsigned addr = block * NSEEL_RAM_ITEMSPERBLOCK;
+            if (NSEEL_VM_getramptr_noalloc(old->vm.get(), addr, &valid) && valid > 0)
+                NSEEL_VM_getramptr(fx->vm.get(), addr, &valid);
+        }
+    }
+}
+
+// move the state of the old effect into the new, on the audio thread
+static void ysfx_swap_migrate(ysfx_t *fx, ysfx_t *old, uint32_t options)
+{
+    if (options & ysfx_swap_keep_sliders) {
+        for (uint32_t i = 0; i < ysfx_max_sliders; ++i) {
+            if (ysfx_slider_exists(fx, i) && ysfx_slider_exists(old, i))
+                ysfx_slider_set_value(fx, i, *old->var.slider[i], true);
+        }
+    }
+
+    if (options & ysfx_swap_keep_memory) {
+        for (uint32_t block = 0; block < NSEEL_RAM_BLOCKS; ++block) {
+            int src_valid = 0;
+            int dst_valid = 0;
+            unsigned addr = block * NSEEL_RAM_ITEMSPERBLOCK;
+            EEL_F *src = NSEEL_VM_getramptr_noalloc(old->vm.get(), addr, &src_valid);
+            if (!src || src_valid <= 0)
+                continue;
+            EEL_F *dst = NSEEL_VM_getramptr_noalloc(fx->vm.get(), addr, &dst_valid);
+            if (!dst || dst_valid <= 0)
+                continue;
+            memcpy(dst, src, (size_t)std::min(src_valid, dst_valid) * sizeof(EEL_F));
+        }
+    }
+}
+
+void ysfx_swap_publish(ysfx_swap_t *swap, ysfx_t *fx, uint32_t options)
+{
+    ysfx_swap_pending_t *pending = new ysfx_swap_pending_t;
+    ysfx_add_ref(fx);
+    pending->fx.reset(fx);
+    pending->options = options;
+
+    ysfx_swap_prepare(fx, swap->current.load(std::memory_order_acquire), options);
+
+    // replace any effect which was published, but not installed yet
+    delete swap->pending.exchange(pending, std::memory_order_acq_rel);
+}
+
+bool ysfx_swap_reload(ysfx_swap_t *swap, const char *filepath, uint32_t loadopts, uint32_t compileopts, uint32_t options)
+{
+    ysfx_u fx{ysfx_new(ysfx_get_config(swap->current.load(std::memory_order_acquire)))};
+
+    if (!ysfx_load_file(fx.get(), filepath, loadopts))
+        return false;
+    if (!ysfx_compile(fx.get(), compileopts))
+        return false;
+
+    ysfx_swap_publish(swap, fx.get(), options);
+    return true;
+}
+
+ysfx_t *ysfx_swap_acquire(ysfx_swap_t *swap)
+{
+    ysfx_t *current = swap->current.load(std::memory_order_relaxed);
+
+    // wait until the previous effect is collected, since it can't be freed here
+    if (swap->retired.load(std::memory_order_acquire))
+        return current;
+
+    ysfx_swap_pending_t *pending = swap->pending.exchange(nullptr, std::memory_order_acq_rel);
+    if (!pending)
+        return current;
+
+    ysfx_t *fx = pending->fx.release();
+    ysfx_swap_migrate(fx, current, pending->options);
+
+    // the node returns to the loading thread, carrying the old effect
+    pending->fx.reset(current);
+    swap->current.store(fx, std::memory_order_release);
+    swap->retired.store(pending, std::memory_order_release);
+
+    return fx;
+}
+
+void ysfx_swap_collect(ysfx_swap_t *swap)
+{
+    delete swap->retired.exchange(nullptr, std::memory_order_acq_rel);
+}
@@ -0,0 +1,35 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+#include "ysfx.h"
+#include <atomic>
+
+// an effect which waits to be installed, with the options of the swap
+struct ysfx_swap_pending_t {
+    ysfx_u fx;
+    uint32_t options = 0;
+};
+
+struct ysfx_swap_s {
+    // the effect in use by the audio thread
+    std::atomic<ysfx_t *> current{nullptr};
+    // the next effect, published by the loading thread
+    std::atomic<ysfx_swap_pending_t *> pending{nullptr};
+    // the effect which was replaced, to be freed by the loading thread
+    std::atomic<ysfx_swap_pending_t *> retired{nullptr};
+};
@@ -0,0 +1,288 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "ysfx_trace.hpp"
+#include "ysfx_utils.hpp"
+#include <memory>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstdio>
+#include <cinttypes>
+
+std::atomic<bool> ysfx_trace_on{false};
+
+namespace {
+
+enum {
+    // the number of events which a thread keeps until the trace is written
+    ysfx_trace_ring_size = 8192,
+    // the depth of the spans which the host opens with `ysfx_trace_begin`
+    ysfx_trace_max_depth = 32,
+};
+
+enum ysfx_trace_kind_t : uint8_t {
+    ysfx_trace_kind_span,
+    ysfx_trace_kind_count,
+};
+
+struct ysfx_trace_event_t {
+    const char *name;
+    const char *category;
+    uint64_t time_ns;
+    // the end of a span, or the value of a counter
+    int64_t data;
+    ysfx_trace_kind_t kind;
+};
+
+// a single producer, the thread, and a single consumer, the writer
+struct ysfx_trace_ring_t {
+    uint32_t thread = 0;
+    std::atomic<const char *> thread_name{nullptr};
+    std::atomic<uint64_t> write_count{0};
+    std::atomic<uint64_t> read_count{0};
+    std::atomic<uint64_t> dropped{0};
+    // set when the thread exits, the writer deletes the ring once it is empty
+    std::atomic<bool> orphan{false};
+    ysfx_trace_event_t events[ysfx_trace_ring_size];
+
+    // the spans which the host opened, only accessed by the thread
+    uint32_t depth = 0;
+    const char *open_names[ysfx_trace_max_depth];
+    uint64_t open_times[ysfx_trace_max_depth];
+};
+
+struct ysfx_trace_registry_t {
+    ysfx::mutex mutex;
+    std::vector<std::unique_ptr<ysfx_trace_ring_t>> rings;
+    uint32_t next_thread = 1;
+    uint64_t epoch_ns = ysfx::monotonic_ns();
+};
+
+static ysfx_trace_registry_t &ysfx_trace_registry()
+{
+    static ysfx_trace_registry_t registry;
+    return registry;
+}
+
+struct ysfx_trace_thread_t {
+    ysfx_trace_ring_t *ring = nullptr;
+    ~ysfx_trace_thread_t()
+    {
+        if (ring)
+            ring->orphan.store(true, std::memory_order_release);
+        ring = nullptr;
+    }
+};
+
+static thread_local ysfx_trace_thread_t ysfx_trace_thread;
+
+// NOTE: the first event of a thread allocates its ring
+static ysfx_trace_ring_t *ysfx_trace_get_ring()
+{
+    ysfx_trace_ring_t *ring = ysfx_trace_thread.ring;
+    if (!ring) {
+        ysfx_trace_registry_t &registry = ysfx_trace_registry();
+        std::lock_guard<ysfx::mutex> lock{registry.mutex};
+        ring = new ysfx_trace_ring_t;
+        ring->thread = registry.next_thread++;
+        registry.rings.emplace_back(ring);
+        ysfx_trace_thread.ring = ring;
+    }
+    return ring;
+}
+
+static void ysfx_trace_push(const ysfx_trace_event_t &event)
+{
+    ysfx_trace_ring_t *ring = ysfx_trace_get_ring();
+    uint64_t w = ring->write_count.load(std::memory_order_relaxed);
+    uint64_t r = ring->read_count.load(std::memory_order_acquire);
+    if (w - r >= ysfx_trace_ring_size) {
+        ring->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    ring->events[w % ysfx_trace_ring_size] = event;
+    ring->write_count.store(w + 1, std::memory_order_release);
+}
+
+static void ysfx_trace_write_string(FILE *stream, const char *text)
+{
+    fputc('"', stream);
+    for (const char *p = text ? text : ""; *p; ++p) {
+        unsigned char c = (unsigned char)*p;
+        if (c == '"' || c == '\\')
+            fprintf(stream, "\\%c", c);
+        else if (c < 0x20)
+            fprintf(stream, "\\u%04x", c);
+        else
+            fputc(c, stream);
+    }
+    fputc('"', stream);
+}
+
+} // namespace
+
+//------------------------------------------------------------------------------
+void ysfx_trace_span(const char *name, const char *category, uint64_t begin_ns, uint64_t end_ns)
+{
+    ysfx_trace_push(ysfx_trace_event_t{name, category, begin_ns, (int64_t)end_ns, ysfx_trace_kind_span});
+}
+
+void ysfx_trace_count(const char *name, int64_t value)
+{
+    ysfx_trace_push(ysfx_trace_event_t{name, nullptr, ysfx::monotonic_ns(), value, ysfx_trace_kind_count});
+}
+
+void ysfx_trace_name_thread(const char *name)
+{
+    ysfx_trace_get_ring()->thread_name.store(name, std::memory_order_relaxed);
+}
+
+ysfx_trace_scope::ysfx_trace_scope(const char *name, const char *category)
+{
+    if (!ysfx_trace_enabled())
+        return;
+    m_name = name;
+    m_category = category;
+    m_begin = ysfx::monotonic_ns();
+}
+
+ysfx_trace_scope::~ysfx_trace_scope()
+{
+    if (m_name)
+        ysfx_trace_span(m_name, m_category, m_begin, ysfx::monotonic_ns());
+}
+
+//------------------------------------------------------------------------------
+void ysfx_set_tracing(bool enable)
+{
+    // start the clock of the trace before the first event
+    ysfx_trace_registry();
+    ysfx_trace_on.store(enable, std::memory_order_relaxed);
+}
+
+bool ysfx_is_tracing()
+{
+    return ysfx_trace_enabled();
+}
+
+void ysfx_trace_begin(const char *name)
+{
+    if (!ysfx_trace_enabled())
+        return;
+    ysfx_trace_ring_t *ring = ysfx_trace_get_ring();
+    if (ring->depth < ysfx_trace_max_depth) {
+        ring->open_names[ring->depth] = name;
+        ring->open_times[ring->depth] = ysfx::monotonic_ns();
+    }
+    ++ring->depth;
+}
+
+void ysfx_trace_end()
+{
+    ysfx_trace_ring_t *ring = ysfx_trace_thread.ring;
+    if (!ring || ring->depth == 0)
+        return;
+    --ring->depth;
+    if (ring->depth < ysfx_trace_max_depth && ysfx_trace_enabled())
+        ysfx_trace_span(ring->open_names[ring->depth], "host", ring->open_times[ring->depth], ysfx::monotonic_ns());
+}
+
+void ysfx_trace_value(const char *name, int64_t value)
+{
+    if (ysfx_trace_enabled())
+        ysfx_trace_count(name, value);
+}
+
+void ysfx_trace_thread_name(const char *name)
+{
+    if (ysfx_trace_enabled())
+        ysfx_trace_name_thread(name);
+}
+
+bool ysfx_write_trace(const char *path)
+{
+    ysfx_trace_registry_t &registry = ysfx_trace_registry();
+    std::lock_guard<ysfx::mutex> lock{registry.mutex};
+
+    ysfx::FILE_u stream{ysfx::fopen_utf8(path, "wb")};
+    if (!stream)
+        return false;
+    FILE *out = stream.get();
+
+    fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", out);
+    bool first = true;
+    auto separate = [&]() {
+        fputs(first ? "\n" : ",\n", out);
+        first = false;
+    };
+
+    std::vector<ysfx_trace_event_t> events;
+    for (const std::unique_ptr<ysfx_trace_ring_t> &ring : registry.rings) {
+        // take the events which are complete, and give the space back
+        uint64_t r = ring->read_count.load(std::memory_order_relaxed);
+        uint64_t w = ring->write_count.load(std::memory_order_acquire);
+        events.clear();
+        events.reserve((size_t)(w - r));
+        for (uint64_t i = r; i < w; ++i)
+            events.push_back(ring->events[i % ysfx_trace_ring_size]);
+        ring->read_count.store(w, std::memory_order_release);
+
+        if (const char *name = ring->thread_name.load(std::memory_order_relaxed)) {
+            separate();
+            fprintf(out, "{\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"name\":\"thread_name\",\"args\":{\"name\":", ring->thread);
+            ysfx_trace_write_string(out, name);
+            fputs("}}", out);
+        }
+
+        for (const ysfx_trace_event_t &event : events) {
+            double ts = (double)(int64_t)(event.time_ns - registry.epoch_ns) * 1e-3;
+            separate();
+            if (event.kind == ysfx_trace_kind_span) {
+                double dur = (double)((uint64_t)event.data - event.time_ns) * 1e-3;
+                fprintf(out, "{\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"cat\":", ring->thread, ts, dur);
+                ysfx_trace_write_string(out, event.category);
+                fputs(",\"name\":", out);
+                ysfx_trace_write_string(out, event.name);
+                fputc('}', out);
+            }
+            else {
+                fprintf(out, "{\"ph\":\"C\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"name\":", ring->thread, ts);
+                ysfx_trace_write_string(out, event.name);
+                fprintf(out, ",\"args\":{\"value\":%" PRId64 "}}", event.data);
+            }
+        }
+
+        // the events which did not fit, between two writes of the trace
+        if (uint64_t dropped = ring->dropped.exchange(0, std::memory_order_relaxed)) {
+            separate();
+            fprintf(out, "{\"ph\":\"C\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"name\":\"dropped events\",\"args\":{\"value\":%" PRIu64 "}}",
+                    ring->thread, (double)(int64_t)(ysfx::monotonic_ns() - registry.epoch_ns) * 1e-3, dropped);
+        }
+    }
+
+    // forget the threads which exited, once their rings are empty
+    registry.rings.erase(
+        std::remove_if(registry.rings.begin(), registry.rings.end(), [](const std::unique_ptr<ysfx_trace_ring_t> &ring) {
+            return ring->orphan.load(std::memory_order_acquire) &&
+                ring->read_count.load(std::memory_order_relaxed) == ring->write_count.load(std::memory_order_acquire);
+        }),
+        registry.rings.end());
+
+    fputs("\n]}\n", out);
+    return fflush(out) == 0 && !ferror(out);
+}
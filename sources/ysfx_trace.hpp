@@ -0,0 +1,54 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+#include "ysfx.h"
+#include <atomic>
+#include <cstdint>
+
+// the recording of a trace of the activity, on every thread: each thread
+//   writes into a ring of its own without locking, and the writer of the
+//   trace empties the rings; the names are constant strings, which are kept
+//   by address until the trace is written
+
+extern std::atomic<bool> ysfx_trace_on;
+
+inline bool ysfx_trace_enabled()
+{
+    return ysfx_trace_on.load(std::memory_order_relaxed);
+}
+
+// record a span of the calling thread, between times of `ysfx::monotonic_ns`
+void ysfx_trace_span(const char *name, const char *category, uint64_t begin_ns, uint64_t end_ns);
+// record the value of a counter
+void ysfx_trace_count(const char *name, int64_t value);
+// name the calling thread
+void ysfx_trace_name_thread(const char *name);
+
+// record a span over the lifetime of the object, if tracing when it is created
+class ysfx_trace_scope {
+public:
+    ysfx_trace_scope(const char *name, const char *category);
+    ~ysfx_trace_scope();
+
+private:
+    const char *m_name = nullptr;
+    const char *m_category = nullptr;
+    uint64_t m_begin = 0;
+    ysfx_trace_scope(const ysfx_trace_scope &) = delete;
+    ysfx_trace_scope &operator=(const ysfx_trace_scope &) = delete;
+};
@@ -16,7 +16,6 @@
 //
 
 #include "ysfx_utils.hpp"
-#include "base64/Base64.hpp"
 #include <system_error>
 #include <algorithm>
 #include <deque>
@@ -25,16 +24,23 @@
 #include <clocale>
 #include <cstring>
 #include <cassert>
+#include <chrono>
 #if !defined(_WIN32)
 #   include <sys/stat.h>
 #   include <sys/types.h>
 #   include <unistd.h>
 #   include <dirent.h>
 #   include <fcntl.h>
+#   include <sys/mman.h>
 #else
 #   include <windows.h>
 #   include <io.h>
 #endif
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#   include <xmmintrin.h>
+#elif defined(_M_ARM64)
+#   include <intrin.h>
+#endif
 
 namespace ysfx {
 
@@ -189,14 +195,337 @@ double c_strtod(const char *text, char **endp, c_locale_t loc)
 #endif
 }
 
+//------------------------------------------------------------------------------
+// the parsing of numbers, without the locale; decimals go by the fast path of
+//   Clinger when they convert exactly, else by the one of Eisel and Lemire, and
+//   the rest, such as hexadecimals, inf and nan, or the cases which are too close
+//   to halfway, by the C library
+
+namespace {
+
+struct u128 {
+    uint64_t hi;
+    uint64_t lo;
+};
+
+u128 mul_64x64(uint64_t a, uint64_t b)
+{
+#if defined(__SIZEOF_INT128__)
+    unsigned __int128 r = (unsigned __int128)a * b;
+    return {(uint64_t)(r >> 64), (uint64_t)r};
+#else
+    uint64_t a0 = (uint32_t)a, a1 = a >> 32;
+    uint64_t b0 = (uint32_t)b, b1 = b >> 32;
+    uint64_t p00 = a0 * b0, p01 = a0 * b1, p10 = a1 * b0, p11 = a1 * b1;
+    uint64_t mid = (p00 >> 32) + (uint32_t)p01 + (uint32_t)p10;
+    return {p11 + (p01 >> 32) + (p10 >> 32) + (mid >> 32), (mid << 32) | (uint32_t)p00};
+#endif
+}
+
+int count_leading_zeros(uint64_t x)
+{
+#if defined(__GNUC__)
+    if (x)
+        return __builtin_clzll(x);
+#endif
+    int n = 0;
+    for (uint64_t bit = (uint64_t)1 << 63; bit && !(x & bit); bit >>= 1)
+        ++n;
+    return n;
+}
+
+// the powers of 10 from 10^-342 to 10^308, as the 128 bits of their powers of 5,
+//   truncated above 1 and rounded up below, as the algorithm requires
+struct pow10_table {
+    enum { min_power = -342, max_power = 308 };
+    u128 power[max_power - min_power + 1];
+
+    pow10_table();
+
+    const u128 &get(int q) const { return power[q - min_power]; }
+
+private:
+    using big = std::vector<uint32_t>;
+    static uint32_t bit_length(const big &n);
+    static uint32_t window(const big &n, int64_t pos);
+    static u128 top_128(const big &n);
+};
+
+pow10_table::pow10_table()
+{
+    // 5^k for the positive powers, multiplied up
+    big n{1};
+    for (int q = 0; q <= max_power; ++q) {
+        power[q - min_power] = top_128(n);
+        uint64_t carry = 0;
+        for (uint32_t &limb : n) {
+            carry += (uint64_t)limb * 5;
+            limb = (uint32_t)carry;
+            carry >>= 32;
+        }
+        if (carry)
+            n.push_back((uint32_t)carry);
+    }
+
+    // 2^b / 5^k for the negative ones, divided down from a large power of 2
+    //   which has the bits of all of them; 5^k is in n when its turn comes
+    const int64_t big_b = 1728;
+    big x((size_t)(big_b / 32 + 1), 0);
+    x.back() = 1;
+    big p5{1};
+    for (int k = 1; k <= -min_power; ++k) {
+        uint64_t rem = 0;
+        for (size_t i = x.size(); i-- > 0;) {
+            uint64_t cur = (rem << 32) | x[i];
+            x[i] = (uint32_t)(cur / 5);
+            rem = cur % 5;
+        }
+        uint64_t carry = 0;
+        for (uint32_t &limb : p5) {
+            carry += (uint64_t)limb * 5;
+            limb = (uint32_t)carry;
+            carry >>= 32;
+        }
+        if (carry)
+            p5.push_back((uint32_t)carry);
+
+        const int64_t z = bit_length(p5);
+        const int64_t b = (k <= 27) ? (z + 127) : (2 * z + 128);
+        // floor(2^b / 5^k) + 1, which is not exact, so the sum is the ceiling
+        big f((size_t)(b / 32 + 2), 0);
+        for (size_t i = 0; i < f.size(); ++i)
+            f[i] = window(x, big_b - b + 32 * (int64_t)i);
+        for (size_t i = 0; i < f.size() && ++f[i] == 0; ++i)
+            ;
+        power[-k - min_power] = top_128(f);
+    }
+}
+
+uint32_t pow10_table::bit_length(const big &n)
+{
+    for (size_t i = n.size(); i-- > 0;) {
+        if (n[i])
+            return 32 * (uint32_t)i + 64 - (uint32_t)count_leading_zeros(n[i]);
+    }
+    return 0;
+}
+
+// the 32 bits from a position, which can be below 0
+uint32_t pow10_table::window(const big &n, int64_t pos)
+{
+    uint64_t bits = 0;
+    for (int i = 0; i < 2; ++i) {
+        int64_t limb = (pos >= 0) ? (pos / 32 + i) : ((pos - 31) / 32 + i);
+        if (limb >= 0 && (size_t)limb < n.size())
+            bits |= (uint64_t)n[(size_t)limb] << (32 * i);
+    }
+    int64_t shift = pos - 32 * ((pos >= 0) ? (pos / 32) : ((pos - 31) / 32));
+    return (uint32_t)(bits >> shift);
+}
+
+u128 pow10_table::top_128(const big &n)
+{
+    const int64_t top = bit_length(n);
+    u128 r;
+    r.hi = ((uint64_t)window(n, top - 32) << 32) | window(n, top - 64);
+    r.lo = ((uint64_t)window(n, top - 96) << 32) | window(n, top - 128);
+    return r;
+}
+
+// the double of w * 10^q, or false if it needs the exact computation
+bool eisel_lemire(uint64_t w, int q, bool negative, double &value)
+{
+    if (w == 0 || q < pow10_table::min_power || q > pow10_table::max_power)
+        return false;
+
+    static const pow10_table table;
+    const u128 &power = table.get(q);
+
+    int lz = count_leading_zeros(w);
+    w <<= lz;
+    u128 product = mul_64x64(w, power.hi);
+    uint64_t upper = product.hi;
+    uint64_t lower = product.lo;
+    if ((upper & 0x1FF) == 0x1FF && lower + w < lower) {
+        u128 second = mul_64x64(w, power.lo);
+        uint64_t middle = lower + second.hi;
+        if (middle < lower)
+            ++upper;
+        if (middle + 1 == 0 && (upper & 0x1FF) == 0x1FF && second.lo + w < second.lo)
+            return false;
+        lower = middle;
+    }
+
+    const uint64_t upperbit = upper >> 63;
+    uint64_t mantissa = upper >> (upperbit + 9);
+    lz += (int)(1 ^ upperbit);
+    // too close to halfway between two doubles
+    if (lower == 0 && (upper & 0x1FF) == 0 && (mantissa & 3) == 1)
+        return false;
+
+    mantissa += mantissa & 1;
+    mantissa >>= 1;
+    if (mantissa >= ((uint64_t)1 << 53)) {
+        mantissa = (uint64_t)1 << 52;
+        --lz;
+    }
+    mantissa &= ~((uint64_t)1 << 52);
+
+    // the binary exponent is floor(q * log2(10)), biased
+    const int64_t exponent = ((((int64_t)152170 + 65536) * q) >> 16) + 1024 + 63 - lz;
+    // the subnormals and the infinities are for the C library
+    if (exponent < 1 || exponent > 2046)
+        return false;
+
+    uint64_t bits = mantissa | ((uint64_t)exponent << 52) | ((uint64_t)negative << 63);
+    memcpy(&value, &bits, sizeof(value));
+    return true;
+}
+
+// the end of a text, at a pointer or at the terminator
+struct range_end {
+    const char *end;
+    bool at(const char *p) const { return p == end; }
+};
+
+struct null_end {
+    bool at(const char *p) const { return *p == '\0'; }
+};
+
+// parse a decimal number; returns the end of it, `begin` if there is none,
+//   or nullptr if it is for the C library
+template <class End>
+const char *fast_parse_number(const char *begin, End end, double &value)
+{
+    const char *p = begin;
+    while (!end.at(p) && ascii_isspace(*p))
+        ++p;
+
+    bool negative = false;
+    if (!end.at(p) && (*p == '+' || *p == '-'))
+        negative = *p++ == '-';
+
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    bool any = false;
+    bool truncated = false;
+
+    for (; !end.at(p) && *p >= '0' && *p <= '9'; ++p) {
+        any = true;
+        if (digits < 19) {
+            mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+            digits += mantissa != 0;
+        }
+        else {
+            truncated |= *p != '0';
+            ++exponent;
+        }
+    }
+    if (!end.at(p) && (*p == 'x' || *p == 'X'))
+        return nullptr;
+    if (!end.at(p) && *p == '.') {
+        ++p;
+        for (; !end.at(p) && *p >= '0' && *p <= '9'; ++p) {
+            any = true;
+            if (digits < 19) {
+                mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+                digits += mantissa != 0;
+                --exponent;
+            }
+            else
+                truncated |= *p != '0';
+        }
+    }
+    // maybe inf or nan, else nothing
+    if (!any) {
+        const char *q = begin;
+        while (!end.at(q) && (ascii_isspace(*q) || *q == '+' || *q == '-'))
+            ++q;
+        return (!end.at(q) && (*q == 'i' || *q == 'I' || *q == 'n' || *q == 'N')) ? nullptr : begin;
+    }
+    if (!end.at(p) && (*p == 'e' || *p == 'E')) {
+        const char *q = p + 1;
+        bool negexp = false;
+        if (!end.at(q) && (*q == '+' || *q == '-'))
+            negexp = *q++ == '-';
+        if (!end.at(q) && *q >= '0' && *q <= '9') {
+            int e = 0;
+            for (; !end.at(q) && *q >= '0' && *q <= '9'; ++q)
+                e = (e < 10000) ? (e * 10 + (*q - '0')) : e;
+            exponent += negexp ? -e : e;
+            p = q;
+        }
+    }
+
+    static const double powers[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+    };
+
+    if (mantissa == 0 && !truncated) {
+        value = negative ? -0.0 : 0.0;
+        return p;
+    }
+
+    if (!truncated && mantissa <= ((uint64_t)1 << 53) && exponent >= -22 && exponent <= 22) {
+        double result = (double)mantissa;
+        result = (exponent < 0) ? (result / powers[-exponent]) : (result * powers[exponent]);
+        value = negative ? -result : result;
+        return p;
+    }
+
+    // the digits which were cut put the number between the mantissa and the next,
+    //   it's good if both of them round the same
+    double result;
+    if (!eisel_lemire(mantissa, exponent, negative, result))
+        return nullptr;
+    if (truncated) {
+        double next;
+        if (!eisel_lemire(mantissa + 1, exponent, negative, next) || next != result)
+            return nullptr;
+    }
+    value = result;
+    return p;
+}
+
+} // namespace
+
 double dot_atof(const char *text)
 {
-    return c_atof(text, c_numeric_locale());
+    double value = 0;
+    const char *endp = fast_parse_number(text, null_end{}, value);
+    if (!endp)
+        return c_atof(text, c_numeric_locale());
+    return (endp != text) ? value : 0;
 }
 
 double dot_strtod(const char *text, char **endp)
 {
-    return c_strtod(text, endp, c_numeric_locale());
+    double value = 0;
+    const char *end = fast_parse_number(text, null_end{}, value);
+    if (!end)
+        return c_strtod(text, endp, c_numeric_locale());
+    if (endp)
+        *endp = (char *)end;
+    return value;
+}
+
+const char *dot_parse_number(const char *begin, const char *end, double &value)
+{
+    if (const char *p = fast_parse_number(begin, range_end{end}, value))
+        return p;
+
+    char buf[256];
+    size_t len = std::min<size_t>((size_t)(end - begin), sizeof(buf) - 1);
+    memcpy(buf, begin, len);
+    buf[len] = '\0';
+    char *endp = buf;
+    double result = c_strtod(buf, &endp, c_numeric_locale());
+    if (endp == buf)
+        return begin;
+    value = result;
+    return begin + (endp - buf);
 }
 
 bool ascii_isspace(char c)
@@ -344,16 +673,121 @@ float unpack_f32le(const uint8_t data[4])
     return value;
 }
 
+void pack_u64le(uint64_t value, uint8_t data[8])
+{
+    pack_u32le((uint32_t)value, data);
+    pack_u32le((uint32_t)(value >> 32), data + 4);
+}
+
+void pack_f64le(double value, uint8_t data[8])
+{
+    uint64_t u;
+    memcpy(&u, &value, 8);
+    pack_u64le(u, data);
+}
+
+uint64_t unpack_u64le(const uint8_t data[8])
+{
+    return unpack_u32le(data) | ((uint64_t)unpack_u32le(data + 4) << 32);
+}
+
+double unpack_f64le(const uint8_t data[8])
+{
+    double value;
+    uint64_t u = unpack_u64le(data);
+    memcpy(&value, &u, 8);
+    return value;
+}
+
 //------------------------------------------------------------------------------
 
-std::vector<uint8_t> decode_base64(const char *text, size_t len)
+namespace {
+
+const uint64_t hash_prime1 = UINT64_C(0x9E3779B185EBCA87);
+const uint64_t hash_prime2 = UINT64_C(0xC2B2AE3D27D4EB4F);
+const uint64_t hash_prime3 = UINT64_C(0x165667B19E3779F9);
+const uint64_t hash_prime4 = UINT64_C(0x85EBCA77C2B2AE63);
+const uint64_t hash_prime5 = UINT64_C(0x27D4EB2F165667C5);
+
+inline uint64_t hash_rotl(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+inline uint64_t hash_read64(const uint8_t *p)
 {
-    return d_getChunkFromBase64String(text, len);
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return v;
 }
 
-std::string encode_base64(const uint8_t *data, size_t len)
+inline uint64_t hash_round(uint64_t acc, uint64_t input)
 {
-    return d_getBase64StringFromChunk(data, len);
+    acc += input * hash_prime2;
+    return hash_rotl(acc, 31) * hash_prime1;
+}
+
+inline uint64_t hash_merge(uint64_t acc, uint64_t lane)
+{
+    acc ^= hash_round(0, lane);
+    return acc * hash_prime1 + hash_prime4;
+}
+
+} // namespace
+
+uint64_t hash_bytes(const void *data, size_t size, uint64_t seed)
+{
+    const uint8_t *p = (const uint8_t *)data;
+    const uint8_t *end = p + size;
+    uint64_t h;
+
+    if (size >= 32) {
+        // four independent lanes, which the processor runs in parallel
+        uint64_t v1 = seed + hash_prime1 + hash_prime2;
+        uint64_t v2 = seed + hash_prime2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - hash_prime1;
+        const uint8_t *limit = end - 32;
+        do {
+            v1 = hash_round(v1, hash_read64(p));
+            v2 = hash_round(v2, hash_read64(p + 8));
+            v3 = hash_round(v3, hash_read64(p + 16));
+            v4 = hash_round(v4, hash_read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+        h = hash_rotl(v1, 1) + hash_rotl(v2, 7) + hash_rotl(v3, 12) + hash_rotl(v4, 18);
+        h = hash_merge(h, v1);
+        h = hash_merge(h, v2);
+        h = hash_merge(h, v3);
+        h = hash_merge(h, v4);
+    }
+    else
+        h = seed + hash_prime5;
+
+    h += (uint64_t)size;
+
+    for (; p + 8 <= end; p += 8) {
+        h ^= hash_round(0, hash_read64(p));
+        h = hash_rotl(h, 27) * hash_prime1 + hash_prime4;
+    }
+    if (p + 4 <= end) {
+        uint32_t w;
+        memcpy(&w, p, 4);
+        h ^= (uint64_t)w * hash_prime1;
+        h = hash_rotl(h, 23) * hash_prime2 + hash_prime3;
+        p += 4;
+    }
+    for (; p < end; ++p) {
+        h ^= *p * hash_prime5;
+        h = hash_rotl(h, 11) * hash_prime1;
+    }
+
+    h ^= h >> 33;
+    h *= hash_prime2;
+    h ^= h >> 29;
+    h *= hash_prime3;
+    h ^= h >> 32;
+    return h;
 }
 
 //------------------------------------------------------------------------------
@@ -420,6 +854,82 @@ bool get_handle_file_uid(void *handle, file_uid &uid)
 }
 #endif
 
+bool get_file_stamp(const char *path, file_stamp &stamp)
+{
+#if !defined(_WIN32)
+    struct stat st;
+    if (stat(path, &st) != 0)
+        return false;
+#if defined(__APPLE__)
+    const struct timespec &mtime = st.st_mtimespec;
+#else
+    const struct timespec &mtime = st.st_mtim;
+#endif
+    stamp.first = (uint64_t)mtime.tv_sec * 1000000000u + (uint64_t)mtime.tv_nsec;
+    stamp.second = (uint64_t)st.st_size;
+    return true;
+#else
+    WIN32_FILE_ATTRIBUTE_DATA info;
+    if (!GetFileAttributesExW(widen(path).c_str(), GetFileExInfoStandard, &info))
+        return false;
+    // 100-nanosecond intervals
+    uint64_t mtime = (uint64_t)info.ftLastWriteTime.dwLowDateTime | ((uint64_t)info.ftLastWriteTime.dwHighDateTime << 32);
+    stamp.first = mtime * 100;
+    stamp.second = (uint64_t)info.nFileSizeLow | ((uint64_t)info.nFileSizeHigh << 32);
+    return true;
+#endif
+}
+
+bool get_stream_file_stamp(FILE *stream, file_stamp &stamp)
+{
+#if !defined(_WIN32)
+    int fd = fileno(stream);
+    if (fd == -1)
+        return false;
+#else
+    int fd = _fileno(stream);
+    if (fd == -1)
+        return false;
+#endif
+    return get_descriptor_file_stamp(fd, stamp);
+}
+
+bool get_descriptor_file_stamp(int fd, file_stamp &stamp)
+{
+#if !defined(_WIN32)
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+        return false;
+#if defined(__APPLE__)
+    const struct timespec &mtime = st.st_mtimespec;
+#else
+    const struct timespec &mtime = st.st_mtim;
+#endif
+    stamp.first = (uint64_t)mtime.tv_sec * 1000000000u + (uint64_t)mtime.tv_nsec;
+    stamp.second = (uint64_t)st.st_size;
+    return true;
+#else
+    HANDLE handle = (HANDLE)_get_osfhandle(fd);
+    if (handle == INVALID_HANDLE_VALUE)
+        return false;
+    return get_handle_file_stamp((void *)handle, stamp);
+#endif
+}
+
+#if defined(_WIN32)
+bool get_handle_file_stamp(void *handle, file_stamp &stamp)
+{
+    BY_HANDLE_FILE_INFORMATION info;
+    if (!GetFileInformationByHandle((HANDLE)handle, &info))
+        return false;
+    // 100-nanosecond intervals
+    uint64_t mtime = (uint64_t)info.ftLastWriteTime.dwLowDateTime | ((uint64_t)info.ftLastWriteTime.dwHighDateTime << 32);
+    stamp.first = mtime * 100;
+    stamp.second = (uint64_t)info.nFileSizeLow | ((uint64_t)info.nFileSizeHigh << 32);
+    return true;
+}
+#endif
+
 //------------------------------------------------------------------------------
 
 bool is_path_separator(char ch)
@@ -516,6 +1026,11 @@ bool exists(const char *path)
     return access(path, F_OK) == 0;
 }
 
+bool rename_file(const char *from, const char *to)
+{
+    return rename(from, to) == 0;
+}
+
 string_list list_directory(const char *path)
 {
     string_list list;
@@ -600,6 +1115,11 @@ bool exists(const char *path)
     return _waccess(widen(path).c_str(), 0) == 0;
 }
 
+bool rename_file(const char *from, const char *to)
+{
+    return MoveFileExW(widen(from).c_str(), widen(to).c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+}
+
 string_list list_directory(const char *path)
 {
     string_list list;
@@ -747,6 +1267,129 @@ int case_resolve(const char *root_, const char *fragment, std::string &result)
 
 //------------------------------------------------------------------------------
 
+bool mapped_file::open(const char *path)
+{
+    close();
+
+#if !defined(_WIN32)
+    int fd = ::open(path, O_RDONLY);
+    if (fd == -1)
+        return false;
+    struct stat st;
+    void *data = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0 && (uint64_t)st.st_size <= SIZE_MAX)
+        data = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED)
+        return false;
+    m_data = (const uint8_t *)data;
+    m_size = (size_t)st.st_size;
+#else
+    HANDLE file = CreateFileW(widen(path).c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+    LARGE_INTEGER size{};
+    HANDLE mapping = nullptr;
+    if (GetFileSizeEx(file, &size) && size.QuadPart > 0 && (uint64_t)size.QuadPart <= SIZE_MAX)
+        mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (!mapping)
+        return false;
+    void *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (!data)
+        return false;
+    m_data = (const uint8_t *)data;
+    m_size = (size_t)size.QuadPart;
+#endif
+
+    return true;
+}
+
+void mapped_file::view(std::shared_ptr<const void> owner, const uint8_t *data, size_t size)
+{
+    close();
+
+    m_owner = std::move(owner);
+    m_data = data;
+    m_size = size;
+}
+
+void mapped_file::close()
+{
+    if (!m_data)
+        return;
+    if (m_owner)
+        m_owner.reset();
+    else {
+#if !defined(_WIN32)
+        munmap((void *)m_data, m_size);
+#else
+        UnmapViewOfFile(m_data);
+#endif
+    }
+    m_data = nullptr;
+    m_size = 0;
+}
+
+//------------------------------------------------------------------------------
+
+bool shared_mapped_file::open(const char *path, size_t size)
+{
+    close();
+
+    if (size == 0)
+        return false;
+
+#if !defined(_WIN32)
+    int fd = ::open(path, O_RDWR|O_CREAT, 0644);
+    if (fd == -1)
+        return false;
+    struct stat st;
+    void *data = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) &&
+        ((uint64_t)st.st_size >= size || ftruncate(fd, (off_t)size) == 0))
+    {
+        data = mmap(nullptr, size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (data == MAP_FAILED)
+        return false;
+#else
+    HANDLE file = CreateFileW(widen(path).c_str(), GENERIC_READ|GENERIC_WRITE, FILE_SHARE_READ|FILE_SHARE_WRITE, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+    // the mapping extends the file if it is smaller
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READWRITE, (DWORD)((uint64_t)size >> 32), (DWORD)size, nullptr);
+    CloseHandle(file);
+    if (!mapping)
+        return false;
+    void *data = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+    CloseHandle(mapping);
+    if (!data)
+        return false;
+#endif
+
+    m_data = (uint8_t *)data;
+    m_size = size;
+    return true;
+}
+
+void shared_mapped_file::close()
+{
+    if (!m_data)
+        return;
+#if !defined(_WIN32)
+    munmap(m_data, m_size);
+#else
+    UnmapViewOfFile(m_data);
+#endif
+    m_data = nullptr;
+    m_size = 0;
+}
+
+//------------------------------------------------------------------------------
+
 #if defined(_WIN32)
 std::wstring widen(const std::string &u8str)
 {
@@ -785,6 +1428,92 @@ std::string narrow(const wchar_t *wdata, size_t wlen)
 }
 #endif
 
+//------------------------------------------------------------------------------
+uint64_t monotonic_ns()
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//------------------------------------------------------------------------------
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+static uintptr_t get_fp_control()
+{
+    return _mm_getcsr();
+}
+
+static void set_fp_control(uintptr_t value)
+{
+    _mm_setcsr((unsigned)value);
+}
+
+// FTZ | DAZ
+static constexpr uintptr_t fp_flush_denormals_bits = 0x8040;
+#elif defined(__aarch64__) && (defined(__GNUC__) || defined(__clang__))
+static uintptr_t get_fp_control()
+{
+    uint64_t value;
+    __asm__ __volatile__("mrs %0, fpcr" : "=r"(value));
+    return (uintptr_t)value;
+}
+
+static void set_fp_control(uintptr_t value)
+{
+    __asm__ __volatile__("msr fpcr, %0" : : "r"((uint64_t)value));
+}
+
+// FZ
+static constexpr uintptr_t fp_flush_denormals_bits = (uintptr_t)1 << 24;
+#elif defined(_M_ARM64)
+static uintptr_t get_fp_control()
+{
+    return (uintptr_t)_ReadStatusReg(ARM64_FPCR);
+}
+
+static void set_fp_control(uintptr_t value)
+{
+    _WriteStatusReg(ARM64_FPCR, (__int64)value);
+}
+
+// FZ
+static constexpr uintptr_t fp_flush_denormals_bits = (uintptr_t)1 << 24;
+#else
+static uintptr_t get_fp_control()
+{
+    return 0;
+}
+
+static void set_fp_control(uintptr_t)
+{
+}
+
+static constexpr uintptr_t fp_flush_denormals_bits = 0;
+#endif
+
+bool can_flush_denormals()
+{
+    return fp_flush_denormals_bits != 0;
+}
+
+scoped_flush_denormals::scoped_flush_denormals(bool enable)
+{
+    if (!enable)
+        return;
+    m_saved = get_fp_control();
+    uintptr_t value = m_saved | fp_flush_denormals_bits;
+    if (value != m_saved) {
+        set_fp_control(value);
+        m_active = true;
+    }
+}
+
+scoped_flush_denormals::~scoped_flush_denormals()
+{
+    if (m_active)
+        set_fp_control(m_saved);
+}
+
 } // namespace ysfx
 
 //------------------------------------------------------------------------------
@@ -19,6 +19,7 @@
 #include "ysfx.h"
 #include <string>
 #include <vector>
+#include <memory>
 #include <mutex>
 #include <cstdio>
 #include <cstdint>
@@ -84,8 +85,11 @@ using string_list = std::vector<std::string>;
 
 double c_atof(const char *text, c_locale_t loc);
 double c_strtod(const char *text, char **endp, c_locale_t loc);
+// like `atof` and `strtod` in the C locale, which they use only for what is not decimal
 double dot_atof(const char *text);
 double dot_strtod(const char *text, char **endp);
+// parse a number in a range of text like `dot_strtod`, without a terminator; returns the end of the number, or `begin` if none
+const char *dot_parse_number(const char *begin, const char *end, double &value);
 bool ascii_isspace(char c);
 bool ascii_isalpha(char c);
 char ascii_tolower(char c);
@@ -104,11 +108,26 @@ void pack_u32le(uint32_t value, uint8_t data[4]);
 void pack_f32le(float value, uint8_t data[4]);
 uint32_t unpack_u32le(const uint8_t data[4]);
 float unpack_f32le(const uint8_t data[4]);
+void pack_u64le(uint64_t value, uint8_t data[8]);
+void pack_f64le(double value, uint8_t data[8]);
+uint64_t unpack_u64le(const uint8_t data[8]);
+double unpack_f64le(const uint8_t data[8]);
 
 //------------------------------------------------------------------------------
 
 std::vector<uint8_t> decode_base64(const char *text, size_t len = ~(size_t)0);
 std::string encode_base64(const uint8_t *data, size_t len);
+// the same, into buffers of the sizes below; they return the sizes of what they wrote
+size_t decode_base64(const char *text, size_t len, uint8_t *data);
+size_t encode_base64(const uint8_t *data, size_t len, char *text);
+inline size_t base64_decoded_capacity(size_t len) { return len / 4 * 3 + 2; }
+inline size_t base64_encoded_size(size_t len) { return (len + 2) / 3 * 4; }
+
+//------------------------------------------------------------------------------
+
+// a fast hash of 64 bits, which is not cryptographic; it is XXH64, reading the words in native order
+uint64_t hash_bytes(const void *data, size_t size, uint64_t seed = 0);
+inline uint64_t hash_combine(uint64_t h, uint64_t v) { return (h ^ v) * UINT64_C(0x9E3779B185EBCA87) + (h >> 29); }
 
 //------------------------------------------------------------------------------
 
@@ -120,6 +139,15 @@ bool get_descriptor_file_uid(int fd, file_uid &uid);
 bool get_handle_file_uid(void *handle, file_uid &uid);
 #endif
 
+// identifies a version of a file, as the modification time in nanoseconds and the size
+using file_stamp = std::pair<uint64_t, uint64_t>;
+bool get_file_stamp(const char *path, file_stamp &stamp);
+bool get_stream_file_stamp(FILE *stream, file_stamp &stamp);
+bool get_descriptor_file_stamp(int fd, file_stamp &stamp);
+#if defined(_WIN32)
+bool get_handle_file_stamp(void *handle, file_stamp &stamp);
+#endif
+
 //------------------------------------------------------------------------------
 
 struct split_path_t {
@@ -147,6 +175,8 @@ bool path_is_relative(const char *path);
 
 // check whether a file exists on disk
 bool exists(const char *path);
+// rename a file, replacing the destination if it exists
+bool rename_file(const char *from, const char *to);
 // list the elements of a directory; directories are distinguished with a final '/'
 string_list list_directory(const char *path);
 // visit the root and subdirectories in depth-first order
@@ -154,6 +184,45 @@ void visit_directories(const char *rootpath, bool (*visit)(const std::string &,
 // resolve a path which matches root/fragment, where fragment is case-insensitive (0=failed, 1=exact, 2=inexact)
 int case_resolve(const char *root, const char *fragment, std::string &result);
 
+// a read-only view of the whole contents of a file in memory
+class mapped_file {
+public:
+    mapped_file() = default;
+    ~mapped_file() { close(); }
+    // map the file, and return whether it succeeded; an empty file does not map
+    bool open(const char *path);
+    // view memory which the owner keeps alive, instead of mapping a file
+    void view(std::shared_ptr<const void> owner, const uint8_t *data, size_t size);
+    void close();
+    bool is_open() const { return m_data != nullptr; }
+    const uint8_t *data() const { return m_data; }
+    size_t size() const { return m_size; }
+private:
+    const uint8_t *m_data = nullptr;
+    size_t m_size = 0;
+    std::shared_ptr<const void> m_owner;
+    mapped_file(const mapped_file &) = delete;
+    mapped_file &operator=(const mapped_file &) = delete;
+};
+
+// a writable view of a file in memory, which other processes mapping it share
+class shared_mapped_file {
+public:
+    shared_mapped_file() = default;
+    ~shared_mapped_file() { close(); }
+    // map the first `size` bytes of the file, which is created or extended with zeros as needed
+    bool open(const char *path, size_t size);
+    void close();
+    bool is_open() const { return m_data != nullptr; }
+    uint8_t *data() const { return m_data; }
+    size_t size() const { return m_size; }
+private:
+    uint8_t *m_data = nullptr;
+    size_t m_size = 0;
+    shared_mapped_file(const shared_mapped_file &) = delete;
+    shared_mapped_file &operator=(const shared_mapped_file &) = delete;
+};
+
 //------------------------------------------------------------------------------
 
 #if defined(_WIN32)
@@ -165,6 +234,36 @@ std::string narrow(const wchar_t *wdata, size_t wlen = ~(size_t)0);
 
 //------------------------------------------------------------------------------
 
+// get whether the CPU can flush denormals; otherwise `scoped_flush_denormals` does nothing
+bool can_flush_denormals();
+
+// enable flush-to-zero and denormals-are-zero on the current thread, for the lifetime of the object
+class scoped_flush_denormals {
+public:
+    explicit scoped_flush_denormals(bool enable = true);
+    ~scoped_flush_denormals();
+private:
+    uintptr_t m_saved = 0;
+    bool m_active = false;
+    scoped_flush_denormals(const scoped_flush_denormals &) = delete;
+    scoped_flush_denormals &operator=(const scoped_flush_denormals &) = delete;
+};
+
+// get a monotonic time, in nanoseconds
+uint64_t monotonic_ns();
+
+// add the time spent in the lifetime of the object to a counter, in nanoseconds
+class scoped_timer {
+public:
+    explicit scoped_timer(uint64_t &dest) : m_dest(dest), m_begin(monotonic_ns()) {}
+    ~scoped_timer() { m_dest += monotonic_ns() - m_begin; }
+private:
+    uint64_t &m_dest;
+    uint64_t m_begin = 0;
+    scoped_timer(const scoped_timer &) = delete;
+    scoped_timer &operator=(const scoped_timer &) = delete;
+};
+
 template <class F>
 class scope_guard {
 public:
@@ -0,0 +1,264 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "ysfx_utils.hpp"
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#   define YSFX_BASE64_SSE2 1
+#   include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#   define YSFX_BASE64_NEON 1
+#   include <arm_neon.h>
+#endif
+
+namespace ysfx {
+
+namespace {
+
+const char base64_chars[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+    "abcdefghijklmnopqrstuvwxyz"
+    "0123456789+/";
+
+struct base64_index_table {
+    int8_t index[256];
+    base64_index_table()
+    {
+        memset(index, -1, sizeof(index));
+        for (int8_t i = 0; i < 64; ++i)
+            index[(uint8_t)base64_chars[i]] = i;
+    }
+};
+
+const base64_index_table base64_table;
+
+//------------------------------------------------------------------------------
+// the blocks of the vectors: they decode only what is entirely valid, and leave
+//   the rest, such as the padding or the spaces, to the scalar code
+
+#if defined(YSFX_BASE64_SSE2)
+enum { base64_decode_block = 16 };
+
+inline __m128i in_range(__m128i c, char lo, char hi)
+{
+    // the bytes from 128 are negative, so they are in none of the ranges
+    return _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8((char)(lo - 1))), _mm_cmplt_epi8(c, _mm_set1_epi8((char)(hi + 1))));
+}
+
+bool decode_block(const char *text, uint8_t *data)
+{
+    const __m128i c = _mm_loadu_si128((const __m128i *)text);
+    const __m128i upper = in_range(c, 'A', 'Z');
+    const __m128i lower = in_range(c, 'a', 'z');
+    const __m128i digit = in_range(c, '0', '9');
+    const __m128i plus = _mm_cmpeq_epi8(c, _mm_set1_epi8('+'));
+    const __m128i slash = _mm_cmpeq_epi8(c, _mm_set1_epi8('/'));
+    const __m128i valid = _mm_or_si128(_mm_or_si128(_mm_or_si128(upper, lower), _mm_or_si128(digit, plus)), slash);
+    if (_mm_movemask_epi8(valid) != 0xFFFF)
+        return false;
+
+    __m128i offset = _mm_and_si128(upper, _mm_set1_epi8(-'A'));
+    offset = _mm_or_si128(offset, _mm_and_si128(lower, _mm_set1_epi8(26 - 'a')));
+    offset = _mm_or_si128(offset, _mm_and_si128(digit, _mm_set1_epi8(52 - '0')));
+    offset = _mm_or_si128(offset, _mm_and_si128(plus, _mm_set1_epi8(62 - '+')));
+    offset = _mm_or_si128(offset, _mm_and_si128(slash, _mm_set1_epi8(63 - '/')));
+    const __m128i v = _mm_add_epi8(c, offset);
+
+    // each 4 indices, as the 24 bits of a quad
+    __m128i q = _mm_slli_epi32(_mm_and_si128(v, _mm_set1_epi32(0xFF)), 18);
+    q = _mm_or_si128(q, _mm_slli_epi32(_mm_and_si128(v, _mm_set1_epi32(0xFF00)), 4));
+    q = _mm_or_si128(q, _mm_srli_epi32(_mm_and_si128(v, _mm_set1_epi32(0xFF0000)), 10));
+    q = _mm_or_si128(q, _mm_srli_epi32(v, 24));
+
+    alignas(16) uint32_t quads[4];
+    _mm_store_si128((__m128i *)quads, q);
+    for (uint32_t i = 0; i < 4; ++i) {
+        data[3 * i] = (uint8_t)(quads[i] >> 16);
+        data[3 * i + 1] = (uint8_t)(quads[i] >> 8);
+        data[3 * i + 2] = (uint8_t)quads[i];
+    }
+    return true;
+}
+
+// the encoder has no block: without a shuffle, the gather of 3 bytes into 4 costs
+//   more than it saves, and the scalar code is faster
+#elif defined(YSFX_BASE64_NEON)
+enum { base64_decode_block = 64, base64_encode_block = 48 };
+
+inline uint8x16_t in_range(uint8x16_t c, uint8_t lo, uint8_t hi)
+{
+    return vandq_u8(vcgeq_u8(c, vdupq_n_u8(lo)), vcleq_u8(c, vdupq_n_u8(hi)));
+}
+
+// the index of each character, or 0xFF for the invalid ones
+inline uint8x16_t decode_chars(uint8x16_t c)
+{
+    const uint8x16_t upper = in_range(c, 'A', 'Z');
+    const uint8x16_t lower = in_range(c, 'a', 'z');
+    const uint8x16_t digit = in_range(c, '0', '9');
+    const uint8x16_t plus = vceqq_u8(c, vdupq_n_u8('+'));
+    const uint8x16_t slash = vceqq_u8(c, vdupq_n_u8('/'));
+    const uint8x16_t valid = vorrq_u8(vorrq_u8(vorrq_u8(upper, lower), vorrq_u8(digit, plus)), slash);
+
+    uint8x16_t offset = vandq_u8(upper, vdupq_n_u8((uint8_t)-'A'));
+    offset = vorrq_u8(offset, vandq_u8(lower, vdupq_n_u8((uint8_t)(26 - 'a'))));
+    offset = vorrq_u8(offset, vandq_u8(digit, vdupq_n_u8((uint8_t)(52 - '0'))));
+    offset = vorrq_u8(offset, vandq_u8(plus, vdupq_n_u8((uint8_t)(62 - '+'))));
+    offset = vorrq_u8(offset, vandq_u8(slash, vdupq_n_u8((uint8_t)(63 - '/'))));
+    return vorrq_u8(vaddq_u8(c, offset), vmvnq_u8(valid));
+}
+
+bool decode_block(const char *text, uint8_t *data)
+{
+    const uint8x16x4_t c = vld4q_u8((const uint8_t *)text);
+    const uint8x16_t a = decode_chars(c.val[0]);
+    const uint8x16_t b = decode_chars(c.val[1]);
+    const uint8x16_t x = decode_chars(c.val[2]);
+    const uint8x16_t d = decode_chars(c.val[3]);
+    if (vmaxvq_u8(vorrq_u8(vorrq_u8(a, b), vorrq_u8(x, d))) >= 64)
+        return false;
+
+    uint8x16x3_t out;
+    out.val[0] = vorrq_u8(vshlq_n_u8(a, 2), vshrq_n_u8(b, 4));
+    out.val[1] = vorrq_u8(vshlq_n_u8(b, 4), vshrq_n_u8(x, 2));
+    out.val[2] = vorrq_u8(vshlq_n_u8(x, 6), d);
+    vst3q_u8(data, out);
+    return true;
+}
+
+void encode_block(const uint8_t *data, char *text)
+{
+    uint8x16x4_t table;
+    for (uint32_t i = 0; i < 4; ++i)
+        table.val[i] = vld1q_u8((const uint8_t *)&base64_chars[16 * i]);
+
+    const uint8x16x3_t b = vld3q_u8(data);
+    uint8x16x4_t v;
+    v.val[0] = vshrq_n_u8(b.val[0], 2);
+    v.val[1] = vandq_u8(vorrq_u8(vshlq_n_u8(b.val[0], 4), vshrq_n_u8(b.val[1], 4)), vdupq_n_u8(63));
+    v.val[2] = vandq_u8(vorrq_u8(vshlq_n_u8(b.val[1], 2), vshrq_n_u8(b.val[2], 6)), vdupq_n_u8(63));
+    v.val[3] = vandq_u8(b.val[2], vdupq_n_u8(63));
+    for (uint32_t i = 0; i < 4; ++i)
+        v.val[i] = vqtbl4q_u8(table, v.val[i]);
+    vst4q_u8((uint8_t *)text, v);
+}
+#endif
+
+} // namespace
+
+//------------------------------------------------------------------------------
+
+size_t decode_base64(const char *text, size_t len, uint8_t *data)
+{
+    if (!text)
+        return 0;
+    if (len == ~(size_t)0)
+        len = strlen(text);
+
+    size_t pos = 0;
+    size_t size = 0;
+    uint32_t quad = 0;
+    uint32_t count = 0;
+
+    while (pos < len) {
+#if defined(YSFX_BASE64_SSE2) || defined(YSFX_BASE64_NEON)
+        if (count == 0 && len - pos >= base64_decode_block && decode_block(&text[pos], &data[size])) {
+            pos += base64_decode_block;
+            size += base64_decode_block / 4 * 3;
+            continue;
+        }
+#endif
+        const uint8_t c = (uint8_t)text[pos++];
+        if (c == '\0' || c == '=')
+            break;
+        const int8_t index = base64_table.index[c];
+        if (index == -1)
+            continue;
+        quad = (quad << 6) | (uint32_t)index;
+        if (++count == 4) {
+            data[size++] = (uint8_t)(quad >> 16);
+            data[size++] = (uint8_t)(quad >> 8);
+            data[size++] = (uint8_t)quad;
+            quad = 0;
+            count = 0;
+        }
+    }
+
+    // the bytes which the last incomplete quad has whole
+    if (count > 1) {
+        quad <<= 6 * (4 - count);
+        data[size++] = (uint8_t)(quad >> 16);
+        if (count > 2)
+            data[size++] = (uint8_t)(quad >> 8);
+    }
+
+    return size;
+}
+
+size_t encode_base64(const uint8_t *data, size_t len, char *text)
+{
+    size_t pos = 0;
+    size_t size = 0;
+
+#if defined(YSFX_BASE64_NEON)
+    for (; len - pos >= base64_encode_block; pos += base64_encode_block) {
+        encode_block(&data[pos], &text[size]);
+        size += base64_encode_block / 3 * 4;
+    }
+#endif
+
+    for (; len - pos >= 3; pos += 3) {
+        const uint32_t quad = ((uint32_t)data[pos] << 16) | ((uint32_t)data[pos + 1] << 8) | data[pos + 2];
+        text[size++] = base64_chars[quad >> 18];
+        text[size++] = base64_chars[(quad >> 12) & 63];
+        text[size++] = base64_chars[(quad >> 6) & 63];
+        text[size++] = base64_chars[quad & 63];
+    }
+
+    if (pos < len) {
+        const bool two = len - pos == 2;
+        const uint32_t quad = ((uint32_t)data[pos] << 16) | (two ? ((uint32_t)data[pos + 1] << 8) : 0);
+        text[size++] = base64_chars[quad >> 18];
+        text[size++] = base64_chars[(quad >> 12) & 63];
+        text[size++] = two ? base64_chars[(quad >> 6) & 63] : '=';
+        text[size++] = '=';
+    }
+
+    return size;
+}
+
+std::vector<uint8_t> decode_base64(const char *text, size_t len)
+{
+    if (!text)
+        return {};
+    if (len == ~(size_t)0)
+        len = strlen(text);
+
+    std::vector<uint8_t> data(base64_decoded_capacity(len));
+    data.resize(decode_base64(text, len, data.data()));
+    return data;
+}
+
+std::string encode_base64(const uint8_t *data, size_t len)
+{
+    std::string text(base64_encoded_size(len), '\0');
+    text.resize(encode_base64(data, len, &text[0]));
+    return text;
+}
+
+} // namespace ysfx
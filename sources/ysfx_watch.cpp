@@ -0,0 +1,112 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "ysfx_watch.hpp"
+#include "ysfx.hpp"
+#include <memory>
+
+// the whole memory of the VM
+static constexpr uint64_t ysfx_watch_max_values = (uint64_t)NSEEL_RAM_BLOCKS * NSEEL_RAM_ITEMSPERBLOCK;
+
+ysfx_watch_t::~ysfx_watch_t()
+{
+    delete pending.exchange(nullptr);
+    delete retired.exchange(nullptr);
+    delete active;
+}
+
+bool ysfx_set_watch(ysfx_t *fx, const char *const *names, uint32_t num_names, const ysfx_watch_range_t *ranges, uint32_t num_ranges)
+{
+    ysfx_watch_t &watch = fx->watch;
+
+    std::unique_ptr<ysfx_watch_list_t> list{new ysfx_watch_list_t};
+    list->generation = watch.generation;
+
+    bool found = true;
+    list->vars.reserve(num_names);
+    for (uint32_t i = 0; i < num_names; ++i) {
+        ysfx_real *var = ysfx_find_var(fx, names[i]);
+        found = found && var;
+        list->vars.push_back(var);
+    }
+
+    uint64_t num_values = num_names;
+    list->ranges.assign(ranges, ranges + num_ranges);
+    for (const ysfx_watch_range_t &range : list->ranges)
+        num_values += range.count;
+    if (num_values > ysfx_watch_max_values)
+        return false;
+    list->num_values = (uint32_t)num_values;
+    for (uint32_t i = 0; i < 3; ++i)
+        list->buffer[i].assign(list->num_values, 0);
+
+    delete watch.retired.exchange(nullptr, std::memory_order_acquire);
+
+    watch.reading = list.get();
+    delete watch.pending.exchange(list.release(), std::memory_order_acq_rel);
+
+    return found;
+}
+
+const ysfx_real *ysfx_get_watch(ysfx_t *fx, uint32_t *count)
+{
+    ysfx_watch_t &watch = fx->watch;
+
+    delete watch.retired.exchange(nullptr, std::memory_order_acquire);
+
+    ysfx_watch_list_t *list = watch.reading;
+    if (count)
+        *count = list ? list->num_values : 0;
+    if (!list)
+        return nullptr;
+
+    if (list->buffer.update())
+        list->received = true;
+
+    return list->received ? list->buffer.front().data() : nullptr;
+}
+
+void ysfx_watch_publish(ysfx_t *fx, ysfx_watch_t &watch)
+{
+    // take the new list, once the one before is freed
+    if (watch.pending.load(std::memory_order_relaxed) && !watch.retired.load(std::memory_order_acquire)) {
+        ysfx_watch_list_t *list = watch.pending.exchange(nullptr, std::memory_order_acq_rel);
+        if (list) {
+            if (watch.active)
+                watch.retired.store(watch.active, std::memory_order_release);
+            watch.active = list;
+        }
+    }
+
+    ysfx_watch_list_t *list = watch.active;
+    if (!list || list->num_values == 0)
+        return;
+
+    ysfx_real *values = list->buffer.back().data();
+
+    // the variables of unloaded code are gone, and read as zero
+    const bool vars_valid = list->generation == watch.generation;
+    for (ysfx_real *var : list->vars)
+        *values++ = (vars_valid && var) ? *var : 0;
+
+    for (const ysfx_watch_range_t &range : list->ranges) {
+        ysfx_read_vmem(fx, range.addr, values, range.count);
+        values += range.count;
+    }
+
+    list->buffer.publish();
+}
@@ -0,0 +1,53 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+#include "ysfx.h"
+#include "utility/triple_buffer.hpp"
+#include <vector>
+#include <atomic>
+
+// the values which a reader subscribes to, copied after each processing cycle
+struct ysfx_watch_list_t {
+    // the variables, null for those which do not exist
+    std::vector<ysfx_real *> vars;
+    std::vector<ysfx_watch_range_t> ranges;
+    uint32_t num_values = 0;
+    // the variables are those of this generation of the code
+    uint32_t generation = 0;
+    // the processing writes into `back`, the reader owns `front`
+    ysfx::triple_buffer<std::vector<ysfx_real>> buffer;
+    // whether the reader has received values yet
+    bool received = false;
+};
+
+struct ysfx_watch_t {
+    ~ysfx_watch_t();
+    // the list published by the reader, until the processing takes it
+    std::atomic<ysfx_watch_list_t *> pending{nullptr};
+    // the list which the processing fills
+    ysfx_watch_list_t *active = nullptr;
+    // the list which was replaced, to be freed by the reader
+    std::atomic<ysfx_watch_list_t *> retired{nullptr};
+    // the list which the reader published last, and reads from
+    ysfx_watch_list_t *reading = nullptr;
+    // incremented when the code is unloaded, which invalidates the variables
+    uint32_t generation = 0;
+};
+
+// copy the values after a processing cycle, on the audio thread
+void ysfx_watch_publish(ysfx_t *fx, ysfx_watch_t &watch);
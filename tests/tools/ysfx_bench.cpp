@@ -0,0 +1,208 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+#include "ysfx.h"
+#include "ysfx_bench_corpus.hpp"
+#include "ysfx_bench_utils.hpp"
+#include <string>
+#include <vector>
+#include <cstring>
+
+// Measures the throughput of the processing over a corpus of effects which
+// are typical of JSFX, across block sizes, channel counts and sample rates,
+// with the float and the double entry points.
+//
+// Usage: ysfx_bench [seconds-of-audio] [effect]
+//
+// The results are written as JSON on the standard output, one entry per
+// effect and configuration, with the time in nanoseconds per sample (one
+// channel of one frame) and the realtime factor, which is the duration of
+// the audio over the time it took to process it.
+
+#if defined(__clang__)
+static const char bench_compiler[] = "clang " __clang_version__;
+#elif defined(__GNUC__)
+static const char bench_compiler[] = "gcc " __VERSION__;
+#elif defined(_MSC_VER)
+static const char bench_compiler[] = "msvc";
+#else
+static const char bench_compiler[] = "other";
+#endif
+
+#if defined(NDEBUG)
+static const bool bench_optimized = true;
+#else
+static const bool bench_optimized = false;
+#endif
+
+static const uint32_t bench_blocks[] = {64, 256, 1024};
+static const uint32_t bench_channels[] = {1, 2, 8};
+static const ysfx_real bench_rates[] = {44100, 48000, 96000};
+
+struct bench_result {
+    uint64_t frames = 0;
+    double seconds = 0;
+};
+
+static ysfx_t *bench_load(const bench_effect &effect, uint32_t channels, uint32_t block, ysfx_real rate)
+{
+    std::string text = "desc:bench" "\n";
+    for (uint32_t ch = 0; ch < channels; ++ch)
+        text += "in_pin:input " + std::to_string(ch + 1) + "\n";
+    for (uint32_t ch = 0; ch < channels; ++ch)
+        text += "out_pin:output " + std::to_string(ch + 1) + "\n";
+    text += effect.code;
+
+    ysfx_u fx{bench_compile(text, effect.name)};
+    ysfx_set_block_size(fx.get(), block);
+    ysfx_set_sample_rate(fx.get(), rate);
+    ysfx_init(fx.get());
+    return fx.release();
+}
+
+// the same notes on every machine, a chord which changes twice a second
+static void bench_send_notes(ysfx_t *fx, uint64_t frame, uint32_t block, ysfx_real rate)
+{
+    const uint64_t period = (uint64_t)(rate / 2);
+    const uint64_t offset = frame % period;
+    if (offset + block <= period && offset != 0)
+        return;
+
+    const uint32_t at = (offset == 0) ? 0 : (uint32_t)(period - offset);
+    const uint64_t index = (frame + at) / period;
+    const uint8_t root = (uint8_t)(48 + index % 12);
+    const uint8_t last = (uint8_t)(48 + (index + 11) % 12);
+    const uint8_t intervals[3] = {0, 4, 7};
+    for (uint8_t interval : intervals) {
+        const uint8_t off[3] = {0x80, (uint8_t)(last + interval), 0};
+        const uint8_t on[3] = {0x90, (uint8_t)(root + interval), 100};
+        ysfx_midi_event_t event{0, at, 3, off};
+        ysfx_send_midi(fx, &event);
+        event.data = on;
+        ysfx_send_midi(fx, &event);
+    }
+}
+
+template <class Real>
+static void bench_process(ysfx_t *fx, const Real *const *ins, Real *const *outs, uint32_t channels, uint32_t block);
+
+template <>
+void bench_process<float>(ysfx_t *fx, const float *const *ins, float *const *outs, uint32_t channels, uint32_t block)
+{
+    ysfx_process_float(fx, ins, outs, channels, channels, block);
+}
+
+template <>
+void bench_process<double>(ysfx_t *fx, const double *const *ins, double *const *outs, uint32_t channels, uint32_t block)
+{
+    ysfx_process_double(fx, ins, outs, channels, channels, block);
+}
+
+template <class Real>
+static bench_result bench_run(const bench_effect &effect, uint32_t channels, uint32_t block, ysfx_real rate, double seconds)
+{
+    ysfx_u fx{bench_load(effect, channels, block, rate)};
+
+    // a deterministic input, generated before the timing
+    std::vector<Real> input((size_t)channels * block);
+    std::vector<Real> output((size_t)channels * block);
+    std::vector<const Real *> ins(channels);
+    std::vector<Real *> outs(channels);
+    uint32_t seed = 1;
+    for (Real &sample : input) {
+        seed = seed * 1103515245u + 12345u;
+        sample = (Real)((double)(seed >> 8) / (1u << 24) - 0.5);
+    }
+    for (uint32_t ch = 0; ch < channels; ++ch) {
+        ins[ch] = &input[(size_t)ch * block];
+        outs[ch] = &output[(size_t)ch * block];
+    }
+
+    const uint64_t frames = ((uint64_t)(seconds * rate) + block - 1) / block * block;
+    ysfx_midi_event_t event;
+
+    // the first tenth is not timed, so the caches and the branch predictors are warm
+    uint64_t frame = 0;
+    for (uint64_t warm = frames / 10; frame < warm; frame += block) {
+        bench_send_notes(fx.get(), frame, block, rate);
+        bench_process<Real>(fx.get(), ins.data(), outs.data(), channels, block);
+        while (ysfx_receive_midi(fx.get(), &event));
+    }
+
+    bench_clock::time_point start = bench_clock::now();
+    for (uint64_t done = 0; done < frames; done += block, frame += block) {
+        bench_send_notes(fx.get(), frame, block, rate);
+        bench_process<Real>(fx.get(), ins.data(), outs.data(), channels, block);
+        while (ysfx_receive_midi(fx.get(), &event));
+    }
+    bench_clock::duration time = bench_clock::now() - start;
+
+    bench_result result;
+    result.frames = frames;
+    result.seconds = bench_seconds(time);
+    return result;
+}
+
+static void bench_report(bool first, const char *name, const char *type, uint32_t channels, uint32_t block, ysfx_real rate, const bench_result &result)
+{
+    double samples = (double)result.frames * channels;
+    double ns = (samples > 0) ? (result.seconds * 1e9 / samples) : 0;
+    double realtime = (result.seconds > 0) ? (result.frames / rate / result.seconds) : 0;
+    printf("%s\n    {\"effect\": \"%s\", \"type\": \"%s\", \"channels\": %u, \"block\": %u, \"rate\": %.0f, "
+           "\"frames\": %llu, \"seconds\": %.6f, \"ns_per_sample\": %.3f, \"realtime_factor\": %.2f}",
+           first ? "" : ",", name, type, channels, block, rate,
+           (unsigned long long)result.frames, result.seconds, ns, realtime);
+    fflush(stdout);
+}
+
+int main(int argc, char *argv[])
+{
+    double seconds = 2;
+    const char *only = nullptr;
+    if (argc > 3) {
+        fprintf(stderr, "Usage: %s [seconds-of-audio] [effect]\n", argv[0]);
+        return 1;
+    }
+    if (argc >= 2)
+        seconds = strtod(argv[1], nullptr);
+    if (!(seconds > 0))
+        seconds = 1;
+    if (argc >= 3)
+        only = argv[2];
+
+    printf("{\n  \"arch\": \"%s\",\n  \"compiler\": \"%s\",\n  \"optimized\": %s,\n  \"seconds_of_audio\": %g,\n  \"results\": [",
+           bench_arch, bench_compiler, bench_optimized ? "true" : "false", seconds);
+
+    bool first = true;
+    for (const bench_effect &effect : bench_effects) {
+        if (only && strcmp(only, effect.name) != 0)
+            continue;
+        for (uint32_t channels : bench_channels) {
+            for (uint32_t block : bench_blocks) {
+                for (ysfx_real rate : bench_rates) {
+                    bench_report(first, effect.name, "float", channels, block, rate,
+                                 bench_run<float>(effect, channels, block, rate, seconds));
+                    first = false;
+                    bench_report(first, effect.name, "double", channels, block, rate,
+                                 bench_run<double>(effect, channels, block, rate, seconds));
+                }
+            }
+        }
+    }
+
+    printf("\n  ]\n}\n");
+    return 0;
+}
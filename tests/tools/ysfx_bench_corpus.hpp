@@ -0,0 +1,138 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+
+// Effects which are typical of JSFX, for the benchmarks and for the checks of
+// the processing, which run them with the same inputs.
+
+struct bench_effect {
+    const char *name;
+    const char *code;
+};
+
+// the code goes after the header, which declares a pin per channel; the notes
+// which the host sends drive the synth and the arpeggiator
+static const bench_effect bench_effects[] = {
+    // three bands of biquads per channel, the state of each in the memory
+    {"eq",
+     "@init" "\n"
+     "b0 = 0.2; b1 = 0.4; b2 = 0.2; a1 = -0.5; a2 = 0.3;" "\n"
+     "@sample" "\n"
+     "ch = 0;" "\n"
+     "loop(num_ch," "\n"
+     "  s = ch * 8; x = spl(ch);" "\n"
+     "  y = b0 * x + s[0]; s[0] = b1 * x - a1 * y + s[1]; s[1] = b2 * x - a2 * y; x = y;" "\n"
+     "  y = b0 * x + s[2]; s[2] = b1 * x - a1 * y + s[3]; s[3] = b2 * x - a2 * y; x = y;" "\n"
+     "  y = b0 * x + s[4]; s[4] = b1 * x - a1 * y + s[5]; s[5] = b2 * x - a2 * y;" "\n"
+     "  spl(ch) = y;" "\n"
+     "  ch += 1;" "\n"
+     ");" "\n"},
+    // a compressor linked over the channels, with a level detector in decibels
+    {"compressor",
+     "@init" "\n"
+     "att = exp(-1 / (0.002 * srate)); rel = exp(-1 / (0.1 * srate));" "\n"
+     "thresh = -18; ratio = 4; env = 0;" "\n"
+     "@sample" "\n"
+     "peak = 0; ch = 0;" "\n"
+     "loop(num_ch, peak = max(peak, abs(spl(ch))); ch += 1);" "\n"
+     "env = peak > env ? att * env + (1 - att) * peak : rel * env + (1 - rel) * peak;" "\n"
+     "db = 20 * log10(max(env, 0.000001));" "\n"
+     "gain = db > thresh ? exp((thresh - db) * (1 - 1 / ratio) * 0.11512925) : 1;" "\n"
+     "ch = 0;" "\n"
+     "loop(num_ch, spl(ch) *= gain; ch += 1);" "\n"},
+    // eight voices of oscillators with envelopes, which the MIDI notes start and stop
+    {"synth",
+     "@init" "\n"
+     "voices = 1000; nv = 8;" "\n"
+     "@block" "\n"
+     "while(midirecv(ofs, m1, m2, m3)) (" "\n"
+     "  v = voices + ((m2 % nv) * 4);" "\n"
+     "  (m1 & 0xf0) == 0x90 && m3 > 0 ? (v[0] = 440 * pow(2, (m2 - 69) / 12) / srate; v[2] = 1) : v[2] = 0;" "\n"
+     ");" "\n"
+     "@sample" "\n"
+     "out = 0; i = 0;" "\n"
+     "loop(nv," "\n"
+     "  v = voices + i * 4;" "\n"
+     "  v[3] += ((v[2] ? 1 : 0) - v[3]) * 0.001;" "\n"
+     "  (v[1] += v[0]) >= 1 ? v[1] -= 1;" "\n"
+     "  out += (v[1] * 2 - 1) * v[3] * 0.125 + sin(v[1] * 6.2831853) * v[3] * 0.0625;" "\n"
+     "  i += 1;" "\n"
+     ");" "\n"
+     "ch = 0;" "\n"
+     "loop(num_ch, spl(ch) = out; ch += 1);" "\n"},
+    // a convolution with the FFT by blocks of 512, each channel overlapping and adding
+    {"convolution",
+     "@init" "\n"
+     "len = 512; size = 1024; pos = 0;" "\n"
+     "ir = 0; memset(ir, 0, size * 2);" "\n"
+     "i = 0; loop(len, ir[i * 2] = exp(-i / 64) * (((i * 7919) % 13) / 6.5 - 1) / 16; i += 1);" "\n"
+     "fft(ir, size);" "\n"
+     "@sample" "\n"
+     "ch = 0;" "\n"
+     "loop(num_ch," "\n"
+     "  base = 65536 * (ch + 1); in = base + 2048; out = base + 2560;" "\n"
+     "  in[pos] = spl(ch); spl(ch) = out[pos];" "\n"
+     "  ch += 1;" "\n"
+     ");" "\n"
+     "(pos += 1) >= len ? (" "\n"
+     "  pos = 0; ch = 0;" "\n"
+     "  loop(num_ch," "\n"
+     "    base = 65536 * (ch + 1); wk = base; in = base + 2048; out = base + 2560; ov = base + 3072;" "\n"
+     "    memset(wk, 0, size * 2);" "\n"
+     "    i = 0; loop(len, wk[i * 2] = in[i]; i += 1);" "\n"
+     "    fft(wk, size); convolve_c(wk, ir, size); ifft(wk, size);" "\n"
+     "    i = 0; loop(len, out[i] = (wk[i * 2] + ov[i]) / size; ov[i] = wk[(i + len) * 2]; i += 1);" "\n"
+     "    ch += 1;" "\n"
+     "  );" "\n"
+     ");" "\n"},
+    // an arpeggiator over the held notes, which sends its steps at their offsets
+    {"arpeggiator",
+     "@init" "\n"
+     "held = 1000; nheld = 0; step = floor(srate / 16); next = 0; cur = 0; last = -1;" "\n"
+     "@block" "\n"
+     "while(midirecv(ofs, m1, m2, m3)) (" "\n"
+     "  (m1 & 0xf0) == 0x90 && m3 > 0 ? (nheld < 16 ? (held[nheld] = m2; nheld += 1)) : (" "\n"
+     "    i = 0; loop(nheld, held[i] == m2 ? (held[i] = held[nheld - 1]; nheld -= 1); i += 1);" "\n"
+     "  );" "\n"
+     ");" "\n"
+     "while(next < samplesblock) (" "\n"
+     "  last >= 0 ? midisend(next, 0x80, last, 0);" "\n"
+     "  nheld > 0 ? (cur = (cur + 1) % nheld; last = held[cur]; midisend(next, 0x90, last, 100)) : last = -1;" "\n"
+     "  next += step;" "\n"
+     ");" "\n"
+     "next -= samplesblock;" "\n"},
+    // an analyzer which windows the signal for the FFT, and keeps the spectrum for @gfx
+    {"analyzer",
+     "@init" "\n"
+     "size = 1024; ring = 0; wk = 65536; bins = 131072; win = 196608; pos = 0;" "\n"
+     "i = 0; loop(size, win[i] = 0.5 - 0.5 * cos(2 * $pi * i / size); i += 1);" "\n"
+     "@sample" "\n"
+     "m = 0; ch = 0;" "\n"
+     "loop(num_ch, m += spl(ch); ch += 1);" "\n"
+     "ring[pos] = m / num_ch;" "\n"
+     "(pos += 1) >= size ? (" "\n"
+     "  pos = 0;" "\n"
+     "  i = 0; loop(size, wk[i * 2] = ring[i] * win[i]; wk[i * 2 + 1] = 0; i += 1);" "\n"
+     "  fft(wk, size); fft_permute(wk, size);" "\n"
+     "  i = 0; loop(size / 2, re = wk[i * 2]; im = wk[i * 2 + 1];" "\n"
+     "    bins[i] = bins[i] * 0.8 + 0.2 * 10 * log10(re * re + im * im + 0.000000001); i += 1);" "\n"
+     ");" "\n"
+     "@gfx 400 200" "\n"
+     "i = 1; gfx_x = 0; gfx_y = gfx_h;" "\n"
+     "loop(size / 2 - 1, gfx_lineto(log(i) / log(size / 2) * gfx_w, gfx_h * (1 - (bins[i] + 90) / 90)); i += 1);" "\n"},
+};
@@ -0,0 +1,77 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+#include "ysfx_fft.hpp"
+#include "ysfx_bench_utils.hpp"
+#include <vector>
+#include <cmath>
+
+// Measures the FFT which EEL uses, against the original one of WDL.
+//
+// Usage: ysfx_bench_fft [iterations]
+//
+// One line per transform, size and implementation, in microseconds per
+// forward and inverse pair.
+
+template <class T, class Fn>
+static void bench_run(const char *name, const char *impl, int len, uint32_t iterations, std::vector<T> &buf, Fn &&fn)
+{
+    bench_clock::time_point start = bench_clock::now();
+    for (uint32_t i = 0; i < iterations; ++i) {
+        fn(buf.data(), len, 0);
+        fn(buf.data(), len, 1);
+        // keep the values bounded, as the inverse is not normalized
+        buf[0] *= 1.0 / len;
+    }
+    double seconds = bench_seconds(bench_clock::now() - start);
+    printf("%s,%s,%d,%.3f\n", name, impl, len, seconds / iterations * 1e6);
+    fflush(stdout);
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t iterations = 2000;
+    if (argc > 2) {
+        fprintf(stderr, "Usage: %s [iterations]\n", argv[0]);
+        return 1;
+    }
+    if (argc == 2)
+        iterations = (uint32_t)strtoul(argv[1], nullptr, 10);
+    if (iterations == 0)
+        iterations = 1;
+
+    WDL_fft_init();
+
+    printf("transform,implementation,size,microseconds\n");
+
+    for (int len = 16; len <= 32768; len *= 2) {
+        std::vector<WDL_FFT_REAL> buf(2 * (size_t)len);
+        for (size_t i = 0; i < buf.size(); ++i)
+            buf[i] = std::sin(i * 0.37);
+
+        uint32_t count = std::max<uint32_t>(1, (uint32_t)((uint64_t)iterations * 1024 / len));
+#if defined(YSFX_FFT_SIMD)
+        bench_run("fft", "wdl", len, count, buf, [](WDL_FFT_REAL *p, int n, int inv) { ysfx_wdl_fft((WDL_FFT_COMPLEX *)p, n, inv); });
+#endif
+        bench_run("fft", "ysfx", len, count, buf, [](WDL_FFT_REAL *p, int n, int inv) { WDL_fft((WDL_FFT_COMPLEX *)p, n, inv); });
+#if defined(YSFX_FFT_SIMD)
+        bench_run("fft_real", "wdl", len, count, buf, [](WDL_FFT_REAL *p, int n, int inv) { ysfx_wdl_real_fft(p, n, inv); });
+#endif
+        bench_run("fft_real", "ysfx", len, count, buf, [](WDL_FFT_REAL *p, int n, int inv) { WDL_real_fft(p, n, inv); });
+    }
+
+    return 0;
+}
@@ -0,0 +1,112 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+#if !defined(YSFX_NO_GFX)
+#define WDL_NO_DEFINE_MINMAX
+#include "WDL/swell/swell.h"
+#include "WDL/lice/lice.h"
+#include "ysfx_lice_simd.hpp"
+#endif
+#include "ysfx_bench_utils.hpp"
+#include <functional>
+
+// Measures the LICE drawing which JSFX use the most, against its vectorized paths.
+//
+// Usage: ysfx_bench_gfx [frames]
+//
+// One line per benchmark and implementation, in megapixels per second.
+
+#if !defined(YSFX_NO_GFX)
+static const int bench_width = 1024;
+static const int bench_height = 768;
+
+static void bench_report(const char *name, const char *impl, uint64_t pixels, bench_clock::duration time)
+{
+    double seconds = bench_seconds(time);
+    double rate = bench_per_second(pixels * 1e-6, time);
+    printf("%s,%s,%llu,%.6f,%.1f\n", name, impl, (unsigned long long)pixels, seconds, rate);
+    fflush(stdout);
+}
+
+static void bench_run(const char *name, uint32_t frames, const std::function<void()> &lice, const std::function<bool()> &ysfx)
+{
+    uint64_t pixels = (uint64_t)frames * bench_width * bench_height;
+
+    bench_clock::time_point start = bench_clock::now();
+    for (uint32_t f = 0; f < frames; ++f)
+        lice();
+    bench_report(name, "lice", pixels, bench_clock::now() - start);
+
+    start = bench_clock::now();
+    for (uint32_t f = 0; f < frames; ++f) {
+        if (!ysfx())
+            lice();
+    }
+    bench_report(name, "ysfx", pixels, bench_clock::now() - start);
+}
+#endif
+
+int main(int argc, char *argv[])
+{
+    uint32_t frames = 200;
+    if (argc > 2) {
+        fprintf(stderr, "Usage: %s [frames]\n", argv[0]);
+        return 1;
+    }
+    if (argc == 2)
+        frames = (uint32_t)strtoul(argv[1], nullptr, 10);
+    if (frames == 0)
+        frames = 1;
+
+#if !defined(YSFX_NO_GFX)
+    LICE_MemBitmap dest(bench_width, bench_height);
+    LICE_MemBitmap src(bench_width, bench_height);
+    LICE_pixel *p = src.getBits();
+    for (int i = 0, n = src.getRowSpan() * bench_height; i < n; ++i)
+        p[i] = (LICE_pixel)(i * 2654435761u);
+
+    const int w = bench_width, h = bench_height;
+    const LICE_pixel color = LICE_RGBA(200, 100, 50, 180);
+
+    printf("benchmark,implementation,pixels,seconds,megapixels_per_second\n");
+
+    bench_run("fill_copy_opaque", frames,
+        [&]() { LICE_FillRect(&dest, 0, 0, w, h, color, 1.0f, LICE_BLIT_MODE_COPY); },
+        [&]() { return ysfx::lice_fill_rect(&dest, 0, 0, w, h, color, 1.0f, LICE_BLIT_MODE_COPY); });
+    bench_run("fill_copy_alpha", frames,
+        [&]() { LICE_FillRect(&dest, 0, 0, w, h, color, 0.3f, LICE_BLIT_MODE_COPY); },
+        [&]() { return ysfx::lice_fill_rect(&dest, 0, 0, w, h, color, 0.3f, LICE_BLIT_MODE_COPY); });
+    bench_run("fill_add", frames,
+        [&]() { LICE_FillRect(&dest, 0, 0, w, h, color, 0.3f, LICE_BLIT_MODE_ADD); },
+        [&]() { return ysfx::lice_fill_rect(&dest, 0, 0, w, h, color, 0.3f, LICE_BLIT_MODE_ADD); });
+    bench_run("multiply_add", frames,
+        [&]() { LICE_MultiplyAddRect(&dest, 0, 0, w, h, 0.9f, 0.9f, 0.9f, 1.0f, 1.0f, 2.0f, 3.0f, 0.0f); },
+        [&]() { return ysfx::lice_multiply_add_rect(&dest, 0, 0, w, h, 0.9f, 0.9f, 0.9f, 1.0f, 1.0f, 2.0f, 3.0f, 0.0f); });
+    bench_run("blit_copy_alpha", frames,
+        [&]() { LICE_ScaledBlit(&dest, &src, 0, 0, w, h, 0, 0, (float)w, (float)h, 0.7f, LICE_BLIT_MODE_COPY); },
+        [&]() { return ysfx::lice_scaled_blit(&dest, &src, 0, 0, w, h, 0, 0, (float)w, (float)h, 0.7f, LICE_BLIT_MODE_COPY); });
+    bench_run("blit_source_alpha", frames,
+        [&]() { LICE_ScaledBlit(&dest, &src, 0, 0, w, h, 0, 0, (float)w, (float)h, 1.0f, LICE_BLIT_MODE_COPY|LICE_BLIT_USE_ALPHA); },
+        [&]() { return ysfx::lice_scaled_blit(&dest, &src, 0, 0, w, h, 0, 0, (float)w, (float)h, 1.0f, LICE_BLIT_MODE_COPY|LICE_BLIT_USE_ALPHA); });
+    bench_run("blit_add", frames,
+        [&]() { LICE_ScaledBlit(&dest, &src, 0, 0, w, h, 0, 0, (float)w, (float)h, 0.5f, LICE_BLIT_MODE_ADD); },
+        [&]() { return ysfx::lice_scaled_blit(&dest, &src, 0, 0, w, h, 0, 0, (float)w, (float)h, 0.5f, LICE_BLIT_MODE_ADD); });
+#else
+    fprintf(stderr, "Graphics are not supported in this build\n");
+#endif
+
+    return 0;
+}
@@ -0,0 +1,257 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+#include "ysfx.h"
+#include "ysfx_bench_utils.hpp"
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+
+// Measures the cost of @gfx over a corpus of effects whose interfaces are
+// heavy, without a window, at several sizes and scale factors of the display.
+//
+// Usage: ysfx_bench_gfx_effects [frames] [effect]
+//
+// One line per effect, size and scale, in milliseconds per frame: all of
+// `ysfx_gfx_run`, its EEL code, its drawing by LICE, and the copy into a
+// host image. "dirty" is the fraction of the frame which the host copies.
+
+static const uint32_t bench_sizes[][2] = {{400, 300}, {800, 600}, {1600, 1200}};
+static const ysfx_real bench_scales[] = {1, 2};
+
+struct bench_effect {
+    const char *name;
+    const char *code;
+};
+
+// the code goes after the header; each effect animates, so that every frame draws
+static const bench_effect bench_effects[] = {
+    // bars with gradients, and their values in text
+    {"meters",
+     "@init" "\n"
+     "gfx_ext_retina = 1;" "\n"
+     "@gfx 800 600" "\n"
+     "frame += 1; n = 32; bw = gfx_w / n; i = 0;" "\n"
+     "gfx_set(0.1, 0.1, 0.12); gfx_rect(0, 0, gfx_w, gfx_h);" "\n"
+     "loop(n," "\n"
+     "  v = 0.5 + 0.5 * sin(frame * 0.05 + i * 0.4); bh = v * (gfx_h - 40);" "\n"
+     "  gfx_gradrect(i * bw + 2, gfx_h - 20 - bh, bw - 4, bh, 0.2, 0.9, 0.3, 1, v * 0.01, -0.01, 0, 0, 0, 0, 0, 0);" "\n"
+     "  gfx_set(1, 1, 1); gfx_x = i * bw + 2; gfx_y = gfx_h - 16; gfx_drawnumber(v * 100, 0);" "\n"
+     "  i += 1;" "\n"
+     ");" "\n"},
+    // a curve of many segments over a grid, as the analyzers draw
+    {"spectrum",
+     "@init" "\n"
+     "gfx_ext_retina = 1;" "\n"
+     "@gfx 800 600" "\n"
+     "frame += 1;" "\n"
+     "gfx_set(0, 0, 0); gfx_rect(0, 0, gfx_w, gfx_h);" "\n"
+     "gfx_set(0.3, 0.3, 0.3); i = 1; loop(9, gfx_line(gfx_w * i / 10, 0, gfx_w * i / 10, gfx_h); gfx_line(0, gfx_h * i / 10, gfx_w, gfx_h * i / 10); i += 1);" "\n"
+     "gfx_set(0.4, 0.8, 1); gfx_x = 0; gfx_y = gfx_h / 2; i = 0;" "\n"
+     "loop(1024," "\n"
+     "  x = gfx_w * i / 1023; y = gfx_h * (0.5 + 0.3 * sin(i * 0.03 + frame * 0.1) * cos(i * 0.011));" "\n"
+     "  gfx_lineto(x, y, 1); i += 1;" "\n"
+     ");" "\n"},
+    // a panel of knobs, with arcs, circles and labels
+    {"knobs",
+     "@init" "\n"
+     "gfx_ext_retina = 1;" "\n"
+     "@gfx 800 600" "\n"
+     "frame += 1; cols = 8; rows = 4; kw = gfx_w / cols; kh = gfx_h / rows; r = min(kw, kh) * 0.35;" "\n"
+     "gfx_set(0.15, 0.15, 0.15); gfx_rect(0, 0, gfx_w, gfx_h);" "\n"
+     "j = 0; loop(rows, i = 0; loop(cols," "\n"
+     "  cx = (i + 0.5) * kw; cy = (j + 0.45) * kh; v = 0.5 + 0.5 * sin(frame * 0.03 + i + j * 3);" "\n"
+     "  gfx_set(0.3, 0.3, 0.3); gfx_circle(cx, cy, r, 1, 1);" "\n"
+     "  gfx_set(1, 0.6, 0.1); gfx_arc(cx, cy, r + 3, -2.4, -2.4 + 4.8 * v, 1);" "\n"
+     "  gfx_set(1, 1, 1); gfx_line(cx, cy, cx + r * sin(-2.4 + 4.8 * v), cy - r * cos(-2.4 + 4.8 * v), 1);" "\n"
+     "  gfx_x = cx - r; gfx_y = cy + r + 6; gfx_drawstr(\"Parameter\");" "\n"
+     "  i += 1); j += 1);" "\n"},
+    // an offscreen image, drawn then scaled onto the frame with a fade
+    {"images",
+     "@init" "\n"
+     "gfx_ext_retina = 1;" "\n"
+     "@gfx 800 600" "\n"
+     "frame += 1;" "\n"
+     "gfx_setimgdim(0, 256, 256); gfx_dest = 0;" "\n"
+     "gfx_set(0, 0, 0); gfx_rect(0, 0, 256, 256);" "\n"
+     "i = 0; loop(16, gfx_set(i / 16, 1 - i / 16, 0.5); gfx_circle(128 + 100 * sin(frame * 0.02 + i), 128 + 100 * cos(frame * 0.03 + i), 12, 1, 1); i += 1);" "\n"
+     "gfx_dest = -1; gfx_a = 1;" "\n"
+     "gfx_muladdrect(0, 0, gfx_w, gfx_h, 0.9, 0.9, 0.9, 1);" "\n"
+     "gfx_blit(0, 1, 0, 0, 0, 256, 256, 0, 0, gfx_w / 2, gfx_h);" "\n"
+     "gfx_blit(0, 1, frame * 0.01, 0, 0, 256, 256, gfx_w / 2, 0, gfx_w / 2, gfx_h);" "\n"},
+    // a list of lines of text, as the editors and the browsers draw
+    {"text",
+     "@init" "\n"
+     "gfx_ext_retina = 1;" "\n"
+     "@gfx 800 600" "\n"
+     "frame += 1;" "\n"
+     "gfx_setfont(1, \"Arial\", 14);" "\n"
+     "gfx_set(1, 1, 1); gfx_rect(0, 0, gfx_w, gfx_h);" "\n"
+     "gfx_set(0, 0, 0); gfx_y = 0; i = 0;" "\n"
+     "while (gfx_y < gfx_h) (" "\n"
+     "  gfx_x = 4; gfx_printf(\"%4d  preset %d  gain %.2f dB\", i + frame, i, sin(i + frame * 0.1) * 12);" "\n"
+     "  gfx_y += gfx_texth + 2; i += 1;" "\n"
+     ");" "\n"},
+    // the pixels one by one, where the cost of each call dominates
+    {"pixels",
+     "@init" "\n"
+     "gfx_ext_retina = 1;" "\n"
+     "@gfx 800 600" "\n"
+     "frame += 1; y = 0;" "\n"
+     "loop(128, x = 0; loop(128," "\n"
+     "  gfx_x = x; gfx_y = y; gfx_setpixel((x + frame) % 128 / 128, y / 128, 0.5);" "\n"
+     "  x += 1); y += 1);" "\n"},
+};
+
+struct bench_result {
+    uint32_t frames = 0;
+    double run_ms = 0;
+    double eel_ms = 0;
+    double lice_ms = 0;
+    double copy_ms = 0;
+    double dirty = 0;
+};
+
+static ysfx_t *bench_load(const bench_effect &effect)
+{
+    std::string text = "desc:bench" "\n";
+    text += effect.code;
+
+    ysfx_u fx{bench_compile(text, effect.name)};
+    ysfx_set_sample_rate(fx.get(), 48000);
+    ysfx_set_block_size(fx.get(), 256);
+    ysfx_init(fx.get());
+    return fx.release();
+}
+
+// the copy of the region which was drawn on into a host image, without its alpha
+static void bench_copy(const uint8_t *src, uint8_t *dst, uint32_t width, const uint32_t rect[4])
+{
+    for (uint32_t y = rect[1]; y < rect[1] + rect[3]; ++y) {
+        const uint32_t *s = (const uint32_t *)&src[4 * ((size_t)y * width + rect[0])];
+        uint32_t *d = (uint32_t *)&dst[4 * ((size_t)y * width + rect[0])];
+        for (uint32_t x = 0; x < rect[2]; ++x)
+            d[x] = s[x] | 0xff000000u;
+    }
+}
+
+static bench_result bench_run(const bench_effect &effect, uint32_t width, uint32_t height, ysfx_real scale, uint32_t frames)
+{
+    ysfx_u fx{bench_load(effect)};
+
+    const uint32_t pixel_width = (uint32_t)(width * scale);
+    const uint32_t pixel_height = (uint32_t)(height * scale);
+    std::vector<uint8_t> pixels(4 * (size_t)pixel_width * pixel_height);
+    std::vector<uint8_t> host(pixels.size());
+
+    ysfx_gfx_config_t gc{};
+    gc.pixel_width = pixel_width;
+    gc.pixel_height = pixel_height;
+    gc.pixels = pixels.data();
+    gc.scale_factor = scale;
+    ysfx_gfx_setup(fx.get(), &gc);
+
+    // the first frames load the fonts and make the images
+    for (uint32_t f = 0; f < 3; ++f)
+        ysfx_gfx_run(fx.get());
+
+    ysfx_reset_profile_stats(fx.get());
+    ysfx_set_profiling(fx.get(), true);
+
+    bench_clock::duration run_time{};
+    bench_clock::duration copy_time{};
+    uint64_t dirty_pixels = 0;
+
+    for (uint32_t f = 0; f < frames; ++f) {
+        bench_clock::time_point start = bench_clock::now();
+        bool drawn = ysfx_gfx_run(fx.get());
+        bench_clock::time_point middle = bench_clock::now();
+        uint32_t rect[4];
+        if (!ysfx_gfx_get_dirty_rect(fx.get(), rect)) {
+            rect[0] = rect[1] = 0;
+            rect[2] = pixel_width;
+            rect[3] = pixel_height;
+        }
+        if (drawn) {
+            bench_copy(pixels.data(), host.data(), pixel_width, rect);
+            dirty_pixels += (uint64_t)rect[2] * rect[3];
+        }
+        bench_clock::time_point end = bench_clock::now();
+        run_time += middle - start;
+        copy_time += end - middle;
+    }
+
+    ysfx_set_profiling(fx.get(), false);
+
+    ysfx_profile_stats_t stats{};
+    ysfx_get_profile_stats(fx.get(), ysfx_section_gfx, &stats);
+    uint64_t draw_ns = ysfx_get_gfx_draw_ns(fx.get());
+
+    gc.pixel_width = 0;
+    gc.pixel_height = 0;
+    gc.pixels = nullptr;
+    ysfx_gfx_setup(fx.get(), &gc);
+
+    bench_result result;
+    result.frames = frames;
+    result.run_ms = 1e3 * bench_seconds(run_time) / frames;
+    result.eel_ms = 1e-6 * (double)(stats.total_ns - std::min(stats.total_ns, draw_ns)) / frames;
+    result.lice_ms = 1e-6 * (double)draw_ns / frames;
+    result.copy_ms = 1e3 * bench_seconds(copy_time) / frames;
+    result.dirty = (double)dirty_pixels / ((double)frames * pixel_width * pixel_height);
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t frames = 100;
+    const char *only = nullptr;
+    if (argc > 3) {
+        fprintf(stderr, "Usage: %s [frames] [effect]\n", argv[0]);
+        return 1;
+    }
+    if (argc >= 2)
+        frames = (uint32_t)strtoul(argv[1], nullptr, 10);
+    if (argc >= 3)
+        only = argv[2];
+    if (frames == 0)
+        frames = 1;
+
+    printf("effect,width,height,scale,frames,run_ms,eel_ms,lice_ms,copy_ms,dirty\n");
+
+    bool found = false;
+    for (const bench_effect &effect : bench_effects) {
+        if (only && strcmp(only, effect.name) != 0)
+            continue;
+        found = true;
+        for (const uint32_t *size : bench_sizes) {
+            for (ysfx_real scale : bench_scales) {
+                bench_result result = bench_run(effect, size[0], size[1], scale, frames);
+                printf("%s,%u,%u,%g,%u,%.4f,%.4f,%.4f,%.4f,%.3f\n", effect.name, size[0], size[1], scale,
+                       result.frames, result.run_ms, result.eel_ms, result.lice_ms, result.copy_ms, result.dirty);
+                fflush(stdout);
+            }
+        }
+    }
+
+    if (!found) {
+        fprintf(stderr, "Unknown effect: %s\n", only);
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,167 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+#include "ysfx.h"
+#include "ysfx_bench_utils.hpp"
+#include <string>
+#include <vector>
+
+// Measures the code which the JIT of EEL generates, over kernels which are
+// typical of JSFX, so that machines of different architectures compare.
+//
+// Usage: ysfx_bench_jit [seconds-of-audio]
+//
+// One line per kernel, in nanoseconds per frame. The checksum is the sum of
+// the output, the same on every architecture for the kernels which call no
+// math library, so it also catches a wrong code generator.
+
+static const uint32_t bench_block = 256;
+static const ysfx_real bench_rate = 48000;
+
+struct bench_kernel {
+    const char *name;
+    const char *code;
+};
+
+// the code goes after the header, "@init" comes first if any
+static const bench_kernel bench_kernels[] = {
+    // many variables alive at once, the register pressure of a long expression
+    {"arith",
+     "@sample" "\n"
+     "a = spl0 * 0.5 + 0.25; b = a * a - 0.125; c = b * a + a * 0.75;" "\n"
+     "d = (a + b) * (c - a) + b * c; e = d * 0.0625 + c * b - a;" "\n"
+     "spl0 = (a - b + c - d + e) * 0.1;" "\n"},
+    // the state of filters, in variables which persist across samples
+    {"biquad",
+     "@init" "\n"
+     "b0 = 0.2; b1 = 0.4; b2 = 0.2; a1 = -0.5; a2 = 0.3;" "\n"
+     "@sample" "\n"
+     "x = spl0;" "\n"
+     "y = b0 * x + s1; s1 = b1 * x - a1 * y + s2; s2 = b2 * x - a2 * y;" "\n"
+     "y2 = b0 * y + t1; t1 = b1 * y - a1 * y2 + t2; t2 = b2 * y - a2 * y2;" "\n"
+     "spl0 = y2;" "\n"},
+    // a delay line with a feedback, which reads and writes the memory
+    {"delay",
+     "@init" "\n"
+     "len = 12345; buf = 0; pos = 0;" "\n"
+     "@sample" "\n"
+     "d = buf[pos]; buf[pos] = spl0 + d * 0.5;" "\n"
+     "(pos += 1) >= len ? pos = 0;" "\n"
+     "spl0 = d;" "\n"},
+    // a short inner loop, as the FIR filters of JSFX do
+    {"fir_loop",
+     "@init" "\n"
+     "n = 32; h = 100000; x = 200000; i = 0;" "\n"
+     "loop(n, h[i] = 1 / (i + 1); i += 1);" "\n"
+     "@sample" "\n"
+     "i = n - 1; loop(n - 1, x[i] = x[i - 1]; i -= 1); x[0] = spl0;" "\n"
+     "acc = 0; i = 0; loop(n, acc += h[i] * x[i]; i += 1);" "\n"
+     "spl0 = acc;" "\n"},
+    // conditions and the comparison builtins
+    {"branch",
+     "@sample" "\n"
+     "x = spl0;" "\n"
+     "x > 0.5 ? x = 1 - x : x < -0.5 ? x = -1 - x;" "\n"
+     "y = abs(x) > 0.25 ? sign(x) * 0.25 : x;" "\n"
+     "spl0 = min(max(y * 3, -0.5), 0.5);" "\n"},
+    // user functions with locals and instance variables
+    {"functions",
+     "@init" "\n"
+     "function lp(x, k) instance(s) (s += (x - s) * k);" "\n"
+     "function shape(x) local(t) (t = x * x; x * (1.5 - 0.5 * t));" "\n"
+     "@sample" "\n"
+     "spl0 = shape(f1.lp(spl0, 0.1)) + shape(f2.lp(spl0, 0.3));" "\n"},
+    // the calls into the math library
+    {"math",
+     "@sample" "\n"
+     "x = spl0;" "\n"
+     "spl0 = sin(x) * 0.5 + exp(-abs(x)) * 0.25 + log(1 + x * x) * 0.125 + sqrt(abs(x)) * 0.0625;" "\n"},
+    // the builtins which work on the memory by blocks
+    {"block_builtins",
+     "@init" "\n"
+     "a = 0; b = 70000; n = 256; i = 0;" "\n"
+     "loop(n, b[i] = i / n; i += 1);" "\n"
+     "@block" "\n"
+     "mem_mul(a, b, n); mem_add_scaled(a, b, 0.5, n); m = mem_abs_max(a, n);" "\n"
+     "@sample" "\n"
+     "spl0 = spl0 * 0.5 + m * 0.001;" "\n"},
+};
+
+static void bench_report(const char *name, uint64_t frames, bench_clock::duration time, double checksum)
+{
+    double seconds = bench_seconds(time);
+    double ns = (frames > 0) ? (seconds * 1e9 / frames) : 0;
+    printf("%s,%s,%llu,%.6f,%.2f,%.17g\n", name, bench_arch, (unsigned long long)frames, seconds, ns, checksum);
+    fflush(stdout);
+}
+
+static void bench_run(const bench_kernel &kernel, uint64_t frames)
+{
+    std::string text =
+        "desc:bench" "\n"
+        "in_pin:input" "\n"
+        "out_pin:output" "\n";
+    text += kernel.code;
+
+    ysfx_u fx{bench_compile(text, kernel.name)};
+    ysfx_set_block_size(fx.get(), bench_block);
+    ysfx_set_sample_rate(fx.get(), bench_rate);
+    ysfx_init(fx.get());
+
+    // a deterministic input, the same on every machine
+    std::vector<double> input(bench_block);
+    std::vector<double> output(bench_block);
+    uint32_t seed = 1;
+    const double *ins[] = {input.data()};
+    double *outs[] = {output.data()};
+
+    double checksum = 0;
+    bench_clock::duration time{};
+    for (uint64_t done = 0; done < frames; done += bench_block) {
+        for (uint32_t i = 0; i < bench_block; ++i) {
+            seed = seed * 1103515245u + 12345u;
+            input[i] = (double)(seed >> 8) / (1u << 24) - 0.5;
+        }
+        bench_clock::time_point start = bench_clock::now();
+        ysfx_process_double(fx.get(), ins, outs, 1, 1, bench_block);
+        time += bench_clock::now() - start;
+        for (uint32_t i = 0; i < bench_block; ++i)
+            checksum += output[i];
+    }
+
+    bench_report(kernel.name, (frames + bench_block - 1) / bench_block * bench_block, time, checksum);
+}
+
+int main(int argc, char *argv[])
+{
+    double seconds = 20;
+    if (argc > 2) {
+        fprintf(stderr, "Usage: %s [seconds-of-audio]\n", argv[0]);
+        return 1;
+    }
+    if (argc >= 2)
+        seconds = strtod(argv[1], nullptr);
+    if (!(seconds > 0))
+        seconds = 1;
+
+    uint64_t frames = (uint64_t)(seconds * bench_rate);
+
+    printf("kernel,arch,frames,seconds,ns_per_frame,checksum\n");
+    for (const bench_kernel &kernel : bench_kernels)
+        bench_run(kernel, frames);
+
+    return 0;
+}
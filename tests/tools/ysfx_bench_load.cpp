@@ -0,0 +1,276 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+#include "ysfx.h"
+#include "ysfx_utils.hpp"
+#include "ysfx_bench_utils.hpp"
+#include <string>
+#include <vector>
+#if !defined(_WIN32)
+#   include <sys/stat.h>
+#   include <unistd.h>
+#else
+#   include <direct.h>
+#endif
+
+// Measures the loading of an effect with a deep tree of imports, under an
+// import root which holds many other files, by phase and by the number of
+// instances which are alive at once.
+//
+// Usage: ysfx_bench_load [max-instances]
+//
+// One line per scenario and instance count, in milliseconds per instance, by
+// phase of ysfx_get_load_stats. "shared" keeps the instances alive, sharing
+// the parsed files; "isolated" and "disk_cache" free each before the next,
+// without or with the cache on disk. The first line is the first load.
+
+static const uint32_t bench_depth = 5;
+static const uint32_t bench_fanout = 2;
+static const uint32_t bench_noise_dirs = 20;
+static const uint32_t bench_noise_files = 20;
+static const uint32_t bench_counts[] = {1, 10, 50, 100, 200, 500};
+
+struct bench_phases {
+    double load = 0;
+    double compile = 0;
+    double init = 0;
+    double io = 0;
+    double preprocess = 0;
+    double parse = 0;
+    double import = 0;
+    uint64_t files = 0;
+    uint64_t cached_files = 0;
+};
+
+static double bench_ms(bench_clock::duration time)
+{
+    return 1e3 * bench_seconds(time);
+}
+
+static void bench_report(const char *name, uint32_t instances, const bench_phases &sum)
+{
+    double n = instances;
+    printf("%s,%u,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.1f,%.1f\n", name, instances,
+           sum.load / n, sum.compile / n, sum.init / n, sum.io / n, sum.preprocess / n,
+           sum.parse / n, sum.import / n, sum.files / n, sum.cached_files / n);
+    fflush(stdout);
+}
+
+//------------------------------------------------------------------------------
+// a tree of files on disk, removed at the end
+struct bench_tree {
+    bench_tree();
+    ~bench_tree();
+    void make_dir(const std::string &path);
+    void make_file(const std::string &path, const std::string &text);
+    std::string m_root;
+    std::string m_main;
+    std::string m_cache;
+    std::vector<std::string> m_files;
+    std::vector<std::string> m_dirs;
+};
+
+void bench_tree::make_dir(const std::string &path)
+{
+#if !defined(_WIN32)
+    int ret = mkdir(path.c_str(), 0755);
+#else
+    int ret = _mkdir(path.c_str());
+#endif
+    if (ret != 0) {
+        fprintf(stderr, "Cannot create the directory: %s\n", path.c_str());
+        exit(1);
+    }
+    m_dirs.push_back(path);
+}
+
+void bench_tree::make_file(const std::string &path, const std::string &text)
+{
+    FILE *stream = fopen(path.c_str(), "wb");
+    if (!stream || fwrite(text.data(), 1, text.size(), stream) != text.size()) {
+        fprintf(stderr, "Cannot write the file: %s\n", path.c_str());
+        exit(1);
+    }
+    fclose(stream);
+    m_files.push_back(path);
+}
+
+// each library defines functions, and imports the next level by name alone,
+// so the import is searched below the root
+static std::string bench_library(uint32_t level, uint32_t index)
+{
+    std::string id = std::to_string(level) + "_" + std::to_string(index);
+    std::string text;
+    if (level + 1 < bench_depth) {
+        for (uint32_t k = 0; k < bench_fanout; ++k)
+            text += "import bench_lib_" + std::to_string(level + 1) + "_" + std::to_string(index * bench_fanout + k) + ".jsfx-inc" "\n";
+    }
+    text +=
+        "@init" "\n"
+        "function lib_filter_" + id + "(x, k) instance(s) (s += (x - s) * k);" "\n"
+        "function lib_shape_" + id + "(x) local(t) (t = x * x; x * (1.5 - 0.5 * t));" "\n"
+        "function lib_table_" + id + "(n) local(i) (i = 0; loop(n, this[i] = sin(i / n * $pi); i += 1));" "\n"
+        "lib_state_" + id + " = " + std::to_string(level * 100 + index) + ";" "\n";
+    return text;
+}
+
+bench_tree::bench_tree()
+{
+    m_root = bench_temp_path("");
+    make_dir(m_root);
+    make_dir(m_root + "/Effects");
+    make_dir(m_root + "/Effects/bench");
+    make_dir(m_root + "/Effects/libs");
+    make_dir(m_root + "/Effects/libs/deep");
+    make_dir(m_root + "/Cache");
+    m_cache = m_root + "/Cache";
+
+    // the other files of a library, which the index of the imports goes through
+    for (uint32_t d = 0; d < bench_noise_dirs; ++d) {
+        std::string dir = m_root + "/Effects/other_" + std::to_string(d);
+        make_dir(dir);
+        for (uint32_t f = 0; f < bench_noise_files; ++f)
+            make_file(dir + "/other_" + std::to_string(f) + ".jsfx-inc", "@init" "\n" "x = 1;" "\n");
+    }
+
+    uint32_t width = 1;
+    for (uint32_t level = 0; level < bench_depth; ++level, width *= bench_fanout) {
+        for (uint32_t index = 0; index < width; ++index) {
+            std::string name = "bench_lib_" + std::to_string(level) + "_" + std::to_string(index) + ".jsfx-inc";
+            make_file(m_root + "/Effects/libs/deep/" + name, bench_library(level, index));
+        }
+    }
+
+    m_main = m_root + "/Effects/bench/main.jsfx";
+    make_file(m_main,
+              "desc:bench load" "\n"
+              "slider1:0.5<0,1,0.01>Amount" "\n"
+              "in_pin:input" "\n"
+              "out_pin:output" "\n"
+              "import bench_lib_0_0.jsfx-inc" "\n"
+              "@init" "\n"
+              "t.lib_table_0_0(64);" "\n"
+              "@slider" "\n"
+              "k = slider1;" "\n"
+              "@sample" "\n"
+              "spl0 = lib_shape_0_0(f.lib_filter_0_0(spl0, k));" "\n");
+}
+
+bench_tree::~bench_tree()
+{
+    for (const std::string &file : m_files)
+        remove(file.c_str());
+    // the cache writes files of its own
+    for (const std::string &entry : ysfx::list_directory(m_cache.c_str()))
+        remove((m_cache + "/" + entry).c_str());
+    for (size_t i = m_dirs.size(); i-- > 0;) {
+#if !defined(_WIN32)
+        rmdir(m_dirs[i].c_str());
+#else
+        _rmdir(m_dirs[i].c_str());
+#endif
+    }
+}
+
+//------------------------------------------------------------------------------
+static ysfx_t *bench_load(ysfx_config_t *config, const bench_tree &tree, bench_phases &sum)
+{
+    ysfx_u fx{ysfx_new(config)};
+
+    bench_clock::time_point start = bench_clock::now();
+    bool ok = ysfx_load_file(fx.get(), tree.m_main.c_str(), 0);
+    bench_clock::time_point loaded = bench_clock::now();
+    ok = ok && ysfx_compile(fx.get(), 0);
+    bench_clock::time_point compiled = bench_clock::now();
+    if (!ok) {
+        fprintf(stderr, "Cannot load the effect: %s\n", tree.m_main.c_str());
+        exit(1);
+    }
+    ysfx_init(fx.get());
+    bench_clock::time_point initialized = bench_clock::now();
+
+    ysfx_load_stats_t stats{};
+    ysfx_get_load_stats(fx.get(), &stats);
+    sum.load += bench_ms(loaded - start);
+    sum.compile += bench_ms(compiled - loaded);
+    sum.init += bench_ms(initialized - compiled);
+    sum.io += stats.io_ns * 1e-6;
+    sum.preprocess += stats.preprocess_ns * 1e-6;
+    sum.parse += stats.parse_ns * 1e-6;
+    sum.import += stats.import_ns * 1e-6;
+    sum.files += stats.num_files;
+    sum.cached_files += stats.num_cached_files;
+    return fx.release();
+}
+
+static ysfx_config_t *bench_config(const bench_tree &tree, bool disk_cache)
+{
+    ysfx_config_t *config = ysfx_config_new();
+    ysfx_set_import_root(config, (tree.m_root + "/Effects").c_str());
+    if (disk_cache)
+        ysfx_set_cache_root(config, tree.m_cache.c_str());
+    return config;
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t max_instances = 500;
+    if (argc > 2) {
+        fprintf(stderr, "Usage: %s [max-instances]\n", argv[0]);
+        return 1;
+    }
+    if (argc >= 2)
+        max_instances = (uint32_t)strtoul(argv[1], nullptr, 10);
+    if (max_instances < 1)
+        max_instances = 1;
+
+    bench_tree tree;
+
+    printf("scenario,instances,load_ms,compile_ms,init_ms,io_ms,preprocess_ms,parse_ms,import_ms,files,cached_files\n");
+
+    {
+        ysfx_config_u config{bench_config(tree, false)};
+        bench_phases sum;
+        ysfx_u{bench_load(config.get(), tree, sum)};
+        bench_report("cold", 1, sum);
+    }
+
+    for (uint32_t count : bench_counts) {
+        if (count > max_instances)
+            break;
+
+        {
+            ysfx_config_u config{bench_config(tree, false)};
+            bench_phases sum;
+            std::vector<ysfx_u> alive;
+            alive.reserve(count);
+            for (uint32_t i = 0; i < count; ++i)
+                alive.emplace_back(bench_load(config.get(), tree, sum));
+            bench_report("shared", count, sum);
+        }
+
+        const char *names[] = {"isolated", "disk_cache"};
+        for (int disk_cache = 0; disk_cache < 2; ++disk_cache) {
+            ysfx_config_u config{bench_config(tree, disk_cache != 0)};
+            bench_phases sum;
+            for (uint32_t i = 0; i < count; ++i)
+                ysfx_u{bench_load(config.get(), tree, sum)};
+            bench_report(names[disk_cache], count, sum);
+        }
+    }
+
+    return 0;
+}
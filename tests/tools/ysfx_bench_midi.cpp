@@ -0,0 +1,197 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+#include "ysfx.h"
+#include "ysfx_midi.hpp"
+#include "ysfx_bench_utils.hpp"
+#include <string>
+#include <vector>
+
+// Measures the throughput of the MIDI buffers and of the JSFX MIDI functions.
+//
+// Usage: ysfx_bench_midi [blocks]
+//
+// One line per benchmark, density and bus count, in events per second.
+
+static const uint32_t bench_densities[] = {16, 256, 4096};
+static const uint32_t bench_buses[] = {1, 4, 16};
+static const uint32_t bench_block_size = 4096;
+
+static void bench_report(const char *name, uint32_t density, uint32_t buses, uint64_t events, bench_clock::duration time)
+{
+    double seconds = bench_seconds(time);
+    double rate = bench_per_second((double)events, time);
+    printf("%s,%u,%u,%llu,%.6f,%.0f\n", name, density, buses, (unsigned long long)events, seconds, rate);
+    fflush(stdout);
+}
+
+static void bench_fill(ysfx_midi_buffer_t *midi, uint32_t density, uint32_t buses)
+{
+    static const uint8_t msg[3] = {0x90, 60, 64};
+    ysfx_midi_clear(midi);
+    for (uint32_t i = 0; i < density; ++i) {
+        ysfx_midi_event_t event;
+        event.bus = i % buses;
+        event.offset = i * bench_block_size / density;
+        event.size = 3;
+        event.data = msg;
+        ysfx_midi_push(midi, &event);
+    }
+}
+
+//------------------------------------------------------------------------------
+static void bench_buffer(uint32_t blocks, uint32_t density, uint32_t buses)
+{
+    ysfx_midi_buffer_t midi;
+    ysfx_midi_reserve(&midi, density * 16, false);
+
+    uint64_t events = (uint64_t)blocks * density;
+    ysfx_midi_event_t event;
+
+    bench_clock::time_point start = bench_clock::now();
+    for (uint32_t b = 0; b < blocks; ++b)
+        bench_fill(&midi, density, buses);
+    bench_report("push", density, buses, events, bench_clock::now() - start);
+
+    start = bench_clock::now();
+    for (uint32_t b = 0; b < blocks; ++b) {
+        ysfx_midi_rewind(&midi);
+        while (ysfx_midi_get_next(&midi, &event));
+    }
+    bench_report("get_next", density, buses, events, bench_clock::now() - start);
+
+    // rewinding drops the index, so this times the indexing along with reading
+    start = bench_clock::now();
+    for (uint32_t b = 0; b < blocks; ++b) {
+        ysfx_midi_rewind(&midi);
+        for (uint32_t bus = 0; bus < buses; ++bus)
+            while (ysfx_midi_get_next_from_bus(&midi, bus, &event));
+    }
+    bench_report("get_next_from_bus", density, buses, events, bench_clock::now() - start);
+}
+
+//------------------------------------------------------------------------------
+struct bench_script {
+    explicit bench_script(const std::string &text);
+    ysfx_u m_fx;
+};
+
+bench_script::bench_script(const std::string &text)
+{
+    m_fx.reset(bench_compile(text, "midi"));
+    ysfx_set_block_size(m_fx.get(), bench_block_size);
+    ysfx_set_midi_capacity(m_fx.get(), 1 << 20, true);
+    ysfx_init(m_fx.get());
+}
+
+static std::string bench_script_sending(const char *call, uint32_t density, uint32_t buses)
+{
+    std::string text =
+        "desc:bench" "\n"
+        "out_pin:output" "\n"
+        "@init" "\n"
+        "ext_midi_bus = 1;" "\n"
+        "msg = 1000;" "\n"
+        "msg[0] = 0x90; msg[1] = 60; msg[2] = 64;" "\n"
+        "@block" "\n"
+        "i = 0;" "\n"
+        "loop(" + std::to_string(density) + "," "\n"
+        "  midi_bus = i % " + std::to_string(buses) + ";" "\n"
+        "  ofs = floor(i * " + std::to_string(bench_block_size) + " / " + std::to_string(density) + ");" "\n"
+        "  " + call + ";" "\n"
+        "  i += 1;" "\n"
+        ");" "\n";
+    return text;
+}
+
+static std::string bench_script_receiving(uint32_t buses)
+{
+    std::string text =
+        "desc:bench" "\n"
+        "out_pin:output" "\n"
+        "@init" "\n"
+        "ext_midi_bus = 1;" "\n"
+        "@block" "\n"
+        "midi_bus = 0;" "\n"
+        "loop(" + std::to_string(buses) + "," "\n"
+        "  while(midirecv(ofs, m1, m2, m3)) (n += 1);" "\n"
+        "  midi_bus += 1;" "\n"
+        ");" "\n";
+    return text;
+}
+
+static void bench_eel(uint32_t blocks, uint32_t density, uint32_t buses)
+{
+    uint64_t events = (uint64_t)blocks * density;
+    ysfx_midi_event_t event;
+
+    const char *send_names[] = {"eel_midisend", "eel_midisend_buf"};
+    const char *send_calls[] = {"midisend(ofs, 0x90, 60, 64)", "midisend_buf(ofs, msg, 3)"};
+
+    for (uint32_t k = 0; k < 2; ++k) {
+        bench_script script(bench_script_sending(send_calls[k], density, buses));
+        ysfx_t *fx = script.m_fx.get();
+        bench_clock::time_point start = bench_clock::now();
+        for (uint32_t b = 0; b < blocks; ++b) {
+            ysfx_process_float(fx, nullptr, nullptr, 0, 0, bench_block_size);
+            while (ysfx_receive_midi(fx, &event));
+        }
+        bench_report(send_names[k], density, buses, events, bench_clock::now() - start);
+    }
+
+    {
+        static const uint8_t msg[3] = {0x90, 60, 64};
+        bench_script script(bench_script_receiving(buses));
+        ysfx_t *fx = script.m_fx.get();
+        bench_clock::time_point start = bench_clock::now();
+        for (uint32_t b = 0; b < blocks; ++b) {
+            for (uint32_t i = 0; i < density; ++i) {
+                event.bus = i % buses;
+                event.offset = i * bench_block_size / density;
+                event.size = 3;
+                event.data = msg;
+                ysfx_send_midi(fx, &event);
+            }
+            ysfx_process_float(fx, nullptr, nullptr, 0, 0, bench_block_size);
+        }
+        bench_report("eel_midirecv", density, buses, events, bench_clock::now() - start);
+    }
+}
+
+//------------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    uint32_t blocks = 1000;
+    if (argc > 2) {
+        fprintf(stderr, "Usage: %s [blocks]\n", argv[0]);
+        return 1;
+    }
+    if (argc == 2)
+        blocks = (uint32_t)strtoul(argv[1], nullptr, 10);
+    if (blocks == 0)
+        blocks = 1;
+
+    printf("benchmark,events_per_block,buses,events,seconds,events_per_second\n");
+
+    for (uint32_t density : bench_densities) {
+        for (uint32_t buses : bench_buses) {
+            bench_buffer(blocks, density, buses);
+            bench_eel(blocks, density, buses);
+        }
+    }
+
+    return 0;
+}
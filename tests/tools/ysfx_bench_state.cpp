@@ -0,0 +1,256 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+#include "ysfx.h"
+#include "ysfx_bench_utils.hpp"
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <cstring>
+
+// Measures the throughput of saving and loading states and banks, and checks
+// that the states come back unchanged on the way.
+//
+// Usage: ysfx_bench_state [max-megabytes] [fuzz-rounds]
+//
+// One line per benchmark and size, in megabytes and presets per second. The
+// fuzz rounds stop with an error at the first state which does not round-trip.
+
+static const uint32_t bench_bank_presets[] = {16, 256, 4096};
+static const size_t bench_bank_payload = 256;
+
+static void bench_report(const char *name, uint64_t payload, uint32_t presets, uint32_t iterations, uint64_t bytes, bench_clock::duration time)
+{
+    double seconds = bench_seconds(time);
+    double mbps = bench_per_second((double)bytes / (1 << 20), time);
+    double pps = bench_per_second((double)presets * iterations, time);
+    printf("%s,%llu,%u,%u,%.6f,%.3f,%.0f\n", name, (unsigned long long)payload, presets, iterations, seconds, mbps, pps);
+    fflush(stdout);
+}
+
+//------------------------------------------------------------------------------
+// an effect which serializes a number of slots of its memory, filled at random
+struct bench_script {
+    bench_script(uint32_t slots, uint32_t seed);
+    ysfx_u m_fx;
+};
+
+bench_script::bench_script(uint32_t slots, uint32_t seed)
+{
+    std::string text =
+        "desc:bench" "\n"
+        "out_pin:output" "\n"
+        "slider1:0.5<0,1,0.001>the slider 1" "\n"
+        "slider2:3<0,10,1>the slider 2" "\n"
+        "@init" "\n"
+        "n = " + std::to_string(slots) + ";" "\n"
+        "s = " + std::to_string(seed) + ";" "\n"
+        "i = 0;" "\n"
+        "loop(n," "\n"
+        "  s = (s * 1103515245 + 12345) % 2147483648;" "\n"
+        "  i[0] = s / 2147483648 - 0.5;" "\n"
+        "  i += 1;" "\n"
+        ");" "\n"
+        "@serialize" "\n"
+        "file_mem(0, 0, n);" "\n";
+
+    m_fx.reset(bench_compile(text, "state"));
+    ysfx_init(m_fx.get());
+}
+
+static bool bench_same_state(const ysfx_state_t *a, const ysfx_state_t *b)
+{
+    if (a->slider_count != b->slider_count || a->data_size != b->data_size)
+        return false;
+    for (uint32_t i = 0; i < a->slider_count; ++i) {
+        if (a->sliders[i].index != b->sliders[i].index || a->sliders[i].value != b->sliders[i].value)
+            return false;
+    }
+    return memcmp(a->data, b->data, a->data_size) == 0;
+}
+
+//------------------------------------------------------------------------------
+static void bench_state(uint64_t payload, bool lossless)
+{
+    uint32_t slots = (uint32_t)(payload / (lossless ? 8 : 4));
+    bench_script script(slots, 1);
+    ysfx_t *fx = script.m_fx.get();
+    ysfx_set_lossless_serialization(fx, lossless);
+
+    // repeat the small ones, so the time is not all in the clock
+    uint32_t iterations = (uint32_t)std::max<uint64_t>(1, ((uint64_t)64 << 20) / std::max<uint64_t>(payload, 1024));
+    iterations = std::min<uint32_t>(iterations, 10000);
+
+    ysfx_state_u state;
+    bench_clock::time_point start = bench_clock::now();
+    for (uint32_t i = 0; i < iterations; ++i)
+        state.reset(ysfx_save_state(fx));
+    bench_report(lossless ? "save_state_f64" : "save_state", payload, 1, iterations, (uint64_t)iterations * state->data_size, bench_clock::now() - start);
+
+    start = bench_clock::now();
+    for (uint32_t i = 0; i < iterations; ++i)
+        ysfx_load_state(fx, state.get());
+    bench_report(lossless ? "load_state_f64" : "load_state", payload, 1, iterations, (uint64_t)iterations * state->data_size, bench_clock::now() - start);
+
+    ysfx_state_u again{ysfx_save_state(fx)};
+    if (!bench_same_state(state.get(), again.get())) {
+        fprintf(stderr, "The state of %llu bytes does not round-trip\n", (unsigned long long)payload);
+        exit(1);
+    }
+}
+
+//------------------------------------------------------------------------------
+static ysfx_bank_t *bench_make_bank(ysfx_state_t *state, uint32_t presets)
+{
+    ysfx_bank_u bank{ysfx_create_empty_bank("bench")};
+    for (uint32_t i = 0; i < presets; ++i) {
+        std::string name = "preset " + std::to_string(i);
+        bank.reset(ysfx_add_preset_to_bank(bank.get(), name.c_str(), ysfx_state_dup(state)));
+    }
+    return bank.release();
+}
+
+static uint64_t bench_file_size(const std::string &path)
+{
+    FILE *stream = fopen(path.c_str(), "rb");
+    if (!stream)
+        return 0;
+    fseek(stream, 0, SEEK_END);
+    long size = ftell(stream);
+    fclose(stream);
+    return (size > 0) ? (uint64_t)size : 0;
+}
+
+static void bench_bank(uint32_t presets, bool binary)
+{
+    bench_script script((uint32_t)(bench_bank_payload / 4), 2);
+    ysfx_state_u state{ysfx_save_state(script.m_fx.get())};
+    ysfx_bank_u bank{bench_make_bank(state.get(), presets)};
+
+    std::string path = bench_temp_path(binary ? ".ysfxbank" : ".rpl");
+    uint32_t iterations = std::max<uint32_t>(1, 4096 / presets);
+
+    bench_clock::time_point start = bench_clock::now();
+    for (uint32_t i = 0; i < iterations; ++i) {
+        if (!(binary ? ysfx_save_bank_binary : ysfx_save_bank)(path.c_str(), bank.get())) {
+            fprintf(stderr, "Cannot save the bank: %s\n", path.c_str());
+            exit(1);
+        }
+    }
+    bench_clock::duration time = bench_clock::now() - start;
+    uint64_t size = bench_file_size(path);
+    bench_report(binary ? "save_bank_binary" : "save_bank", bench_bank_payload, presets, iterations, iterations * size, time);
+
+    ysfx_bank_u loaded;
+    start = bench_clock::now();
+    for (uint32_t i = 0; i < iterations; ++i)
+        loaded.reset(ysfx_load_bank(path.c_str()));
+    bench_report(binary ? "load_bank_binary" : "load_bank", bench_bank_payload, presets, iterations, iterations * size, bench_clock::now() - start);
+
+    // only the lazy part: the names and ranges of the presets
+    if (!binary) {
+        start = bench_clock::now();
+        for (uint32_t i = 0; i < iterations; ++i)
+            loaded.reset(ysfx_load_bank_index(path.c_str(), nullptr));
+        bench_report("load_bank_index", bench_bank_payload, presets, iterations, iterations * size, bench_clock::now() - start);
+        loaded.reset(ysfx_load_bank(path.c_str()));
+    }
+
+    remove(path.c_str());
+
+    if (!loaded || loaded->preset_count != presets) {
+        fprintf(stderr, "The bank of %u presets does not round-trip\n", presets);
+        exit(1);
+    }
+    // the text format keeps the data exactly, though not the slider doubles
+    for (uint32_t i = 0; i < presets; ++i) {
+        const ysfx_state_t *a = loaded->presets[i].state;
+        if (a->data_size != state->data_size || memcmp(a->data, state->data, a->data_size) != 0 ||
+            (binary && !bench_same_state(a, state.get()))) {
+            fprintf(stderr, "The preset %u of the bank does not round-trip\n", i);
+            exit(1);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+static void bench_fuzz(uint32_t rounds)
+{
+    std::mt19937 rng(12345);
+    bench_clock::time_point start = bench_clock::now();
+    uint64_t bytes = 0;
+
+    for (uint32_t r = 0; r < rounds; ++r) {
+        // sizes around the blocks of the VM memory, which the serializer crosses
+        uint32_t slots = std::uniform_int_distribution<uint32_t>(0, 3 * 65536 + 7)(rng);
+        bool lossless = (rng() & 1) != 0;
+        bench_script source(slots, rng());
+        bench_script target(slots, rng());
+        ysfx_set_lossless_serialization(source.m_fx.get(), lossless);
+        ysfx_set_lossless_serialization(target.m_fx.get(), lossless);
+
+        ysfx_slider_set_value(source.m_fx.get(), 0, std::uniform_real_distribution<double>(0, 1)(rng), true);
+        ysfx_state_u state{ysfx_save_state(source.m_fx.get())};
+        ysfx_load_state(target.m_fx.get(), state.get());
+        ysfx_state_u again{ysfx_save_state(target.m_fx.get())};
+        if (!bench_same_state(state.get(), again.get())) {
+            fprintf(stderr, "The fuzz round %u does not round-trip, with %u slots\n", r, slots);
+            exit(1);
+        }
+        bytes += state->data_size;
+    }
+
+    bench_report("fuzz_round_trip", 0, rounds, 1, bytes, bench_clock::now() - start);
+}
+
+//------------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    uint64_t max_megabytes = 16;
+    uint32_t fuzz_rounds = 32;
+    if (argc > 3) {
+        fprintf(stderr, "Usage: %s [max-megabytes] [fuzz-rounds]\n", argv[0]);
+        return 1;
+    }
+    if (argc >= 2)
+        max_megabytes = strtoull(argv[1], nullptr, 10);
+    if (argc >= 3)
+        fuzz_rounds = (uint32_t)strtoul(argv[2], nullptr, 10);
+    // the memory of the VM has room for 32M slots, which is 128 MiB as floats
+    max_megabytes = std::min<uint64_t>(std::max<uint64_t>(max_megabytes, 1), 128);
+
+    printf("benchmark,payload_bytes,presets,iterations,seconds,megabytes_per_second,presets_per_second\n");
+
+    uint64_t payload = 16;
+    for (; payload <= (max_megabytes << 20); payload *= 16) {
+        bench_state(payload, false);
+        bench_state(payload, true);
+    }
+    if (payload / 16 < (max_megabytes << 20)) {
+        bench_state(max_megabytes << 20, false);
+        bench_state(max_megabytes << 20, true);
+    }
+
+    for (uint32_t presets : bench_bank_presets) {
+        bench_bank(presets, false);
+        bench_bank(presets, true);
+    }
+
+    bench_fuzz(fuzz_rounds);
+
+    return 0;
+}
@@ -0,0 +1,82 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+#include "ysfx.h"
+#include <string>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+// The parts which the benchmarks share. They write their results on the
+// standard output, as CSV with a line of column names first unless told
+// otherwise, and exit with a message on the standard error when their setup
+// fails.
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+static const char bench_arch[] = "aarch64";
+#elif defined(__x86_64__) || defined(_M_X64)
+static const char bench_arch[] = "x86_64";
+#elif defined(__i386__) || defined(_M_IX86)
+static const char bench_arch[] = "x86";
+#elif defined(__arm__) || defined(_M_ARM)
+static const char bench_arch[] = "arm";
+#else
+static const char bench_arch[] = "other";
+#endif
+
+using bench_clock = std::chrono::steady_clock;
+
+static inline double bench_seconds(bench_clock::duration time)
+{
+    return std::chrono::duration<double>(time).count();
+}
+
+// the amount per second, or 0 if no time was measured
+static inline double bench_per_second(double amount, bench_clock::duration time)
+{
+    double seconds = bench_seconds(time);
+    return (seconds > 0) ? (amount / seconds) : 0;
+}
+
+// a file name in the current directory, which no other run uses
+static inline std::string bench_temp_path(const char *suffix)
+{
+    return "ysfx-bench-tmp." + std::to_string((unsigned long long)bench_clock::now().time_since_epoch().count()) + suffix;
+}
+
+// load and compile the text of an effect, which goes through a temporary file
+static inline ysfx_t *bench_compile(const std::string &text, const char *name)
+{
+    std::string path = bench_temp_path(".jsfx");
+    FILE *stream = fopen(path.c_str(), "wb");
+    if (!stream || fwrite(text.data(), 1, text.size(), stream) != text.size()) {
+        fprintf(stderr, "Cannot write the script: %s\n", path.c_str());
+        exit(1);
+    }
+    fclose(stream);
+
+    ysfx_config_u config{ysfx_config_new()};
+    ysfx_u fx{ysfx_new(config.get())};
+    bool ok = ysfx_load_file(fx.get(), path.c_str(), 0) && ysfx_compile(fx.get(), 0);
+    remove(path.c_str());
+    if (!ok) {
+        fprintf(stderr, "Cannot compile the script: %s\n", name);
+        exit(1);
+    }
+    return fx.release();
+}
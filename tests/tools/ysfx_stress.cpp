@@ -0,0 +1,413 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+#include "ysfx.h"
+#include "ysfx_bench_corpus.hpp"
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// Runs many instances of the corpus of effects concurrently, the way a large
+// session does: several processing threads drive them at random block sizes,
+// while other threads post slider changes and floods of MIDI, recall presets,
+// save and load the states, and run @gfx.
+//
+// Usage: ysfx_stress [instances] [processing-threads] [seconds] [seed]
+//
+// The inputs of every thread come from the seed, so a failure can be run
+// again with the same sequences, although the threads interleave freely.
+// The results are written as JSON on the standard output: the throughput,
+// the latency of the cycles, the deadlines which were missed and the worst
+// instance, and the counts of the changes which were injected.
+//
+// To check for data races, configure a build of the tools with
+//   -DCMAKE_C_FLAGS=-fsanitize=thread -DCMAKE_CXX_FLAGS=-fsanitize=thread
+// and run a few seconds of it under ThreadSanitizer.
+//
+// The states and the presets follow the rules of the API: the other threads
+// request them, and the processing thread of the instance applies them
+// between two of its cycles, as a plugin does at a block boundary.
+
+static const uint32_t stress_channels = 2;
+static const uint32_t stress_max_block = 1024;
+static const ysfx_real stress_rate = 48000;
+static const uint32_t stress_max_gfx = 16;
+
+using stress_clock = std::chrono::steady_clock;
+
+// the corpus has no sliders nor state, these exercise the slider queue,
+// @slider and @serialize
+static const char stress_sliders[] =
+    "slider1:0.5<0,1,0.001>amount" "\n"
+    "slider2:0<0,3,1{a,b,c,d}>mode" "\n";
+static const char stress_sections[] =
+    "\n"
+    "@slider" "\n"
+    "stress_amount = slider1; stress_mode = slider2; stress_sliders += 1;" "\n"
+    "@serialize" "\n"
+    "file_var(0, stress_amount); file_var(0, stress_sliders);" "\n";
+
+// xorshift64*, a different sequence for each thread of a seed
+struct stress_random {
+    explicit stress_random(uint64_t seed) : state(seed * 0x9E3779B97F4A7C15ull + 1) {}
+    uint64_t next()
+    {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * 0x2545F4914F6CDD1Dull;
+    }
+    uint32_t below(uint32_t n) { return (uint32_t)(next() % n); }
+    double unit() { return (double)(next() >> 11) / (double)(1ull << 53); }
+    uint64_t state;
+};
+
+struct stress_instance {
+    ysfx_u fx;
+    const bench_effect *effect = nullptr;
+    // the requests which the processing thread applies between cycles
+    std::atomic<ysfx_state_t *> state_request{nullptr};
+    std::atomic<ysfx_state_t *> preset_request{nullptr};
+    std::atomic<bool> save_request{false};
+    // the last saved state, which the processing thread leaves here
+    std::atomic<ysfx_state_t *> saved{nullptr};
+};
+
+// the latency of the cycles, in bins of a power of two of nanoseconds
+struct stress_latency {
+    static const uint32_t num_bins = 40;
+    uint64_t bins[num_bins] = {};
+    uint64_t max_ns = 0;
+    void add(uint64_t ns)
+    {
+        uint32_t bin = 0;
+        while (bin + 1 < num_bins && (ns >> bin) != 0)
+            ++bin;
+        ++bins[bin];
+        max_ns = std::max(max_ns, ns);
+    }
+    void merge(const stress_latency &other)
+    {
+        for (uint32_t i = 0; i < num_bins; ++i)
+            bins[i] += other.bins[i];
+        max_ns = std::max(max_ns, other.max_ns);
+    }
+    // an upper bound, the end of the bin which reaches the rank
+    uint64_t percentile(double p) const
+    {
+        uint64_t total = 0;
+        for (uint64_t count : bins)
+            total += count;
+        uint64_t rank = (uint64_t)(p * total), count = 0;
+        for (uint32_t i = 0; i < num_bins; ++i) {
+            count += bins[i];
+            if (count > rank)
+                return std::min(max_ns, (uint64_t)1 << i);
+        }
+        return max_ns;
+    }
+};
+
+struct stress_counts {
+    std::atomic<uint64_t> sliders{0};
+    std::atomic<uint64_t> midi{0};
+    std::atomic<uint64_t> presets{0};
+    std::atomic<uint64_t> states_saved{0};
+    std::atomic<uint64_t> states_loaded{0};
+    std::atomic<uint64_t> gfx_frames{0};
+    std::atomic<uint64_t> rejected{0};
+};
+
+static std::string stress_temp_path(const char *suffix)
+{
+    return "ysfx-bench-tmp." + std::to_string((unsigned long long)stress_clock::now().time_since_epoch().count()) + suffix;
+}
+
+static void stress_free_state(std::atomic<ysfx_state_t *> &slot, ysfx_state_t *state)
+{
+    if (ysfx_state_t *old = slot.exchange(state))
+        ysfx_state_free(old);
+}
+
+//------------------------------------------------------------------------------
+static void stress_process(std::vector<std::unique_ptr<stress_instance>> &instances, uint32_t thread, uint32_t num_threads,
+                           uint64_t seed, const std::atomic<bool> &quit, stress_latency &latency, uint64_t &frames)
+{
+    stress_random random{seed + 1000 + thread};
+    std::vector<float> buffer(2 * stress_channels * stress_max_block);
+    const float *ins[stress_channels];
+    float *outs[stress_channels];
+    for (uint32_t ch = 0; ch < stress_channels; ++ch) {
+        ins[ch] = &buffer[ch * stress_max_block];
+        outs[ch] = &buffer[(stress_channels + ch) * stress_max_block];
+    }
+
+    while (!quit.load(std::memory_order_relaxed)) {
+        for (size_t i = thread; i < instances.size(); i += num_threads) {
+            stress_instance &inst = *instances[i];
+            ysfx_t *fx = inst.fx.get();
+
+            // at the boundary of the block, as a host which is asked for it
+            if (ysfx_state_t *state = inst.state_request.exchange(nullptr)) {
+                ysfx_load_state(fx, state);
+                ysfx_state_free(state);
+            }
+            if (ysfx_state_t *state = inst.preset_request.exchange(nullptr)) {
+                ysfx_load_slider_state(fx, state);
+                ysfx_state_free(state);
+            }
+            if (inst.save_request.exchange(false))
+                stress_free_state(inst.saved, ysfx_save_state(fx));
+
+            // the sizes of hosts, which change from a cycle to the next
+            uint32_t block = 1 + random.below(stress_max_block);
+            for (uint32_t s = 0; s < stress_channels * block; ++s)
+                buffer[s] = (float)(random.unit() - 0.5);
+
+            stress_clock::time_point start = stress_clock::now();
+            ysfx_process_float(fx, ins, outs, stress_channels, stress_channels, block);
+            latency.add((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(stress_clock::now() - start).count());
+            frames += block;
+
+            ysfx_midi_event_t event;
+            while (ysfx_receive_midi(fx, &event))
+                ;
+        }
+    }
+}
+
+static void stress_control(std::vector<std::unique_ptr<stress_instance>> &instances, uint64_t seed,
+                           const std::atomic<bool> &quit, stress_counts &counts)
+{
+    stress_random random{seed + 1};
+    const uint32_t n = (uint32_t)instances.size();
+    while (!quit.load(std::memory_order_relaxed)) {
+        // a burst of automation on a few instances
+        for (uint32_t k = 0; k < 64; ++k) {
+            ysfx_t *fx = instances[random.below(n)]->fx.get();
+            bool ok = ysfx_post_slider_value(fx, random.below(2), random.unit() * 3, random.below(64));
+            ok ? ++counts.sliders : ++counts.rejected;
+        }
+        // a flood of MIDI, more than a cycle holds sometimes
+        ysfx_t *target = instances[random.below(n)]->fx.get();
+        for (uint32_t k = 0; k < 256; ++k) {
+            const uint8_t data[3] = {(uint8_t)((k & 1) ? 0x80 : 0x90), (uint8_t)(36 + random.below(48)), (uint8_t)random.below(128)};
+            ysfx_midi_event_t event{0, random.below(64), 3, data};
+            ysfx_post_midi(target, &event) ? ++counts.midi : ++counts.rejected;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(200 + random.below(800)));
+    }
+}
+
+static void stress_states(std::vector<std::unique_ptr<stress_instance>> &instances, uint64_t seed,
+                          const std::atomic<bool> &quit, stress_counts &counts)
+{
+    stress_random random{seed + 2};
+    const uint32_t n = (uint32_t)instances.size();
+    while (!quit.load(std::memory_order_relaxed)) {
+        stress_instance &inst = *instances[random.below(n)];
+        switch (random.below(3)) {
+        case 0:
+            inst.save_request.store(true);
+            ++counts.states_saved;
+            break;
+        case 1:
+        case 2:
+            // the saved state comes back, whole or as a preset of the sliders
+            if (ysfx_state_t *saved = inst.saved.exchange(nullptr)) {
+                std::atomic<ysfx_state_t *> &slot = (random.below(2) == 0) ? inst.state_request : inst.preset_request;
+                stress_free_state(slot, ysfx_state_dup(saved));
+                stress_free_state(inst.saved, saved);
+                (&slot == &inst.state_request) ? ++counts.states_loaded : ++counts.presets;
+            }
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(100 + random.below(400)));
+    }
+}
+
+static void stress_gfx(std::vector<std::unique_ptr<stress_instance>> &instances,
+                       const std::atomic<bool> &quit, stress_counts &counts)
+{
+    // a window for some of the effects which draw
+    const uint32_t w = 400, h = 200;
+    std::vector<ysfx_t *> windows;
+    std::vector<std::unique_ptr<uint8_t[]>> pixels;
+    for (const std::unique_ptr<stress_instance> &inst : instances) {
+        if (windows.size() >= stress_max_gfx)
+            break;
+        ysfx_t *fx = inst->fx.get();
+        if (!ysfx_has_section(fx, ysfx_section_gfx))
+            continue;
+        pixels.emplace_back(new uint8_t[4 * w * h]());
+        ysfx_gfx_config_t gc{};
+        gc.pixel_width = w;
+        gc.pixel_height = h;
+        gc.pixels = pixels.back().get();
+        gc.scale_factor = 1.0;
+        ysfx_gfx_setup(fx, &gc);
+        windows.push_back(fx);
+    }
+    if (windows.empty())
+        return;
+
+    while (!quit.load(std::memory_order_relaxed)) {
+        for (ysfx_t *fx : windows) {
+            ysfx_gfx_run(fx);
+            ++counts.gfx_frames;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(16));
+    }
+}
+
+//------------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    uint32_t num_instances = 300;
+    uint32_t num_threads = 4;
+    double seconds = 10;
+    uint64_t seed = 1;
+    if (argc > 5) {
+        fprintf(stderr, "Usage: %s [instances] [processing-threads] [seconds] [seed]\n", argv[0]);
+        return 1;
+    }
+    if (argc >= 2)
+        num_instances = (uint32_t)strtoul(argv[1], nullptr, 10);
+    if (argc >= 3)
+        num_threads = (uint32_t)strtoul(argv[2], nullptr, 10);
+    if (argc >= 4)
+        seconds = strtod(argv[3], nullptr);
+    if (argc >= 5)
+        seed = strtoull(argv[4], nullptr, 10);
+    num_instances = std::max(1u, num_instances);
+    num_threads = std::max(1u, std::min(num_threads, num_instances));
+    if (!(seconds > 0))
+        seconds = 1;
+
+    // a file per effect, which all its instances load
+    const size_t num_effects = sizeof(bench_effects) / sizeof(bench_effects[0]);
+    std::vector<std::string> paths(num_effects);
+    for (size_t e = 0; e < num_effects; ++e) {
+        std::string text = "desc:stress" "\n";
+        text += stress_sliders;
+        for (uint32_t ch = 0; ch < stress_channels; ++ch)
+            text += "in_pin:input " + std::to_string(ch + 1) + "\n";
+        for (uint32_t ch = 0; ch < stress_channels; ++ch)
+            text += "out_pin:output " + std::to_string(ch + 1) + "\n";
+        text += bench_effects[e].code;
+        text += stress_sections;
+
+        paths[e] = stress_temp_path((std::string(".") + bench_effects[e].name + ".jsfx").c_str());
+        FILE *stream = fopen(paths[e].c_str(), "wb");
+        if (!stream || fwrite(text.data(), 1, text.size(), stream) != text.size()) {
+            fprintf(stderr, "Cannot write the script: %s\n", paths[e].c_str());
+            return 1;
+        }
+        fclose(stream);
+    }
+
+    ysfx_config_u config{ysfx_config_new()};
+    std::vector<std::unique_ptr<stress_instance>> instances(num_instances);
+    stress_clock::time_point load_start = stress_clock::now();
+    for (uint32_t i = 0; i < num_instances; ++i) {
+        size_t e = i % num_effects;
+        stress_instance *inst = new stress_instance;
+        instances[i].reset(inst);
+        inst->effect = &bench_effects[e];
+        inst->fx.reset(ysfx_new(config.get()));
+        ysfx_t *fx = inst->fx.get();
+        if (!ysfx_load_file(fx, paths[e].c_str(), 0) || !ysfx_compile(fx, 0)) {
+            fprintf(stderr, "Cannot compile the effect: %s\n", bench_effects[e].name);
+            return 1;
+        }
+        ysfx_set_block_size(fx, stress_max_block);
+        ysfx_set_sample_rate(fx, stress_rate);
+        ysfx_set_slider_queue_capacity(fx, 256);
+        ysfx_set_midi_queue_capacity(fx, 512);
+        ysfx_init(fx);
+    }
+    double load_seconds = std::chrono::duration<double>(stress_clock::now() - load_start).count();
+    for (const std::string &path : paths)
+        remove(path.c_str());
+
+    std::atomic<bool> quit{false};
+    stress_counts counts;
+    std::vector<stress_latency> latencies(num_threads);
+    std::vector<uint64_t> frames(num_threads);
+
+    stress_clock::time_point start = stress_clock::now();
+    std::vector<std::thread> threads;
+    for (uint32_t t = 0; t < num_threads; ++t)
+        threads.emplace_back([&, t]() { stress_process(instances, t, num_threads, seed, quit, latencies[t], frames[t]); });
+    threads.emplace_back([&]() { stress_control(instances, seed, quit, counts); });
+    threads.emplace_back([&]() { stress_states(instances, seed, quit, counts); });
+    threads.emplace_back([&]() { stress_gfx(instances, quit, counts); });
+
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    quit.store(true);
+    for (std::thread &thread : threads)
+        thread.join();
+    double elapsed = std::chrono::duration<double>(stress_clock::now() - start).count();
+
+    stress_latency latency;
+    uint64_t total_frames = 0;
+    for (uint32_t t = 0; t < num_threads; ++t) {
+        latency.merge(latencies[t]);
+        total_frames += frames[t];
+    }
+
+    // the instance which came the closest to its deadline, or went over the most
+    uint64_t misses = 0, midi_overflow = 0;
+    uint32_t worst = 0;
+    double worst_load = -1;
+    for (uint32_t i = 0; i < num_instances; ++i) {
+        ysfx_t *fx = instances[i]->fx.get();
+        ysfx_deadline_stats_t stats{};
+        ysfx_get_deadline_stats(fx, &stats);
+        misses += stats.misses;
+        midi_overflow += ysfx_get_midi_overflow(fx);
+        if (stats.max_load > worst_load) {
+            worst_load = stats.max_load;
+            worst = i;
+        }
+        stress_free_state(instances[i]->state_request, nullptr);
+        stress_free_state(instances[i]->preset_request, nullptr);
+        stress_free_state(instances[i]->saved, nullptr);
+    }
+
+    printf("{\n  \"instances\": %u,\n  \"threads\": %u,\n  \"seconds\": %.3f,\n  \"seed\": %llu,\n  \"load_seconds\": %.3f,\n",
+           num_instances, num_threads, elapsed, (unsigned long long)seed, load_seconds);
+    printf("  \"frames_per_second\": %.0f,\n  \"realtime_factor\": %.2f,\n",
+           total_frames / elapsed, total_frames / stress_rate / elapsed);
+    printf("  \"latency_ns\": {\"p50\": %llu, \"p99\": %llu, \"p999\": %llu, \"max\": %llu},\n",
+           (unsigned long long)latency.percentile(0.5), (unsigned long long)latency.percentile(0.99),
+           (unsigned long long)latency.percentile(0.999), (unsigned long long)latency.max_ns);
+    printf("  \"deadline_misses\": %llu,\n  \"worst_instance\": {\"index\": %u, \"effect\": \"%s\", \"max_load\": %.3f},\n",
+           (unsigned long long)misses, worst, instances[worst]->effect->name, worst_load);
+    printf("  \"injected\": {\"sliders\": %llu, \"midi\": %llu, \"presets\": %llu, \"states_saved\": %llu, \"states_loaded\": %llu, \"gfx_frames\": %llu},\n",
+           (unsigned long long)counts.sliders.load(), (unsigned long long)counts.midi.load(), (unsigned long long)counts.presets.load(),
+           (unsigned long long)counts.states_saved.load(), (unsigned long long)counts.states_loaded.load(), (unsigned long long)counts.gfx_frames.load());
+    printf("  \"rejected_posts\": %llu,\n  \"midi_overflow\": %llu\n}\n",
+           (unsigned long long)counts.rejected.load(), (unsigned long long)midi_overflow);
+    return 0;
+}
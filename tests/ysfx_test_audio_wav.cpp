@@ -18,9 +18,13 @@
 #include "ysfx.h"
 #include "ysfx_test_utils.hpp"
 #include "ysfx_audio_wav.hpp"
+#include "ysfx_audio_stream.hpp"
+#include "ysfx_audio_cache.hpp"
+#include "ysfx_config.hpp"
 #include "ysfx_utils.hpp"
 #include <catch.hpp>
 #include <random>
+#include <cmath>
 
 #if defined(__GNUC__)
 #   pragma GCC diagnostic push
@@ -97,4 +101,344 @@ TEST_CASE("wav audio format", "[wav]")
             }
         }
     }
+    SECTION("stream wav file")
+    {
+        scoped_new_txt wav_file("${root}/example.wav", nullptr, 0);
+
+        drwav_data_format fmt{};
+        fmt.container = drwav_container_riff;
+        fmt.format = DR_WAVE_FORMAT_IEEE_FLOAT;
+        fmt.channels = 2;
+        fmt.sampleRate = 44100;
+        fmt.bitsPerSample = 32;
+        uint64_t totalframes = 10000;
+        uint64_t totalsmpls = fmt.channels * totalframes;
+        std::unique_ptr<float[]> data{new float[(size_t)totalsmpls]};
+
+        {
+            std::mt19937_64 prng;
+            for (size_t i = 0; i < (size_t)totalsmpls; ++i)
+                data[i] = std::uniform_real_distribution<float>{-1.0f, 1.0f}(prng);
+        }
+        {
+            drwav wav;
+            REQUIRE(drwav_init_file_write(&wav, wav_file.m_path.c_str(), &fmt, nullptr));
+            uint64_t written = drwav_write_pcm_frames(&wav, totalframes, data.get());
+            drwav_uninit(&wav);
+            REQUIRE(written == totalframes);
+        }
+
+        ysfx_audio_reader_t *reader = ysfx_audio_format_wav.open(wav_file.m_path.c_str());
+        REQUIRE(reader);
+        auto reader_cleanup = ysfx::defer([reader]() { ysfx_audio_format_wav.close(reader); });
+
+        // a ring which is much smaller than the reads, so they have to wait
+        for (uint32_t capacity : {100u, 100000u}) {
+            ysfx_audio_format_wav.rewind(reader);
+            ysfx_audio_stream_t stream{ysfx_audio_format_wav, reader, capacity};
+            std::unique_ptr<ysfx_real[]> buf{new ysfx_real[1000]};
+
+            for (int time = 0; time < 2; ++time) {
+                uint64_t smplpos = 0;
+                uint32_t bufsize = 1;
+
+                while (smplpos < totalsmpls) {
+                    REQUIRE(stream.avail() == totalsmpls - smplpos);
+                    uint64_t n = std::min<uint64_t>(totalsmpls - smplpos, bufsize);
+                    REQUIRE(stream.read(buf.get(), n) == n);
+                    for (size_t i = 0; i < n; ++i)
+                        REQUIRE(data[(size_t)smplpos + i] == Approx(buf[i]));
+                    smplpos += n;
+                    bufsize = bufsize % 1000 + 37;
+                }
+
+                REQUIRE(stream.avail() == 0);
+                REQUIRE(stream.read(buf.get(), 1) == 0);
+                stream.rewind();
+            }
+        }
+    }
+
+    SECTION("file_mem of a wav file across blocks")
+    {
+        const char *text =
+        "desc:test" "\n"
+        "filename:0,example.wav" "\n"
+        "out_pin:output" "\n"
+        "@init" "\n"
+        "h = file_open(0);" "\n"
+        "file_riff(h, nch, srate);" "\n"
+        "n = file_mem(h, 65530, 300000);" "\n"
+        "file_close(h);" "\n";
+
+        scoped_new_dir dir_fx("${root}/Effects");
+        scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+        scoped_new_txt wav_file("${root}/Effects/example.wav", nullptr, 0);
+
+        drwav_data_format fmt{};
+        fmt.container = drwav_container_riff;
+        fmt.format = DR_WAVE_FORMAT_PCM;
+        fmt.channels = 2;
+        fmt.sampleRate = 48000;
+        fmt.bitsPerSample = 16;
+        uint64_t totalframes = 100003;
+        uint64_t totalsmpls = fmt.channels * totalframes;
+        std::vector<int16_t> data((size_t)totalsmpls);
+        for (size_t i = 0; i < data.size(); ++i)
+            data[i] = (int16_t)((i * 7919) % 65536 - 32768);
+        {
+            drwav wav;
+            REQUIRE(drwav_init_file_write(&wav, wav_file.m_path.c_str(), &fmt, nullptr));
+            REQUIRE(drwav_write_pcm_frames(&wav, totalframes, data.data()) == totalframes);
+            drwav_uninit(&wav);
+        }
+
+        // read directly, streamed, and from the cache
+        for (int mode = 0; mode < 3; ++mode) {
+            ysfx_config_u config{ysfx_config_new()};
+            ysfx_register_builtin_audio_formats(config.get());
+            if (mode == 2)
+                ysfx_set_audio_cache_size(config.get(), 16 << 20);
+            ysfx_u fx{ysfx_new(config.get())};
+            ysfx_set_audio_file_read_ahead(fx.get(), (mode == 1) ? 0.5 : 0.0);
+
+            REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+            REQUIRE(ysfx_compile(fx.get(), 0));
+            ysfx_init(fx.get());
+
+            REQUIRE(ysfx_read_var(fx.get(), "nch") == 2);
+            REQUIRE(ysfx_read_var(fx.get(), "srate") == 48000);
+            REQUIRE(ysfx_read_var(fx.get(), "n") == totalsmpls);
+            std::vector<ysfx_real> values((size_t)totalsmpls + 1);
+            ysfx_read_vmem(fx.get(), 65530, values.data(), (uint32_t)values.size());
+            for (size_t i = 0; i < data.size(); ++i)
+                REQUIRE(values[i] == Approx(data[i] / 32768.0));
+            REQUIRE(values[(size_t)totalsmpls] == 0);
+        }
+    }
+
+    SECTION("file_mem of a resampled wav file")
+    {
+        const char *text =
+        "desc:test" "\n"
+        "filename:0,example.wav" "\n"
+        "out_pin:output" "\n"
+        "@init" "\n"
+        "h = file_open(0);" "\n"
+        "file_riff(h, nch, srate);" "\n"
+        "a = file_avail(h);" "\n"
+        "n = file_mem(h, 0, 3);" "\n"
+        "n += file_mem(h, 3, 100000);" "\n"
+        "file_close(h);" "\n";
+
+        scoped_new_dir dir_fx("${root}/Effects");
+        scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+        scoped_new_txt wav_file("${root}/Effects/example.wav", nullptr, 0);
+
+        // a sine on the left and a cosine on the right
+        const double freq = 1000;
+        drwav_data_format fmt{};
+        fmt.container = drwav_container_riff;
+        fmt.format = DR_WAVE_FORMAT_IEEE_FLOAT;
+        fmt.channels = 2;
+        fmt.sampleRate = 44100;
+        fmt.bitsPerSample = 32;
+        uint64_t totalframes = 10000;
+        std::vector<float> data((size_t)(2 * totalframes));
+        for (size_t i = 0; i < totalframes; ++i) {
+            double phase = 2 * M_PI * freq * (double)i / fmt.sampleRate;
+            data[2 * i] = (float)std::sin(phase);
+            data[2 * i + 1] = (float)std::cos(phase);
+        }
+        {
+            drwav wav;
+            REQUIRE(drwav_init_file_write(&wav, wav_file.m_path.c_str(), &fmt, nullptr));
+            REQUIRE(drwav_write_pcm_frames(&wav, totalframes, data.data()) == totalframes);
+            drwav_uninit(&wav);
+        }
+
+        // read directly and from the cache
+        for (int mode = 0; mode < 2; ++mode) {
+            ysfx_config_u config{ysfx_config_new()};
+            ysfx_register_builtin_audio_formats(config.get());
+            if (mode == 1)
+                ysfx_set_audio_cache_size(config.get(), 16 << 20);
+            ysfx_u fx{ysfx_new(config.get())};
+            ysfx_set_audio_file_resampling(fx.get(), true);
+            ysfx_set_sample_rate(fx.get(), 48000);
+
+            REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+            REQUIRE(ysfx_compile(fx.get(), 0));
+            ysfx_init(fx.get());
+
+            uint64_t outframes = (totalframes * 48000 + 44099) / 44100;
+            REQUIRE(ysfx_read_var(fx.get(), "nch") == 2);
+            REQUIRE(ysfx_read_var(fx.get(), "srate") == 48000);
+            REQUIRE(ysfx_read_var(fx.get(), "a") == 2 * outframes);
+            REQUIRE(ysfx_read_var(fx.get(), "n") == 2 * outframes);
+
+            std::vector<ysfx_real> values((size_t)(2 * outframes));
+            ysfx_read_vmem(fx.get(), 0, values.data(), (uint32_t)values.size());
+            // away from the edges, where the filter sees the zeros around the file
+            for (size_t i = 100; i + 100 < outframes; ++i) {
+                double phase = 2 * M_PI * freq * (double)i / 48000;
+                REQUIRE(values[2 * i] == Approx(std::sin(phase)).margin(1e-3));
+                REQUIRE(values[2 * i + 1] == Approx(std::cos(phase)).margin(1e-3));
+            }
+        }
+    }
+
+    SECTION("file_open_write of a wav file")
+    {
+        const char *text =
+        "desc:test" "\n"
+        "out_pin:output" "\n"
+        "@init" "\n"
+        "i = 0; loop(3000, i[0] = (i % 100) / 100; i += 1);" "\n"
+        "h = file_open_write(\"rec.wav\");" "\n"
+        "file_riff(h, 3, 22050);" "\n"
+        "n = file_mem(h, 0, 3000);" "\n"
+        "nch = 2; srate = 48000;" "\n"
+        "file_riff(h, nch, srate);" "\n"
+        "file_close(h);" "\n";
+
+        scoped_new_dir dir_fx("${root}/Effects");
+        scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+        scoped_new_txt wav_file("${root}/Effects/rec.wav", nullptr, 0);
+
+        ysfx_config_u config{ysfx_config_new()};
+        ysfx_set_write_root(config.get(), dir_fx.m_path.c_str());
+        ysfx_u fx{ysfx_new(config.get())};
+
+        REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+        REQUIRE(ysfx_compile(fx.get(), 0));
+        ysfx_init(fx.get());
+
+        // the format is fixed after the first write
+        REQUIRE(ysfx_read_var(fx.get(), "n") == 3000);
+        REQUIRE(ysfx_read_var(fx.get(), "nch") == 3);
+        REQUIRE(ysfx_read_var(fx.get(), "srate") == 22050);
+
+        drwav wav;
+        REQUIRE(drwav_init_file(&wav, wav_file.m_path.c_str(), nullptr));
+        auto wav_cleanup = ysfx::defer([&wav]() { drwav_uninit(&wav); });
+        REQUIRE(wav.channels == 3);
+        REQUIRE(wav.sampleRate == 22050);
+        REQUIRE(wav.totalPCMFrameCount == 1000);
+        std::vector<float> data(3000);
+        REQUIRE(drwav_read_pcm_frames_f32(&wav, 1000, data.data()) == 1000);
+        for (size_t i = 0; i < data.size(); ++i)
+            REQUIRE(data[i] == Approx((i % 100) / 100.0));
+    }
+
+    SECTION("audio cache")
+    {
+        scoped_new_txt wav_file1("${root}/example1.wav", nullptr, 0);
+        scoped_new_txt wav_file2("${root}/example2.wav", nullptr, 0);
+
+        drwav_data_format fmt{};
+        fmt.container = drwav_container_riff;
+        fmt.format = DR_WAVE_FORMAT_IEEE_FLOAT;
+        fmt.channels = 1;
+        fmt.sampleRate = 44100;
+        fmt.bitsPerSample = 32;
+        std::vector<float> data(1000, 0.25f);
+        for (const scoped_new_txt *file : {&wav_file1, &wav_file2}) {
+            drwav wav;
+            REQUIRE(drwav_init_file_write(&wav, file->m_path.c_str(), &fmt, nullptr));
+            REQUIRE(drwav_write_pcm_frames(&wav, data.size(), data.data()) == data.size());
+            drwav_uninit(&wav);
+        }
+
+        // room for one of the files only
+        ysfx_audio_cache_t cache{1500 * sizeof(ysfx_real)};
+        ysfx_decoded_audio_sp audio1 = ysfx_audio_cache_get(cache, ysfx_audio_format_wav, wav_file1.m_path.c_str());
+        REQUIRE(audio1);
+        REQUIRE(audio1->info.channels == 1);
+        REQUIRE(audio1->samples.size() == 1000);
+        REQUIRE(audio1->samples[999] == 0.25);
+        REQUIRE(ysfx_audio_cache_get(cache, ysfx_audio_format_wav, wav_file1.m_path.c_str()) == audio1);
+
+        // the least recently used is released, but its users keep it
+        ysfx_decoded_audio_sp audio2 = ysfx_audio_cache_get(cache, ysfx_audio_format_wav, wav_file2.m_path.c_str());
+        REQUIRE(audio2);
+        REQUIRE(audio2 != audio1);
+        REQUIRE(cache.lru.size() == 1);
+        REQUIRE(audio1->samples.size() == 1000);
+        REQUIRE(ysfx_audio_cache_get(cache, ysfx_audio_format_wav, wav_file1.m_path.c_str()) != audio1);
+
+        // the files which do not fit are not decoded
+        ysfx_audio_cache_resize(cache, 500 * sizeof(ysfx_real));
+        REQUIRE(cache.lru.empty());
+        REQUIRE(!ysfx_audio_cache_get(cache, ysfx_audio_format_wav, wav_file1.m_path.c_str()));
+
+        // configurations can share one cache
+        ysfx_config_u config1{ysfx_config_new()};
+        ysfx_config_u config2{ysfx_config_new()};
+        ysfx_set_audio_cache_size(config1.get(), 1 << 20);
+        ysfx_share_audio_cache(config2.get(), config1.get());
+        REQUIRE(config2->audio_cache == config1->audio_cache);
+        ysfx_set_audio_cache_size(config2.get(), 0);
+        REQUIRE(!config2->audio_cache);
+        REQUIRE(config1->audio_cache);
+    }
+
+    SECTION("preload manifest")
+    {
+        const char *text =
+            "desc:example" "\n"
+            "filename:0,example.wav" "\n"
+            "out_pin:output" "\n"
+            "@init" "\n"
+            "h1 = file_open(0);" "\n"
+            "file_close(h1);" "\n"
+            "h2 = file_open(\"notes.txt\");" "\n"
+            "file_close(h2);" "\n"
+            "h3 = file_open(\"missing.txt\");" "\n";
+
+        scoped_new_dir dir_fx("${root}/Effects");
+        scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+        scoped_new_txt file_notes("${root}/Effects/notes.txt", "1 2 3");
+        scoped_new_txt wav_file("${root}/Effects/example.wav", nullptr, 0);
+
+        drwav_data_format fmt{};
+        fmt.container = drwav_container_riff;
+        fmt.format = DR_WAVE_FORMAT_IEEE_FLOAT;
+        fmt.channels = 1;
+        fmt.sampleRate = 44100;
+        fmt.bitsPerSample = 32;
+        std::vector<float> data(1000, 0.25f);
+        {
+            drwav wav;
+            REQUIRE(drwav_init_file_write(&wav, wav_file.m_path.c_str(), &fmt, nullptr));
+            REQUIRE(drwav_write_pcm_frames(&wav, data.size(), data.data()) == data.size());
+            drwav_uninit(&wav);
+        }
+
+        std::string manifest;
+        {
+            ysfx_config_u config{ysfx_config_new()};
+            ysfx_register_builtin_audio_formats(config.get());
+            ysfx_u fx{ysfx_new(config.get())};
+            REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+            REQUIRE(ysfx_compile(fx.get(), 0));
+            ysfx_init(fx.get());
+
+            char *text = ysfx_get_init_manifest(fx.get());
+            REQUIRE(text);
+            manifest.assign(text);
+            ysfx_free_resolved_path(text);
+        }
+        // the files which @init found, in order
+        REQUIRE(manifest == wav_file.m_path + "\n" + file_notes.m_path + "\n");
+
+        // the session decodes the audio ahead, into the cache of its instances
+        ysfx_config_u config{ysfx_config_new()};
+        ysfx_register_builtin_audio_formats(config.get());
+        ysfx_set_audio_cache_size(config.get(), 1 << 20);
+        ysfx_preload(config.get(), manifest.c_str());
+        ysfx_preload_wait(config.get());
+        REQUIRE(config->audio_cache->lru.size() == 1);
+        REQUIRE(config->audio_cache->lru.front().audio->samples.size() == 1000);
+    }
 }
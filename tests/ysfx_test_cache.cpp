@@ -0,0 +1,284 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "ysfx.h"
+#include "ysfx.hpp"
+#include "ysfx_utils.hpp"
+#include "ysfx_test_utils.hpp"
+#include <catch.hpp>
+#include <cstdio>
+
+static uint32_t count_cache_entries(const std::string &path)
+{
+    uint32_t count = 0;
+    for (const std::string &name : ysfx::list_directory(path.c_str()))
+        count += ysfx::path_has_suffix(name.c_str(), "ysfxcache");
+    return count;
+}
+
+TEST_CASE("compile cache", "[cache]")
+{
+    const char *text =
+        "desc:test" "\n"
+        "config: test1 \"test\" 8 1=test 2" "\n"
+        "import include.jsfx-inc" "\n"
+        "@init" "\n"
+        "x1 = <?printf(\"%d\", test1)?>;" "\n";
+
+    const char *include_text =
+        "@init" "\n"
+        "x2 = <?printf(\"%d\", test1)?>;" "\n";
+
+    scoped_new_dir dir_fx("${root}/Effects");
+    scoped_new_dir dir_cache("${root}/Cache");
+    scoped_new_txt file("${root}/Effects/include.jsfx-inc", include_text);
+    std::string main_path = resolve_path("${root}/Effects/example.jsfx");
+
+    auto clean_cache = ysfx::defer([&dir_cache]() {
+        for (const std::string &name : ysfx::list_directory(dir_cache.m_path.c_str()))
+            remove((dir_cache.m_path + '/' + name).c_str());
+    });
+
+    auto load = [&](ysfx_real &x1, ysfx_real &x2) {
+        ysfx_config_u config{ysfx_config_new()};
+        ysfx_set_cache_root(config.get(), dir_cache.m_path.c_str());
+        ysfx_u fx{ysfx_new(config.get())};
+        REQUIRE(ysfx_load_file(fx.get(), main_path.c_str(), 0));
+        REQUIRE(ysfx_compile(fx.get(), 0));
+        ysfx_init(fx.get());
+        x1 = ysfx_read_var(fx.get(), "x1");
+        x2 = ysfx_read_var(fx.get(), "x2");
+    };
+
+    ysfx_real x1 = 0, x2 = 0;
+
+    {
+        scoped_new_txt file_main(main_path, text);
+
+        // the first load fills the cache
+        REQUIRE(count_cache_entries(dir_cache.m_path) == 0);
+        load(x1, x2);
+        REQUIRE(x1 == 8);
+        REQUIRE(x2 == 8);
+        REQUIRE(count_cache_entries(dir_cache.m_path) == 2);
+
+        // the next load gives identical results from the cache
+        load(x1, x2);
+        REQUIRE(x1 == 8);
+        REQUIRE(x2 == 8);
+        REQUIRE(count_cache_entries(dir_cache.m_path) == 2);
+    }
+
+    {
+        // a modified file gets a new entry, and so does the import, since it
+        // sees different preprocessor values
+        const char *new_text =
+            "desc:test" "\n"
+            "config: test1 \"test\" 16 1=test 2" "\n"
+            "import include.jsfx-inc" "\n"
+            "@init" "\n"
+            "x1 = 1 + <?printf(\"%d\", test1)?>;" "\n";
+        scoped_new_txt file_main(main_path, new_text);
+
+        load(x1, x2);
+        REQUIRE(x1 == 17);
+        REQUIRE(x2 == 16);
+        REQUIRE(count_cache_entries(dir_cache.m_path) == 4);
+    }
+}
+
+TEST_CASE("shared source units", "[cache]")
+{
+    const char *text =
+        "desc:test" "\n"
+        "slider1:0<0,1,0.1>the slider 1" "\n"
+        "import include.jsfx-inc" "\n"
+        "@init" "\n"
+        "x1 = 1;" "\n";
+
+    const char *include_text =
+        "@init" "\n"
+        "x2 = 2;" "\n";
+
+    scoped_new_dir dir_fx("${root}/Effects");
+    scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+    scoped_new_txt file("${root}/Effects/include.jsfx-inc", include_text);
+
+    ysfx_config_u config{ysfx_config_new()};
+    ysfx_u fx1{ysfx_new(config.get())};
+    ysfx_u fx2{ysfx_new(config.get())};
+
+    REQUIRE(ysfx_load_file(fx1.get(), file_main.m_path.c_str(), 0));
+    REQUIRE(ysfx_load_file(fx2.get(), file_main.m_path.c_str(), 0));
+
+    // instances share the sections
+    REQUIRE(fx1->source.main->toplevel == fx2->source.main->toplevel);
+    REQUIRE(fx1->source.imports.size() == 1);
+    REQUIRE(fx2->source.imports.size() == 1);
+    REQUIRE(fx1->source.imports[0]->toplevel == fx2->source.imports[0]->toplevel);
+
+    // the headers are separate
+    REQUIRE(&fx1->source.main->header != &fx2->source.main->header);
+    REQUIRE(fx1->source.main->header.sliders[0].exists);
+
+    // each instance compiles and runs on its own
+    REQUIRE(ysfx_compile(fx1.get(), 0));
+    REQUIRE(ysfx_compile(fx2.get(), 0));
+    ysfx_init(fx1.get());
+    ysfx_init(fx2.get());
+    REQUIRE(ysfx_read_var(fx2.get(), "x1") == 1);
+    REQUIRE(ysfx_read_var(fx2.get(), "x2") == 2);
+
+    // a configuration with another import root parses the file again
+    ysfx_config_u other_config{ysfx_config_new()};
+    ysfx_set_import_root(other_config.get(), dir_fx.m_path.c_str());
+    ysfx_u fx3{ysfx_new(other_config.get())};
+    REQUIRE(ysfx_load_file(fx3.get(), file_main.m_path.c_str(), 0));
+    REQUIRE(fx1->source.main->toplevel != fx3->source.main->toplevel);
+
+    // the units are released with the last instance
+    std::weak_ptr<const ysfx_toplevel_t> shared = fx1->source.main->toplevel;
+    fx1.reset();
+    REQUIRE(!shared.expired());
+    fx2.reset();
+    REQUIRE(shared.expired());
+}
+
+TEST_CASE("parallel loading of imports", "[cache]")
+{
+    const char *text =
+        "desc:test" "\n"
+        "import a.jsfx-inc" "\n"
+        "import b.jsfx-inc" "\n"
+        "@init" "\n"
+        "order = order * 10 + 9;" "\n";
+
+    // the tree a -> (c, d), b -> (c, e), where c is shared
+    scoped_new_dir dir_fx("${root}/Effects");
+    scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+    scoped_new_txt file_a("${root}/Effects/a.jsfx-inc", "import c.jsfx-inc\nimport d.jsfx-inc\n@init\norder = order * 10 + 1;\n");
+    scoped_new_txt file_b("${root}/Effects/b.jsfx-inc", "import c.jsfx-inc\nimport e.jsfx-inc\n@init\norder = order * 10 + 2;\n");
+    scoped_new_txt file_c("${root}/Effects/c.jsfx-inc", "import a.jsfx-inc\n@init\norder = order * 10 + 3;\n");
+    scoped_new_txt file_d("${root}/Effects/d.jsfx-inc", "@init\norder = order * 10 + 4;\n");
+    scoped_new_txt file_e("${root}/Effects/e.jsfx-inc", "@init\norder = order * 10 + 5;\n");
+
+    uint32_t num_threads = GENERATE(1, 4);
+
+    ysfx_config_u config{ysfx_config_new()};
+    ysfx_set_load_threads(config.get(), num_threads);
+    ysfx_u fx{ysfx_new(config.get())};
+    REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+
+    // in post-order, with each file once, whichever the threads
+    REQUIRE(fx->source.imports.size() == 5);
+    REQUIRE(ysfx::path_file_name(fx->source.imports[0]->path.c_str()) == "c.jsfx-inc");
+    REQUIRE(ysfx::path_file_name(fx->source.imports[1]->path.c_str()) == "d.jsfx-inc");
+    REQUIRE(ysfx::path_file_name(fx->source.imports[2]->path.c_str()) == "a.jsfx-inc");
+    REQUIRE(ysfx::path_file_name(fx->source.imports[3]->path.c_str()) == "e.jsfx-inc");
+    REQUIRE(ysfx::path_file_name(fx->source.imports[4]->path.c_str()) == "b.jsfx-inc");
+
+    REQUIRE(ysfx_compile(fx.get(), 0));
+    ysfx_init(fx.get());
+    REQUIRE(ysfx_read_var(fx.get(), "order") == 341529);
+
+    ysfx_load_stats_t stats;
+    ysfx_get_load_stats(fx.get(), &stats);
+    REQUIRE(stats.num_files == 6);
+
+    // a missing file fails the load
+    scoped_new_txt file_bad("${root}/Effects/bad.jsfx", "desc:bad\nimport a.jsfx-inc\nimport missing.jsfx-inc\n");
+    REQUIRE(!ysfx_load_file(fx.get(), file_bad.m_path.c_str(), 0));
+}
+
+TEST_CASE("load statistics", "[cache]")
+{
+    const char *text =
+        "desc:test" "\n"
+        "import include.jsfx-inc" "\n"
+        "@init" "\n"
+        "x = f(1);" "\n"
+        "@sample" "\n"
+        "spl0 = x;" "\n";
+
+    const char *text_inc =
+        "@init" "\n"
+        "function f(a) ( a * 2 );" "\n";
+
+    scoped_new_dir dir_fx("${root}/Effects");
+    scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+    scoped_new_txt file_inc("${root}/Effects/include.jsfx-inc", text_inc);
+
+    ysfx_config_u config{ysfx_config_new()};
+    ysfx_u fx{ysfx_new(config.get())};
+    REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+    REQUIRE(ysfx_compile(fx.get(), 0));
+
+    ysfx_load_stats_t stats;
+    ysfx_get_load_stats(fx.get(), &stats);
+    REQUIRE(stats.num_files == 2);
+    REQUIRE(stats.num_cached_files == 0);
+    REQUIRE(stats.slowest_file != std::string{});
+    REQUIRE(stats.code_size[ysfx_section_init] > 0);
+    REQUIRE(stats.code_size[ysfx_section_sample] > 0);
+    REQUIRE(stats.code_size[ysfx_section_block] == 0);
+
+    // the other instance gets the parsed files of the first
+    ysfx_u other{ysfx_new(config.get())};
+    REQUIRE(ysfx_load_file(other.get(), file_main.m_path.c_str(), 0));
+    ysfx_get_load_stats(other.get(), &stats);
+    REQUIRE(stats.num_files == 2);
+    REQUIRE(stats.num_cached_files == 2);
+    REQUIRE(stats.code_size[ysfx_section_init] == 0);
+}
+
+TEST_CASE("prewarming", "[cache]")
+{
+    const char *text =
+        "desc:test" "\n"
+        "import include.jsfx-inc" "\n"
+        "@init" "\n"
+        "x = f(1);" "\n";
+
+    const char *text_inc =
+        "@init" "\n"
+        "function f(a) ( a * 2 );" "\n";
+
+    scoped_new_dir dir_fx("${root}/Effects");
+    scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+    scoped_new_txt file_inc("${root}/Effects/include.jsfx-inc", text_inc);
+
+    ysfx_config_u config{ysfx_config_new()};
+    ysfx_prewarm(config.get(), file_main.m_path.c_str());
+    ysfx_prewarm_wait(config.get());
+
+    // the files are parsed already, though no instance has loaded them
+    ysfx_u fx{ysfx_new(config.get())};
+    REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+    ysfx_load_stats_t stats;
+    ysfx_get_load_stats(fx.get(), &stats);
+    REQUIRE(stats.num_files == 2);
+    REQUIRE(stats.num_cached_files == 2);
+
+    REQUIRE(ysfx_compile(fx.get(), 0));
+    ysfx_init(fx.get());
+    REQUIRE(ysfx_read_var(fx.get(), "x") == 2);
+
+    // the configuration is released while a file is in progress
+    fx.reset();
+    ysfx_prewarm(config.get(), file_main.m_path.c_str());
+    config.reset();
+}
@@ -0,0 +1,419 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "ysfx.h"
+#include "ysfx_test_utils.hpp"
+#include <catch.hpp>
+#include <vector>
+
+TEST_CASE("effect chains", "[chain]")
+{
+    const char *text =
+        "desc:example" "\n"
+        "in_pin:input" "\n"
+        "out_pin:output" "\n"
+        "@init" "\n"
+        "ext_nodenorm = 1;" "\n"
+        "@block" "\n"
+        "while (midirecv(ofs, msg1, msg2)) (" "\n"
+        "  midisend(ofs, msg1, msg2 + 1); // next note" "\n"
+        ");" "\n"
+        "@sample" "\n"
+        "spl0 = 2 * spl0 + 1;" "\n";
+
+    scoped_new_dir dir_fx("${root}/Effects");
+    scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+
+    ysfx_config_u config{ysfx_config_new()};
+    ysfx_chain_u chain{ysfx_chain_new()};
+
+    for (int i = 0; i < 3; ++i) {
+        ysfx_u fx{ysfx_new(config.get())};
+        REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+        REQUIRE(ysfx_compile(fx.get(), 0));
+        ysfx_init(fx.get());
+        ysfx_chain_append(chain.get(), fx.get());
+    }
+
+    REQUIRE(ysfx_chain_get_size(chain.get()) == 3);
+    REQUIRE(ysfx_chain_get_effect(chain.get(), 2) != nullptr);
+    REQUIRE(ysfx_chain_get_effect(chain.get(), 3) == nullptr);
+
+    SECTION("audio goes through all effects")
+    {
+        float in[16];
+        float out[16];
+        for (uint32_t i = 0; i < 16; ++i)
+            in[i] = (float)i;
+        const float *ins[] = {in};
+        float *outs[] = {out};
+        ysfx_chain_process_float(chain.get(), ins, outs, 1, 1, 16);
+        for (uint32_t i = 0; i < 16; ++i)
+            REQUIRE(out[i] == 8 * in[i] + 7);
+    }
+
+    SECTION("MIDI goes through all effects")
+    {
+        const uint8_t data[] = {0x90, 60, 0x40};
+        ysfx_midi_event_t event{};
+        event.offset = 5;
+        event.size = sizeof(data);
+        event.data = data;
+        REQUIRE(ysfx_chain_send_midi(chain.get(), &event));
+
+        float out[16];
+        float *outs[] = {out};
+        ysfx_chain_process_float(chain.get(), nullptr, outs, 0, 1, 16);
+
+        REQUIRE(ysfx_chain_receive_midi(chain.get(), &event));
+        REQUIRE(event.offset == 5);
+        REQUIRE(event.size == 3);
+        REQUIRE(event.data[0] == 0x90);
+        REQUIRE(event.data[1] == 63);
+        REQUIRE(event.data[2] == 0x40);
+        REQUIRE(!ysfx_chain_receive_midi(chain.get(), &event));
+    }
+
+    SECTION("pipelined groups delay the output")
+    {
+        const uint32_t sizes[] = {1, 2};
+        for (uint32_t num_groups : {3u, 2u}) {
+            ysfx_chain_set_pipeline(chain.get(), num_groups, (num_groups == 2) ? sizes : nullptr);
+            ysfx_chain_set_capacity(chain.get(), 1, 16);
+            REQUIRE(ysfx_chain_get_pdc_delay(chain.get()) == num_groups * 16);
+
+            const uint8_t data[] = {0x90, 60, 0x40};
+            for (uint32_t cycle = 0; cycle < 6; ++cycle) {
+                ysfx_midi_event_t event{};
+                event.offset = cycle;
+                event.size = sizeof(data);
+                event.data = data;
+                REQUIRE(ysfx_chain_send_midi(chain.get(), &event));
+
+                float in[16];
+                float out[16];
+                for (uint32_t i = 0; i < 16; ++i)
+                    in[i] = (float)(cycle * 16 + i);
+                const float *ins[] = {in};
+                float *outs[] = {out};
+                ysfx_chain_process_float(chain.get(), ins, outs, 1, 1, 16);
+
+                // the blocks come out as many cycles late as there are groups
+                const uint32_t delay = num_groups;
+                if (cycle < delay) {
+                    for (uint32_t i = 0; i < 16; ++i)
+                        REQUIRE(out[i] == 0);
+                    REQUIRE(!ysfx_chain_receive_midi(chain.get(), &event));
+                    continue;
+                }
+                for (uint32_t i = 0; i < 16; ++i)
+                    REQUIRE(out[i] == 8 * (float)((cycle - delay) * 16 + i) + 7);
+                REQUIRE(ysfx_chain_receive_midi(chain.get(), &event));
+                REQUIRE(event.offset == cycle - delay);
+                REQUIRE(event.data[1] == 63);
+                REQUIRE(!ysfx_chain_receive_midi(chain.get(), &event));
+            }
+        }
+
+        ysfx_chain_set_pipeline(chain.get(), 1, nullptr);
+        REQUIRE(ysfx_chain_get_pdc_delay(chain.get()) == 0);
+    }
+
+    SECTION("pipelined groups keep their delay when the cycles vary")
+    {
+        ysfx_chain_set_pipeline(chain.get(), 2, nullptr);
+        ysfx_chain_set_capacity(chain.get(), 1, 16);
+        const uint32_t delay = 32;
+        REQUIRE(ysfx_chain_get_pdc_delay(chain.get()) == delay);
+
+        const uint8_t data[] = {0x90, 60, 0x40};
+        std::vector<uint32_t> notes;
+        size_t num_received = 0;
+        uint32_t frame = 0;
+        for (uint32_t num_frames : {5u, 16u, 3u, 11u, 1u, 16u, 7u, 13u, 9u, 16u}) {
+            // a note at the start of every cycle, which comes back as late as the audio
+            ysfx_midi_event_t event{};
+            event.offset = 0;
+            event.size = sizeof(data);
+            event.data = data;
+            REQUIRE(ysfx_chain_send_midi(chain.get(), &event));
+            notes.push_back(frame);
+
+            float in[16];
+            float out[16];
+            for (uint32_t i = 0; i < num_frames; ++i)
+                in[i] = (float)(frame + i);
+            const float *ins[] = {in};
+            float *outs[] = {out};
+            ysfx_chain_process_float(chain.get(), ins, outs, 1, 1, num_frames);
+
+            for (uint32_t i = 0; i < num_frames; ++i) {
+                if (frame + i < delay)
+                    REQUIRE(out[i] == 0);
+                else
+                    REQUIRE(out[i] == 8 * (float)(frame + i - delay) + 7);
+            }
+            while (ysfx_chain_receive_midi(chain.get(), &event)) {
+                REQUIRE(num_received < notes.size());
+                REQUIRE(frame + event.offset == notes[num_received++] + delay);
+                REQUIRE(event.data[1] == 63);
+            }
+            frame += num_frames;
+        }
+        REQUIRE(num_received == 8);
+    }
+
+    SECTION("parallel branches are summed")
+    {
+        // each branch doubles and adds one, except the last which is dry
+        const uint32_t num_branches = 5;
+        std::vector<ysfx_chain_u> branches;
+        std::vector<ysfx_chain_t *> branch_ptrs;
+        for (uint32_t b = 0; b < num_branches; ++b) {
+            ysfx_chain_u branch{ysfx_chain_new()};
+            if (b + 1 < num_branches) {
+                ysfx_u fx{ysfx_new(config.get())};
+                REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+                REQUIRE(ysfx_compile(fx.get(), 0));
+                ysfx_init(fx.get());
+                ysfx_chain_append(branch.get(), fx.get());
+            }
+            branch_ptrs.push_back(branch.get());
+            branches.push_back(std::move(branch));
+        }
+
+        ysfx_chain_u graph{ysfx_chain_new()};
+        ysfx_chain_append_parallel(graph.get(), branch_ptrs.data(), num_branches);
+        REQUIRE(ysfx_chain_get_effect(graph.get(), 0) == nullptr);
+
+        const uint8_t data[] = {0x90, 60, 0x40};
+        ysfx_midi_event_t event{};
+        event.size = sizeof(data);
+        event.data = data;
+
+        for (uint32_t num_threads : {1u, 3u}) {
+            ysfx_chain_set_num_threads(graph.get(), num_threads);
+            for (int cycle = 0; cycle < 4; ++cycle) {
+                REQUIRE(ysfx_chain_send_midi(graph.get(), &event));
+
+                float in[16];
+                float out[16];
+                for (uint32_t i = 0; i < 16; ++i)
+                    in[i] = (float)i;
+                const float *ins[] = {in};
+                float *outs[] = {out};
+                ysfx_chain_process_float(graph.get(), ins, outs, 1, 1, 16);
+                for (uint32_t i = 0; i < 16; ++i)
+                    REQUIRE(out[i] == (num_branches - 1) * (2 * in[i] + 1) + in[i]);
+
+                // every branch outputs the MIDI, the dry one unchanged
+                uint32_t count = 0;
+                while (ysfx_chain_receive_midi(graph.get(), &event))
+                    ++count;
+                REQUIRE(count == num_branches);
+                event.data = data;
+            }
+        }
+
+        // the host runs the branches, or declines and the chain runs them
+        struct host_t {
+            ysfx_chain_t *chain = nullptr;
+            bool accept = false;
+            uint32_t num_tasks = 0;
+        };
+        host_t host;
+        host.chain = graph.get();
+        auto executor = [](void *userdata, uint32_t num_tasks) -> bool {
+            host_t *host = (host_t *)userdata;
+            if (!host->accept)
+                return false;
+            for (uint32_t i = num_tasks; i-- > 0; ) {
+                ysfx_chain_execute_task(host->chain, i);
+                ++host->num_tasks;
+            }
+            return true;
+        };
+        ysfx_chain_set_executor(graph.get(), executor, &host);
+
+        for (bool accept : {true, false}) {
+            host.accept = accept;
+            host.num_tasks = 0;
+
+            float in[16];
+            float out[16];
+            for (uint32_t i = 0; i < 16; ++i)
+                in[i] = (float)i;
+            const float *ins[] = {in};
+            float *outs[] = {out};
+            ysfx_chain_process_float(graph.get(), ins, outs, 1, 1, 16);
+            for (uint32_t i = 0; i < 16; ++i)
+                REQUIRE(out[i] == (num_branches - 1) * (2 * in[i] + 1) + in[i]);
+            REQUIRE(host.num_tasks == (accept ? num_branches : 0));
+        }
+
+        ysfx_chain_set_executor(graph.get(), nullptr, nullptr);
+    }
+
+    SECTION("ganged lanes follow the first")
+    {
+        const char *text_gain =
+            "desc:gain" "\n"
+            "slider1:1<0,4,0.1>gain" "\n"
+            "in_pin:input" "\n"
+            "out_pin:output" "\n"
+            "@init" "\n"
+            "ext_nodenorm = 1;" "\n"
+            "acc = 0;" "\n"
+            "@block" "\n"
+            "while (midirecv(ofs, msg1, msg2)) (" "\n"
+            "  midisend(ofs, msg1, msg2);" "\n"
+            ");" "\n"
+            "@sample" "\n"
+            "acc += spl0;" "\n"
+            "spl0 = acc * slider1;" "\n";
+        scoped_new_txt file_gain("${root}/Effects/gain.jsfx", text_gain);
+
+        ysfx_u fx{ysfx_new(config.get())};
+        REQUIRE(ysfx_load_file(fx.get(), file_gain.m_path.c_str(), 0));
+        REQUIRE(ysfx_compile(fx.get(), 0));
+        ysfx_init(fx.get());
+
+        const uint32_t num_lanes = 4;
+        ysfx_chain_u ganged{ysfx_chain_new()};
+        ysfx_chain_append_ganged(ganged.get(), fx.get(), num_lanes);
+        REQUIRE(ysfx_chain_get_size(ganged.get()) == 1);
+        REQUIRE(ysfx_chain_get_effect(ganged.get(), 0) == fx.get());
+
+        const uint8_t data[] = {0x90, 60, 0x40};
+        ysfx_midi_event_t event{};
+        event.size = sizeof(data);
+        event.data = data;
+
+        // one channel more than the lanes, which passes through
+        const uint32_t num_channels = num_lanes + 1;
+        const uint32_t num_frames = 8;
+        ysfx_real sums[num_channels] = {};
+        for (uint32_t num_threads : {1u, 3u}) {
+            ysfx_chain_set_num_threads(ganged.get(), num_threads);
+            ysfx_slider_set_value(fx.get(), 0, (ysfx_real)(num_threads + 1), true);
+            for (int cycle = 0; cycle < 3; ++cycle) {
+                REQUIRE(ysfx_chain_send_midi(ganged.get(), &event));
+
+                std::vector<std::vector<float>> in(num_channels, std::vector<float>(num_frames));
+                std::vector<std::vector<float>> out(num_channels, std::vector<float>(num_frames));
+                const float *ins[num_channels];
+                float *outs[num_channels];
+                for (uint32_t ch = 0; ch < num_channels; ++ch) {
+                    for (uint32_t f = 0; f < num_frames; ++f)
+                        in[ch][f] = (float)(ch + 1);
+                    ins[ch] = in[ch].data();
+                    outs[ch] = out[ch].data();
+                }
+                ysfx_chain_process_float(ganged.get(), ins, outs, num_channels, num_channels, num_frames);
+
+                // every lane keeps its own state, with the gain of the first
+                for (uint32_t ch = 0; ch < num_lanes; ++ch) {
+                    for (uint32_t f = 0; f < num_frames; ++f) {
+                        sums[ch] += ch + 1;
+                        REQUIRE(out[ch][f] == (float)(sums[ch] * (num_threads + 1)));
+                    }
+                }
+                for (uint32_t f = 0; f < num_frames; ++f)
+                    REQUIRE(out[num_lanes][f] == (float)num_channels);
+
+                uint32_t count = 0;
+                while (ysfx_chain_receive_midi(ganged.get(), &event))
+                    ++count;
+                REQUIRE(count == 1);
+                event.data = data;
+            }
+        }
+    }
+
+    SECTION("voices take the notes")
+    {
+        // a voice holds the level of its note, and fades out quickly after
+        const char *text_voice =
+            "desc:voice" "\n"
+            "out_pin:output" "\n"
+            "@init" "\n"
+            "ext_nodenorm = 1;" "\n"
+            "held = 0; level = 0;" "\n"
+            "@block" "\n"
+            "while (midirecv(ofs, m1, m2, m3)) (" "\n"
+            "  (m1 & 0xf0) == 0x90 && m3 > 0 ? (held = 1; level = m2;) :" "\n"
+            "  (m1 & 0xf0) == 0x80 || (m1 & 0xf0) == 0x90 ? held = 0;" "\n"
+            ");" "\n"
+            "@sample" "\n"
+            "held ? spl0 = level : (level *= 0.25; spl0 = level);" "\n";
+        scoped_new_txt file_voice("${root}/Effects/voice.jsfx", text_voice);
+
+        ysfx_u fx{ysfx_new(config.get())};
+        REQUIRE(ysfx_load_file(fx.get(), file_voice.m_path.c_str(), 0));
+        REQUIRE(ysfx_compile(fx.get(), 0));
+        ysfx_init(fx.get());
+
+        ysfx_chain_u synth{ysfx_chain_new()};
+        ysfx_chain_append_voices(synth.get(), fx.get(), 2);
+        REQUIRE(ysfx_chain_get_effect(synth.get(), 0) == fx.get());
+        REQUIRE(ysfx_chain_get_active_voices(synth.get(), 0) == 0);
+
+        auto send = [&](uint8_t status, uint8_t note, uint8_t velocity) {
+            const uint8_t data[] = {status, note, velocity};
+            ysfx_midi_event_t event{};
+            event.size = sizeof(data);
+            event.data = data;
+            REQUIRE(ysfx_chain_send_midi(synth.get(), &event));
+        };
+
+        const uint32_t num_frames = 64;
+        auto cycle = [&]() -> float {
+            float out[num_frames];
+            float *outs[] = {out};
+            ysfx_chain_process_float(synth.get(), nullptr, outs, 0, 1, num_frames);
+            return out[num_frames - 1];
+        };
+
+        for (uint32_t num_threads : {1u, 3u}) {
+            ysfx_chain_set_num_threads(synth.get(), num_threads);
+
+            send(0x90, 10, 100);
+            send(0x90, 20, 100);
+            REQUIRE(cycle() == 30);
+            REQUIRE(ysfx_chain_get_active_voices(synth.get(), 0) == 2);
+
+            // the third note steals the voice of the first
+            send(0x90, 40, 100);
+            REQUIRE(cycle() == 60);
+
+            // a released voice fades, then rests after a silent cycle
+            send(0x80, 20, 0);
+            REQUIRE(cycle() == 40);
+            REQUIRE(ysfx_chain_get_active_voices(synth.get(), 0) == 2);
+
+            // the note which was stolen has no voice anymore
+            send(0x80, 10, 0);
+            REQUIRE(cycle() == 40);
+            REQUIRE(ysfx_chain_get_active_voices(synth.get(), 0) == 1);
+
+            send(0x80, 40, 0);
+            cycle();
+            REQUIRE(cycle() == 0);
+            REQUIRE(ysfx_chain_get_active_voices(synth.get(), 0) == 0);
+        }
+    }
+}
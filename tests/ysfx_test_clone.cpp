@@ -0,0 +1,194 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "ysfx.h"
+#include "ysfx_test_utils.hpp"
+#include "ysfx_api_eel.hpp"
+#include "ysfx.hpp"
+#include <catch.hpp>
+
+TEST_CASE("clone", "[clone]")
+{
+    const char *text =
+        "desc:example" "\n"
+        "slider1:1<0,10,1>the slider" "\n"
+        "out_pin:output" "\n"
+        "@init" "\n"
+        "inits += 1;" "\n"
+        "state = slider1;" "\n"
+        "mem[100000] = 42;" "\n"
+        "strcpy(5, \"from init\");" "\n"
+        "strcpy(#named, \"named\");" "\n"
+        "@block" "\n"
+        "blocks += 1;" "\n"
+        "@sample" "\n"
+        "spl0 = state + mem[100000];" "\n";
+
+    scoped_new_dir dir_fx("${root}/Effects");
+    scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+
+    ysfx_config_u config{ysfx_config_new()};
+    ysfx_u fx{ysfx_new(config.get())};
+    REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+    REQUIRE(ysfx_compile(fx.get(), 0));
+    ysfx_set_sample_rate(fx.get(), 48000);
+    ysfx_set_block_size(fx.get(), 16);
+    ysfx_init(fx.get());
+
+    float out[16] = {};
+    float *outs[] = {out};
+    ysfx_process_float(fx.get(), nullptr, outs, 0, 1, 16);
+    REQUIRE(out[0] == 43);
+
+    // the value is changed after @init, so it's visible if @init runs again
+    ysfx_slider_set_value(fx.get(), 0, 3, false);
+    ysfx_string_set(fx.get(), 5, "after init");
+
+    SECTION("compiled and initialized")
+    {
+        ysfx_u copy{ysfx_clone(fx.get())};
+        REQUIRE(copy);
+        REQUIRE(ysfx_is_compiled(copy.get()));
+        REQUIRE(ysfx_get_sample_rate(copy.get()) == 48000);
+        REQUIRE(ysfx_get_block_size(copy.get()) == 16);
+
+        REQUIRE(ysfx_read_var(copy.get(), "inits") == 1);
+        REQUIRE(ysfx_read_var(copy.get(), "blocks") == 1);
+        REQUIRE(ysfx_read_var(copy.get(), "state") == 1);
+        REQUIRE(ysfx_slider_get_value(copy.get(), 0) == 3);
+        REQUIRE(ysfx_read_vmem_single(copy.get(), 100000) == 42);
+
+        std::string txt;
+        REQUIRE(ysfx_string_get(copy.get(), 5, txt));
+        REQUIRE(txt == "after init");
+
+        // the copy processes without running @init
+        ysfx_process_float(copy.get(), nullptr, outs, 0, 1, 16);
+        REQUIRE(out[0] == 43);
+        REQUIRE(ysfx_read_var(copy.get(), "inits") == 1);
+        REQUIRE(ysfx_read_var(copy.get(), "blocks") == 2);
+
+        // the instances are independent
+        ysfx_slider_set_value(copy.get(), 0, 5, false);
+        REQUIRE(ysfx_slider_get_value(fx.get(), 0) == 3);
+    }
+
+    SECTION("loaded only")
+    {
+        ysfx_u loaded{ysfx_new(config.get())};
+        REQUIRE(ysfx_load_file(loaded.get(), file_main.m_path.c_str(), 0));
+
+        ysfx_u copy{ysfx_clone(loaded.get())};
+        REQUIRE(copy);
+        REQUIRE(ysfx_is_loaded(copy.get()));
+        REQUIRE(!ysfx_is_compiled(copy.get()));
+        REQUIRE(ysfx_slider_exists(copy.get(), 0));
+        REQUIRE(ysfx_compile(copy.get(), 0));
+    }
+}
+
+TEST_CASE("adopt state after a change of code", "[clone]")
+{
+    const char *text_v1 =
+        "desc:example" "\n"
+        "slider1:1<0,10,1>the slider" "\n"
+        "out_pin:output" "\n"
+        "@init" "\n"
+        "inits += 1;" "\n"
+        "@block" "\n"
+        "mem[0] += 1;" "\n"
+        "@sample" "\n"
+        "spl0 = mem[0];" "\n";
+
+    const char *text_v2 =
+        "desc:example" "\n"
+        "slider1:1<0,10,1>the slider" "\n"
+        "out_pin:output" "\n"
+        "@init" "\n"
+        "inits += 1;" "\n"
+        "@block" "\n"
+        "mem[0] += 1;" "\n"
+        "@sample" "\n"
+        "spl0 = 10 * mem[0];" "\n";
+
+    const char *text_v3 =
+        "desc:example" "\n"
+        "slider1:1<0,10,1>the slider" "\n"
+        "slider2:1<0,10,1>another slider" "\n"
+        "out_pin:output" "\n"
+        "@init" "\n"
+        "inits += 1;" "\n"
+        "@sample" "\n"
+        "spl0 = 10 * mem[0];" "\n";
+
+    scoped_new_dir dir_fx("${root}/Effects");
+    std::string main_path = resolve_path("${root}/Effects/example.jsfx");
+
+    ysfx_config_u config{ysfx_config_new()};
+    ysfx_u fx{ysfx_new(config.get())};
+    {
+        scoped_new_txt file_main(main_path, text_v1);
+        REQUIRE(ysfx_load_file(fx.get(), main_path.c_str(), 0));
+        REQUIRE(ysfx_compile(fx.get(), 0));
+        ysfx_init(fx.get());
+    }
+
+    float out[16] = {};
+    float *outs[] = {out};
+    ysfx_process_float(fx.get(), nullptr, outs, 0, 1, 16);
+    ysfx_process_float(fx.get(), nullptr, outs, 0, 1, 16);
+    REQUIRE(out[0] == 2);
+
+    SECTION("code only")
+    {
+        scoped_new_txt file_main(main_path, text_v2);
+
+        ysfx_u next{ysfx_new(config.get())};
+        REQUIRE(ysfx_load_file(next.get(), main_path.c_str(), 0));
+        REQUIRE(ysfx_compile(next.get(), 0));
+        REQUIRE(ysfx_get_changed_sections(fx.get(), next.get()) == (1u << ysfx_section_sample));
+
+        REQUIRE(ysfx_adopt_state(next.get(), fx.get()));
+        REQUIRE(ysfx_read_var(next.get(), "inits") == 1);
+
+        ysfx_process_float(next.get(), nullptr, outs, 0, 1, 16);
+        REQUIRE(out[0] == 30);
+        REQUIRE(ysfx_read_var(next.get(), "inits") == 1);
+    }
+
+    SECTION("header and code")
+    {
+        scoped_new_txt file_main(main_path, text_v3);
+
+        ysfx_u next{ysfx_new(config.get())};
+        REQUIRE(ysfx_load_file(next.get(), main_path.c_str(), 0));
+        REQUIRE(ysfx_compile(next.get(), 0));
+        REQUIRE(ysfx_get_changed_sections(fx.get(), next.get()) ==
+            (ysfx_changed_header | (1u << ysfx_section_block) | (1u << ysfx_section_sample)));
+    }
+
+    SECTION("uninitialized")
+    {
+        scoped_new_txt file_main(main_path, text_v1);
+
+        ysfx_u next{ysfx_new(config.get())};
+        REQUIRE(ysfx_load_file(next.get(), main_path.c_str(), 0));
+        REQUIRE(ysfx_compile(next.get(), 0));
+        REQUIRE(ysfx_get_changed_sections(fx.get(), next.get()) == 0);
+        REQUIRE(!ysfx_adopt_state(fx.get(), next.get()));
+    }
+}
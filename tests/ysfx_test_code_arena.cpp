@@ -0,0 +1,127 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "ysfx.h"
+#include "ysfx_code_arena.hpp"
+#include "ysfx_test_utils.hpp"
+#include <catch.hpp>
+#include <cstring>
+#include <cmath>
+
+TEST_CASE("code arena", "[code]")
+{
+    const size_t page = ysfx_code_arena_t::page_size();
+
+    SECTION("pages are packed and reused")
+    {
+        ysfx_code_arena_t arena{8 * page};
+
+        uint8_t *a = (uint8_t *)arena.allocate(2 * page);
+        uint8_t *b = (uint8_t *)arena.allocate(page);
+        uint8_t *c = (uint8_t *)arena.allocate(3 * page);
+        REQUIRE(a);
+        REQUIRE(b == a + 2 * page);
+        REQUIRE(c == b + page);
+        std::memset(a, 0xcc, 6 * page);
+
+        ysfx_code_arena_stats_t stats{};
+        arena.get_stats(&stats);
+        REQUIRE(stats.num_regions == 1);
+        REQUIRE(stats.reserved_bytes == 8 * page);
+        REQUIRE(stats.used_bytes == 6 * page);
+
+        // the free neighbors merge, and the lowest span is taken first
+        arena.deallocate(a, 2 * page);
+        arena.deallocate(b, page);
+        uint8_t *d = (uint8_t *)arena.allocate(3 * page);
+        REQUIRE(d == a);
+        std::memset(d, 0, 3 * page);
+
+        // a full region is followed by another
+        uint8_t *e = (uint8_t *)arena.allocate(4 * page);
+        REQUIRE(e);
+        arena.get_stats(&stats);
+        REQUIRE(stats.num_regions == 2);
+
+        // the region which becomes empty goes back, unless it is the last
+        arena.deallocate(e, 4 * page);
+        arena.get_stats(&stats);
+        REQUIRE(stats.num_regions == 1);
+        REQUIRE(stats.used_bytes == 6 * page);
+        arena.deallocate(c, 3 * page);
+        arena.deallocate(d, 3 * page);
+        arena.get_stats(&stats);
+        REQUIRE(stats.num_regions == 1);
+        REQUIRE(stats.used_bytes == 0);
+    }
+
+    SECTION("large and invalid sizes")
+    {
+        ysfx_code_arena_t arena{4 * page};
+
+        REQUIRE(!arena.allocate(0));
+        REQUIRE(!arena.allocate(page + 1));
+
+        uint8_t *large = (uint8_t *)arena.allocate(16 * page);
+        REQUIRE(large);
+        std::memset(large, 0, 16 * page);
+        ysfx_code_arena_stats_t stats{};
+        arena.get_stats(&stats);
+        REQUIRE(stats.num_regions == 0);
+        REQUIRE(stats.used_bytes == 16 * page);
+        arena.deallocate(large, 16 * page);
+        arena.get_stats(&stats);
+        REQUIRE(stats.used_bytes == 0);
+    }
+
+    SECTION("the code of effects")
+    {
+        const char *text =
+            "desc:example" "\n"
+            "out_pin:output" "\n"
+            "@init" "\n"
+            "function f(x) ( x * 0.5 );" "\n"
+            "@sample" "\n"
+            "spl0 = f(sin(n += 0.01));" "\n";
+
+        scoped_new_dir dir_fx("${root}/Effects");
+        scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+
+        ysfx_code_arena_stats_t before{};
+        ysfx_get_code_arena_stats(&before);
+
+        ysfx_config_u config{ysfx_config_new()};
+        ysfx_u fx{ysfx_new(config.get())};
+        REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+        REQUIRE(ysfx_compile(fx.get(), 0));
+        ysfx_init(fx.get());
+
+        ysfx_code_arena_stats_t stats{};
+        ysfx_get_code_arena_stats(&stats);
+        REQUIRE(stats.num_regions >= 1);
+        REQUIRE(stats.used_bytes > before.used_bytes);
+
+        float out[16] = {};
+        float *outs[] = {out};
+        ysfx_process_float(fx.get(), nullptr, outs, 0, 1, 16);
+        REQUIRE(out[15] == Approx(0.5 * std::sin(0.16)).epsilon(1e-6));
+
+        fx.reset();
+        ysfx_get_code_arena_stats(&stats);
+        REQUIRE(stats.used_bytes == before.used_bytes);
+    }
+}
@@ -0,0 +1,105 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+#include "ysfx_fft.hpp"
+#include <catch.hpp>
+#include <complex>
+#include <vector>
+#include <cmath>
+
+static std::vector<WDL_FFT_COMPLEX> make_fft_input(int len)
+{
+    std::vector<WDL_FFT_COMPLEX> buf((size_t)len);
+    for (int i = 0; i < len; ++i) {
+        buf[(size_t)i].re = std::sin(i * 0.37) + 0.01 * i;
+        buf[(size_t)i].im = std::cos(i * 1.13) - 0.2;
+    }
+    return buf;
+}
+
+TEST_CASE("fft", "[fft]")
+{
+    WDL_fft_init();
+
+    SECTION("complex transform")
+    {
+        for (int len = 2; len <= 32768; len *= 2) {
+            INFO("size " << len);
+            const std::vector<WDL_FFT_COMPLEX> input = make_fft_input(len);
+            std::vector<WDL_FFT_COMPLEX> buf = input;
+            WDL_fft(buf.data(), len, 0);
+
+            // the bins are those of the DFT, in the order of WDL_fft_permute
+            if (len <= 1024) {
+                double error = 0;
+                for (int k = 0; k < len; ++k) {
+                    std::complex<double> sum = 0;
+                    for (int n = 0; n < len; ++n) {
+                        std::complex<double> x{input[(size_t)n].re, input[(size_t)n].im};
+                        sum += x * std::polar(1.0, -2.0 * 3.14159265358979323846 * ((double)n * k / len));
+                    }
+                    const WDL_FFT_COMPLEX &bin = buf[(size_t)WDL_fft_permute(len, k)];
+                    error = std::max(error, std::abs(sum - std::complex<double>{bin.re, bin.im}));
+                }
+                REQUIRE(error < 1e-9 * len);
+            }
+
+#if defined(YSFX_FFT_SIMD)
+            std::vector<WDL_FFT_COMPLEX> ref = input;
+            ysfx_wdl_fft(ref.data(), len, 0);
+            for (int k = 0; k < len; ++k) {
+                REQUIRE(std::fabs(buf[(size_t)k].re - ref[(size_t)k].re) < 1e-9 * len);
+                REQUIRE(std::fabs(buf[(size_t)k].im - ref[(size_t)k].im) < 1e-9 * len);
+            }
+#endif
+
+            // the inverse takes the permuted bins, and it's not normalized
+            WDL_fft(buf.data(), len, 1);
+            double error = 0;
+            for (int n = 0; n < len; ++n) {
+                error = std::max(error, std::fabs(buf[(size_t)n].re / len - input[(size_t)n].re));
+                error = std::max(error, std::fabs(buf[(size_t)n].im / len - input[(size_t)n].im));
+            }
+            REQUIRE(error < 1e-12 * len);
+        }
+    }
+
+    SECTION("real transform")
+    {
+        for (int len = 2; len <= 32768; len *= 2) {
+            INFO("size " << len);
+            std::vector<WDL_FFT_REAL> input((size_t)len);
+            for (int i = 0; i < len; ++i)
+                input[(size_t)i] = std::sin(i * 0.29) + 0.3 * std::cos(i * 2.1);
+
+            std::vector<WDL_FFT_REAL> buf = input;
+            WDL_real_fft(buf.data(), len, 0);
+
+#if defined(YSFX_FFT_SIMD)
+            std::vector<WDL_FFT_REAL> ref = input;
+            ysfx_wdl_real_fft(ref.data(), len, 0);
+            for (int k = 0; k < len; ++k)
+                REQUIRE(std::fabs(buf[(size_t)k] - ref[(size_t)k]) < 1e-9 * len);
+#endif
+
+            WDL_real_fft(buf.data(), len, 1);
+            double error = 0;
+            for (int n = 0; n < len; ++n)
+                error = std::max(error, std::fabs(buf[(size_t)n] / (2 * len) - input[(size_t)n]));
+            REQUIRE(error < 1e-12 * len);
+        }
+    }
+}
@@ -127,5 +127,45 @@ TEST_CASE("file system utilities", "[filesystem]")
             REQUIRE(std::filesystem::path(test) == std::filesystem::path(root.m_path + "dir1/second_file.jsfx-inc"));
             ysfx_free_resolved_path(test);
         }
-    }    
+    }
+
+    SECTION("index of the import root")
+    {
+        scoped_new_dir root("${root}/lib/");
+        scoped_new_dir sub1("${root}/lib/a/");
+        scoped_new_dir sub2("${root}/lib/a/deep/");
+        scoped_new_dir sub3("${root}/lib/b/");
+        scoped_new_txt file_main("${root}/lib/main.jsfx", "desc:example\n");
+
+        ysfx_config_u config{ysfx_config_new()};
+        ysfx_set_import_root(config.get(), root.m_path.c_str());
+        ysfx_u fx{ysfx_new(config.get())};
+
+        auto resolve = [&](const char *name) -> std::string {
+            char *path = ysfx_resolve_path_and_allocate(fx.get(), name, file_main.m_path.c_str());
+            std::string result = path ? path : "";
+            ysfx_free_resolved_path(path);
+            return result;
+        };
+
+        {
+            scoped_new_txt file("${root}/lib/a/deep/Lib.jsfx-inc", "");
+            // found in a subdirectory, case-insensitively
+            REQUIRE(std::filesystem::path(resolve("lib.jsfx-inc")) == std::filesystem::path(file.m_path));
+            REQUIRE(std::filesystem::path(resolve("deep/LIB.jsfx-inc")) == std::filesystem::path(file.m_path));
+            REQUIRE(resolve("nope/lib.jsfx-inc").empty());
+        }
+
+        {
+            // the file has moved, the index is refreshed
+            scoped_new_txt file("${root}/lib/b/lib.jsfx-inc", "");
+            REQUIRE(std::filesystem::path(resolve("lib.jsfx-inc")) == std::filesystem::path(file.m_path));
+
+            // an added file is found after an explicit refresh
+            scoped_new_txt other("${root}/lib/a/lib.jsfx-inc", "");
+            REQUIRE(std::filesystem::path(resolve("lib.jsfx-inc")) == std::filesystem::path(file.m_path));
+            ysfx_refresh_import_root(config.get());
+            REQUIRE(std::filesystem::path(resolve("lib.jsfx-inc")) == std::filesystem::path(other.m_path));
+        }
+    }
 }
@@ -0,0 +1,577 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "ysfx.h"
+#include "ysfx_test_utils.hpp"
+#include <catch.hpp>
+#include <thread>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <random>
+
+#if !defined(YSFX_NO_GFX)
+#define WDL_NO_DEFINE_MINMAX
+#include "WDL/swell/swell.h"
+#include "WDL/lice/lice.h"
+#include "ysfx_lice_simd.hpp"
+#include "ysfx_image_cache.hpp"
+
+TEST_CASE("graphics", "[gfx]")
+{
+    SECTION("concurrent instances")
+    {
+        const char *text =
+            "desc:example" "\n"
+            "out_pin:output" "\n"
+            "@gfx 64 64" "\n"
+            "gfx_r = 1; gfx_g = 0; gfx_b = 0; gfx_a = 1;" "\n"
+            "gfx_rect(0, 0, gfx_w, gfx_h);" "\n"
+            "gfx_setfont(1, \"Arial\", 12);" "\n"
+            "gfx_x = 2; gfx_y = 2;" "\n"
+            "gfx_r = gfx_g = gfx_b = 1;" "\n"
+            "gfx_drawstr(\"hello world\");" "\n"
+            "gfx_setfont(0);" "\n"
+            "gfx_x = 2; gfx_y = 30;" "\n"
+            "gfx_drawnumber(frames += 1, 0);" "\n";
+
+        scoped_new_dir dir_fx("${root}/Effects");
+        scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+
+        const uint32_t num_threads = 8;
+        const uint32_t num_frames = 50;
+        const uint32_t w = 64, h = 64;
+
+        // the effects compile here, so the threads only run @gfx
+        std::vector<ysfx_u> fxs;
+        std::vector<std::vector<uint8_t>> pixels;
+        for (uint32_t t = 0; t < num_threads; ++t) {
+            ysfx_config_u config{ysfx_config_new()};
+            ysfx_u fx{ysfx_new(config.get())};
+            REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+            REQUIRE(ysfx_compile(fx.get(), 0));
+            ysfx_init(fx.get());
+            fxs.push_back(std::move(fx));
+            pixels.emplace_back(4 * w * h);
+        }
+
+        std::vector<std::thread> threads;
+        std::vector<int> ok(num_threads, 0);
+
+        for (uint32_t t = 0; t < num_threads; ++t) {
+            threads.emplace_back([&, t]() {
+                ysfx_t *fx = fxs[t].get();
+                ysfx_gfx_config_t gc{};
+                gc.pixel_width = w;
+                gc.pixel_height = h;
+                gc.pixels = pixels[t].data();
+                gc.scale_factor = 1.0;
+                ysfx_gfx_setup(fx, &gc);
+
+                // each instance draws in its own thread, without any lock of the host
+                for (uint32_t i = 0; i < num_frames; ++i)
+                    ysfx_gfx_run(fx);
+
+                // the corner, which no text covers, has the red of the background
+                const uint8_t *corner = &pixels[t][4 * (w * (h - 1) + (w - 1))];
+                ok[t] = ysfx_read_var(fx, "frames") == num_frames && corner[2] == 0xff && corner[1] == 0;
+            });
+        }
+
+        for (std::thread &thread : threads)
+            thread.join();
+        for (uint32_t t = 0; t < num_threads; ++t)
+            REQUIRE(ok[t]);
+    }
+
+    SECTION("dirty rectangle")
+    {
+        const char *text =
+            "desc:example" "\n"
+            "out_pin:output" "\n"
+            "@gfx 64 64" "\n"
+            "gfx_clear = clearing ? 0 : -1;" "\n"
+            "gfx_r = gfx_g = gfx_b = gfx_a = 1;" "\n"
+            "drawing ? gfx_rect(10, 20, 8, 4);" "\n";
+
+        scoped_new_dir dir_fx("${root}/Effects");
+        scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+
+        ysfx_config_u config{ysfx_config_new()};
+        ysfx_u fx{ysfx_new(config.get())};
+        REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+        REQUIRE(ysfx_compile(fx.get(), 0));
+        ysfx_init(fx.get());
+
+        const uint32_t w = 64, h = 64;
+        std::vector<uint8_t> pixels(4 * w * h);
+        ysfx_gfx_config_t gc{};
+        gc.pixel_width = w;
+        gc.pixel_height = h;
+        gc.pixels = pixels.data();
+        gc.scale_factor = 1.0;
+        ysfx_gfx_setup(fx.get(), &gc);
+
+        uint32_t rect[4];
+
+        // a frame which draws nothing has nothing to repaint
+        REQUIRE(!ysfx_gfx_run(fx.get()));
+        REQUIRE(!ysfx_gfx_get_dirty_rect(fx.get(), rect));
+
+        // a rectangle, with the margin of a pixel
+        *ysfx_find_var(fx.get(), "drawing") = 1;
+        REQUIRE(ysfx_gfx_run(fx.get()));
+        REQUIRE(ysfx_gfx_get_dirty_rect(fx.get(), rect));
+        REQUIRE(rect[0] == 9);
+        REQUIRE(rect[1] == 19);
+        REQUIRE(rect[2] == 10);
+        REQUIRE(rect[3] == 6);
+
+        // clearing changes all of the frame
+        *ysfx_find_var(fx.get(), "clearing") = 1;
+        REQUIRE(ysfx_gfx_run(fx.get()));
+        REQUIRE(ysfx_gfx_get_dirty_rect(fx.get(), rect));
+        REQUIRE(rect[0] == 0);
+        REQUIRE(rect[1] == 0);
+        REQUIRE(rect[2] == w);
+        REQUIRE(rect[3] == h);
+    }
+
+    SECTION("offscreen rendering")
+    {
+        const char *text =
+            "desc:example" "\n"
+            "out_pin:output" "\n"
+            "@gfx 64 64" "\n"
+            "frames += 1;" "\n"
+            "gfx_set(1, 0, 0);" "\n"
+            "gfx_rect(0, 0, gfx_w / 2, gfx_h);" "\n";
+
+        scoped_new_dir dir_fx("${root}/Effects");
+        scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+
+        ysfx_config_u config{ysfx_config_new()};
+        ysfx_u fx{ysfx_new(config.get())};
+        REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+        REQUIRE(ysfx_compile(fx.get(), 0));
+
+        const uint32_t w = 16, h = 8;
+        std::vector<uint8_t> pixels(4 * w * h, 0xff);
+
+        // nothing runs before the initialization
+        REQUIRE(ysfx_gfx_render_offscreen(fx.get(), w, h, 3, pixels.data()) == 0);
+
+        ysfx_init(fx.get());
+        REQUIRE(ysfx_gfx_render_offscreen(fx.get(), w, h, 3, pixels.data()) == 3);
+        REQUIRE(*ysfx_find_var(fx.get(), "frames") == 3);
+
+        uint32_t left, right;
+        memcpy(&left, &pixels[4 * (w / 2 - 1)], 4);
+        memcpy(&right, &pixels[4 * (w / 2)], 4);
+        REQUIRE((left & 0xffffff) == 0xff0000);
+        REQUIRE(right == 0);
+
+        // the buffer is no longer used by the frames which follow
+        std::fill(pixels.begin(), pixels.end(), 0x55);
+        ysfx_gfx_run(fx.get());
+        REQUIRE(pixels[0] == 0x55);
+    }
+
+    SECTION("time of the drawing")
+    {
+        const char *text =
+            "desc:example" "\n"
+            "out_pin:output" "\n"
+            "@gfx 64 64" "\n"
+            "i = 0; loop(100, gfx_set(i / 100, 0, 0); gfx_rect(0, 0, gfx_w, gfx_h); i += 1);" "\n";
+
+        scoped_new_dir dir_fx("${root}/Effects");
+        scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+
+        ysfx_config_u config{ysfx_config_new()};
+        ysfx_u fx{ysfx_new(config.get())};
+        REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+        REQUIRE(ysfx_compile(fx.get(), 0));
+        ysfx_init(fx.get());
+
+        const uint32_t w = 64, h = 64;
+        std::vector<uint8_t> pixels(4 * w * h);
+
+        // nothing is measured unless profiling
+        REQUIRE(ysfx_gfx_render_offscreen(fx.get(), w, h, 2, pixels.data()) == 2);
+        REQUIRE(ysfx_get_gfx_draw_ns(fx.get()) == 0);
+
+        ysfx_set_profiling(fx.get(), true);
+        REQUIRE(ysfx_gfx_render_offscreen(fx.get(), w, h, 2, pixels.data()) == 2);
+        ysfx_set_profiling(fx.get(), false);
+
+        ysfx_profile_stats_t stats{};
+        REQUIRE(ysfx_get_profile_stats(fx.get(), ysfx_section_gfx, &stats));
+        uint64_t draw_ns = ysfx_get_gfx_draw_ns(fx.get());
+        REQUIRE(draw_ns > 0);
+        REQUIRE(draw_ns <= stats.total_ns);
+
+        ysfx_reset_profile_stats(fx.get());
+        REQUIRE(ysfx_get_gfx_draw_ns(fx.get()) == 0);
+    }
+
+    SECTION("measured text")
+    {
+        const char *text =
+            "desc:example" "\n"
+            "out_pin:output" "\n"
+            "@init" "\n"
+            "size = 12;" "\n"
+            "@gfx 64 64" "\n"
+            "gfx_setfont(1, \"Arial\", size);" "\n"
+            "gfx_measurestr(\"Hello\", w1, h1);" "\n"
+            "gfx_measurestr(\"Hello\", w2, h2);" "\n"
+            "gfx_measurestr(\"Hello\\nworld\", w3, h3);" "\n"
+            "gfx_x = gfx_y = 0;" "\n"
+            "gfx_drawstr(\"Hello\");" "\n"
+            "x1 = gfx_x;" "\n";
+
+        scoped_new_dir dir_fx("${root}/Effects");
+        scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+
+        ysfx_config_u config{ysfx_config_new()};
+        ysfx_u fx{ysfx_new(config.get())};
+        REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+        REQUIRE(ysfx_compile(fx.get(), 0));
+        ysfx_init(fx.get());
+
+        const uint32_t w = 64, h = 64;
+        std::vector<uint8_t> pixels(4 * w * h);
+        ysfx_gfx_config_t gc{};
+        gc.pixel_width = w;
+        gc.pixel_height = h;
+        gc.pixels = pixels.data();
+        gc.scale_factor = 1.0;
+        ysfx_gfx_setup(fx.get(), &gc);
+
+        // the measure of a line is the same from the cache, and for drawing
+        ysfx_gfx_run(fx.get());
+        ysfx_real w1 = *ysfx_find_var(fx.get(), "w1");
+        ysfx_real h1 = *ysfx_find_var(fx.get(), "h1");
+        REQUIRE(w1 > 0);
+        REQUIRE(*ysfx_find_var(fx.get(), "w2") == w1);
+        REQUIRE(*ysfx_find_var(fx.get(), "h2") == h1);
+        REQUIRE(*ysfx_find_var(fx.get(), "h3") == 2 * h1);
+        REQUIRE(*ysfx_find_var(fx.get(), "x1") == w1);
+
+        // changing the font measures again
+        *ysfx_find_var(fx.get(), "size") = 24;
+        ysfx_gfx_run(fx.get());
+        REQUIRE(*ysfx_find_var(fx.get(), "w1") > w1);
+        REQUIRE(*ysfx_find_var(fx.get(), "h1") > h1);
+    }
+
+    SECTION("shared images")
+    {
+        const char *text =
+            "desc:example" "\n"
+            "filename:0,knob.png" "\n"
+            "out_pin:output" "\n"
+            "@gfx 64 64" "\n"
+            "gfx_dest = 0;" "\n"
+            "drawing ? (gfx_r = gfx_g = gfx_b = gfx_a = 1; gfx_rect(0, 0, 4, 4));" "\n"
+            "gfx_x = 1; gfx_y = 1; gfx_getpixel(r, g, b);" "\n"
+            "gfx_dest = -1;" "\n";
+
+        scoped_new_dir dir_fx("${root}/Effects");
+        scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+        scoped_new_txt file_img("${root}/Effects/knob.png", "");
+        {
+            LICE_MemBitmap bm(8, 8);
+            LICE_Clear(&bm, LICE_RGBA(0, 0, 255, 255));
+            REQUIRE(LICE_WritePNG(file_img.m_path.c_str(), &bm, true));
+        }
+
+        // the decoded file is the same for all who load it
+        ysfx_image_sp image = ysfx_image_acquire(file_img.m_path.c_str());
+        REQUIRE(image);
+        REQUIRE(image == ysfx_image_acquire(file_img.m_path.c_str()));
+
+        const uint32_t w = 64, h = 64;
+        std::vector<uint8_t> pixels(4 * w * h);
+        ysfx_gfx_config_t gc{};
+        gc.pixel_width = w;
+        gc.pixel_height = h;
+        gc.pixels = pixels.data();
+        gc.scale_factor = 1.0;
+
+        ysfx_config_u config{ysfx_config_new()};
+        ysfx_u fx[2];
+        for (ysfx_u &f : fx) {
+            f.reset(ysfx_new(config.get()));
+            REQUIRE(ysfx_load_file(f.get(), file_main.m_path.c_str(), 0));
+            REQUIRE(ysfx_compile(f.get(), 0));
+            ysfx_init(f.get());
+            ysfx_gfx_setup(f.get(), &gc);
+        }
+
+        // drawing on the image of one instance leaves the other one as it was
+        *ysfx_find_var(fx[0].get(), "drawing") = 1;
+        for (ysfx_u &f : fx)
+            ysfx_gfx_run(f.get());
+        REQUIRE(*ysfx_find_var(fx[0].get(), "r") == 1);
+        REQUIRE(*ysfx_find_var(fx[1].get(), "r") == 0);
+        REQUIRE(*ysfx_find_var(fx[1].get(), "b") == 1);
+
+        LICE_pixel *p = image->bitmap->getBits();
+        REQUIRE(p[0] == (LICE_pixel)LICE_RGBA(0, 0, 255, 255));
+
+        // a newer version of the file is another image
+        {
+            LICE_MemBitmap bm(4, 4);
+            LICE_Clear(&bm, LICE_RGBA(0, 255, 0, 255));
+            REQUIRE(LICE_WritePNG(file_img.m_path.c_str(), &bm, true));
+        }
+        ysfx_image_sp newer = ysfx_image_acquire(file_img.m_path.c_str());
+        REQUIRE(newer);
+        REQUIRE(newer != image);
+        REQUIRE(newer->bitmap->getWidth() == 4);
+    }
+
+    SECTION("input")
+    {
+        const char *text =
+            "desc:example" "\n"
+            "out_pin:output" "\n"
+            "@gfx 64 64" "\n"
+            "mx = mouse_x; my = mouse_y; cap = mouse_cap; wheel = mouse_wheel;" "\n"
+            "n = 0; s = 0;" "\n"
+            "while ((c = gfx_getchar()) > 0) ( n += 1; s = s * 256 + c; );" "\n";
+
+        scoped_new_dir dir_fx("${root}/Effects");
+        scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+
+        ysfx_config_u config{ysfx_config_new()};
+        ysfx_u fx{ysfx_new(config.get())};
+        REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+        REQUIRE(ysfx_compile(fx.get(), 0));
+        ysfx_init(fx.get());
+
+        const uint32_t w = 64, h = 64;
+        std::vector<uint8_t> pixels(4 * w * h);
+        ysfx_gfx_config_t gc{};
+        gc.pixel_width = w;
+        gc.pixel_height = h;
+        gc.pixels = pixels.data();
+        gc.scale_factor = 1.0;
+        ysfx_gfx_setup(fx.get(), &gc);
+        ysfx_gfx_run(fx.get());
+
+        // the keys arrive in order, and the moves merge into the last, with the wheel steps added up
+        ysfx_gfx_add_key(fx.get(), 0, 'a', true);
+        ysfx_gfx_add_key(fx.get(), 0, 'a', false);
+        ysfx_gfx_add_key(fx.get(), 0, 'b', true);
+        ysfx_gfx_update_mouse(fx.get(), 0, 10, 20, 0, 1, 0);
+        ysfx_gfx_update_mouse(fx.get(), 0, 11, 21, 0, 1, 0);
+        ysfx_gfx_update_mouse(fx.get(), 0, 12, 22, ysfx_button_left, 0, 0);
+        ysfx_gfx_run(fx.get());
+        REQUIRE(*ysfx_find_var(fx.get(), "n") == 2);
+        REQUIRE(*ysfx_find_var(fx.get(), "s") == 'a' * 256 + 'b');
+        REQUIRE(*ysfx_find_var(fx.get(), "mx") == 12);
+        REQUIRE(*ysfx_find_var(fx.get(), "my") == 22);
+        REQUIRE(*ysfx_find_var(fx.get(), "cap") == 1);
+        REQUIRE(*ysfx_find_var(fx.get(), "wheel") == 1024);
+
+        // nothing new, the mouse stays
+        ysfx_gfx_run(fx.get());
+        REQUIRE(*ysfx_find_var(fx.get(), "n") == 0);
+        REQUIRE(*ysfx_find_var(fx.get(), "mx") == 12);
+        REQUIRE(*ysfx_find_var(fx.get(), "wheel") == 1024);
+
+        // the input from another thread, while @gfx runs
+        std::thread sender([&fx]() {
+            for (int i = 1; i <= 100; ++i)
+                ysfx_gfx_update_mouse(fx.get(), 0, i, i, 0, 0, 0);
+        });
+        for (int i = 0; i < 100; ++i)
+            ysfx_gfx_run(fx.get());
+        sender.join();
+        ysfx_gfx_run(fx.get());
+        REQUIRE(*ysfx_find_var(fx.get(), "mx") == 100);
+    }
+
+    SECTION("spectrum analyzer")
+    {
+        const char *text =
+            "desc:example" "\n"
+            "out_pin:output" "\n"
+            "@init" "\n"
+            "analyzer = analyzer_create(0, 64);" "\n"
+            "again = analyzer_create(0, 64);" "\n"
+            "@sample" "\n"
+            "spl0 = 0.5 * sin(2 * $pi * 8 * n / 64) + 0.25;" "\n"
+            "n += 1;" "\n"
+            "@gfx 64 64" "\n"
+            "bins = analyzer_read(analyzer, 1000, window);" "\n";
+
+        scoped_new_dir dir_fx("${root}/Effects");
+        scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+
+        ysfx_config_u config{ysfx_config_new()};
+        ysfx_u fx{ysfx_new(config.get())};
+        REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+        REQUIRE(ysfx_compile(fx.get(), 0));
+        ysfx_init(fx.get());
+
+        // the same tap again is the same analyzer
+        REQUIRE(*ysfx_find_var(fx.get(), "analyzer") == 1);
+        REQUIRE(*ysfx_find_var(fx.get(), "again") == 1);
+
+        const uint32_t w = 64, h = 64;
+        std::vector<uint8_t> pixels(4 * w * h);
+        ysfx_gfx_config_t gc{};
+        gc.pixel_width = w;
+        gc.pixel_height = h;
+        gc.pixels = pixels.data();
+        gc.scale_factor = 1.0;
+        ysfx_gfx_setup(fx.get(), &gc);
+
+        // 1.5 transforms of audio, the older samples leave the window
+        std::vector<float> out(96);
+        float *outs[] = {out.data()};
+        ysfx_process_float(fx.get(), nullptr, outs, 0, 1, 96);
+
+        // rectangular: the sine and the offset fall exactly into their bins
+        ysfx_gfx_run(fx.get());
+        REQUIRE(*ysfx_find_var(fx.get(), "bins") == 32);
+        for (uint32_t k = 0; k < 32; ++k) {
+            ysfx_real expected = (k == 0) ? 0.25 : (k == 8) ? 0.5 : 0;
+            REQUIRE(ysfx_read_vmem_single(fx.get(), 1000 + k) == Approx(expected).margin(1e-6));
+        }
+
+        // Hann: the sine keeps its amplitude at the center, and spreads to the neighbors
+        *ysfx_find_var(fx.get(), "window") = 1;
+        ysfx_gfx_run(fx.get());
+        REQUIRE(ysfx_read_vmem_single(fx.get(), 1000 + 8) == Approx(0.5));
+        REQUIRE(ysfx_read_vmem_single(fx.get(), 1000 + 7) == Approx(0.25));
+        REQUIRE(ysfx_read_vmem_single(fx.get(), 1000 + 12) == Approx(0).margin(1e-6));
+
+        // a null output is analyzed as silence
+        float *null_outs[] = {nullptr};
+        ysfx_process_float(fx.get(), nullptr, null_outs, 0, 1, 128);
+        *ysfx_find_var(fx.get(), "window") = 0;
+        ysfx_gfx_run(fx.get());
+        for (uint32_t k = 0; k < 32; ++k)
+            REQUIRE(ysfx_read_vmem_single(fx.get(), 1000 + k) == 0);
+    }
+}
+
+TEST_CASE("vectorized drawing", "[gfx]")
+{
+    // each drawing is made by LICE and by the vectors, which must agree to the bit;
+    // odd sizes, so the rows end in pixels which the vectors leave
+    const int w = 37, h = 23;
+    std::mt19937 prng(1234);
+
+    auto randomize = [&prng](LICE_IBitmap *bm) {
+        LICE_pixel *p = bm->getBits();
+        for (int i = 0, n = bm->getRowSpan() * bm->getHeight(); i < n; ++i)
+            p[i] = (LICE_pixel)prng();
+    };
+    auto same_pixels = [](LICE_IBitmap *a, LICE_IBitmap *b) -> bool {
+        return memcmp(a->getBits(), b->getBits(), sizeof(LICE_pixel) * a->getRowSpan() * a->getHeight()) == 0;
+    };
+
+    const float alphas[] = {1.0f, 0.75f, 0.5f, 0.25f, 0.3f, 0.01f, 0.999f, 0.0f};
+    const int rects[][4] = {{0, 0, w, h}, {3, 5, 17, 9}, {-4, -2, 11, 30}, {30, 20, 20, 20}, {w, 0, 5, 5}};
+
+    std::vector<LICE_pixel> buf1(w * h), buf2(w * h);
+
+    SECTION("fill")
+    {
+        const int modes[] = {LICE_BLIT_MODE_COPY, LICE_BLIT_MODE_ADD,
+                             LICE_BLIT_MODE_COPY|LICE_BLIT_USE_ALPHA, LICE_BLIT_MODE_ADD|LICE_BLIT_USE_ALPHA};
+        for (bool flipped : {false, true}) {
+            LICE_WrapperBitmap expected(buf1.data(), w, h, w, flipped);
+            LICE_WrapperBitmap actual(buf2.data(), w, h, w, flipped);
+            for (int mode : modes) {
+                for (float alpha : alphas) {
+                    for (const int *r : rects) {
+                        randomize(&expected);
+                        memcpy(buf2.data(), buf1.data(), sizeof(LICE_pixel) * w * h);
+                        LICE_pixel color = (LICE_pixel)prng();
+                        LICE_FillRect(&expected, r[0], r[1], r[2], r[3], color, alpha, mode);
+                        if (!ysfx::lice_fill_rect(&actual, r[0], r[1], r[2], r[3], color, alpha, mode))
+                            LICE_FillRect(&actual, r[0], r[1], r[2], r[3], color, alpha, mode);
+                        REQUIRE(same_pixels(&expected, &actual));
+                    }
+                }
+            }
+        }
+    }
+
+    SECTION("multiply add")
+    {
+        const float params[][8] = {
+            {1, 1, 1, 1, 0, 0, 0, 0},
+            {0.5f, 0.25f, 2.0f, 1.0f, 10, -20, 30, 0},
+            {-1.0f, 0.9f, 1.1f, 0.3f, 255, 0, -300, 128},
+        };
+        for (bool flipped : {false, true}) {
+            LICE_WrapperBitmap expected(buf1.data(), w, h, w, flipped);
+            LICE_WrapperBitmap actual(buf2.data(), w, h, w, flipped);
+            for (const float *m : params) {
+                for (const int *r : rects) {
+                    randomize(&expected);
+                    memcpy(buf2.data(), buf1.data(), sizeof(LICE_pixel) * w * h);
+                    LICE_MultiplyAddRect(&expected, r[0], r[1], r[2], r[3], m[0], m[1], m[2], m[3], m[4], m[5], m[6], m[7]);
+                    if (!ysfx::lice_multiply_add_rect(&actual, r[0], r[1], r[2], r[3], m[0], m[1], m[2], m[3], m[4], m[5], m[6], m[7]))
+                        LICE_MultiplyAddRect(&actual, r[0], r[1], r[2], r[3], m[0], m[1], m[2], m[3], m[4], m[5], m[6], m[7]);
+                    REQUIRE(same_pixels(&expected, &actual));
+                }
+            }
+        }
+    }
+
+    SECTION("blit")
+    {
+        const int modes[] = {LICE_BLIT_MODE_COPY, LICE_BLIT_MODE_ADD, LICE_BLIT_MODE_COPY|LICE_BLIT_USE_ALPHA,
+                             LICE_BLIT_MODE_COPY|LICE_BLIT_USE_ALPHA|LICE_BLIT_FILTER_BILINEAR};
+        const int sw = 29, sh = 31;
+        std::vector<LICE_pixel> srcbuf(sw * sh);
+        for (bool flipped : {false, true}) {
+            LICE_WrapperBitmap expected(buf1.data(), w, h, w, flipped);
+            LICE_WrapperBitmap actual(buf2.data(), w, h, w, flipped);
+            LICE_WrapperBitmap src(srcbuf.data(), sw, sh, sw, !flipped);
+            for (int mode : modes) {
+                for (float alpha : alphas) {
+                    for (const int *r : rects) {
+                        randomize(&expected);
+                        randomize(&src);
+                        // some pixels which are transparent, and some opaque
+                        for (int i = 0; i < sw * sh; i += 3)
+                            srcbuf[i] &= (i & 1) ? 0x00ffffff : 0xffffffff;
+                        for (int i = 1; i < sw * sh; i += 5)
+                            srcbuf[i] |= 0xff000000;
+                        memcpy(buf2.data(), buf1.data(), sizeof(LICE_pixel) * w * h);
+                        const float sx = (float)(r[0] / 2), sy = (float)(r[1] / 2);
+                        LICE_ScaledBlit(&expected, &src, r[0], r[1], r[2], r[3], sx, sy, (float)r[2], (float)r[3], alpha, mode);
+                        if (!ysfx::lice_scaled_blit(&actual, &src, r[0], r[1], r[2], r[3], sx, sy, (float)r[2], (float)r[3], alpha, mode))
+                            LICE_ScaledBlit(&actual, &src, r[0], r[1], r[2], r[3], sx, sy, (float)r[2], (float)r[3], alpha, mode);
+                        REQUIRE(same_pixels(&expected, &actual));
+                    }
+                }
+            }
+        }
+    }
+}
+#endif
@@ -19,9 +19,14 @@
 #include "ysfx_test_utils.hpp"
 #include "ysfx_api_eel.hpp"
 #include "ysfx.hpp"
+#include "ysfx_config.hpp"
 #include <catch.hpp>
 
 #include <iostream>
+#include <vector>
+#include <cmath>
+#include <chrono>
+#include <thread>
 
 TEST_CASE("integration", "[integration]")
 {
@@ -72,6 +77,42 @@ TEST_CASE("integration", "[integration]")
         REQUIRE((txt == "filedir/blap.txt"));
     };
 
+    SECTION("file slider listing")
+    {
+        const char *text =
+            "desc:example" "\n"
+            "out_pin:output" "\n"
+            "slider1:/filedir:blip.txt:Directory test" "\n";
+
+        scoped_new_dir dir_fx("${root}/Effects");
+        scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+        scoped_new_dir dir_data("${root}/Data");
+        scoped_new_dir dir_data2("${root}/Data/filedir");
+        scoped_new_txt f1("${root}/Data/filedir/blip.txt", "blah");
+        scoped_new_txt f2("${root}/Data/filedir/blap.txt", "bloo");
+
+        ysfx_config_u config{ysfx_config_new()};
+        ysfx_set_data_root(config.get(), dir_data.m_path.c_str());
+
+        auto count_files = [&config, &file_main]() -> uint32_t {
+            ysfx_u fx{ysfx_new(config.get())};
+            REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+            return ysfx_slider_get_enum_size(fx.get(), 0);
+        };
+
+        REQUIRE(count_files() == 2);
+        // the second instance takes the listing of the first
+        REQUIRE(count_files() == 2);
+        REQUIRE(config->dir_listings.size() == 1);
+
+        // the listing follows the changes of the directory
+        {
+            scoped_new_txt f3("${root}/Data/filedir/blop.txt", "bloo");
+            REQUIRE(count_files() == 3);
+        }
+        REQUIRE(count_files() == 2);
+    };
+
     SECTION("strcpy_from_slider_non_file")
     {
         const char *text =
@@ -180,6 +221,65 @@ TEST_CASE("integration", "[integration]")
         REQUIRE(ysfx_read_var(fx.get(), "x3") == 8);
     };
 
+    SECTION("preprocessor config variants")
+    {
+        const char *text =
+            "desc:test" "\n"
+            "config: test1 \"test\" 8 1=one 2=two" "\n"
+            "slider1:0<0,1,0.1>the slider 1" "\n"
+            "import include.jsfx-inc" "\n"
+            "@init" "\n"
+            "x1 = <?printf(\"%d\", test1)?>;" "\n";
+
+        const char *include_text =
+            "@init" "\n"
+            "x3 = <?printf(\"%d\", test1)?>;" "\n";
+
+        scoped_new_dir dir_fx("${root}/Effects");
+        scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+        scoped_new_txt file("${root}/Effects/include.jsfx-inc", include_text);
+
+        ysfx_config_u config{ysfx_config_new()};
+        ysfx_u fx{ysfx_new(config.get())};
+
+        REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+        REQUIRE(ysfx_compile(fx.get(), 0));
+        ysfx_init(fx.get());
+        ysfx_slider_set_value(fx.get(), 0, 0.5, false);
+
+        REQUIRE(ysfx_get_num_config_items(fx.get()) == 1);
+        REQUIRE(!strcmp(ysfx_get_config_item_identifier(fx.get(), 0), "test1"));
+        REQUIRE(ysfx_get_config_item_num_values(fx.get(), 0) == 2);
+        REQUIRE(ysfx_get_config_item_value(fx.get(), 0, 1) == 2);
+        REQUIRE(!strcmp(ysfx_get_config_item_value_name(fx.get(), 0, 1), "two"));
+        REQUIRE(ysfx_get_config_value(fx.get(), 0) == 8);
+
+        // a value which is not listed
+        REQUIRE(!ysfx_set_config_value(fx.get(), 0, 5));
+        REQUIRE(ysfx_read_var(fx.get(), "x1") == 8);
+
+        // the prepared variant is found in memory, for the main file and the import
+        ysfx_prepare_config_variants(fx.get(), false);
+        REQUIRE(ysfx_set_config_value(fx.get(), 0, 2));
+        ysfx_load_stats_t stats{};
+        ysfx_get_load_stats(fx.get(), &stats);
+        REQUIRE(stats.num_files == 3);
+        REQUIRE(stats.num_cached_files == 3);
+
+        REQUIRE(ysfx_get_config_value(fx.get(), 0) == 2);
+        REQUIRE(ysfx_is_compiled(fx.get()));
+        REQUIRE(ysfx_read_var(fx.get(), "x1") == 2);
+        REQUIRE(ysfx_read_var(fx.get(), "x3") == 2);
+        REQUIRE(ysfx_slider_get_value(fx.get(), 0) == 0.5);
+
+        REQUIRE(ysfx_set_config_value(fx.get(), 0, 8));
+        REQUIRE(ysfx_read_var(fx.get(), "x1") == 8);
+        REQUIRE(ysfx_read_var(fx.get(), "x3") == 8);
+
+        // the effect is released while the variants are being prepared
+        ysfx_prepare_config_variants(fx.get(), true);
+    };
+
     SECTION("preprocessor ensure rewind")
     {
         const char *text =
@@ -331,6 +431,586 @@ TEST_CASE("integration", "[integration]")
         REQUIRE(ysfx_calculate_used_mem(fx.get()) == 13434880);  // Note that this always rounds to the next full block
     };
 
+    SECTION("prefault from the high-water mark")
+    {
+        const char *text =
+        "desc:test" "\n"
+        "options:maxmem=13421772" "\n"
+        "out_pin:output" "\n"
+        "@init" "\n"
+        "mem[1000000] = 1;" "\n";
+
+        scoped_new_dir dir_fx("${root}/Effects");
+        scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+
+        ysfx_config_u config{ysfx_config_new()};
+        ysfx_u fx{ysfx_new(config.get())};
+
+        REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+        REQUIRE(ysfx_compile(fx.get(), 0));
+        ysfx_init(fx.get());
+
+        REQUIRE(ysfx_calculate_used_mem(fx.get()) == 65536);
+        REQUIRE(ysfx_get_memory_high_water(fx.get()) == 1048576);
+
+        ysfx_state_u state{ysfx_save_state(fx.get())};
+        REQUIRE(state->mem_high_water == 1048576);
+
+        // a new session pre-faults what the previous one has used
+        ysfx_u fx2{ysfx_new(config.get())};
+        ysfx_set_auto_prefault(fx2.get(), ysfx_prefault_high_water);
+        REQUIRE(ysfx_load_file(fx2.get(), file_main.m_path.c_str(), 0));
+        REQUIRE(ysfx_compile(fx2.get(), 0));
+        state->mem_high_water = 2 * 1048576;
+        REQUIRE(ysfx_load_state(fx2.get(), state.get()));
+        REQUIRE(ysfx_calculate_used_mem(fx2.get()) == 2 * 1048576);
+
+        ysfx_prefault_memory(fx2.get(), ysfx_prefault_maxmem);
+        REQUIRE(ysfx_calculate_used_mem(fx2.get()) == 13434880);
+    };
+
+    SECTION("memory statistics")
+    {
+        const char *text =
+        "desc:test" "\n"
+        "options:maxmem=13421772" "\n"
+        "out_pin:output" "\n"
+        "@init" "\n"
+        "mem[10] = 1;" "\n"
+        "mem[1000000] = 1;" "\n"
+        "strcpy(#named, \"hello\");" "\n";
+
+        scoped_new_dir dir_fx("${root}/Effects");
+        scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+
+        ysfx_config_u config{ysfx_config_new()};
+        ysfx_u fx{ysfx_new(config.get())};
+
+        REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+        REQUIRE(ysfx_compile(fx.get(), 0));
+        ysfx_init(fx.get());
+
+        ysfx_memory_stats_t stats{};
+        ysfx_get_memory_stats(fx.get(), &stats);
+        REQUIRE(stats.ram_blocks == 2);
+        REQUIRE(stats.ram_bytes == 2 * 65536 * sizeof(ysfx_real));
+        REQUIRE(stats.ram_high_water == 1048576);
+        REQUIRE(stats.ram_limit == 13434880);
+        REQUIRE(stats.num_strings >= 1);
+        REQUIRE(stats.string_bytes >= 5);
+        REQUIRE(stats.num_images == 0);
+        REQUIRE(stats.image_bytes == 0);
+        REQUIRE(ysfx_calculate_used_mem(fx.get()) == 2 * 65536);
+    };
+
+    SECTION("relocate memory")
+    {
+        const char *text =
+        "desc:test" "\n"
+        "out_pin:output" "\n"
+        "@init" "\n"
+        "mem[10] = 1;" "\n"
+        "mem[1000000] = 2;" "\n"
+        "@sample" "\n"
+        "spl0 = mem[10] + mem[1000000];" "\n";
+
+        scoped_new_dir dir_fx("${root}/Effects");
+        scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+
+        ysfx_config_u config{ysfx_config_new()};
+        ysfx_u fx{ysfx_new(config.get())};
+
+        REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+        REQUIRE(ysfx_compile(fx.get(), 0));
+        ysfx_init(fx.get());
+
+        ysfx_relocate_memory(fx.get());
+        REQUIRE(ysfx_calculate_used_mem(fx.get()) == 2 * 65536);
+        REQUIRE(ysfx_read_vmem_single(fx.get(), 10) == 1);
+        REQUIRE(ysfx_read_vmem_single(fx.get(), 1000000) == 2);
+
+        float buf[16]{};
+        float *outs[] = {buf};
+        ysfx_process_float(fx.get(), nullptr, outs, 0, 1, 16);
+        REQUIRE(buf[15] == 3);
+    };
+
+    SECTION("vmem spans and snapshot")
+    {
+        const char *text =
+        "desc:test" "\n"
+        "out_pin:output" "\n"
+        "@init" "\n"
+        "mem[65530] = 1;" "\n"
+        "mem[65540] = 2;" "\n"
+        "@block" "\n"
+        "mem[65531] += 1;" "\n";
+
+        scoped_new_dir dir_fx("${root}/Effects");
+        scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+
+        ysfx_config_u config{ysfx_config_new()};
+        ysfx_u fx{ysfx_new(config.get())};
+
+        REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+        REQUIRE(ysfx_compile(fx.get(), 0));
+        ysfx_init(fx.get());
+
+        ysfx_vmem_span_t spans[4];
+        REQUIRE(ysfx_get_vmem_spans(fx.get(), 65530, 20, spans, 4) == 2);
+        REQUIRE(spans[0].addr == 65530);
+        REQUIRE(spans[0].count == 6);
+        REQUIRE(spans[0].data[0] == 1);
+        REQUIRE(spans[1].addr == 65536);
+        REQUIRE(spans[1].count == 14);
+        REQUIRE(spans[1].data[4] == 2);
+        REQUIRE(ysfx_get_vmem_spans(fx.get(), 3 * 65536, 1, spans, 4) == 1);
+        REQUIRE(spans[0].data == nullptr);
+        REQUIRE(ysfx_get_vmem_spans(fx.get(), 0, 65536 * 3, spans, 1) == 3);
+
+        ysfx_real values[20];
+        ysfx_read_vmem(fx.get(), 65530, values, 20);
+        REQUIRE(values[0] == 1);
+        REQUIRE(values[10] == 2);
+
+        ysfx_set_vmem_snapshot(fx.get(), 65530, 20);
+        uint32_t count = 0;
+        const ysfx_real *snapshot = ysfx_get_vmem_snapshot(fx.get(), &count);
+        REQUIRE(count == 20);
+        REQUIRE(snapshot[0] == 0);
+
+        float buf[64]{};
+        float *outs[] = {buf};
+        ysfx_process_float(fx.get(), nullptr, outs, 0, 1, 64);
+        snapshot = ysfx_get_vmem_snapshot(fx.get(), &count);
+        REQUIRE(snapshot[0] == 1);
+        REQUIRE(snapshot[1] == 1);
+        REQUIRE(snapshot[10] == 2);
+
+        // the reader keeps its copy until it asks again
+        ysfx_process_float(fx.get(), nullptr, outs, 0, 1, 64);
+        ysfx_process_float(fx.get(), nullptr, outs, 0, 1, 64);
+        REQUIRE(snapshot[1] == 1);
+        snapshot = ysfx_get_vmem_snapshot(fx.get(), &count);
+        REQUIRE(snapshot[1] == 3);
+    };
+
+    SECTION("watched variables and memory")
+    {
+        const char *text =
+        "desc:test" "\n"
+        "out_pin:output" "\n"
+        "@init" "\n"
+        "mem[100] = 5;" "\n"
+        "@block" "\n"
+        "counter += 1;" "\n"
+        "mem[101] = counter * 2;" "\n";
+
+        scoped_new_dir dir_fx("${root}/Effects");
+        scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+
+        ysfx_config_u config{ysfx_config_new()};
+        ysfx_u fx{ysfx_new(config.get())};
+
+        REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+        REQUIRE(ysfx_compile(fx.get(), 0));
+        ysfx_init(fx.get());
+
+        uint32_t count = 0;
+        REQUIRE(ysfx_get_watch(fx.get(), &count) == nullptr);
+        REQUIRE(count == 0);
+
+        const char *names[] = {"counter", "missing"};
+        ysfx_watch_range_t range{100, 2};
+        REQUIRE(!ysfx_set_watch(fx.get(), names, 2, &range, 1));
+        REQUIRE(ysfx_get_watch(fx.get(), &count) == nullptr);
+        REQUIRE(count == 4);
+
+        float buf[64]{};
+        float *outs[] = {buf};
+        ysfx_process_float(fx.get(), nullptr, outs, 0, 1, 64);
+        const ysfx_real *values = ysfx_get_watch(fx.get(), &count);
+        REQUIRE(values);
+        REQUIRE(values[0] == 1);
+        REQUIRE(values[1] == 0);
+        REQUIRE(values[2] == 5);
+        REQUIRE(values[3] == 2);
+
+        // the reader keeps its copy until it asks again
+        ysfx_process_float(fx.get(), nullptr, outs, 0, 1, 64);
+        REQUIRE(values[0] == 1);
+        values = ysfx_get_watch(fx.get(), &count);
+        REQUIRE(values[0] == 2);
+        REQUIRE(values[3] == 4);
+
+        // another watch replaces it
+        REQUIRE(ysfx_set_watch(fx.get(), names, 1, nullptr, 0));
+        ysfx_process_float(fx.get(), nullptr, outs, 0, 1, 64);
+        values = ysfx_get_watch(fx.get(), &count);
+        REQUIRE(count == 1);
+        REQUIRE(values[0] == 3);
+
+        // the variables of the unloaded code read as zero
+        REQUIRE(ysfx_compile(fx.get(), 0));
+        ysfx_init(fx.get());
+        ysfx_process_float(fx.get(), nullptr, outs, 0, 1, 64);
+        values = ysfx_get_watch(fx.get(), &count);
+        REQUIRE(values[0] == 0);
+    };
+
+    SECTION("file_mem across blocks")
+    {
+        const char *text =
+        "desc:test" "\n"
+        "filename:0,table.raw" "\n"
+        "out_pin:output" "\n"
+        "@init" "\n"
+        "h = file_open(0);" "\n"
+        "n = file_mem(h, 65530, 3000);" "\n"
+        "file_close(h);" "\n";
+
+        std::vector<float> table(2000);
+        for (size_t i = 0; i < table.size(); ++i)
+            table[i] = (float)i * 0.5f;
+
+        scoped_new_dir dir_fx("${root}/Effects");
+        scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+        scoped_new_txt file_table("${root}/Effects/table.raw", (const char *)table.data(), table.size() * sizeof(float));
+
+        ysfx_config_u config{ysfx_config_new()};
+        ysfx_u fx{ysfx_new(config.get())};
+
+        REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+        REQUIRE(ysfx_compile(fx.get(), 0));
+        ysfx_init(fx.get());
+
+        REQUIRE(ysfx_read_var(fx.get(), "n") == 2000);
+        std::vector<ysfx_real> values(2001);
+        ysfx_read_vmem(fx.get(), 65530, values.data(), 2001);
+        for (size_t i = 0; i < table.size(); ++i)
+            REQUIRE(values[i] == table[i]);
+        REQUIRE(values[2000] == 0);
+    };
+
+    SECTION("file_var of a text file")
+    {
+        const char *text =
+        "desc:test" "\n"
+        "filename:0,numbers.txt" "\n"
+        "out_pin:output" "\n"
+        "@init" "\n"
+        "h = file_open(0);" "\n"
+        "n = file_mem(h, 0, 10);" "\n"
+        "file_close(h);" "\n";
+
+        scoped_new_dir dir_fx("${root}/Effects");
+        scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+        scoped_new_txt file_numbers("${root}/Effects/numbers.txt",
+            "1, -2.5\n" "junk\n" "1e3,0x10\n" "0.12345678901234567890123\n" "7");
+
+        ysfx_config_u config{ysfx_config_new()};
+        ysfx_u fx{ysfx_new(config.get())};
+
+        REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+        REQUIRE(ysfx_compile(fx.get(), 0));
+        ysfx_init(fx.get());
+
+        REQUIRE(ysfx_read_var(fx.get(), "n") == 6);
+        ysfx_real values[6];
+        ysfx_read_vmem(fx.get(), 0, values, 6);
+        REQUIRE(values[0] == 1);
+        REQUIRE(values[1] == -2.5);
+        REQUIRE(values[2] == 1000);
+        REQUIRE(values[3] == 16);
+        REQUIRE(values[4] == Approx(0.12345678901234567890123));
+        REQUIRE(values[5] == 7);
+    };
+
+    SECTION("file handles")
+    {
+        const char *text =
+        "desc:test" "\n"
+        "filename:0,value.txt" "\n"
+        "out_pin:output" "\n"
+        "@init" "\n"
+        "h1 = file_open(0);" "\n"
+        "c1 = file_close(h1);" "\n"
+        "h2 = file_open(0);" "\n"
+        "r1 = file_var(h1, v1);" "\n"
+        "c2 = file_close(h1);" "\n"
+        "r2 = file_var(h2, v2);" "\n"
+        "file_close(h2);" "\n"
+        "n = 0; while (file_open(0) >= 0 ? n += 1);" "\n"
+        "c0 = file_close(0);" "\n";
+
+        scoped_new_dir dir_fx("${root}/Effects");
+        scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+        scoped_new_txt file_data("${root}/Effects/value.txt", "7");
+
+        ysfx_config_u config{ysfx_config_new()};
+        ysfx_u fx{ysfx_new(config.get())};
+
+        REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+        REQUIRE(ysfx_compile(fx.get(), 0));
+        ysfx_init(fx.get());
+
+        // the slot is reused, but the closed handle remains invalid
+        REQUIRE(ysfx_read_var(fx.get(), "h1") == 1);
+        REQUIRE(ysfx_read_var(fx.get(), "c1") == 0);
+        REQUIRE(ysfx_read_var(fx.get(), "h2") != ysfx_read_var(fx.get(), "h1"));
+        REQUIRE((uint32_t)ysfx_read_var(fx.get(), "h2") % ysfx_max_file_handles == 1);
+        REQUIRE(ysfx_read_var(fx.get(), "r1") == 0);
+        REQUIRE(ysfx_read_var(fx.get(), "c2") == -1);
+        REQUIRE(ysfx_read_var(fx.get(), "r2") == 1);
+        REQUIRE(ysfx_read_var(fx.get(), "v2") == 7);
+        REQUIRE(ysfx_read_var(fx.get(), "n") == ysfx_max_file_handles - 1);
+        REQUIRE(ysfx_read_var(fx.get(), "c0") == -1);
+
+        // the slots start over at the next initialization, in new generations
+        ysfx_real h2 = ysfx_read_var(fx.get(), "h2");
+        ysfx_init(fx.get());
+        REQUIRE((uint32_t)ysfx_read_var(fx.get(), "h1") % ysfx_max_file_handles == 1);
+        REQUIRE(ysfx_read_var(fx.get(), "h1") != h2);
+    };
+
+    SECTION("file_open of a resolved file")
+    {
+        const char *text =
+        "desc:test" "\n"
+        "filename:0,value.txt" "\n"
+        "out_pin:output" "\n"
+        "@init" "\n"
+        "h = file_open(0);" "\n"
+        "v = -1;" "\n"
+        "h >= 0 ? (file_var(h, v); file_close(h););" "\n";
+
+        scoped_new_dir dir_fx("${root}/Effects");
+        scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+        scoped_new_dir dir_data("${root}/Data");
+
+        ysfx_config_u config{ysfx_config_new()};
+        ysfx_set_data_root(config.get(), dir_data.m_path.c_str());
+        ysfx_u fx{ysfx_new(config.get())};
+
+        REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+        REQUIRE(ysfx_compile(fx.get(), 0));
+
+        {
+            scoped_new_txt file_data("${root}/Data/value.txt", "1");
+            for (int time = 0; time < 2; ++time) {
+                ysfx_init(fx.get());
+                REQUIRE(ysfx_read_var(fx.get(), "v") == 1);
+            }
+
+            // the directory of the effect takes precedence, once it has the file
+            scoped_new_txt file_local("${root}/Effects/value.txt", "2");
+            ysfx_init(fx.get());
+            REQUIRE(ysfx_read_var(fx.get(), "v") == 2);
+        }
+
+        // the file is gone
+        ysfx_init(fx.get());
+        REQUIRE(ysfx_read_var(fx.get(), "v") == -1);
+    };
+
+    SECTION("file_open_async")
+    {
+        const char *text =
+        "desc:test" "\n"
+        "filename:0,value.txt" "\n"
+        "out_pin:output" "\n"
+        "@init" "\n"
+        "h = file_open_async(0);" "\n"
+        "a = file_avail(h);" "\n"
+        "h2 = file_open_async(\"missing.txt\");" "\n"
+        "v = -1;" "\n"
+        "@block" "\n"
+        "v < 0 && file_avail(h) >= 0 ? file_var(h, v);" "\n"
+        "a2 = file_avail(h2);" "\n";
+
+        scoped_new_dir dir_fx("${root}/Effects");
+        scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+        scoped_new_txt file_data("${root}/Effects/value.txt", "7");
+
+        ysfx_config_u config{ysfx_config_new()};
+        ysfx_u fx{ysfx_new(config.get())};
+
+        REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+        REQUIRE(ysfx_compile(fx.get(), 0));
+        ysfx_init(fx.get());
+
+        // the handles are valid at once, even for a file which will fail to open
+        REQUIRE(ysfx_read_var(fx.get(), "h") > 0);
+        REQUIRE(ysfx_read_var(fx.get(), "h2") > 0);
+        ysfx_real a = ysfx_read_var(fx.get(), "a");
+        REQUIRE((a == ysfx_async_file_t::pending_avail || a > 0));
+
+        float out[16] = {};
+        float *outs[] = {out};
+        for (int i = 0; i < 1000 && (ysfx_read_var(fx.get(), "v") < 0 || ysfx_read_var(fx.get(), "a2") != 0); ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            ysfx_process_float(fx.get(), nullptr, outs, 0, 1, 16);
+        }
+        REQUIRE(ysfx_read_var(fx.get(), "v") == 7);
+        REQUIRE(ysfx_read_var(fx.get(), "a2") == 0);
+    };
+
+    SECTION("file_open_write of raw and text files")
+    {
+        const char *text =
+        "desc:test" "\n"
+        "out_pin:output" "\n"
+        "@init" "\n"
+        "bad1 = file_open_write(\"../escape.raw\");" "\n"
+        "bad2 = file_open_write(\"sub/../../escape.raw\");" "\n"
+        "i = 0; loop(100, i[0] = i * 0.25; i += 1);" "\n"
+        "h = file_open_write(\"out.raw\");" "\n"
+        "w1 = file_mem(h, 0, 100);" "\n"
+        "x = 42; w2 = file_var(h, x);" "\n"
+        "file_string(h, \"hello\");" "\n"
+        "file_close(h);" "\n"
+        "h = file_open_write(\"out.txt\");" "\n"
+        "x = 0.5; file_var(h, x);" "\n"
+        "x = -3; file_var(h, x);" "\n"
+        "file_close(h);" "\n"
+        "h = file_open(\"out.raw\");" "\n"
+        "r1 = file_mem(h, 1000, 100);" "\n"
+        "file_var(h, y);" "\n"
+        "file_string(h, #s);" "\n"
+        "s5 = strcmp(#s, \"hello\");" "\n"
+        "file_close(h);" "\n"
+        "h = file_open(\"out.txt\");" "\n"
+        "r2 = file_mem(h, 2000, 10);" "\n"
+        "file_close(h);" "\n";
+
+        scoped_new_dir dir_fx("${root}/Effects");
+        scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+        // the files to write, removed afterwards
+        scoped_new_txt file_raw("${root}/Effects/out.raw", "");
+        scoped_new_txt file_txt("${root}/Effects/out.txt", "");
+
+        ysfx_config_u config{ysfx_config_new()};
+        ysfx_set_write_root(config.get(), dir_fx.m_path.c_str());
+        ysfx_u fx{ysfx_new(config.get())};
+
+        REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+        REQUIRE(ysfx_compile(fx.get(), 0));
+        ysfx_init(fx.get());
+
+        REQUIRE(ysfx_read_var(fx.get(), "bad1") == -1);
+        REQUIRE(ysfx_read_var(fx.get(), "bad2") == -1);
+        REQUIRE(ysfx_read_var(fx.get(), "w1") == 100);
+        REQUIRE(ysfx_read_var(fx.get(), "w2") == 1);
+        REQUIRE(ysfx_read_var(fx.get(), "r1") == 100);
+        REQUIRE(ysfx_read_var(fx.get(), "y") == 42);
+        REQUIRE(ysfx_read_var(fx.get(), "s5") == 0);
+        REQUIRE(ysfx_read_var(fx.get(), "r2") == 2);
+
+        ysfx_real values[100];
+        ysfx_read_vmem(fx.get(), 1000, values, 100);
+        for (uint32_t i = 0; i < 100; ++i)
+            REQUIRE(values[i] == i * 0.25);
+        ysfx_read_vmem(fx.get(), 2000, values, 2);
+        REQUIRE(values[0] == 0.5);
+        REQUIRE(values[1] == -3);
+    };
+
+    SECTION("slider of var")
+    {
+        ysfx_config_u config{ysfx_config_new()};
+        ysfx_u fx{ysfx_new(config.get())};
+
+        for (uint32_t i = 0; i < ysfx_max_sliders; ++i)
+            REQUIRE(ysfx_get_slider_of_var(fx.get(), fx->var.slider[i]) == i);
+        REQUIRE(ysfx_get_slider_of_var(fx.get(), fx->var.spl[0]) == ~(uint32_t)0);
+        REQUIRE(ysfx_get_slider_of_var(fx.get(), fx->var.gfx_r) == ~(uint32_t)0);
+
+        // the storage of the variables starts on a cache line
+        REQUIRE((uintptr_t)fx->var.spl[0] % 64 == 0);
+
+        // the variables of every block are next to each other
+        REQUIRE(fx->var.samplesblock == fx->var.spl[ysfx_fixed_channels - 1] + 2);
+        REQUIRE(fx->var.trigger == fx->var.samplesblock + 1);
+    };
+
+    SECTION("spare strings")
+    {
+        const char *text =
+        "desc:test" "\n"
+        "out_pin:output" "\n"
+        "@init" "\n"
+        "strcpy(1, \"from init\");" "\n"
+        "@block" "\n"
+        "strcpy(2, \"from block\");" "\n";
+
+        scoped_new_dir dir_fx("${root}/Effects");
+        scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+
+        ysfx_config_u config{ysfx_config_new()};
+        ysfx_u fx{ysfx_new(config.get())};
+
+        REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+        REQUIRE(ysfx_compile(fx.get(), 0));
+        ysfx_init(fx.get());
+        REQUIRE(fx->string_pool.spare.size() == ysfx_string_pool_size);
+
+        // the string of @block takes one of the spares
+        float buf[16]{};
+        float *outs[] = {buf};
+        ysfx_process_float(fx.get(), nullptr, outs, 0, 1, 16);
+        REQUIRE(fx->string_pool.spare.size() == ysfx_string_pool_size - 1);
+
+        std::string txt;
+        REQUIRE(ysfx_string_get(fx.get(), 2, txt));
+        REQUIRE(txt == "from block");
+
+        ysfx_init(fx.get());
+        REQUIRE(fx->string_pool.spare.size() == ysfx_string_pool_size);
+    };
+
+    SECTION("reserved strings")
+    {
+        const std::string text =
+        "desc:test" "\n"
+        "out_pin:output" "\n"
+        "@init" "\n"
+        "named = #msg; unnamed = #; user = 3; strcpy(user, \"x\");" "\n"
+        "@block" "\n"
+        "strcpy(#msg, \"" + std::string(100, 'a') + "\"); strcpy(unnamed, #msg); strcat(user, #msg);" "\n";
+
+        scoped_new_dir dir_fx("${root}/Effects");
+        scoped_new_txt file_main("${root}/Effects/example.jsfx", text.c_str());
+
+        ysfx_config_u config{ysfx_config_new()};
+        ysfx_u fx{ysfx_new(config.get())};
+
+        REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+        REQUIRE(ysfx_compile(fx.get(), 0));
+        ysfx_init(fx.get());
+
+        // the buffers are allocated before processing, and stay the same
+        const char *names[] = {"named", "unnamed", "user"};
+        const char *buffers[3] = {};
+        for (uint32_t i = 0; i < 3; ++i) {
+            WDL_FastString *str = nullptr;
+            ysfx_string_access_unlocked(fx.get(), ysfx_read_var(fx.get(), names[i]), &str, false);
+            REQUIRE(str);
+            buffers[i] = str->Get();
+            REQUIRE(buffers[i][0] == (i == 2 ? 'x' : '\0'));
+        }
+
+        float buf[16]{};
+        float *outs[] = {buf};
+        ysfx_process_float(fx.get(), nullptr, outs, 0, 1, 16);
+
+        for (uint32_t i = 0; i < 3; ++i) {
+            WDL_FastString *str = nullptr;
+            ysfx_string_access_unlocked(fx.get(), ysfx_read_var(fx.get(), names[i]), &str, false);
+            REQUIRE(str->GetLength() == (i == 2 ? 101 : 100));
+            REQUIRE(str->Get() == buffers[i]);
+        }
+    };
+
     SECTION("multi_config")
     {
         auto compile_and_check = [](const char *text, uint32_t ref_value, bool want_meter) {
@@ -360,4 +1040,391 @@ TEST_CASE("integration", "[integration]")
         compile_and_check("desc:test" "\noptions:gfx_hz=60\nout_pin:output\n@init\n", 60, true);
         compile_and_check("desc:test" "\noptions:gfx_hz=60\noptions:no_meter\nout_pin:output\n@init\n", 60, false);
     }  
+
+    SECTION("named gmem")
+    {
+        const char *text_writer =
+            "desc:test" "\n"
+            "options:gmem=testbus" "\n"
+            "out_pin:output" "\n"
+            "@init" "\n"
+            "gmem[5] = 42;" "\n"
+            "gmem[2000000] = 7;" "\n";
+
+        const char *text_reader =
+            "desc:test" "\n"
+            "options:gmem=testbus" "\n"
+            "out_pin:output" "\n"
+            "@init" "\n"
+            "x = gmem[5];" "\n"
+            "y = gmem[2000000];" "\n";
+
+        const char *text_other =
+            "desc:test" "\n"
+            "options:gmem=otherbus" "\n"
+            "out_pin:output" "\n"
+            "@init" "\n"
+            "x = gmem[5];" "\n";
+
+        scoped_new_dir dir_fx("${root}/Effects");
+        scoped_new_txt file_writer("${root}/Effects/writer.jsfx", text_writer);
+        scoped_new_txt file_reader("${root}/Effects/reader.jsfx", text_reader);
+        scoped_new_txt file_other("${root}/Effects/other.jsfx", text_other);
+
+        ysfx_config_u config{ysfx_config_new()};
+        auto create = [&config](const std::string &path) -> ysfx_u {
+            ysfx_u fx{ysfx_new(config.get())};
+            REQUIRE(ysfx_load_file(fx.get(), path.c_str(), 0));
+            REQUIRE(ysfx_compile(fx.get(), 0));
+            return fx;
+        };
+
+        ysfx_u writer = create(file_writer.m_path);
+        ysfx_u reader = create(file_reader.m_path);
+        ysfx_u other = create(file_other.m_path);
+
+        ysfx_init(writer.get());
+        ysfx_init(reader.get());
+        ysfx_init(other.get());
+
+        REQUIRE(ysfx_read_var(reader.get(), "x") == 42);
+        REQUIRE(ysfx_read_var(reader.get(), "y") == 7);
+        REQUIRE(ysfx_read_var(other.get(), "x") == 0);
+
+        // the memory lasts while an instance uses it
+        writer.reset();
+        ysfx_init(reader.get());
+        REQUIRE(ysfx_read_var(reader.get(), "x") == 42);
+
+        // it's released with the last instance
+        reader.reset();
+        reader = create(file_reader.m_path);
+        ysfx_init(reader.get());
+        REQUIRE(ysfx_read_var(reader.get(), "x") == 0);
+    }
+
+    SECTION("named gmem backed by a file")
+    {
+        const char *text_writer =
+            "desc:test" "\n"
+            "options:gmem=filebus" "\n"
+            "out_pin:output" "\n"
+            "@init" "\n"
+            "gmem[5] = 42;" "\n"
+            "gmem[70000] = 3;" "\n"
+            "gmem[2000000] = 7;" "\n";
+
+        const char *text_reader =
+            "desc:test" "\n"
+            "options:gmem=filebus" "\n"
+            "out_pin:output" "\n"
+            "@init" "\n"
+            "x = gmem[5];" "\n"
+            "y = gmem[70000];" "\n"
+            "z = gmem[2000000];" "\n";
+
+        scoped_new_dir dir_fx("${root}/Effects");
+        scoped_new_txt file_writer("${root}/Effects/writer.jsfx", text_writer);
+        scoped_new_txt file_reader("${root}/Effects/reader.jsfx", text_reader);
+        scoped_new_txt file_gmem("${root}/Effects/filebus.gmem", "");
+
+        ysfx_config_u config{ysfx_config_new()};
+        ysfx_set_gmem_file(config.get(), "filebus", file_gmem.m_path.c_str(), 70001);
+        auto create = [&config](const std::string &path) -> ysfx_u {
+            ysfx_u fx{ysfx_new(config.get())};
+            REQUIRE(ysfx_load_file(fx.get(), path.c_str(), 0));
+            REQUIRE(ysfx_compile(fx.get(), 0));
+            ysfx_init(fx.get());
+            return fx;
+        };
+
+        // the file has whole blocks of memory
+        create(file_writer.m_path);
+        ysfx::mapped_file mapped;
+        REQUIRE(mapped.open(file_gmem.m_path.c_str()));
+        REQUIRE(mapped.size() == 2 * 65536 * sizeof(ysfx_real));
+        mapped.close();
+
+        // the mapped items outlive the instances, the others do not
+        ysfx_u reader = create(file_reader.m_path);
+        REQUIRE(ysfx_read_var(reader.get(), "x") == 42);
+        REQUIRE(ysfx_read_var(reader.get(), "y") == 3);
+        REQUIRE(ysfx_read_var(reader.get(), "z") == 0);
+
+        // without the file, it starts empty
+        reader.reset();
+        ysfx_set_gmem_file(config.get(), "filebus", nullptr, 0);
+        reader = create(file_reader.m_path);
+        REQUIRE(ysfx_read_var(reader.get(), "x") == 0);
+    }
+
+    SECTION("block math")
+    {
+        // the spans cross the boundaries of the blocks of memory
+        const char *text =
+            "desc:test" "\n"
+            "out_pin:output" "\n"
+            "@init" "\n"
+            "n = 41;" "\n"
+            "a = 65536 - 17; b = 2 * 65536 - 5; c = 3 * 65536 - 7; ref = 400000;" "\n"
+            "h1 = 500000; h2 = 4 * 65536 - 2; q = 600000; st = 600010;" "\n"
+            "i = 0; loop(n + 4, a[i] = sin(i * 0.37) - 0.2; b[i] = cos(i * 0.11) + 0.5; i += 1);" "\n"
+            "h1[0] = h2[0] = 0.1; h1[1] = h2[1] = 0.2; h1[2] = h2[2] = 0.3; h1[3] = h2[3] = -0.1; h1[4] = h2[4] = 0.05;" "\n"
+            "q[0] = 0.2; q[1] = 0.4; q[2] = 0.2; q[3] = -0.5; q[4] = 0.3;" "\n"
+            "function check() local(i, e) (i = 0; e = 0; loop(n, e = max(e, abs(c[i] - ref[i])); i += 1); e);" "\n"
+            "function copy_a() local(i) (i = 0; loop(n, c[i] = a[i]; i += 1));" "\n"
+            // mem_mul
+            "copy_a(); i = 0; loop(n, ref[i] = a[i] * b[i]; i += 1);" "\n"
+            "ret_mul = mem_mul(c, b, n);" "\n"
+            "err_mul = check();" "\n"
+            // mem_mul by memory which is not allocated
+            "copy_a(); i = 0; loop(n, ref[i] = 0; i += 1);" "\n"
+            "mem_mul(c, 6 * 65536 - 3, n);" "\n"
+            "err_mul_zero = check();" "\n"
+            // mem_add_scaled
+            "copy_a(); i = 0; loop(n, ref[i] = a[i] + b[i] * 0.3; i += 1);" "\n"
+            "mem_add_scaled(c, b, 0.3, n);" "\n"
+            "err_add = check();" "\n"
+            // mem_ramp
+            "copy_a(); i = 0; loop(n, ref[i] = a[i] * (0.5 + i / n); i += 1);" "\n"
+            "mem_ramp(c, n, 0.5, 1.5);" "\n"
+            "err_ramp = check();" "\n"
+            // mem_fir, with contiguous coefficients and not
+            "i = 0; loop(n, k = 0; ref[i] = 0; loop(5, ref[i] += h1[k] * a[i + 4 - k]; k += 1); i += 1);" "\n"
+            "mem_fir(c, a, h1, 5, n);" "\n"
+            "err_fir = check();" "\n"
+            "memset(c, 0, n); mem_fir(c, a, h2, 5, n);" "\n"
+            "err_fir_split = check();" "\n"
+            // mem_biquad
+            "s1 = s2 = 0; i = 0;" "\n"
+            "loop(n, x = a[i]; y = q[0] * x + s1; s1 = q[1] * x - q[3] * y + s2; s2 = q[2] * x - q[4] * y; ref[i] = y; i += 1);" "\n"
+            "copy_a(); st[0] = st[1] = 0;" "\n"
+            "mem_biquad(c, n, q, st);" "\n"
+            "err_biquad = max(check(), max(abs(st[0] - s1), abs(st[1] - s2)));" "\n"
+            // reductions
+            "m = 0; e = 0; i = 0; loop(n, m = max(m, abs(a[i])); e += a[i] * a[i]; i += 1);" "\n"
+            "err_abs_max = abs(mem_abs_max(a, n) - m);" "\n"
+            "err_rms = abs(mem_rms(a, n) - sqrt(e / n));" "\n";
+
+        scoped_new_dir dir_fx("${root}/Effects");
+        scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+
+        ysfx_config_u config{ysfx_config_new()};
+        ysfx_u fx{ysfx_new(config.get())};
+        REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+        REQUIRE(ysfx_compile(fx.get(), 0));
+        ysfx_init(fx.get());
+
+        REQUIRE(ysfx_read_var(fx.get(), "ret_mul") == 3 * 65536 - 7);
+        for (const char *name : {"err_mul", "err_mul_zero", "err_add", "err_ramp", "err_fir", "err_fir_split",
+                                 "err_biquad", "err_abs_max", "err_rms"}) {
+            INFO(name);
+            REQUIRE(ysfx_read_var(fx.get(), name) < 1e-12);
+        }
+    }
+
+    SECTION("atomics")
+    {
+        const char *text =
+            "desc:test" "\n"
+            "out_pin:output" "\n"
+            "@init" "\n"
+            "x = 1; m = 65536 - 1;" "\n"
+            "r_add = atomic_add(x, 2.5);" "\n"
+            "r_seteq = atomic_setifequal(x, 3.5, 10);" "\n"
+            "r_setne = atomic_setifequal(x, 3.5, 20);" "\n"
+            "y = 4; r_exch = atomic_exch(x, y);" "\n"
+            "r_set = atomic_set(m[0], -7);" "\n"
+            "atomic_add(m[0], 0.5); r_get = atomic_get(m[0]);" "\n"
+            "r_x = x; r_y = y;" "\n";
+
+        scoped_new_dir dir_fx("${root}/Effects");
+        scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+
+        ysfx_config_u config{ysfx_config_new()};
+        ysfx_u fx{ysfx_new(config.get())};
+        REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+        REQUIRE(ysfx_compile(fx.get(), 0));
+        ysfx_init(fx.get());
+
+        REQUIRE(ysfx_read_var(fx.get(), "r_add") == 3.5);
+        REQUIRE(ysfx_read_var(fx.get(), "r_seteq") == 3.5);
+        REQUIRE(ysfx_read_var(fx.get(), "r_setne") == 10);
+        REQUIRE(ysfx_read_var(fx.get(), "r_exch") == 4);
+        REQUIRE(ysfx_read_var(fx.get(), "r_x") == 4);
+        REQUIRE(ysfx_read_var(fx.get(), "r_y") == 10);
+        REQUIRE(ysfx_read_var(fx.get(), "r_set") == -7);
+        REQUIRE(ysfx_read_var(fx.get(), "r_get") == -6.5);
+    }
+
+    SECTION("indexed spl and slider")
+    {
+        const char *text =
+            "desc:test" "\n"
+            "slider1:0.25<0,1,0.01>the slider 1" "\n"
+            "slider3:alias=3<0,10,1>the slider 3" "\n"
+            "in_pin:input 1" "\n"
+            "in_pin:input 2" "\n"
+            "in_pin:input 3" "\n"
+            "out_pin:output 1" "\n"
+            "out_pin:output 2" "\n"
+            "out_pin:output 3" "\n"
+            "@init" "\n"
+            "ext_nodenorm = 1;" "\n"
+            "s1 = slider(1); s3 = slider(2.9999); s0 = slider(0.5); s65 = slider(65);" "\n"
+            "slider(3) = 7; r_alias = alias;" "\n"
+            "spl(64) = 5; r_out = spl(64); r_neg = spl(-2);" "\n"
+            "@sample" "\n"
+            "ch = 0; loop(num_ch, spl(ch) = spl(ch) * (ch + 1) + spl(ch + 0.99985); ch += 1);" "\n";
+
+        scoped_new_dir dir_fx("${root}/Effects");
+        scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+
+        ysfx_config_u config{ysfx_config_new()};
+        ysfx_u fx{ysfx_new(config.get())};
+        REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+        REQUIRE(ysfx_compile(fx.get(), 0));
+        ysfx_init(fx.get());
+
+        REQUIRE(ysfx_read_var(fx.get(), "s1") == 0.25);
+        REQUIRE(ysfx_read_var(fx.get(), "s3") == 3);
+        REQUIRE(ysfx_read_var(fx.get(), "s0") == 0);
+        REQUIRE(ysfx_read_var(fx.get(), "s65") == 0);
+        REQUIRE(ysfx_read_var(fx.get(), "r_alias") == 7);
+        REQUIRE(ysfx_read_var(fx.get(), "r_out") == 0);
+        REQUIRE(ysfx_read_var(fx.get(), "r_neg") == 0);
+
+        double in[3][4] = {{1, 2, 3, 4}, {5, 6, 7, 8}, {-1, -2, -3, -4}};
+        double out[3][4] = {};
+        const double *ins[] = {in[0], in[1], in[2]};
+        double *outs[] = {out[0], out[1], out[2]};
+        ysfx_process_double(fx.get(), ins, outs, 3, 3, 4);
+
+        // spl(ch + 0.99985) rounds down to the channel itself
+        for (uint32_t i = 0; i < 4; ++i) {
+            REQUIRE(out[0][i] == in[0][i] * 2);
+            REQUIRE(out[1][i] == in[1][i] * 3);
+            REQUIRE(out[2][i] == in[2][i] * 4);
+        }
+    }
+
+    SECTION("partitioned convolution")
+    {
+        // a dense start and a sparse tail, which reach the largest partitions
+        const char *text =
+            "desc:test" "\n"
+            "out_pin:output" "\n"
+            "@init" "\n"
+            "ir = 0; len = 40001; buf1 = 100000; buf2 = 200000; n = 50000;" "\n"
+            "i = 0; loop(3000, ir[i] = sin(i * 0.1) * exp(-i * 0.001); i += 1);" "\n"
+            "ir[len - 1] = 0.5;" "\n"
+            "i = 0; loop(n, buf1[i] = buf2[i] = sin(i * 0.05) + 0.3 * sin(i * 1.7); i += 1);" "\n"
+            "c1 = conv_create(ir, len, 64);" "\n"
+            "c2 = conv_create(ir, len, 64, 1);" "\n"
+            "latency = conv_latency(c1);" "\n"
+            "i = 0; while (i < n) (k = min(37, n - i); conv_process(c1, buf1 + i, k); conv_process(c2, buf2 + i, k); i += k;);" "\n"
+            "freed = conv_free(c1);" "\n"
+            "after_free = conv_process(c1, buf1, 1);" "\n";
+
+        scoped_new_dir dir_fx("${root}/Effects");
+        scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+
+        ysfx_config_u config{ysfx_config_new()};
+        ysfx_u fx{ysfx_new(config.get())};
+        REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+        REQUIRE(ysfx_compile(fx.get(), 0));
+        ysfx_init(fx.get());
+
+        REQUIRE(ysfx_read_var(fx.get(), "c1") == 1);
+        REQUIRE(ysfx_read_var(fx.get(), "c2") == 2);
+        REQUIRE(ysfx_read_var(fx.get(), "latency") == 64);
+        REQUIRE(ysfx_read_var(fx.get(), "freed") == 1);
+        REQUIRE(ysfx_read_var(fx.get(), "after_free") == 0);
+
+        const uint32_t n = 50000, len = 40001, latency = 64;
+        std::vector<ysfx_real> x(n), h(len, 0.0);
+        for (uint32_t i = 0; i < n; ++i)
+            x[i] = std::sin(i * 0.05) + 0.3 * std::sin(i * 1.7);
+        for (uint32_t i = 0; i < 3000; ++i)
+            h[i] = std::sin(i * 0.1) * std::exp(-(double)i * 0.001);
+        h[len - 1] = 0.5;
+
+        std::vector<ysfx_real> out1(n), out2(n);
+        ysfx_read_vmem(fx.get(), 100000, out1.data(), n);
+        ysfx_read_vmem(fx.get(), 200000, out2.data(), n);
+
+        double error1 = 0, error2 = 0;
+        for (uint32_t i = 0; i < n; ++i) {
+            double y = 0;
+            if (i >= latency) {
+                uint32_t t = i - latency;
+                for (uint32_t k = 0; k < 3000 && k <= t; ++k)
+                    y += h[k] * x[t - k];
+                if (t >= len - 1)
+                    y += h[len - 1] * x[t - (len - 1)];
+            }
+            error1 = std::max(error1, std::fabs(out1[i] - y));
+            error2 = std::max(error2, std::fabs(out2[i] - y));
+        }
+        REQUIRE(error1 < 1e-9);
+        REQUIRE(error2 < 1e-9);
+    }
+
+    SECTION("lookahead")
+    {
+        const char *text =
+            "desc:test" "\n"
+            "in_pin:left" "\n"
+            "in_pin:right" "\n"
+            "out_pin:left" "\n"
+            "out_pin:right" "\n"
+            "@init" "\n"
+            "la = la_create(2, 3);" "\n"
+            "latency = la_latency(la);" "\n"
+            "buf = 1000;" "\n"
+            "@block" "\n"
+            "n = 0;" "\n"
+            "@sample" "\n"
+            "buf[2 * n] = spl0; buf[2 * n + 1] = spl1; n += 1;" "\n"
+            "n == samplesblock ? (" "\n"
+            "  pushed = la_push(la, buf, n);" "\n"
+            "  got = la_read(la, buf, n);" "\n"
+            ");" "\n";
+
+        scoped_new_dir dir_fx("${root}/Effects");
+        scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+
+        ysfx_config_u config{ysfx_config_new()};
+        ysfx_u fx{ysfx_new(config.get())};
+        REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+        REQUIRE(ysfx_compile(fx.get(), 0));
+        ysfx_set_block_size(fx.get(), 4);
+        ysfx_init(fx.get());
+
+        REQUIRE(ysfx_read_var(fx.get(), "la") == 1);
+        REQUIRE(ysfx_read_var(fx.get(), "latency") == 3);
+        REQUIRE(ysfx_get_pdc_delay(fx.get()) == 3);
+
+        double in[2][4];
+        double out[2][4];
+        const double *ins[] = {in[0], in[1]};
+        double *outs[] = {out[0], out[1]};
+        for (uint32_t block = 0; block < 3; ++block) {
+            for (uint32_t i = 0; i < 4; ++i) {
+                in[0][i] = 4 * block + i + 1;
+                in[1][i] = -in[0][i];
+            }
+            ysfx_process_double(fx.get(), ins, outs, 2, 2, 4);
+            REQUIRE(ysfx_read_var(fx.get(), "pushed") == 4);
+            REQUIRE(ysfx_read_var(fx.get(), "got") == 4);
+        }
+
+        // the last block, as it comes 3 frames late
+        ysfx_real delayed[8];
+        ysfx_read_vmem(fx.get(), 1000, delayed, 8);
+        for (uint32_t i = 0; i < 4; ++i) {
+            REQUIRE(delayed[2 * i] == 8 + i - 3 + 1);
+            REQUIRE(delayed[2 * i + 1] == -(ysfx_real)(8 + i - 3 + 1));
+        }
+    }
 }
@@ -16,8 +16,11 @@
 //
 
 #include "ysfx.h"
+#include "ysfx_midi.hpp"
 #include "ysfx_test_utils.hpp"
 #include <catch.hpp>
+#include <thread>
+#include <vector>
 #include <cstring>
 
 TEST_CASE("midi input and output", "[midi]")
@@ -269,6 +272,44 @@ TEST_CASE("midi input and output", "[midi]")
         REQUIRE(*b3 == 0x7f);
     }
 
+    SECTION("midirecv from bus")
+    {
+        const char *text =
+            "desc:example" "\n"
+            "out_pin:output" "\n"
+            "@init" "\n"
+            "ext_midi_bus=1;" "\n"
+            "@block" "\n"
+            "midi_bus=1; n1=0; while (midirecv(off, m1, m2, m3)) (n1+=1; last1=m2;);" "\n"
+            "midi_bus=0; n0=0; while (midirecv(off, m1, m2, m3)) (n0+=1; last0=m2;);" "\n";
+
+        scoped_new_dir dir_fx("${root}/Effects");
+        scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+
+        ysfx_config_u config{ysfx_config_new()};
+        ysfx_u fx{ysfx_new(config.get())};
+
+        REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+        REQUIRE(ysfx_compile(fx.get(), 0));
+
+        for (uint32_t i = 0; i < 10; ++i) {
+            const uint8_t data[] = {0x90, (uint8_t)i, 0x40};
+            ysfx_midi_event_t event;
+            event.bus = (i % 3 == 0) ? 1 : 0;
+            event.offset = i;
+            event.size = 3;
+            event.data = data;
+            REQUIRE(ysfx_send_midi(fx.get(), &event));
+        }
+
+        ysfx_process_float(fx.get(), nullptr, nullptr, 0, 0, 30);
+
+        REQUIRE(*ysfx_find_var(fx.get(), "n1") == 4);
+        REQUIRE(*ysfx_find_var(fx.get(), "last1") == 9);
+        REQUIRE(*ysfx_find_var(fx.get(), "n0") == 6);
+        REQUIRE(*ysfx_find_var(fx.get(), "last0") == 8);
+    }
+
     SECTION("midirecv_buf")
     {
         const char *text =
@@ -406,3 +447,580 @@ TEST_CASE("midi input and output", "[midi]")
 
     // TODO test MIDI bus
 }
+
+TEST_CASE("midi buffer capacity", "[midi]")
+{
+    const char *text =
+        "desc:example" "\n"
+        "out_pin:output" "\n"
+        "@init" "\n"
+        "dump = 1000;" "\n"
+        "i = 0; loop(500, dump[i] = i & 0x7f; i += 1);" "\n"
+        "@block" "\n"
+        "midisend(0, 0x90, 60, 0x40);" "\n"
+        "midisyx(10, dump, 500);" "\n"
+        "midisend(20, 0x80, 60, 0);" "\n";
+
+    scoped_new_dir dir_fx("${root}/Effects");
+    scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+
+    ysfx_config_u config{ysfx_config_new()};
+    ysfx_u fx{ysfx_new(config.get())};
+
+    REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+    REQUIRE(ysfx_compile(fx.get(), 0));
+
+    SECTION("sysex pool")
+    {
+        ysfx_set_midi_capacity(fx.get(), 128, false);
+        ysfx_set_midi_sysex_capacity(fx.get(), 1024);
+
+        for (uint32_t cycle = 0; cycle < 2; ++cycle) {
+            ysfx_process_float(fx.get(), nullptr, nullptr, 0, 0, 30);
+
+            ysfx_midi_event_t event;
+            REQUIRE(ysfx_receive_midi(fx.get(), &event));
+            REQUIRE(event.offset == 0);
+            REQUIRE(event.size == 3);
+            REQUIRE(ysfx_receive_midi(fx.get(), &event));
+            REQUIRE(event.offset == 10);
+            REQUIRE(event.size == 502);
+            REQUIRE(event.data[0] == 0xf0);
+            REQUIRE(event.data[1] == 0);
+            REQUIRE(event.data[500] == 499 % 128);
+            REQUIRE(event.data[501] == 0xf7);
+            REQUIRE(ysfx_receive_midi(fx.get(), &event));
+            REQUIRE(event.offset == 20);
+            REQUIRE(event.data[0] == 0x80);
+            REQUIRE(!ysfx_receive_midi(fx.get(), &event));
+        }
+
+        REQUIRE(ysfx_get_midi_overflow(fx.get()) == 0);
+    }
+
+    SECTION("overflow")
+    {
+        ysfx_set_midi_capacity(fx.get(), 128, false);
+
+        ysfx_process_float(fx.get(), nullptr, nullptr, 0, 0, 30);
+
+        ysfx_midi_event_t event;
+        REQUIRE(ysfx_receive_midi(fx.get(), &event));
+        REQUIRE(event.offset == 0);
+        REQUIRE(ysfx_receive_midi(fx.get(), &event));
+        REQUIRE(event.offset == 20);
+        REQUIRE(!ysfx_receive_midi(fx.get(), &event));
+
+        REQUIRE(ysfx_get_midi_overflow(fx.get()) == 1);
+    }
+}
+
+TEST_CASE("midi batch transfer", "[midi]")
+{
+    const char *text =
+        "desc:example" "\n"
+        "out_pin:output" "\n"
+        "@block" "\n"
+        "while (midirecv(off, m1, m2, m3)) (midisend(off, m1, m2 + 1, m3););" "\n";
+
+    scoped_new_dir dir_fx("${root}/Effects");
+    scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+
+    ysfx_config_u config{ysfx_config_new()};
+    ysfx_u fx{ysfx_new(config.get())};
+
+    REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+    REQUIRE(ysfx_compile(fx.get(), 0));
+
+    uint8_t data[10][3];
+    ysfx_midi_event_t events[10];
+    for (uint32_t i = 0; i < 10; ++i) {
+        data[i][0] = 0x90;
+        data[i][1] = (uint8_t)i;
+        data[i][2] = 0x40;
+        events[i].bus = 0;
+        events[i].offset = i;
+        events[i].size = 3;
+        events[i].data = data[i];
+    }
+    REQUIRE(ysfx_send_midi_batch(fx.get(), events, 10) == 10);
+
+    ysfx_process_float(fx.get(), nullptr, nullptr, 0, 0, 30);
+
+    ysfx_midi_event_t received[4];
+    uint32_t total = 0;
+    uint32_t count;
+    while ((count = ysfx_receive_midi_batch(fx.get(), received, 4)) > 0) {
+        REQUIRE(count == (total < 8 ? 4u : 2u));
+        for (uint32_t i = 0; i < count; ++i) {
+            REQUIRE(received[i].offset == total + i);
+            REQUIRE(received[i].size == 3);
+            REQUIRE(received[i].data[1] == total + i + 1);
+        }
+        total += count;
+    }
+    REQUIRE(total == 10);
+}
+
+TEST_CASE("midi output sorting", "[midi]")
+{
+    const char *text =
+        "desc:example" "\n"
+        "out_pin:output" "\n"
+        "@block" "\n"
+        "midisend(20, 0x90, 1, 0x40);" "\n"
+        "midisend(5, 0x90, 2, 0x40);" "\n"
+        "midisend(10, 0x90, 3, 0x40);" "\n"
+        "midisend(5, 0x90, 4, 0x40);" "\n";
+
+    scoped_new_dir dir_fx("${root}/Effects");
+    scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+
+    ysfx_config_u config{ysfx_config_new()};
+    ysfx_u fx{ysfx_new(config.get())};
+
+    REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+    REQUIRE(ysfx_compile(fx.get(), 0));
+
+    SECTION("in order of sending")
+    {
+        ysfx_process_float(fx.get(), nullptr, nullptr, 0, 0, 30);
+
+        ysfx_midi_event_t event;
+        for (uint8_t key : {1, 2, 3, 4}) {
+            REQUIRE(ysfx_receive_midi(fx.get(), &event));
+            REQUIRE(event.data[1] == key);
+        }
+        REQUIRE(!ysfx_receive_midi(fx.get(), &event));
+    }
+
+    SECTION("sorted by offset")
+    {
+        ysfx_set_midi_output_sorted(fx.get(), true);
+        ysfx_process_float(fx.get(), nullptr, nullptr, 0, 0, 30);
+
+        ysfx_midi_event_t event;
+        const uint32_t offsets[] = {5, 5, 10, 20};
+        const uint8_t keys[] = {2, 4, 3, 1};
+        for (uint32_t i = 0; i < 4; ++i) {
+            REQUIRE(ysfx_receive_midi(fx.get(), &event));
+            REQUIRE(event.offset == offsets[i]);
+            REQUIRE(event.data[1] == keys[i]);
+        }
+        REQUIRE(!ysfx_receive_midi(fx.get(), &event));
+    }
+}
+
+TEST_CASE("midi universal packets", "[midi]")
+{
+    scoped_new_dir dir_fx("${root}/Effects");
+
+    SECTION("legacy script receiving packets")
+    {
+        const char *text =
+            "desc:example" "\n"
+            "out_pin:output" "\n"
+            "@block" "\n"
+            "midirecv(aOff, a1, a2, a3);" "\n"
+            "midirecv(bOff, b1, b2, b3);" "\n"
+            "blen = midirecv_buf(cOff, 1000, 100);" "\n";
+
+        scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+
+        ysfx_config_u config{ysfx_config_new()};
+        ysfx_u fx{ysfx_new(config.get())};
+
+        REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+        REQUIRE(ysfx_compile(fx.get(), 0));
+
+        ysfx_ump_event_t event{};
+        // MIDI 1.0 note on
+        event.offset = 1;
+        event.size = 1;
+        event.data[0] = 0x20903c40;
+        REQUIRE(ysfx_send_ump(fx.get(), &event));
+        // utility, no translation
+        event.offset = 2;
+        event.size = 1;
+        event.data[0] = 0x00000000;
+        REQUIRE(ysfx_send_ump(fx.get(), &event));
+        // MIDI 2.0 control change, full value
+        event.offset = 3;
+        event.size = 2;
+        event.data[0] = 0x40b10700;
+        event.data[1] = 0xffffffff;
+        REQUIRE(ysfx_send_ump(fx.get(), &event));
+        // complete 7-bit SysEx
+        event.offset = 4;
+        event.size = 2;
+        event.data[0] = 0x30037e7f;
+        event.data[1] = 0x09000000;
+        REQUIRE(ysfx_send_ump(fx.get(), &event));
+        // wrong size
+        event.size = 1;
+        REQUIRE(!ysfx_send_ump(fx.get(), &event));
+
+        ysfx_process_float(fx.get(), nullptr, nullptr, 0, 0, 30);
+
+        REQUIRE(*ysfx_find_var(fx.get(), "aOff") == 1);
+        REQUIRE(*ysfx_find_var(fx.get(), "a1") == 0x90);
+        REQUIRE(*ysfx_find_var(fx.get(), "a2") == 0x3c);
+        REQUIRE(*ysfx_find_var(fx.get(), "a3") == 0x40);
+        REQUIRE(*ysfx_find_var(fx.get(), "bOff") == 3);
+        REQUIRE(*ysfx_find_var(fx.get(), "b1") == 0xb1);
+        REQUIRE(*ysfx_find_var(fx.get(), "b2") == 7);
+        REQUIRE(*ysfx_find_var(fx.get(), "b3") == 0x7f);
+        REQUIRE(*ysfx_find_var(fx.get(), "cOff") == 4);
+        REQUIRE(*ysfx_find_var(fx.get(), "blen") == 5);
+
+        ysfx_real sysex[5];
+        ysfx_read_vmem(fx.get(), 1000, sysex, 5);
+        REQUIRE(sysex[0] == 0xf0);
+        REQUIRE(sysex[1] == 0x7e);
+        REQUIRE(sysex[2] == 0x7f);
+        REQUIRE(sysex[3] == 0x09);
+        REQUIRE(sysex[4] == 0xf7);
+    }
+
+    SECTION("packets in and out")
+    {
+        const char *text =
+            "desc:example" "\n"
+            "out_pin:output" "\n"
+            "@block" "\n"
+            "n = 0; while ((len = midirecv_ump(off, 1000)) > 0) (n += 1; midisend_ump(off, 1000););" "\n"
+            "midisend(20, 0x80, 0x3c, 0);" "\n";
+
+        scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+
+        ysfx_config_u config{ysfx_config_new()};
+        ysfx_u fx{ysfx_new(config.get())};
+
+        REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+        REQUIRE(ysfx_compile(fx.get(), 0));
+
+        // MIDI 2.0 note on, with a 16-bit velocity
+        ysfx_ump_event_t event{};
+        event.offset = 1;
+        event.size = 2;
+        event.data[0] = 0x40903c00;
+        event.data[1] = 0x12340000;
+        REQUIRE(ysfx_send_ump(fx.get(), &event));
+
+        // a SysEx of 8 bytes of payload, in MIDI 1.0
+        const uint8_t sysex[] = {0xf0, 1, 2, 3, 4, 5, 6, 7, 8, 0xf7};
+        ysfx_midi_event_t midi{};
+        midi.offset = 2;
+        midi.size = sizeof(sysex);
+        midi.data = sysex;
+        REQUIRE(ysfx_send_midi(fx.get(), &midi));
+
+        ysfx_process_float(fx.get(), nullptr, nullptr, 0, 0, 30);
+
+        REQUIRE(*ysfx_find_var(fx.get(), "n") == 3);
+
+        REQUIRE(ysfx_receive_ump(fx.get(), &event));
+        REQUIRE(event.offset == 1);
+        REQUIRE(event.size == 2);
+        REQUIRE(event.data[0] == 0x40903c00);
+        REQUIRE(event.data[1] == 0x12340000);
+
+        REQUIRE(ysfx_receive_ump(fx.get(), &event));
+        REQUIRE(event.offset == 2);
+        REQUIRE(event.size == 2);
+        REQUIRE(event.data[0] == 0x30160102);
+        REQUIRE(event.data[1] == 0x03040506);
+
+        REQUIRE(ysfx_receive_ump(fx.get(), &event));
+        REQUIRE(event.size == 2);
+        REQUIRE(event.data[0] == 0x30320708);
+        REQUIRE(event.data[1] == 0);
+
+        REQUIRE(ysfx_receive_ump(fx.get(), &event));
+        REQUIRE(event.offset == 20);
+        REQUIRE(event.size == 1);
+        REQUIRE(event.data[0] == 0x20803c00);
+
+        REQUIRE(!ysfx_receive_ump(fx.get(), &event));
+    }
+}
+
+TEST_CASE("midi section", "[midi]")
+{
+    scoped_new_dir dir_fx("${root}/Effects");
+
+    const uint32_t offsets[] = {0, 5, 5, 12, 40};
+    auto send_events = [&offsets](ysfx_t *fx) {
+        for (uint32_t i = 0; i < 5; ++i) {
+            const uint8_t data[] = {0x90, (uint8_t)(60 + i), 0x40};
+            ysfx_midi_event_t event{};
+            event.offset = offsets[i];
+            event.size = 3;
+            event.data = data;
+            REQUIRE(ysfx_send_midi(fx, &event));
+        }
+    };
+
+    SECTION("before the sample of the event")
+    {
+        const char *text =
+            "desc:example" "\n"
+            "out_pin:output" "\n"
+            "@init" "\n"
+            "at = 1000; key = 2000;" "\n"
+            "@block" "\n"
+            "pos = 0; n = 0;" "\n"
+            "@midi" "\n"
+            "midirecv(off, m1, m2, m3) ? (at[n] = pos; key[n] = m2; n += 1;);" "\n"
+            "@sample" "\n"
+            "pos += 1;" "\n";
+
+        scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+
+        ysfx_config_u config{ysfx_config_new()};
+        ysfx_u fx{ysfx_new(config.get())};
+
+        REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+        REQUIRE(ysfx_compile(fx.get(), 0));
+        REQUIRE(ysfx_has_section(fx.get(), ysfx_section_midi));
+
+        send_events(fx.get());
+        ysfx_process_float(fx.get(), nullptr, nullptr, 0, 0, 30);
+
+        REQUIRE(*ysfx_find_var(fx.get(), "n") == 5);
+        ysfx_real at[5];
+        ysfx_real key[5];
+        ysfx_read_vmem(fx.get(), 1000, at, 5);
+        ysfx_read_vmem(fx.get(), 2000, key, 5);
+        const ysfx_real expected_at[] = {0, 5, 5, 12, 30};
+        for (uint32_t i = 0; i < 5; ++i) {
+            REQUIRE(at[i] == expected_at[i]);
+            REQUIRE(key[i] == 60 + i);
+        }
+    }
+
+    SECTION("without @sample")
+    {
+        const char *text =
+            "desc:example" "\n"
+            "out_pin:output" "\n"
+            "@block" "\n"
+            "n = 0;" "\n"
+            "@midi" "\n"
+            "midirecv(off, m1, m2, m3) ? (n += 1; last = off;);" "\n"
+            "midirecv(off, m1, m2, m3) ? (n += 100;);" "\n";
+
+        scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+
+        ysfx_config_u config{ysfx_config_new()};
+        ysfx_u fx{ysfx_new(config.get())};
+
+        REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+        REQUIRE(ysfx_compile(fx.get(), 0));
+
+        send_events(fx.get());
+        ysfx_process_float(fx.get(), nullptr, nullptr, 0, 0, 30);
+
+        REQUIRE(*ysfx_find_var(fx.get(), "n") == 5);
+        REQUIRE(*ysfx_find_var(fx.get(), "last") == 40);
+    }
+}
+
+TEST_CASE("midi buffer encoding", "[midi]")
+{
+    ysfx_midi_buffer_t midi;
+    ysfx_midi_reserve(&midi, 64 * 1024, false);
+
+    std::vector<uint8_t> large(300);
+    for (size_t i = 0; i < large.size(); ++i)
+        large[i] = (uint8_t)i;
+    const uint8_t small[] = {0xb0, 7, 100};
+
+    ysfx_midi_event_t event{};
+    for (uint32_t i = 0; i < 1000; ++i) {
+        event.bus = i % ysfx_max_midi_buses;
+        event.offset = i;
+        event.size = sizeof(small);
+        event.data = small;
+        REQUIRE(ysfx_midi_push(&midi, &event));
+    }
+    // a short message takes a 5-byte header
+    REQUIRE(midi.data.size() == 1000 * (5 + sizeof(small)));
+
+    event.bus = 3;
+    event.offset = 1u << 30;
+    event.size = (uint32_t)large.size();
+    event.data = large.data();
+    REQUIRE(ysfx_midi_push(&midi, &event));
+
+    for (uint32_t i = 0; i < 1000; ++i) {
+        REQUIRE(ysfx_midi_get_next(&midi, &event));
+        REQUIRE(event.bus == i % ysfx_max_midi_buses);
+        REQUIRE(event.offset == i);
+        REQUIRE(event.size == sizeof(small));
+        REQUIRE(memcmp(event.data, small, sizeof(small)) == 0);
+    }
+    REQUIRE(ysfx_midi_get_next(&midi, &event));
+    REQUIRE(event.bus == 3);
+    REQUIRE(event.offset == ysfx_midi_offset_max);
+    REQUIRE(event.size == large.size());
+    REQUIRE(memcmp(event.data, large.data(), large.size()) == 0);
+    REQUIRE(!ysfx_midi_get_next(&midi, &event));
+
+    // the size of the incremental writer is patched after the data
+    ysfx_midi_clear(&midi);
+    ysfx_midi_push_t mp;
+    REQUIRE(ysfx_midi_push_begin(&midi, 1, 10, &mp));
+    REQUIRE(ysfx_midi_push_data(&mp, large.data(), (uint32_t)large.size()));
+    REQUIRE(ysfx_midi_push_end(&mp));
+    REQUIRE(ysfx_midi_get_next_from_bus(&midi, 1, &event));
+    REQUIRE(event.offset == 10);
+    REQUIRE(event.size == large.size());
+    REQUIRE(memcmp(event.data, large.data(), large.size()) == 0);
+}
+
+TEST_CASE("midi posting from other threads", "[midi]")
+{
+    const char *text =
+        "desc:example" "\n"
+        "out_pin:output" "\n"
+        "@block" "\n"
+        "while (midirecv(off, m1, m2, m3)) (midisend(off, m1, m2, m3););" "\n";
+
+    scoped_new_dir dir_fx("${root}/Effects");
+    scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+
+    ysfx_config_u config{ysfx_config_new()};
+    ysfx_u fx{ysfx_new(config.get())};
+
+    REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+    REQUIRE(ysfx_compile(fx.get(), 0));
+
+    const uint8_t msg[3] = {0x90, 60, 0x40};
+    ysfx_midi_event_t event{0, 5, 3, msg};
+
+    SECTION("disabled")
+    {
+        REQUIRE(!ysfx_post_midi(fx.get(), &event));
+    }
+
+    SECTION("limits")
+    {
+        ysfx_set_midi_queue_capacity(fx.get(), 3);
+        const uint8_t large[17] = {0xf0};
+        ysfx_midi_event_t large_event{0, 0, 17, large};
+        REQUIRE(!ysfx_post_midi(fx.get(), &large_event));
+        for (uint32_t i = 0; i < 4; ++i)
+            REQUIRE(ysfx_post_midi(fx.get(), &event));
+        REQUIRE(!ysfx_post_midi(fx.get(), &event));
+        REQUIRE(ysfx_get_midi_overflow(fx.get()) == 1);
+
+        ysfx_process_float(fx.get(), nullptr, nullptr, 0, 0, 30);
+        uint32_t count = 0;
+        ysfx_midi_event_t received;
+        while (ysfx_receive_midi(fx.get(), &received)) {
+            REQUIRE(received.offset == 5);
+            REQUIRE(received.size == 3);
+            REQUIRE(memcmp(received.data, msg, 3) == 0);
+            ++count;
+        }
+        REQUIRE(count == 4);
+        REQUIRE(ysfx_post_midi(fx.get(), &event));
+    }
+
+    SECTION("concurrent")
+    {
+        const uint32_t num_threads = 4;
+        const uint32_t num_events = 1000;
+        ysfx_set_midi_queue_capacity(fx.get(), 64);
+
+        std::vector<std::thread> threads;
+        for (uint32_t t = 0; t < num_threads; ++t) {
+            threads.emplace_back([&fx, t]() {
+                for (uint32_t i = 0; i < num_events; ++i) {
+                    uint8_t data[3] = {(uint8_t)(0x90 + t), (uint8_t)(i & 0x7f), (uint8_t)(i >> 7)};
+                    ysfx_midi_event_t event{0, 0, 3, data};
+                    while (!ysfx_post_midi(fx.get(), &event))
+                        std::this_thread::yield();
+                }
+            });
+        }
+
+        uint32_t next[num_threads] = {};
+        uint32_t total = 0;
+        while (total < num_threads * num_events) {
+            ysfx_process_float(fx.get(), nullptr, nullptr, 0, 0, 30);
+            ysfx_midi_event_t received;
+            while (ysfx_receive_midi(fx.get(), &received)) {
+                uint32_t t = received.data[0] - 0x90;
+                REQUIRE(t < num_threads);
+                // the events of each thread arrive in their order
+                REQUIRE((uint32_t)(received.data[1] + (received.data[2] << 7)) == next[t]);
+                ++next[t];
+                ++total;
+            }
+        }
+
+        for (std::thread &thread : threads)
+            thread.join();
+        REQUIRE(total == num_threads * num_events);
+    }
+}
+
+TEST_CASE("midi output deduplication", "[midi]")
+{
+    const char *text =
+        "desc:example" "\n"
+        "out_pin:output" "\n"
+        "@block" "\n"
+        "midisend(0, 0xb0, 7, 100);" "\n"
+        "midisend(1, 0xb0, 7, 100);" "\n"
+        "midisend(2, 0xb1, 7, 100);" "\n"
+        "midisend(3, 0x90, 60, 0x40);" "\n"
+        "midisend(4, 0x90, 60, 0x40);" "\n"
+        "midisend(5, 0xe0, 0, 64);" "\n"
+        "midisend(6, 0xe0, 0, 64);" "\n"
+        "midisend(7, 0xb0, 7, 101);" "\n"
+        "midisend(8, 0xb0, 7, 102);" "\n"
+        "midisend(9, 0xb0, 7, 103);" "\n"
+        "midisend(10, 0xb0, 7, 103);" "\n";
+
+    scoped_new_dir dir_fx("${root}/Effects");
+    scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+
+    ysfx_config_u config{ysfx_config_new()};
+    ysfx_u fx{ysfx_new(config.get())};
+
+    REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+    REQUIRE(ysfx_compile(fx.get(), 0));
+
+    std::vector<uint32_t> offsets;
+    auto receive = [&fx, &offsets]() {
+        offsets.clear();
+        ysfx_process_float(fx.get(), nullptr, nullptr, 0, 0, 30);
+        ysfx_midi_event_t event;
+        while (ysfx_receive_midi(fx.get(), &event))
+            offsets.push_back(event.offset);
+    };
+
+    SECTION("disabled")
+    {
+        receive();
+        REQUIRE(offsets.size() == 11);
+    }
+
+    SECTION("repeated values")
+    {
+        ysfx_set_midi_output_deduplicated(fx.get(), true, 0);
+        receive();
+        REQUIRE(offsets == std::vector<uint32_t>{0, 2, 3, 4, 5, 7, 8, 9});
+    }
+
+    SECTION("minimum interval")
+    {
+        ysfx_set_midi_output_deduplicated(fx.get(), true, 4);
+        receive();
+        // the values at 8 and 9 are too close to the one at 7, but the last is kept
+        REQUIRE(offsets == std::vector<uint32_t>{0, 2, 3, 4, 5, 7, 10});
+    }
+}
@@ -0,0 +1,117 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "ysfx.h"
+#include "ysfx_package.hpp"
+#include "ysfx_test_utils.hpp"
+#include <catch.hpp>
+#include <string>
+
+TEST_CASE("single-file packages", "[package]")
+{
+    const char *text =
+        "desc:Packaged effect" "\n"
+        "author:Someone" "\n"
+        "import helper.jsfx-inc" "\n"
+        "filename:0,data/numbers.txt" "\n"
+        "slider1:0<0,10,1>the slider 1" "\n"
+        "out_pin:output" "\n"
+        "@init" "\n"
+        "h = file_open(0);" "\n"
+        "n = file_mem(h, 0, 10);" "\n"
+        "file_close(h);" "\n"
+        "@sample" "\n"
+        "spl0 = helper();" "\n";
+
+    const char *helper =
+        "@init" "\n"
+        "function helper() ( 0.25 );" "\n";
+
+    // the long runs deflate
+    std::string numbers;
+    for (int i = 0; i < 100; ++i)
+        numbers.append("1, 2, 3, 4, 5\n");
+
+    scoped_new_dir dir_src("${root}/Source");
+    scoped_new_txt file_main("${root}/Source/example.jsfx", text);
+    scoped_new_dir dir_lib("${root}/Source/lib");
+    scoped_new_txt file_helper("${root}/Source/lib/helper.jsfx-inc", helper);
+    scoped_new_dir dir_data("${root}/Source/data");
+    scoped_new_txt file_numbers("${root}/Source/data/numbers.txt", numbers.c_str());
+
+    // the package replaces this file, which is removed at the end
+    scoped_new_dir dir_pkg("${root}/Packages");
+    scoped_new_txt file_pkg("${root}/Packages/example.ysfxpkg", "");
+
+    bool compress = GENERATE(false, true);
+    REQUIRE(ysfx_package_create(file_pkg.m_path.c_str(), dir_src.m_path.c_str(), "example.jsfx", compress));
+
+    SECTION("entries")
+    {
+        ysfx_package_sp package = ysfx_package_find(file_pkg.m_path);
+        REQUIRE(package);
+        REQUIRE(package->main == "example.jsfx");
+        REQUIRE(package->entries.size() == 3);
+        REQUIRE(package->find("LIB/Helper.jsfx-inc"));
+        REQUIRE(package->search("", "helper.jsfx-inc") == package->find("lib/helper.jsfx-inc"));
+        REQUIRE(package->has_directory("data"));
+        REQUIRE(!package->has_directory("other"));
+
+        ysfx::string_list root = package->list_directory("");
+        REQUIRE(root == ysfx::string_list{"data/", "example.jsfx", "lib/"});
+
+        const ysfx_package_entry_t *entry = package->find("data/numbers.txt");
+        REQUIRE(entry);
+        REQUIRE(entry->method == (compress ? ysfx_package_deflated : ysfx_package_stored));
+
+        ysfx_package_data_sp data = ysfx_package_read(file_pkg.m_path + "/data/numbers.txt");
+        REQUIRE(data);
+        REQUIRE(std::string((const char *)data->data, data->size) == numbers);
+
+        REQUIRE(!ysfx_package_read(file_pkg.m_path + "/data/missing.txt"));
+        REQUIRE(!ysfx_package_find(file_main.m_path));
+    }
+
+    SECTION("load and process")
+    {
+        ysfx_config_u config{ysfx_config_new()};
+        ysfx_u fx{ysfx_new(config.get())};
+
+        REQUIRE(ysfx_load_file(fx.get(), file_pkg.m_path.c_str(), 0));
+        REQUIRE(std::string(ysfx_get_name(fx.get())) == "Packaged effect");
+        REQUIRE(ysfx_compile(fx.get(), 0));
+        ysfx_init(fx.get());
+
+        REQUIRE(ysfx_read_var(fx.get(), "n") == 10);
+
+        float out[4] = {};
+        float *outs[] = {out};
+        ysfx_process_float(fx.get(), nullptr, outs, 0, 1, 4);
+        REQUIRE(out[3] == 0.25f);
+    }
+
+    SECTION("scan")
+    {
+        ysfx_config_u config{ysfx_config_new()};
+        ysfx_scan_u scan{ysfx_scan_header(config.get(), file_pkg.m_path.c_str())};
+        REQUIRE(scan);
+        REQUIRE(std::string(ysfx_scan_get_name(scan.get())) == "Packaged effect");
+        REQUIRE(std::string(ysfx_scan_get_author(scan.get())) == "Someone");
+        REQUIRE(ysfx_scan_slider_exists(scan.get(), 0));
+        REQUIRE(ysfx_scan_get_num_outputs(scan.get()) == 1);
+    }
+}
@@ -25,6 +25,10 @@
 #include <catch.hpp>
 #include <map>
 #include <string>
+#include <cmath>
+#include <vector>
+#include <string_view>
+#include <cstdio>
 
 TEST_CASE("preprocessor", "[basic]")
 {
@@ -105,6 +109,65 @@ TEST_CASE("preprocessor", "[basic]")
         processed_reader.read_next_line(line);
         REQUIRE(line == "@block");
     }
+
+    SECTION("preprocessor without code blocks")
+    {
+        const char *text =
+            "// the header" "\r\n"
+            "@init" "\r"
+            "c = 1 < 2;" "\n"
+            "\n"
+            "@block";
+
+        ysfx::string_text_reader raw_reader(text);
+
+        ysfx_parse_error err;
+        std::string processed_str;
+        std::map<std::string, ysfx_real> preprocessor_values;
+        REQUIRE(ysfx_preprocess(raw_reader, &err, processed_str, preprocessor_values));
+        REQUIRE(!err);
+        REQUIRE(processed_str == "// the header\n@init\nc = 1 < 2;\n\n@block\n");
+    }
+}
+
+TEST_CASE("text reading", "[parse]")
+{
+    // long enough to span the blocks of the file
+    std::string text = "first\r\nsecond\rthird\n\n";
+    text.append(100000, 'x');
+    text.append("\r\nlast");
+    std::vector<std::string> expected{"first", "second", "third", "", std::string(100000, 'x'), "last"};
+
+    auto read_all = [](ysfx::text_reader &reader) -> std::vector<std::string> {
+        std::vector<std::string> lines;
+        std::string_view line;
+        while (reader.read_next_line(line))
+            lines.emplace_back(line);
+        return lines;
+    };
+
+    SECTION("string")
+    {
+        ysfx::string_text_reader reader(text.c_str());
+        REQUIRE(read_all(reader) == expected);
+        reader.rewind();
+        REQUIRE(read_all(reader) == expected);
+    }
+
+    SECTION("file")
+    {
+        ysfx::FILE_u stream{tmpfile()};
+        REQUIRE(stream);
+        // the text ends at a null character
+        fwrite(text.data(), 1, text.size() + 1, stream.get());
+        fputs("ignored\n", stream.get());
+        rewind(stream.get());
+
+        ysfx::stdio_text_reader reader(stream.get());
+        REQUIRE(read_all(reader) == expected);
+        reader.rewind();
+        REQUIRE(read_all(reader) == expected);
+    }
 }
 
 TEST_CASE("section splitting", "[parse]")
@@ -387,6 +450,68 @@ static void ensure_path_slider(const ysfx_slider_t &slider, int32_t id, const st
         REQUIRE(!slider.path.empty());
 }
 
+TEST_CASE("number parsing", "[parse]")
+{
+    auto parse = [](const char *text, size_t *length) -> double {
+        char *endp = nullptr;
+        double value = ysfx::dot_strtod(text, &endp);
+        *length = (size_t)(endp - text);
+        return value;
+    };
+    size_t length;
+
+    SECTION("short decimals")
+    {
+        REQUIRE(parse("  -12.5e1,", &length) == -125);
+        REQUIRE(length == 9);
+        REQUIRE(parse(".25", &length) == 0.25);
+        REQUIRE(length == 3);
+        REQUIRE(parse("3.", &length) == 3);
+        REQUIRE(length == 2);
+        REQUIRE(parse("7e", &length) == 7);
+        REQUIRE(length == 1);
+        REQUIRE(ysfx::dot_atof("0.1") == 0.1);
+    }
+
+    SECTION("long decimals, rounded as the C library")
+    {
+        REQUIRE(parse("3.141592653589793238462643383279", &length) == 3.141592653589793);
+        REQUIRE(length == 32);
+        REQUIRE(parse("123456789012345678901234567890", &length) == 123456789012345678901234567890.0);
+        REQUIRE(parse("2.2250738585072014e-308", &length) == 2.2250738585072014e-308);
+        REQUIRE(parse("1.7976931348623157e308", &length) == 1.7976931348623157e308);
+        // halfway between 2 doubles, and just above
+        REQUIRE(parse("9007199254740993", &length) == 9007199254740992.0);
+        REQUIRE(parse("9007199254740993.0000000001", &length) == 9007199254740994.0);
+    }
+
+    SECTION("numbers for the C library")
+    {
+        REQUIRE(parse("0x10", &length) == 16);
+        REQUIRE(length == 4);
+        REQUIRE(parse("-inf", &length) == -HUGE_VAL);
+        REQUIRE(parse("4.9e-324", &length) == 4.9e-324);
+    }
+
+    SECTION("not numbers")
+    {
+        REQUIRE(parse("abc", &length) == 0);
+        REQUIRE(length == 0);
+        REQUIRE(parse("-.e1", &length) == 0);
+        REQUIRE(length == 0);
+        REQUIRE(ysfx::dot_atof("") == 0);
+    }
+
+    SECTION("ranges without a terminator")
+    {
+        const char *text = "1.5e3";
+        double value = 0;
+        REQUIRE(ysfx::dot_parse_number(text, text + 3, value) == text + 3);
+        REQUIRE(value == 1.5);
+        REQUIRE(ysfx::dot_parse_number(text, text, value) == text);
+    }
+}
+
 TEST_CASE("slider parsing", "[parse]")
 {
     SECTION("minimal range syntax")
@@ -765,6 +890,7 @@ TEST_CASE("header parsing", "[parse]")
         REQUIRE(header.out_pins[0] == "The output 1");
         REQUIRE(header.out_pins[1] == "The output 2");
         REQUIRE(header.sliders[42].exists);
+        REQUIRE(header.slider_indices == std::vector<uint32_t>{42});
         REQUIRE(header.imports.size() == 1);
         REQUIRE(header.imports[0] == "foo.jsfx-inc");
     }
@@ -95,6 +95,157 @@ TEST_CASE("preset handling", "[preset]")
         validatePreset(&bank->presets[3], ">", ">", 1.0f, 0.9f, 0.8f, 0.8f, 0.9f, 1.0f);
     }
 
+    SECTION("Bank index")
+    {
+        const char *rpl_text =
+            "<REAPER_PRESET_LIBRARY \"JS: TestCaseRPL\"" "\n"
+            "  <PRESET `1.defaults`" "\n"
+            "    MCAwIC0gMCAtIC0gLSAtIC0gLSAtIC0gLSAtIC0gLSAtIC0gLSAtIC0gLSAtIC0gLSAtIC0gLSAtIC0gLSAtIC0gLSAtIC0gLSAtIC0gLSAtIC0gLSAtIC0gLSAtIC0g" "\n"
+            "    LSAtIC0gLSAtIC0gLSAtIC0gLSAtIC0gLSAtIC0gLSAxLmRlZmF1bHRzAAAAAAAAAAAAAAAAAA==" "\n"
+            "  >" "\n"
+            "  <PRESET `2.a preset with spaces in the name`" "\n"
+            "    MC4zNCAwLjc1IC0gMC42MiAtIC0gLSAtIC0gLSAtIC0gLSAtIC0gLSAtIC0gLSAtIC0gLSAtIC0gLSAtIC0gLSAtIC0gLSAtIC0gLSAtIC0gLSAtIC0gLSAtIC0gLSAt" "\n"
+            "    IC0gLSAtIC0gLSAtIC0gLSAtIC0gLSAtIC0gLSAtIC0gLSAtIC0gLSAiMi5hIHByZXNldCB3aXRoIHNwYWNlcyBpbiB0aGUgbmFtZSIAUrgePwAAQD97FK4+" "\n"
+            "  >" "\n"
+            ">" "\n";
+
+        scoped_new_dir dir_fx("${root}/Effects");
+        scoped_new_txt file_rpl("${root}/Effects/example.jsfx.rpl", rpl_text);
+        scoped_new_txt file_index("${root}/Effects/example.jsfx.rpl.index", "");
+
+        for (int pass = 0; pass < 2; ++pass) {
+            // the first pass scans the bank and writes the index, the second reads it
+            ysfx_bank_u bank{ysfx_load_bank_index(file_rpl.m_path.c_str(), file_index.m_path.c_str())};
+            REQUIRE(bank);
+            REQUIRE(!strcmp(bank->name, "JS: TestCaseRPL"));
+            REQUIRE(bank->preset_count == 2);
+            REQUIRE(!strcmp(bank->presets[0].name, "1.defaults"));
+            REQUIRE(!strcmp(bank->presets[1].name, "2.a preset with spaces in the name"));
+            REQUIRE(bank->presets[0].state == nullptr);
+            REQUIRE(bank->presets[1].state == nullptr);
+
+            validatePreset(ysfx_bank_get_preset(bank.get(), 1), "2.a preset with spaces in the name", "\"2.a preset with spaces in the name\"", 0.34f, 0.75f, 0.62f, 0.62f, 0.75f, 0.34f);
+            REQUIRE(bank->presets[0].state == nullptr);
+
+            // the copies keep the presets which are not decoded yet
+            ysfx_bank_u renamed{ysfx_rename_preset_from_bank(bank.get(), "2.a preset with spaces in the name", "renamed")};
+            REQUIRE(renamed->presets[0].state == nullptr);
+            validatePreset(ysfx_bank_get_preset(renamed.get(), 0), "1.defaults", "1.defaults", 0.0, 0.0, 0.0, 0.0, 0.0, 0.0);
+            REQUIRE(!strcmp(renamed->presets[1].name, "renamed"));
+        }
+
+        // an index of another version of the bank is not used
+        {
+            std::string text = rpl_text;
+            text.insert(text.size() - 2, "  <PRESET `3.more`" "\n" "  >" "\n");
+            ysfx::FILE_u stream{ysfx::fopen_utf8(file_rpl.m_path.c_str(), "wb")};
+            REQUIRE(fwrite(text.data(), 1, text.size(), stream.get()) == text.size());
+        }
+        ysfx_bank_u bank{ysfx_load_bank_index(file_rpl.m_path.c_str(), file_index.m_path.c_str())};
+        REQUIRE(bank);
+        REQUIRE(bank->preset_count == 3);
+        REQUIRE(!strcmp(bank->presets[2].name, "3.more"));
+        REQUIRE(ysfx_bank_get_preset(bank.get(), 2)->state->data_size == 0);
+    }
+
+    SECTION("Binary bank")
+    {
+        ysfx_state_slider_t sliders[] = {{0, 0.1}, {3, 1.0 / 3.0}};
+        uint8_t data[] = {1, 2, 3, 0, 5};
+        ysfx_state_t state{sliders, 2, data, sizeof(data), 64};
+
+        ysfx_bank_u bank{ysfx_create_empty_bank("JS: TestCaseBinary")};
+        bank.reset(ysfx_add_preset_to_bank(bank.get(), "with data", ysfx_state_dup(&state)));
+        state.data_size = 0;
+        bank.reset(ysfx_add_preset_to_bank(bank.get(), "sliders only", ysfx_state_dup(&state)));
+
+        scoped_new_dir dir_fx("${root}/Effects");
+        scoped_new_txt file_bank("${root}/Effects/example.ysfxbank", "");
+        REQUIRE(ysfx_save_bank_binary(file_bank.m_path.c_str(), bank.get()));
+
+        ysfx_bank_u loaded{ysfx_load_bank(file_bank.m_path.c_str())};
+        REQUIRE(loaded);
+        REQUIRE(!strcmp(loaded->name, "JS: TestCaseBinary"));
+        REQUIRE(loaded->preset_count == 2);
+        for (uint32_t i = 0; i < 2; ++i) {
+            REQUIRE(!strcmp(loaded->presets[i].name, bank->presets[i].name));
+            REQUIRE(!strcmp(loaded->presets[i].blob_name, bank->presets[i].blob_name));
+            ysfx_state_t *a = loaded->presets[i].state;
+            ysfx_state_t *b = bank->presets[i].state;
+            REQUIRE(a->slider_count == b->slider_count);
+            for (uint32_t j = 0; j < a->slider_count; ++j) {
+                REQUIRE(a->sliders[j].index == b->sliders[j].index);
+                // the doubles come back exactly
+                REQUIRE(a->sliders[j].value == b->sliders[j].value);
+            }
+            REQUIRE(a->data_size == b->data_size);
+            REQUIRE(!memcmp(a->data, b->data, a->data_size));
+            REQUIRE(a->mem_high_water == 64);
+        }
+        REQUIRE(loaded->presets[0].state->sliders[1].value == 1.0 / 3.0);
+
+        // the index loader recognizes it too, and the bank can go back to RPL
+        loaded.reset(ysfx_load_bank_index(file_bank.m_path.c_str(), nullptr));
+        REQUIRE(loaded);
+        REQUIRE(loaded->preset_count == 2);
+        scoped_new_txt file_rpl("${root}/Effects/example.jsfx.rpl", "");
+        REQUIRE(ysfx_save_bank(file_rpl.m_path.c_str(), loaded.get()));
+        loaded.reset(ysfx_load_bank(file_rpl.m_path.c_str()));
+        REQUIRE(loaded);
+        REQUIRE(loaded->preset_count == 2);
+        REQUIRE(loaded->presets[1].state->data_size == 0);
+
+        // a cut file does not load
+        std::string whole;
+        {
+            ysfx::FILE_u stream{ysfx::fopen_utf8(file_bank.m_path.c_str(), "rb")};
+            char buf[256];
+            for (size_t n; (n = fread(buf, 1, sizeof(buf), stream.get())) > 0; )
+                whole.append(buf, n);
+        }
+        {
+            ysfx::FILE_u stream{ysfx::fopen_utf8(file_bank.m_path.c_str(), "wb")};
+            REQUIRE(fwrite(whole.data(), 1, whole.size() - 1, stream.get()) == whole.size() - 1);
+        }
+        REQUIRE(!ysfx_bank_u{ysfx_load_bank(file_bank.m_path.c_str())});
+    }
+
+    SECTION("State hashes")
+    {
+        ysfx_state_slider_t sliders[] = {{0, 0.1}, {3, 1.0 / 3.0}};
+        uint8_t data[] = {1, 2, 3, 0, 5};
+        ysfx_state_t state{sliders, 2, data, sizeof(data), 64};
+
+        ysfx_state_u copy{ysfx_state_dup(&state)};
+        uint64_t hash = ysfx_state_hash(&state);
+        REQUIRE(hash != 0);
+        REQUIRE(state.hash == hash);
+        REQUIRE(copy->hash == 0);
+        REQUIRE(ysfx_state_hash(copy.get()) == hash);
+
+        // a modified state has its hash reset
+        ysfx_state_u other{ysfx_state_dup(&state)};
+        other->sliders[1].value = 0.5;
+        REQUIRE(ysfx_state_hash(other.get()) != hash);
+        REQUIRE(!ysfx_is_state_equal(other.get(), &state));
+        other->sliders[1].value = 1.0 / 3.0;
+        other->data[4] = 6;
+        other->hash = 0;
+        REQUIRE(ysfx_state_hash(other.get()) != hash);
+
+        ysfx_bank_u bank{ysfx_create_empty_bank("JS: TestCaseHashes")};
+        bank.reset(ysfx_add_preset_to_bank(bank.get(), "other", other.release()));
+        bank.reset(ysfx_add_preset_to_bank(bank.get(), "same", copy.release()));
+        REQUIRE(ysfx_bank_find_state(bank.get(), &state) == 2);
+        // again, with the hashes of the presets cached
+        REQUIRE(ysfx_bank_find_state(bank.get(), &state) == 2);
+        state.sliders[0].value = 0.2;
+        state.hash = 0;
+        REQUIRE(ysfx_bank_find_state(bank.get(), &state) == 0);
+        state.sliders[0].value = 0.1;
+        state.hash = 0;
+    }
+
     SECTION("Store preset in bank")
     {
         const char *source_text =
@@ -146,9 +297,17 @@ TEST_CASE("preset handling", "[preset]")
         validatePreset(&new_bank->presets[0], "1.defaults", "1.defaults", 0.0, 0.0, 0.0, 0.0, 0.0, 0.0);
         validatePreset(&new_bank->presets[1], "added preset", "\"added preset\"", 5.0f, 0.0f, 1337.0f, 0.0f, 1337.0f, 0.0f);
 
-        // Validate that the banks don't point to the same memory (it should have made its own copy)
-        REQUIRE(new_bank->presets[0].name != bank->presets[0].name);
-        REQUIRE(new_bank->presets[0].state != bank->presets[0].state);
+        // The banks share the presets which they have in common, instead of copying them
+        REQUIRE(new_bank->presets[0].name == bank->presets[0].name);
+        REQUIRE(new_bank->presets[0].state == bank->presets[0].state);
+
+        // and the presets outlive the bank they came from
+        ysfx_bank_u shared_bank{ysfx_delete_preset_from_bank(new_bank.get(), "added preset")};
+        {
+            ysfx_bank_u old_bank{std::move(new_bank)};
+            new_bank.reset(ysfx_add_preset_to_bank(shared_bank.get(), "added preset", ysfx_state_dup(old_bank->presets[1].state)));
+        }
+        validatePreset(&shared_bank->presets[0], "1.defaults", "1.defaults", 0.0, 0.0, 0.0, 0.0, 0.0, 0.0);
 
         ysfx_state_t *state3 = ysfx_state_dup(state);
         REQUIRE(ysfx_is_state_equal(state3, state));
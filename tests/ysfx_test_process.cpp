@@ -0,0 +1,1756 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "ysfx.h"
+#include "ysfx.hpp"
+#include "ysfx_api_eel.hpp"
+#include "ysfx_test_utils.hpp"
+#include <catch.hpp>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <thread>
+#include <chrono>
+
+TEST_CASE("sample-accurate processing", "[process]")
+{
+    const char *text =
+        "desc:example" "\n"
+        "slider1:0<0,1,0.1>the slider" "\n"
+        "out_pin:output" "\n"
+        "@init" "\n"
+        "num_blocks = 0;" "\n"
+        "num_slider = 0;" "\n"
+        "@slider" "\n"
+        "num_slider += 1;" "\n"
+        "@block" "\n"
+        "blocks = 1000;" "\n"
+        "offsets = 2000;" "\n"
+        "values = 3000;" "\n"
+        "blocks[num_blocks] = samplesblock;" "\n"
+        "values[num_blocks] = slider1;" "\n"
+        "offsets[num_blocks] = -1;" "\n"
+        "midirecv(ofs, msg1, msg2) ? (" "\n"
+        "  offsets[num_blocks] = ofs;" "\n"
+        "  midisend(ofs, msg1, msg2);" "\n"
+        ");" "\n"
+        "num_blocks += 1;" "\n";
+
+    scoped_new_dir dir_fx("${root}/Effects");
+    scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+
+    ysfx_config_u config{ysfx_config_new()};
+    ysfx_u fx{ysfx_new(config.get())};
+
+    REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+    REQUIRE(ysfx_compile(fx.get(), 0));
+
+    ysfx_real *num_blocks = ysfx_find_var(fx.get(), "num_blocks");
+    ysfx_real *num_slider = ysfx_find_var(fx.get(), "num_slider");
+    REQUIRE(num_blocks);
+    REQUIRE(num_slider);
+
+    auto send_note = [&fx](uint32_t offset) {
+        const uint8_t data[] = {0x90, 60, 0x40};
+        ysfx_midi_event_t event{};
+        event.offset = offset;
+        event.size = sizeof(data);
+        event.data = data;
+        REQUIRE(ysfx_send_midi(fx.get(), &event));
+    };
+
+    auto block_value = [&fx](uint32_t base, uint32_t index) -> ysfx_real {
+        return ysfx_read_vmem_single(fx.get(), base + index);
+    };
+
+    SECTION("cycle is not split by default")
+    {
+        ysfx_init(fx.get());
+        send_note(10);
+        send_note(40);
+        ysfx_process_float(fx.get(), nullptr, nullptr, 0, 0, 64);
+
+        REQUIRE(*num_blocks == 1);
+        REQUIRE(block_value(1000, 0) == 64);
+        REQUIRE(block_value(2000, 0) == 10);
+    }
+
+    SECTION("cycle is split at MIDI offsets")
+    {
+        ysfx_set_sample_accurate(fx.get(), 1);
+        ysfx_init(fx.get());
+        send_note(10);
+        send_note(40);
+        ysfx_process_float(fx.get(), nullptr, nullptr, 0, 0, 64);
+
+        REQUIRE(*num_blocks == 3);
+        REQUIRE(block_value(1000, 0) == 10);
+        REQUIRE(block_value(1000, 1) == 30);
+        REQUIRE(block_value(1000, 2) == 24);
+        REQUIRE(block_value(2000, 0) == -1);
+        REQUIRE(block_value(2000, 1) == 0);
+        REQUIRE(block_value(2000, 2) == 0);
+
+        // output offsets are relative to the whole cycle
+        ysfx_midi_event_t event;
+        REQUIRE(ysfx_receive_midi(fx.get(), &event));
+        REQUIRE(event.offset == 10);
+        REQUIRE(ysfx_receive_midi(fx.get(), &event));
+        REQUIRE(event.offset == 40);
+        REQUIRE(!ysfx_receive_midi(fx.get(), &event));
+    }
+
+    SECTION("sub-blocks respect the minimum length")
+    {
+        ysfx_set_sample_accurate(fx.get(), 16);
+        ysfx_init(fx.get());
+        send_note(10);
+        send_note(20);
+        send_note(50);
+        ysfx_process_float(fx.get(), nullptr, nullptr, 0, 0, 64);
+
+        REQUIRE(*num_blocks == 3);
+        REQUIRE(block_value(1000, 0) == 20);
+        REQUIRE(block_value(1000, 1) == 30);
+        REQUIRE(block_value(1000, 2) == 14);
+    }
+
+    SECTION("cycle is split at slider changes")
+    {
+        ysfx_set_sample_accurate(fx.get(), 1);
+        ysfx_init(fx.get());
+        ysfx_process_float(fx.get(), nullptr, nullptr, 0, 0, 64);
+        *num_blocks = 0;
+        *num_slider = 0;
+
+        REQUIRE(ysfx_slider_set_value_at(fx.get(), 0, 0.75, 48));
+        REQUIRE(ysfx_slider_set_value_at(fx.get(), 0, 0.5, 16));
+        ysfx_process_float(fx.get(), nullptr, nullptr, 0, 0, 64);
+
+        REQUIRE(*num_blocks == 3);
+        REQUIRE(*num_slider == 2);
+        REQUIRE(block_value(1000, 0) == 16);
+        REQUIRE(block_value(1000, 1) == 32);
+        REQUIRE(block_value(1000, 2) == 16);
+        REQUIRE(block_value(3000, 0) == 0);
+        REQUIRE(block_value(3000, 1) == 0.5);
+        REQUIRE(block_value(3000, 2) == 0.75);
+    }
+
+    SECTION("slider changes are applied at once without splitting")
+    {
+        ysfx_init(fx.get());
+        REQUIRE(ysfx_slider_set_value_at(fx.get(), 0, 0.5, 16));
+        ysfx_process_float(fx.get(), nullptr, nullptr, 0, 0, 64);
+
+        REQUIRE(*num_blocks == 1);
+        REQUIRE(ysfx_slider_get_value(fx.get(), 0) == 0.5);
+    }
+
+    SECTION("slider changes are bounded")
+    {
+        ysfx_set_block_size(fx.get(), 64);
+        ysfx_init(fx.get());
+        REQUIRE(!ysfx_slider_set_value_at(fx.get(), 0, 0.5, 64));
+
+        // the changes fill what is reserved, and no more
+        uint32_t count = 0;
+        while (count < 65536 && ysfx_slider_set_value_at(fx.get(), 0, 0.5, 0))
+            ++count;
+        REQUIRE(count >= ysfx_max_sliders);
+        REQUIRE(count < 65536);
+
+        ysfx_process_float(fx.get(), nullptr, nullptr, 0, 0, 64);
+        REQUIRE(ysfx_slider_set_value_at(fx.get(), 0, 0.25, 63));
+    }
+}
+
+TEST_CASE("sample conversion", "[process]")
+{
+    const char *text =
+        "desc:example" "\n"
+        "in_pin:input 1" "\n"
+        "in_pin:input 2" "\n"
+        "out_pin:output 1" "\n"
+        "out_pin:output 2" "\n"
+        "@init" "\n"
+        "ext_nodenorm = 1;" "\n"
+        "num_blocks = 0;" "\n"
+        "@block" "\n"
+        "num_blocks += 1;" "\n"
+        "@sample" "\n"
+        "spl0 = 2 * spl0 + spl1;" "\n"
+        "spl1 = -spl1;" "\n";
+
+    scoped_new_dir dir_fx("${root}/Effects");
+    scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+
+    ysfx_config_u config{ysfx_config_new()};
+    ysfx_u fx{ysfx_new(config.get())};
+
+    REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+    REQUIRE(ysfx_compile(fx.get(), 0));
+
+    // odd length, to exercise the remainder of vectorized loops
+    const uint32_t num_frames = 67;
+
+    SECTION("float")
+    {
+        std::vector<float> in0(num_frames), in1(num_frames), out0(num_frames), out1(num_frames);
+        for (uint32_t i = 0; i < num_frames; ++i) {
+            in0[i] = (float)i / 8;
+            in1[i] = (float)i / 16;
+        }
+        const float *ins[] = {in0.data(), in1.data()};
+        float *outs[] = {out0.data(), out1.data()};
+        ysfx_process_float(fx.get(), ins, outs, 2, 2, num_frames);
+        for (uint32_t i = 0; i < num_frames; ++i) {
+            REQUIRE(out0[i] == 2 * in0[i] + in1[i]);
+            REQUIRE(out1[i] == -in1[i]);
+        }
+    }
+
+    SECTION("double")
+    {
+        std::vector<double> in0(num_frames), in1(num_frames), out0(num_frames), out1(num_frames);
+        for (uint32_t i = 0; i < num_frames; ++i) {
+            in0[i] = (double)i / 8;
+            in1[i] = (double)i / 16;
+        }
+        const double *ins[] = {in0.data(), in1.data()};
+        double *outs[] = {out0.data(), out1.data()};
+        ysfx_process_double(fx.get(), ins, outs, 2, 2, num_frames);
+        for (uint32_t i = 0; i < num_frames; ++i) {
+            REQUIRE(out0[i] == 2 * in0[i] + in1[i]);
+            REQUIRE(out1[i] == -in1[i]);
+        }
+    }
+
+    SECTION("longer than the block size")
+    {
+        ysfx_set_block_size(fx.get(), 16);
+        ysfx_init(fx.get());
+
+        std::vector<float> in0(num_frames), in1(num_frames), out0(num_frames), out1(num_frames);
+        for (uint32_t i = 0; i < num_frames; ++i) {
+            in0[i] = (float)i / 8;
+            in1[i] = (float)i / 16;
+        }
+        const float *ins[] = {in0.data(), in1.data()};
+        float *outs[] = {out0.data(), out1.data()};
+        ysfx_process_float(fx.get(), ins, outs, 2, 2, num_frames);
+        for (uint32_t i = 0; i < num_frames; ++i) {
+            REQUIRE(out0[i] == 2 * in0[i] + in1[i]);
+            REQUIRE(out1[i] == -in1[i]);
+        }
+
+        // the cycle is split at the block size
+        REQUIRE(ysfx_read_var(fx.get(), "num_blocks") == 5);
+    }
+}
+
+TEST_CASE("denormal handling", "[process]")
+{
+    const char *text =
+        "desc:example" "\n"
+        "in_pin:input" "\n"
+        "out_pin:output" "\n"
+        "@sample" "\n"
+        "spl0 = spl0;" "\n";
+
+    scoped_new_dir dir_fx("${root}/Effects");
+    scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+
+    ysfx_config_u config{ysfx_config_new()};
+    ysfx_u fx{ysfx_new(config.get())};
+
+    REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+    REQUIRE(ysfx_compile(fx.get(), 0));
+
+    double in[16] = {};
+    double out[16] = {};
+    const double *ins[] = {in};
+    double *outs[] = {out};
+
+    SECTION("add offset")
+    {
+        ysfx_process_double(fx.get(), ins, outs, 1, 1, 16);
+        for (uint32_t i = 0; i < 16; ++i)
+            REQUIRE(out[i] != 0);
+    }
+
+    SECTION("flush to zero")
+    {
+        ysfx_set_denormal_mode(fx.get(), ysfx_denormal_flush_to_zero);
+        ysfx_process_double(fx.get(), ins, outs, 1, 1, 16);
+        for (uint32_t i = 0; i < 16; ++i)
+            REQUIRE(out[i] == 0);
+    }
+}
+
+TEST_CASE("silence skip", "[process]")
+{
+    const char *text =
+        "desc:example" "\n"
+        "in_pin:input" "\n"
+        "out_pin:output" "\n"
+        "@init" "\n"
+        "num_blocks = 0;" "\n"
+        "@block" "\n"
+        "num_blocks += 1;" "\n"
+        "@midi" "\n"
+        "num_notes += 1;" "\n"
+        "@sample" "\n"
+        "spl0 *= 0.5;" "\n";
+
+    scoped_new_dir dir_fx("${root}/Effects");
+    scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+
+    ysfx_config_u config{ysfx_config_new()};
+    ysfx_u fx{ysfx_new(config.get())};
+
+    REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+    REQUIRE(ysfx_compile(fx.get(), 0));
+    ysfx_init(fx.get());
+
+    ysfx_real *num_blocks = ysfx_find_var(fx.get(), "num_blocks");
+    REQUIRE(num_blocks);
+
+    float in[16] = {};
+    float out[16] = {};
+    const float *ins[] = {in};
+    float *outs[] = {out};
+
+    SECTION("disabled by default")
+    {
+        for (int i = 0; i < 4; ++i)
+            ysfx_process_float(fx.get(), ins, outs, 1, 1, 16);
+        REQUIRE(*num_blocks == 4);
+        REQUIRE(!ysfx_is_sleeping(fx.get()));
+    }
+
+    SECTION("sleeps after silence, wakes on audio")
+    {
+        // the first cycle is not quiet, since it has @slider to run
+        ysfx_set_silence_skip(fx.get(), 2, 1e-8);
+        for (int i = 0; i < 5; ++i)
+            ysfx_process_float(fx.get(), ins, outs, 1, 1, 16);
+        REQUIRE(*num_blocks == 3);
+        REQUIRE(ysfx_is_sleeping(fx.get()));
+        for (uint32_t i = 0; i < 16; ++i)
+            REQUIRE(out[i] == 0);
+
+        in[3] = 1;
+        ysfx_process_float(fx.get(), ins, outs, 1, 1, 16);
+        REQUIRE(*num_blocks == 4);
+        REQUIRE(!ysfx_is_sleeping(fx.get()));
+        REQUIRE(out[3] == 0.5f);
+    }
+
+    SECTION("wakes on MIDI")
+    {
+        ysfx_set_silence_skip(fx.get(), 1, 1e-8);
+        for (int i = 0; i < 3; ++i)
+            ysfx_process_float(fx.get(), ins, outs, 1, 1, 16);
+        REQUIRE(*num_blocks == 2);
+        REQUIRE(ysfx_is_sleeping(fx.get()));
+
+        const uint8_t data[] = {0x90, 60, 0x40};
+        ysfx_midi_event_t event{};
+        event.size = sizeof(data);
+        event.data = data;
+        REQUIRE(ysfx_send_midi(fx.get(), &event));
+        ysfx_process_float(fx.get(), ins, outs, 1, 1, 16);
+        REQUIRE(*num_blocks == 3);
+    }
+}
+
+TEST_CASE("interleaved processing", "[process]")
+{
+    const char *text =
+        "desc:example" "\n"
+        "in_pin:input 1" "\n"
+        "in_pin:input 2" "\n"
+        "out_pin:output 1" "\n"
+        "out_pin:output 2" "\n"
+        "@init" "\n"
+        "ext_nodenorm = 1;" "\n"
+        "@sample" "\n"
+        "tmp = spl0;" "\n"
+        "spl0 = spl1;" "\n"
+        "spl1 = 2 * tmp;" "\n";
+
+    scoped_new_dir dir_fx("${root}/Effects");
+    scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+
+    ysfx_config_u config{ysfx_config_new()};
+    ysfx_u fx{ysfx_new(config.get())};
+
+    REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+    REQUIRE(ysfx_compile(fx.get(), 0));
+
+    // 3 channels: the third one is above the pins, and gets forwarded
+    const uint32_t num_channels = 3;
+    const uint32_t num_frames = 37;
+
+    std::vector<float> in(num_channels * num_frames);
+    for (uint32_t i = 0; i < num_frames; ++i) {
+        in[i * num_channels + 0] = (float)i;
+        in[i * num_channels + 1] = (float)i / 4;
+        in[i * num_channels + 2] = -(float)i;
+    }
+
+    auto check = [&](const std::vector<float> &out) {
+        for (uint32_t i = 0; i < num_frames; ++i) {
+            REQUIRE(out[i * num_channels + 0] == (float)i / 4);
+            REQUIRE(out[i * num_channels + 1] == 2 * (float)i);
+            REQUIRE(out[i * num_channels + 2] == -(float)i);
+        }
+    };
+
+    SECTION("separate buffers")
+    {
+        std::vector<float> out(num_channels * num_frames);
+        ysfx_process_interleaved_float(fx.get(), in.data(), out.data(), num_channels, num_frames);
+        check(out);
+    }
+
+    SECTION("in place")
+    {
+        std::vector<float> buffer = in;
+        ysfx_process_interleaved_float_in_place(fx.get(), buffer.data(), num_channels, num_frames);
+        check(buffer);
+    }
+
+    SECTION("double, in place")
+    {
+        std::vector<double> buffer(in.begin(), in.end());
+        ysfx_process_interleaved_double_in_place(fx.get(), buffer.data(), num_channels, num_frames);
+        for (uint32_t i = 0; i < num_frames; ++i) {
+            REQUIRE(buffer[i * num_channels + 0] == (double)i / 4);
+            REQUIRE(buffer[i * num_channels + 1] == 2 * (double)i);
+            REQUIRE(buffer[i * num_channels + 2] == -(double)i);
+        }
+    }
+}
+
+TEST_CASE("metering", "[process]")
+{
+    const char *text =
+        "desc:example" "\n"
+        "in_pin:input 1" "\n"
+        "in_pin:input 2" "\n"
+        "out_pin:output 1" "\n"
+        "out_pin:output 2" "\n"
+        "@init" "\n"
+        "ext_nodenorm = 1;" "\n"
+        "@sample" "\n"
+        "spl0 *= 2;" "\n"
+        "spl1 = 0;" "\n";
+
+    scoped_new_dir dir_fx("${root}/Effects");
+    scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+
+    ysfx_config_u config{ysfx_config_new()};
+    ysfx_u fx{ysfx_new(config.get())};
+
+    REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+    REQUIRE(ysfx_compile(fx.get(), 0));
+
+    // an odd count, to measure the remainder after the vectors
+    const uint32_t num_frames = 37;
+    std::vector<float> in0(num_frames), in1(num_frames, 0.25f);
+    std::vector<float> out0(num_frames), out1(num_frames);
+    for (uint32_t i = 0; i < num_frames; ++i)
+        in0[i] = (i & 1) ? -0.5f : 0.5f;
+    in0[10] = -0.75f;
+
+    const float *ins[] = {in0.data(), in1.data()};
+    float *outs[] = {out0.data(), out1.data()};
+
+    ysfx_meter_t meters[4]{};
+
+    SECTION("disabled by default")
+    {
+        ysfx_process_float(fx.get(), ins, outs, 2, 2, num_frames);
+        REQUIRE(ysfx_get_meters(fx.get(), false, meters, 4) == 0);
+    }
+
+    SECTION("measures the inputs and outputs")
+    {
+        ysfx_set_metering(fx.get(), true);
+        ysfx_process_float(fx.get(), ins, outs, 2, 2, num_frames);
+        ysfx_process_float(fx.get(), ins, outs, 2, 2, num_frames);
+
+        const double rms0 = std::sqrt(((num_frames - 1) * 0.25 + 0.5625) / num_frames);
+
+        REQUIRE(ysfx_get_meters(fx.get(), false, meters, 4) == 2);
+        REQUIRE(meters[0].peak == Approx(0.75));
+        REQUIRE(meters[0].rms == Approx(rms0));
+        REQUIRE(meters[1].peak == Approx(0.25));
+        REQUIRE(meters[1].rms == Approx(0.25));
+
+        REQUIRE(ysfx_get_meters(fx.get(), true, meters, 1) == 2);
+        REQUIRE(meters[0].peak == Approx(1.5));
+        REQUIRE(meters[0].rms == Approx(2 * rms0));
+
+        // the levels start over after reading
+        REQUIRE(ysfx_get_meters(fx.get(), false, meters, 4) == 2);
+        REQUIRE(meters[0].peak == 0);
+        REQUIRE(meters[0].rms == 0);
+    }
+
+    SECTION("interleaved, in place")
+    {
+        ysfx_set_metering(fx.get(), true);
+        std::vector<double> buffer(2 * num_frames);
+        for (uint32_t i = 0; i < num_frames; ++i) {
+            buffer[2 * i + 0] = in0[i];
+            buffer[2 * i + 1] = in1[i];
+        }
+        ysfx_process_interleaved_double_in_place(fx.get(), buffer.data(), 2, num_frames);
+
+        REQUIRE(ysfx_get_meters(fx.get(), false, meters, 4) == 2);
+        REQUIRE(meters[0].peak == Approx(0.75));
+        REQUIRE(meters[1].peak == Approx(0.25));
+        REQUIRE(ysfx_get_meters(fx.get(), true, meters, 4) == 2);
+        REQUIRE(meters[0].peak == Approx(1.5));
+        REQUIRE(meters[1].peak == 0);
+        REQUIRE(meters[1].rms == 0);
+    }
+
+    SECTION("null channels are silent")
+    {
+        ysfx_set_metering(fx.get(), true);
+        const float *null_ins[] = {in0.data(), nullptr};
+        float *null_outs[] = {out0.data(), nullptr};
+        ysfx_process_float(fx.get(), null_ins, null_outs, 2, 2, num_frames);
+
+        REQUIRE(ysfx_get_meters(fx.get(), false, meters, 4) == 2);
+        REQUIRE(meters[0].peak == Approx(0.75));
+        REQUIRE(meters[1].peak == 0);
+        REQUIRE(meters[1].rms == 0);
+        REQUIRE(ysfx_get_meters(fx.get(), true, meters, 4) == 2);
+        REQUIRE(meters[0].peak == Approx(1.5));
+        REQUIRE(meters[1].peak == 0);
+    }
+}
+
+TEST_CASE("section profiling", "[process]")
+{
+    const char *text =
+        "desc:example" "\n"
+        "out_pin:output" "\n"
+        "@init" "\n"
+        "x = 0;" "\n"
+        "@block" "\n"
+        "x += 1;" "\n"
+        "@sample" "\n"
+        "spl0 = x;" "\n";
+
+    scoped_new_dir dir_fx("${root}/Effects");
+    scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+
+    ysfx_config_u config{ysfx_config_new()};
+    ysfx_u fx{ysfx_new(config.get())};
+
+    REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+    REQUIRE(ysfx_compile(fx.get(), 0));
+
+    float out[32] = {};
+    float *outs[] = {out};
+    ysfx_profile_stats_t stats{};
+
+    SECTION("disabled by default")
+    {
+        ysfx_init(fx.get());
+        ysfx_process_float(fx.get(), nullptr, outs, 0, 1, 32);
+        REQUIRE(ysfx_get_profile_stats(fx.get(), ysfx_section_block, &stats));
+        REQUIRE(stats.calls == 0);
+        REQUIRE(stats.min_ns == 0);
+    }
+
+    SECTION("counts executions")
+    {
+        ysfx_set_profiling(fx.get(), true);
+        ysfx_init(fx.get());
+        for (int i = 0; i < 3; ++i)
+            ysfx_process_float(fx.get(), nullptr, outs, 0, 1, 32);
+
+        REQUIRE(ysfx_get_profile_stats(fx.get(), ysfx_section_init, &stats));
+        REQUIRE(stats.calls == 1);
+        REQUIRE(ysfx_get_profile_stats(fx.get(), ysfx_section_block, &stats));
+        REQUIRE(stats.calls == 3);
+        REQUIRE(stats.min_ns <= stats.max_ns);
+        REQUIRE(stats.total_ns >= stats.max_ns);
+        uint64_t binned = 0;
+        for (uint32_t i = 0; i < ysfx_profile_histogram_size; ++i)
+            binned += stats.histogram[i];
+        REQUIRE(binned == 3);
+        REQUIRE(ysfx_get_profile_stats(fx.get(), ysfx_section_sample, &stats));
+        REQUIRE(stats.calls == 3);
+
+        ysfx_reset_profile_stats(fx.get());
+        REQUIRE(ysfx_get_profile_stats(fx.get(), ysfx_section_block, &stats));
+        REQUIRE(stats.calls == 0);
+        REQUIRE(!ysfx_get_profile_stats(fx.get(), 0, &stats));
+    }
+}
+
+TEST_CASE("deadline statistics", "[process]")
+{
+    const char *text =
+        "desc:example" "\n"
+        "out_pin:output" "\n"
+        "@block" "\n"
+        "slow ? loop(5000000, x += 1);" "\n"
+        "@sample" "\n"
+        "spl0 = 0;" "\n";
+
+    scoped_new_dir dir_fx("${root}/Effects");
+    scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+
+    ysfx_config_u config{ysfx_config_new()};
+    ysfx_u fx{ysfx_new(config.get())};
+
+    REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+    REQUIRE(ysfx_compile(fx.get(), 0));
+    ysfx_set_sample_rate(fx.get(), 48000);
+    ysfx_init(fx.get());
+
+    float out[32] = {};
+    float *outs[] = {out};
+    ysfx_deadline_stats_t stats{};
+
+    for (int i = 0; i < 10; ++i)
+        ysfx_process_float(fx.get(), nullptr, outs, 0, 1, 32);
+    // a cycle without frames has no deadline
+    ysfx_process_float(fx.get(), nullptr, outs, 0, 1, 0);
+
+    ysfx_get_deadline_stats(fx.get(), &stats);
+    REQUIRE(stats.cycles == 10);
+    uint64_t binned = 0;
+    for (uint32_t i = 0; i < ysfx_deadline_histogram_size; ++i)
+        binned += stats.histogram[i];
+    REQUIRE(binned == 10);
+    REQUIRE(stats.p50_load <= stats.p90_load);
+    REQUIRE(stats.p90_load <= stats.p99_load);
+    REQUIRE(stats.p99_load <= stats.p999_load);
+    REQUIRE(stats.p999_load <= stats.max_load);
+
+    // 5 million iterations do not fit in 32 frames, which last less than a millisecond
+    *ysfx_find_var(fx.get(), "slow") = 1;
+    for (int i = 0; i < 3; ++i)
+        ysfx_process_float(fx.get(), nullptr, outs, 0, 1, 32);
+
+    ysfx_get_deadline_stats(fx.get(), &stats);
+    REQUIRE(stats.cycles == 13);
+    REQUIRE(stats.misses >= 3);
+    REQUIRE(stats.max_load > 1.0);
+    REQUIRE(stats.p999_load > 1.0);
+
+    ysfx_reset_deadline_stats(fx.get());
+    ysfx_get_deadline_stats(fx.get(), &stats);
+    REQUIRE(stats.cycles == 0);
+    REQUIRE(stats.misses == 0);
+    REQUIRE(stats.max_load == 0);
+    REQUIRE(stats.p50_load == 0);
+}
+
+TEST_CASE("recent load", "[process]")
+{
+    const char *text =
+        "desc:example" "\n"
+        "out_pin:output" "\n"
+        "@sample" "\n"
+        "spl0 = 0;" "\n";
+
+    scoped_new_dir dir_fx("${root}/Effects");
+    scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+
+    ysfx_config_u config{ysfx_config_new()};
+    ysfx_u fx{ysfx_new(config.get())};
+
+    REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+    REQUIRE(ysfx_compile(fx.get(), 0));
+    ysfx_set_sample_rate(fx.get(), 48000);
+    ysfx_init(fx.get());
+
+    double avg = -1, peak = -1;
+
+    ysfx_get_cpu_load(fx.get(), &avg, &peak);
+    REQUIRE(avg == 0);
+    REQUIRE(peak == 0);
+
+    // the cycles are recorded with durations of their own, as the real ones vary with the machine
+    //   32 frames at 48 kHz last 2/3 of a millisecond
+    const uint64_t budget_ns = 32 * 1000000000ull / 48000;
+
+    // a slow cycle raises the peak to its load, and the average a little
+    ysfx_record_deadline(fx.get(), 3 * budget_ns, 32);
+    ysfx_get_cpu_load(fx.get(), &avg, &peak);
+    REQUIRE(peak == Approx(3.0));
+    REQUIRE(avg > 0);
+    REQUIRE(avg < peak);
+
+    // the fast cycles of 10 seconds of audio bring both down, the peak over 5 seconds and the average over 1
+    for (int i = 0; i < 48000 * 10 / 32; ++i)
+        ysfx_record_deadline(fx.get(), budget_ns / 10, 32);
+    ysfx_get_cpu_load(fx.get(), &avg, &peak);
+    REQUIRE(peak == Approx(3.0 * std::exp(-2.0)).epsilon(0.01));
+    REQUIRE(avg == Approx(0.1).epsilon(0.01));
+
+    // a cycle without frames is not counted
+    ysfx_record_deadline(fx.get(), budget_ns, 0);
+    double same_avg = -1;
+    ysfx_get_cpu_load(fx.get(), &same_avg, nullptr);
+    REQUIRE(same_avg == avg);
+
+    ysfx_reset_deadline_stats(fx.get());
+    ysfx_get_cpu_load(fx.get(), &avg, nullptr);
+    REQUIRE(avg == 0);
+}
+
+TEST_CASE("background initialization", "[process]")
+{
+    const char *text =
+        "desc:example" "\n"
+        "in_pin:input" "\n"
+        "out_pin:output" "\n"
+        "@init" "\n"
+        "rate = srate; gain = 0; loop(20000000, x += 1); gain = 0.5;" "\n"
+        "@slider" "\n"
+        "sliders += 1;" "\n"
+        "@block" "\n"
+        "while (midirecv(offset, m1, m2, m3)) (notes += 1);" "\n"
+        "@sample" "\n"
+        "spl0 *= gain;" "\n";
+
+    scoped_new_dir dir_fx("${root}/Effects");
+    scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+
+    ysfx_config_u config{ysfx_config_new()};
+    ysfx_u fx{ysfx_new(config.get())};
+
+    REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+    REQUIRE(ysfx_compile(fx.get(), 0));
+    ysfx_set_background_init(fx.get(), true);
+
+    float in[8] = {1, 1, 1, 1, 1, 1, 1, 1};
+    float out[8] = {};
+    const float *ins[] = {in};
+    float *outs[] = {out};
+
+    // the first cycle starts @init, and passes the audio through
+    const uint8_t note[3] = {0x90, 60, 100};
+    ysfx_midi_event_t event{0, 0, 3, note};
+    REQUIRE(ysfx_send_midi(fx.get(), &event));
+    ysfx_process_float(fx.get(), ins, outs, 1, 1, 8);
+    REQUIRE(out[0] == 1);
+
+    while (ysfx_is_initializing(fx.get()))
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    REQUIRE(*ysfx_find_var(fx.get(), "rate") == 44100);
+    REQUIRE(*ysfx_find_var(fx.get(), "sliders") == 1);
+
+    // the next cycle processes, with the MIDI which has waited
+    ysfx_process_float(fx.get(), ins, outs, 1, 1, 8);
+    REQUIRE(out[0] == 0.5f);
+    REQUIRE(*ysfx_find_var(fx.get(), "notes") == 1);
+
+    // a change of the settings waits for @init to end, then makes it due again
+    ysfx_set_sample_rate(fx.get(), 96000);
+    ysfx_process_float(fx.get(), ins, outs, 1, 1, 8);
+    REQUIRE(out[0] == 1);
+    ysfx_set_sample_rate(fx.get(), 48000);
+    REQUIRE_FALSE(ysfx_is_initializing(fx.get()));
+    REQUIRE(*ysfx_find_var(fx.get(), "rate") == 96000);
+
+    // without it, @init runs in the cycle
+    ysfx_set_background_init(fx.get(), false);
+    ysfx_process_float(fx.get(), ins, outs, 1, 1, 8);
+    REQUIRE(out[0] == 0.5f);
+    REQUIRE(*ysfx_find_var(fx.get(), "rate") == 48000);
+
+    // an offline render waits for it, and passes nothing through
+    ysfx_set_background_init(fx.get(), true);
+    ysfx_time_info_t info{};
+    info.tempo = 120;
+    info.playback_state = ysfx_playback_playing;
+    info.offline = true;
+    ysfx_set_time_info(fx.get(), &info);
+    ysfx_set_sample_rate(fx.get(), 96000);
+    ysfx_process_float(fx.get(), ins, outs, 1, 1, 8);
+    REQUIRE(out[0] == 0.5f);
+    REQUIRE(*ysfx_find_var(fx.get(), "rate") == 96000);
+}
+
+TEST_CASE("tracing", "[process]")
+{
+    const char *text =
+        "desc:example" "\n"
+        "out_pin:output" "\n"
+        "@block" "\n"
+        "midisend(0, 0x90, 60, 100);" "\n"
+        "@sample" "\n"
+        "spl0 = 0;" "\n";
+
+    scoped_new_dir dir_fx("${root}/Effects");
+    scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+    scoped_new_txt file_trace("${root}/trace.json", "");
+
+    auto read_trace = [&]() -> std::string {
+        std::string data;
+        FILE *stream = fopen(file_trace.m_path.c_str(), "rb");
+        REQUIRE(stream);
+        char buf[4096];
+        for (size_t n; (n = fread(buf, 1, sizeof(buf), stream)) > 0; )
+            data.append(buf, n);
+        fclose(stream);
+        return data;
+    };
+
+    ysfx_config_u config{ysfx_config_new()};
+    ysfx_u fx{ysfx_new(config.get())};
+
+    float out[32] = {};
+    float *outs[] = {out};
+
+    REQUIRE(!ysfx_is_tracing());
+    ysfx_set_tracing(true);
+    REQUIRE(ysfx_is_tracing());
+
+    REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+    REQUIRE(ysfx_compile(fx.get(), 0));
+    ysfx_init(fx.get());
+    ysfx_trace_begin("host work");
+    for (int i = 0; i < 3; ++i)
+        ysfx_process_float(fx.get(), nullptr, outs, 0, 1, 32);
+    ysfx_trace_end();
+    ysfx_trace_value("host counter", 42);
+
+    ysfx_set_tracing(false);
+    REQUIRE(ysfx_write_trace(file_trace.m_path.c_str()));
+
+    std::string trace = read_trace();
+    REQUIRE(trace.find("\"traceEvents\"") != trace.npos);
+    REQUIRE(trace.find("\"name\":\"load\"") != trace.npos);
+    REQUIRE(trace.find("\"name\":\"compile\"") != trace.npos);
+    REQUIRE(trace.find("\"name\":\"@block\"") != trace.npos);
+    REQUIRE(trace.find("\"name\":\"process\"") != trace.npos);
+    REQUIRE(trace.find("\"name\":\"midi out bytes\"") != trace.npos);
+    REQUIRE(trace.find("\"name\":\"host work\"") != trace.npos);
+    REQUIRE(trace.find("\"name\":\"host counter\",\"args\":{\"value\":42}") != trace.npos);
+
+    // the events are forgotten once written, and none come while stopped
+    ysfx_process_float(fx.get(), nullptr, outs, 0, 1, 32);
+    REQUIRE(ysfx_write_trace(file_trace.m_path.c_str()));
+    trace = read_trace();
+    REQUIRE(trace.find("\"traceEvents\"") != trace.npos);
+    REQUIRE(trace.find("\"name\":\"process\"") == trace.npos);
+}
+
+TEST_CASE("line profiling", "[process]")
+{
+    const char *text =
+        "desc:example" "\n"
+        "import lib.jsfx-inc" "\n"
+        "out_pin:output" "\n"
+        "@init" "\n"
+        "x = 0; s = \"a;b\"; // a string; and a comment" "\n"
+        "@block" "\n"
+        "x = 0;" "\n"
+        "loop(20000, x += sin(x) * 0.001 + 1);" "\n"
+        "y = slow();" "\n"
+        "@sample" "\n"
+        "spl0 = (x; y;);" "\n";
+    const char *text_lib =
+        "@init" "\n"
+        "function slow() local(i, a) (" "\n"
+        "  a = 0; i = 0;" "\n"
+        "  loop(20000, a += cos(i); i += 1);" "\n"
+        "  a;" "\n"
+        ");" "\n";
+
+    scoped_new_dir dir_fx("${root}/Effects");
+    scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+    scoped_new_txt file_lib("${root}/Effects/lib.jsfx-inc", text_lib);
+
+    ysfx_config_u config{ysfx_config_new()};
+    ysfx_u fx{ysfx_new(config.get())};
+
+    REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+    REQUIRE(ysfx_compile(fx.get(), ysfx_compile_profile_lines));
+    ysfx_set_line_sampling(fx.get(), true, 100);
+    ysfx_init(fx.get());
+
+    float out[32] = {};
+    float *outs[] = {out};
+
+    // the probes do not change what the code computes
+    ysfx_process_float(fx.get(), nullptr, outs, 0, 1, 32);
+    double expected = 0;
+    for (int i = 0; i < 20000; ++i)
+        expected += std::cos((double)i);
+    REQUIRE(std::fabs(ysfx_read_var(fx.get(), "y") - expected) < 1e-9);
+    REQUIRE(out[31] == (float)expected);
+
+    std::vector<ysfx_line_sample_t> samples;
+    uint64_t total = 0;
+    for (int round = 0; round < 2000 && total < 200; ++round) {
+        ysfx_process_float(fx.get(), nullptr, outs, 0, 1, 32);
+        samples.resize(ysfx_get_line_samples(fx.get(), nullptr, 0));
+        samples.resize(ysfx_get_line_samples(fx.get(), samples.data(), (uint32_t)samples.size()));
+        total = 0;
+        for (const ysfx_line_sample_t &sample : samples)
+            total += sample.count;
+    }
+    REQUIRE(total >= 200);
+
+    // the loops of both files are found, and no line which has no statement
+    uint64_t main_loop = 0;
+    uint64_t lib_loop = 0;
+    for (const ysfx_line_sample_t &sample : samples) {
+        std::string file = sample.file;
+        INFO(file << ":" << sample.line);
+        if (file == file_main.m_path) {
+            REQUIRE((sample.line == 7 || sample.line == 8 || sample.line == 9 || sample.line == 11));
+            if (sample.line == 8)
+                main_loop = sample.count;
+        }
+        else {
+            REQUIRE(file.find("lib.jsfx-inc") != std::string::npos);
+            REQUIRE((sample.line >= 3 && sample.line <= 5));
+            if (sample.line == 4)
+                lib_loop = sample.count;
+        }
+    }
+    REQUIRE(main_loop > 0);
+    REQUIRE(lib_loop > 0);
+
+    ysfx_reset_line_samples(fx.get());
+    ysfx_set_line_sampling(fx.get(), false, 0);
+    REQUIRE(ysfx_get_line_samples(fx.get(), nullptr, 0) == 0);
+}
+
+TEST_CASE("specialization of constants", "[process]")
+{
+    const char *text =
+        "desc:example" "\n"
+        "options:const=mode,Gain,unused" "\n"
+        "slider1:0<0,2,1>mode" "\n"
+        "slider2:0.5<0,1,0.01>gain" "\n"
+        "out_pin:output" "\n"
+        "@slider" "\n"
+        "mode = slider1; gain = slider2 * 2;" "\n"
+        "@sample" "\n"
+        "/* gain */ n += 1; s = \"gain\";" "\n"
+        "mode == 0 ? spl0 = GAIN * sin(n * 0.01) :" "\n"
+        "mode == 1 ? spl0 = -gain * (n % 7) :" "\n"
+        "spl0 = gain * gain + (gain > 1 ? 1 : 0);" "\n";
+
+    scoped_new_dir dir_fx("${root}/Effects");
+    scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+
+    ysfx_config_u config{ysfx_config_new()};
+    ysfx_u generic{ysfx_new(config.get())};
+    ysfx_u special{ysfx_new(config.get())};
+
+    REQUIRE(ysfx_load_file(generic.get(), file_main.m_path.c_str(), 0));
+    REQUIRE(ysfx_compile(generic.get(), 0));
+    REQUIRE(ysfx_load_file(special.get(), file_main.m_path.c_str(), 0));
+    REQUIRE(ysfx_compile(special.get(), ysfx_compile_specialize));
+    ysfx_init(generic.get());
+    ysfx_init(special.get());
+
+    float out_generic[32] = {};
+    float out_special[32] = {};
+    float *outs_generic[] = {out_generic};
+    float *outs_special[] = {out_special};
+
+    auto process = [&]() {
+        ysfx_process_float(generic.get(), nullptr, outs_generic, 0, 1, 32);
+        ysfx_process_float(special.get(), nullptr, outs_special, 0, 1, 32);
+        for (uint32_t i = 0; i < 32; ++i)
+            REQUIRE(out_generic[i] == out_special[i]);
+    };
+
+    REQUIRE(ysfx_get_specialized_count(generic.get()) == 0);
+
+    const ysfx_real settings[][2] = {{0, 0.5}, {1, 0.25}, {2, 0.75}, {0, 0.5}};
+    uint32_t expected_count = 0;
+    for (const ysfx_real *setting : settings) {
+        ysfx_slider_set_value(generic.get(), 0, setting[0], true);
+        ysfx_slider_set_value(generic.get(), 1, setting[1], true);
+        ysfx_slider_set_value(special.get(), 0, setting[0], true);
+        ysfx_slider_set_value(special.get(), 1, setting[1], true);
+
+        // the generic code runs until the variant is ready, then the variant
+        if (expected_count < 3)
+            ++expected_count;
+        for (int round = 0; round < 2000 && ysfx_get_specialized_count(special.get()) < expected_count; ++round) {
+            process();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        REQUIRE(ysfx_get_specialized_count(special.get()) == expected_count);
+        for (int round = 0; round < 4; ++round)
+            process();
+    }
+
+    // the values which come back use the variant which is cached
+    REQUIRE(ysfx_get_specialized_count(special.get()) == 3);
+}
+
+TEST_CASE("eval", "[process]")
+{
+    const char *text =
+        "desc:example" "\n"
+        "out_pin:output" "\n"
+        "@init" "\n"
+        "n = 0; depth = 0;" "\n"
+        "#nest = \"depth += 1; eval(#nest)\";" "\n"
+        "eval(#nest);" "\n"
+        "@block" "\n"
+        "eval(\"n += 1\");" "\n"
+        "eval( \"n += 10\" );" "\n"
+        "sprintf(#s, \"m = %d\", 5);" "\n"
+        "eval(#s);" "\n";
+
+    scoped_new_dir dir_fx("${root}/Effects");
+    scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+
+    ysfx_config_u config{ysfx_config_new()};
+    ysfx_u fx{ysfx_new(config.get())};
+    REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+    REQUIRE(ysfx_compile(fx.get(), 0));
+
+    // the literal texts are compiled with the code
+    REQUIRE(fx->code.eval_cache->size() == 2);
+
+    ysfx_init(fx.get());
+    // the nesting stops at its limit
+    REQUIRE(ysfx_read_var(fx.get(), "depth") == 8);
+
+    float out[16] = {};
+    float *outs[] = {out};
+    for (int i = 0; i < 3; ++i)
+        ysfx_process_float(fx.get(), nullptr, outs, 0, 1, 16);
+
+    REQUIRE(ysfx_read_var(fx.get(), "n") == 33);
+    REQUIRE(ysfx_read_var(fx.get(), "m") == 5);
+    REQUIRE(fx->code.eval_cache->size() == 4);
+}
+
+TEST_CASE("match", "[process]")
+{
+    const char *text =
+        "desc:example" "\n"
+        "out_pin:output" "\n"
+        "@init" "\n"
+        "#msg = \"/track/12/volume 0.75\";" "\n"
+        "#pat = \"*/%{#what}s *\";" "\n"
+        "@block" "\n"
+        "ok = match(\"/track/%d/*\", #msg, track);" "\n"
+        "match(\"*volume %f\", #msg, volume);" "\n"
+        "caseless = matchi(\"/TRACK/%{n}D/VOLUME*\", #msg);" "\n"
+        "cased = match(\"/TRACK/*\", #msg);" "\n"
+        "match(#pat, #msg) ? strcpy(5, #what);" "\n";
+
+    scoped_new_dir dir_fx("${root}/Effects");
+    scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+
+    ysfx_config_u config{ysfx_config_new()};
+    ysfx_u fx{ysfx_new(config.get())};
+    REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+    REQUIRE(ysfx_compile(fx.get(), 0));
+
+    // the literal patterns are compiled with the code
+    REQUIRE(fx->code.match_cache->size() == 4);
+
+    ysfx_init(fx.get());
+    float out[16] = {};
+    float *outs[] = {out};
+    for (int i = 0; i < 2; ++i)
+        ysfx_process_float(fx.get(), nullptr, outs, 0, 1, 16);
+
+    REQUIRE(ysfx_read_var(fx.get(), "ok") == 1);
+    REQUIRE(ysfx_read_var(fx.get(), "track") == 12);
+    REQUIRE(ysfx_read_var(fx.get(), "volume") == 0.75);
+    REQUIRE(ysfx_read_var(fx.get(), "caseless") == 1);
+    REQUIRE(ysfx_read_var(fx.get(), "n") == 12);
+    REQUIRE(ysfx_read_var(fx.get(), "cased") == 0);
+
+    std::string found;
+    REQUIRE(ysfx_string_get(fx.get(), 5, found));
+    REQUIRE(found == "volume");
+    REQUIRE(fx->code.match_cache->size() == 5);
+}
+
+TEST_CASE("transport", "[process]")
+{
+    const char *text =
+        "desc:example" "\n"
+        "out_pin:output" "\n"
+        "@block" "\n"
+        "seen_tempo = tempo;" "\n"
+        "tempo = 1;" "\n";
+
+    scoped_new_dir dir_fx("${root}/Effects");
+    scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+
+    ysfx_config_u config{ysfx_config_new()};
+    ysfx_u fx{ysfx_new(config.get())};
+
+    REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+    REQUIRE(ysfx_compile(fx.get(), 0));
+
+    ysfx_set_sample_rate(fx.get(), 48000);
+    ysfx_set_block_size(fx.get(), 64);
+    ysfx_init(fx.get());
+
+    ysfx_time_info_t info{};
+    info.tempo = 96;
+    info.playback_state = ysfx_playback_playing;
+    info.time_position = 10;
+    info.beat_position = 18;
+    info.time_signature[0] = 6;
+    info.time_signature[1] = 8;
+
+    ysfx_set_time_info(fx.get(), &info);
+
+    ysfx_transport_t transport{};
+    ysfx_get_transport(fx.get(), &transport);
+    REQUIRE(transport.info.tempo == 96);
+    REQUIRE(transport.samples_per_beat == 30000);
+    REQUIRE(transport.beats_per_bar == 3);
+    REQUIRE(transport.bar_position == 6);
+
+    REQUIRE(*ysfx_find_var(fx.get(), "ts_num") == 6);
+    REQUIRE(*ysfx_find_var(fx.get(), "ts_denom") == 8);
+
+    SECTION("the same info still restores what the code wrote")
+    {
+        float out[64] = {};
+        float *outs[] = {out};
+        ysfx_process_float(fx.get(), nullptr, outs, 0, 1, 64);
+        REQUIRE(*ysfx_find_var(fx.get(), "seen_tempo") == 96);
+        REQUIRE(*ysfx_find_var(fx.get(), "tempo") == 1);
+        ysfx_set_time_info(fx.get(), &info);
+        REQUIRE(*ysfx_find_var(fx.get(), "tempo") == 96);
+    }
+
+    SECTION("the derived values follow the changes")
+    {
+        info.beat_position = 21;
+        ysfx_set_time_info(fx.get(), &info);
+        ysfx_get_transport(fx.get(), &transport);
+        REQUIRE(transport.bar_position == 7);
+
+        ysfx_set_sample_rate(fx.get(), 96000);
+        ysfx_get_transport(fx.get(), &transport);
+        REQUIRE(transport.samples_per_beat == 60000);
+
+        info.time_signature[0] = 0;
+        ysfx_set_time_info(fx.get(), &info);
+        ysfx_get_transport(fx.get(), &transport);
+        REQUIRE(transport.beats_per_bar == 0);
+        REQUIRE(transport.bar_position == 0);
+    }
+
+    SECTION("offline render")
+    {
+        REQUIRE(!ysfx_is_offline(fx.get()));
+        REQUIRE(*ysfx_find_var(fx.get(), "play_offline") == 0);
+
+        info.offline = true;
+        ysfx_set_time_info(fx.get(), &info);
+        REQUIRE(ysfx_is_offline(fx.get()));
+        REQUIRE(*ysfx_find_var(fx.get(), "play_offline") == 1);
+
+        // the cycles of a bounce have no deadline
+        float out[64] = {};
+        float *outs[] = {out};
+        ysfx_process_float(fx.get(), nullptr, outs, 0, 1, 64);
+        ysfx_deadline_stats_t stats{};
+        ysfx_get_deadline_stats(fx.get(), &stats);
+        REQUIRE(stats.cycles == 0);
+    }
+}
+
+TEST_CASE("channels above the fixed variables", "[process]")
+{
+    const uint32_t num_pins = 130;
+
+    std::string text = "desc:example" "\n";
+    for (uint32_t i = 0; i < num_pins; ++i) {
+        text += "in_pin:" + std::string((i == num_pins - 1) ? "sidechain" : "input") + "\n";
+        text += "out_pin:output" "\n";
+    }
+    text +=
+        "@init" "\n"
+        "ext_nodenorm = 1;" "\n"
+        "@sample" "\n"
+        "i = 0;" "\n"
+        "loop(num_ch, spl(i) = 2 * spl(i); i += 1);" "\n"
+        "spl129 += 1;" "\n"
+        "spl0 += spl(200);" "\n";
+
+    scoped_new_dir dir_fx("${root}/Effects");
+    scoped_new_txt file_main("${root}/Effects/example.jsfx", text.c_str());
+
+    ysfx_config_u config{ysfx_config_new()};
+    ysfx_u fx{ysfx_new(config.get())};
+
+    REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+    REQUIRE(ysfx_compile(fx.get(), 0));
+
+    REQUIRE(ysfx_get_num_inputs(fx.get()) == num_pins);
+    REQUIRE(ysfx_get_num_outputs(fx.get()) == num_pins);
+    REQUIRE(fx->var.spl.size() == num_pins);
+    REQUIRE(!ysfx_is_sidechain_input(fx.get(), num_pins - 2));
+    REQUIRE(ysfx_is_sidechain_input(fx.get(), num_pins - 1));
+
+    const uint32_t num_frames = 16;
+    ysfx_set_block_size(fx.get(), num_frames);
+    ysfx_init(fx.get());
+
+    auto expected = [&](uint32_t ch, float value) -> float {
+        return 2 * value + ((ch == num_pins - 1) ? 1 : 0);
+    };
+
+    SECTION("planar")
+    {
+        std::vector<std::vector<float>> in(num_pins), out(num_pins);
+        std::vector<const float *> ins(num_pins);
+        std::vector<float *> outs(num_pins);
+        for (uint32_t ch = 0; ch < num_pins; ++ch) {
+            in[ch].assign(num_frames, (float)ch);
+            out[ch].assign(num_frames, -1);
+            ins[ch] = in[ch].data();
+            outs[ch] = out[ch].data();
+        }
+        ysfx_process_float(fx.get(), ins.data(), outs.data(), num_pins, num_pins, num_frames);
+        for (uint32_t ch = 0; ch < num_pins; ++ch) {
+            for (float value : out[ch])
+                REQUIRE(value == expected(ch, (float)ch));
+        }
+    }
+
+    SECTION("interleaved")
+    {
+        // one channel above the pins, which gets forwarded
+        const uint32_t num_channels = num_pins + 1;
+        std::vector<float> buffer(num_channels * num_frames);
+        for (uint32_t i = 0; i < num_frames; ++i) {
+            for (uint32_t ch = 0; ch < num_channels; ++ch)
+                buffer[i * num_channels + ch] = (float)ch;
+        }
+        ysfx_process_interleaved_float_in_place(fx.get(), buffer.data(), num_channels, num_frames);
+        for (uint32_t i = 0; i < num_frames; ++i) {
+            for (uint32_t ch = 0; ch < num_pins; ++ch)
+                REQUIRE(buffer[i * num_channels + ch] == expected(ch, (float)ch));
+            REQUIRE(buffer[i * num_channels + num_pins] == (float)num_pins);
+        }
+    }
+
+    SECTION("a smaller effect has the fixed variables only")
+    {
+        scoped_new_txt file_small("${root}/Effects/small.jsfx",
+            "desc:small" "\n"
+            "in_pin:input" "\n"
+            "out_pin:output" "\n"
+            "@sample" "\n"
+            "spl0 = 1;" "\n");
+        REQUIRE(ysfx_load_file(fx.get(), file_small.m_path.c_str(), 0));
+        REQUIRE(ysfx_compile(fx.get(), 0));
+        REQUIRE(fx->var.spl.size() == ysfx_fixed_channels);
+    }
+}
+
+TEST_CASE("null channels", "[process]")
+{
+    const char *text =
+        "desc:example" "\n"
+        "in_pin:input L" "\n"
+        "in_pin:input R" "\n"
+        "in_pin:sidechain L" "\n"
+        "in_pin:Aux R" "\n"
+        "out_pin:output L" "\n"
+        "out_pin:output R" "\n"
+        "@init" "\n"
+        "ext_nodenorm = 1;" "\n"
+        "@sample" "\n"
+        "spl0 = spl0 + spl2;" "\n"
+        "spl1 = spl1 + spl3 + 1;" "\n";
+
+    scoped_new_dir dir_fx("${root}/Effects");
+    scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+
+    ysfx_config_u config{ysfx_config_new()};
+    ysfx_u fx{ysfx_new(config.get())};
+
+    REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+    REQUIRE(ysfx_compile(fx.get(), 0));
+
+    REQUIRE(!ysfx_is_sidechain_input(fx.get(), 0));
+    REQUIRE(!ysfx_is_sidechain_input(fx.get(), 1));
+    REQUIRE(ysfx_is_sidechain_input(fx.get(), 2));
+    REQUIRE(ysfx_is_sidechain_input(fx.get(), 3));
+    REQUIRE(!ysfx_is_sidechain_input(fx.get(), 4));
+
+    ysfx_set_block_size(fx.get(), 8);
+    ysfx_init(fx.get());
+
+    std::vector<float> in0(8, 1), in2(8, 2);
+    std::vector<float> out0(8, -1);
+    const float *ins[] = {in0.data(), nullptr, in2.data(), nullptr};
+    float *outs[] = {out0.data(), nullptr};
+    ysfx_process_float(fx.get(), ins, outs, 4, 2, 8);
+
+    for (float value : out0)
+        REQUIRE(value == 3);
+}
+
+TEST_CASE("oversampling", "[process]")
+{
+    const char *text =
+        "desc:example" "\n"
+        "in_pin:input" "\n"
+        "out_pin:output" "\n"
+        "@init" "\n"
+        "ext_nodenorm = 1;" "\n"
+        "pdc_delay = 8;" "\n"
+        "num_samples = 0;" "\n"
+        "@block" "\n"
+        "rate = srate;" "\n"
+        "frames = samplesblock;" "\n"
+        "@sample" "\n"
+        "num_samples += 1;" "\n";
+
+    scoped_new_dir dir_fx("${root}/Effects");
+    scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+
+    ysfx_config_u config{ysfx_config_new()};
+    ysfx_u fx{ysfx_new(config.get())};
+
+    REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+    REQUIRE(ysfx_compile(fx.get(), 0));
+
+    const uint32_t block_size = 64;
+    ysfx_set_sample_rate(fx.get(), 48000);
+    ysfx_set_block_size(fx.get(), block_size);
+
+    SECTION("disabled by default")
+    {
+        REQUIRE(ysfx_get_oversampling(fx.get()) == 1);
+        ysfx_init(fx.get());
+        REQUIRE(ysfx_get_pdc_delay(fx.get()) == 8);
+    }
+
+    SECTION("factor is rounded to a supported value")
+    {
+        ysfx_set_oversampling(fx.get(), 3);
+        REQUIRE(ysfx_get_oversampling(fx.get()) == 2);
+        ysfx_set_oversampling(fx.get(), 16);
+        REQUIRE(ysfx_get_oversampling(fx.get()) == 8);
+        ysfx_set_oversampling(fx.get(), 0);
+        REQUIRE(ysfx_get_oversampling(fx.get()) == 1);
+    }
+
+    for (uint32_t factor : {2u, 4u, 8u}) {
+        DYNAMIC_SECTION("factor " << factor)
+        {
+            ysfx_set_oversampling(fx.get(), factor);
+            ysfx_init(fx.get());
+
+            std::vector<float> in(block_size * 4);
+            std::vector<float> out(in.size());
+            in[0] = 1;
+            for (uint32_t i = 0; i < in.size(); i += block_size) {
+                const float *ins[] = {&in[i]};
+                float *outs[] = {&out[i]};
+                ysfx_process_float(fx.get(), ins, outs, 1, 1, block_size);
+            }
+
+            REQUIRE(ysfx_read_var(fx.get(), "rate") == 48000.0 * factor);
+            REQUIRE(ysfx_read_var(fx.get(), "frames") == block_size * factor);
+            REQUIRE(ysfx_read_var(fx.get(), "num_samples") == in.size() * factor);
+
+            // the impulse is delayed by the filters, and keeps unity gain
+            ysfx_real latency = ysfx_get_pdc_delay(fx.get());
+            ysfx_real pdc = 8.0 / factor;
+            REQUIRE(latency > pdc);
+            uint32_t peak = 0;
+            double sum = 0;
+            for (uint32_t i = 0; i < out.size(); ++i) {
+                if (out[i] > out[peak])
+                    peak = i;
+                sum += out[i];
+            }
+            REQUIRE(sum == Approx(1.0).margin(1e-3));
+            REQUIRE(std::fabs(peak - (latency - pdc)) <= 1.0);
+        }
+    }
+}
+
+TEST_CASE("delay compensation", "[process]")
+{
+    // the effect delays the first channel by 5, the others pass at once
+    const char *text =
+        "desc:example" "\n"
+        "in_pin:input 1" "\n"
+        "in_pin:input 2" "\n"
+        "in_pin:input 3" "\n"
+        "out_pin:output 1" "\n"
+        "out_pin:output 2" "\n"
+        "out_pin:output 3" "\n"
+        "@init" "\n"
+        "ext_nodenorm = 1;" "\n"
+        "pdc_delay = 5;" "\n"
+        "pdc_bot_ch = 0;" "\n"
+        "pdc_top_ch = 1;" "\n"
+        "buf = 0; pos = 0;" "\n"
+        "@block" "\n"
+        "grow ? pdc_delay = 20;" "\n"
+        "@sample" "\n"
+        "tmp = buf[pos]; buf[pos] = spl0; spl0 = tmp;" "\n"
+        "pos = (pos + 1) % 5;" "\n";
+
+    scoped_new_dir dir_fx("${root}/Effects");
+    scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+
+    ysfx_config_u config{ysfx_config_new()};
+    ysfx_u fx{ysfx_new(config.get())};
+
+    REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+    REQUIRE(ysfx_compile(fx.get(), 0));
+
+    const uint32_t block_size = 16;
+    ysfx_set_block_size(fx.get(), block_size);
+
+    // an impulse at the start, on every channel, and one more channel than the pins
+    const uint32_t num_channels = 4;
+    ysfx_set_pdc_capacity(fx.get(), num_channels, 0);
+    const uint32_t num_blocks = 3;
+    std::vector<std::vector<float>> out(num_channels, std::vector<float>(block_size * num_blocks));
+    auto run = [&]() {
+        std::vector<float> in(block_size * num_blocks);
+        in[0] = 1;
+        for (uint32_t i = 0; i < in.size(); i += block_size) {
+            const float *ins[num_channels];
+            float *outs[num_channels];
+            for (uint32_t ch = 0; ch < num_channels; ++ch) {
+                ins[ch] = &in[i];
+                outs[ch] = &out[ch][i];
+            }
+            ysfx_process_float(fx.get(), ins, outs, num_channels, num_channels, block_size);
+        }
+    };
+    auto impulse_at = [&](uint32_t ch) -> uint32_t {
+        for (uint32_t i = 0; i < out[ch].size(); ++i) {
+            if (out[ch][i] != 0)
+                return (out[ch][i] == 1) ? i : ~(uint32_t)0;
+        }
+        return ~(uint32_t)0;
+    };
+
+    SECTION("disabled by default")
+    {
+        ysfx_init(fx.get());
+        run();
+        REQUIRE(impulse_at(0) == 5);
+        for (uint32_t ch = 1; ch < num_channels; ++ch)
+            REQUIRE(impulse_at(ch) == 0);
+    }
+
+    SECTION("aligns the channels outside of the range")
+    {
+        ysfx_set_pdc_compensation(fx.get(), true);
+        ysfx_init(fx.get());
+        uint32_t channels[2];
+        ysfx_get_pdc_channels(fx.get(), channels);
+        REQUIRE(channels[0] == 0);
+        REQUIRE(channels[1] == 1);
+        run();
+        for (uint32_t ch = 0; ch < num_channels; ++ch)
+            REQUIRE(impulse_at(ch) == 5);
+    }
+
+    SECTION("idle while the range is empty")
+    {
+        ysfx_set_pdc_compensation(fx.get(), true);
+        ysfx_init(fx.get());
+        *ysfx_find_var(fx.get(), "pdc_top_ch") = 0;
+        run();
+        for (uint32_t ch = 1; ch < num_channels; ++ch)
+            REQUIRE(impulse_at(ch) == 0);
+    }
+
+    SECTION("keeps to the capacity while processing")
+    {
+        // the lines have room for the 5 frames of @init, rounded to 8, and the delay which grows is shortened
+        ysfx_set_pdc_compensation(fx.get(), true);
+        ysfx_init(fx.get());
+        *ysfx_find_var(fx.get(), "grow") = 1;
+        run();
+        REQUIRE(ysfx_get_pdc_delay(fx.get()) == 20);
+        for (uint32_t ch = 1; ch < num_channels; ++ch)
+            REQUIRE(impulse_at(ch) == 7);
+    }
+
+    SECTION("reserves the capacity of the host")
+    {
+        ysfx_set_pdc_compensation(fx.get(), true);
+        ysfx_set_pdc_capacity(fx.get(), num_channels, 20);
+        ysfx_init(fx.get());
+        *ysfx_find_var(fx.get(), "grow") = 1;
+        run();
+        for (uint32_t ch = 1; ch < num_channels; ++ch)
+            REQUIRE(impulse_at(ch) == 20);
+    }
+
+    SECTION("does not delay the channels beyond the capacity")
+    {
+        ysfx_set_pdc_compensation(fx.get(), true);
+        ysfx_set_pdc_capacity(fx.get(), 0, 0);
+        ysfx_init(fx.get());
+        run();
+        for (uint32_t ch = 1; ch < 3; ++ch)
+            REQUIRE(impulse_at(ch) == 5);
+        REQUIRE(impulse_at(3) == 0);
+    }
+}
+
+TEST_CASE("frame loop", "[process]")
+{
+    auto check = [](const char *text, bool loops) {
+        std::string source =
+            "desc:example" "\n"
+            "in_pin:input 1" "\n"
+            "in_pin:input 2" "\n"
+            "out_pin:output 1" "\n"
+            "out_pin:output 2" "\n"
+            "@midi" "\n"
+            "notes += 1;" "\n"
+            "@sample" "\n";
+        source.append(text);
+
+        scoped_new_dir dir_fx("${root}/Effects");
+        scoped_new_txt file_main("${root}/Effects/example.jsfx", source.c_str());
+
+        ysfx_config_u config{ysfx_config_new()};
+        ysfx_u generic{ysfx_new(config.get())};
+        ysfx_u looped{ysfx_new(config.get())};
+
+        REQUIRE(ysfx_load_file(generic.get(), file_main.m_path.c_str(), 0));
+        REQUIRE(ysfx_compile(generic.get(), 0));
+        REQUIRE(ysfx_load_file(looped.get(), file_main.m_path.c_str(), 0));
+        REQUIRE(ysfx_compile(looped.get(), ysfx_compile_frame_loop));
+        REQUIRE(!generic->code.sample_loop);
+        REQUIRE((looped->code.sample_loop != nullptr) == loops);
+        ysfx_init(generic.get());
+        ysfx_init(looped.get());
+
+        const uint32_t num_frames = 64;
+        std::vector<float> in(2 * num_frames);
+        for (uint32_t i = 0; i < in.size(); ++i)
+            in[i] = (float)std::cos(i * 0.1);
+        float out_generic[2 * num_frames] = {};
+        float out_looped[2 * num_frames] = {};
+        const float *ins[] = {&in[0], &in[num_frames]};
+        float *outs_generic[] = {&out_generic[0], &out_generic[num_frames]};
+        float *outs_looped[] = {&out_looped[0], &out_looped[num_frames]};
+
+        // the events run between the frames, in either mode
+        const uint8_t data[] = {0x90, 60, 0x40};
+        for (uint32_t round = 0; round < 4; ++round) {
+            for (ysfx_t *fx : {generic.get(), looped.get()}) {
+                for (uint32_t offset : {0u, 5u + round, 40u}) {
+                    ysfx_midi_event_t event{};
+                    event.offset = offset;
+                    event.size = sizeof(data);
+                    event.data = data;
+                    REQUIRE(ysfx_send_midi(fx, &event));
+                }
+            }
+            ysfx_process_float(generic.get(), ins, outs_generic, 2, 2, num_frames);
+            ysfx_process_float(looped.get(), ins, outs_looped, 2, 2, num_frames);
+            for (uint32_t i = 0; i < 2 * num_frames; ++i)
+                REQUIRE(out_generic[i] == out_looped[i]);
+        }
+    };
+
+    SECTION("in a loop")
+    {
+        check(
+            "n += 1;" "\n"
+            "spl0 = spl0 * 0.5 + spl1 * notes;" "\n"
+            "spl1 = sin(n * 0.01) // no semicolon" "\n",
+            true);
+    }
+
+    SECTION("per frame, with a function")
+    {
+        check(
+            "function f(x) ( x * 0.5 );" "\n"
+            "n += 1;" "\n"
+            "spl0 = f(spl0) + spl1 * notes;" "\n"
+            "spl1 = sin(n * 0.01);" "\n",
+            false);
+    }
+}
+
+TEST_CASE("capabilities", "[process]")
+{
+    auto capabilities = [](const char *code) -> uint32_t {
+        std::string text =
+            "desc:example" "\n"
+            "slider1:0<0,1,0.01>first" "\n"
+            "slider2:gain=0<0,1,0.01>second" "\n"
+            "out_pin:output" "\n";
+        text.append(code);
+
+        scoped_new_dir dir_fx("${root}/Effects");
+        scoped_new_txt file_main("${root}/Effects/example.jsfx", text.c_str());
+
+        ysfx_config_u config{ysfx_config_new()};
+        ysfx_u fx{ysfx_new(config.get())};
+        REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+        REQUIRE(ysfx_get_capabilities(fx.get()) == 0);
+        REQUIRE(ysfx_compile(fx.get(), 0));
+        return ysfx_get_capabilities(fx.get());
+    };
+
+    REQUIRE(capabilities(
+        "@slider" "\n"
+        "g = slider1 * 2 + gain;" "\n"
+        "@sample" "\n"
+        "// tempo, midisend(0, 0x90, 60, 0x40);" "\n"
+        "spl0 = g * sin(x += 0.01); s = \"play_position\";" "\n") == 0);
+
+    REQUIRE(capabilities(
+        "@midi" "\n"
+        "x += 1;" "\n") == ysfx_capability_midi_in);
+    REQUIRE(capabilities(
+        "@block" "\n"
+        "while (midirecv(offset, msg1, msg2, msg3)) (midisend(offset, msg1, msg2, msg3));" "\n") ==
+            (ysfx_capability_midi_in|ysfx_capability_midi_out));
+
+    REQUIRE(capabilities(
+        "@block" "\n"
+        "beats = beat_position * Tempo;" "\n") == ysfx_capability_transport);
+    REQUIRE(capabilities(
+        "@init" "\n"
+        "function f() ( _global.ts_num );" "\n") == ysfx_capability_transport);
+
+    REQUIRE(capabilities(
+        "@block" "\n"
+        "slider1 += 0.1;" "\n") == ysfx_capability_slider_output);
+    REQUIRE(capabilities(
+        "@block" "\n"
+        "GAIN = 0.5;" "\n") == ysfx_capability_slider_output);
+    REQUIRE(capabilities(
+        "@serialize" "\n"
+        "file_var(0, slider1);" "\n") == ysfx_capability_slider_output);
+    REQUIRE(capabilities(
+        "@block" "\n"
+        "slider_automate(2);" "\n") == ysfx_capability_slider_output);
+
+    REQUIRE(capabilities(
+        "@init" "\n"
+        "pdc_delay = 64;" "\n") == ysfx_capability_latency);
+
+    // the code which `eval` runs is in a string, so it could be anything
+    REQUIRE(capabilities(
+        "@block" "\n"
+        "eval(\"midisend(0, 0x90, 60, 0x40);\");" "\n") ==
+            (ysfx_capability_midi_in|ysfx_capability_midi_out|ysfx_capability_transport|
+             ysfx_capability_slider_output|ysfx_capability_latency));
+}
+
+TEST_CASE("midi through eval", "[process]")
+{
+    const char *text =
+        "desc:example" "\n"
+        "out_pin:output" "\n"
+        "@block" "\n"
+        "eval(\"while(midirecv(o,m1,m2,m3)) (cnt+=1; midisend(o,m1,m2,m3));\");" "\n";
+
+    scoped_new_dir dir_fx("${root}/Effects");
+    scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+
+    ysfx_config_u config{ysfx_config_new()};
+    ysfx_u fx{ysfx_new(config.get())};
+    REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+    REQUIRE(ysfx_compile(fx.get(), 0));
+    ysfx_init(fx.get());
+
+    const uint8_t data[] = {0x90, 60, 0x40};
+    ysfx_midi_event_t event{};
+    event.offset = 3;
+    event.size = sizeof(data);
+    event.data = data;
+    REQUIRE(ysfx_send_midi(fx.get(), &event));
+
+    float out[16] = {};
+    float *outs[] = {out};
+    ysfx_process_float(fx.get(), nullptr, outs, 0, 1, 16);
+
+    REQUIRE(*ysfx_find_var(fx.get(), "cnt") == 1);
+    ysfx_midi_event_t received{};
+    REQUIRE(ysfx_receive_midi(fx.get(), &received));
+    REQUIRE(received.offset == 3);
+    REQUIRE(received.size == 3);
+    REQUIRE(received.data[0] == 0x90);
+    REQUIRE(!ysfx_receive_midi(fx.get(), &received));
+}
+
+TEST_CASE("midi which the code cannot receive", "[process]")
+{
+    const char *text =
+        "desc:example" "\n"
+        "out_pin:output" "\n"
+        "@block" "\n"
+        "num_blocks += 1;" "\n";
+
+    scoped_new_dir dir_fx("${root}/Effects");
+    scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+
+    ysfx_config_u config{ysfx_config_new()};
+    ysfx_u fx{ysfx_new(config.get())};
+    REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+    REQUIRE(ysfx_compile(fx.get(), 0));
+    ysfx_init(fx.get());
+
+    // the events do not split the cycle
+    ysfx_set_sample_accurate(fx.get(), 1);
+    const uint8_t data[] = {0x90, 60, 0x40};
+    for (uint32_t offset : {3u, 7u}) {
+        ysfx_midi_event_t event{};
+        event.offset = offset;
+        event.size = sizeof(data);
+        event.data = data;
+        REQUIRE(ysfx_send_midi(fx.get(), &event));
+    }
+    float out[16] = {};
+    float *outs[] = {out};
+    ysfx_process_float(fx.get(), nullptr, outs, 0, 1, 16);
+
+    ysfx_real *num_blocks = ysfx_find_var(fx.get(), "num_blocks");
+    REQUIRE(num_blocks);
+    REQUIRE(*num_blocks == 1);
+}
@@ -0,0 +1,99 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "ysfx.h"
+#include "ysfx_test_utils.hpp"
+#include <catch.hpp>
+#include <vector>
+
+TEST_CASE("batch processing", "[process]")
+{
+    // every instance counts its cycles, and scales by its own gain
+    const char *text =
+        "desc:example" "\n"
+        "slider1:1<0,100,1>gain" "\n"
+        "in_pin:input" "\n"
+        "out_pin:output" "\n"
+        "@init" "\n"
+        "ext_nodenorm = 1;" "\n"
+        "cycles = 0;" "\n"
+        "@block" "\n"
+        "cycles += 1;" "\n"
+        "@sample" "\n"
+        "spl0 = spl0 * slider1 + cycles;" "\n";
+
+    scoped_new_dir dir_fx("${root}/Effects");
+    scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+
+    ysfx_config_u config{ysfx_config_new()};
+
+    const uint32_t num_effects = 37;
+    const uint32_t num_frames = 16;
+    std::vector<ysfx_u> effects;
+    for (uint32_t i = 0; i < num_effects; ++i) {
+        ysfx_u fx{ysfx_new(config.get())};
+        REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+        REQUIRE(ysfx_compile(fx.get(), 0));
+        ysfx_set_block_size(fx.get(), num_frames);
+        ysfx_init(fx.get());
+        ysfx_slider_set_value(fx.get(), 0, (ysfx_real)i, true);
+        effects.push_back(std::move(fx));
+    }
+
+    std::vector<float> in(num_frames);
+    for (uint32_t f = 0; f < num_frames; ++f)
+        in[f] = (float)f;
+    const float *ins[] = {in.data()};
+
+    std::vector<std::vector<float>> out(num_effects, std::vector<float>(num_frames));
+    std::vector<float *> outs(num_effects);
+    std::vector<ysfx_process_job_t> jobs(num_effects);
+    for (uint32_t i = 0; i < num_effects; ++i) {
+        outs[i] = out[i].data();
+        jobs[i] = {effects[i].get(), ins, &outs[i], 1, 1};
+    }
+
+    auto check = [&](uint32_t cycles) {
+        for (uint32_t i = 0; i < num_effects; ++i) {
+            for (uint32_t f = 0; f < num_frames; ++f)
+                REQUIRE(out[i][f] == in[f] * i + cycles);
+        }
+    };
+
+    uint32_t cycles = 0;
+    SECTION("without a pool")
+    {
+        for (; cycles < 3; ) {
+            ysfx_process_many(nullptr, jobs.data(), num_effects, num_frames);
+            check(++cycles);
+        }
+    }
+
+    for (uint32_t num_threads : {1u, 2u, 4u}) {
+        DYNAMIC_SECTION("threads " << num_threads)
+        {
+            ysfx_process_pool_u pool{ysfx_process_pool_new(num_threads)};
+            for (; cycles < 10; ) {
+                ysfx_process_many(pool.get(), jobs.data(), num_effects, num_frames);
+                check(++cycles);
+            }
+            // fewer jobs than the threads
+            ysfx_process_many(pool.get(), jobs.data(), 1, num_frames);
+            REQUIRE(out[0][0] == cycles + 1);
+        }
+    }
+}
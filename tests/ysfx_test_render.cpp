@@ -0,0 +1,268 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "ysfx.h"
+#include "ysfx_test_utils.hpp"
+#include "tools/ysfx_bench_corpus.hpp"
+#include <catch.hpp>
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+// The regression of the output of the corpus: a fixed input goes through
+// every effect, and the loudness of each window of the output is compared
+// with a golden file, within a tolerance, since the math library differs
+// between platforms.
+//
+// To write the golden files again, run with YSFX_TEST_UPDATE_GOLDEN=1.
+//
+// The time of the processing is compared with a baseline of the machine, as
+// it does not carry over between machines: YSFX_TEST_PERF_BASELINE names the
+// file, which the update writes too, and YSFX_TEST_PERF_TOLERANCE gives the
+// regression which is allowed, in percent, 10 by default.
+
+static const uint32_t render_channels = 2;
+static const uint32_t render_block = 256;
+static const ysfx_real render_rate = 48000;
+static const uint32_t render_frames = 96000;
+static const uint32_t render_window = 4096;
+
+struct render_result {
+    // the RMS of each channel, by window
+    std::vector<double> rms;
+    uint64_t midi_events = 0;
+    double ns_per_sample = 0;
+};
+
+static ysfx_t *render_load(const bench_effect &effect, const std::string &path)
+{
+    std::string text = "desc:render" "\n";
+    for (uint32_t ch = 0; ch < render_channels; ++ch)
+        text += "in_pin:input " + std::to_string(ch + 1) + "\n";
+    for (uint32_t ch = 0; ch < render_channels; ++ch)
+        text += "out_pin:output " + std::to_string(ch + 1) + "\n";
+    text += effect.code;
+
+    scoped_new_txt file_main(path, text.c_str());
+    ysfx_config_u config{ysfx_config_new()};
+    ysfx_u fx{ysfx_new(config.get())};
+    REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+    REQUIRE(ysfx_compile(fx.get(), 0));
+    ysfx_set_block_size(fx.get(), render_block);
+    ysfx_set_sample_rate(fx.get(), render_rate);
+    ysfx_init(fx.get());
+    return fx.release();
+}
+
+template <class Real>
+static void render_process(ysfx_t *fx, const Real *const *ins, Real *const *outs, uint32_t frames);
+
+template <>
+void render_process<float>(ysfx_t *fx, const float *const *ins, float *const *outs, uint32_t frames)
+{
+    ysfx_process_float(fx, ins, outs, render_channels, render_channels, frames);
+}
+
+template <>
+void render_process<double>(ysfx_t *fx, const double *const *ins, double *const *outs, uint32_t frames)
+{
+    ysfx_process_double(fx, ins, outs, render_channels, render_channels, frames);
+}
+
+// a noise which is the same everywhere, and a chord which changes every block of a window
+template <class Real>
+static render_result render_effect(const bench_effect &effect)
+{
+    ysfx_u fx{render_load(effect, "${root}/Effects/render.jsfx")};
+
+    std::vector<Real> buffer(2 * render_channels * render_block);
+    const Real *ins[render_channels];
+    Real *outs[render_channels];
+    for (uint32_t ch = 0; ch < render_channels; ++ch) {
+        ins[ch] = &buffer[ch * render_block];
+        outs[ch] = &buffer[(render_channels + ch) * render_block];
+    }
+
+    render_result result;
+    std::vector<double> sums(render_channels);
+    uint32_t seed = 1;
+    uint64_t ns = 0;
+
+    for (uint32_t frame = 0; frame < render_frames; frame += render_block) {
+        for (uint32_t i = 0; i < render_channels * render_block; ++i) {
+            seed = seed * 1103515245u + 12345u;
+            buffer[i] = (Real)((double)(seed >> 8) / (1u << 24) - 0.5);
+        }
+        if (frame % render_window == 0) {
+            const uint8_t root = (uint8_t)(48 + (frame / render_window) % 12);
+            const uint8_t last = (uint8_t)(48 + (frame / render_window + 11) % 12);
+            for (uint8_t interval : {0, 4, 7}) {
+                const uint8_t off[3] = {0x80, (uint8_t)(last + interval), 0};
+                const uint8_t on[3] = {0x90, (uint8_t)(root + interval), 100};
+                ysfx_midi_event_t event{0, 0, 3, off};
+                ysfx_send_midi(fx.get(), &event);
+                event.data = on;
+                ysfx_send_midi(fx.get(), &event);
+            }
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        render_process<Real>(fx.get(), ins, outs, render_block);
+        ns += (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+        ysfx_midi_event_t event;
+        while (ysfx_receive_midi(fx.get(), &event))
+            ++result.midi_events;
+
+        for (uint32_t ch = 0; ch < render_channels; ++ch) {
+            for (uint32_t i = 0; i < render_block; ++i)
+                sums[ch] += (double)outs[ch][i] * (double)outs[ch][i];
+        }
+        if ((frame + render_block) % render_window == 0) {
+            for (uint32_t ch = 0; ch < render_channels; ++ch) {
+                result.rms.push_back(std::sqrt(sums[ch] / render_window));
+                sums[ch] = 0;
+            }
+        }
+    }
+
+    result.ns_per_sample = (double)ns / ((double)render_frames * render_channels);
+    return result;
+}
+
+static bool render_env_flag(const char *name)
+{
+    const char *value = getenv(name);
+    return value && value[0] != '\0' && value[0] != '0';
+}
+
+static std::string render_golden_path(const bench_effect &effect)
+{
+    return std::string(YSFX_TEST_GOLDEN_DIR) + "/render/" + effect.name + ".txt";
+}
+
+static bool render_read_golden(const std::string &path, render_result &golden)
+{
+    FILE *stream = fopen(path.c_str(), "rb");
+    if (!stream)
+        return false;
+    char line[256];
+    while (fgets(line, sizeof(line), stream)) {
+        unsigned long long count;
+        double value;
+        if (line[0] == '#')
+            continue;
+        else if (sscanf(line, "midi %llu", &count) == 1)
+            golden.midi_events = count;
+        else if (sscanf(line, "%lf", &value) == 1)
+            golden.rms.push_back(value);
+    }
+    fclose(stream);
+    return true;
+}
+
+static void render_write_golden(const std::string &path, const bench_effect &effect, const render_result &result)
+{
+    FILE *stream = fopen(path.c_str(), "wb");
+    REQUIRE(stream);
+    fprintf(stream, "# %s: %u channels, %.0f Hz, blocks of %u, %u frames\n", effect.name, render_channels, render_rate, render_block, render_frames);
+    fprintf(stream, "# the RMS of each channel in windows of %u frames, then the count of MIDI events out\n", render_window);
+    for (double value : result.rms)
+        fprintf(stream, "%.9e\n", value);
+    fprintf(stream, "midi %llu\n", (unsigned long long)result.midi_events);
+    fclose(stream);
+}
+
+TEST_CASE("render regression", "[render]")
+{
+    scoped_new_dir dir_fx("${root}/Effects");
+
+    const bool update = render_env_flag("YSFX_TEST_UPDATE_GOLDEN");
+    const char *baseline_path = getenv("YSFX_TEST_PERF_BASELINE");
+    const char *tolerance_text = getenv("YSFX_TEST_PERF_TOLERANCE");
+    const double perf_tolerance = tolerance_text ? strtod(tolerance_text, nullptr) : 10.0;
+
+    // the baseline of the machine, by effect
+    std::map<std::string, double> baseline;
+    if (baseline_path && !update) {
+        FILE *stream = fopen(baseline_path, "rb");
+        REQUIRE(stream);
+        char name[64];
+        double ns;
+        while (fscanf(stream, "%63s %lf", name, &ns) == 2)
+            baseline[name] = ns;
+        fclose(stream);
+    }
+    std::map<std::string, double> measured;
+
+    for (const bench_effect &effect : bench_effects) {
+        INFO("effect: " << effect.name);
+
+        render_result result = render_effect<double>(effect);
+        std::string path = render_golden_path(effect);
+
+        if (update)
+            render_write_golden(path, effect, result);
+        else {
+            render_result golden;
+            REQUIRE(render_read_golden(path, golden));
+            REQUIRE(golden.midi_events == result.midi_events);
+            REQUIRE(golden.rms.size() == result.rms.size());
+            for (size_t i = 0; i < golden.rms.size(); ++i) {
+                INFO("window " << i / render_channels << ", channel " << i % render_channels);
+                REQUIRE(std::fabs(result.rms[i] - golden.rms[i]) <= 1e-9 + 1e-6 * std::fabs(golden.rms[i]));
+            }
+        }
+
+        // the float path agrees with the double path, to the precision of float
+        render_result single = render_effect<float>(effect);
+        REQUIRE(single.midi_events == result.midi_events);
+        REQUIRE(single.rms.size() == result.rms.size());
+        for (size_t i = 0; i < result.rms.size(); ++i) {
+            INFO("window " << i / render_channels << ", channel " << i % render_channels);
+            REQUIRE(std::fabs(single.rms[i] - result.rms[i]) <= 1e-6 + 1e-4 * std::fabs(result.rms[i]));
+        }
+
+        // the best of a few renders, which is the least disturbed by the machine
+        if (baseline_path) {
+            double ns = std::min(result.ns_per_sample, single.ns_per_sample);
+            for (int i = 0; i < 2; ++i)
+                ns = std::min(ns, render_effect<double>(effect).ns_per_sample);
+            measured[effect.name] = ns;
+            if (!update) {
+                auto it = baseline.find(effect.name);
+                REQUIRE(it != baseline.end());
+                INFO("ns per sample: " << ns << ", baseline: " << it->second);
+                // a nanosecond more, for the effects which cost next to nothing
+                REQUIRE(ns <= it->second * (1 + perf_tolerance / 100) + 1);
+            }
+        }
+    }
+
+    if (baseline_path && update) {
+        FILE *stream = fopen(baseline_path, "wb");
+        REQUIRE(stream);
+        for (const auto &item : measured)
+            fprintf(stream, "%s %.3f\n", item.first.c_str(), item.second);
+        fclose(stream);
+    }
+}
@@ -0,0 +1,421 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "ysfx.h"
+#include "ysfx.hpp"
+#include "ysfx_config.hpp"
+#include "ysfx_test_utils.hpp"
+#include "tools/ysfx_bench_corpus.hpp"
+#include <catch.hpp>
+#include <atomic>
+#include <new>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+// The checker of the real-time safety: while a thread is inside the
+// processing, as marked by `ysfx_set_thread_id`, the calls which allocate or
+// which lock are recorded with their backtrace. On glibc, the functions of the
+// C library are interposed, which covers the operators `new` and `delete` and
+// the mutexes; elsewhere, only the operators `new` and `delete` are replaced.
+
+#if defined(__GLIBC__) && !defined(__SANITIZE_ADDRESS__)
+#   define YSFX_TEST_RT_INTERPOSE_LIBC 1
+#   include <execinfo.h>
+#   include <pthread.h>
+#   include <dlfcn.h>
+#endif
+
+namespace {
+
+enum rt_violation_kind {
+    rt_violation_alloc,
+    rt_violation_free,
+    rt_violation_lock,
+};
+
+struct rt_violation {
+    rt_violation_kind kind;
+    int depth;
+    void *frames[32];
+};
+
+// the records are preallocated, the checker must not allocate itself
+static const uint32_t rt_max_violations = 16;
+static rt_violation rt_violations[rt_max_violations];
+static std::atomic<uint32_t> rt_num_violations{0};
+static std::atomic<bool> rt_armed{false};
+static thread_local bool rt_recording = false;
+
+static void rt_check(rt_violation_kind kind)
+{
+    if (!rt_armed.load(std::memory_order_relaxed) || rt_recording)
+        return;
+    if (ysfx_get_thread_id() != ysfx_thread_id_dsp)
+        return;
+
+    rt_recording = true;
+    uint32_t index = rt_num_violations.fetch_add(1);
+    if (index < rt_max_violations) {
+        rt_violation &v = rt_violations[index];
+        v.kind = kind;
+#if defined(YSFX_TEST_RT_INTERPOSE_LIBC)
+        v.depth = backtrace(v.frames, (int)(sizeof(v.frames) / sizeof(v.frames[0])));
+#else
+        v.depth = 0;
+#endif
+    }
+    rt_recording = false;
+}
+
+static void rt_arm()
+{
+    rt_num_violations.store(0);
+    rt_armed.store(true);
+}
+
+static uint32_t rt_disarm()
+{
+    rt_armed.store(false);
+    return rt_num_violations.load();
+}
+
+static void rt_report(const char *name)
+{
+    static const char *const kinds[] = {"allocation", "deallocation", "lock"};
+    uint32_t count = rt_num_violations.load();
+    fprintf(stderr, "%s: %u violation(s) of the real-time safety in the processing\n", name, count);
+    if (count > rt_max_violations)
+        count = rt_max_violations;
+    for (uint32_t i = 0; i < count; ++i) {
+        const rt_violation &v = rt_violations[i];
+        fprintf(stderr, "#%u: %s\n", i + 1, kinds[v.kind]);
+#if defined(YSFX_TEST_RT_INTERPOSE_LIBC)
+        fflush(stderr);
+        backtrace_symbols_fd(v.frames, v.depth, 2);
+#endif
+    }
+}
+
+} // namespace
+
+#if defined(YSFX_TEST_RT_INTERPOSE_LIBC)
+extern "C" {
+
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void __libc_free(void *ptr);
+
+void *malloc(size_t size)
+{
+    rt_check(rt_violation_alloc);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size)
+{
+    rt_check(rt_violation_alloc);
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    rt_check(rt_violation_alloc);
+    return __libc_realloc(ptr, size);
+}
+
+void free(void *ptr)
+{
+    if (ptr)
+        rt_check(rt_violation_free);
+    __libc_free(ptr);
+}
+
+// the next definition is found before the tests run, since dlsym can allocate
+static int (*rt_next_mutex_lock)(pthread_mutex_t *) =
+    (int (*)(pthread_mutex_t *))dlsym(RTLD_NEXT, "pthread_mutex_lock");
+
+int pthread_mutex_lock(pthread_mutex_t *mutex)
+{
+    rt_check(rt_violation_lock);
+    return rt_next_mutex_lock(mutex);
+}
+
+} // extern "C"
+
+// the first backtrace loads the unwinder, which allocates; do it up front
+static const int rt_backtrace_preload = []() {
+    void *frame;
+    return backtrace(&frame, 1);
+}();
+#else
+void *operator new(size_t size)
+{
+    rt_check(rt_violation_alloc);
+    if (void *ptr = malloc(size ? size : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *ptr) noexcept
+{
+    if (ptr)
+        rt_check(rt_violation_free);
+    free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    operator delete(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+    operator delete(ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept
+{
+    operator delete(ptr);
+}
+#endif
+
+//------------------------------------------------------------------------------
+static void rt_send_notes(ysfx_t *fx, uint64_t block_index)
+{
+    const uint8_t root = (uint8_t)(48 + block_index % 12);
+    const uint8_t last = (uint8_t)(48 + (block_index + 11) % 12);
+    const uint8_t intervals[3] = {0, 4, 7};
+    for (uint8_t interval : intervals) {
+        const uint8_t off[3] = {0x80, (uint8_t)(last + interval), 0};
+        const uint8_t on[3] = {0x90, (uint8_t)(root + interval), 100};
+        ysfx_midi_event_t event{0, 0, 3, off};
+        ysfx_send_midi(fx, &event);
+        event.data = on;
+        ysfx_send_midi(fx, &event);
+    }
+}
+
+template <class Real>
+static void rt_process(ysfx_t *fx, const Real *const *ins, Real *const *outs, uint32_t channels, uint32_t block);
+
+template <>
+void rt_process<float>(ysfx_t *fx, const float *const *ins, float *const *outs, uint32_t channels, uint32_t block)
+{
+    ysfx_process_float(fx, ins, outs, channels, channels, block);
+}
+
+template <>
+void rt_process<double>(ysfx_t *fx, const double *const *ins, double *const *outs, uint32_t channels, uint32_t block)
+{
+    ysfx_process_double(fx, ins, outs, channels, channels, block);
+}
+
+// processes for a while first, since the memory of the VM comes into use, and
+// the first processing of a block size, which is allowed to allocate; then it
+// checks the same processing in the steady state
+template <class Real>
+static uint32_t rt_check_effect(ysfx_t *fx, uint32_t channels, uint32_t block, uint32_t num_blocks)
+{
+    std::vector<Real> buffer(2 * channels * block);
+    std::vector<const Real *> ins(channels);
+    std::vector<Real *> outs(channels);
+    for (uint32_t ch = 0; ch < channels; ++ch) {
+        ins[ch] = &buffer[ch * block];
+        outs[ch] = &buffer[(channels + ch) * block];
+    }
+
+    uint32_t seed = 1;
+    auto fill = [&]() {
+        for (uint32_t i = 0; i < channels * block; ++i) {
+            seed = seed * 1103515245u + 12345u;
+            buffer[i] = (Real)((double)(seed >> 8) / (1u << 24) - 0.5);
+        }
+    };
+
+    for (uint32_t b = 0; b < num_blocks; ++b) {
+        fill();
+        rt_send_notes(fx, b);
+        rt_process<Real>(fx, ins.data(), outs.data(), channels, block);
+    }
+
+    uint32_t count = 0;
+    for (uint32_t b = 0; b < num_blocks; ++b) {
+        fill();
+        rt_send_notes(fx, b);
+        rt_arm();
+        rt_process<Real>(fx, ins.data(), outs.data(), channels, block);
+        count += rt_disarm();
+        if (count > 0)
+            break;
+    }
+    return count;
+}
+
+TEST_CASE("real-time safety of the processing", "[rt]")
+{
+    SECTION("the checker detects an allocation")
+    {
+        void *(*volatile alloc)(size_t) = &malloc;
+        void (*volatile dealloc)(void *) = &free;
+
+        rt_arm();
+        void *ptr = alloc(16);
+        REQUIRE(rt_disarm() == 0);
+        dealloc(ptr);
+
+        ysfx_set_thread_id(ysfx_thread_id_dsp);
+        rt_arm();
+        ptr = alloc(16);
+        dealloc(ptr);
+        uint32_t count = rt_disarm();
+        ysfx_set_thread_id(ysfx_thread_id_none);
+#if defined(YSFX_TEST_RT_INTERPOSE_LIBC)
+        REQUIRE(count == 2);
+#else
+        // only the operators are replaced
+        (void)count;
+#endif
+    }
+
+    SECTION("the corpus processes without allocating or locking")
+    {
+        const uint32_t channels = 2;
+        const uint32_t block = 256;
+        const uint32_t num_blocks = 200;
+
+        for (const bench_effect &effect : bench_effects) {
+            std::string text = "desc:rt" "\n";
+            for (uint32_t ch = 0; ch < channels; ++ch)
+                text += "in_pin:input " + std::to_string(ch + 1) + "\n";
+            for (uint32_t ch = 0; ch < channels; ++ch)
+                text += "out_pin:output " + std::to_string(ch + 1) + "\n";
+            text += effect.code;
+
+            scoped_new_dir dir_fx("${root}/Effects");
+            scoped_new_txt file_main("${root}/Effects/rt.jsfx", text.c_str());
+
+            ysfx_config_u config{ysfx_config_new()};
+            ysfx_u fx{ysfx_new(config.get())};
+            REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+            REQUIRE(ysfx_compile(fx.get(), 0));
+            ysfx_set_block_size(fx.get(), block);
+            ysfx_set_sample_rate(fx.get(), 48000);
+            ysfx_init(fx.get());
+
+            INFO("effect: " << effect.name);
+
+            uint32_t count = rt_check_effect<float>(fx.get(), channels, block, num_blocks);
+            if (count > 0)
+                rt_report(effect.name);
+            REQUIRE(count == 0);
+
+            count = rt_check_effect<double>(fx.get(), channels, block, num_blocks);
+            if (count > 0)
+                rt_report(effect.name);
+            REQUIRE(count == 0);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+namespace {
+
+struct rt_log_record {
+    std::mutex mutex;
+    std::vector<std::pair<ysfx_log_level, std::string>> messages;
+};
+
+static void rt_log_reporter(intptr_t userdata, ysfx_log_level level, const char *message)
+{
+    rt_log_record &record = *(rt_log_record *)userdata;
+    std::lock_guard<std::mutex> lock{record.mutex};
+    record.messages.emplace_back(level, message);
+}
+
+} // namespace
+
+TEST_CASE("logging from the processing", "[rt]")
+{
+    rt_log_record record;
+    ysfx_config_u config{ysfx_config_new()};
+    ysfx_set_log_reporter(config.get(), &rt_log_reporter);
+    ysfx_set_user_data(config.get(), (intptr_t)&record);
+
+    SECTION("the log is queued without allocating or locking")
+    {
+        ysfx_set_thread_id(ysfx_thread_id_dsp);
+        rt_arm();
+        ysfx_logf(*config, ysfx_log_warning, "message %d", 1);
+        ysfx_log(*config, ysfx_log_info, "message 2");
+        uint32_t count = rt_disarm();
+        ysfx_set_thread_id(ysfx_thread_id_none);
+        REQUIRE(count == 0);
+        REQUIRE(record.messages.empty());
+
+        config->log_queue->drain();
+        REQUIRE(record.messages.size() == 2);
+        REQUIRE(record.messages[0].first == ysfx_log_warning);
+        REQUIRE(record.messages[0].second == "message 1");
+        REQUIRE(record.messages[1].first == ysfx_log_info);
+        REQUIRE(record.messages[1].second == "message 2");
+    }
+
+    SECTION("the excess is dropped and counted")
+    {
+        const uint32_t total = 1000;
+        ysfx_set_thread_id(ysfx_thread_id_dsp);
+        for (uint32_t i = 0; i < total; ++i)
+            ysfx_log(*config, ysfx_log_info, "chatty");
+        ysfx_set_thread_id(ysfx_thread_id_none);
+
+        config->log_queue->drain();
+        // at most the capacity, since nothing delivers meanwhile, and the count of the dropped
+        REQUIRE(record.messages.size() <= (size_t)ysfx_log_queue_t::capacity + 1);
+        const std::pair<ysfx_log_level, std::string> &last = record.messages.back();
+        REQUIRE(last.first == ysfx_log_warning);
+        REQUIRE(last.second == std::to_string(total - (record.messages.size() - 1)) + " messages of the processing were dropped");
+    }
+
+    SECTION("the thread delivers in the background")
+    {
+        config->log_queue->start();
+        ysfx_set_thread_id(ysfx_thread_id_dsp);
+        ysfx_log(*config, ysfx_log_error, "from the processing");
+        ysfx_set_thread_id(ysfx_thread_id_none);
+
+        bool delivered = false;
+        for (int i = 0; i < 200 && !delivered; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            std::lock_guard<std::mutex> lock{record.mutex};
+            delivered = !record.messages.empty();
+        }
+        REQUIRE(delivered);
+        std::lock_guard<std::mutex> lock{record.mutex};
+        REQUIRE(record.messages[0].second == "from the processing");
+    }
+}
@@ -0,0 +1,95 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "ysfx.h"
+#include "ysfx_test_utils.hpp"
+#include "ysfx_utils.hpp"
+#include <catch.hpp>
+#include <thread>
+
+TEST_CASE("sandbox", "[sandbox]")
+{
+    const char *text =
+        "desc:example" "\n"
+        "slider1:1<0,10,1>the slider" "\n"
+        "in_pin:input" "\n"
+        "out_pin:output" "\n"
+        "@init" "\n"
+        "ext_nodenorm = 1;" "\n"
+        "@block" "\n"
+        "while (midirecv(ofs, msg1, msg2, msg3)) (" "\n"
+        "  midisend(ofs, msg1, msg2 + 1, msg3);" "\n"
+        ");" "\n"
+        "@sample" "\n"
+        "spl0 = spl0 * slider1;" "\n";
+
+    scoped_new_dir dir_fx("${root}/Effects");
+    scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+
+    ysfx_config_u config{ysfx_config_new()};
+    ysfx_u fx{ysfx_new(config.get())};
+    REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+    REQUIRE(ysfx_compile(fx.get(), 0));
+
+    // the child is a thread here, it shares the memory by name all the same
+    ysfx_sandbox_u sandbox{ysfx_sandbox_new(2, 16)};
+    REQUIRE(sandbox);
+    bool served = false;
+    std::thread child([&]() { served = ysfx_sandbox_serve(fx.get(), ysfx_sandbox_get_name(sandbox.get())); });
+    // a failed check leaves early, and the child must be stopped before it
+    auto child_cleanup = ysfx::defer([&]() {
+        sandbox.reset();
+        if (child.joinable())
+            child.join();
+    });
+    REQUIRE(ysfx_sandbox_wait_connected(sandbox.get(), 5000));
+
+    ysfx_sandbox_set_sample_rate(sandbox.get(), 48000);
+    ysfx_sandbox_set_block_size(sandbox.get(), 16);
+
+    ysfx_real *const *ins = ysfx_sandbox_get_inputs(sandbox.get());
+    ysfx_real *const *outs = ysfx_sandbox_get_outputs(sandbox.get());
+    for (uint32_t i = 0; i < 16; ++i)
+        ins[0][i] = 0.5;
+
+    REQUIRE(ysfx_sandbox_slider_set_value(sandbox.get(), 0, 4));
+    const uint8_t note[3] = {0x90, 60, 100};
+    ysfx_midi_event_t event_in{0, 3, sizeof(note), note};
+    REQUIRE(ysfx_sandbox_send_midi(sandbox.get(), &event_in));
+
+    REQUIRE(ysfx_sandbox_process(sandbox.get(), 1, 1, 16, 5000000));
+    for (uint32_t i = 0; i < 16; ++i)
+        REQUIRE(outs[0][i] == 2);
+    REQUIRE(ysfx_sandbox_slider_get_value(sandbox.get(), 0) == 4);
+
+    ysfx_midi_event_t event_out{};
+    REQUIRE(ysfx_sandbox_receive_midi(sandbox.get(), &event_out));
+    REQUIRE(event_out.offset == 3);
+    REQUIRE(event_out.size == 3);
+    REQUIRE(event_out.data[0] == 0x90);
+    REQUIRE(event_out.data[1] == 61);
+    REQUIRE(!ysfx_sandbox_receive_midi(sandbox.get(), &event_out));
+
+    // the next cycle does not repeat what the last one was given
+    REQUIRE(ysfx_sandbox_process(sandbox.get(), 1, 1, 16, 5000000));
+    REQUIRE(outs[0][0] == 2);
+    REQUIRE(!ysfx_sandbox_receive_midi(sandbox.get(), &event_out));
+
+    sandbox.reset();
+    child.join();
+    REQUIRE(served);
+}
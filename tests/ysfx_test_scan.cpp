@@ -0,0 +1,109 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "ysfx.h"
+#include "ysfx_utils.hpp"
+#include "ysfx_test_utils.hpp"
+#include <catch.hpp>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+TEST_CASE("header scan", "[scan]")
+{
+    const char *text =
+        "desc:Example effect" "\n"
+        "author:Someone" "\n"
+        "tags:filter eq" "\n"
+        "import missing.jsfx-inc" "\n"
+        "in_pin:left" "\n"
+        "in_pin:right" "\n"
+        "out_pin:output" "\n"
+        "slider1:0.5<0,1,0.1>the slider 1" "\n"
+        "slider3:4<1,8,1>the slider 3" "\n"
+        "@init" "\n"
+        "this is not valid code;" "\n";
+
+    scoped_new_dir dir_fx("${root}/Effects");
+    scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+    scoped_new_txt file_nodesc("${root}/Effects/nodesc.jsfx", "@sample\n");
+
+    ysfx_config_u config{ysfx_config_new()};
+
+    auto check = [](ysfx_scan_t *scan) {
+        REQUIRE(scan);
+        REQUIRE(std::string(ysfx_scan_get_name(scan)) == "Example effect");
+        REQUIRE(std::string(ysfx_scan_get_author(scan)) == "Someone");
+        const char *tags[4] = {};
+        REQUIRE(ysfx_scan_get_tags(scan, tags, 4) == 2);
+        REQUIRE(std::string(tags[0]) == "filter");
+        REQUIRE(std::string(tags[1]) == "eq");
+        REQUIRE(ysfx_scan_get_num_inputs(scan) == 2);
+        REQUIRE(ysfx_scan_get_num_outputs(scan) == 1);
+        REQUIRE(std::string(ysfx_scan_get_input_name(scan, 1)) == "right");
+        REQUIRE(std::string(ysfx_scan_get_output_name(scan, 0)) == "output");
+        REQUIRE(ysfx_scan_slider_exists(scan, 0));
+        REQUIRE(!ysfx_scan_slider_exists(scan, 1));
+        REQUIRE(ysfx_scan_slider_exists(scan, 2));
+        REQUIRE(std::string(ysfx_scan_slider_get_name(scan, 2)) == "the slider 3");
+        ysfx_slider_curve_t curve{};
+        REQUIRE(ysfx_scan_slider_get_curve(scan, 2, &curve));
+        REQUIRE(curve.def == 4);
+        REQUIRE(curve.max == 8);
+    };
+
+    SECTION("single file")
+    {
+        // the imports are not resolved, and the code is not read
+        ysfx_scan_u scan{ysfx_scan_header(config.get(), file_main.m_path.c_str())};
+        check(scan.get());
+
+        ysfx_scan_u nodesc{ysfx_scan_header(config.get(), file_nodesc.m_path.c_str())};
+        REQUIRE(nodesc);
+        REQUIRE(std::string(ysfx_scan_get_name(nodesc.get())) == "nodesc.jsfx");
+
+        ysfx_scan_u missing{ysfx_scan_header(config.get(), (dir_fx.m_path + "/missing.jsfx").c_str())};
+        REQUIRE(!missing);
+    }
+
+    SECTION("many files in parallel")
+    {
+        std::vector<const char *> paths(64, file_main.m_path.c_str());
+        std::vector<ysfx_scan_t *> results(paths.size());
+        ysfx_scan_headers(config.get(), paths.data(), (uint32_t)paths.size(), results.data(), 4);
+        for (ysfx_scan_t *scan : results) {
+            check(scan);
+            ysfx_scan_free(scan);
+        }
+    }
+
+    SECTION("with a cache")
+    {
+        scoped_new_dir dir_cache("${root}/Cache");
+        auto clean_cache = ysfx::defer([&dir_cache]() {
+            for (const std::string &name : ysfx::list_directory(dir_cache.m_path.c_str()))
+                remove((dir_cache.m_path + '/' + name).c_str());
+        });
+        ysfx_set_cache_root(config.get(), dir_cache.m_path.c_str());
+
+        ysfx_scan_u first{ysfx_scan_header(config.get(), file_main.m_path.c_str())};
+        check(first.get());
+        REQUIRE(ysfx::list_directory(dir_cache.m_path.c_str()).size() == 1);
+        ysfx_scan_u second{ysfx_scan_header(config.get(), file_main.m_path.c_str())};
+        check(second.get());
+    }
+}
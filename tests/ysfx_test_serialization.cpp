@@ -22,6 +22,10 @@
 #include "ysfx_utils.hpp"
 #include "ysfx_test_utils.hpp"
 #include <catch.hpp>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstring>
 
 TEST_CASE("save and load", "[serialization]")
 {
@@ -118,6 +122,145 @@ TEST_CASE("save and load", "[serialization]")
         REQUIRE(ysfx::unpack_f32le(&state->data[4 * sizeof(float)]) == 400);
     };
 
+    SECTION("serialization into host buffers")
+    {
+        const char *text =
+            "desc:example" "\n"
+            "out_pin:output" "\n"
+            "@init" "\n"
+            "myvar1=1;" "\n"
+            "myarray=777;" "\n"
+            "myarray[0]=100;" "\n"
+            "myarray[1]=200;" "\n"
+            "@serialize" "\n"
+            "file_var(0, myvar1);" "\n"
+            "file_mem(0, myarray, 2);" "\n"
+            "@sample" "\n"
+            "spl0=0.0;" "\n";
+
+        scoped_new_dir dir_fx("${root}/Effects");
+        scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+
+        ysfx_config_u config{ysfx_config_new()};
+        ysfx_u fx{ysfx_new(config.get())};
+
+        REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+        REQUIRE(ysfx_compile(fx.get(), 0));
+
+        auto grow = [](ysfx_serial_buffer_t *buffer, size_t capacity) -> bool {
+            std::vector<uint8_t> &vec = *(std::vector<uint8_t> *)buffer->userdata;
+            vec.resize(capacity);
+            buffer->data = vec.data();
+            buffer->capacity = capacity;
+            return true;
+        };
+
+        std::vector<uint8_t> storage;
+        ysfx_serial_buffer_t buffer{};
+        buffer.grow = grow;
+        buffer.userdata = (intptr_t)&storage;
+        REQUIRE(ysfx_save_serialized_state_to(fx.get(), &buffer));
+        REQUIRE(buffer.size == 3 * sizeof(float));
+        REQUIRE(ysfx::unpack_f32le(&buffer.data[0 * sizeof(float)]) == 1);
+        REQUIRE(ysfx::unpack_f32le(&buffer.data[1 * sizeof(float)]) == 100);
+        REQUIRE(ysfx::unpack_f32le(&buffer.data[2 * sizeof(float)]) == 200);
+
+        uint8_t input[3 * sizeof(float)];
+        ysfx::pack_f32le(2, &input[0 * sizeof(float)]);
+        ysfx::pack_f32le(300, &input[1 * sizeof(float)]);
+        ysfx::pack_f32le(400, &input[2 * sizeof(float)]);
+        REQUIRE(ysfx_load_serialized_state_from(fx.get(), input, sizeof(input)));
+        REQUIRE(ysfx_read_var(fx.get(), "myvar1") == 2);
+
+        // a buffer which cannot grow is left as it was
+        uint8_t fixed[2 * sizeof(float)];
+        ysfx_serial_buffer_t small{};
+        small.data = fixed;
+        small.capacity = sizeof(fixed);
+        REQUIRE(!ysfx_save_serialized_state_to(fx.get(), &small));
+        REQUIRE(small.size == 0);
+    };
+
+    SECTION("memory across blocks, and lossless")
+    {
+        const char *text =
+            "desc:example" "\n"
+            "out_pin:output" "\n"
+            "@init" "\n"
+            "i=0; loop(100000, mem[i]=i+0.1; i+=1);" "\n"
+            "@serialize" "\n"
+            "file_mem(0, mem, 100000);" "\n"
+            "@sample" "\n"
+            "spl0=0.0;" "\n";
+
+        scoped_new_dir dir_fx("${root}/Effects");
+        scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+
+        ysfx_config_u config{ysfx_config_new()};
+        ysfx_u fx{ysfx_new(config.get())};
+
+        REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+        REQUIRE(ysfx_compile(fx.get(), 0));
+        ysfx_init(fx.get());
+
+        ysfx_state_u state{ysfx_save_state(fx.get())};
+        REQUIRE(state->data_size == 100000 * sizeof(float));
+        REQUIRE(ysfx::unpack_f32le(&state->data[0]) == 0.1f);
+        REQUIRE(ysfx::unpack_f32le(&state->data[99999 * sizeof(float)]) == 99999.1f);
+
+        REQUIRE(!ysfx_get_lossless_serialization(fx.get()));
+        ysfx_set_lossless_serialization(fx.get(), true);
+        state.reset(ysfx_save_state(fx.get()));
+        REQUIRE(state->data_size == 100000 * sizeof(double));
+
+        // the values come back exactly
+        ysfx_real values[2] = {1234.5678, 0.1};
+        memcpy(&state->data[65535 * sizeof(double)], values, sizeof(values));
+        REQUIRE(ysfx_load_serialized_state(fx.get(), state.get()));
+        ysfx_real mem[2]{};
+        ysfx_read_vmem(fx.get(), 65535, mem, 2);
+        REQUIRE(mem[0] == 1234.5678);
+        REQUIRE(mem[1] == 0.1);
+        ysfx_read_vmem(fx.get(), 99999, mem, 1);
+        REQUIRE(mem[0] == 99999.1);
+    };
+
+    SECTION("lazy compilation")
+    {
+        const char *text =
+            "desc:example" "\n"
+            "out_pin:output" "\n"
+            "@init" "\n"
+            "myvar1=1;" "\n"
+            "@serialize" "\n"
+            "file_var(0, myvar1);" "\n"
+            "@gfx" "\n"
+            "this is ( not valid;" "\n";
+
+        scoped_new_dir dir_fx("${root}/Effects");
+        scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+
+        ysfx_config_u config{ysfx_config_new()};
+        ysfx_u fx{ysfx_new(config.get())};
+
+        REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+        REQUIRE(!ysfx_compile(fx.get(), 0));
+
+        // @gfx is not compiled yet, so the error is not seen
+        REQUIRE(ysfx_compile(fx.get(), ysfx_compile_lazy));
+        ysfx_init(fx.get());
+
+        // @serialize compiles on the first save
+        ysfx_state_u state{ysfx_save_state(fx.get())};
+        REQUIRE(state);
+        REQUIRE(state->data_size == 1 * sizeof(float));
+        REQUIRE(ysfx::unpack_f32le(&state->data[0]) == 1);
+
+        ysfx::pack_f32le(5, &state->data[0]);
+        REQUIRE(ysfx_load_state(fx.get(), state.get()));
+        REQUIRE(ysfx_read_var(fx.get(), "myvar1") == 5);
+    };
+
     SECTION("load serialization only")
     {
         const char *text =
@@ -199,6 +342,45 @@ TEST_CASE("save and load", "[serialization]")
         REQUIRE(state->sliders[3].value == 3);
     };
 
+    SECTION("load sliders only")
+    {
+        const char *text =
+            "desc:example" "\n"
+            "out_pin:output" "\n"
+            "slider1:1<1,3,0.1>the slider 1" "\n"
+            "slider2:2<1,3,0.1>the slider 2" "\n"
+            "@init" "\n"
+            "myvar1=1;" "\n"
+            "serializations=0;" "\n"
+            "@serialize" "\n"
+            "serializations+=1;" "\n"
+            "file_var(0, myvar1);" "\n"
+            "@sample" "\n"
+            "spl0=0.0;" "\n";
+
+        scoped_new_dir dir_fx("${root}/Effects");
+        scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+
+        ysfx_config_u config{ysfx_config_new()};
+        ysfx_u fx{ysfx_new(config.get())};
+
+        REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+        REQUIRE(ysfx_compile(fx.get(), 0));
+        ysfx_init(fx.get());
+
+        ysfx_slider_set_value(fx.get(), 1, 3, false);
+
+        ysfx_state_slider_t sliders[] = {{0, 2.5}};
+        ysfx_state_t state{sliders, 1, nullptr, 0, 0};
+        REQUIRE(ysfx_load_slider_state(fx.get(), &state));
+
+        REQUIRE(ysfx_read_var(fx.get(), "serializations") == 0);
+        REQUIRE(ysfx_read_var(fx.get(), "myvar1") == 1);
+        REQUIRE(ysfx_slider_get_value(fx.get(), 0) == 2.5);
+        // the sliders the state lacks return to their defaults
+        REQUIRE(ysfx_slider_get_value(fx.get(), 1) == 2);
+    };
+
     SECTION("file_avail")
     {
         const char *text =
@@ -252,3 +434,46 @@ TEST_CASE("save and load", "[serialization]")
         REQUIRE(ysfx::unpack_f32le(&state->data[4 * sizeof(float)]) == 400);
     };
 }
+
+TEST_CASE("base64", "[serialization]")
+{
+    // long enough for the vectorized blocks, and the tails of every length
+    std::vector<uint8_t> data(200);
+    for (size_t i = 0; i < data.size(); ++i)
+        data[i] = (uint8_t)(i * 37 + 11);
+
+    SECTION("known text")
+    {
+        const char *text = "bGlnaHQgd29yaw==";
+        REQUIRE(ysfx::encode_base64((const uint8_t *)"light work", 10) == text);
+        std::vector<uint8_t> decoded = ysfx::decode_base64(text);
+        REQUIRE(std::string(decoded.begin(), decoded.end()) == "light work");
+    }
+
+    SECTION("round trip")
+    {
+        for (size_t size = 0; size <= data.size(); ++size) {
+            std::string text = ysfx::encode_base64(data.data(), size);
+            REQUIRE(text.size() == ysfx::base64_encoded_size(size));
+            std::vector<uint8_t> decoded = ysfx::decode_base64(text.data(), text.size());
+            REQUIRE(decoded == std::vector<uint8_t>(data.begin(), data.begin() + size));
+        }
+    }
+
+    SECTION("spaces and line breaks")
+    {
+        std::string text = ysfx::encode_base64(data.data(), data.size());
+        for (size_t i = text.size() - 1; i > 0; i -= std::min<size_t>(i, 29))
+            text.insert(i, (i % 2) ? "\n" : " ");
+        REQUIRE(ysfx::decode_base64(text.data(), text.size()) == data);
+    }
+
+    SECTION("the C interface")
+    {
+        std::string text(ysfx_base64_encoded_size(data.size()), '\0');
+        REQUIRE(ysfx_base64_encode(data.data(), data.size(), &text[0]) == text.size());
+        std::vector<uint8_t> decoded(ysfx_base64_decoded_capacity(text.size()));
+        decoded.resize(ysfx_base64_decode(text.data(), text.size(), decoded.data()));
+        REQUIRE(decoded == data);
+    }
+}
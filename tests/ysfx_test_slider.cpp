@@ -22,6 +22,7 @@
 #include "ysfx.h"
 #include "ysfx_test_utils.hpp"
 #include <catch.hpp>
+#include <thread>
 
 TEST_CASE("slider manipulation", "[sliders]")
 {
@@ -54,6 +55,34 @@ TEST_CASE("slider manipulation", "[sliders]")
         REQUIRE(ysfx_slider_get_value(fx.get(), 1) == 3);
     }
 
+    SECTION("slider indices")
+    {
+        const char *text =
+            "desc:example" "\n"
+            "out_pin:output" "\n"
+            "slider70:0<0,1,0.1>the slider 70" "\n"
+            "slider3:0<0,1,0.1>the slider 3" "\n"
+            "@sample" "\n"
+            "spl0=0.0;" "\n";
+
+        scoped_new_dir dir_fx("${root}/Effects");
+        scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+
+        ysfx_config_u config{ysfx_config_new()};
+        ysfx_u fx{ysfx_new(config.get())};
+
+        REQUIRE(ysfx_get_slider_count(fx.get()) == 0);
+        REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+        REQUIRE(ysfx_get_slider_count(fx.get()) == 2);
+
+        uint32_t indices[2] = {};
+        REQUIRE(ysfx_get_slider_indices(fx.get(), indices, 1) == 2);
+        REQUIRE(indices[0] == 2);
+        REQUIRE(indices[1] == 0);
+        REQUIRE(ysfx_get_slider_indices(fx.get(), indices, 2) == 2);
+        REQUIRE(indices[1] == 69);
+    }
+
     SECTION("slider case insensitivity")
     {
         const char *text =
@@ -143,8 +172,21 @@ TEST_CASE("slider manipulation", "[sliders]")
         REQUIRE(!slider_is_visible(253));
         REQUIRE(slider_is_visible(254));
 
+        for (uint8_t group = 0; group < ysfx_max_slider_groups; ++group)
+            ysfx_fetch_slider_visibility_changes(fx.get(), group);
+
+        uint32_t notified = 0;
+        ysfx_set_slider_visibility_callback(fx.get(), [](void *userdata) { ++*(uint32_t *)userdata; }, &notified);
+
         ysfx_process_float(fx.get(), nullptr, nullptr, 0, 0, 1);
 
+        REQUIRE(notified == 6);
+        REQUIRE(ysfx_fetch_slider_visibility_changes(fx.get(), 0) ==
+                (ysfx_slider_mask(0, 0) | ysfx_slider_mask(2, 0) | ysfx_slider_mask(4, 0) | ysfx_slider_mask(5, 0)));
+        REQUIRE(ysfx_fetch_slider_visibility_changes(fx.get(), 0) == 0);
+        REQUIRE(ysfx_fetch_slider_visibility_changes(fx.get(), 1) == 0);
+        REQUIRE(ysfx_fetch_slider_visibility_changes(fx.get(), 3) == (ysfx_slider_mask(253, 3) | ysfx_slider_mask(254, 3)));
+
         visible = ysfx_get_slider_visibility(fx.get(), 0);
         REQUIRE(!slider_is_visible(0));
         REQUIRE(slider_is_visible(1));
@@ -355,4 +397,375 @@ TEST_CASE("slider manipulation", "[sliders]")
         touched = ysfx_fetch_slider_touches(fx.get(), 3);
         REQUIRE(touched == ysfx_slider_mask(255, 3));  // We didn't stop touching 255.
     }
+
+    SECTION("slider value changes")
+    {
+        const char *text =
+            "desc:example" "\n"
+            "out_pin:output" "\n"
+            "slider1:0<0,1,0.1>the slider 1" "\n"
+            "slider2:0<0,1,0.1>the slider 2" "\n"
+            "slider200:0<0,1,0.1>the slider 200" "\n"
+            "@block" "\n"
+            "slider2 = counter;" "\n"
+            "counter == 1 ? slider200 = 0.5;" "\n"
+            "counter += 1;" "\n";
+
+        scoped_new_dir dir_fx("${root}/Effects");
+        scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+
+        ysfx_config_u config{ysfx_config_new()};
+        ysfx_u fx{ysfx_new(config.get())};
+
+        REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+        REQUIRE(ysfx_compile(fx.get(), 0));
+
+        ysfx_init(fx.get());
+        ysfx_process_float(fx.get(), nullptr, nullptr, 0, 0, 1);
+        REQUIRE(ysfx_fetch_slider_value_changes(fx.get(), 0) == 0);
+        REQUIRE(ysfx_fetch_slider_value_changes(fx.get(), 3) == 0);
+
+        ysfx_process_float(fx.get(), nullptr, nullptr, 0, 0, 1);
+        REQUIRE(ysfx_fetch_slider_value_changes(fx.get(), 0) == ysfx_slider_mask(1, 0));
+        REQUIRE(ysfx_fetch_slider_value_changes(fx.get(), 3) == ysfx_slider_mask(199, 3));
+        REQUIRE(ysfx_fetch_slider_value_changes(fx.get(), 0) == 0);
+
+        ysfx_slider_set_value(fx.get(), 0, 0.3, false);
+        ysfx_process_float(fx.get(), nullptr, nullptr, 0, 0, 1);
+        REQUIRE(ysfx_fetch_slider_value_changes(fx.get(), 0) == (ysfx_slider_mask(0, 0) | ysfx_slider_mask(1, 0)));
+        REQUIRE(ysfx_fetch_slider_value_changes(fx.get(), 3) == 0);
+    }
+
+    SECTION("slider snapshot")
+    {
+        const char *text =
+            "desc:example" "\n"
+            "out_pin:output" "\n"
+            "slider1:0<0,1,0.1>the slider 1" "\n"
+            "slider200:0<0,1,0.1>the slider 200" "\n"
+            "@block" "\n"
+            "counter == 1 ? slider200 = 0.5;" "\n"
+            "counter += 1;" "\n";
+
+        scoped_new_dir dir_fx("${root}/Effects");
+        scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+
+        ysfx_config_u config{ysfx_config_new()};
+        ysfx_u fx{ysfx_new(config.get())};
+
+        REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+        REQUIRE(ysfx_compile(fx.get(), 0));
+        ysfx_init(fx.get());
+
+        float out[4] = {};
+        float *outs[] = {out};
+
+        // nothing is published before a reader asks
+        const ysfx_slider_snapshot_t *snap = ysfx_get_slider_snapshot(fx.get());
+        REQUIRE(snap->generation == 0);
+        REQUIRE(snap->count == ysfx_get_max_sliders());
+
+        ysfx_process_float(fx.get(), nullptr, outs, 0, 1, 4);
+        snap = ysfx_get_slider_snapshot(fx.get());
+        REQUIRE(snap->generation == 1);
+        REQUIRE(snap->values[199] == 0);
+
+        ysfx_process_float(fx.get(), nullptr, outs, 0, 1, 4);
+        snap = ysfx_get_slider_snapshot(fx.get());
+        REQUIRE(snap->generation == 2);
+        REQUIRE(snap->values[199] == 0.5);
+
+        // the generation stays while the values do
+        ysfx_process_float(fx.get(), nullptr, outs, 0, 1, 4);
+        REQUIRE(ysfx_get_slider_snapshot(fx.get())->generation == 2);
+
+        ysfx_slider_set_value(fx.get(), 0, 0.3, false);
+        ysfx_process_float(fx.get(), nullptr, outs, 0, 1, 4);
+        ysfx_process_float(fx.get(), nullptr, outs, 0, 1, 4);
+        snap = ysfx_get_slider_snapshot(fx.get());
+        REQUIRE(snap->generation == 3);
+        REQUIRE(snap->values[0] == 0.3);
+    }
+
+    SECTION("slider smoothing")
+    {
+        const char *text =
+            "desc:example" "\n"
+            "out_pin:output" "\n"
+            "slider1:0<0,1,0.1>the slider 1" "\n"
+            "@slider" "\n"
+            "calls += 1;" "\n"
+            "@sample" "\n"
+            "spl0 = slider1;" "\n";
+
+        scoped_new_dir dir_fx("${root}/Effects");
+        scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+
+        ysfx_config_u config{ysfx_config_new()};
+        ysfx_u fx{ysfx_new(config.get())};
+
+        REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+        REQUIRE(ysfx_compile(fx.get(), 0));
+
+        ysfx_init(fx.get());
+        ysfx_set_sample_accurate(fx.get(), 1);
+        REQUIRE(ysfx_slider_set_smoothing(fx.get(), 0, 10));
+        REQUIRE(!ysfx_slider_set_smoothing(fx.get(), ysfx_max_sliders, 10));
+
+        double out[16] = {};
+        double *outs[] = {out};
+        ysfx_slider_set_value_at(fx.get(), 0, 1.0, 2);
+        ysfx_process_double(fx.get(), nullptr, outs, 0, 1, 16);
+
+        REQUIRE(out[0] == 0);
+        REQUIRE(out[1] == 0);
+        for (uint32_t i = 0; i < 10; ++i)
+            REQUIRE(out[2 + i] == Approx(0.1 * (i + 1)));
+        for (uint32_t i = 12; i < 16; ++i)
+            REQUIRE(out[i] == 1.0);
+
+        // @slider runs once, after the slider has arrived
+        ysfx_real calls = ysfx_read_var(fx.get(), "calls");
+        ysfx_process_double(fx.get(), nullptr, outs, 0, 1, 16);
+        REQUIRE(ysfx_read_var(fx.get(), "calls") == calls + 1);
+        REQUIRE(ysfx_slider_get_value(fx.get(), 0) == 1.0);
+    }
+
+    SECTION("state morphing")
+    {
+        const char *text =
+            "desc:example" "\n"
+            "out_pin:output" "\n"
+            "slider1:0<0,100,1>the slider 1" "\n"
+            "slider2:0<0,2,1{A,B,C}>the slider 2" "\n"
+            "slider3:0<0,10,0.1>the slider 3" "\n"
+            "@init" "\n"
+            "calls = 0;" "\n"
+            "@slider" "\n"
+            "calls += 1;" "\n"
+            "@serialize" "\n"
+            "file_var(0, slider1);" "\n"
+            "@sample" "\n"
+            "spl0 = slider1;" "\n";
+
+        scoped_new_dir dir_fx("${root}/Effects");
+        scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+
+        ysfx_config_u config{ysfx_config_new()};
+        ysfx_u fx{ysfx_new(config.get())};
+
+        REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+        REQUIRE(ysfx_compile(fx.get(), 0));
+
+        ysfx_init(fx.get());
+
+        ysfx_state_slider_t sliders_a[] = {{0, 0.0}, {1, 0.0}};
+        ysfx_state_slider_t sliders_b[] = {{0, 100.0}, {1, 2.0}, {2, 5.0}};
+        ysfx_state_t a{sliders_a, 2, nullptr, 0, 0};
+        ysfx_state_t b{sliders_b, 3, nullptr, 0, 0};
+
+        ysfx_morph_states(fx.get(), &a, &b, 0.25);
+        REQUIRE(ysfx_slider_get_value(fx.get(), 0) == Approx(25.0));
+        REQUIRE(ysfx_slider_get_value(fx.get(), 1) == 0.0);
+        // a slider only one state has takes its value
+        REQUIRE(ysfx_slider_get_value(fx.get(), 2) == 5.0);
+
+        ysfx_morph_states(fx.get(), &a, &b, 0.75);
+        REQUIRE(ysfx_slider_get_value(fx.get(), 0) == Approx(75.0));
+        REQUIRE(ysfx_slider_get_value(fx.get(), 1) == 2.0);
+
+        ysfx_morph_states(fx.get(), &a, &b, 2.0);
+        REQUIRE(ysfx_slider_get_value(fx.get(), 0) == 100.0);
+
+        double out[16] = {};
+        double *outs[] = {out};
+        ysfx_real calls = ysfx_read_var(fx.get(), "calls");
+        ysfx_process_double(fx.get(), nullptr, outs, 0, 1, 16);
+        REQUIRE(ysfx_read_var(fx.get(), "calls") == calls + 1);
+
+        // with smoothing, the morph glides like any change
+        ysfx_set_sample_accurate(fx.get(), 1);
+        REQUIRE(ysfx_slider_set_smoothing(fx.get(), 0, 10));
+        ysfx_morph_states(fx.get(), &a, &b, 0.0);
+        ysfx_process_double(fx.get(), nullptr, outs, 0, 1, 16);
+        for (uint32_t i = 0; i < 10; ++i)
+            REQUIRE(out[i] == Approx(100.0 - 10.0 * (i + 1)));
+        REQUIRE(out[15] == 0.0);
+    }
+
+    SECTION("slider posting")
+    {
+        const char *text =
+            "desc:example" "\n"
+            "out_pin:output" "\n"
+            "slider1:0<0,100,1>the slider 1" "\n"
+            "@sample" "\n"
+            "spl0 = slider1;" "\n";
+
+        scoped_new_dir dir_fx("${root}/Effects");
+        scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+
+        ysfx_config_u config{ysfx_config_new()};
+        ysfx_u fx{ysfx_new(config.get())};
+
+        REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+        REQUIRE(ysfx_compile(fx.get(), 0));
+
+        ysfx_init(fx.get());
+        ysfx_set_sample_accurate(fx.get(), 1);
+        REQUIRE(!ysfx_post_slider_value(fx.get(), 0, 1, 0));
+
+        ysfx_set_slider_queue_capacity(fx.get(), 4);
+        REQUIRE(!ysfx_post_slider_value(fx.get(), ysfx_max_sliders, 1, 0));
+        REQUIRE(ysfx_post_slider_value(fx.get(), 0, 1, 2));
+        REQUIRE(ysfx_post_slider_value(fx.get(), 0, 2, 4));
+        REQUIRE(ysfx_post_slider_value(fx.get(), 0, 3, 4));
+        REQUIRE(ysfx_post_slider_value(fx.get(), 0, 4, 6));
+        REQUIRE(!ysfx_post_slider_value(fx.get(), 0, 5, 6));
+
+        double out[8] = {};
+        double *outs[] = {out};
+        ysfx_process_double(fx.get(), nullptr, outs, 0, 1, 8);
+
+        // the changes at the same offset apply in the order of posting
+        const double expected[8] = {0, 0, 1, 1, 3, 3, 4, 4};
+        for (uint32_t i = 0; i < 8; ++i)
+            REQUIRE(out[i] == expected[i]);
+
+        std::thread producer([&fx]() {
+            for (uint32_t i = 1; i <= 100; ++i) {
+                while (!ysfx_post_slider_value(fx.get(), 0, i, 0))
+                    std::this_thread::yield();
+            }
+        });
+        ysfx_real last = 4;
+        while (last < 100) {
+            ysfx_process_double(fx.get(), nullptr, outs, 0, 1, 8);
+            ysfx_real value = ysfx_slider_get_value(fx.get(), 0);
+            REQUIRE(value >= last);
+            last = value;
+        }
+        producer.join();
+    }
+
+    SECTION("timed automation and triggers")
+    {
+        const char *text =
+            "desc:example" "\n"
+            "out_pin:output" "\n"
+            "slider1:0<0,100,1>the slider 1" "\n"
+            "slider2:0<0,100,1>the slider 2" "\n"
+            "@block" "\n"
+            "trigger & 2 ? slider2 = 50;" "\n"
+            "trigger & 2 ? slider_automate(slider2);" "\n"
+            "@sample" "\n"
+            "counter += 1;" "\n"
+            "counter == 3 ? (slider1 = 10; slider_automate(slider1););" "\n"
+            "spl0 = trigger;" "\n";
+
+        scoped_new_dir dir_fx("${root}/Effects");
+        scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+
+        ysfx_config_u config{ysfx_config_new()};
+        ysfx_u fx{ysfx_new(config.get())};
+
+        REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+        REQUIRE(ysfx_compile(fx.get(), 0));
+
+        ysfx_init(fx.get());
+        ysfx_set_sample_accurate(fx.get(), 1);
+        ysfx_set_slider_automation_capacity(fx.get(), 8);
+
+        REQUIRE(!ysfx_send_trigger_at(fx.get(), ysfx_max_triggers, 0));
+        REQUIRE(ysfx_send_trigger_at(fx.get(), 1, 5));
+        REQUIRE(ysfx_send_trigger_at(fx.get(), 0, 6));
+
+        double out[8] = {};
+        double *outs[] = {out};
+        ysfx_process_double(fx.get(), nullptr, outs, 0, 1, 8);
+
+        // each trigger lasts for the sub-block which starts at its offset
+        const double expected[8] = {0, 0, 0, 0, 0, 2, 1, 1};
+        for (uint32_t i = 0; i < 8; ++i)
+            REQUIRE(out[i] == expected[i]);
+
+        ysfx_slider_automation_t automation{};
+        REQUIRE(ysfx_receive_slider_automation(fx.get(), &automation));
+        REQUIRE(automation.index == 0);
+        REQUIRE(automation.offset == 2);
+        REQUIRE(automation.value == 10);
+        REQUIRE(ysfx_receive_slider_automation(fx.get(), &automation));
+        REQUIRE(automation.index == 1);
+        REQUIRE(automation.offset == 5);
+        REQUIRE(automation.value == 50);
+        REQUIRE(!ysfx_receive_slider_automation(fx.get(), &automation));
+
+        // the masks are maintained alongside
+        REQUIRE(ysfx_fetch_slider_automations(fx.get(), 0) == 3);
+    }
+
+    SECTION("slider batches")
+    {
+        const char *text =
+            "desc:example" "\n"
+            "out_pin:output" "\n"
+            "slider1:0<0,100,1>the slider 1" "\n"
+            "slider2:1000<20,22050,0.01:log>the slider 2" "\n"
+            "slider3:0<-60,12,0.1:sqr>the slider 3" "\n"
+            "@init" "\n"
+            "calls = 0;" "\n"
+            "@slider" "\n"
+            "calls += 1;" "\n";
+
+        scoped_new_dir dir_fx("${root}/Effects");
+        scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+
+        ysfx_config_u config{ysfx_config_new()};
+        ysfx_u fx{ysfx_new(config.get())};
+
+        REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+        REQUIRE(ysfx_compile(fx.get(), 0));
+        ysfx_init(fx.get());
+
+        const uint32_t indices[] = {0, 1, 2, 99};
+
+        const ysfx_real values[] = {50, 440, -6, 1};
+        ysfx_slider_set_values(fx.get(), indices, values, 4, false);
+        REQUIRE(ysfx_slider_get_value(fx.get(), 0) == 50);
+        REQUIRE(ysfx_slider_get_value(fx.get(), 1) == 440);
+        REQUIRE(ysfx_slider_get_value(fx.get(), 2) == -6);
+
+        // the normalized values follow the curves closely
+        const ysfx_real normalized[] = {0.25, 0.5, 0.75, 1};
+        ysfx_slider_set_values(fx.get(), indices, normalized, 4, true);
+        for (uint32_t i = 0; i < 3; ++i) {
+            ysfx_slider_curve_t curve{};
+            REQUIRE(ysfx_slider_get_curve(fx.get(), i, &curve));
+            ysfx_real expected = ysfx_normalized_to_ysfx_value(normalized[i], &curve);
+            REQUIRE(ysfx_slider_get_value(fx.get(), i) == Approx(expected).margin(1e-4 * (curve.max - curve.min)));
+        }
+
+        ysfx_real dest[4] = {};
+        ysfx_slider_get_values(fx.get(), indices, dest, 4, true);
+        for (uint32_t i = 0; i < 3; ++i)
+            REQUIRE(dest[i] == Approx(normalized[i]).margin(1e-4));
+        REQUIRE(dest[3] == 0);
+
+        ysfx_slider_get_values(fx.get(), indices, dest, 3, false);
+        for (uint32_t i = 0; i < 3; ++i)
+            REQUIRE(dest[i] == ysfx_slider_get_value(fx.get(), i));
+
+        // out of the range, the normalized values are clamped
+        const ysfx_real beyond[] = {-1, 2};
+        ysfx_slider_set_values(fx.get(), indices, beyond, 2, true);
+        REQUIRE(ysfx_slider_get_value(fx.get(), 0) == 0);
+        REQUIRE(ysfx_slider_get_value(fx.get(), 1) == Approx(22050));
+
+        // the changes notify the effect
+        double out[16] = {};
+        double *outs[] = {out};
+        ysfx_real calls = ysfx_read_var(fx.get(), "calls");
+        ysfx_process_double(fx.get(), nullptr, outs, 0, 1, 16);
+        REQUIRE(ysfx_read_var(fx.get(), "calls") == calls + 1);
+    }
 }
@@ -0,0 +1,166 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+#include "ysfx.h"
+#include "ysfx_test_utils.hpp"
+#include "ysfx_api_eel.hpp"
+#include "ysfx.hpp"
+#include <catch.hpp>
+
+TEST_CASE("snapshot", "[snapshot]")
+{
+    const char *text =
+        "desc:example" "\n"
+        "slider1:1<0,10,1>the slider" "\n"
+        "out_pin:output" "\n"
+        "@init" "\n"
+        "counter = 0;" "\n"
+        "mem[10] = 1;" "\n"
+        "strcpy(5, \"before\");" "\n"
+        "@block" "\n"
+        "counter += 1;" "\n"
+        "mem[200000] = counter;" "\n"
+        "strcpy(5, \"after\");" "\n"
+        "@sample" "\n"
+        "spl0 = counter;" "\n";
+
+    scoped_new_dir dir_fx("${root}/Effects");
+    scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+
+    ysfx_config_u config{ysfx_config_new()};
+    ysfx_u fx{ysfx_new(config.get())};
+    REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+    REQUIRE(ysfx_compile(fx.get(), 0));
+    ysfx_set_block_size(fx.get(), 16);
+    ysfx_init(fx.get());
+
+    float out[16] = {};
+    float *outs[] = {out};
+
+    ysfx_snapshot_u first{ysfx_snapshot_take(fx.get(), nullptr)};
+    REQUIRE(first);
+    REQUIRE(ysfx_snapshot_get_memory_size(first.get(), nullptr) == 65536 * sizeof(ysfx_real));
+
+    ysfx_process_float(fx.get(), nullptr, outs, 0, 1, 16);
+    ysfx_process_float(fx.get(), nullptr, outs, 0, 1, 16);
+    ysfx_slider_set_value(fx.get(), 0, 5, false);
+    REQUIRE(ysfx_read_var(fx.get(), "counter") == 2);
+    REQUIRE(ysfx_read_vmem_single(fx.get(), 200000) == 2);
+
+    // the second one shares the block which has not changed
+    ysfx_snapshot_u second{ysfx_snapshot_take(fx.get(), first.get())};
+    REQUIRE(ysfx_snapshot_get_memory_size(second.get(), first.get()) == 65536 * sizeof(ysfx_real));
+    REQUIRE(ysfx_snapshot_get_memory_size(second.get(), nullptr) == 2 * 65536 * sizeof(ysfx_real));
+
+    REQUIRE(ysfx_snapshot_restore(fx.get(), first.get()));
+    REQUIRE(ysfx_read_var(fx.get(), "counter") == 0);
+    REQUIRE(ysfx_slider_get_value(fx.get(), 0) == 1);
+    REQUIRE(ysfx_read_vmem_single(fx.get(), 10) == 1);
+    REQUIRE(ysfx_read_vmem_single(fx.get(), 200000) == 0);
+    std::string txt;
+    REQUIRE(ysfx_string_get(fx.get(), 5, txt));
+    REQUIRE(txt == "before");
+
+    REQUIRE(ysfx_snapshot_restore(fx.get(), second.get()));
+    REQUIRE(ysfx_read_var(fx.get(), "counter") == 2);
+    REQUIRE(ysfx_slider_get_value(fx.get(), 0) == 5);
+    REQUIRE(ysfx_read_vmem_single(fx.get(), 200000) == 2);
+    REQUIRE(ysfx_string_get(fx.get(), 5, txt));
+    REQUIRE(txt == "after");
+
+    // processing continues from the restored state, without @init
+    ysfx_process_float(fx.get(), nullptr, outs, 0, 1, 16);
+    REQUIRE(out[0] == 3);
+}
+
+TEST_CASE("hibernation", "[snapshot]")
+{
+    const char *text =
+        "desc:example" "\n"
+        "slider1:1<0,10,1>the slider" "\n"
+        "out_pin:output" "\n"
+        "@init" "\n"
+        "counter = 0;" "\n"
+        "mem[10] = 1;" "\n"
+        "@block" "\n"
+        "counter += 1;" "\n"
+        "mem[200000] = counter;" "\n"
+        "mem[300000] = 0;" "\n"
+        "@serialize" "\n"
+        "file_var(0, counter);" "\n"
+        "@sample" "\n"
+        "spl0 = counter;" "\n";
+
+    scoped_new_dir dir_fx("${root}/Effects");
+    scoped_new_txt file_main("${root}/Effects/example.jsfx", text);
+
+    ysfx_config_u config{ysfx_config_new()};
+    ysfx_u fx{ysfx_new(config.get())};
+    REQUIRE(ysfx_load_file(fx.get(), file_main.m_path.c_str(), 0));
+    REQUIRE(ysfx_compile(fx.get(), 0));
+    ysfx_set_block_size(fx.get(), 16);
+    ysfx_init(fx.get());
+
+    float out[16] = {};
+    float *outs[] = {out};
+
+    ysfx_process_float(fx.get(), nullptr, outs, 0, 1, 16);
+    ysfx_process_float(fx.get(), nullptr, outs, 0, 1, 16);
+    ysfx_slider_set_value(fx.get(), 0, 5, false);
+
+    ysfx_memory_stats_t stats{};
+    ysfx_get_memory_stats(fx.get(), &stats);
+    REQUIRE(stats.ram_blocks == 3);
+
+    SECTION("state")
+    {
+        REQUIRE(ysfx_hibernate(fx.get(), 0));
+        REQUIRE(ysfx_is_hibernating(fx.get()));
+        REQUIRE(!ysfx_is_compiled(fx.get()));
+        ysfx_get_memory_stats(fx.get(), &stats);
+        REQUIRE(stats.ram_blocks == 0);
+
+        // the effect passes through, meanwhile
+        ysfx_process_float(fx.get(), nullptr, outs, 0, 1, 16);
+        REQUIRE(out[0] == 0);
+
+        REQUIRE(ysfx_wake(fx.get()));
+        REQUIRE(!ysfx_is_hibernating(fx.get()));
+        REQUIRE(ysfx_read_var(fx.get(), "counter") == 2);
+        REQUIRE(ysfx_slider_get_value(fx.get(), 0) == 5);
+        REQUIRE(ysfx_read_vmem_single(fx.get(), 10) == 1);
+        REQUIRE(ysfx_read_vmem_single(fx.get(), 200000) == 0);
+    }
+
+    SECTION("virtual machine")
+    {
+        REQUIRE(ysfx_hibernate(fx.get(), ysfx_hibernate_keep_vm));
+        ysfx_get_memory_stats(fx.get(), &stats);
+        REQUIRE(stats.ram_blocks == 0);
+
+        REQUIRE(ysfx_wake(fx.get()));
+        REQUIRE(ysfx_read_var(fx.get(), "counter") == 2);
+        REQUIRE(ysfx_slider_get_value(fx.get(), 0) == 5);
+        REQUIRE(ysfx_read_vmem_single(fx.get(), 200000) == 2);
+        // the block of zeros was not kept
+        ysfx_get_memory_stats(fx.get(), &stats);
+        REQUIRE(stats.ram_blocks == 2);
+    }
+
+    // processing continues from where it was
+    ysfx_process_float(fx.get(), nullptr, outs, 0, 1, 16);
+    REQUIRE(out[0] == 3);
+}
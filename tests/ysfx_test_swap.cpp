@@ -0,0 +1,122 @@
+// Copyright 2021 Jean Pierre Cimalando
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "ysfx.h"
+#include "ysfx_test_utils.hpp"
+#include <catch.hpp>
+
+TEST_CASE("hot swap", "[swap]")
+{
+    const char *text_v1 =
+        "desc:example" "\n"
+        "slider1:1<0,10,1>the slider" "\n"
+        "out_pin:output" "\n"
+        "@init" "\n"
+        "version = 1;" "\n"
+        "@block" "\n"
+        "mem[0] += 1;" "\n"
+        "@sample" "\n"
+        "spl0 = slider1;" "\n";
+
+    const char *text_v2 =
+        "desc:example" "\n"
+        "slider1:1<0,10,1>the slider" "\n"
+        "out_pin:output" "\n"
+        "@init" "\n"
+        "version = 2;" "\n"
+        "@sample" "\n"
+        "spl0 = 10 * slider1 + mem[0];" "\n";
+
+    scoped_new_dir dir_fx("${root}/Effects");
+    scoped_new_txt file_v1("${root}/Effects/v1.jsfx", text_v1);
+    scoped_new_txt file_v2("${root}/Effects/v2.jsfx", text_v2);
+
+    ysfx_config_u config{ysfx_config_new()};
+    ysfx_u fx{ysfx_new(config.get())};
+    REQUIRE(ysfx_load_file(fx.get(), file_v1.m_path.c_str(), 0));
+    REQUIRE(ysfx_compile(fx.get(), 0));
+    ysfx_set_sample_rate(fx.get(), 48000);
+    ysfx_set_block_size(fx.get(), 16);
+    ysfx_init(fx.get());
+
+    ysfx_swap_u swap{ysfx_swap_new(fx.get())};
+
+    float out[16] = {};
+    float *outs[] = {out};
+
+    auto process = [&]() -> ysfx_t * {
+        ysfx_t *current = ysfx_swap_acquire(swap.get());
+        ysfx_process_float(current, nullptr, outs, 0, 1, 16);
+        return current;
+    };
+
+    ysfx_slider_set_value(fx.get(), 0, 3, true);
+    REQUIRE(process() == fx.get());
+    REQUIRE(process() == fx.get());
+    REQUIRE(out[0] == 3);
+
+    SECTION("keeps state")
+    {
+        REQUIRE(ysfx_swap_reload(swap.get(), file_v2.m_path.c_str(), 0, 0,
+                                 ysfx_swap_keep_sliders|ysfx_swap_keep_memory));
+
+        // the old effect still runs until the next acquire
+        REQUIRE(ysfx_read_var(fx.get(), "version") == 1);
+        ysfx_t *current = process();
+        REQUIRE(current != fx.get());
+        REQUIRE(ysfx_read_var(current, "version") == 2);
+        REQUIRE(ysfx_get_sample_rate(current) == 48000);
+        REQUIRE(ysfx_get_block_size(current) == 16);
+        REQUIRE(ysfx_slider_get_value(current, 0) == 3);
+        REQUIRE(out[0] == 10 * 3 + 2);
+
+        // no more swaps
+        REQUIRE(process() == current);
+        ysfx_swap_collect(swap.get());
+        REQUIRE(process() == current);
+    }
+
+    SECTION("resets state")
+    {
+        REQUIRE(ysfx_swap_reload(swap.get(), file_v2.m_path.c_str(), 0, 0, 0));
+        ysfx_t *current = process();
+        REQUIRE(ysfx_slider_get_value(current, 0) == 1);
+        REQUIRE(out[0] == 10);
+    }
+
+    SECTION("a later publication replaces an earlier one")
+    {
+        ysfx_u fx2{ysfx_new(config.get())};
+        REQUIRE(ysfx_load_file(fx2.get(), file_v2.m_path.c_str(), 0));
+        REQUIRE(ysfx_compile(fx2.get(), 0));
+        REQUIRE(ysfx_swap_reload(swap.get(), file_v2.m_path.c_str(), 0, 0, 0));
+        ysfx_swap_publish(swap.get(), fx2.get(), 0);
+        REQUIRE(process() == fx2.get());
+    }
+
+    SECTION("waits for the previous effect to be collected")
+    {
+        REQUIRE(ysfx_swap_reload(swap.get(), file_v2.m_path.c_str(), 0, 0, 0));
+        ysfx_t *second = process();
+        REQUIRE(ysfx_swap_reload(swap.get(), file_v1.m_path.c_str(), 0, 0, 0));
+        REQUIRE(process() == second);
+        ysfx_swap_collect(swap.get());
+        ysfx_t *third = process();
+        REQUIRE(third != second);
+        REQUIRE(ysfx_read_var(third, "version") == 1);
+    }
+}
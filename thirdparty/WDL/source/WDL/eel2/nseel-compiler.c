@@ -74,6 +74,20 @@ FILE *g_eel_dump_fp, *g_eel_dump_fp2;
   #define NSEEL_ATOF atof
 #endif
 
+// the host may provide the pages of the code, which it gives as read-write and takes back by their size
+#if defined(NSEEL_CODE_ALLOC) && defined(_M_ARM64EC)
+  #undef NSEEL_CODE_ALLOC
+#endif
+#ifdef NSEEL_CODE_ALLOC
+  void *NSEEL_CODE_ALLOC(size_t);
+  void NSEEL_CODE_FREE(void *, size_t);
+#endif
+
+// the alignment of each chunk of the storage of variables, which the host may raise to a cache line
+#ifndef NSEEL_VARS_ALIGN
+  #define NSEEL_VARS_ALIGN 8
+#endif
+
 
 /*
   P1 is rightmost parameter
@@ -809,7 +823,9 @@ static void freeBlocks(llBlock **start, int is_code)
 #ifndef EEL_DOESNT_NEED_EXEC_PERMS
     if (is_code)
     {
-      #ifdef _WIN32
+      #if defined(NSEEL_CODE_ALLOC)
+        NSEEL_CODE_FREE(s, sizeof(*s) + s->sizealloc);
+      #elif defined(_WIN32)
         VirtualFree(s, 0, MEM_RELEASE);
       #else
         munmap(s,sizeof(*s) + s->sizealloc);
@@ -854,7 +870,10 @@ static void *__newBlock_align(llBlock **start, int size, int align, int is_for_c
   {
     const int code_page_size = eel_get_page_size();
     alloc_amt = (sizeof(*llb) + size + code_page_size - 1) & ~(code_page_size-1);
-    #ifdef _WIN32
+    #if defined(NSEEL_CODE_ALLOC)
+      llb = (llBlock *)NSEEL_CODE_ALLOC(alloc_amt);
+      if (llb == NULL) return NULL;
+    #elif defined(_WIN32)
       #ifdef _M_ARM64EC
       {
         MEM_EXTENDED_PARAMETER ext;
@@ -5595,7 +5614,7 @@ EEL_F *nseel_int_register_var(compileContext *ctx, const char *name, int isReg,
   {
     const int sz=500;
     ctx->varValueStore_left = sz;
-    ctx->varValueStore = (EEL_F *)newCtxDataBlock((int)sizeof(EEL_F)*sz,8);
+    ctx->varValueStore = (EEL_F *)newCtxDataBlock((int)sizeof(EEL_F)*sz,NSEEL_VARS_ALIGN);
   }
   if (ctx->varValueStore)
   {
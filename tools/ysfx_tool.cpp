@@ -16,26 +16,81 @@
 //
 
 #include "ysfx.h"
+#include "ysfx_audio_wav.hpp"
+#include "ysfx_audio_flac.hpp"
+#include "ysfx_utils.hpp"
 #include <getopt.h>
 #include <vector>
 #include <string>
 #include <chrono>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <functional>
 #include <cstdio>
 #include <cstdlib>
+#if !defined(YSFX_NO_GFX)
+#   define WDL_NO_DEFINE_MINMAX
+#   include "WDL/swell/swell.h"
+#   include "WDL/lice/lice.h"
+#endif
 namespace kro = std::chrono;
 
+#if defined(__GNUC__)
+#   pragma GCC diagnostic push
+#   pragma GCC diagnostic ignored "-Wunused-function"
+#endif
+
+#define DR_WAV_IMPLEMENTATION
+#define DRWAV_API static
+#define DRWAV_PRIVATE static
+#include "dr_wav.h"
+
+#if defined(__GNUC__)
+#   pragma GCC diagnostic pop
+#endif
+
 struct {
     const char *input_file = nullptr;
     bool no_gfx = false;
     bool no_serialize = false;
+    bool stats = false;
+    const char *render_file = nullptr;
+    double profile_seconds = 0;
+    const char *profile_input = nullptr;
+    const char *serve_name = nullptr;
+    std::vector<std::string> chains;
+    std::string output_dir = ".";
+    uint32_t jobs = 0;
+    uint32_t block_size = 1024;
+    uint32_t render_gfx_frames = 0;
+    uint32_t gfx_width = 0;
+    uint32_t gfx_height = 0;
+    std::vector<std::string> gfx_files;
 } args;
 
 void print_help()
 {
     fprintf(stderr, "Usage: ysfx_tool [option]... <file.jsfx>\n"
+        "       ysfx_tool --render=<audio file> --chain=<file.jsfx>[,<file.jsfx>]... [option]...\n"
+        "       ysfx_tool --render-gfx=<frames> [option]... <file.jsfx>...\n"
+        "       ysfx_tool --profile=<seconds> [--input=<audio file>] [option]... <file.jsfx>\n"
+        "       ysfx_tool --serve=<name> [option]... <file.jsfx>\n"
         "Options:\n"
         "\t" "--no-gfx          Do not compile the @gfx section" "\n"
-        "\t" "--no-serialize    Do not compile the @serialize section" "\n");
+        "\t" "--no-serialize    Do not compile the @serialize section" "\n"
+        "\t" "--stats           Print the time spent in each step of loading and compilation" "\n"
+        "\t" "--render=FILE     Render the audio file offline through each chain" "\n"
+        "\t" "--chain=LIST      Add a chain of effects, separated by commas" "\n"
+        "\t" "--render-gfx=N    Render N frames of @gfx of each effect, and save the last as PNG" "\n"
+        "\t" "--gfx-size=WxH    Size of the rendered @gfx (default: the size which the effect requests)" "\n"
+        "\t" "--output-dir=DIR  Directory of the rendered files (default: .)" "\n"
+        "\t" "--jobs=N          Number of chains or effects rendered in parallel (default: all cores)" "\n"
+        "\t" "--block-size=N    Number of frames per processing cycle (default: 1024)" "\n"
+        "\t" "--profile=SECONDS Process this much audio as fast as possible, and report where the time goes" "\n"
+        "\t" "--input=FILE      Audio file which the profile processes in a loop (default: noise)" "\n"
+        "\t" "--serve=NAME      Process the cycles of the host which created the sandbox of this name" "\n");
 }
 
 void process_args(int argc, char *argv[])
@@ -44,6 +99,17 @@ void process_args(int argc, char *argv[])
         {"help", 0, nullptr, 'h'},
         {"no-gfx", 0, nullptr, 'G'},
         {"no-serialize", 0, nullptr, 'S'},
+        {"stats", 0, nullptr, 's'},
+        {"render", 1, nullptr, 'r'},
+        {"chain", 1, nullptr, 'c'},
+        {"output-dir", 1, nullptr, 'o'},
+        {"jobs", 1, nullptr, 'j'},
+        {"block-size", 1, nullptr, 'b'},
+        {"render-gfx", 1, nullptr, 'g'},
+        {"gfx-size", 1, nullptr, 'z'},
+        {"profile", 1, nullptr, 'p'},
+        {"input", 1, nullptr, 'i'},
+        {"serve", 1, nullptr, 'x'},
         {},
     };
 
@@ -63,11 +129,116 @@ void process_args(int argc, char *argv[])
         case 'S':
             args.no_serialize = true;
             break;
+        case 's':
+            args.stats = true;
+            break;
+        case 'r':
+            args.render_file = optarg;
+            break;
+        case 'c':
+            args.chains.push_back(optarg);
+            break;
+        case 'o':
+            args.output_dir = optarg;
+            break;
+        case 'j':
+            args.jobs = (uint32_t)strtoul(optarg, nullptr, 10);
+            break;
+        case 'b':
+            args.block_size = (uint32_t)strtoul(optarg, nullptr, 10);
+            if (args.block_size == 0) {
+                fprintf(stderr, "The block size must be positive.\n");
+                exit(1);
+            }
+            break;
+        case 'g':
+            args.render_gfx_frames = (uint32_t)strtoul(optarg, nullptr, 10);
+            if (args.render_gfx_frames == 0) {
+                fprintf(stderr, "The number of frames must be positive.\n");
+                exit(1);
+            }
+            break;
+        case 'z':
+            if (sscanf(optarg, "%ux%u", &args.gfx_width, &args.gfx_height) != 2 ||
+                args.gfx_width == 0 || args.gfx_height == 0) {
+                fprintf(stderr, "The size must be given as WxH.\n");
+                exit(1);
+            }
+            break;
+        case 'p':
+            args.profile_seconds = strtod(optarg, nullptr);
+            if (!(args.profile_seconds > 0)) {
+                fprintf(stderr, "The duration of the profile must be positive.\n");
+                exit(1);
+            }
+            break;
+        case 'i':
+            args.profile_input = optarg;
+            break;
+        case 'x':
+            args.serve_name = optarg;
+            break;
         default:
             exit(1);
         }
     }
 
+    if (args.profile_input && !args.profile_seconds) {
+        fprintf(stderr, "The input is only used with --profile.\n");
+        exit(1);
+    }
+
+    if (args.serve_name) {
+        if (args.profile_seconds || args.render_file || args.render_gfx_frames) {
+            fprintf(stderr, "Please either serve, render or profile.\n");
+            exit(1);
+        }
+        if (argc - optind != 1) {
+            fprintf(stderr, "Please specify exactly one effect to serve.\n");
+            exit(1);
+        }
+        args.input_file = argv[optind];
+        return;
+    }
+
+    if (args.profile_seconds) {
+        if (args.render_file || args.render_gfx_frames) {
+            fprintf(stderr, "Please either render or profile.\n");
+            exit(1);
+        }
+        if (argc - optind != 1) {
+            fprintf(stderr, "Please specify exactly one effect to profile.\n");
+            exit(1);
+        }
+        args.input_file = argv[optind];
+        return;
+    }
+
+    if (args.render_gfx_frames) {
+        if (args.render_file) {
+            fprintf(stderr, "Please render either audio or graphics.\n");
+            exit(1);
+        }
+        if (argc - optind < 1) {
+            fprintf(stderr, "Please specify at least one effect to render.\n");
+            exit(1);
+        }
+        args.gfx_files.assign(argv + optind, argv + argc);
+        return;
+    }
+
+    if (args.render_file) {
+        if (args.chains.empty()) {
+            fprintf(stderr, "Please specify at least one chain to render.\n");
+            exit(1);
+        }
+        if (argc - optind != 0) {
+            fprintf(stderr, "Please specify the effects with --chain when rendering.\n");
+            exit(1);
+        }
+        return;
+    }
+
     if (argc - optind != 1) {
         fprintf(stderr, "Please specify exactly one input file.\n");
         exit(1);
@@ -86,6 +257,28 @@ const char *yesno(bool b)
     return b ? "yes" : "no";
 }
 
+void dump_load_stats(ysfx_t *fx)
+{
+    printf("\n" "--- statistics ---" "\n\n");
+
+    ysfx_load_stats_t stats;
+    ysfx_get_load_stats(fx, &stats);
+
+    printf("* Files: %u (%u already parsed)\n", stats.num_files, stats.num_cached_files);
+    if (stats.num_files > 0)
+        printf("* Slowest file: %s (%.3f ms)\n", stats.slowest_file, 1e-6 * (double)stats.slowest_file_ns);
+    printf("* I/O: %.3f ms\n", 1e-6 * (double)stats.io_ns);
+    printf("* Preprocess: %.3f ms\n", 1e-6 * (double)stats.preprocess_ns);
+    printf("* Parse: %.3f ms\n", 1e-6 * (double)stats.parse_ns);
+    printf("* Imports: %.3f ms\n", 1e-6 * (double)stats.import_ns);
+
+    const char *section_names[] = {nullptr, "@init", "@slider", "@block", "@sample", "@gfx", "@serialize", "@midi"};
+    for (uint32_t type = ysfx_section_init; type <= ysfx_section_midi; ++type) {
+        printf("* Compile %s: %.3f ms, %u bytes\n", section_names[type],
+               1e-6 * (double)stats.compile_ns[type], stats.code_size[type]);
+    }
+}
+
 void dump_header_info(ysfx_t *fx)
 {
     printf("\n" "--- header information ---" "\n\n");
@@ -116,6 +309,8 @@ void dump_header_info(ysfx_t *fx)
         sections.push_back("@gfx");
     if (ysfx_has_section(fx, ysfx_section_serialize))
         sections.push_back("@serialize");
+    if (ysfx_has_section(fx, ysfx_section_midi))
+        sections.push_back("@midi");
     printf("Sections: %u\n", (uint32_t)sections.size());
     for (const std::string &section : sections)
         printf("\t* ID: %s\n", section.c_str());
@@ -203,14 +398,478 @@ bool process_jsfx()
     t2 = kro::steady_clock::now();
     printf("Elapsed: %.3f ms\n", 1e3 * kro::duration<double>(t2 - t1).count());
 
+    if (args.stats)
+        dump_load_stats(fx.get());
+
     printf("\n" "--- success ---" "\n");
     return true;
 }
 
+struct render_input_t {
+    uint32_t channels = 0;
+    ysfx_real sample_rate = 0;
+    uint64_t frames = 0;
+    std::vector<ysfx_real> samples;
+};
+
+std::mutex print_mutex;
+
+void log_report_quiet(intptr_t userdata, ysfx_log_level level, const char *message)
+{
+    if (level == ysfx_log_info)
+        return;
+    std::lock_guard<std::mutex> lock{print_mutex};
+    fprintf(stderr, "%s: %s\n", ysfx_log_level_string(level), message);
+}
+
+bool read_render_input(const char *path, render_input_t &input)
+{
+    const ysfx_audio_format_t *formats[] = {&ysfx_audio_format_wav, &ysfx_audio_format_flac};
+
+    for (const ysfx_audio_format_t *fmt : formats) {
+        if (!fmt->can_handle(path))
+            continue;
+        ysfx_audio_reader_t *reader = fmt->open(path);
+        if (!reader)
+            return false;
+        auto reader_cleanup = ysfx::defer([fmt, reader]() { fmt->close(reader); });
+        ysfx_audio_file_info_t info = fmt->info(reader);
+        if (info.channels == 0)
+            return false;
+        input.channels = info.channels;
+        input.sample_rate = info.sample_rate;
+        input.samples.resize((size_t)fmt->avail(reader));
+        input.samples.resize((size_t)fmt->read(reader, input.samples.data(), input.samples.size()));
+        input.frames = input.samples.size() / input.channels;
+        return true;
+    }
+
+    return false;
+}
+
+ysfx_t *load_render_effect(const std::string &path, bool with_gfx = false)
+{
+    ysfx_config_u config{ysfx_config_new()};
+    ysfx_set_log_reporter(config.get(), &log_report_quiet);
+    ysfx_register_builtin_audio_formats(config.get());
+    ysfx_guess_file_roots(config.get(), path.c_str());
+
+    ysfx_u fx{ysfx_new(config.get())};
+    uint32_t compile_opts = with_gfx ? 0 : ysfx_compile_no_gfx;
+    if (args.no_serialize)
+        compile_opts |= ysfx_compile_no_serialize;
+    if (!ysfx_load_file(fx.get(), path.c_str(), 0) || !ysfx_compile(fx.get(), compile_opts))
+        return nullptr;
+    return fx.release();
+}
+
+bool render_chain(size_t index, const render_input_t &input)
+{
+    ysfx::string_list paths = ysfx::split_strings_noempty(
+        args.chains[index].c_str(), [](char c) -> bool { return c == ','; });
+    if (paths.empty())
+        return false;
+
+    std::vector<ysfx_u> chain;
+    chain.reserve(paths.size());
+    for (const std::string &path : paths) {
+        ysfx_u fx{load_render_effect(path)};
+        if (!fx) {
+            std::lock_guard<std::mutex> lock{print_mutex};
+            fprintf(stderr, "Cannot load effect: %s\n", path.c_str());
+            return false;
+        }
+        ysfx_set_sample_rate(fx.get(), input.sample_rate);
+        ysfx_set_block_size(fx.get(), args.block_size);
+        ysfx_init(fx.get());
+        chain.push_back(std::move(fx));
+    }
+
+    std::string output_path = ysfx::path_ensure_final_separator(args.output_dir.c_str()) +
+        std::to_string(index + 1) + "-" + ysfx::path_file_name(paths.back().c_str()) + ".wav";
+
+    drwav_data_format fmt{};
+    fmt.container = drwav_container_riff;
+    fmt.format = DR_WAVE_FORMAT_IEEE_FLOAT;
+    fmt.channels = input.channels;
+    fmt.sampleRate = (uint32_t)input.sample_rate;
+    fmt.bitsPerSample = 32;
+
+    drwav wav;
+    if (!drwav_init_file_write(&wav, output_path.c_str(), &fmt, nullptr)) {
+        std::lock_guard<std::mutex> lock{print_mutex};
+        fprintf(stderr, "Cannot write output: %s\n", output_path.c_str());
+        return false;
+    }
+    auto wav_cleanup = ysfx::defer([&wav]() { drwav_uninit(&wav); });
+
+    const uint32_t channels = input.channels;
+    std::vector<ysfx_real> block((size_t)args.block_size * channels);
+    std::vector<float> block_f32(block.size());
+
+    for (uint64_t frame = 0; frame < input.frames; frame += args.block_size) {
+        uint32_t num_frames = (uint32_t)std::min<uint64_t>(args.block_size, input.frames - frame);
+        size_t num_samples = (size_t)num_frames * channels;
+        std::copy_n(&input.samples[(size_t)frame * channels], num_samples, block.data());
+        for (ysfx_u &fx : chain)
+            ysfx_process_interleaved_double_in_place(fx.get(), block.data(), channels, num_frames);
+        for (size_t i = 0; i < num_samples; ++i)
+            block_f32[i] = (float)block[i];
+        if (drwav_write_pcm_frames(&wav, num_frames, block_f32.data()) != num_frames)
+            return false;
+    }
+
+    std::lock_guard<std::mutex> lock{print_mutex};
+    printf("* Rendered: %s\n", output_path.c_str());
+    return true;
+}
+
+uint32_t render_workers(size_t count)
+{
+    uint32_t num_workers = args.jobs;
+    if (num_workers == 0)
+        num_workers = std::max(1u, std::thread::hardware_concurrency());
+    if (num_workers > count)
+        num_workers = (uint32_t)count;
+    return num_workers;
+}
+
+// run jobs over some workers, each taking the next index; returns whether all succeeded
+bool run_render_workers(size_t count, const std::function<bool(size_t)> &job)
+{
+    std::atomic<size_t> next{0};
+    std::atomic<bool> success{true};
+    auto work = [&]() {
+        for (size_t index; (index = next.fetch_add(1)) < count; ) {
+            if (!job(index))
+                success = false;
+        }
+    };
+
+    uint32_t num_workers = render_workers(count);
+    std::vector<std::thread> workers;
+    workers.reserve(num_workers);
+    for (uint32_t i = 0; i < num_workers; ++i)
+        workers.emplace_back(work);
+    for (std::thread &worker : workers)
+        worker.join();
+
+    return success;
+}
+
+bool render_jsfx()
+{
+    render_input_t input;
+
+    printf("* Input: %s\n", args.render_file);
+    if (!read_render_input(args.render_file, input)) {
+        fprintf(stderr, "Cannot read the audio file.\n");
+        return false;
+    }
+    printf("* Channels: %u\n", input.channels);
+    printf("* Sample rate: %g\n", input.sample_rate);
+    printf("* Frames: %llu\n", (unsigned long long)input.frames);
+
+    kro::steady_clock::time_point t1 = kro::steady_clock::now();
+
+    // each worker takes the next chain, with its own set of effects
+    bool success = run_render_workers(args.chains.size(),
+        [&input](size_t index) -> bool { return render_chain(index, input); });
+
+    kro::steady_clock::time_point t2 = kro::steady_clock::now();
+    printf("Elapsed: %.3f ms\n", 1e3 * kro::duration<double>(t2 - t1).count());
+
+    return success;
+}
+
+#if !defined(YSFX_NO_GFX)
+bool render_gfx_effect(size_t index)
+{
+    const std::string &path = args.gfx_files[index];
+
+    // each worker is the UI thread of its own effects
+    ysfx_u fx{load_render_effect(path, true)};
+    if (!fx) {
+        std::lock_guard<std::mutex> lock{print_mutex};
+        fprintf(stderr, "Cannot load effect: %s\n", path.c_str());
+        return false;
+    }
+    ysfx_set_block_size(fx.get(), args.block_size);
+    ysfx_init(fx.get());
+
+    // a block of silence, for the effects which draw what they compute
+    ysfx_process_float(fx.get(), nullptr, nullptr, 0, 0, args.block_size);
+
+    uint32_t dim[2] = {args.gfx_width, args.gfx_height};
+    if (dim[0] == 0 || dim[1] == 0) {
+        ysfx_get_gfx_dim(fx.get(), dim);
+        if (dim[0] == 0 || dim[1] == 0) {
+            dim[0] = 640;
+            dim[1] = 480;
+        }
+    }
+
+    std::vector<uint8_t> pixels(4 * (size_t)dim[0] * (size_t)dim[1]);
+    if (ysfx_gfx_render_offscreen(fx.get(), dim[0], dim[1], args.render_gfx_frames, pixels.data()) == 0) {
+        std::lock_guard<std::mutex> lock{print_mutex};
+        fprintf(stderr, "Cannot render @gfx: %s\n", path.c_str());
+        return false;
+    }
+
+    std::string output_path = ysfx::path_ensure_final_separator(args.output_dir.c_str()) +
+        std::to_string(index + 1) + "-" + ysfx::path_file_name(path.c_str()) + ".png";
+
+    // the frame is opaque, whatever alpha the effect has drawn
+    LICE_WrapperBitmap bm{(LICE_pixel *)pixels.data(), (int)dim[0], (int)dim[1], (int)dim[0], false};
+    if (!LICE_WritePNG(output_path.c_str(), &bm, false)) {
+        std::lock_guard<std::mutex> lock{print_mutex};
+        fprintf(stderr, "Cannot write output: %s\n", output_path.c_str());
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock{print_mutex};
+    printf("* Rendered: %s (%ux%u)\n", output_path.c_str(), dim[0], dim[1]);
+    return true;
+}
+#endif
+
+bool render_gfx()
+{
+#if !defined(YSFX_NO_GFX)
+    kro::steady_clock::time_point t1 = kro::steady_clock::now();
+    bool success = run_render_workers(args.gfx_files.size(), &render_gfx_effect);
+    kro::steady_clock::time_point t2 = kro::steady_clock::now();
+    printf("Elapsed: %.3f ms\n", 1e3 * kro::duration<double>(t2 - t1).count());
+    return success;
+#else
+    fprintf(stderr, "Graphics are not supported in this build.\n");
+    return false;
+#endif
+}
+
+// the notes of the profile: a chord every half second, which changes its root
+void profile_send_midi(ysfx_t *fx, uint64_t frame, uint32_t num_frames, ysfx_real sample_rate, uint64_t &sent)
+{
+    const uint64_t period = std::max<uint64_t>(1, (uint64_t)(sample_rate / 2));
+    for (uint64_t next = (frame + period - 1) / period * period; next < frame + num_frames; next += period) {
+        uint64_t index = next / period;
+        uint8_t root = (uint8_t)(48 + index % 12);
+        uint8_t last = (uint8_t)(48 + (index + 11) % 12);
+        for (uint8_t interval : {0, 4, 7}) {
+            const uint8_t off[3] = {0x80, (uint8_t)(last + interval), 0};
+            const uint8_t on[3] = {0x90, (uint8_t)(root + interval), 100};
+            ysfx_midi_event_t event{0, (uint32_t)(next - frame), 3, off};
+            sent += (index > 0) && ysfx_send_midi(fx, &event);
+            event.data = on;
+            sent += ysfx_send_midi(fx, &event);
+        }
+    }
+}
+
+bool profile_jsfx()
+{
+    render_input_t input;
+    if (args.profile_input) {
+        printf("* Input: %s\n", args.profile_input);
+        if (!read_render_input(args.profile_input, input) || input.frames == 0) {
+            fprintf(stderr, "Cannot read the audio file.\n");
+            return false;
+        }
+    }
+    else {
+        printf("* Input: noise\n");
+        input.sample_rate = 48000;
+    }
+
+    ysfx_config_u config{ysfx_config_new()};
+    ysfx_set_log_reporter(config.get(), &log_report_quiet);
+    ysfx_register_builtin_audio_formats(config.get());
+    ysfx_guess_file_roots(config.get(), args.input_file);
+
+    // the lines are found by sampling, in code which is compiled with probes
+    ysfx_u fx{ysfx_new(config.get())};
+    uint32_t compile_opts = ysfx_compile_no_gfx | ysfx_compile_profile_lines;
+    if (args.no_serialize)
+        compile_opts |= ysfx_compile_no_serialize;
+    if (!ysfx_load_file(fx.get(), args.input_file, 0) || !ysfx_compile(fx.get(), compile_opts)) {
+        fprintf(stderr, "Cannot load effect: %s\n", args.input_file);
+        return false;
+    }
+
+    const uint32_t num_ins = ysfx_get_num_inputs(fx.get());
+    const uint32_t num_outs = ysfx_get_num_outputs(fx.get());
+    const uint32_t block_size = args.block_size;
+    const uint64_t total_frames = (uint64_t)(args.profile_seconds * input.sample_rate);
+
+    printf("* Effect: %s\n", args.input_file);
+    printf("* Channels: %u in, %u out\n", num_ins, num_outs);
+    printf("* Sample rate: %g\n", input.sample_rate);
+    printf("* Block size: %u\n", block_size);
+
+    ysfx_set_sample_rate(fx.get(), input.sample_rate);
+    ysfx_set_block_size(fx.get(), block_size);
+    ysfx_set_profiling(fx.get(), true);
+    ysfx_init(fx.get());
+    ysfx_reset_deadline_stats(fx.get());
+    ysfx_set_line_sampling(fx.get(), true, 0);
+
+    std::vector<double> in_buf((size_t)block_size * std::max(1u, num_ins));
+    std::vector<double> out_buf((size_t)block_size * std::max(1u, num_outs));
+    std::vector<const double *> ins(num_ins);
+    std::vector<double *> outs(num_outs);
+    for (uint32_t ch = 0; ch < num_ins; ++ch)
+        ins[ch] = &in_buf[(size_t)ch * block_size];
+    for (uint32_t ch = 0; ch < num_outs; ++ch)
+        outs[ch] = &out_buf[(size_t)ch * block_size];
+
+    uint64_t midi_in = 0;
+    uint64_t midi_out = 0;
+    uint32_t seed = 1;
+
+    kro::steady_clock::time_point t1 = kro::steady_clock::now();
+
+    for (uint64_t frame = 0; frame < total_frames; frame += block_size) {
+        uint32_t num_frames = (uint32_t)std::min<uint64_t>(block_size, total_frames - frame);
+
+        // the file loops, each pin taking a channel in turn
+        for (uint32_t ch = 0; ch < num_ins; ++ch) {
+            double *dst = &in_buf[(size_t)ch * block_size];
+            for (uint32_t i = 0; i < num_frames; ++i) {
+                if (input.frames > 0) {
+                    uint64_t position = (frame + i) % input.frames;
+                    dst[i] = input.samples[(size_t)(position * input.channels + ch % input.channels)];
+                }
+                else {
+                    seed = seed * 1103515245u + 12345u;
+                    dst[i] = 0.5 * ((double)(seed >> 8) / (1u << 24) - 0.5);
+                }
+            }
+        }
+
+        profile_send_midi(fx.get(), frame, num_frames, input.sample_rate, midi_in);
+        ysfx_process_double(fx.get(), ins.data(), outs.data(), num_ins, num_outs, num_frames);
+
+        ysfx_midi_event_t event;
+        while (ysfx_receive_midi(fx.get(), &event))
+            ++midi_out;
+    }
+
+    kro::steady_clock::time_point t2 = kro::steady_clock::now();
+    ysfx_set_profiling(fx.get(), false);
+
+    double elapsed = kro::duration<double>(t2 - t1).count();
+    double audio = (double)total_frames / input.sample_rate;
+
+    printf("\n" "--- processing ---" "\n\n");
+
+    printf("* Audio: %.3f s\n", audio);
+    printf("* Elapsed: %.3f ms\n", 1e3 * elapsed);
+    if (elapsed > 0)
+        printf("* Speed: %.1fx realtime\n", audio / elapsed);
+
+    ysfx_deadline_stats_t deadline;
+    ysfx_get_deadline_stats(fx.get(), &deadline);
+    printf("* Cycles: %llu (%llu over their deadline)\n",
+           (unsigned long long)deadline.cycles, (unsigned long long)deadline.misses);
+    printf("* Load: p50 %.0f%%, p99 %.0f%%, max %.1f%%\n",
+           100 * deadline.p50_load, 100 * deadline.p99_load, 100 * deadline.max_load);
+
+    printf("\n" "--- sections ---" "\n\n");
+
+    // the shares are of the time of the sections, of which @sample counts once per cycle
+    const char *section_names[] = {nullptr, "@init", "@slider", "@block", "@sample", "@gfx", "@serialize", "@midi"};
+    ysfx_profile_stats_t sections[ysfx_section_midi + 1] = {};
+    uint64_t sections_ns = 0;
+    for (uint32_t type = ysfx_section_init; type <= ysfx_section_midi; ++type) {
+        if (ysfx_get_profile_stats(fx.get(), type, &sections[type]))
+            sections_ns += sections[type].total_ns;
+    }
+    for (uint32_t type = ysfx_section_init; type <= ysfx_section_midi; ++type) {
+        const ysfx_profile_stats_t &stats = sections[type];
+        if (stats.calls == 0)
+            continue;
+        printf("* %s: %llu calls, %.3f ms total, %.3f us mean, %.3f us max, %.1f%%\n", section_names[type],
+               (unsigned long long)stats.calls, 1e-6 * (double)stats.total_ns,
+               1e-3 * (double)stats.total_ns / (double)stats.calls, 1e-3 * (double)stats.max_ns,
+               sections_ns ? (100.0 * (double)stats.total_ns / (double)sections_ns) : 0.0);
+    }
+
+    printf("\n" "--- memory ---" "\n\n");
+
+    ysfx_memory_stats_t memory;
+    ysfx_get_memory_stats(fx.get(), &memory);
+    printf("* High-water mark: %u slots (%.1f KiB)\n", memory.ram_high_water, (double)memory.ram_high_water * sizeof(ysfx_real) / 1024);
+    printf("* Allocated: %u blocks, %.1f KiB\n", memory.ram_blocks, (double)memory.ram_bytes / 1024);
+    printf("* Strings: %u, %llu bytes\n", memory.num_strings, (unsigned long long)memory.string_bytes);
+
+    printf("\n" "--- MIDI ---" "\n\n");
+
+    printf("* Received: %llu events (%.1f per second of audio)\n", (unsigned long long)midi_in, midi_in / audio);
+    printf("* Sent: %llu events (%.1f per second of audio)\n", (unsigned long long)midi_out, midi_out / audio);
+
+    printf("\n" "--- lines ---" "\n\n");
+
+    std::vector<ysfx_line_sample_t> lines(ysfx_get_line_samples(fx.get(), nullptr, 0));
+    lines.resize(std::min<size_t>(lines.size(), ysfx_get_line_samples(fx.get(), lines.data(), (uint32_t)lines.size())));
+    ysfx_set_line_sampling(fx.get(), false, 0);
+
+    uint64_t line_total = 0;
+    for (const ysfx_line_sample_t &line : lines)
+        line_total += line.count;
+    std::sort(lines.begin(), lines.end(),
+        [](const ysfx_line_sample_t &a, const ysfx_line_sample_t &b) -> bool { return a.count > b.count; });
+
+    if (lines.empty())
+        printf("No lines were found running.\n");
+    for (size_t i = 0; i < lines.size() && i < 20; ++i) {
+        const ysfx_line_sample_t &line = lines[i];
+        printf("* %s:%u: %llu samples, %.1f%%\n", ysfx::path_file_name(line.file).c_str(), line.line,
+               (unsigned long long)line.count, 100.0 * (double)line.count / (double)line_total);
+    }
+
+    return true;
+}
+
+bool serve_jsfx()
+{
+    ysfx_config_u config{ysfx_config_new()};
+    ysfx_set_log_reporter(config.get(), &log_report_quiet);
+    ysfx_register_builtin_audio_formats(config.get());
+    ysfx_guess_file_roots(config.get(), args.input_file);
+
+    // the child has no window, the host draws the graphics if it wants them
+    ysfx_u fx{ysfx_new(config.get())};
+    uint32_t compile_opts = ysfx_compile_no_gfx;
+    if (args.no_serialize)
+        compile_opts |= ysfx_compile_no_serialize;
+    if (!ysfx_load_file(fx.get(), args.input_file, 0) || !ysfx_compile(fx.get(), compile_opts)) {
+        fprintf(stderr, "Cannot load effect: %s\n", args.input_file);
+        return false;
+    }
+
+    if (!ysfx_sandbox_serve(fx.get(), args.serve_name)) {
+        fprintf(stderr, "Cannot open the sandbox: %s\n", args.serve_name);
+        return false;
+    }
+    return true;
+}
+
 int main(int argc, char *argv[])
 {
     process_args(argc, argv);
 
+    if (args.serve_name)
+        return serve_jsfx() ? 0 : 1;
+
+    if (args.profile_seconds)
+        return profile_jsfx() ? 0 : 1;
+
+    if (args.render_gfx_frames)
+        return render_gfx() ? 0 : 1;
+
+    if (args.render_file)
+        return render_jsfx() ? 0 : 1;
+
     if (!process_jsfx())
         return 1;
 